@@ -29,12 +29,17 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "dispatch.h"
+#include "kernels.h"
+#include "run_adding.h"
+#include "utils.h"
 
 /*****************************************************************************/
 
@@ -118,6 +123,24 @@ public:
 
 /*****************************************************************************/
 
+static void setDecoderRunAddingGain(LADSPA_Handle Instance,
+				    LADSPA_Data Gain);
+
+/** The decoders below share a run_adding gain. */
+class AmbisonicDecoder : public CMT_PluginInstance {
+protected:
+  LADSPA_Data m_fRunAddingGain;
+public:
+  AmbisonicDecoder(const unsigned long lPortCount)
+    : CMT_PluginInstance(lPortCount),
+      m_fRunAddingGain(1) {
+  }
+  friend void setDecoderRunAddingGain(LADSPA_Handle Instance,
+				      LADSPA_Data Gain);
+};
+
+/*****************************************************************************/
+
 #define DECST_IN_W  0
 #define DECST_IN_X  1
 #define DECST_IN_Y  2
@@ -125,16 +148,18 @@ public:
 #define DECST_OUT_L 4
 #define DECST_OUT_R 5
 
+template <OutputFunction write_output>
 static void runBFormatToStereo(LADSPA_Handle Instance,
                                unsigned long SampleCount);
 
 /** This plugin decodes B-Format to produce a stereo speaker feed. */
-class BFormatToStereo : public CMT_PluginInstance {
+class BFormatToStereo : public AmbisonicDecoder {
 public:
   BFormatToStereo(const LADSPA_Descriptor *,
 		  unsigned long lSampleRate)
-    : CMT_PluginInstance(6) {
+    : AmbisonicDecoder(6) {
   }
+  template <OutputFunction write_output>
   friend void runBFormatToStereo(LADSPA_Handle Instance,
 				 unsigned long SampleCount);
 };
@@ -150,16 +175,18 @@ public:
 #define DECQ_OUT_BL 6
 #define DECQ_OUT_BR 7
 
+template <OutputFunction write_output>
 static void runBFormatToQuad(LADSPA_Handle Instance,
                              unsigned long SampleCount);
 
 /** This plugin decodes B-Format to produce a quad (square) speaker feed. */
-class BFormatToQuad : public CMT_PluginInstance {
+class BFormatToQuad : public AmbisonicDecoder {
 public:
   BFormatToQuad(const LADSPA_Descriptor *,
 		unsigned long lSampleRate)
-    : CMT_PluginInstance(8) {
+    : AmbisonicDecoder(8) {
   }
+  template <OutputFunction write_output>
   friend void runBFormatToQuad(LADSPA_Handle Instance,
 			       unsigned long SampleCount);
 };
@@ -179,17 +206,19 @@ public:
 #define DECC_OUT_TBL 10
 #define DECC_OUT_TBR 11
 
+template <OutputFunction write_output>
 static void runBFormatToCube(LADSPA_Handle Instance,
                              unsigned long SampleCount);
 
 /** This plugin decodes B-Format to produce a speaker feed for eight
     speakers arranged at the corners of a cube. */
-class BFormatToCube : public CMT_PluginInstance {
+class BFormatToCube : public AmbisonicDecoder {
 public:
   BFormatToCube(const LADSPA_Descriptor *,
 		unsigned long lSampleRate)
-    : CMT_PluginInstance(12) {
+    : AmbisonicDecoder(12) {
   }
+  template <OutputFunction write_output>
   friend void runBFormatToCube(LADSPA_Handle Instance,
 			       unsigned long SampleCount);
 };
@@ -214,17 +243,19 @@ public:
 #define DECO_OUT_BLL  15
 #define DECO_OUT_FLL  16
 
+template <OutputFunction write_output>
 static void runFMHFormatToOct(LADSPA_Handle Instance,
                               unsigned long SampleCount);
 
 /** This plugin decodes FMH-Format to produce a speaker feed for eight
     speakers arranged at the corners of an octagon. */
-class FMHFormatToOct : public CMT_PluginInstance {
+class FMHFormatToOct : public AmbisonicDecoder {
 public:
   FMHFormatToOct(const LADSPA_Descriptor *,
 	       unsigned long lSampleRate)
-    : CMT_PluginInstance(17) {
+    : AmbisonicDecoder(17) {
   }
+  template <OutputFunction write_output>
   friend void runFMHFormatToOct(LADSPA_Handle Instance,
 				unsigned long SampleCount);
 };
@@ -241,18 +272,53 @@ public:
 #define BFROT_OUT_Y    7
 #define BFROT_OUT_Z    8
 
+static void activateRotation(LADSPA_Handle Instance);
 static void runBFormatRotation(LADSPA_Handle Instance,
                                unsigned long SampleCount);
+static void runFMHFormatRotation(LADSPA_Handle Instance,
+                                 unsigned long SampleCount);
+
+/** Base class for the rotation plugins, which smooth changes to the
+    rotation angle (in degrees). */
+class SoundfieldRotation : public CMT_PluginInstance {
+protected:
+
+  ParameterSmoother<> m_oAngle;
+
+  /** Ramp towards fDegrees the short way round. */
+  void setAngleTarget(const LADSPA_Data fDegrees) {
+    LADSPA_Data fDelta = fmod(fDegrees - m_oAngle.getTarget(), 360);
+    if (fDelta > 180)
+      fDelta -= 360;
+    else if (fDelta < -180)
+      fDelta += 360;
+    /* Ignore rounding differences between equivalent angles. */
+    if (fabs(fDelta) > 1e-3)
+      m_oAngle.setTarget(m_oAngle.getTarget() + fDelta);
+    else
+      m_oAngle.setTarget(m_oAngle.getTarget());
+  }
+
+public:
+  SoundfieldRotation(unsigned long lPortCount,
+		     unsigned long lSampleRate)
+    : CMT_PluginInstance(lPortCount),
+      m_oAngle(LADSPA_Data(lSampleRate)) {
+  }
+  friend void activateRotation(LADSPA_Handle Instance);
+  friend void runBFormatRotation(LADSPA_Handle Instance,
+				 unsigned long SampleCount);
+  friend void runFMHFormatRotation(LADSPA_Handle Instance,
+				   unsigned long SampleCount);
+};
 
 /** This plugin rotates an B-Format soundfield around the Z-axis. */
-class BFormatRotation : public CMT_PluginInstance {
+class BFormatRotation : public SoundfieldRotation {
 public:
   BFormatRotation(const LADSPA_Descriptor *,
 		  unsigned long lSampleRate)
-    : CMT_PluginInstance(9) {
+    : SoundfieldRotation(9, lSampleRate) {
   }
-  friend void runBFormatRotation(LADSPA_Handle Instance,
-				 unsigned long SampleCount);
 };
 
 /*****************************************************************************/
@@ -279,18 +345,13 @@ public:
 #define FMHROT_OUT_U    17
 #define FMHROT_OUT_V    18
 
-static void runFMHFormatRotation(LADSPA_Handle Instance,
-                                 unsigned long SampleCount);
-
 /** This plugin rotates an FMH-Format soundfield around the Z-axis. */
-class FMHFormatRotation : public CMT_PluginInstance {
+class FMHFormatRotation : public SoundfieldRotation {
 public:
   FMHFormatRotation(const LADSPA_Descriptor *,
 		    unsigned long lSampleRate)
-    : CMT_PluginInstance(19) {
+    : SoundfieldRotation(19, lSampleRate) {
   }
-  friend void runFMHFormatRotation(LADSPA_Handle Instance,
-				   unsigned long SampleCount);
 };
 
 /*****************************************************************************/
@@ -426,6 +487,15 @@ runFMHToB(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+static void
+setDecoderRunAddingGain(LADSPA_Handle Instance,
+			LADSPA_Data Gain) {
+  ((AmbisonicDecoder *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+template <OutputFunction write_output>
 static void
 runBFormatToStereo(LADSPA_Handle Instance,
 		   unsigned long SampleCount) {
@@ -443,14 +513,15 @@ runBFormatToStereo(LADSPA_Handle Instance,
        lSampleIndex++) {
     LADSPA_Data fA = 0.707107 * *(pfInW++);
     LADSPA_Data fB = 0.5 * *(pfInY++);
-    *(pfOutL++) = fA + fB;
-    *(pfOutR++) = fA - fB;
+    write_output(pfOutL, fA + fB, poProcessor->m_fRunAddingGain);
+    write_output(pfOutR, fA - fB, poProcessor->m_fRunAddingGain);
   }
 
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void
 runBFormatToQuad(LADSPA_Handle Instance,
 		 unsigned long SampleCount) {
@@ -471,18 +542,19 @@ runBFormatToQuad(LADSPA_Handle Instance,
        lSampleIndex++) {
     LADSPA_Data fW = 0.353553 * *(pfInW++);
     LADSPA_Data fX = 0.243361 * *(pfInX++);
-    LADSPA_Data fY = 0.243361 * *(pfInY++);
+    LADSPA_Data fY = 0.243361 * *pfInY;
     LADSPA_Data fV = 0.096383 * *(pfInY++);
-    *(pfOutFL++) = fW + fX + fY + fV;
-    *(pfOutFR++) = fW + fX - fY - fV;
-    *(pfOutBL++) = fW - fX + fY + fV;
-    *(pfOutBR++) = fW - fX - fY - fV;
+    write_output(pfOutFL, fW + fX + fY + fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutFR, fW + fX - fY - fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBL, fW - fX + fY + fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBR, fW - fX - fY - fV, poProcessor->m_fRunAddingGain);
   }
 
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void
 runBFormatToCube(LADSPA_Handle Instance,
 		 unsigned long SampleCount) {
@@ -498,35 +570,36 @@ runBFormatToCube(LADSPA_Handle Instance,
   LADSPA_Data * pfOutBFR = poProcessor->m_ppfPorts[DECC_OUT_BFR];
   LADSPA_Data * pfOutBBL = poProcessor->m_ppfPorts[DECC_OUT_BBL];
   LADSPA_Data * pfOutBBR = poProcessor->m_ppfPorts[DECC_OUT_BBR];
-  LADSPA_Data * pfOutTFL = poProcessor->m_ppfPorts[DECC_OUT_BFL];
-  LADSPA_Data * pfOutTFR = poProcessor->m_ppfPorts[DECC_OUT_BFR];
-  LADSPA_Data * pfOutTBL = poProcessor->m_ppfPorts[DECC_OUT_BBL];
-  LADSPA_Data * pfOutTBR = poProcessor->m_ppfPorts[DECC_OUT_BBR];
+  LADSPA_Data * pfOutTFL = poProcessor->m_ppfPorts[DECC_OUT_TFL];
+  LADSPA_Data * pfOutTFR = poProcessor->m_ppfPorts[DECC_OUT_TFR];
+  LADSPA_Data * pfOutTBL = poProcessor->m_ppfPorts[DECC_OUT_TBL];
+  LADSPA_Data * pfOutTBR = poProcessor->m_ppfPorts[DECC_OUT_TBR];
 
   for (unsigned long lSampleIndex = 0; 
        lSampleIndex < SampleCount; 
        lSampleIndex++) {
     LADSPA_Data fW = 0.176777 * *(pfInW++);
-    LADSPA_Data fX = 0.113996 * *(pfInX++);
-    LADSPA_Data fY = 0.113996 * *(pfInY++);
-    LADSPA_Data fZ = 0.113996 * *(pfInZ++);
+    LADSPA_Data fX = 0.113996 * *pfInX;
+    LADSPA_Data fY = 0.113996 * *pfInY;
+    LADSPA_Data fZ = 0.113996 * *pfInZ;
     LADSPA_Data fS = 0.036859 * *(pfInX++);
     LADSPA_Data fT = 0.036859 * *(pfInY++);
     LADSPA_Data fV = 0.036859 * *(pfInZ++);
-    *(pfOutBFL++) = fW + fX + fY - fZ + fV - fT - fS;
-    *(pfOutBFR++) = fW + fX - fY - fZ - fV + fT - fS;
-    *(pfOutBBL++) = fW - fX + fY - fZ + fV + fT + fS;
-    *(pfOutBBR++) = fW - fX - fY - fZ - fV - fT + fS;
-    *(pfOutTFL++) = fW + fX + fY + fZ + fV + fT + fS;
-    *(pfOutTFR++) = fW + fX - fY + fZ - fV - fT + fS;
-    *(pfOutTBL++) = fW - fX + fY + fZ + fV - fT - fS;
-    *(pfOutTBR++) = fW - fX - fY + fZ - fV + fT - fS;
+    write_output(pfOutBFL, fW + fX + fY - fZ + fV - fT - fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBFR, fW + fX - fY - fZ - fV + fT - fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBBL, fW - fX + fY - fZ + fV + fT + fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBBR, fW - fX - fY - fZ - fV - fT + fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutTFL, fW + fX + fY + fZ + fV + fT + fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutTFR, fW + fX - fY + fZ - fV - fT + fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutTBL, fW - fX + fY + fZ + fV - fT - fS, poProcessor->m_fRunAddingGain);
+    write_output(pfOutTBR, fW - fX - fY + fZ - fV + fT - fS, poProcessor->m_fRunAddingGain);
   }
 
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void
 runFMHFormatToOct(LADSPA_Handle Instance,
 		  unsigned long SampleCount) {
@@ -558,31 +631,41 @@ runFMHFormatToOct(LADSPA_Handle Instance,
     LADSPA_Data fY2 = 0.159068 * *(pfInY++);
     LADSPA_Data fU  = 0.034175 * *(pfInU++);
     LADSPA_Data fV  = 0.034175 * *(pfInV++);
-    *(pfOutFFL++) = fW + fX2 + fY1 + fU + fV;
-    *(pfOutFFR++) = fW + fX2 - fY1 + fU - fV;
-    *(pfOutFRR++) = fW + fX1 - fY2 - fU - fV;
-    *(pfOutBRR++) = fW - fX1 + fY2 - fU + fV;
-    *(pfOutBBR++) = fW - fX2 + fY1 + fU + fV;
-    *(pfOutBBL++) = fW - fX2 - fY1 + fU - fV;
-    *(pfOutBLL++) = fW - fX1 - fY2 - fU - fV;
-    *(pfOutFLL++) = fW + fX1 + fY2 - fU + fV;
+    write_output(pfOutFFL, fW + fX2 + fY1 + fU + fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutFFR, fW + fX2 - fY1 + fU - fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutFRR, fW + fX1 - fY2 - fU - fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBRR, fW - fX1 + fY2 - fU + fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBBR, fW - fX2 + fY1 + fU + fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBBL, fW - fX2 - fY1 + fU - fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutBLL, fW - fX1 - fY2 - fU - fV, poProcessor->m_fRunAddingGain);
+    write_output(pfOutFLL, fW + fX1 + fY2 - fU + fV, poProcessor->m_fRunAddingGain);
   }
 
 }
 
 /*****************************************************************************/
 
+static void
+activateRotation(LADSPA_Handle Instance) {
+  ((SoundfieldRotation *)Instance)->m_oAngle.reset();
+}
+
+/*****************************************************************************/
+
 static void
 runBFormatRotation(LADSPA_Handle Instance,
 		   unsigned long SampleCount) {
 
   BFormatRotation * poProcessor = (BFormatRotation *)Instance;
 
+  poProcessor->setAngleTarget(*(poProcessor->m_ppfPorts[BFROT_ANGLE]));
+  ParameterSmoother<> & oAngle = poProcessor->m_oAngle;
+
   /* Work in radians. */
-  LADSPA_Data fAngle 
-    = LADSPA_Data(M_PI / 180.0) * *(poProcessor->m_ppfPorts[FMHROT_ANGLE]);
+  LADSPA_Data fAngle = LADSPA_Data(M_PI / 180.0) * oAngle.getValue();
   LADSPA_Data fSin = sin(fAngle);
   LADSPA_Data fCos = cos(fAngle);
+  const bool bConstant = oAngle.isConstant();
 
   LADSPA_Data * pfInW  = poProcessor->m_ppfPorts[BFROT_IN_W];
   LADSPA_Data * pfInX  = poProcessor->m_ppfPorts[BFROT_IN_X];
@@ -601,6 +684,11 @@ runBFormatRotation(LADSPA_Handle Instance,
   for (unsigned long lSampleIndex = 0; 
        lSampleIndex < SampleCount; 
        lSampleIndex++) {
+    if (!bConstant) {
+      fAngle = LADSPA_Data(M_PI / 180.0) * oAngle.next();
+      fSin = sin(fAngle);
+      fCos = cos(fAngle);
+    }
     float fInX = *(pfInX++);
     float fInY = *(pfInY++);
     *(pfOutX++) = fCos * fInX - fSin  * fInY;
@@ -616,13 +704,16 @@ runFMHFormatRotation(LADSPA_Handle Instance,
 
   FMHFormatRotation * poProcessor = (FMHFormatRotation *)Instance;
 
+  poProcessor->setAngleTarget(*(poProcessor->m_ppfPorts[FMHROT_ANGLE]));
+  ParameterSmoother<> & oAngle = poProcessor->m_oAngle;
+
   /* Work in radians. */
-  LADSPA_Data fAngle 
-    = LADSPA_Data(M_PI / 180.0) * *(poProcessor->m_ppfPorts[FMHROT_ANGLE]);
+  LADSPA_Data fAngle = LADSPA_Data(M_PI / 180.0) * oAngle.getValue();
   LADSPA_Data fSin = sin(fAngle);
   LADSPA_Data fCos = cos(fAngle);
   LADSPA_Data fSin2 = sin(fAngle * 2);
   LADSPA_Data fCos2 = cos(fAngle * 2);
+  const bool bConstant = oAngle.isConstant();
 
   LADSPA_Data * pfInW  = poProcessor->m_ppfPorts[FMHROT_IN_W];
   LADSPA_Data * pfInX  = poProcessor->m_ppfPorts[FMHROT_IN_X];
@@ -653,6 +744,14 @@ runFMHFormatRotation(LADSPA_Handle Instance,
        lSampleIndex < SampleCount; 
        lSampleIndex++) {
 
+    if (!bConstant) {
+      fAngle = LADSPA_Data(M_PI / 180.0) * oAngle.next();
+      fSin = sin(fAngle);
+      fCos = cos(fAngle);
+      fSin2 = sin(fAngle * 2);
+      fCos2 = cos(fAngle * 2);
+    }
+
     float fInX = *(pfInX++);
     float fInY = *(pfInY++);
     float fInS = *(pfInS++);
@@ -671,6 +770,944 @@ runFMHFormatRotation(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+/* The panners below fuse an encoder, a rotation and a decoder. For a
+   mono source with fixed coordinates and angle, each speaker feed is
+   just the input times a gain. The panner composes the encoder
+   gains, the rotation and the decoder matrix into one gain per
+   speaker each block, and the only audio it writes is the speaker
+   outputs. Gains are ramped across each block so that moving the
+   source or the rotation does not click. */
+
+#define PAN_INPUT  0
+#define PAN_X      1
+#define PAN_Y      2
+#define PAN_Z      3
+#define PAN_ANGLE  4
+#define PAN_OUTPUT 5
+
+#define PAN_STEREO 0
+#define PAN_QUAD   1
+#define PAN_CUBE   2
+#define PAN_OCT    3
+
+#define PAN_LAYOUT_COUNT 4
+
+#define PAN_MAX_SPEAKERS 8
+
+/** Input is copied through a buffer of this many samples so that
+    outputs may share a buffer with the input. */
+#define PAN_CHUNK 64
+
+/** Speakers and the decoder matrix (W, X, Y, Z, R, S, T, U, V
+    columns) of each layout. These match the bf2stereo, bf2quad,
+    bf2cube and fmh2oct decoders, except that the second order terms
+    are left out of the B-Format decoders as B-Format carries no
+    second order channels. */
+static const int g_piPannerSpeakers[PAN_LAYOUT_COUNT] = { 2, 4, 8, 8 };
+static const float g_aaafPannerDecoders[PAN_LAYOUT_COUNT]
+                                       [PAN_MAX_SPEAKERS]
+                                       [9] = {
+  /* Stereo. */
+  { { 0.707107f, 0, 0.5f, 0, 0, 0, 0, 0, 0 },
+    { 0.707107f, 0, -0.5f, 0, 0, 0, 0, 0, 0 } },
+  /* Quad. */
+  { { 0.353553f, 0.243361f, 0.243361f, 0, 0, 0, 0, 0, 0 },
+    { 0.353553f, 0.243361f, -0.243361f, 0, 0, 0, 0, 0, 0 },
+    { 0.353553f, -0.243361f, 0.243361f, 0, 0, 0, 0, 0, 0 },
+    { 0.353553f, -0.243361f, -0.243361f, 0, 0, 0, 0, 0, 0 } },
+  /* Cube. */
+  { { 0.176777f, 0.113996f, 0.113996f, -0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, 0.113996f, -0.113996f, -0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, -0.113996f, 0.113996f, -0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, -0.113996f, -0.113996f, -0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, 0.113996f, 0.113996f, 0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, 0.113996f, -0.113996f, 0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, -0.113996f, 0.113996f, 0.113996f, 0, 0, 0, 0, 0 },
+    { 0.176777f, -0.113996f, -0.113996f, 0.113996f, 0, 0, 0, 0, 0 } },
+  /* Octagon. */
+  { { 0.176777f, 0.159068f, 0.065888f, 0, 0, 0, 0, 0.034175f, 0.034175f },
+    { 0.176777f, 0.159068f, -0.065888f, 0, 0, 0, 0, 0.034175f, -0.034175f },
+    { 0.176777f, 0.065888f, -0.159068f, 0, 0, 0, 0, -0.034175f, -0.034175f },
+    { 0.176777f, -0.065888f, 0.159068f, 0, 0, 0, 0, -0.034175f, 0.034175f },
+    { 0.176777f, -0.159068f, 0.065888f, 0, 0, 0, 0, 0.034175f, 0.034175f },
+    { 0.176777f, -0.159068f, -0.065888f, 0, 0, 0, 0, 0.034175f, -0.034175f },
+    { 0.176777f, -0.065888f, -0.159068f, 0, 0, 0, 0, -0.034175f, -0.034175f },
+    { 0.176777f, 0.065888f, 0.159068f, 0, 0, 0, 0, -0.034175f, 0.034175f } }
+};
+
+static void activateAmbisonicPanner(LADSPA_Handle Instance);
+static void setAmbisonicPannerRunAddingGain(LADSPA_Handle Instance,
+					    LADSPA_Data Gain);
+template <int iLayout, OutputFunction write_output>
+static void runAmbisonicPanner(LADSPA_Handle Instance,
+			       unsigned long SampleCount);
+
+/** This plugin encodes a signal at a position in a virtual space,
+    rotates the soundfield around the Z-axis and decodes it to
+    speakers in one step. */
+class AmbisonicPanner : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_afGain[PAN_MAX_SPEAKERS];
+  bool m_bGainsSet;
+  LADSPA_Data m_fRunAddingGain;
+
+public:
+  AmbisonicPanner(const LADSPA_Descriptor * psDescriptor,
+		  unsigned long lSampleRate)
+    : CMT_PluginInstance(psDescriptor->PortCount),
+      m_bGainsSet(false),
+      m_fRunAddingGain(1) {
+  }
+  friend void activateAmbisonicPanner(LADSPA_Handle Instance);
+  friend void setAmbisonicPannerRunAddingGain(LADSPA_Handle Instance,
+					      LADSPA_Data Gain);
+  template <int iLayout, OutputFunction write_output>
+  friend void runAmbisonicPanner(LADSPA_Handle Instance,
+				 unsigned long SampleCount);
+};
+
+/*****************************************************************************/
+
+static void
+activateAmbisonicPanner(LADSPA_Handle Instance) {
+  ((AmbisonicPanner *)Instance)->m_bGainsSet = false;
+}
+
+/*****************************************************************************/
+
+static void
+setAmbisonicPannerRunAddingGain(LADSPA_Handle Instance,
+				LADSPA_Data Gain) {
+  ((AmbisonicPanner *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+template <int iLayout, OutputFunction write_output>
+static void
+runAmbisonicPanner(LADSPA_Handle Instance,
+		   unsigned long SampleCount) {
+
+  AmbisonicPanner * poProcessor = (AmbisonicPanner *)Instance;
+  const int iSpeakers = g_piPannerSpeakers[iLayout];
+
+  /* Encode, as encode_fmh does. */
+  LADSPA_Data fX = *(poProcessor->m_ppfPorts[PAN_X]);
+  LADSPA_Data fY = *(poProcessor->m_ppfPorts[PAN_Y]);
+  LADSPA_Data fZ = *(poProcessor->m_ppfPorts[PAN_Z]);
+  LADSPA_Data fDistanceSquared = fX * fX + fY * fY + fZ * fZ;
+  LADSPA_Data afChannel[9];
+  afChannel[0] = 0.707107;
+  if (fDistanceSquared > 1e-10) {
+    LADSPA_Data fOneOverDistanceSquared 
+      = 1 / fDistanceSquared;
+    LADSPA_Data fOneOverDistanceCubed 
+      = LADSPA_Data(pow(fDistanceSquared, -1.5));
+    afChannel[1] = fX * fOneOverDistanceSquared;
+    afChannel[2] = fY * fOneOverDistanceSquared;
+    afChannel[3] = fZ * fOneOverDistanceSquared;
+    afChannel[4] = ((fZ * fZ) * fOneOverDistanceSquared - 0.5) 
+      * sqrt(fOneOverDistanceSquared);
+    afChannel[5] = 2 * (fZ * fX) * fOneOverDistanceCubed;
+    afChannel[6] = 2 * (fY * fX) * fOneOverDistanceCubed;
+    afChannel[7] = (fX * fX - fY * fY) * fOneOverDistanceCubed;
+    afChannel[8] = 2 * (fX * fY) * fOneOverDistanceCubed;
+  }
+  else {
+    /* Avoid division by zero issues. */
+    for (int iChannel = 1; iChannel < 9; iChannel++)
+      afChannel[iChannel] = 0;
+  }
+
+  /* Rotate, as fmh_rotate_z does. */
+  LADSPA_Data fAngle 
+    = LADSPA_Data(M_PI / 180.0) * *(poProcessor->m_ppfPorts[PAN_ANGLE]);
+  LADSPA_Data fSin = sin(fAngle);
+  LADSPA_Data fCos = cos(fAngle);
+  LADSPA_Data fSin2 = sin(fAngle * 2);
+  LADSPA_Data fCos2 = cos(fAngle * 2);
+  LADSPA_Data fA, fB;
+  fA = afChannel[1];
+  fB = afChannel[2];
+  afChannel[1] = fCos * fA - fSin * fB;
+  afChannel[2] = fSin * fA + fCos * fB;
+  fA = afChannel[5];
+  fB = afChannel[6];
+  afChannel[5] = fCos * fA - fSin * fB;
+  afChannel[6] = fSin * fA + fCos * fB;
+  fA = afChannel[7];
+  fB = afChannel[8];
+  afChannel[7] = fCos2 * fA - fSin2 * fB;
+  afChannel[8] = fSin2 * fA + fCos2 * fB;
+
+  /* Decode. The first block after activation starts at its gains
+     rather than ramping from silence. */
+  LADSPA_Data afGainStep[PAN_MAX_SPEAKERS];
+  const LADSPA_Data fRampScalar = SampleCount > 0 ? 1.0f / SampleCount : 0;
+  int iSpeaker;
+  for (iSpeaker = 0; iSpeaker < iSpeakers; iSpeaker++) {
+    const float * pfDecoder = g_aaafPannerDecoders[iLayout][iSpeaker];
+    LADSPA_Data fGain = 0;
+    for (int iChannel = 0; iChannel < 9; iChannel++)
+      fGain += pfDecoder[iChannel] * afChannel[iChannel];
+    if (!poProcessor->m_bGainsSet)
+      poProcessor->m_afGain[iSpeaker] = fGain;
+    afGainStep[iSpeaker] 
+      = (fGain - poProcessor->m_afGain[iSpeaker]) * fRampScalar;
+  }
+  poProcessor->m_bGainsSet = true;
+
+  const LADSPA_Data fOutputGain 
+    = get_gain<write_output>(poProcessor->m_fRunAddingGain);
+  const LADSPA_Data * pfInput = poProcessor->m_ppfPorts[PAN_INPUT];
+  LADSPA_Data afInput[PAN_CHUNK];
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+
+    const unsigned long lChunkSize 
+      = (SampleCount - lChunkStart < PAN_CHUNK 
+	 ? SampleCount - lChunkStart 
+	 : PAN_CHUNK);
+    memcpy(afInput, pfInput + lChunkStart, sizeof(LADSPA_Data) * lChunkSize);
+
+    for (iSpeaker = 0; iSpeaker < iSpeakers; iSpeaker++) {
+      const LADSPA_Data fGain = poProcessor->m_afGain[iSpeaker];
+      const LADSPA_Data fGainStep = afGainStep[iSpeaker];
+      dispatchWriteGainRamp<is_adding<write_output>()>
+	(poProcessor->m_ppfPorts[PAN_OUTPUT + iSpeaker] + lChunkStart,
+	 afInput,
+	 fGain * fOutputGain,
+	 fGainStep * fOutputGain,
+	 lChunkSize);
+      poProcessor->m_afGain[iSpeaker] = fGain + lChunkSize * fGainStep;
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* Encoders for moving sources. encode_bformat and encode_fmh read
+   the source position once per block, so a moving source steps at
+   each block boundary. The smoothed encoders glide their control
+   position instead, working out the channel gains every PAN_CHUNK
+   samples and ramping between them, while the audio rate encoders
+   take the position as audio and work out the gains for each
+   sample. The gains are those of encode_bformat and encode_fmh, to
+   within the accuracy of inverseDistance(). */
+
+#define MENC_INPUT  0
+#define MENC_X      1
+#define MENC_Y      2
+#define MENC_Z      3
+#define MENC_OUTPUT 4
+
+#define MENC_MAX_CHANNELS 9
+
+static void activateMovingEncoder(LADSPA_Handle Instance);
+template <int iChannels>
+static void runSmoothMovingEncoder(LADSPA_Handle Instance,
+				   unsigned long SampleCount);
+template <int iChannels>
+static void runAudioMovingEncoder(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+
+/** This plugin encodes a moving source to B-Format (4 channels) or
+    FMH-Format (9 channels). */
+class MovingEncoder : public CMT_PluginInstance {
+private:
+
+  /** Source position, used by the smoothed encoders only. */
+  ParameterSmoother<> m_aoPosition[3];
+
+public:
+  MovingEncoder(const LADSPA_Descriptor * psDescriptor,
+		unsigned long lSampleRate)
+    : CMT_PluginInstance(psDescriptor->PortCount) {
+    for (int iAxis = 0; iAxis < 3; iAxis++)
+      m_aoPosition[iAxis] = ParameterSmoother<>(LADSPA_Data(lSampleRate));
+  }
+  friend void activateMovingEncoder(LADSPA_Handle Instance);
+  template <int iChannels>
+  friend void runSmoothMovingEncoder(LADSPA_Handle Instance,
+				     unsigned long SampleCount);
+  template <int iChannels>
+  friend void runAudioMovingEncoder(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+};
+
+/*****************************************************************************/
+
+/** Calculate the gains of the iChannels channels of an encoder for a
+    source at (fX, fY, fZ), given fOneOverDistance as calculated by
+    inverseDistance(). */
+template <int iChannels>
+inline void
+calculateMovingEncoderGains(LADSPA_Data * pfGains,
+			    const LADSPA_Data fX,
+			    const LADSPA_Data fY,
+			    const LADSPA_Data fZ,
+			    const LADSPA_Data fOneOverDistance) {
+  const LADSPA_Data fOneOverDistanceSquared 
+    = fOneOverDistance * fOneOverDistance;
+  pfGains[0] = 0.707107f;
+  pfGains[1] = fX * fOneOverDistanceSquared;
+  pfGains[2] = fY * fOneOverDistanceSquared;
+  pfGains[3] = fZ * fOneOverDistanceSquared;
+  if (iChannels == 9) {
+    const LADSPA_Data fOneOverDistanceCubed 
+      = fOneOverDistanceSquared * fOneOverDistance;
+    pfGains[4] = ((fZ * fZ) * fOneOverDistanceSquared - 0.5f) 
+      * fOneOverDistance;
+    pfGains[5] = 2 * (fZ * fX) * fOneOverDistanceCubed;
+    pfGains[6] = 2 * (fY * fX) * fOneOverDistanceCubed;
+    pfGains[7] = (fX * fX - fY * fY) * fOneOverDistanceCubed;
+    pfGains[8] = 2 * (fX * fY) * fOneOverDistanceCubed;
+  }
+}
+
+/** As above, for a source held in smoothers. */
+template <int iChannels>
+inline void
+calculateMovingEncoderGains(LADSPA_Data * pfGains,
+			    const ParameterSmoother<> * poPosition) {
+  const LADSPA_Data fX = poPosition[0].getValue();
+  const LADSPA_Data fY = poPosition[1].getValue();
+  const LADSPA_Data fZ = poPosition[2].getValue();
+  LADSPA_Data fOneOverDistance;
+  inverseDistance(&fOneOverDistance, &fX, &fY, &fZ, 1);
+  calculateMovingEncoderGains<iChannels>(pfGains, fX, fY, fZ, 
+					 fOneOverDistance);
+}
+
+/*****************************************************************************/
+
+static void
+activateMovingEncoder(LADSPA_Handle Instance) {
+  MovingEncoder * poProcessor = (MovingEncoder *)Instance;
+  for (int iAxis = 0; iAxis < 3; iAxis++)
+    poProcessor->m_aoPosition[iAxis].reset();
+}
+
+/*****************************************************************************/
+
+template <int iChannels>
+static void
+runSmoothMovingEncoder(LADSPA_Handle Instance,
+		       unsigned long SampleCount) {
+
+  MovingEncoder * poProcessor = (MovingEncoder *)Instance;
+  ParameterSmoother<> * poPosition = poProcessor->m_aoPosition;
+
+  bool bConstant = true;
+  for (int iAxis = 0; iAxis < 3; iAxis++) {
+    poPosition[iAxis].setTarget(*(poProcessor->m_ppfPorts[MENC_X + iAxis]));
+    bConstant = bConstant && poPosition[iAxis].isConstant();
+  }
+
+  LADSPA_Data afGain[MENC_MAX_CHANNELS];
+  LADSPA_Data afNextGain[MENC_MAX_CHANNELS];
+  calculateMovingEncoderGains<iChannels>(afGain, poPosition);
+
+  /* Copy the input so that outputs may share its buffer. */
+  const LADSPA_Data * pfInput = poProcessor->m_ppfPorts[MENC_INPUT];
+  LADSPA_Data afInput[PAN_CHUNK];
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+    const unsigned long lChunkSize 
+      = (SampleCount - lChunkStart < PAN_CHUNK 
+	 ? SampleCount - lChunkStart 
+	 : PAN_CHUNK);
+    memcpy(afInput, pfInput + lChunkStart, sizeof(LADSPA_Data) * lChunkSize);
+
+    if (bConstant) {
+      for (int iChannel = 0; iChannel < iChannels; iChannel++)
+	dispatchWriteGainRamp(poProcessor->m_ppfPorts[MENC_OUTPUT + iChannel] 
+			      + lChunkStart,
+			      afInput,
+			      afGain[iChannel],
+			      0,
+			      lChunkSize);
+      continue;
+    }
+
+    /* Ramp the gains to those for the position at the end of the
+       chunk. */
+    for (int iAxis = 0; iAxis < 3; iAxis++)
+      poPosition[iAxis].skip(lChunkSize);
+    calculateMovingEncoderGains<iChannels>(afNextGain, poPosition);
+    const LADSPA_Data fOneOverChunkSize = 1 / LADSPA_Data(lChunkSize);
+    for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+      dispatchWriteGainRamp(poProcessor->m_ppfPorts[MENC_OUTPUT + iChannel] 
+			    + lChunkStart,
+			    afInput,
+			    afGain[iChannel],
+			    ((afNextGain[iChannel] - afGain[iChannel])
+			     * fOneOverChunkSize),
+			    lChunkSize);
+      afGain[iChannel] = afNextGain[iChannel];
+    }
+  }
+}
+
+/*****************************************************************************/
+
+template <int iChannels>
+static void
+runAudioMovingEncoder(LADSPA_Handle Instance,
+		      unsigned long SampleCount) {
+
+  MovingEncoder * poProcessor = (MovingEncoder *)Instance;
+
+  const LADSPA_Data * pfInput = poProcessor->m_ppfPorts[MENC_INPUT];
+  const LADSPA_Data * pfX = poProcessor->m_ppfPorts[MENC_X];
+  const LADSPA_Data * pfY = poProcessor->m_ppfPorts[MENC_Y];
+  const LADSPA_Data * pfZ = poProcessor->m_ppfPorts[MENC_Z];
+
+  /* Outputs are built locally so that they may share buffers with
+     the inputs. */
+  LADSPA_Data aafOutput[MENC_MAX_CHANNELS][PAN_CHUNK];
+  LADSPA_Data afOneOverDistance[PAN_CHUNK];
+  LADSPA_Data afGain[MENC_MAX_CHANNELS];
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+    const unsigned long lChunkSize 
+      = (SampleCount - lChunkStart < PAN_CHUNK 
+	 ? SampleCount - lChunkStart 
+	 : PAN_CHUNK);
+
+    inverseDistance(afOneOverDistance, 
+		    pfX + lChunkStart, 
+		    pfY + lChunkStart, 
+		    pfZ + lChunkStart, 
+		    lChunkSize);
+    for (unsigned long lIndex = 0; lIndex < lChunkSize; lIndex++) {
+      const unsigned long lSampleIndex = lChunkStart + lIndex;
+      calculateMovingEncoderGains<iChannels>(afGain,
+					     pfX[lSampleIndex],
+					     pfY[lSampleIndex],
+					     pfZ[lSampleIndex],
+					     afOneOverDistance[lIndex]);
+      const LADSPA_Data fInput = pfInput[lSampleIndex];
+      for (int iChannel = 0; iChannel < iChannels; iChannel++)
+	aafOutput[iChannel][lIndex] = afGain[iChannel] * fInput;
+    }
+
+    for (int iChannel = 0; iChannel < iChannels; iChannel++)
+      memcpy(poProcessor->m_ppfPorts[MENC_OUTPUT + iChannel] + lChunkStart,
+	     aafOutput[iChannel],
+	     sizeof(LADSPA_Data) * lChunkSize);
+  }
+}
+
+/*****************************************************************************/
+
+/* Higher order plugins. These handle soundfields of order one to
+   three, either in ACN channel order with SN3D normalisation (as used
+   by AmbiX) or in the Furse-Malham channel order and weighting that
+   the B-Format and FMH-Format plugins above use. All three are built
+   on the tables and ambisonicHarmonics() below, so supporting a new
+   order or format means extending these rather than writing new
+   loops. */
+
+#define HOA_MAX_ORDER    3
+#define HOA_MAX_CHANNELS ((HOA_MAX_ORDER + 1) * (HOA_MAX_ORDER + 1))
+#define HOA_MAX_SPEAKERS 16
+
+#define HOA_CHANNELS(iOrder) (((iOrder) + 1) * ((iOrder) + 1))
+
+#define HOA_ACN  0
+#define HOA_FUMA 1
+
+/** Degree (m) of each ACN channel. The order is floor(sqrt(ACN)). */
+static const int g_piHOADegree[HOA_MAX_CHANNELS] = {
+  0,
+  -1, 0, 1,
+  -2, -1, 0, 1, 2,
+  -3, -2, -1, 0, 1, 2, 3
+};
+
+/** ACN channel carried by each Furse-Malham channel (WXYZ RSTUV
+    KLMNOPQ). */
+static const int g_piFuMaToACN[HOA_MAX_CHANNELS] = {
+  0, 3, 1, 2, 6, 7, 5, 8, 4, 12, 13, 11, 14, 10, 15, 9
+};
+
+/** Furse-Malham weight of each ACN channel relative to SN3D. */
+static const float g_pfFuMaWeight[HOA_MAX_CHANNELS] = {
+  0.707107f,
+  1, 1, 1,
+  1.154701f, 1.154701f, 1, 1.154701f, 1.154701f,
+  1.264911f, 1.341641f, 1.185854f, 1, 1.185854f, 1.341641f, 1.264911f
+};
+
+static const char * g_apcFuMaNames[HOA_MAX_CHANNELS] = {
+  "W", "X", "Y", "Z", "R", "S", "T", "U", 
+  "V", "K", "L", "M", "N", "O", "P", "Q"
+};
+
+/** Write the name of an input or output port for a channel. */
+static void
+hoaPortName(char * pcName, 
+	    const char * pcDirection, 
+	    const int iFormat, 
+	    const int iChannel) {
+  if (iFormat == HOA_FUMA)
+    sprintf(pcName, "%s (%s)", pcDirection, g_apcFuMaNames[iChannel]);
+  else
+    sprintf(pcName, "%s (ACN %d)", pcDirection, iChannel);
+}
+
+/** ACN channel carried by channel iChannel of format iFormat. */
+inline int
+hoaChannelToACN(const int iFormat, const int iChannel) {
+  return iFormat == HOA_FUMA ? g_piFuMaToACN[iChannel] : iChannel;
+}
+
+/** Weight of channel iChannel of format iFormat relative to SN3D. */
+inline LADSPA_Data
+hoaChannelWeight(const int iFormat, const int iChannel) {
+  return iFormat == HOA_FUMA ? g_pfFuMaWeight[g_piFuMaToACN[iChannel]] : 1;
+}
+
+/** Fill pfHarmonics with the SN3D real spherical harmonics, in ACN
+    order, up to the given order for the unit vector (fX, fY, fZ).
+    These are polynomials in the vector components so no
+    trigonometry is needed. */
+static void
+ambisonicHarmonics(LADSPA_Data * pfHarmonics,
+		   const int iOrder,
+		   const LADSPA_Data fX,
+		   const LADSPA_Data fY,
+		   const LADSPA_Data fZ) {
+  pfHarmonics[0] = 1;
+  if (iOrder < 1)
+    return;
+  pfHarmonics[1] = fY;
+  pfHarmonics[2] = fZ;
+  pfHarmonics[3] = fX;
+  if (iOrder < 2)
+    return;
+  const LADSPA_Data fX2 = fX * fX;
+  const LADSPA_Data fY2 = fY * fY;
+  const LADSPA_Data fZ2 = fZ * fZ;
+  const LADSPA_Data fRoot3 = 1.732051f;
+  pfHarmonics[4] = fRoot3 * fX * fY;
+  pfHarmonics[5] = fRoot3 * fY * fZ;
+  pfHarmonics[6] = 0.5f * (3 * fZ2 - 1);
+  pfHarmonics[7] = fRoot3 * fX * fZ;
+  pfHarmonics[8] = 0.5f * fRoot3 * (fX2 - fY2);
+  if (iOrder < 3)
+    return;
+  pfHarmonics[9] = 0.790569f * fY * (3 * fX2 - fY2);
+  pfHarmonics[10] = 3.872983f * fX * fY * fZ;
+  pfHarmonics[11] = 0.612372f * fY * (5 * fZ2 - 1);
+  pfHarmonics[12] = 0.5f * fZ * (5 * fZ2 - 3);
+  pfHarmonics[13] = 0.612372f * fX * (5 * fZ2 - 1);
+  pfHarmonics[14] = 1.936492f * fZ * (fX2 - fY2);
+  pfHarmonics[15] = 0.790569f * fX * (fX2 - 3 * fY2);
+}
+
+/*****************************************************************************/
+
+#define HOAENC_INPUT  0
+#define HOAENC_X      1
+#define HOAENC_Y      2
+#define HOAENC_Z      3
+#define HOAENC_OUTPUT 4
+
+template <int iOrder, int iFormat>
+static void runHigherOrderEncoder(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+
+/** This plugin encodes a signal to a higher order soundfield
+    depending on where it is located in a virtual space. As with the
+    B-Format encoder, components other than W fall off with distance
+    while W does not. */
+class HigherOrderEncoder : public CMT_PluginInstance {
+public:
+  HigherOrderEncoder(const LADSPA_Descriptor * psDescriptor,
+		     unsigned long lSampleRate)
+    : CMT_PluginInstance(psDescriptor->PortCount) {
+  }
+  template <int iOrder, int iFormat>
+  friend void runHigherOrderEncoder(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+};
+
+/*****************************************************************************/
+
+/** Calculate the gains for each channel of a higher order encoder for
+    a source at (fX, fY, fZ). */
+template <int iOrder, int iFormat>
+static void
+calculateHigherOrderEncoderGains(LADSPA_Data * pfGains,
+				 const LADSPA_Data fX,
+				 const LADSPA_Data fY,
+				 const LADSPA_Data fZ) {
+  const LADSPA_Data fDistanceSquared = fX * fX + fY * fY + fZ * fZ;
+  LADSPA_Data afHarmonics[HOA_MAX_CHANNELS];
+  LADSPA_Data fDistanceGain;
+  if (fDistanceSquared > 1e-10) {
+    fDistanceGain = 1 / sqrt(fDistanceSquared);
+    ambisonicHarmonics(afHarmonics, 
+		       iOrder,
+		       fX * fDistanceGain, 
+		       fY * fDistanceGain, 
+		       fZ * fDistanceGain);
+  }
+  else {
+    /* Avoid division by zero issues. */
+    fDistanceGain = 0;
+    ambisonicHarmonics(afHarmonics, iOrder, 0, 0, 0);
+  }
+  for (int iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++) {
+    const int iACN = hoaChannelToACN(iFormat, iChannel);
+    pfGains[iChannel] 
+      = (hoaChannelWeight(iFormat, iChannel) 
+	 * afHarmonics[iACN] 
+	 * (iACN == 0 ? 1 : fDistanceGain));
+  }
+}
+
+/*****************************************************************************/
+
+template <int iOrder, int iFormat>
+static void
+runHigherOrderEncoder(LADSPA_Handle Instance,
+		      unsigned long SampleCount) {
+
+  HigherOrderEncoder * poProcessor = (HigherOrderEncoder *)Instance;
+
+  LADSPA_Data afGains[HOA_MAX_CHANNELS];
+  calculateHigherOrderEncoderGains<iOrder, iFormat>
+    (afGains,
+     *(poProcessor->m_ppfPorts[HOAENC_X]),
+     *(poProcessor->m_ppfPorts[HOAENC_Y]),
+     *(poProcessor->m_ppfPorts[HOAENC_Z]));
+
+  /* Copy the input so that outputs may share its buffer. */
+  const LADSPA_Data * pfInput = poProcessor->m_ppfPorts[HOAENC_INPUT];
+  LADSPA_Data afInput[PAN_CHUNK];
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+    const unsigned long lChunkSize 
+      = (SampleCount - lChunkStart < PAN_CHUNK 
+	 ? SampleCount - lChunkStart 
+	 : PAN_CHUNK);
+    memcpy(afInput, pfInput + lChunkStart, sizeof(LADSPA_Data) * lChunkSize);
+    for (int iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++)
+      dispatchWriteGainRamp(poProcessor->m_ppfPorts[HOAENC_OUTPUT + iChannel] 
+			    + lChunkStart,
+			    afInput,
+			    afGains[iChannel],
+			    0,
+			    lChunkSize);
+  }
+}
+
+/*****************************************************************************/
+
+#define HOAROT_ANGLE  0
+#define HOAROT_INPUT  1
+
+/** Output ports follow the inputs. */
+#define HOAROT_OUTPUT(iOrder) (HOAROT_INPUT + HOA_CHANNELS(iOrder))
+
+template <int iOrder, int iFormat>
+static void runHigherOrderRotation(LADSPA_Handle Instance,
+				   unsigned long SampleCount);
+
+/** This plugin rotates a higher order soundfield around the
+    Z-axis. Rotation mixes each pair of channels of order n and degree
+    +/-m by the angle m times the rotation. The cosines and sines of
+    the multiple angles are found by recurrence from a single sin()
+    and cos() each block, or each PAN_CHUNK samples while the angle is
+    gliding, and interpolated in between. */
+class HigherOrderRotation : public SoundfieldRotation {
+private:
+
+  /** Cosine and sine of m times the angle used at the end of the last
+      block, for m from 1 to HOA_MAX_ORDER. */
+  LADSPA_Data m_afCos[HOA_MAX_ORDER + 1];
+  LADSPA_Data m_afSin[HOA_MAX_ORDER + 1];
+
+  void calculateMultipleAngles(LADSPA_Data * pfCos, 
+			       LADSPA_Data * pfSin,
+			       const LADSPA_Data fDegrees) {
+    const LADSPA_Data fAngle = LADSPA_Data(M_PI / 180.0) * fDegrees;
+    pfCos[0] = 1;
+    pfSin[0] = 0;
+    pfCos[1] = cos(fAngle);
+    pfSin[1] = sin(fAngle);
+    for (int iDegree = 2; iDegree <= HOA_MAX_ORDER; iDegree++) {
+      pfCos[iDegree] 
+	= pfCos[iDegree - 1] * pfCos[1] - pfSin[iDegree - 1] * pfSin[1];
+      pfSin[iDegree] 
+	= pfSin[iDegree - 1] * pfCos[1] + pfCos[iDegree - 1] * pfSin[1];
+    }
+  }
+
+public:
+  HigherOrderRotation(const LADSPA_Descriptor * psDescriptor,
+		      unsigned long lSampleRate)
+    : SoundfieldRotation(psDescriptor->PortCount, lSampleRate) {
+  }
+  template <int iOrder, int iFormat>
+  friend void runHigherOrderRotation(LADSPA_Handle Instance,
+				     unsigned long SampleCount);
+};
+
+/*****************************************************************************/
+
+template <int iOrder, int iFormat>
+static void
+runHigherOrderRotation(LADSPA_Handle Instance,
+		       unsigned long SampleCount) {
+
+  HigherOrderRotation * poProcessor = (HigherOrderRotation *)Instance;
+  const int iChannels = HOA_CHANNELS(iOrder);
+  LADSPA_Data ** ppfInputs = poProcessor->m_ppfPorts + HOAROT_INPUT;
+  LADSPA_Data ** ppfOutputs 
+    = poProcessor->m_ppfPorts + HOAROT_OUTPUT(iOrder);
+
+  poProcessor->setAngleTarget(*(poProcessor->m_ppfPorts[HOAROT_ANGLE]));
+  ParameterSmoother<> & oAngle = poProcessor->m_oAngle;
+  const bool bConstant = oAngle.isConstant();
+  if (bConstant)
+    poProcessor->calculateMultipleAngles(poProcessor->m_afCos,
+					 poProcessor->m_afSin,
+					 oAngle.getValue());
+
+  /* Find the channel pairs of degree +/-m. Channels of degree zero
+     are unchanged. */
+  int aiPositive[HOA_MAX_CHANNELS], aiNegative[HOA_MAX_CHANNELS];
+  int aiPairDegree[HOA_MAX_CHANNELS];
+  int iPairCount = 0;
+  for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+    const int iACN = hoaChannelToACN(iFormat, iChannel);
+    const int iDegree = g_piHOADegree[iACN];
+    if (iDegree > 0) {
+      int iOther = 0;
+      while (hoaChannelToACN(iFormat, iOther) != iACN - 2 * iDegree)
+	iOther++;
+      aiPositive[iPairCount] = iChannel;
+      aiNegative[iPairCount] = iOther;
+      aiPairDegree[iPairCount] = iDegree;
+      iPairCount++;
+    }
+    else if (iDegree == 0 && ppfOutputs[iChannel] != ppfInputs[iChannel])
+      memcpy(ppfOutputs[iChannel], 
+	     ppfInputs[iChannel], 
+	     sizeof(LADSPA_Data) * SampleCount);
+  }
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+
+    unsigned long lChunkSize = SampleCount - lChunkStart;
+    if (!bConstant && lChunkSize > PAN_CHUNK)
+      lChunkSize = PAN_CHUNK;
+
+    LADSPA_Data afCos[HOA_MAX_ORDER + 1];
+    LADSPA_Data afSin[HOA_MAX_ORDER + 1];
+    int iDegree;
+    if (bConstant) {
+      for (iDegree = 0; iDegree <= HOA_MAX_ORDER; iDegree++) {
+	afCos[iDegree] = poProcessor->m_afCos[iDegree];
+	afSin[iDegree] = poProcessor->m_afSin[iDegree];
+      }
+    }
+    else {
+      oAngle.skip(lChunkSize);
+      poProcessor->calculateMultipleAngles(afCos, afSin, oAngle.getValue());
+    }
+    const LADSPA_Data fChunkScalar = 1.0f / lChunkSize;
+
+    for (int iPair = 0; iPair < iPairCount; iPair++) {
+
+      iDegree = aiPairDegree[iPair];
+      LADSPA_Data fCos = poProcessor->m_afCos[iDegree];
+      LADSPA_Data fSin = poProcessor->m_afSin[iDegree];
+      const LADSPA_Data fCosStep = (afCos[iDegree] - fCos) * fChunkScalar;
+      const LADSPA_Data fSinStep = (afSin[iDegree] - fSin) * fChunkScalar;
+
+      const LADSPA_Data * pfInP = ppfInputs[aiPositive[iPair]] + lChunkStart;
+      const LADSPA_Data * pfInN = ppfInputs[aiNegative[iPair]] + lChunkStart;
+      LADSPA_Data * pfOutP = ppfOutputs[aiPositive[iPair]] + lChunkStart;
+      LADSPA_Data * pfOutN = ppfOutputs[aiNegative[iPair]] + lChunkStart;
+
+      for (unsigned long lSampleIndex = 0; 
+	   lSampleIndex < lChunkSize;
+	   lSampleIndex++) {
+	const LADSPA_Data fC = fCos + (lSampleIndex + 1) * fCosStep;
+	const LADSPA_Data fS = fSin + (lSampleIndex + 1) * fSinStep;
+	const LADSPA_Data fP = pfInP[lSampleIndex];
+	const LADSPA_Data fN = pfInN[lSampleIndex];
+	pfOutP[lSampleIndex] = fC * fP - fS * fN;
+	pfOutN[lSampleIndex] = fS * fP + fC * fN;
+      }
+    }
+
+    for (iDegree = 0; iDegree <= HOA_MAX_ORDER; iDegree++) {
+      poProcessor->m_afCos[iDegree] = afCos[iDegree];
+      poProcessor->m_afSin[iDegree] = afSin[iDegree];
+    }
+  }
+}
+
+/*****************************************************************************/
+
+#define HOADEC_INPUT 0
+
+/** Output ports follow the inputs. */
+#define HOADEC_OUTPUT(iOrder) (HOADEC_INPUT + HOA_CHANNELS(iOrder))
+
+#define HOA_LAYOUT_OCT  0
+#define HOA_LAYOUT_16   1
+
+#define HOA_LAYOUT_COUNT 2
+
+/** Speaker counts and directions (azimuth anticlockwise from the
+    front and elevation, in degrees) of the decoder layouts: a
+    horizontal octagon, and two rings of eight at 30 degrees above and
+    below the horizontal, with the upper ring turned by half a
+    speaker. */
+static const int g_piHOALayoutSpeakers[HOA_LAYOUT_COUNT] = { 8, 16 };
+static const float g_aaafHOALayouts[HOA_LAYOUT_COUNT][HOA_MAX_SPEAKERS][2] = {
+  { {  22.5f, 0 }, { -22.5f, 0 }, { -67.5f, 0 }, { -112.5f, 0 },
+    { -157.5f, 0 }, { 157.5f, 0 }, { 112.5f, 0 }, {  67.5f, 0 } },
+  { {  22.5f, -30 }, { -22.5f, -30 }, { -67.5f, -30 }, { -112.5f, -30 },
+    { -157.5f, -30 }, { 157.5f, -30 }, { 112.5f, -30 }, {  67.5f, -30 },
+    {  0, 30 }, { -45, 30 }, { -90, 30 }, { -135, 30 },
+    {  180, 30 }, { 135, 30 }, {  90, 30 }, {  45, 30 } }
+};
+
+template <int iOrder, int iFormat, int iLayout>
+static void runHigherOrderDecoder(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+
+/** This plugin decodes a higher order soundfield to a fixed speaker
+    layout by sampling the soundfield in each speaker's direction. The
+    decoder matrix is built once, at instantiation. */
+class HigherOrderDecoder : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_aafMatrix[HOA_MAX_SPEAKERS][HOA_MAX_CHANNELS];
+
+public:
+  HigherOrderDecoder(const LADSPA_Descriptor * psDescriptor,
+		     unsigned long lSampleRate)
+    : CMT_PluginInstance(psDescriptor->PortCount) {
+  }
+
+  void buildMatrix(const int iOrder, const int iFormat, const int iLayout) {
+    const int iSpeakers = g_piHOALayoutSpeakers[iLayout];
+    for (int iSpeaker = 0; iSpeaker < iSpeakers; iSpeaker++) {
+      const double dAzimuth 
+	= (M_PI / 180.0) * g_aaafHOALayouts[iLayout][iSpeaker][0];
+      const double dElevation
+	= (M_PI / 180.0) * g_aaafHOALayouts[iLayout][iSpeaker][1];
+      LADSPA_Data afHarmonics[HOA_MAX_CHANNELS];
+      ambisonicHarmonics(afHarmonics,
+			 iOrder,
+			 LADSPA_Data(cos(dAzimuth) * cos(dElevation)),
+			 LADSPA_Data(sin(dAzimuth) * cos(dElevation)),
+			 LADSPA_Data(sin(dElevation)));
+      for (int iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++) {
+	const int iACN = hoaChannelToACN(iFormat, iChannel);
+	const int iChannelOrder = (int)sqrt(iACN + 0.5);
+	/* Undo the format weighting and the SN3D normalisation, then
+	   spread the result over the speakers. */
+	m_aafMatrix[iSpeaker][iChannel]
+	  = (afHarmonics[iACN] 
+	     * (2 * iChannelOrder + 1)
+	     / (hoaChannelWeight(iFormat, iChannel) * iSpeakers));
+      }
+    }
+  }
+
+  template <int iOrder, int iFormat, int iLayout>
+  friend void runHigherOrderDecoder(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+};
+
+/*****************************************************************************/
+
+template <int iOrder, int iFormat, int iLayout>
+static LADSPA_Handle
+instantiateHigherOrderDecoder(const LADSPA_Descriptor * Descriptor,
+			      unsigned long SampleRate) {
+  HigherOrderDecoder * poDecoder 
+    = new HigherOrderDecoder(Descriptor, SampleRate);
+  poDecoder->buildMatrix(iOrder, iFormat, iLayout);
+  return poDecoder;
+}
+
+/*****************************************************************************/
+
+template <int iOrder, int iFormat, int iLayout>
+static void
+runHigherOrderDecoder(LADSPA_Handle Instance,
+		      unsigned long SampleCount) {
+
+  HigherOrderDecoder * poProcessor = (HigherOrderDecoder *)Instance;
+  const int iChannels = HOA_CHANNELS(iOrder);
+  const int iSpeakers = g_piHOALayoutSpeakers[iLayout];
+  LADSPA_Data ** ppfInputs = poProcessor->m_ppfPorts + HOADEC_INPUT;
+  LADSPA_Data ** ppfOutputs 
+    = poProcessor->m_ppfPorts + HOADEC_OUTPUT(iOrder);
+
+  /* Speaker feeds are built in a buffer, so outputs may share buffers
+     with inputs. */
+  LADSPA_Data aafOutput[HOA_MAX_SPEAKERS][PAN_CHUNK];
+
+  for (unsigned long lChunkStart = 0; 
+       lChunkStart < SampleCount; 
+       lChunkStart += PAN_CHUNK) {
+
+    const unsigned long lChunkSize 
+      = (SampleCount - lChunkStart < PAN_CHUNK 
+	 ? SampleCount - lChunkStart 
+	 : PAN_CHUNK);
+    int iSpeaker;
+
+    for (iSpeaker = 0; iSpeaker < iSpeakers; iSpeaker++) {
+      const LADSPA_Data * pfMatrix = poProcessor->m_aafMatrix[iSpeaker];
+      LADSPA_Data * pfOutput = aafOutput[iSpeaker];
+      dispatchWriteGainRamp(pfOutput, 
+			    ppfInputs[0] + lChunkStart, 
+			    pfMatrix[0], 
+			    0, 
+			    lChunkSize);
+      for (int iChannel = 1; iChannel < iChannels; iChannel++)
+	if (pfMatrix[iChannel] != 0)
+	  dispatchMixBuffers(pfOutput,
+			     pfOutput,
+			     1,
+			     ppfInputs[iChannel] + lChunkStart,
+			     pfMatrix[iChannel],
+			     lChunkSize);
+    }
+
+    for (iSpeaker = 0; iSpeaker < iSpeakers; iSpeaker++)
+      memcpy(ppfOutputs[iSpeaker] + lChunkStart,
+	     aafOutput[iSpeaker],
+	     sizeof(LADSPA_Data) * lChunkSize);
+  }
+}
+
+/*****************************************************************************/
+
 void
 initialise_ambisonic() {
   
@@ -842,9 +1879,9 @@ initialise_ambisonic() {
      NULL,
      CMT_Instantiate<BFormatToStereo>,
      NULL,
-     runBFormatToStereo,
-     NULL,
-     NULL,
+     runBFormatToStereo<write_output_normal>,
+     runBFormatToStereo<write_output_adding>,
+     setDecoderRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
@@ -876,9 +1913,9 @@ initialise_ambisonic() {
      NULL,
      CMT_Instantiate<BFormatToQuad>,
      NULL,
-     runBFormatToQuad,
-     NULL,
-     NULL,
+     runBFormatToQuad<write_output_normal>,
+     runBFormatToQuad<write_output_adding>,
+     setDecoderRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
@@ -916,9 +1953,9 @@ initialise_ambisonic() {
      NULL,
      CMT_Instantiate<BFormatToCube>,
      NULL,
-     runBFormatToCube,
-     NULL,
-     NULL,
+     runBFormatToCube<write_output_normal>,
+     runBFormatToCube<write_output_adding>,
+     setDecoderRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
@@ -968,9 +2005,9 @@ initialise_ambisonic() {
      NULL,
      CMT_Instantiate<FMHFormatToOct>,
      NULL,
-     runFMHFormatToOct,
-     NULL,
-     NULL,
+     runFMHFormatToOct<write_output_normal>,
+     runFMHFormatToOct<write_output_adding>,
+     setDecoderRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
@@ -1034,7 +2071,7 @@ initialise_ambisonic() {
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
      NULL,
      CMT_Instantiate<BFormatRotation>,
-     NULL,
+     activateRotation,
      runBFormatRotation,
      NULL,
      NULL,
@@ -1082,7 +2119,7 @@ initialise_ambisonic() {
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
      NULL,
      CMT_Instantiate<FMHFormatRotation>,
-     NULL,
+     activateRotation,
      runFMHFormatRotation,
      NULL,
      NULL,
@@ -1151,6 +2188,342 @@ initialise_ambisonic() {
      "Output (V)");
   registerNewPluginDescriptor(psDescriptor);
 
+  const char * apcPannerLabels[PAN_LAYOUT_COUNT] = {
+    "bf_pan_stereo",
+    "bf_pan_quad",
+    "bf_pan_cube",
+    "fmh_pan_oct"
+  };
+  const char * apcPannerNames[PAN_LAYOUT_COUNT] = {
+    "Ambisonic Panner (B-Format Encode, Rotate and Decode to Stereo)",
+    "Ambisonic Panner (B-Format Encode, Rotate and Decode to Quad)",
+    "Ambisonic Panner (B-Format Encode, Rotate and Decode to Cube)",
+    "Ambisonic Panner (FMH-Format Encode, Rotate and Decode to Octagon)"
+  };
+  const char * aapcPannerOutputs[PAN_LAYOUT_COUNT][PAN_MAX_SPEAKERS] = {
+    { "Output (Left)",
+      "Output (Right)" },
+    { "Output (Front Left)",
+      "Output (Front Right)",
+      "Output (Back Left)",
+      "Output (Back Right)" },
+    { "Output (Base Front Left)",
+      "Output (Base Front Right)",
+      "Output (Base Back Left)",
+      "Output (Base Back Right)",
+      "Output (Top Front Left)",
+      "Output (Top Front Right)",
+      "Output (Top Back Left)",
+      "Output (Top Back Right)" },
+    { "Output (Front Front Left)",
+      "Output (Front Front Right)",
+      "Output (Front Right Right)",
+      "Output (Back Right Right)",
+      "Output (Back Back Right)",
+      "Output (Back Back Left)",
+      "Output (Back Left Left)",
+      "Output (Front Left Left)" }
+  };
+  LADSPA_Run_Function afPannerRun[PAN_LAYOUT_COUNT] = {
+    runAmbisonicPanner<PAN_STEREO, write_output_normal>,
+    runAmbisonicPanner<PAN_QUAD, write_output_normal>,
+    runAmbisonicPanner<PAN_CUBE, write_output_normal>,
+    runAmbisonicPanner<PAN_OCT, write_output_normal>
+  };
+  LADSPA_Run_Function afPannerRunAdding[PAN_LAYOUT_COUNT] = {
+    runAmbisonicPanner<PAN_STEREO, write_output_adding>,
+    runAmbisonicPanner<PAN_QUAD, write_output_adding>,
+    runAmbisonicPanner<PAN_CUBE, write_output_adding>,
+    runAmbisonicPanner<PAN_OCT, write_output_adding>
+  };
+
+  for (int iLayout = 0; iLayout < PAN_LAYOUT_COUNT; iLayout++) {
+
+    psDescriptor = new CMT_Descriptor
+      (1969 + iLayout,
+       apcPannerLabels[iLayout],
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       apcPannerNames[iLayout],
+       CMT_MAKER("Richard W.E. Furse"),
+       CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+       NULL,
+       CMT_Instantiate<AmbisonicPanner>,
+       activateAmbisonicPanner,
+       afPannerRun[iLayout],
+       afPannerRunAdding[iLayout],
+       setAmbisonicPannerRunAddingGain,
+       NULL);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+       "Input");
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Sound Source X Coordinate",
+       LADSPA_HINT_DEFAULT_1);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Sound Source Y Coordinate",
+       LADSPA_HINT_DEFAULT_0);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Sound Source Z Coordinate",
+       LADSPA_HINT_DEFAULT_0);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Angle of Rotation (Degrees Anticlockwise)",
+       (LADSPA_HINT_BOUNDED_BELOW
+	| LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_DEFAULT_HIGH),
+       -180,
+       180);
+    for (int iSpeaker = 0; iSpeaker < g_piPannerSpeakers[iLayout]; iSpeaker++)
+      psDescriptor->addPort
+	(LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	 aapcPannerOutputs[iLayout][iSpeaker]);
+    registerNewPluginDescriptor(psDescriptor);
+  }
+
+  const char * apcMovingEncoderLabels[2][2] = {
+    { "encode_bformat_smooth", "encode_fmh_smooth" },
+    { "encode_bformat_audio", "encode_fmh_audio" }
+  };
+  const char * apcMovingEncoderNames[2][2] = {
+    { "Ambisonic Encoder (B-Format, Smoothed Position)", 
+      "Ambisonic Encoder (FMH-Format, Smoothed Position)" },
+    { "Ambisonic Encoder (B-Format, Audio Rate Position)",
+      "Ambisonic Encoder (FMH-Format, Audio Rate Position)" }
+  };
+  LADSPA_Run_Function aafMovingEncoderRun[2][2] = {
+    { runSmoothMovingEncoder<4>, runSmoothMovingEncoder<9> },
+    { runAudioMovingEncoder<4>, runAudioMovingEncoder<9> }
+  };
+  const char * apcMovingEncoderOutputs[MENC_MAX_CHANNELS] = {
+    "Output (W)", "Output (X)", "Output (Y)", "Output (Z)", "Output (R)",
+    "Output (S)", "Output (T)", "Output (U)", "Output (V)"
+  };
+  const char * apcMovingEncoderAxes[3] = {
+    "Sound Source X Coordinate",
+    "Sound Source Y Coordinate",
+    "Sound Source Z Coordinate"
+  };
+
+  for (int iRate = 0; iRate < 2; iRate++) {
+    const LADSPA_PortDescriptor iPositionPort 
+      = (LADSPA_PORT_INPUT 
+	 | (iRate == 0 ? LADSPA_PORT_CONTROL : LADSPA_PORT_AUDIO));
+    for (int iType = 0; iType < 2; iType++) {
+
+      psDescriptor = new CMT_Descriptor
+	(1989 + iRate * 2 + iType,
+	 apcMovingEncoderLabels[iRate][iType],
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 apcMovingEncoderNames[iRate][iType],
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<MovingEncoder>,
+	 iRate == 0 ? activateMovingEncoder : NULL,
+	 aafMovingEncoderRun[iRate][iType],
+	 NULL,
+	 NULL,
+	 NULL);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	 "Input");
+      for (int iAxis = 0; iAxis < 3; iAxis++)
+	psDescriptor->addPort
+	  (iPositionPort,
+	   apcMovingEncoderAxes[iAxis],
+	   (iRate == 0 
+	    ? (iAxis == 0 ? LADSPA_HINT_DEFAULT_1 : LADSPA_HINT_DEFAULT_0)
+	    : 0));
+      for (int iChannel = 0; iChannel < (iType == 0 ? 4 : 9); iChannel++)
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   apcMovingEncoderOutputs[iChannel]);
+      registerNewPluginDescriptor(psDescriptor);
+    }
+  }
+
+  const char * apcHOAFormatLabels[2] = { "acn", "fuma" };
+  const char * apcHOAFormatNames[2] = { "ACN/SN3D", "FuMa" };
+  LADSPA_Run_Function aafHOAEncoderRun[2][HOA_MAX_ORDER] = {
+    { runHigherOrderEncoder<1, HOA_ACN>,
+      runHigherOrderEncoder<2, HOA_ACN>,
+      runHigherOrderEncoder<3, HOA_ACN> },
+    { runHigherOrderEncoder<1, HOA_FUMA>,
+      runHigherOrderEncoder<2, HOA_FUMA>,
+      runHigherOrderEncoder<3, HOA_FUMA> }
+  };
+  LADSPA_Run_Function aafHOARotationRun[2][HOA_MAX_ORDER] = {
+    { runHigherOrderRotation<1, HOA_ACN>,
+      runHigherOrderRotation<2, HOA_ACN>,
+      runHigherOrderRotation<3, HOA_ACN> },
+    { runHigherOrderRotation<1, HOA_FUMA>,
+      runHigherOrderRotation<2, HOA_FUMA>,
+      runHigherOrderRotation<3, HOA_FUMA> }
+  };
+  LADSPA_Instantiate_Function aafHOADecoderInstantiate[2][HOA_LAYOUT_COUNT] = {
+    { instantiateHigherOrderDecoder<3, HOA_ACN, HOA_LAYOUT_OCT>,
+      instantiateHigherOrderDecoder<3, HOA_ACN, HOA_LAYOUT_16> },
+    { instantiateHigherOrderDecoder<3, HOA_FUMA, HOA_LAYOUT_OCT>,
+      instantiateHigherOrderDecoder<3, HOA_FUMA, HOA_LAYOUT_16> }
+  };
+  LADSPA_Run_Function aafHOADecoderRun[2][HOA_LAYOUT_COUNT] = {
+    { runHigherOrderDecoder<3, HOA_ACN, HOA_LAYOUT_OCT>,
+      runHigherOrderDecoder<3, HOA_ACN, HOA_LAYOUT_16> },
+    { runHigherOrderDecoder<3, HOA_FUMA, HOA_LAYOUT_OCT>,
+      runHigherOrderDecoder<3, HOA_FUMA, HOA_LAYOUT_16> }
+  };
+  const char * apcHOALayoutLabels[HOA_LAYOUT_COUNT] = { "oct", "16" };
+  const char * apcHOALayoutNames[HOA_LAYOUT_COUNT] = {
+    "Octagon",
+    "16 Speakers, Two Rings"
+  };
+
+  for (int iFormat = 0; iFormat < 2; iFormat++) {
+
+    int iChannel;
+
+    for (int iOrder = 1; iOrder <= HOA_MAX_ORDER; iOrder++) {
+
+      char acLabel[64];
+      char acName[128];
+      char acPortName[64];
+
+      sprintf(acLabel, "encode_hoa%d_%s", iOrder, apcHOAFormatLabels[iFormat]);
+      sprintf(acName, 
+	      "Ambisonic Encoder (Order %d, %s)", 
+	      iOrder, 
+	      apcHOAFormatNames[iFormat]);
+      psDescriptor = new CMT_Descriptor
+	(1973 + iFormat * 8 + (iOrder - 1),
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<HigherOrderEncoder>,
+	 NULL,
+	 aafHOAEncoderRun[iFormat][iOrder - 1],
+	 NULL,
+	 NULL,
+	 NULL);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	 "Input");
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Sound Source X Coordinate",
+	 LADSPA_HINT_DEFAULT_1);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Sound Source Y Coordinate",
+	 LADSPA_HINT_DEFAULT_0);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Sound Source Z Coordinate",
+	 LADSPA_HINT_DEFAULT_0);
+      for (iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++) {
+	hoaPortName(acPortName, "Output", iFormat, iChannel);
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      registerNewPluginDescriptor(psDescriptor);
+
+      sprintf(acLabel, "hoa%d_%s_rotate_z", iOrder, apcHOAFormatLabels[iFormat]);
+      sprintf(acName, 
+	      "Ambisonic Rotation (Order %d, %s, Horizontal)", 
+	      iOrder, 
+	      apcHOAFormatNames[iFormat]);
+      psDescriptor = new CMT_Descriptor
+	(1976 + iFormat * 8 + (iOrder - 1),
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<HigherOrderRotation>,
+	 activateRotation,
+	 aafHOARotationRun[iFormat][iOrder - 1],
+	 NULL,
+	 NULL,
+	 NULL);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Angle of Rotation (Degrees Anticlockwise)",
+	 (LADSPA_HINT_BOUNDED_BELOW
+	  | LADSPA_HINT_BOUNDED_ABOVE
+	  | LADSPA_HINT_DEFAULT_HIGH),
+	 -180,
+	 180);
+      for (iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++) {
+	hoaPortName(acPortName, "Input", iFormat, iChannel);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (iChannel = 0; iChannel < HOA_CHANNELS(iOrder); iChannel++) {
+	hoaPortName(acPortName, "Output", iFormat, iChannel);
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      registerNewPluginDescriptor(psDescriptor);
+    }
+
+    for (int iLayout = 0; iLayout < HOA_LAYOUT_COUNT; iLayout++) {
+
+      char acLabel[64];
+      char acName[128];
+      char acPortName[64];
+
+      sprintf(acLabel, 
+	      "hoa3_%s_to_%s", 
+	      apcHOAFormatLabels[iFormat],
+	      apcHOALayoutLabels[iLayout]);
+      sprintf(acName, 
+	      "Ambisonic Decoder (Order 3, %s, to %s)", 
+	      apcHOAFormatNames[iFormat],
+	      apcHOALayoutNames[iLayout]);
+      psDescriptor = new CMT_Descriptor
+	(1979 + iFormat * 8 + iLayout,
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 aafHOADecoderInstantiate[iFormat][iLayout],
+	 NULL,
+	 aafHOADecoderRun[iFormat][iLayout],
+	 NULL,
+	 NULL,
+	 NULL);
+      for (iChannel = 0; iChannel < HOA_CHANNELS(3); iChannel++) {
+	hoaPortName(acPortName, "Input", iFormat, iChannel);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (int iSpeaker = 0; 
+	   iSpeaker < g_piHOALayoutSpeakers[iLayout]; 
+	   iSpeaker++) {
+	sprintf(acPortName, 
+		"Output (Azimuth %g, Elevation %g)",
+		g_aaafHOALayouts[iLayout][iSpeaker][0],
+		g_aaafHOALayouts[iLayout][iSpeaker][1]);
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      registerNewPluginDescriptor(psDescriptor);
+    }
+  }
+
 }
 
 /*****************************************************************************/
@@ -25,6 +25,8 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "run_adding.h"
+#include "utils.h"
 
 /*****************************************************************************/
 
@@ -32,20 +34,43 @@
 #define AMP_INPUT1  1
 #define AMP_OUTPUT1 2
 
+static void activateAmplifier(LADSPA_Handle Instance);
+static void setAmplifierRunAddingGain(LADSPA_Handle Instance,
+				      LADSPA_Data Gain);
+template <OutputFunction write_output>
 static void runMonoAmplifier(LADSPA_Handle Instance,
                              unsigned long SampleCount);
+template <OutputFunction write_output>
+static void runStereoAmplifier(LADSPA_Handle Instance,
+                               unsigned long SampleCount);
 
-/** This plugin applies a gain to a mono signal. */
+/** This plugin applies a gain to a mono signal. Gain changes are
+    smoothed. */
 class MonoAmplifier : public CMT_PluginInstance {
+protected:
+
+  ParameterSmoother<> m_oGain;
+  LADSPA_Data m_fRunAddingGain;
+
 public:
 
   MonoAmplifier(const LADSPA_Descriptor *,
-		unsigned long)
-    : CMT_PluginInstance(3) {
+		unsigned long lSampleRate,
+		unsigned long lPortCount = 3)
+    : CMT_PluginInstance(lPortCount),
+      m_oGain(LADSPA_Data(lSampleRate)),
+      m_fRunAddingGain(1) {
   }
 
+  friend void activateAmplifier(LADSPA_Handle Instance);
+  friend void setAmplifierRunAddingGain(LADSPA_Handle Instance,
+					LADSPA_Data Gain);
+  template <OutputFunction write_output>
   friend void runMonoAmplifier(LADSPA_Handle Instance,
 			       unsigned long SampleCount);
+  template <OutputFunction write_output>
+  friend void runStereoAmplifier(LADSPA_Handle Instance,
+                                 unsigned long SampleCount);
 
 };
 
@@ -55,25 +80,36 @@ public:
 #define AMP_INPUT2  3
 #define AMP_OUTPUT2 4
 
-static void runStereoAmplifier(LADSPA_Handle Instance,
-                               unsigned long SampleCount);
-
-/** This plugin applies a gain to a stereo signal. */
-class StereoAmplifier : public CMT_PluginInstance {
+/** This plugin applies a gain to a stereo signal. Gain changes are
+    smoothed. */
+class StereoAmplifier : public MonoAmplifier {
 public:
 
-  StereoAmplifier(const LADSPA_Descriptor *,
-		    unsigned long)
-    : CMT_PluginInstance(5) {
+  StereoAmplifier(const LADSPA_Descriptor * psDescriptor,
+		  unsigned long lSampleRate)
+    : MonoAmplifier(psDescriptor, lSampleRate, 5) {
   }
 
-  friend void runStereoAmplifier(LADSPA_Handle Instance,
-                                 unsigned long SampleCount);
-  
 };
 
 /*****************************************************************************/
 
+static void
+activateAmplifier(LADSPA_Handle Instance) {
+  ((MonoAmplifier *)Instance)->m_oGain.reset();
+}
+
+/*****************************************************************************/
+
+static void
+setAmplifierRunAddingGain(LADSPA_Handle Instance,
+			  LADSPA_Data Gain) {
+  ((MonoAmplifier *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+template <OutputFunction write_output>
 static void 
 runMonoAmplifier(LADSPA_Handle Instance,
 		   unsigned long SampleCount) {
@@ -82,16 +118,29 @@ runMonoAmplifier(LADSPA_Handle Instance,
 
   LADSPA_Data * pfInput = poAmplifier->m_ppfPorts[AMP_INPUT1];
   LADSPA_Data * pfOutput = poAmplifier->m_ppfPorts[AMP_OUTPUT1];
-  LADSPA_Data fGain = *(poAmplifier->m_ppfPorts[AMP_CONTROL]);
-
-  for (unsigned long lSampleIndex = 0; 
-       lSampleIndex < SampleCount; 
-       lSampleIndex++) 
-    *(pfOutput++) = *(pfInput++) * fGain;
+  ParameterSmoother<> & oGain = poAmplifier->m_oGain;
+  oGain.setTarget(*(poAmplifier->m_ppfPorts[AMP_CONTROL]));
+  const LADSPA_Data fRunAddingGain = poAmplifier->m_fRunAddingGain;
+
+  if (oGain.isConstant()) {
+    LADSPA_Data fGain 
+      = oGain.getValue() * get_gain<write_output>(fRunAddingGain);
+    for (unsigned long lSampleIndex = 0; 
+	 lSampleIndex < SampleCount; 
+	 lSampleIndex++) 
+      write_output(pfOutput, *(pfInput++) * fGain, 1.0f);
+  }
+  else {
+    for (unsigned long lSampleIndex = 0; 
+	 lSampleIndex < SampleCount; 
+	 lSampleIndex++) 
+      write_output(pfOutput, *(pfInput++) * oGain.next(), fRunAddingGain);
+  }
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void 
 runStereoAmplifier(LADSPA_Handle Instance,
 		     unsigned long SampleCount) {
@@ -100,17 +149,33 @@ runStereoAmplifier(LADSPA_Handle Instance,
 
   StereoAmplifier * poAmplifier = (StereoAmplifier *)Instance;
 
-  LADSPA_Data fGain = *(poAmplifier->m_ppfPorts[AMP_CONTROL]);
-
-  LADSPA_Data * pfInput = poAmplifier->m_ppfPorts[AMP_INPUT1];
-  LADSPA_Data * pfOutput = poAmplifier->m_ppfPorts[AMP_OUTPUT1];
-  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) 
-    *(pfOutput++) = *(pfInput++) * fGain;
-
-  pfInput = poAmplifier->m_ppfPorts[AMP_INPUT2];
-  pfOutput = poAmplifier->m_ppfPorts[AMP_OUTPUT2];
-  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) 
-    *(pfOutput++) = *(pfInput++) * fGain;
+  LADSPA_Data * pfInput1 = poAmplifier->m_ppfPorts[AMP_INPUT1];
+  LADSPA_Data * pfOutput1 = poAmplifier->m_ppfPorts[AMP_OUTPUT1];
+  LADSPA_Data * pfInput2 = poAmplifier->m_ppfPorts[AMP_INPUT2];
+  LADSPA_Data * pfOutput2 = poAmplifier->m_ppfPorts[AMP_OUTPUT2];
+  ParameterSmoother<> & oGain = poAmplifier->m_oGain;
+  oGain.setTarget(*(poAmplifier->m_ppfPorts[AMP_CONTROL]));
+  const LADSPA_Data fRunAddingGain = poAmplifier->m_fRunAddingGain;
+
+  if (oGain.isConstant()) {
+    LADSPA_Data fGain 
+      = oGain.getValue() * get_gain<write_output>(fRunAddingGain);
+    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) 
+      write_output(pfOutput1, *(pfInput1++) * fGain, 1.0f);
+    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) 
+      write_output(pfOutput2, *(pfInput2++) * fGain, 1.0f);
+  }
+  else {
+    /* Both channels are read before either is written for in-place
+       use. */
+    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+      LADSPA_Data fGain = oGain.next();
+      LADSPA_Data fInput1 = *(pfInput1++);
+      LADSPA_Data fInput2 = *(pfInput2++);
+      write_output(pfOutput1, fInput1 * fGain, fRunAddingGain);
+      write_output(pfOutput2, fInput2 * fGain, fRunAddingGain);
+    }
+  }
 }
 
 /*****************************************************************************/
@@ -129,10 +194,10 @@ initialise_amp() {
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
      NULL,
      CMT_Instantiate<MonoAmplifier>,
-     NULL,
-     runMonoAmplifier,
-     NULL,
-     NULL,
+     activateAmplifier,
+     runMonoAmplifier<write_output_normal>,
+     runMonoAmplifier<write_output_adding>,
+     setAmplifierRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -159,10 +224,10 @@ initialise_amp() {
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
      NULL,
      CMT_Instantiate<StereoAmplifier>,
-     NULL,
-     runStereoAmplifier,
-     NULL,
-     NULL,
+     activateAmplifier,
+     runStereoAmplifier<write_output_normal>,
+     runStereoAmplifier<write_output_adding>,
+     setAmplifierRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -24,8 +24,12 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include "cmt.h"
+#include "gate.h"
+#include "voices.h"
+#include "wavetable.h"
 
 #define PORT_OUT            0
 #define PORT_GATE           1
@@ -88,6 +92,13 @@ class Analogue : public CMT_PluginInstance
 
   LADSPA_Data lfo_vol;
 
+  PRNG        random;
+
+  /* Shared tables. The square wave is built from two band-limited
+     sawtooths so that its pulse width can still be modulated. */
+  const Wavetable *sine_table;
+  const Wavetable *saw_table;
+
 public:
   Analogue(const LADSPA_Descriptor * Descriptor,
            unsigned long             SampleRate)
@@ -96,20 +107,46 @@ public:
       trigger (0),
       d1 (0.0), d2 (0.0),
       dco1_accum (0.0), dco2_accum (0.0), lfo_accum (0.0) {
+    sine_table = acquireWavetable (WAVEFORM_SINE);
+    saw_table = acquireWavetable (WAVEFORM_SAWTOOTH);
   }
 
   ~Analogue () {
+    releaseWavetable (WAVEFORM_SAWTOOTH);
+    releaseWavetable (WAVEFORM_SINE);
   }
 
-  /* Third-order approximation of a sine wave. */
+  /* Sine wave taking a phase in cycles from 0 to 1. */
   static inline LADSPA_Data
-  fast_sin(LADSPA_Data x) {
-    if (x > PI)
-      x = (x < PI * 1.5F) ? (PI - x) : (x - 2.0F * PI);
-    else if (x > PI * 0.5F)
-      x = PI - x;
+  sine(const LADSPA_Data *table,
+       LADSPA_Data        x) {
+    return readWavetable (table, wavetablePhase (x));
+  }
 
-    return x * (1.05F - x * x * 0.175F);
+  /* Band-limited square wave, high while the phase is above width.
+     The difference of two sawtooths offset by width is a pulse wave
+     with a DC offset of 1 - 2 * width, which is removed. */
+  static inline LADSPA_Data
+  square(const LADSPA_Data *table,
+         LADSPA_Data        x,
+         LADSPA_Data        width) {
+    LADSPA_Data y = x - width;
+    if (y < 0.0F)
+      y += 1.0F;
+
+    return readWavetable (table, wavetablePhase (x))
+      - readWavetable (table, wavetablePhase (y))
+      + 1.0F - 2.0F * width;
+  }
+
+  /* Table level to use for a band-limited waveform whose phase moves
+     by up to inc cycles per sample. */
+  static inline const LADSPA_Data *
+  level(const Wavetable *table,
+        LADSPA_Data      inc) {
+    if (inc >= 0.5F)
+      return table->getLevel (0);
+    return table->getLevel (wavetableLevel (wavetablePhase (inc)));
   }
 
   static inline LADSPA_Data
@@ -166,10 +203,13 @@ public:
   }
 
   static inline LADSPA_Data
-  osc(int          waveform,
-      LADSPA_Data  inc,
-      LADSPA_Data  width,
-      LADSPA_Data *accum) {
+  osc(int                waveform,
+      LADSPA_Data        inc,
+      LADSPA_Data        width,
+      LADSPA_Data       *accum,
+      const LADSPA_Data *sine_table,
+      const LADSPA_Data *saw_table,
+      PRNG              &random) {
     *accum += inc;
     while (*accum >= 1.0F)
       *accum -= 1.0F;
@@ -177,9 +217,9 @@ public:
     /* 0 = Sine wave */
     if (waveform == 0)
       if (*accum < width)
-        return fast_sin (*accum / width * PI);
+        return sine (sine_table, *accum / width * 0.5F);
       else
-        return fast_sin (PI + (*accum - width) / (1.0F - width) * PI);
+        return sine (sine_table, 0.5F + (*accum - width) / (1.0F - width) * 0.5F);
 
     /* 1 = Triangle wave */
     else if (waveform == 1)
@@ -190,7 +230,7 @@ public:
 
     /* 2 = Square wave */
     else if (waveform == 2)
-      return (*accum > width) ? 1.0F : -1.0F;
+      return square (saw_table, *accum, width);
 
     /* 3 = Sawtooth wave */
     else if (waveform == 3)
@@ -202,13 +242,13 @@ public:
     /* 4 = Fullwave Rectified Sine wave */
     else if (waveform == 4)
       if (*accum < width)
-        return fast_sin (*accum / width * PI);
+        return sine (sine_table, *accum / width * 0.5F);
       else
-        return fast_sin ((*accum - width) / (1.0F - width) * PI);
+        return sine (sine_table, (*accum - width) / (1.0F - width) * 0.5F);
 
     /* 5 = Static */
     else
-      return (rand () & 1) ? -1.0F : 1.0F;
+      return (random.nextInteger () & 1) ? -1.0F : 1.0F;
   }
 
   static LADSPA_Data
@@ -218,17 +258,21 @@ public:
     return pow (2.0, oct) * freq / sample_rate;
   }
 
+  /* Resonance term for calc_a_b_c() from the resonance port. */
+  static inline LADSPA_Data
+  resonance(LADSPA_Data res_port) {
+    return exp (-1.20 + 3.455 * res_port);
+  }
+
+  /* Filter coefficients for a cutoff of top_freq, which is the
+     frequency scaled by PI / sample_rate. */
   static void
-  calc_a_b_c(Analogue    *analogue,
-             LADSPA_Data  freq,
+  calc_a_b_c(LADSPA_Data  top_freq,
+             LADSPA_Data  res,
              LADSPA_Data *a,
              LADSPA_Data *b,
              LADSPA_Data *c) {
-    LADSPA_Data top_freq, k, res;
-  
-    top_freq = freq;
-    top_freq *= PI / analogue->sample_rate;
-    res = exp (-1.20 + 3.455 * *analogue->m_ppfPorts[PORT_FILT_RES]);
+    LADSPA_Data k;
 
     k = exp (-top_freq / res);
   
@@ -257,8 +301,9 @@ public:
     LADSPA_Data lfo_fadein, a, b, c;
     LADSPA_Data dco1_pwm, dco2_pwm;
     LADSPA_Data dco1_fm, dco2_fm;
-    LADSPA_Data filt_lfo_mod;
+    LADSPA_Data filt_lfo_mod, res, top_scalar;
     LADSPA_Data **ports;
+    const LADSPA_Data *sine_table, *saw1_table, *saw2_table;
 
     a = b = c = 0;
     
@@ -286,7 +331,7 @@ public:
     inc2 = inc (*ports[PORT_DCO2_OCTAVE],
                 *ports[PORT_FREQ],
                 analogue->sample_rate);
-    lfo_inc = 2.0F * PI * *ports[PORT_LFO_FREQ] / analogue->sample_rate;
+    lfo_inc = *ports[PORT_LFO_FREQ] / analogue->sample_rate;
 
     attack1 = multiplier (analogue, *ports[PORT_DCO1_ATTACK]);
     decay1 = multiplier (analogue, *ports[PORT_DCO1_DECAY]);
@@ -307,16 +352,24 @@ public:
     dco1_fm = *analogue->m_ppfPorts[PORT_DCO1_FM] * inc1 * 0.45F;
     dco2_fm = *analogue->m_ppfPorts[PORT_DCO2_FM] * inc2 * 0.45F;
     filt_lfo_mod = *analogue->m_ppfPorts[PORT_FILT_LFO_MOD] * 0.45F;
+    res = resonance (*ports[PORT_FILT_RES]);
+    top_scalar = PI / analogue->sample_rate;
+
+    /* Choose sawtooth levels that stay free of aliasing at the highest
+       frequency the LFO can reach this block. */
+    sine_table = analogue->sine_table->getLevel (0);
+    saw1_table = level (analogue->saw_table, inc1 * (1.0F + fabs (dco1_fm)));
+    saw2_table = level (analogue->saw_table, inc2 * (1.0F + fabs (dco2_fm)));
 
     for (i = 0; i < SampleCount; i++)
       {
         LADSPA_Data lfo, sample;
 
         analogue->lfo_accum += lfo_inc;
-        while (analogue->lfo_accum >= 2.0F * PI)
-          analogue->lfo_accum -= 2.0F * PI;
+        while (analogue->lfo_accum >= 1.0F)
+          analogue->lfo_accum -= 1.0F;
 
-        lfo = fast_sin (analogue->lfo_accum) * analogue->lfo_vol;
+        lfo = sine (sine_table, analogue->lfo_accum) * analogue->lfo_vol;
 
         analogue->lfo_vol += lfo_fadein;
         if (analogue->lfo_vol >= 1.0F)
@@ -327,20 +380,24 @@ public:
                   *ports[PORT_FILT_SUSTAIN], filt_release);
 
         if ((i & 0x000f) == 0)
-          calc_a_b_c (analogue,
-           *ports[PORT_FREQ] * 0.25F + (analogue->filt_env.envelope *
-            *ports[PORT_FILT_ENV_MOD] * *ports[PORT_VELOCITY] *
-            (1.5 + filt_lfo_mod * lfo)) * *ports[PORT_FREQ] * 10.0F, &a, &b, &c);
+          {
+            LADSPA_Data cutoff = *ports[PORT_FREQ] * 0.25F + (analogue->filt_env.envelope *
+              *ports[PORT_FILT_ENV_MOD] * *ports[PORT_VELOCITY] *
+              (1.5 + filt_lfo_mod * lfo)) * *ports[PORT_FREQ] * 10.0F;
+            calc_a_b_c (cutoff * top_scalar, res, &a, &b, &c);
+          }
 
         sample = osc (waveform1, inc1 * (1.0 + lfo * dco1_fm),
                       0.5F + lfo * dco1_pwm,
-                      &analogue->dco1_accum)
+                      &analogue->dco1_accum, sine_table, saw1_table,
+                      analogue->random)
                  * envelope (&analogue->dco1_env,
                              gate, attack1, decay1,
                              *ports[PORT_DCO1_SUSTAIN], release1)
                + osc (waveform2, inc2 * (1.0 + lfo * dco2_fm),
                        0.5F + lfo * dco2_pwm,
-                       &analogue->dco2_accum)
+                       &analogue->dco2_accum, sine_table, saw2_table,
+                       analogue->random)
                   * envelope (&analogue->dco2_env,
                               gate, attack2, decay2,
                               *ports[PORT_DCO2_SUSTAIN], release2);
@@ -354,6 +411,484 @@ public:
         ports[PORT_OUT][i] = sample;
       }
   }
+
+  /* As run(), taking the gate as an audio signal (see gate.h). */
+  static void
+  run_audio_gate(LADSPA_Handle Instance,
+                unsigned long SampleCount) {
+    runWithAudioGate (Instance, ((Analogue*) Instance)->m_ppfPorts, SampleCount,
+                      PORT_GATE, 1 << PORT_OUT, run);
+  }
+};
+
+/*****************************************************************************/
+
+/* Polyphonic analogue voice. As the polyphonic organ, one instance
+   holds a pool of voices sharing the oscillator, LFO, filter and
+   envelope controls, and each key has its own gate, velocity and
+   frequency ports (see voices.h). A rising gate restarts the
+   envelopes and LFO fade-in of a voice as it does for Analogue.
+
+   Four voices are run at a time in SIMD lanes, working through each
+   block a chunk at a time: first the LFOs and filter envelopes, then
+   each oscillator in a loop specialised for its waveform, so the
+   waveform is only looked at once per chunk rather than per sample,
+   and finally the filters. Sines come from a polynomial rather than
+   the table, which differs from Analogue by a few parts in a
+   million. */
+
+#define POLY_PORT_OUT         0
+
+/* The shared controls are those of Analogue from PORT_DCO1_OCTAVE on,
+   in the same order. */
+#define POLY_PORT_SHARED(p)   ((p) - PORT_DCO1_OCTAVE + 1)
+#define POLY_NUM_SHARED       POLY_PORT_SHARED (NUM_PORTS)
+
+#define POLY_PORT_GATE(k)     (POLY_NUM_SHARED + 3 * (k))
+#define POLY_PORT_VELOCITY(k) (POLY_PORT_GATE (k) + 1)
+#define POLY_PORT_FREQ(k)     (POLY_PORT_GATE (k) + 2)
+
+#define POLY_VOICES_PER_KEY   2
+#define POLY_CHUNK            64
+
+/* The filter coefficients are recalculated every 16 samples, counted
+   from the start of the block as in Analogue. */
+#define POLY_FILTER_PERIOD    16
+#define POLY_FILTER_SEGMENTS  (POLY_CHUNK / POLY_FILTER_PERIOD)
+
+/* Envelopes, in the order of their ports. */
+#define POLY_ENV_DCO1         0
+#define POLY_ENV_DCO2         1
+#define POLY_ENV_FILT         2
+
+/* Per-block values for one DCO of a group of voices. */
+typedef struct PolyDCO
+{
+  Lanes              inc;
+  Lanes              fm;
+  Lanes              pwm;
+  const LADSPA_Data *saw_table[LANE_COUNT];
+} PolyDCO;
+
+/* Per-block values for a group of voices. */
+typedef struct PolyLanes
+{
+  PolyDCO     dco[2];
+  Lanes       freq;
+  Lanes       velocity;
+  LaneMask    gate;
+} PolyLanes;
+
+/* Per-block values shared by all voices. */
+typedef struct PolyControls
+{
+  VoiceEnvelope envelope[3];
+  Lanes         lfo_inc;
+  Lanes         lfo_fadein;
+  Lanes         filt_env_mod;
+  Lanes         filt_lfo_mod;
+  LADSPA_Data   res;
+  LADSPA_Data   top_scalar;
+} PolyControls;
+
+class PolyAnalogue : public CMT_PluginInstance
+{
+  LADSPA_Data    sample_rate;
+  VoiceAllocator voices;
+  PRNG           random;
+
+  /* Voice state, as the members of Analogue. env_decay is 1 once an
+     envelope has passed its attack. */
+  LADSPA_Data env[3][VOICE_MAX_VOICES];
+  LADSPA_Data env_decay[3][VOICE_MAX_VOICES];
+  LADSPA_Data dco_accum[2][VOICE_MAX_VOICES];
+  LADSPA_Data lfo_accum[VOICE_MAX_VOICES];
+  LADSPA_Data lfo_vol[VOICE_MAX_VOICES];
+  LADSPA_Data d1[VOICE_MAX_VOICES];
+  LADSPA_Data d2[VOICE_MAX_VOICES];
+  LADSPA_Data freq[VOICE_MAX_VOICES];
+  LADSPA_Data velocity[VOICE_MAX_VOICES];
+
+  const Wavetable *saw_table;
+
+public:
+  PolyAnalogue(const LADSPA_Descriptor * Descriptor,
+               unsigned long             SampleRate)
+    : CMT_PluginInstance(Descriptor->PortCount),
+      sample_rate (SampleRate),
+      voices ((Descriptor->PortCount - POLY_NUM_SHARED) / 3,
+              (Descriptor->PortCount - POLY_NUM_SHARED) / 3 * POLY_VOICES_PER_KEY) {
+    saw_table = acquireWavetable (WAVEFORM_SAWTOOTH);
+    activate (this);
+  }
+
+  ~PolyAnalogue () {
+    releaseWavetable (WAVEFORM_SAWTOOTH);
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    PolyAnalogue *analogue = (PolyAnalogue*) Instance;
+
+    for (int v = 0; v < VOICE_MAX_VOICES; v++)
+      start_voice (analogue, v);
+    analogue->voices.reset ();
+  }
+
+  /* Clear the state of a voice, as activating Analogue does. */
+  static void
+  start_voice(PolyAnalogue *analogue,
+              int           v) {
+    for (int e = 0; e < 3; e++)
+      analogue->env[e][v] = analogue->env_decay[e][v] = 0.0F;
+    analogue->dco_accum[0][v] = analogue->dco_accum[1][v] = 0.0F;
+    analogue->lfo_accum[v] = 0.0F;
+    analogue->lfo_vol[v] = 0.0F;
+    analogue->d1[v] = analogue->d2[v] = 0.0F;
+    analogue->freq[v] = analogue->velocity[v] = 0.0F;
+  }
+
+  /* Start, update and release voices from the key ports. A stolen
+     voice keeps its oscillator and filter state but has its
+     envelopes and LFO restarted, as a retriggered Analogue does. */
+  static void
+  update_keys(PolyAnalogue *analogue) {
+    LADSPA_Data **ports = analogue->m_ppfPorts;
+    LADSPA_Data level[VOICE_MAX_VOICES];
+
+    for (int v = 0; v < analogue->voices.getVoiceCount (); v++)
+      level[v] = analogue->env[POLY_ENV_DCO1][v] + analogue->env[POLY_ENV_DCO2][v];
+
+    for (int k = 0; k < analogue->voices.getKeyCount (); k++)
+      {
+        int event;
+        int v = analogue->voices.followKey (k, *ports[POLY_PORT_GATE (k)] > 0.0,
+                                            level, event);
+
+        if (event == VOICE_STARTED)
+          start_voice (analogue, v);
+        else if (event == VOICE_STOLEN)
+          {
+            for (int e = 0; e < 3; e++)
+              analogue->env[e][v] = analogue->env_decay[e][v] = 0.0F;
+            analogue->lfo_vol[v] = 0.0F;
+          }
+
+        if (v >= 0 && analogue->voices.isHeld (v))
+          {
+            analogue->freq[v] = *ports[POLY_PORT_FREQ (k)];
+            analogue->velocity[v] = *ports[POLY_PORT_VELOCITY (k)];
+          }
+      }
+  }
+
+  static inline Lanes
+  tri(Lanes x) {
+    x = lanesSelect (x > lanesSplat (0.75F), x - 1.0F,
+                     lanesSelect (x > lanesSplat (0.25F), lanesSplat (0.5F) - x, x));
+    return x * 4.0F;
+  }
+
+  /* One sample of waveform for four voices, as Analogue::osc() once
+     the phase has been advanced. noise holds a random value for each
+     lane for the static waveform. */
+  template <int waveform>
+  static inline Lanes
+  osc(const Lanes         accum,
+      const Lanes         width,
+      const LADSPA_Data  *const *saw_table,
+      const LADSPA_Data  *noise) {
+    const Lanes one = lanesSplat (1.0F);
+    const LaneMask first = accum < width;
+    /* Position through whichever part of the cycle the phase is in,
+       from 0 to 1. */
+    const Lanes part = lanesSelect (first, accum / width, (accum - width) / (one - width));
+
+    switch (waveform)
+      {
+      case 0:
+        return lanesSine (lanesSelect (first, part * 0.5F, part * 0.5F + 0.5F));
+      case 1:
+        return tri (lanesSelect (first, part * 0.5F, part * 0.5F + 0.5F));
+      case 2:
+        {
+          Lanes y = accum - width;
+          y = lanesSelect (y < lanesSplat (0.0F), y + one, y);
+          return lanesInterpolate (saw_table, accum * LADSPA_Data (WAVETABLE_SIZE))
+            - lanesInterpolate (saw_table, y * LADSPA_Data (WAVETABLE_SIZE))
+            + one - width * 2.0F;
+        }
+      case 3:
+        return part * 2.0F - one;
+      case 4:
+        return lanesSine (part * 0.5F);
+      default:
+        return lanesSelect (lanesLoad (noise) < lanesSplat (0.0F), lanesSplat (-1.0F), one);
+      }
+  }
+
+  /* Run the LFOs and filter envelopes of a group of voices over a
+     chunk starting at sample start of the block, giving the LFO
+     values and the filter coefficients for each filter period. */
+  static void
+  run_modulation(PolyAnalogue       *analogue,
+                 int                 group,
+                 const PolyLanes    *lanes,
+                 const PolyControls *controls,
+                 Lanes              *lfo,
+                 Lanes             (*coefficients)[3],
+                 unsigned long       start,
+                 unsigned long       count) {
+    Lanes lfo_accum = lanesLoad (analogue->lfo_accum + group);
+    Lanes lfo_vol = lanesLoad (analogue->lfo_vol + group);
+    Lanes filt_env = lanesLoad (analogue->env[POLY_ENV_FILT] + group);
+    LaneMask filt_decay = lanesLoad (analogue->env_decay[POLY_ENV_FILT] + group) > lanesSplat (0.0F);
+    const Lanes one = lanesSplat (1.0F);
+
+    for (unsigned long i = 0; i < count; i++)
+      {
+        lfo_accum = lanesWrap (lfo_accum + controls->lfo_inc);
+        lfo[i] = lanesSine (lfo_accum) * lfo_vol;
+        lfo_vol = lanesMin (lfo_vol + controls->lfo_fadein, one);
+
+        runVoiceEnvelope (filt_env, filt_decay, lanes->gate,
+                          controls->envelope[POLY_ENV_FILT]);
+
+        if (((start + i) & (POLY_FILTER_PERIOD - 1)) == 0)
+          {
+            LADSPA_Data cutoff[LANE_COUNT], a[LANE_COUNT], b[LANE_COUNT], c[LANE_COUNT];
+
+            lanesStore (cutoff,
+                        lanes->freq * 0.25F
+                        + filt_env * controls->filt_env_mod * lanes->velocity
+                        * (lanesSplat (1.5F) + controls->filt_lfo_mod * lfo[i])
+                        * lanes->freq * 10.0F);
+            for (int l = 0; l < LANE_COUNT; l++)
+              Analogue::calc_a_b_c (cutoff[l] * controls->top_scalar, controls->res,
+                                    a + l, b + l, c + l);
+            coefficients[i / POLY_FILTER_PERIOD][0] = lanesLoad (a);
+            coefficients[i / POLY_FILTER_PERIOD][1] = lanesLoad (b);
+            coefficients[i / POLY_FILTER_PERIOD][2] = lanesLoad (c) * lanes->velocity;
+          }
+      }
+
+    lanesStore (analogue->lfo_accum + group, lfo_accum);
+    lanesStore (analogue->lfo_vol + group, lfo_vol);
+    lanesStore (analogue->env[POLY_ENV_FILT] + group, filt_env);
+    lanesStore (analogue->env_decay[POLY_ENV_FILT] + group,
+                lanesSelect (filt_decay, one, lanesSplat (0.0F)));
+  }
+
+  /* Run one DCO and its envelope for a group of voices over a chunk,
+     setting or adding to mix. */
+  template <int waveform>
+  static void
+  run_dco(PolyAnalogue        *analogue,
+          int                  group,
+          int                  d,
+          const PolyLanes     *lanes,
+          const VoiceEnvelope *envelope,
+          const Lanes         *lfo,
+          Lanes               *mix,
+          bool                 add,
+          unsigned long        count) {
+    const PolyDCO *dco = &lanes->dco[d];
+    Lanes accum = lanesLoad (analogue->dco_accum[d] + group);
+    Lanes env = lanesLoad (analogue->env[d] + group);
+    LaneMask decay = lanesLoad (analogue->env_decay[d] + group) > lanesSplat (0.0F);
+    const Lanes one = lanesSplat (1.0F);
+    LADSPA_Data noise[waveform == 5 ? POLY_CHUNK * LANE_COUNT : 1];
+
+    if (waveform == 5)
+      analogue->random.fillBipolar (noise, count * LANE_COUNT);
+
+    for (unsigned long i = 0; i < count; i++)
+      {
+        accum = lanesWrap (accum + dco->inc * (one + lfo[i] * dco->fm));
+        const Lanes y
+          = osc<waveform> (accum, lanesSplat (0.5F) + lfo[i] * dco->pwm,
+                           dco->saw_table, noise + (waveform == 5 ? i * LANE_COUNT : 0))
+          * runVoiceEnvelope (env, decay, lanes->gate, *envelope);
+        mix[i] = add ? mix[i] + y : y;
+      }
+
+    lanesStore (analogue->dco_accum[d] + group, accum);
+    lanesStore (analogue->env[d] + group, env);
+    lanesStore (analogue->env_decay[d] + group, lanesSelect (decay, one, lanesSplat (0.0F)));
+  }
+
+  static void
+  run_dco(PolyAnalogue        *analogue,
+          int                  waveform,
+          int                  group,
+          int                  d,
+          const PolyLanes     *lanes,
+          const VoiceEnvelope *envelope,
+          const Lanes         *lfo,
+          Lanes               *mix,
+          bool                 add,
+          unsigned long        count) {
+    switch (waveform)
+      {
+      case 0:
+        run_dco<0> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      case 1:
+        run_dco<1> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      case 2:
+        run_dco<2> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      case 3:
+        run_dco<3> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      case 4:
+        run_dco<4> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      default:
+        run_dco<5> (analogue, group, d, lanes, envelope, lfo, mix, add, count);
+        break;
+      }
+  }
+
+  /* Filter the mix of a group of voices over a chunk, setting or
+     adding to out. */
+  static void
+  run_filter(PolyAnalogue   *analogue,
+             int             group,
+             Lanes         (*coefficients)[3],
+             const Lanes    *mix,
+             LADSPA_Data    *out,
+             bool            add,
+             unsigned long   count) {
+    Lanes d1 = lanesLoad (analogue->d1 + group);
+    Lanes d2 = lanesLoad (analogue->d2 + group);
+
+    for (unsigned long i = 0; i < count; i++)
+      {
+        const Lanes *abc = coefficients[i / POLY_FILTER_PERIOD];
+        const Lanes sample = abc[0] * d1 + abc[1] * d2 + abc[2] * mix[i];
+        d2 = d1;
+        d1 = sample;
+        out[i] = add ? out[i] + lanesSum (sample) : lanesSum (sample);
+      }
+
+    lanesStore (analogue->d1 + group, d1);
+    lanesStore (analogue->d2 + group, d2);
+  }
+
+  static inline LADSPA_Data
+  multiplier(PolyAnalogue *analogue,
+             LADSPA_Data   value) {
+    return 1.0 - pow (0.05, 1.0 / (analogue->sample_rate * value));
+  }
+
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+  PolyAnalogue *analogue = (PolyAnalogue*) Instance;
+  LADSPA_Data **ports = analogue->m_ppfPorts;
+  PolyControls controls;
+  PolyLanes lanes;
+  Lanes lfo[POLY_CHUNK];
+  Lanes mix[POLY_CHUNK];
+  Lanes coefficients[POLY_FILTER_SEGMENTS][3];
+  double octave[2];
+  LADSPA_Data fm[2], pwm[2];
+  int waveform[2];
+  int d, e, v;
+  bool add = false;
+
+  update_keys (analogue);
+
+  /* Everything that does not depend on the voice is worked out once
+     per block. */
+  for (d = 0; d < 2; d++)
+    {
+      const int offset = d * (PORT_DCO2_OCTAVE - PORT_DCO1_OCTAVE);
+
+      waveform[d] = (int) *ports[POLY_PORT_SHARED (PORT_DCO1_WAVEFORM + offset)];
+      octave[d] = pow (2.0, *ports[POLY_PORT_SHARED (PORT_DCO1_OCTAVE + offset)]);
+      fm[d] = *ports[POLY_PORT_SHARED (PORT_DCO1_FM + offset)] * 0.45F;
+      pwm[d] = *ports[POLY_PORT_SHARED (PORT_DCO1_PWM + offset)] * 0.225F;
+    }
+  for (e = 0; e < 3; e++)
+    {
+      const int base = (e == POLY_ENV_DCO1 ? PORT_DCO1_ATTACK
+                        : e == POLY_ENV_DCO2 ? PORT_DCO2_ATTACK
+                        : PORT_FILT_ATTACK);
+      setVoiceEnvelope (controls.envelope[e],
+                        multiplier (analogue, *ports[POLY_PORT_SHARED (base)]),
+                        multiplier (analogue, *ports[POLY_PORT_SHARED (base + 1)]),
+                        *ports[POLY_PORT_SHARED (base + 2)],
+                        multiplier (analogue, *ports[POLY_PORT_SHARED (base + 3)]));
+    }
+  controls.lfo_inc = lanesSplat (*ports[POLY_PORT_SHARED (PORT_LFO_FREQ)] / analogue->sample_rate);
+  controls.lfo_fadein
+    = lanesSplat (1.0 / (*ports[POLY_PORT_SHARED (PORT_LFO_FADEIN)] * analogue->sample_rate));
+  controls.filt_env_mod = lanesSplat (*ports[POLY_PORT_SHARED (PORT_FILT_ENV_MOD)]);
+  controls.filt_lfo_mod = lanesSplat (*ports[POLY_PORT_SHARED (PORT_FILT_LFO_MOD)] * 0.45F);
+  controls.res = Analogue::resonance (*ports[POLY_PORT_SHARED (PORT_FILT_RES)]);
+  controls.top_scalar = PI / analogue->sample_rate;
+
+  for (int group = 0; group < analogue->voices.getVoiceCount (); group += LANE_COUNT)
+    {
+      if (!analogue->voices.isGroupActive (group))
+        continue;
+
+      for (d = 0; d < 2; d++)
+        {
+          LADSPA_Data inc[LANE_COUNT], dco_fm[LANE_COUNT];
+
+          for (int l = 0; l < LANE_COUNT; l++)
+            {
+              v = group + l;
+              inc[l] = octave[d] * analogue->freq[v] / analogue->sample_rate;
+              dco_fm[l] = fm[d] * inc[l];
+              /* As Analogue, choose sawtooth levels that stay free of
+                 aliasing at the highest frequency the LFO can reach. */
+              lanes.dco[d].saw_table[l]
+                = Analogue::level (analogue->saw_table, inc[l] * (1.0F + fabs (dco_fm[l])));
+            }
+          lanes.dco[d].inc = lanesLoad (inc);
+          lanes.dco[d].fm = lanesLoad (dco_fm);
+          lanes.dco[d].pwm = lanesSplat (pwm[d]);
+        }
+      lanes.freq = lanesLoad (analogue->freq + group);
+      lanes.velocity = lanesLoad (analogue->velocity + group);
+      lanes.gate = lanesSet (analogue->voices.isHeld (group) ? 1.0F : 0.0F,
+                             analogue->voices.isHeld (group + 1) ? 1.0F : 0.0F,
+                             analogue->voices.isHeld (group + 2) ? 1.0F : 0.0F,
+                             analogue->voices.isHeld (group + 3) ? 1.0F : 0.0F)
+        > lanesSplat (0.0F);
+
+      for (unsigned long start = 0; start < SampleCount; start += POLY_CHUNK)
+        {
+          const unsigned long count
+            = SampleCount - start < POLY_CHUNK ? SampleCount - start : POLY_CHUNK;
+
+          run_modulation (analogue, group, &lanes, &controls,
+                          lfo, coefficients, start, count);
+          for (d = 0; d < 2; d++)
+            run_dco (analogue, waveform[d], group, d, &lanes,
+                     &controls.envelope[d], lfo, mix, d > 0, count);
+          run_filter (analogue, group, coefficients, mix,
+                      ports[POLY_PORT_OUT] + start, add, count);
+        }
+      add = true;
+    }
+
+  if (!add)
+    for (unsigned long i = 0; i < SampleCount; i++)
+      ports[POLY_PORT_OUT][i] = 0.0F;
+
+  /* Return voices that have died away to the pool. */
+  for (v = 0; v < analogue->voices.getVoiceCount (); v++)
+    if (analogue->voices.isActive (v) && !analogue->voices.isHeld (v)
+        && analogue->env[POLY_ENV_DCO1][v] < VOICE_SILENCE
+        && analogue->env[POLY_ENV_DCO2][v] < VOICE_SILENCE)
+      analogue->voices.retireVoice (v);
+}
 };
 
 static LADSPA_PortDescriptor g_psPortDescriptors[] =
@@ -502,4 +1037,84 @@ initialise_analogue() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2027,
+       "analogue_audio_gate",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Analogue Voice (Audio Gate)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("2000", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<Analogue>,
+       Analogue::activate,
+       Analogue::run_audio_gate,
+       NULL,
+       NULL,
+       NULL);
+
+  for (int i = 0; i < NUM_PORTS; i++)
+    if (i == PORT_GATE)
+      psDescriptor->addPort(
+        LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+        g_psPortNames[i]);
+    else
+      psDescriptor->addPort(
+        g_psPortDescriptors[i],
+        g_psPortNames[i],
+        g_psPortRangeHints[i].HintDescriptor,
+        g_psPortRangeHints[i].LowerBound,
+        g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
+
+  const char * poly_labels[] = { "analogue_poly8", "analogue_poly16" };
+  const char * poly_names[] = {
+    "Polyphonic Analogue Voice (8 Keys)",
+    "Polyphonic Analogue Voice (16 Keys)"
+  };
+  const int poly_keys[] = { 8, 16 };
+
+  for (int p = 0; p < 2; p++)
+    {
+      psDescriptor = new CMT_Descriptor
+          (1995 + p,
+           poly_labels[p],
+           LADSPA_PROPERTY_HARD_RT_CAPABLE,
+           poly_names[p],
+           CMT_MAKER("David A. Bartold"),
+           CMT_COPYRIGHT("2000", "David A. Bartold"),
+           NULL,
+           CMT_Instantiate<PolyAnalogue>,
+           PolyAnalogue::activate,
+           PolyAnalogue::run,
+           NULL,
+           NULL,
+           NULL);
+
+      psDescriptor->addPort(
+        g_psPortDescriptors[PORT_OUT],
+        g_psPortNames[PORT_OUT]);
+      for (int i = PORT_DCO1_OCTAVE; i < NUM_PORTS; i++)
+        psDescriptor->addPort(
+          g_psPortDescriptors[i],
+          g_psPortNames[i],
+          g_psPortRangeHints[i].HintDescriptor,
+          g_psPortRangeHints[i].LowerBound,
+          g_psPortRangeHints[i].UpperBound);
+      for (int k = 0; k < poly_keys[p]; k++)
+        for (int i = PORT_GATE; i <= PORT_FREQ; i++)
+          {
+            char name[64];
+            sprintf (name, "%s %d", g_psPortNames[i], k + 1);
+            psDescriptor->addPort(
+              g_psPortDescriptors[i],
+              name,
+              g_psPortRangeHints[i].HintDescriptor,
+              g_psPortRangeHints[i].LowerBound,
+              g_psPortRangeHints[i].UpperBound);
+          }
+
+      registerNewPluginDescriptor(psDescriptor);
+    }
 }
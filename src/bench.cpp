@@ -0,0 +1,368 @@
+/* bench.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+/* This is a standalone host, not part of the plugin library. It loads
+   the library, walks ladspa_descriptor() and times every plugin at a
+   range of sample rates and block sizes, printing the cost of each in
+   nanoseconds per sample frame. Usage:
+
+     cmt_bench [-s seconds] [-l label] [library]
+
+   The signals fed to the plugins are deterministic so that runs can
+   be compared with each other. The block kernels the library chose
+   are printed first; set CMT_KERNELS to compare them (see
+   dispatch.h). */
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dlfcn.h>
+#include <ladspa.h>
+
+/*****************************************************************************/
+
+#include "cmt_host.h"
+
+/*****************************************************************************/
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*****************************************************************************/
+
+static const unsigned long g_plSampleRates[] = { 44100, 48000, 96000 };
+static const unsigned long g_plBlockSizes[] = { 16, 64, 256, 1024 };
+
+#define BENCH_SAMPLE_RATE_COUNT \
+  (sizeof(g_plSampleRates) / sizeof(unsigned long))
+#define BENCH_BLOCK_SIZE_COUNT \
+  (sizeof(g_plBlockSizes) / sizeof(unsigned long))
+#define BENCH_MAXIMUM_BLOCK_SIZE 1024
+
+/*****************************************************************************/
+
+static double
+getTime() {
+  struct timespec sTime;
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return sTime.tv_sec * 1e9 + sTime.tv_nsec;
+}
+
+/*****************************************************************************/
+
+/** Choose a value for a control input from its hints, in the same way
+    a typical host would. */
+static LADSPA_Data
+getControlValue(const LADSPA_PortRangeHint & sHint,
+		const unsigned long lSampleRate) {
+
+  LADSPA_PortRangeHintDescriptor iHint = sHint.HintDescriptor;
+  float fLower = sHint.LowerBound;
+  float fUpper = sHint.UpperBound;
+  if (LADSPA_IS_HINT_SAMPLE_RATE(iHint)) {
+    fLower *= lSampleRate;
+    fUpper *= lSampleRate;
+  }
+
+  float fValue;
+  bool bLogarithmic
+    = (LADSPA_IS_HINT_LOGARITHMIC(iHint) && fLower > 0 && fUpper > 0);
+
+  switch (iHint & LADSPA_HINT_DEFAULT_MASK) {
+  case LADSPA_HINT_DEFAULT_MINIMUM:
+    fValue = fLower;
+    break;
+  case LADSPA_HINT_DEFAULT_LOW:
+    if (bLogarithmic)
+      fValue = exp(log(fLower) * 0.75 + log(fUpper) * 0.25);
+    else
+      fValue = fLower * 0.75 + fUpper * 0.25;
+    break;
+  case LADSPA_HINT_DEFAULT_HIGH:
+    if (bLogarithmic)
+      fValue = exp(log(fLower) * 0.25 + log(fUpper) * 0.75);
+    else
+      fValue = fLower * 0.25 + fUpper * 0.75;
+    break;
+  case LADSPA_HINT_DEFAULT_MAXIMUM:
+    fValue = fUpper;
+    break;
+  case LADSPA_HINT_DEFAULT_0:
+    fValue = 0;
+    break;
+  case LADSPA_HINT_DEFAULT_1:
+    fValue = 1;
+    break;
+  case LADSPA_HINT_DEFAULT_100:
+    fValue = 100;
+    break;
+  case LADSPA_HINT_DEFAULT_440:
+    fValue = 440;
+    break;
+  case LADSPA_HINT_DEFAULT_MIDDLE:
+  default:
+    if (LADSPA_IS_HINT_BOUNDED_BELOW(iHint)
+	&& LADSPA_IS_HINT_BOUNDED_ABOVE(iHint)) {
+      if (bLogarithmic)
+	fValue = sqrt(fLower * fUpper);
+      else
+	fValue = (fLower + fUpper) * 0.5;
+    }
+    else if (LADSPA_IS_HINT_BOUNDED_BELOW(iHint))
+      fValue = fLower > 1 ? fLower : 1;
+    else if (LADSPA_IS_HINT_BOUNDED_ABOVE(iHint))
+      fValue = fUpper < 1 ? fUpper : 1;
+    else
+      fValue = 1;
+    break;
+  }
+
+  if (LADSPA_IS_HINT_INTEGER(iHint))
+    fValue = floor(fValue + 0.5);
+  return fValue;
+}
+
+/*****************************************************************************/
+
+/** Fill an audio input buffer with a deterministic test signal: a
+    sine tone mixed with linear congruential noise. Each port gets a
+    different tone so that multi-input plugins do not see identical
+    signals. If the port is bounded, the signal is mapped into its
+    range. */
+static void
+fillAudioInput(LADSPA_Data * pfBuffer,
+	       const unsigned long lSampleCount,
+	       const LADSPA_PortRangeHint & sHint,
+	       const unsigned long lSampleRate,
+	       const unsigned long lPortIndex) {
+
+  LADSPA_PortRangeHintDescriptor iHint = sHint.HintDescriptor;
+  float fCentre = 0;
+  float fScale = 0.5;
+  if (LADSPA_IS_HINT_BOUNDED_BELOW(iHint)
+      && LADSPA_IS_HINT_BOUNDED_ABOVE(iHint)) {
+    float fLower = sHint.LowerBound;
+    float fUpper = sHint.UpperBound;
+    if (LADSPA_IS_HINT_SAMPLE_RATE(iHint)) {
+      fLower *= lSampleRate;
+      fUpper *= lSampleRate;
+    }
+    fCentre = (fLower + fUpper) * 0.5;
+    fScale = (fUpper - fLower) * 0.5;
+  }
+
+  double dPhaseStep = 2 * M_PI * 220.0 * (lPortIndex + 1) / lSampleRate;
+  unsigned long lNoise = 1 + lPortIndex;
+  for (unsigned long lIndex = 0; lIndex < lSampleCount; lIndex++) {
+    lNoise = (lNoise * 1664525UL + 1013904223UL) & 0xFFFFFFFFUL;
+    float fNoise = lNoise * (2.0 / 4294967296.0) - 1;
+    pfBuffer[lIndex]
+      = fCentre + fScale * (0.75 * sin(dPhaseStep * lIndex) + 0.25 * fNoise);
+  }
+}
+
+/*****************************************************************************/
+
+/** Time one plugin at one sample rate and block size. Returns the cost
+    in nanoseconds per sample frame of run() (and of run_adding() in
+    *pdAddingCost if provided and the plugin supports it), or a
+    negative value if the plugin could not be instantiated. */
+static double
+benchmarkPlugin(const LADSPA_Descriptor * psDescriptor,
+		const unsigned long lSampleRate,
+		const unsigned long lBlockSize,
+		const double dSeconds,
+		double * pdAddingCost) {
+
+  LADSPA_Handle hInstance
+    = psDescriptor->instantiate(psDescriptor, lSampleRate);
+  if (!hInstance)
+    return -1;
+
+  unsigned long lPortCount = psDescriptor->PortCount;
+  LADSPA_Data ** ppfBuffers = new LADSPA_Data *[lPortCount];
+  for (unsigned long lPort = 0; lPort < lPortCount; lPort++) {
+    LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+    const LADSPA_PortRangeHint & sHint = psDescriptor->PortRangeHints[lPort];
+    if (LADSPA_IS_PORT_CONTROL(iPort)) {
+      ppfBuffers[lPort] = new LADSPA_Data[1];
+      if (LADSPA_IS_PORT_INPUT(iPort))
+	ppfBuffers[lPort][0] = getControlValue(sHint, lSampleRate);
+      else
+	ppfBuffers[lPort][0] = 0;
+    }
+    else {
+      ppfBuffers[lPort] = new LADSPA_Data[BENCH_MAXIMUM_BLOCK_SIZE];
+      if (LADSPA_IS_PORT_INPUT(iPort))
+	fillAudioInput(ppfBuffers[lPort],
+		       lBlockSize,
+		       sHint,
+		       lSampleRate,
+		       lPort);
+      else
+	memset(ppfBuffers[lPort], 0, sizeof(LADSPA_Data) * lBlockSize);
+    }
+    psDescriptor->connect_port(hInstance, lPort, ppfBuffers[lPort]);
+  }
+
+  unsigned long lBlockCount
+    = (unsigned long)(dSeconds * lSampleRate / lBlockSize);
+  if (lBlockCount == 0)
+    lBlockCount = 1;
+
+  if (psDescriptor->activate)
+    psDescriptor->activate(hInstance);
+
+  /* Warm up caches and let any lazy initialisation happen before the
+     clock starts. */
+  psDescriptor->run(hInstance, lBlockSize);
+
+  double dStart = getTime();
+  for (unsigned long lBlock = 0; lBlock < lBlockCount; lBlock++)
+    psDescriptor->run(hInstance, lBlockSize);
+  double dCost = (getTime() - dStart) / (double(lBlockCount) * lBlockSize);
+
+  if (pdAddingCost) {
+    *pdAddingCost = -1;
+    if (psDescriptor->run_adding) {
+      if (psDescriptor->set_run_adding_gain)
+	psDescriptor->set_run_adding_gain(hInstance, 0.5);
+      psDescriptor->run_adding(hInstance, lBlockSize);
+      dStart = getTime();
+      for (unsigned long lBlock = 0; lBlock < lBlockCount; lBlock++)
+	psDescriptor->run_adding(hInstance, lBlockSize);
+      *pdAddingCost
+	= (getTime() - dStart) / (double(lBlockCount) * lBlockSize);
+    }
+  }
+
+  if (psDescriptor->deactivate)
+    psDescriptor->deactivate(hInstance);
+  psDescriptor->cleanup(hInstance);
+
+  for (unsigned long lPort = 0; lPort < lPortCount; lPort++)
+    delete [] ppfBuffers[lPort];
+  delete [] ppfBuffers;
+
+  return dCost;
+}
+
+/*****************************************************************************/
+
+int
+main(const int iArgc, const char ** ppcArgv) {
+
+  const char * pcLibrary = "../plugins/cmt.so";
+  const char * pcLabel = NULL;
+  double dSeconds = 0.25;
+
+  for (int iArg = 1; iArg < iArgc; iArg++) {
+    if (strcmp(ppcArgv[iArg], "-s") == 0 && iArg + 1 < iArgc)
+      dSeconds = atof(ppcArgv[++iArg]);
+    else if (strcmp(ppcArgv[iArg], "-l") == 0 && iArg + 1 < iArgc)
+      pcLabel = ppcArgv[++iArg];
+    else if (ppcArgv[iArg][0] == '-') {
+      fprintf(stderr,
+	      "Usage: %s [-s seconds] [-l label] [library]\n",
+	      ppcArgv[0]);
+      return 1;
+    }
+    else
+      pcLibrary = ppcArgv[iArg];
+  }
+
+  void * pvLibrary = dlopen(pcLibrary, RTLD_NOW | RTLD_LOCAL);
+  if (!pvLibrary) {
+    fprintf(stderr, "Unable to load %s: %s\n", pcLibrary, dlerror());
+    return 1;
+  }
+  LADSPA_Descriptor_Function fDescriptorFunction
+    = (LADSPA_Descriptor_Function)dlsym(pvLibrary, "ladspa_descriptor");
+  if (!fDescriptorFunction) {
+    fprintf(stderr, "%s is not a LADSPA library.\n", pcLibrary);
+    dlclose(pvLibrary);
+    return 1;
+  }
+
+  /* The library chooses its kernels on the first descriptor call. */
+  fDescriptorFunction(0);
+  CMT_Get_Kernel_Set_Function fGetKernelSet
+    = (CMT_Get_Kernel_Set_Function)dlsym(pvLibrary, "cmt_get_kernel_set");
+  if (fGetKernelSet)
+    printf("kernels: %s\n", fGetKernelSet());
+
+  printf("%-28s %6s %6s %13s %13s\n",
+	 "label", "rate", "block", "run ns/smp", "adding ns/smp");
+
+  const LADSPA_Descriptor * psDescriptor;
+  for (unsigned long lIndex = 0;
+       (psDescriptor = fDescriptorFunction(lIndex)) != NULL;
+       lIndex++) {
+    if (pcLabel && strcmp(pcLabel, psDescriptor->Label) != 0)
+      continue;
+    for (unsigned long lRate = 0; lRate < BENCH_SAMPLE_RATE_COUNT; lRate++)
+      for (unsigned long lBlock = 0; lBlock < BENCH_BLOCK_SIZE_COUNT; lBlock++) {
+	double dAddingCost;
+	double dCost = benchmarkPlugin(psDescriptor,
+				       g_plSampleRates[lRate],
+				       g_plBlockSizes[lBlock],
+				       dSeconds,
+				       &dAddingCost);
+	if (dCost < 0) {
+	  printf("%-28s %6lu %6lu %13s %13s\n",
+		 psDescriptor->Label,
+		 g_plSampleRates[lRate],
+		 g_plBlockSizes[lBlock],
+		 "failed",
+		 "-");
+	  continue;
+	}
+	if (dAddingCost < 0)
+	  printf("%-28s %6lu %6lu %13.2f %13s\n",
+		 psDescriptor->Label,
+		 g_plSampleRates[lRate],
+		 g_plBlockSizes[lBlock],
+		 dCost,
+		 "-");
+	else
+	  printf("%-28s %6lu %6lu %13.2f %13.2f\n",
+		 psDescriptor->Label,
+		 g_plSampleRates[lRate],
+		 g_plBlockSizes[lBlock],
+		 dCost,
+		 dAddingCost);
+	fflush(stdout);
+      }
+  }
+
+  dlclose(pvLibrary);
+  return 0;
+}
+
+/*****************************************************************************/
+
+/* EOF */
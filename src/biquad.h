@@ -0,0 +1,239 @@
+/* biquad.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_BIQUAD_INCLUDED
+#define CMT_BIQUAD_INCLUDED
+
+/*****************************************************************************/
+
+#include <cmath>
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+
+/*****************************************************************************/
+
+/* Second order filter sections. Biquad sections are designed with
+   the formulae from Robert Bristow-Johnson's "Audio EQ Cookbook" and
+   run in transposed direct form II:
+
+     y  = b0 * x + z1
+     z1 = b1 * x - a1 * y + z2
+     z2 = b2 * x - a2 * y
+
+   State variable sections use the trapezoidal integrator form
+   described by Andrew Simper, which stays stable and well behaved
+   when the cutoff is modulated quickly. Designs are done in double
+   precision and give coefficients for use in single precision. */
+
+/*****************************************************************************/
+
+#define BIQUAD_LOWPASS   0
+#define BIQUAD_HIGHPASS  1
+#define BIQUAD_BANDPASS  2
+#define BIQUAD_NOTCH     3
+#define BIQUAD_LOWSHELF  4
+#define BIQUAD_HIGHSHELF 5
+
+/** Coefficients for one biquad section, normalised so a0 is 1. */
+struct BiquadCoefficients {
+  LADSPA_Data m_fB0;
+  LADSPA_Data m_fB1;
+  LADSPA_Data m_fB2;
+  LADSPA_Data m_fA1;
+  LADSPA_Data m_fA2;
+};
+
+/** Design a biquad section of type iType (BIQUAD_LOWPASS etc) with
+    cutoff or centre frequency dFrequency (as a fraction of the sample
+    rate, below 0.5) and quality factor dQ. dGain is the shelf gain in
+    decibels and is ignored by the other types. The bandpass section
+    has unity gain at its centre frequency and the shelves have a
+    slope of one. */
+inline void
+designBiquad(BiquadCoefficients & roCoefficients,
+	     const int            iType,
+	     const double         dFrequency,
+	     const double         dQ,
+	     const double         dGain = 0) {
+
+  const double dOmega = 2 * M_PI * dFrequency;
+  const double dCos = cos(dOmega);
+  const double dSin = sin(dOmega);
+  double dB0, dB1, dB2, dA0, dA1, dA2;
+
+  if (iType == BIQUAD_LOWSHELF || iType == BIQUAD_HIGHSHELF) {
+    const double dA = pow(10, dGain / 40);
+    const double dRootA = sqrt(dA);
+    /* Shelf slope of one. */
+    const double dAlpha = dSin * M_SQRT1_2;
+    const double dSign = (iType == BIQUAD_LOWSHELF ? 1 : -1);
+    dB0 = dA * ((dA + 1) - dSign * (dA - 1) * dCos + 2 * dRootA * dAlpha);
+    dB1 = dSign * 2 * dA * ((dA - 1) - dSign * (dA + 1) * dCos);
+    dB2 = dA * ((dA + 1) - dSign * (dA - 1) * dCos - 2 * dRootA * dAlpha);
+    dA0 = (dA + 1) + dSign * (dA - 1) * dCos + 2 * dRootA * dAlpha;
+    dA1 = -dSign * 2 * ((dA - 1) + dSign * (dA + 1) * dCos);
+    dA2 = (dA + 1) + dSign * (dA - 1) * dCos - 2 * dRootA * dAlpha;
+  }
+  else {
+    const double dAlpha = dSin / (2 * dQ);
+    dA0 = 1 + dAlpha;
+    dA1 = -2 * dCos;
+    dA2 = 1 - dAlpha;
+    switch (iType) {
+    case BIQUAD_HIGHPASS:
+      dB0 = dB2 = (1 + dCos) / 2;
+      dB1 = -(1 + dCos);
+      break;
+    case BIQUAD_BANDPASS:
+      dB0 = dAlpha;
+      dB1 = 0;
+      dB2 = -dAlpha;
+      break;
+    case BIQUAD_NOTCH:
+      dB0 = dB2 = 1;
+      dB1 = -2 * dCos;
+      break;
+    default:
+      dB0 = dB2 = (1 - dCos) / 2;
+      dB1 = 1 - dCos;
+      break;
+    }
+  }
+
+  roCoefficients.m_fB0 = LADSPA_Data(dB0 / dA0);
+  roCoefficients.m_fB1 = LADSPA_Data(dB1 / dA0);
+  roCoefficients.m_fB2 = LADSPA_Data(dB2 / dA0);
+  roCoefficients.m_fA1 = LADSPA_Data(dA1 / dA0);
+  roCoefficients.m_fA2 = LADSPA_Data(dA2 / dA0);
+}
+
+/** Quality factor of section lSection (from zero) of a Butterworth
+    filter of order 2 * lSectionCount built from second order
+    sections. */
+inline double
+butterworthQ(const unsigned long lSection,
+	     const unsigned long lSectionCount) {
+  return 0.5 / cos(M_PI * (2 * lSection + 1) / (4.0 * lSectionCount));
+}
+
+/** Design the two sections of the K-weighting filter of ITU-R
+    BS.1770, used for loudness measurement: a high shelf of about +4dB
+    modelling the head, then a highpass at about 38Hz. These are the
+    analogue prototypes of the 48kHz coefficients given in the
+    standard, so reproduce them at 48kHz and follow them closely at
+    other rates. dSampleRate is in Hz. */
+inline void
+designKWeighting(BiquadCoefficients & roShelf,
+		 BiquadCoefficients & roHighPass,
+		 const double         dSampleRate) {
+
+  double dK = tan(M_PI * 1681.974450955533 / dSampleRate);
+  double dQ = 0.7071752369554196;
+  const double dVH = pow(10, 3.999843853973347 / 20);
+  const double dVB = pow(dVH, 0.4996667741545416);
+  double dA0 = 1 + dK / dQ + dK * dK;
+  roShelf.m_fB0 = LADSPA_Data((dVH + dVB * dK / dQ + dK * dK) / dA0);
+  roShelf.m_fB1 = LADSPA_Data(2 * (dK * dK - dVH) / dA0);
+  roShelf.m_fB2 = LADSPA_Data((dVH - dVB * dK / dQ + dK * dK) / dA0);
+  roShelf.m_fA1 = LADSPA_Data(2 * (dK * dK - 1) / dA0);
+  roShelf.m_fA2 = LADSPA_Data((1 - dK / dQ + dK * dK) / dA0);
+
+  dK = tan(M_PI * 38.13547087602444 / dSampleRate);
+  dQ = 0.5003270373238773;
+  dA0 = 1 + dK / dQ + dK * dK;
+  roHighPass.m_fB0 = 1;
+  roHighPass.m_fB1 = -2;
+  roHighPass.m_fB2 = 1;
+  roHighPass.m_fA1 = LADSPA_Data(2 * (dK * dK - 1) / dA0);
+  roHighPass.m_fA2 = LADSPA_Data((1 - dK / dQ + dK * dK) / dA0);
+}
+
+/*****************************************************************************/
+
+#define SVF_LOWPASS  0
+#define SVF_BANDPASS 1
+#define SVF_HIGHPASS 2
+#define SVF_NOTCH    3
+
+/** Coefficients for one state variable section. Each sample:
+
+     v1  = a1 * ic1 + a2 * (x - ic2)
+     v2  = ic2 + a2 * ic1 + a3 * (x - ic2)
+     ic1 = 2 * v1 - ic1
+     ic2 = 2 * v2 - ic2
+     y   = m0 * x + m1 * v1 + m2 * v2
+
+   where v1 is the bandpass and v2 the lowpass response. The mix
+   coefficients select the mode, so switching mode does not disturb
+   the filter state. */
+struct SVFCoefficients {
+  LADSPA_Data m_fA1;
+  LADSPA_Data m_fA2;
+  LADSPA_Data m_fA3;
+  LADSPA_Data m_fM0;
+  LADSPA_Data m_fM1;
+  LADSPA_Data m_fM2;
+};
+
+/** Design a state variable section in mode iMode (SVF_LOWPASS etc)
+    with cutoff dFrequency (as a fraction of the sample rate, below
+    0.5) and quality factor dQ. */
+inline void
+designSVF(SVFCoefficients & roCoefficients,
+	  const int         iMode,
+	  const double      dFrequency,
+	  const double      dQ) {
+
+  const double dG = tan(M_PI * dFrequency);
+  const double dK = 1 / dQ;
+  const double dA1 = 1 / (1 + dG * (dG + dK));
+  roCoefficients.m_fA1 = LADSPA_Data(dA1);
+  roCoefficients.m_fA2 = LADSPA_Data(dG * dA1);
+  roCoefficients.m_fA3 = LADSPA_Data(dG * dG * dA1);
+
+  roCoefficients.m_fM0 = 0;
+  roCoefficients.m_fM1 = 0;
+  roCoefficients.m_fM2 = 0;
+  switch (iMode) {
+  case SVF_BANDPASS:
+    roCoefficients.m_fM1 = 1;
+    break;
+  case SVF_HIGHPASS:
+    roCoefficients.m_fM0 = 1;
+    roCoefficients.m_fM1 = LADSPA_Data(-dK);
+    roCoefficients.m_fM2 = -1;
+    break;
+  case SVF_NOTCH:
+    roCoefficients.m_fM0 = 1;
+    roCoefficients.m_fM1 = LADSPA_Data(-dK);
+    break;
+  default:
+    roCoefficients.m_fM2 = 1;
+    break;
+  }
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -24,8 +24,13 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include "cmt.h"
+#include "lanes.h"
+#include "silence.h"
+#include "utils.h"
 
 #define PORT_IN_LEFT      0
 #define PORT_IN_RIGHT     1
@@ -36,56 +41,154 @@
 #define PORT_RTL_TIME     6
 #define PORT_RTL_FEEDBACK 7
 #define PORT_CUTOFF       8
+#define PORT_IDLE         9
 
-#define NUM_PORTS         9
+#define NUM_PORTS         10
 
 #ifndef PI
 #define PI 3.14159265358979
 #endif
 
+#ifndef MIN
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#endif
+
+/* Delay buffers hold at least one second and are a power of two
+   frames long, so positions wrap with a mask. */
+static unsigned long
+buffer_frames (unsigned long s_rate)
+{
+  unsigned long frames = 1;
+
+  while (frames < s_rate)
+    frames <<= 1;
+  return frames;
+}
+
 class CanyonDelay : public CMT_PluginInstance {
   LADSPA_Data  sample_rate;
 
-  long         datasize;
-  LADSPA_Data *data_l;
-  LADSPA_Data *data_r;
-  LADSPA_Data  accum_l;
-  LADSPA_Data  accum_r;
+  /* The delay lines are interleaved in data, left then right, with
+     datasize frames. */
+  unsigned long  datasize;
+  unsigned long  mask;
+  LADSPA_Data   *data;
+  LADSPA_Data    accum_l;
+  LADSPA_Data    accum_r;
+
+  unsigned long pos;
+
+  /* Delay times in samples reached at the end of the last block, used
+     by the smoothed variant. Negative before the first block. */
+  LADSPA_Data ltr_delay;
+  LADSPA_Data rtl_delay;
 
-  int pos;
+  SilenceTracker silence;
+
+  /* Control changes glide rather than jump. The filter is smoothed
+     through its coefficient to keep pow() out of the loop. */
+  ParameterSmoother<> ltr_smoother;
+  ParameterSmoother<> rtl_smoother;
+  ParameterSmoother<> filter_smoother;
 
 public:
   CanyonDelay(const LADSPA_Descriptor *,
               unsigned long s_rate)
     : CMT_PluginInstance(NUM_PORTS),
       sample_rate(s_rate),
-      datasize(s_rate),
-      data_l(new LADSPA_Data[datasize]),
-      data_r(new LADSPA_Data[datasize]),
+      datasize(buffer_frames (s_rate)),
+      mask(datasize - 1),
+      data(new LADSPA_Data[2 * datasize]),
       accum_l(0.0),
       accum_r(0.0),
-      pos(0) {
-    for (long i = 0; i < datasize; i++)
-      data_l[i] = data_r[i] = 0.0;
+      pos(0),
+      ltr_delay(-1.0),
+      rtl_delay(-1.0),
+      ltr_smoother(s_rate),
+      rtl_smoother(s_rate),
+      filter_smoother(s_rate) {
+    memset (data, 0, sizeof (LADSPA_Data) * 2 * datasize);
   }
 
   ~CanyonDelay() {
-    delete[] data_l;
-    delete[] data_r;
+    delete[] data;
   }
 
   static void
   activate(LADSPA_Handle Instance) {
     CanyonDelay *delay = (CanyonDelay*) Instance;
 
-    for (long i = 0; i < delay->datasize; i++)
-      delay->data_l[i] = delay->data_r[i] = 0.0;
+    memset (delay->data, 0, sizeof (LADSPA_Data) * 2 * delay->datasize);
 
     delay->accum_l = 0.0;
     delay->accum_r = 0.0;
     delay->pos = 0;
+    delay->ltr_delay = -1.0;
+    delay->rtl_delay = -1.0;
+    delay->silence.reset();
+    delay->ltr_smoother.reset();
+    delay->rtl_smoother.reset();
+    delay->filter_smoother.reset();
+  }
+
+  /* While idle, move the delay lines along with zeros as processing
+     silence would. */
+  inline void
+  run_idle (unsigned long SampleCount) {
+    unsigned long count = MIN (SampleCount, datasize);
+    unsigned long clear_pos = pos;
+
+    while (count > 0)
+      {
+        unsigned long run = MIN (datasize - clear_pos, count);
+
+        memset (data + 2 * clear_pos, 0, sizeof (LADSPA_Data) * 2 * run);
+        clear_pos = 0;
+        count -= run;
+      }
+    pos = (pos + SampleCount) & mask;
+    accum_l = 0.0;
+    accum_r = 0.0;
+    memset (m_ppfPorts[PORT_OUT_LEFT], 0, sizeof (LADSPA_Data) * SampleCount);
+    memset (m_ppfPorts[PORT_OUT_RIGHT], 0, sizeof (LADSPA_Data) * SampleCount);
+    silence.update (true, SampleCount);
+    *m_ppfPorts[PORT_IDLE] = 1.0;
   }
 
+  /* Read channel (0 for left, 1 for right) with linear
+     interpolation, delay_samples behind at_pos. */
+  inline LADSPA_Data
+  read_fractional (int           channel,
+                   unsigned long at_pos,
+                   LADSPA_Data   delay_samples) {
+    int offset = (int) delay_samples;
+    LADSPA_Data frac = delay_samples - offset;
+    unsigned long pos1, pos2;
+
+    pos1 = (at_pos - offset) & mask;
+    pos2 = (pos1 - 1) & mask;
+
+    return data[2 * pos1 + channel]
+      + frac * (data[2 * pos2 + channel] - data[2 * pos1 + channel]);
+  }
+
+  /* Target delay in samples for a time port, kept within the buffer
+     with room for the interpolator. */
+  inline LADSPA_Data
+  delay_target (LADSPA_Data seconds) {
+    LADSPA_Data samples = seconds * sample_rate;
+
+    if (samples < 1.0)
+      samples = 1.0;
+    if (samples > datasize - 2)
+      samples = datasize - 2;
+    return samples;
+  }
+
+  /* With smooth set, the delay times glide across each block and are
+     read with linear interpolation rather than being truncated to
+     whole samples once per block. */
+  template <bool smooth>
   static void
   run(LADSPA_Handle Instance,
       unsigned long SampleCount) {
@@ -93,59 +196,488 @@ public:
     LADSPA_Data **ports;
     unsigned long i;
     int l_to_r_offset, r_to_l_offset;
+    LADSPA_Data ltr_target, rtl_target, ltr_step, rtl_step;
+    LADSPA_Data ltr_feedback, rtl_feedback;
     LADSPA_Data ltr_invmag, rtl_invmag;
     LADSPA_Data filter_mag, filter_invmag;
+    bool constant;
 
     ports = delay->m_ppfPorts;
 
     l_to_r_offset = (int) (*ports[PORT_LTR_TIME] * delay->sample_rate);
     r_to_l_offset = (int) (*ports[PORT_RTL_TIME] * delay->sample_rate);
 
-    ltr_invmag = 1.0 - fabs (*ports[PORT_LTR_FEEDBACK]);
-    rtl_invmag = 1.0 - fabs (*ports[PORT_RTL_FEEDBACK]);
+    ltr_target = rtl_target = ltr_step = rtl_step = 0.0;
+    if (smooth && SampleCount > 0)
+      {
+        ltr_target = delay->delay_target (*ports[PORT_LTR_TIME]);
+        rtl_target = delay->delay_target (*ports[PORT_RTL_TIME]);
+        if (delay->ltr_delay < 0.0)
+          delay->ltr_delay = ltr_target;
+        if (delay->rtl_delay < 0.0)
+          delay->rtl_delay = rtl_target;
+        ltr_step = (ltr_target - delay->ltr_delay) / SampleCount;
+        rtl_step = (rtl_target - delay->rtl_delay) / SampleCount;
+      }
+
+    delay->ltr_smoother.setTarget (*ports[PORT_LTR_FEEDBACK]);
+    delay->rtl_smoother.setTarget (*ports[PORT_RTL_FEEDBACK]);
+    delay->filter_smoother.setTarget (pow (0.5, (4.0 * PI * *ports[PORT_CUTOFF]) / delay->sample_rate));
+    constant = (delay->ltr_smoother.isConstant ()
+                && delay->rtl_smoother.isConstant ()
+                && delay->filter_smoother.isConstant ());
 
-    filter_invmag = pow (0.5, (4.0 * PI * *ports[PORT_CUTOFF]) / delay->sample_rate);
+    ltr_feedback = delay->ltr_smoother.getValue ();
+    rtl_feedback = delay->rtl_smoother.getValue ();
+    ltr_invmag = 1.0 - fabs (ltr_feedback);
+    rtl_invmag = 1.0 - fabs (rtl_feedback);
+
+    filter_invmag = delay->filter_smoother.getValue ();
     filter_mag = 1.0 - filter_invmag;
 
-    for (i = 0; i < SampleCount; i++)
+    /* The delay lines hold the outputs, so once the inputs and
+       outputs have been silent for the longest delay (and so the
+       low-pass filter has decayed too) the tail is over. */
+    unsigned long tail_length;
+    if (smooth)
+      {
+        LADSPA_Data longest = ltr_target;
+        if (rtl_target > longest)
+          longest = rtl_target;
+        if (delay->ltr_delay > longest)
+          longest = delay->ltr_delay;
+        if (delay->rtl_delay > longest)
+          longest = delay->rtl_delay;
+        tail_length = (unsigned long) longest + 2;
+      }
+    else
+      tail_length = (l_to_r_offset > r_to_l_offset
+                     ? l_to_r_offset : r_to_l_offset) + 1;
+    bool silent = (isSilent (ports[PORT_IN_LEFT], SampleCount)
+                   && isSilent (ports[PORT_IN_RIGHT], SampleCount));
+    if (silent && delay->silence.isIdle (tail_length))
+      {
+        if (smooth && SampleCount > 0)
+          {
+            delay->ltr_delay = ltr_target;
+            delay->rtl_delay = rtl_target;
+          }
+        delay->ltr_smoother.skip (SampleCount);
+        delay->rtl_smoother.skip (SampleCount);
+        delay->filter_smoother.skip (SampleCount);
+        delay->run_idle (SampleCount);
+        return;
+      }
+
+    /* Run in segments over which neither the write position nor
+       (with fixed delays) the read positions wrap, so the loop can
+       step through the buffer without masking. */
+    for (i = 0; i < SampleCount; )
+      {
+        unsigned long count, j;
+        unsigned long read_r = 0, read_l = 0;
+
+        count = MIN (SampleCount - i, delay->datasize - delay->pos);
+        if (!smooth)
+          {
+            read_r = (delay->pos - r_to_l_offset) & delay->mask;
+            read_l = (delay->pos - l_to_r_offset) & delay->mask;
+            count = MIN (count, delay->datasize - read_r);
+            count = MIN (count, delay->datasize - read_l);
+          }
+
+        LADSPA_Data *frame = delay->data + 2 * delay->pos;
+        const LADSPA_Data *delayed_r = delay->data + 2 * read_r + 1;
+        const LADSPA_Data *delayed_l = delay->data + 2 * read_l;
+        const LADSPA_Data *in_l = ports[PORT_IN_LEFT] + i;
+        const LADSPA_Data *in_r = ports[PORT_IN_RIGHT] + i;
+        LADSPA_Data *out_l = ports[PORT_OUT_LEFT] + i;
+        LADSPA_Data *out_r = ports[PORT_OUT_RIGHT] + i;
+
+        for (j = 0; j < count; j++)
+          {
+            LADSPA_Data accum_l, accum_r;
+            LADSPA_Data past_r, past_l;
+
+            accum_l = in_l[j];
+            accum_r = in_r[j];
+
+            if (!constant)
+              {
+                ltr_feedback = delay->ltr_smoother.next ();
+                rtl_feedback = delay->rtl_smoother.next ();
+                ltr_invmag = 1.0 - fabs (ltr_feedback);
+                rtl_invmag = 1.0 - fabs (rtl_feedback);
+                filter_invmag = delay->filter_smoother.next ();
+                filter_mag = 1.0 - filter_invmag;
+              }
+
+            if (smooth)
+              {
+                delay->rtl_delay += rtl_step;
+                delay->ltr_delay += ltr_step;
+                past_r = delay->read_fractional (1, delay->pos + j, delay->rtl_delay);
+                past_l = delay->read_fractional (0, delay->pos + j, delay->ltr_delay);
+              }
+            else
+              {
+                past_r = delayed_r[2 * j];
+                past_l = delayed_l[2 * j];
+              }
+
+            /* Mix channels with past samples. */
+            accum_l = accum_l * rtl_invmag + past_r * rtl_feedback;
+            accum_r = accum_r * ltr_invmag + past_l * ltr_feedback;
+
+            /* Low-pass filter output. */
+            accum_l = delay->accum_l * filter_invmag + accum_l * filter_mag;
+            accum_r = delay->accum_r * filter_invmag + accum_r * filter_mag;
+
+            /* Store IIR samples. */
+            delay->accum_l = accum_l;
+            delay->accum_r = accum_r;
+
+            /* Store samples in the delay lines. */
+            frame[2 * j] = accum_l;
+            frame[2 * j + 1] = accum_r;
+
+            out_l[j] = accum_l;
+            out_r[j] = accum_r;
+          }
+
+        delay->pos = (delay->pos + count) & delay->mask;
+        i += count;
+      }
+
+    if (smooth && SampleCount > 0)
+      {
+        /* Avoid accumulating rounding error in the glide. */
+        delay->ltr_delay = ltr_target;
+        delay->rtl_delay = rtl_target;
+      }
+
+    delay->silence.update (silent
+                           && isSilent (ports[PORT_OUT_LEFT], SampleCount)
+                           && isSilent (ports[PORT_OUT_RIGHT], SampleCount),
+                           SampleCount);
+    if (delay->silence.isQuietFor (tail_length))
+      delay->silence.enterIdle ();
+    *ports[PORT_IDLE] = 0.0;
+  }
+};
+
+
+/* Canyon Delay for any number of channels. Each channel has its own
+   delay time, and the delayed signal of every channel can be fed back
+   into every other through a matrix, generalising the left to right
+   and right to left feedback above. All the delay lines share one
+   interleaved buffer with frames padded to a whole number of lanes,
+   so that a sample of every channel is filtered and stored at once.
+
+   Ports are the inputs, the outputs, the channel delay times, the
+   feedback matrix (target channel major), the cutoff and the idle
+   flag. As in CanyonDelay, the dry signal into each channel is scaled
+   by one less the magnitude of its feedback; rows whose feedback
+   magnitudes sum to more than one are scaled down to one so the
+   delay cannot run away. */
+
+#define MATRIX_PORT_IN(c)           (c)
+#define MATRIX_PORT_OUT(c)          (channels + (c))
+#define MATRIX_PORT_TIME(c)         (2 * channels + (c))
+#define MATRIX_PORT_FEEDBACK(to, from) (3 * channels + (to) * channels + (from))
+#define MATRIX_PORT_CUTOFF          (3 * channels + channels * channels)
+#define MATRIX_PORT_IDLE            (MATRIX_PORT_CUTOFF + 1)
+#define MATRIX_NUM_PORTS(channels)  (3 * (channels) + (channels) * (channels) + 2)
+
+template <int channels>
+class CanyonMatrixDelay : public CMT_PluginInstance {
+  enum
+  {
+    groups = (channels + LANE_COUNT - 1) / LANE_COUNT,
+    stride = groups * LANE_COUNT
+  };
+
+  LADSPA_Data sample_rate;
+
+  unsigned long  datasize;
+  unsigned long  mask;
+  LADSPA_Data   *data;
+  unsigned long  pos;
+
+  Lanes accum[groups];
+
+  /* Feedback into each group of target channels from each source
+     channel, the dry gain of each channel and the filter coefficient,
+     as reached at the end of the last block. */
+  LADSPA_Data feedback[channels][stride];
+  LADSPA_Data dry[stride];
+  LADSPA_Data filter_invmag;
+  bool        primed;
+
+  SilenceTracker silence;
+
+public:
+  CanyonMatrixDelay(const LADSPA_Descriptor *,
+                    unsigned long s_rate)
+    : CMT_PluginInstance(MATRIX_NUM_PORTS (channels)),
+      sample_rate(s_rate),
+      datasize(buffer_frames (s_rate)),
+      mask(datasize - 1),
+      data(new LADSPA_Data[stride * datasize]) {
+    activate (this);
+  }
+
+  ~CanyonMatrixDelay() {
+    delete[] data;
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    CanyonMatrixDelay *delay = (CanyonMatrixDelay*) Instance;
+
+    memset (delay->data, 0, sizeof (LADSPA_Data) * stride * delay->datasize);
+    delay->pos = 0;
+    for (int g = 0; g < groups; g++)
+      delay->accum[g] = lanesSplat (0.0);
+    delay->primed = false;
+    delay->silence.reset ();
+  }
+
+  inline void
+  run_idle (unsigned long SampleCount) {
+    unsigned long count = MIN (SampleCount, datasize);
+    unsigned long clear_pos = pos;
+
+    while (count > 0)
+      {
+        unsigned long run = MIN (datasize - clear_pos, count);
+
+        memset (data + stride * clear_pos, 0, sizeof (LADSPA_Data) * stride * run);
+        clear_pos = 0;
+        count -= run;
+      }
+    pos = (pos + SampleCount) & mask;
+    for (int g = 0; g < groups; g++)
+      accum[g] = lanesSplat (0.0);
+    for (int c = 0; c < channels; c++)
+      memset (m_ppfPorts[MATRIX_PORT_OUT (c)], 0, sizeof (LADSPA_Data) * SampleCount);
+    silence.update (true, SampleCount);
+    *m_ppfPorts[MATRIX_PORT_IDLE] = 1.0;
+  }
+
+  /* Input sample i of channel c, or zero for the padding. */
+  inline LADSPA_Data
+  input (int c, unsigned long i) {
+    return c < channels ? m_ppfPorts[MATRIX_PORT_IN (c)][i] : 0.0F;
+  }
+
+  /* Process count frames from frame pos and sample i of the ports,
+     with no position wrapping. delayed[j] points at the frame channel
+     j is read from. With ramp set the gains move by the given steps
+     each sample. */
+  template <bool ramp>
+  inline void
+  run_segment (unsigned long       i,
+               unsigned long       count,
+               const LADSPA_Data **delayed,
+               Lanes               (&gain)[channels][groups],
+               Lanes               (&dry_gain)[groups],
+               Lanes              &filter_gain,
+               const Lanes         (&gain_step)[channels][groups],
+               const Lanes         (&dry_step)[groups],
+               const Lanes        &filter_step) {
+    LADSPA_Data *frame = data + stride * pos;
+    Lanes state[groups];
+    int g, j;
+
+    /* Work on local copies, which the stores to the buffer cannot
+       alias. */
+    Lanes fb[channels][groups], dr[groups], fl = filter_gain;
+    for (g = 0; g < groups; g++)
+      {
+        state[g] = accum[g];
+        dr[g] = dry_gain[g];
+        for (j = 0; j < channels; j++)
+          fb[j][g] = gain[j][g];
+      }
+
+    for (unsigned long k = 0; k < count; k++, i++, frame += stride)
       {
-        LADSPA_Data accum_l, accum_r;
-        int pos1, pos2;
+        Lanes mixed[groups];
+
+        for (g = 0; g < groups; g++)
+          mixed[g] = lanesSet (input (g * LANE_COUNT, i),
+                               input (g * LANE_COUNT + 1, i),
+                               input (g * LANE_COUNT + 2, i),
+                               input (g * LANE_COUNT + 3, i)) * dr[g];
+
+        /* Mix in the channels' past samples. */
+        for (j = 0; j < channels; j++)
+          {
+            const Lanes past = lanesSplat (delayed[j][stride * k + j]);
+            for (g = 0; g < groups; g++)
+              mixed[g] = mixed[g] + fb[j][g] * past;
+          }
+
+        /* Low-pass filter, then store in the delay lines. */
+        for (g = 0; g < groups; g++)
+          {
+            state[g] = state[g] * fl + mixed[g] * (lanesSplat (1.0) - fl);
+            lanesStore (frame + g * LANE_COUNT, state[g]);
+          }
+
+        for (j = 0; j < channels; j++)
+          m_ppfPorts[MATRIX_PORT_OUT (j)][i] = frame[j];
+
+        if (ramp)
+          {
+            for (j = 0; j < channels; j++)
+              for (g = 0; g < groups; g++)
+                fb[j][g] = fb[j][g] + gain_step[j][g];
+            for (g = 0; g < groups; g++)
+              dr[g] = dr[g] + dry_step[g];
+            fl = fl + filter_step;
+          }
+      }
 
-        accum_l = ports[PORT_IN_LEFT][i];
-        accum_r = ports[PORT_IN_RIGHT][i];
+    for (g = 0; g < groups; g++)
+      {
+        accum[g] = state[g];
+        dry_gain[g] = dr[g];
+        for (j = 0; j < channels; j++)
+          gain[j][g] = fb[j][g];
+      }
+    filter_gain = fl;
+  }
 
-        pos1 = delay->pos - r_to_l_offset + delay->datasize;
-        while (pos1 >= delay->datasize)
-          pos1 -= delay->datasize;
-      
-        pos2 = delay->pos - l_to_r_offset + delay->datasize;
-        while (pos2 >= delay->datasize)
-          pos2 -= delay->datasize;
+  /* The feedback and filter settings glide across each block in which
+     they change. Delay times are whole samples, set once per
+     block. */
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+    CanyonMatrixDelay *delay = (CanyonMatrixDelay*) Instance;
+    LADSPA_Data **ports = delay->m_ppfPorts;
+    unsigned long offset[channels];
+    unsigned long tail_length = 0;
+    LADSPA_Data target[channels][stride];
+    LADSPA_Data target_dry[stride];
+    LADSPA_Data target_filter;
+    bool changed;
+    int c, j, g;
+
+    for (j = 0; j < channels; j++)
+      {
+        LADSPA_Data samples = *ports[MATRIX_PORT_TIME (j)] * delay->sample_rate;
+
+        if (samples < 1.0)
+          samples = 1.0;
+        if (samples > delay->datasize - 1)
+          samples = delay->datasize - 1;
+        offset[j] = (unsigned long) samples;
+        if (offset[j] + 1 > tail_length)
+          tail_length = offset[j] + 1;
+      }
 
-        /* Mix channels with past samples. */
-        accum_l = accum_l * rtl_invmag + delay->data_r[pos1] * *ports[PORT_RTL_FEEDBACK];
-        accum_r = accum_r * ltr_invmag + delay->data_l[pos2] * *ports[PORT_LTR_FEEDBACK];
+    for (c = 0; c < stride; c++)
+      {
+        LADSPA_Data magnitude = 0.0, scale = 1.0;
+
+        for (j = 0; j < channels; j++)
+          {
+            target[j][c] = c < channels ? *ports[MATRIX_PORT_FEEDBACK (c, j)] : 0.0F;
+            magnitude += fabs (target[j][c]);
+          }
+        if (magnitude > 1.0)
+          {
+            scale = 1.0 / magnitude;
+            for (j = 0; j < channels; j++)
+              target[j][c] *= scale;
+          }
+        target_dry[c] = c < channels ? 1.0 - magnitude * scale : 0.0;
+      }
+    target_filter = pow (0.5, (4.0 * PI * *ports[MATRIX_PORT_CUTOFF]) / delay->sample_rate);
 
-        /* Low-pass filter output. */
-        accum_l = delay->accum_l * filter_invmag + accum_l * filter_mag;
-        accum_r = delay->accum_r * filter_invmag + accum_r * filter_mag;
+    if (!delay->primed)
+      {
+        memcpy (delay->feedback, target, sizeof (target));
+        memcpy (delay->dry, target_dry, sizeof (target_dry));
+        delay->filter_invmag = target_filter;
+        delay->primed = true;
+      }
+    changed = (memcmp (delay->feedback, target, sizeof (target)) != 0
+               || memcmp (delay->dry, target_dry, sizeof (target_dry)) != 0
+               || delay->filter_invmag != target_filter);
+
+    bool silent = true;
+    for (c = 0; c < channels && silent; c++)
+      silent = isSilent (ports[MATRIX_PORT_IN (c)], SampleCount);
+    if (silent && delay->silence.isIdle (tail_length))
+      {
+        memcpy (delay->feedback, target, sizeof (target));
+        memcpy (delay->dry, target_dry, sizeof (target_dry));
+        delay->filter_invmag = target_filter;
+        delay->run_idle (SampleCount);
+        return;
+      }
 
-        /* Store IIR samples. */
-        delay->accum_l = accum_l;
-        delay->accum_r = accum_r;
-      
-        /* Store samples in arrays. */
-        delay->data_l[delay->pos] = accum_l;
-        delay->data_r[delay->pos] = accum_r;
+    Lanes gain[channels][groups], gain_step[channels][groups];
+    Lanes dry_gain[groups], dry_step[groups];
+    Lanes filter_gain, filter_step;
+    const LADSPA_Data ramp_scale = changed && SampleCount > 0 ? 1.0 / SampleCount : 0.0;
 
-        ports[PORT_OUT_LEFT][i] = accum_l;
-        ports[PORT_OUT_RIGHT][i] = accum_r;
+    for (g = 0; g < groups; g++)
+      {
+        const int first = g * LANE_COUNT;
+
+        for (j = 0; j < channels; j++)
+          {
+            gain[j][g] = lanesLoad (delay->feedback[j] + first);
+            gain_step[j][g] = (lanesLoad (target[j] + first) - gain[j][g]) * ramp_scale;
+          }
+        dry_gain[g] = lanesLoad (delay->dry + first);
+        dry_step[g] = (lanesLoad (target_dry + first) - dry_gain[g]) * ramp_scale;
+      }
+    filter_gain = lanesSplat (delay->filter_invmag);
+    filter_step = lanesSplat ((target_filter - delay->filter_invmag) * ramp_scale);
 
-        delay->pos++;
-        if (delay->pos >= delay->datasize)
-          delay->pos -= delay->datasize;
+    /* Run in segments over which no read or write position wraps. */
+    for (unsigned long i = 0; i < SampleCount; )
+      {
+        const LADSPA_Data *delayed[channels];
+        unsigned long count = MIN (SampleCount - i, delay->datasize - delay->pos);
+
+        for (j = 0; j < channels; j++)
+          {
+            const unsigned long read = (delay->pos - offset[j]) & delay->mask;
+
+            count = MIN (count, delay->datasize - read);
+            delayed[j] = delay->data + stride * read;
+          }
+
+        if (changed)
+          delay->run_segment<true> (i, count, delayed, gain, dry_gain, filter_gain,
+                                    gain_step, dry_step, filter_step);
+        else
+          delay->run_segment<false> (i, count, delayed, gain, dry_gain, filter_gain,
+                                     gain_step, dry_step, filter_step);
+
+        delay->pos = (delay->pos + count) & delay->mask;
+        i += count;
       }
+
+    /* Land exactly on the new settings. */
+    memcpy (delay->feedback, target, sizeof (target));
+    memcpy (delay->dry, target_dry, sizeof (target_dry));
+    delay->filter_invmag = target_filter;
+
+    bool quiet = silent;
+    for (c = 0; c < channels && quiet; c++)
+      quiet = isSilent (ports[MATRIX_PORT_OUT (c)], SampleCount);
+    delay->silence.update (quiet, SampleCount);
+    if (delay->silence.isQuietFor (tail_length))
+      delay->silence.enterIdle ();
+    *ports[MATRIX_PORT_IDLE] = 0.0;
   }
 };
 
@@ -160,7 +692,8 @@ static LADSPA_PortDescriptor g_psPortDescriptors[] =
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
-  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT
+  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+  LADSPA_PORT_CONTROL | LADSPA_PORT_OUTPUT
 };
 
 static const char * const g_psPortNames[] =
@@ -173,7 +706,8 @@ static const char * const g_psPortNames[] =
   "Left to Right Feedback (Percent)",
   "Right to Left Time (Seconds)",
   "Right to Left Feedback (Percent)",
-  "Low-Pass Cutoff (Hz)"
+  "Low-Pass Cutoff (Hz)",
+  SILENCE_IDLE_PORT_NAME
 };
 
 static LADSPA_PortRangeHint g_psPortRangeHints[] =
@@ -187,9 +721,76 @@ static LADSPA_PortRangeHint g_psPortRangeHints[] =
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, -1.0, 1.0 },
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.01, 0.99 },
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, -1.0, 1.0 },
-  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 1.0, 5000.0 }
+  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 1.0, 5000.0 },
+  { SILENCE_IDLE_PORT_HINTS, 0.0, 0.0 }
 };
 
+/* Register a CanyonMatrixDelay, naming the ports after the channel
+   names given. */
+template <int channels>
+static void
+initialise_canyon_matrix (unsigned long               id,
+                          const char                 *label,
+                          const char                 *name,
+                          const char * const         *channel_names) {
+  CMT_Descriptor * psDescriptor;
+  char port_name[128];
+  int c, j;
+
+  psDescriptor = new CMT_Descriptor
+      (id,
+       label,
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       name,
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("1999, 2000", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<CanyonMatrixDelay<channels> >,
+       CanyonMatrixDelay<channels>::activate,
+       CanyonMatrixDelay<channels>::run,
+       NULL,
+       NULL,
+       NULL);
+
+  for (c = 0; c < channels; c++)
+    {
+      sprintf (port_name, "In (%s)", channel_names[c]);
+      psDescriptor->addPort (LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT, port_name);
+    }
+  for (c = 0; c < channels; c++)
+    {
+      sprintf (port_name, "Out (%s)", channel_names[c]);
+      psDescriptor->addPort (LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT, port_name);
+    }
+  for (c = 0; c < channels; c++)
+    {
+      sprintf (port_name, "%s Time (Seconds)", channel_names[c]);
+      psDescriptor->addPort (LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+                             port_name,
+                             LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW,
+                             0.01, 0.99);
+    }
+  for (c = 0; c < channels; c++)
+    for (j = 0; j < channels; j++)
+      {
+        sprintf (port_name, "%s to %s Feedback", channel_names[j], channel_names[c]);
+        psDescriptor->addPort (LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+                               port_name,
+                               LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW
+                               | LADSPA_HINT_DEFAULT_0,
+                               -1.0, 1.0);
+      }
+  psDescriptor->addPort (LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+                         "Low-Pass Cutoff (Hz)",
+                         LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW,
+                         1.0, 5000.0);
+  psDescriptor->addPort (LADSPA_PORT_CONTROL | LADSPA_PORT_OUTPUT,
+                         SILENCE_IDLE_PORT_NAME,
+                         SILENCE_IDLE_PORT_HINTS);
+
+  registerNewPluginDescriptor(psDescriptor);
+}
+
 void
 initialise_canyondelay() {
   CMT_Descriptor * psDescriptor;
@@ -204,7 +805,32 @@ initialise_canyondelay() {
        NULL,
        CMT_Instantiate<CanyonDelay>,
        CanyonDelay::activate,
-       CanyonDelay::run,
+       CanyonDelay::run<false>,
+       NULL,
+       NULL,
+       NULL);
+
+  for (int i = 0; i < NUM_PORTS; i++)
+    psDescriptor->addPort(
+      g_psPortDescriptors[i],
+      g_psPortNames[i],
+      g_psPortRangeHints[i].HintDescriptor,
+      g_psPortRangeHints[i].LowerBound,
+      g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (1911,
+       "canyon_delay_smooth",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Canyon Delay (Smoothed Delay Times)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("1999, 2000", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<CanyonDelay>,
+       CanyonDelay::activate,
+       CanyonDelay::run<true>,
        NULL,
        NULL,
        NULL);
@@ -218,4 +844,14 @@ initialise_canyondelay() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  static const char * const quad_names[] =
+    { "Front Left", "Front Right", "Rear Left", "Rear Right" };
+  static const char * const surround_names[] =
+    { "Front Left", "Front Right", "Centre", "LFE", "Surround Left", "Surround Right" };
+
+  initialise_canyon_matrix<4> (2003, "canyon_delay_quad",
+                               "Canyon Delay (Quad Feedback Matrix)", quad_names);
+  initialise_canyon_matrix<6> (2004, "canyon_delay_51",
+                               "Canyon Delay (5.1 Feedback Matrix)", surround_names);
 }
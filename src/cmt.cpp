@@ -20,11 +20,19 @@
 
 /*****************************************************************************/
 
+#include <cstdint>
 #include <cstring>
+#include <mutex>
+
+#ifdef CMT_INSTRUMENT
+#include <atomic>
+#include <ctime>
+#endif
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "denormal.h"
 
 /*****************************************************************************/
 
@@ -73,14 +81,363 @@ CMT_ConnectPort(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+#ifdef CMT_INSTRUMENT
+
+/* The counters of an instance are only written by the thread running
+   it, as LADSPA never has two threads run one instance at once, but
+   may be read from any thread. The writer makes a sequence number odd
+   while it updates them and readers retry until they see the same
+   even number before and after their copy, so neither side takes a
+   lock and the writer never waits. */
+
+static inline unsigned long long
+readClock() {
+  struct timespec sTime;
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return (unsigned long long)sTime.tv_sec * 1000000000ULL + sTime.tv_nsec;
+}
+
+/** Add to a counter that has a single writer, which needs no locked
+    instruction. */
+static inline void
+addToCounter(std::atomic<unsigned long long> & rllCounter,
+	     const unsigned long long llValue) {
+  rllCounter.store(rllCounter.load(std::memory_order_relaxed) + llValue,
+		   std::memory_order_relaxed);
+}
+
+class CMT_InstanceCounters {
+private:
+
+  std::atomic<unsigned long> m_lSequence;
+
+  /** The duration of one sample, beyond which a call overruns. */
+  const double m_dNanosecondsPerSample;
+
+  std::atomic<unsigned long long> m_llCallCount;
+  std::atomic<unsigned long long> m_llSampleCount;
+  std::atomic<unsigned long long> m_llNanoseconds;
+  std::atomic<unsigned long long> m_llMaximumCallNanoseconds;
+  std::atomic<unsigned long long> m_llOverrunCount;
+  std::atomic<unsigned long long> m_allBlockSizeCounts[CMT_BLOCK_SIZE_BINS];
+
+public:
+
+  CMT_InstanceCounters(const unsigned long lSampleRate)
+    : m_lSequence(0),
+      m_dNanosecondsPerSample(1e9 / lSampleRate),
+      m_llCallCount(0),
+      m_llSampleCount(0),
+      m_llNanoseconds(0),
+      m_llMaximumCallNanoseconds(0),
+      m_llOverrunCount(0) {
+    for (int iBin = 0; iBin < CMT_BLOCK_SIZE_BINS; iBin++)
+      m_allBlockSizeCounts[iBin].store(0, std::memory_order_relaxed);
+  }
+
+  void record(const unsigned long      lSampleCount,
+	      const unsigned long long llNanoseconds) {
+
+    const unsigned long lSequence
+      = m_lSequence.load(std::memory_order_relaxed);
+    m_lSequence.store(lSequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    addToCounter(m_llCallCount, 1);
+    addToCounter(m_llSampleCount, lSampleCount);
+    addToCounter(m_llNanoseconds, llNanoseconds);
+    if (llNanoseconds
+	> m_llMaximumCallNanoseconds.load(std::memory_order_relaxed))
+      m_llMaximumCallNanoseconds.store(llNanoseconds,
+				       std::memory_order_relaxed);
+    if (llNanoseconds > lSampleCount * m_dNanosecondsPerSample)
+      addToCounter(m_llOverrunCount, 1);
+
+    int iBin = 0;
+    while (iBin < CMT_BLOCK_SIZE_BINS - 1 && (lSampleCount >> (iBin + 1)))
+      iBin++;
+    addToCounter(m_allBlockSizeCounts[iBin], 1);
+
+    m_lSequence.store(lSequence + 2, std::memory_order_release);
+  }
+
+  void read(CMT_Instance_Statistics * psStatistics) const {
+    unsigned long lBefore, lAfter;
+    do {
+      lBefore = m_lSequence.load(std::memory_order_acquire);
+      psStatistics->CallCount 
+	= m_llCallCount.load(std::memory_order_relaxed);
+      psStatistics->SampleCount
+	= m_llSampleCount.load(std::memory_order_relaxed);
+      psStatistics->Nanoseconds
+	= m_llNanoseconds.load(std::memory_order_relaxed);
+      psStatistics->MaximumCallNanoseconds
+	= m_llMaximumCallNanoseconds.load(std::memory_order_relaxed);
+      psStatistics->OverrunCount
+	= m_llOverrunCount.load(std::memory_order_relaxed);
+      for (int iBin = 0; iBin < CMT_BLOCK_SIZE_BINS; iBin++)
+	psStatistics->BlockSizeCounts[iBin]
+	  = m_allBlockSizeCounts[iBin].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      lAfter = m_lSequence.load(std::memory_order_relaxed);
+    } while ((lBefore & 1) || lBefore != lAfter);
+  }
+
+};
+
+#endif
+
+/*****************************************************************************/
+
 void 
 CMT_Cleanup(LADSPA_Handle Instance) {
   CMT_PluginInstance * poInstance = (CMT_PluginInstance *)Instance;
+#ifdef CMT_INSTRUMENT
+  delete poInstance->m_poCounters;
+#endif
   delete poInstance;
 }
 
 /*****************************************************************************/
 
+/* The LADSPA entry points below wrap those supplied by each plugin so
+   that every plugin runs with denormals flushed to zero, without
+   needing its own per-sample checks. */
+
+LADSPA_Handle 
+CMT_InstantiateInstance(const LADSPA_Descriptor * Descriptor,
+			unsigned long             SampleRate) {
+  const CMT_Descriptor * psDescriptor = (const CMT_Descriptor *)Descriptor;
+  CMT_PluginInstance * poInstance 
+    = (CMT_PluginInstance *)psDescriptor->m_fInstantiate(Descriptor,
+							 SampleRate);
+  if (poInstance) {
+    poInstance->m_psDescriptor = psDescriptor;
+#ifdef CMT_INSTRUMENT
+    poInstance->m_poCounters = new CMT_InstanceCounters(SampleRate);
+#endif
+  }
+  return poInstance;
+}
+
+/*****************************************************************************/
+
+void 
+CMT_Run(LADSPA_Handle Instance,
+	unsigned long SampleCount) {
+  CMT_PluginInstance * poInstance = (CMT_PluginInstance *)Instance;
+  DenormalGuard oGuard;
+#ifdef CMT_INSTRUMENT
+  const unsigned long long llStart = readClock();
+#endif
+  poInstance->m_psDescriptor->m_fRun(Instance, SampleCount);
+#ifdef CMT_INSTRUMENT
+  poInstance->m_poCounters->record(SampleCount, readClock() - llStart);
+#endif
+}
+
+/*****************************************************************************/
+
+void 
+CMT_RunAdding(LADSPA_Handle Instance,
+	      unsigned long SampleCount) {
+  CMT_PluginInstance * poInstance = (CMT_PluginInstance *)Instance;
+  DenormalGuard oGuard;
+#ifdef CMT_INSTRUMENT
+  const unsigned long long llStart = readClock();
+#endif
+  poInstance->m_psDescriptor->m_fRunAdding(Instance, SampleCount);
+#ifdef CMT_INSTRUMENT
+  poInstance->m_poCounters->record(SampleCount, readClock() - llStart);
+#endif
+}
+
+/*****************************************************************************/
+
+/* The batch is first checked to come from a single descriptor, as the
+   plugin's batch function relies on it. A mixed batch is still run,
+   one instance at a time. */
+
+int
+cmt_run_batch(const LADSPA_Descriptor * Descriptor,
+	      const LADSPA_Handle *     Instances,
+	      unsigned long             InstanceCount,
+	      unsigned long             SampleCount) {
+
+  const CMT_Descriptor * psDescriptor = (const CMT_Descriptor *)Descriptor;
+  DenormalGuard oGuard;
+#ifdef CMT_INSTRUMENT
+  const unsigned long long llStart = readClock();
+#endif
+
+  bool bBatch = (psDescriptor->m_fRunBatch != NULL);
+  unsigned long lIndex;
+  for (lIndex = 0; lIndex < InstanceCount && bBatch; lIndex++)
+    if (((CMT_PluginInstance *)Instances[lIndex])->m_psDescriptor
+	!= psDescriptor)
+      bBatch = false;
+
+  if (bBatch)
+    psDescriptor->m_fRunBatch(Instances, InstanceCount, SampleCount);
+  else
+    for (lIndex = 0; lIndex < InstanceCount; lIndex++) {
+      CMT_PluginInstance * poInstance
+	= (CMT_PluginInstance *)Instances[lIndex];
+      poInstance->m_psDescriptor->m_fRun(Instances[lIndex], SampleCount);
+    }
+
+#ifdef CMT_INSTRUMENT
+  if (InstanceCount > 0) {
+    const unsigned long long llShare
+      = (readClock() - llStart) / InstanceCount;
+    for (lIndex = 0; lIndex < InstanceCount; lIndex++)
+      ((CMT_PluginInstance *)Instances[lIndex])
+	->m_poCounters->record(SampleCount, llShare);
+  }
+#endif
+
+  return bBatch ? 1 : 0;
+}
+
+/*****************************************************************************/
+
+int
+cmt_get_instance_statistics(const LADSPA_Handle       Instance,
+			    CMT_Instance_Statistics * Statistics) {
+#ifdef CMT_INSTRUMENT
+  ((const CMT_PluginInstance *)Instance)->m_poCounters->read(Statistics);
+  return 1;
+#else
+  memset(Statistics, 0, sizeof(CMT_Instance_Statistics));
+  return 0;
+#endif
+}
+
+/*****************************************************************************/
+
+/* For each piece of the block, each instance in turn has its chained
+   ports pointed at the signal and its other audio ports moved on to
+   the piece, is run, and has its ports put back, so the host's
+   connections are the same afterwards. The signal starts in Input,
+   moves between the two scratch buffers and ends in Output. */
+
+/** Whether a port is an audio port of the direction given. */
+static inline bool
+isAudioPort(const LADSPA_PortDescriptor iPort,
+	    const LADSPA_PortDescriptor iDirection) {
+  return LADSPA_IS_PORT_AUDIO(iPort) && (iPort & iDirection);
+}
+
+int
+cmt_run_chain(const LADSPA_Handle * Instances,
+	      unsigned long         InstanceCount,
+	      const LADSPA_Data *   Input,
+	      LADSPA_Data *         Output,
+	      unsigned long         SampleCount) {
+
+  unsigned long lStage, lPort;
+  for (lStage = 0; lStage < InstanceCount; lStage++) {
+    const CMT_Descriptor * psDescriptor
+      = ((CMT_PluginInstance *)Instances[lStage])->m_psDescriptor;
+    for (lPort = 0; lPort < psDescriptor->PortCount; lPort++)
+      if (isAudioPort(psDescriptor->PortDescriptors[lPort],
+		      LADSPA_PORT_OUTPUT))
+	break;
+    if (lPort == psDescriptor->PortCount)
+      return 0;
+  }
+
+  if (InstanceCount == 0) {
+    if (Output != Input)
+      memcpy(Output, Input, sizeof(LADSPA_Data) * SampleCount);
+    return 1;
+  }
+
+  DenormalGuard oGuard;
+  LADSPA_Data aafScratch[2][CMT_CHAIN_BLOCK_SIZE];
+
+  unsigned long lCount;
+  for (unsigned long lStart = 0; lStart < SampleCount; lStart += lCount) {
+
+    lCount = SampleCount - lStart;
+    if (lCount > CMT_CHAIN_BLOCK_SIZE)
+      lCount = CMT_CHAIN_BLOCK_SIZE;
+
+    /* The scratch buffer holding the signal, or -1 for Input. */
+    int iHeld = -1;
+    const LADSPA_Data * pfSignal = Input + lStart;
+
+    for (lStage = 0; lStage < InstanceCount; lStage++) {
+
+      CMT_PluginInstance * poInstance
+	= (CMT_PluginInstance *)Instances[lStage];
+      const CMT_Descriptor * psDescriptor = poInstance->m_psDescriptor;
+      const bool bInPlaceBroken
+	= LADSPA_IS_INPLACE_BROKEN(psDescriptor->Properties);
+
+      LADSPA_Data * pfOutput;
+      if (lStage + 1 == InstanceCount) {
+	pfOutput = Output + lStart;
+	if (bInPlaceBroken && pfSignal == pfOutput) {
+	  memcpy(aafScratch[0], pfSignal, sizeof(LADSPA_Data) * lCount);
+	  pfSignal = aafScratch[0];
+	}
+      }
+      else {
+	if (iHeld < 0 || bInPlaceBroken)
+	  iHeld = (iHeld == 0 ? 1 : 0);
+	pfOutput = aafScratch[iHeld];
+      }
+
+      LADSPA_Data ** ppfPorts = poInstance->m_ppfPorts;
+      LADSPA_Data * pfSavedInput = NULL;
+      LADSPA_Data * pfSavedOutput = NULL;
+      unsigned long lInputPort = psDescriptor->PortCount;
+      unsigned long lOutputPort = psDescriptor->PortCount;
+      for (lPort = 0; lPort < psDescriptor->PortCount; lPort++) {
+	const LADSPA_PortDescriptor iPort
+	  = psDescriptor->PortDescriptors[lPort];
+	if (lInputPort == psDescriptor->PortCount
+	    && isAudioPort(iPort, LADSPA_PORT_INPUT)) {
+	  lInputPort = lPort;
+	  pfSavedInput = ppfPorts[lPort];
+	  ppfPorts[lPort] = (LADSPA_Data *)pfSignal;
+	}
+	else if (lOutputPort == psDescriptor->PortCount
+		 && isAudioPort(iPort, LADSPA_PORT_OUTPUT)) {
+	  lOutputPort = lPort;
+	  pfSavedOutput = ppfPorts[lPort];
+	  ppfPorts[lPort] = pfOutput;
+	}
+	else if (LADSPA_IS_PORT_AUDIO(iPort))
+	  ppfPorts[lPort] += lStart;
+      }
+
+#ifdef CMT_INSTRUMENT
+      const unsigned long long llStart = readClock();
+#endif
+      psDescriptor->m_fRun(poInstance, lCount);
+#ifdef CMT_INSTRUMENT
+      poInstance->m_poCounters->record(lCount, readClock() - llStart);
+#endif
+
+      for (lPort = 0; lPort < psDescriptor->PortCount; lPort++)
+	if (lPort == lInputPort)
+	  ppfPorts[lPort] = pfSavedInput;
+	else if (lPort == lOutputPort)
+	  ppfPorts[lPort] = pfSavedOutput;
+	else if (LADSPA_IS_PORT_AUDIO(psDescriptor->PortDescriptors[lPort]))
+	  ppfPorts[lPort] -= lStart;
+
+      pfSignal = pfOutput;
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
 CMT_Descriptor::
 CMT_Descriptor(unsigned long                       lUniqueID,
 	       const char *                        pcLabel,
@@ -105,11 +462,16 @@ CMT_Descriptor(unsigned long                       lUniqueID,
   PortCount = 0;
   ImplementationData = poImplementationData;
 
-  instantiate = fInstantiate;
+  m_fInstantiate = fInstantiate;
+  m_fRun = fRun;
+  m_fRunAdding = fRunAdding;
+  m_fRunBatch = NULL;
+
+  instantiate = fInstantiate ? CMT_InstantiateInstance : NULL;
   connect_port = CMT_ConnectPort;
   activate = fActivate;
-  run = fRun;
-  run_adding = fRunAdding;
+  run = fRun ? CMT_Run : NULL;
+  run_adding = fRunAdding ? CMT_RunAdding : NULL;
   set_run_adding_gain = fSetRunAddingGain;
   deactivate = fDeactivate;
   cleanup = CMT_Cleanup;
@@ -128,41 +490,53 @@ addPort(LADSPA_PortDescriptor          iPortDescriptor,
 	LADSPA_Data                    fUpperBound) {
 
   unsigned long lOldPortCount = PortCount;
-  unsigned long lNewPortCount = PortCount + 1;
-
-  LADSPA_PortDescriptor * piOldPortDescriptors 
-    = (LADSPA_PortDescriptor *)PortDescriptors;
-  char ** ppcOldPortNames
-    = (char **)PortNames;
-  LADSPA_PortRangeHint * psOldPortRangeHints
-    = (LADSPA_PortRangeHint *)PortRangeHints;
 
   LADSPA_PortDescriptor * piNewPortDescriptors 
-    = new LADSPA_PortDescriptor[lNewPortCount];
+    = (LADSPA_PortDescriptor *)PortDescriptors;
   char ** ppcNewPortNames
-    = new char_ptr[lNewPortCount];
+    = (char **)PortNames;
   LADSPA_PortRangeHint * psNewPortRangeHints
-    = new LADSPA_PortRangeHint[lNewPortCount];
-
-  if (piNewPortDescriptors == NULL
-      || ppcNewPortNames == NULL 
-      || psNewPortRangeHints == NULL) {
-    /* Memory allocation failure that we cannot handle. Best option is
-       probably just to get out while the going is reasonably good. */
-    return;
-  }
+    = (LADSPA_PortRangeHint *)PortRangeHints;
 
-  for (unsigned long lPortIndex = 0;
-       lPortIndex < lOldPortCount; 
-       lPortIndex++) {
-    piNewPortDescriptors[lPortIndex] = piOldPortDescriptors[lPortIndex];
-    ppcNewPortNames[lPortIndex] = ppcOldPortNames[lPortIndex];
-    psNewPortRangeHints[lPortIndex] = psOldPortRangeHints[lPortIndex];
-  }
-  if (lOldPortCount > 0) {
-    delete [] piOldPortDescriptors;
-    delete [] ppcOldPortNames;
-    delete [] psOldPortRangeHints;
+  /* The arrays are allocated with room for a power of two ports, so
+     they are full (or not yet allocated) when the port count is zero
+     or a power of two. Doubling them then keeps the reallocation and
+     copying down while a descriptor is built. */
+  if ((lOldPortCount & (lOldPortCount - 1)) == 0) {
+
+    unsigned long lNewCapacity = lOldPortCount ? 2 * lOldPortCount : 1;
+
+    piNewPortDescriptors = new LADSPA_PortDescriptor[lNewCapacity];
+    ppcNewPortNames = new char_ptr[lNewCapacity];
+    psNewPortRangeHints = new LADSPA_PortRangeHint[lNewCapacity];
+
+    if (piNewPortDescriptors == NULL
+	|| ppcNewPortNames == NULL 
+	|| psNewPortRangeHints == NULL) {
+      /* Memory allocation failure that we cannot handle. Best option is
+	 probably just to get out while the going is reasonably good. */
+      return;
+    }
+
+    LADSPA_PortDescriptor * piOldPortDescriptors 
+      = (LADSPA_PortDescriptor *)PortDescriptors;
+    char ** ppcOldPortNames
+      = (char **)PortNames;
+    LADSPA_PortRangeHint * psOldPortRangeHints
+      = (LADSPA_PortRangeHint *)PortRangeHints;
+
+    for (unsigned long lPortIndex = 0;
+	 lPortIndex < lOldPortCount; 
+	 lPortIndex++) {
+      piNewPortDescriptors[lPortIndex] = piOldPortDescriptors[lPortIndex];
+      ppcNewPortNames[lPortIndex] = ppcOldPortNames[lPortIndex];
+      psNewPortRangeHints[lPortIndex] = psOldPortRangeHints[lPortIndex];
+    }
+    if (lOldPortCount > 0) {
+      delete [] piOldPortDescriptors;
+      delete [] ppcOldPortNames;
+      delete [] psOldPortRangeHints;
+    }
   }
 
   piNewPortDescriptors[lOldPortCount] = iPortDescriptor;
@@ -180,4 +554,111 @@ addPort(LADSPA_PortDescriptor          iPortDescriptor,
 
 /*****************************************************************************/
 
+/* Shared tables are few, so the registry is a simple list searched
+   under a lock. The mutex needs no run-time construction so is safe
+   to use from the static initialisers of other modules. */
+
+struct SharedTableEntry {
+  const char * m_pcKey;
+  int m_iParameter;
+  long m_lUsers;
+  CMT_SharedTable * m_poTable;
+  SharedTableEntry * m_poNext;
+};
+
+static std::mutex g_oSharedTableMutex;
+static SharedTableEntry * g_poSharedTables = NULL;
+
+/*****************************************************************************/
+
+const CMT_SharedTable *
+acquireSharedTable(const char *           pcKey,
+		   int                    iParameter,
+		   CMT_SharedTableFactory fFactory) {
+
+  std::lock_guard<std::mutex> oLock(g_oSharedTableMutex);
+
+  SharedTableEntry * poEntry;
+  for (poEntry = g_poSharedTables; poEntry; poEntry = poEntry->m_poNext)
+    if (poEntry->m_iParameter == iParameter
+	&& strcmp(poEntry->m_pcKey, pcKey) == 0) {
+      poEntry->m_lUsers++;
+      return poEntry->m_poTable;
+    }
+
+  poEntry = new SharedTableEntry;
+  poEntry->m_pcKey = pcKey;
+  poEntry->m_iParameter = iParameter;
+  poEntry->m_lUsers = 1;
+  poEntry->m_poTable = fFactory(iParameter);
+  poEntry->m_poNext = g_poSharedTables;
+  g_poSharedTables = poEntry;
+  return poEntry->m_poTable;
+}
+
+/*****************************************************************************/
+
+void
+releaseSharedTable(const char * pcKey, int iParameter) {
+
+  std::lock_guard<std::mutex> oLock(g_oSharedTableMutex);
+
+  SharedTableEntry ** ppoLink = &g_poSharedTables;
+  while (*ppoLink) {
+    SharedTableEntry * poEntry = *ppoLink;
+    if (poEntry->m_iParameter == iParameter
+	&& strcmp(poEntry->m_pcKey, pcKey) == 0) {
+      if (--poEntry->m_lUsers == 0) {
+	*ppoLink = poEntry->m_poNext;
+	delete poEntry->m_poTable;
+	delete poEntry;
+      }
+      return;
+    }
+    ppoLink = &poEntry->m_poNext;
+  }
+}
+
+/*****************************************************************************/
+
+/** Free any tables still held when the library is unloaded. */
+void
+finaliseSharedTables() {
+  std::lock_guard<std::mutex> oLock(g_oSharedTableMutex);
+  while (g_poSharedTables) {
+    SharedTableEntry * poEntry = g_poSharedTables;
+    g_poSharedTables = poEntry->m_poNext;
+    delete poEntry->m_poTable;
+    delete poEntry;
+  }
+}
+
+/*****************************************************************************/
+
+/* The block is over-allocated so the data can start on an aligned
+   boundary, with the start of the block stored just before it. */
+
+LADSPA_Data *
+allocateTableData(unsigned long lSampleCount) {
+  char * pcBlock = new char[lSampleCount * sizeof(LADSPA_Data)
+			    + sizeof(char *)
+			    + CMT_TABLE_ALIGNMENT];
+  uintptr_t iAddress = (uintptr_t)(pcBlock + sizeof(char *));
+  iAddress = ((iAddress + CMT_TABLE_ALIGNMENT - 1)
+	      & ~(uintptr_t)(CMT_TABLE_ALIGNMENT - 1));
+  char ** ppcData = (char **)iAddress;
+  ppcData[-1] = pcBlock;
+  return (LADSPA_Data *)ppcData;
+}
+
+/*****************************************************************************/
+
+void
+freeTableData(LADSPA_Data * pfData) {
+  if (pfData)
+    delete [] ((char **)pfData)[-1];
+}
+
+/*****************************************************************************/
+
 /* EOF */
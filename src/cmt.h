@@ -27,6 +27,7 @@
 
 /*****************************************************************************/
 
+#include "cmt_host.h"
 #include "ladspa_types.h"
 
 /*****************************************************************************/
@@ -41,6 +42,18 @@ public:
 
 /*****************************************************************************/
 
+/** Plugins that can run many of their instances in one pass supply
+    a function of this type through CMT_Descriptor::setRunBatch(). It
+    is called by cmt_run_batch() (see cmt_host.h) with InstanceCount
+    activated and connected instances of the plugin, and must leave
+    them as calling run() on each in turn would. */
+typedef void (*CMT_Run_Batch_Implementation)
+  (const LADSPA_Handle * Instances,
+   unsigned long         InstanceCount,
+   unsigned long         SampleCount);
+
+/*****************************************************************************/
+
 /** This structure describes a CMT LADSPA Plugin. It is a direct
     ancestor of the _LADSPA_Descriptor structure which allows direct
     casting. A rich constructor function is provided make it easier to
@@ -59,6 +72,30 @@ private:
   CMT_Descriptor(const CMT_Descriptor &) {
   }
 
+  /* The functions passed to the constructor. The LADSPA instantiate,
+     run and run_adding entries point at wrappers in cmt.cpp that call
+     these with denormals flushed to zero (see denormal.h). */
+  LADSPA_Instantiate_Function m_fInstantiate;
+  LADSPA_Run_Function         m_fRun;
+  LADSPA_Run_Adding_Function  m_fRunAdding;
+  CMT_Run_Batch_Implementation m_fRunBatch;
+
+  friend LADSPA_Handle CMT_InstantiateInstance(const LADSPA_Descriptor * Descriptor,
+					       unsigned long             SampleRate);
+  friend void CMT_Run(LADSPA_Handle Instance,
+		      unsigned long SampleCount);
+  friend void CMT_RunAdding(LADSPA_Handle Instance,
+			    unsigned long SampleCount);
+  friend int cmt_run_batch(const LADSPA_Descriptor * Descriptor,
+			   const LADSPA_Handle *     Instances,
+			   unsigned long             InstanceCount,
+			   unsigned long             SampleCount);
+  friend int cmt_run_chain(const LADSPA_Handle * Instances,
+			   unsigned long         InstanceCount,
+			   const LADSPA_Data *   Input,
+			   LADSPA_Data *         Output,
+			   unsigned long         SampleCount);
+
 public:
 
   ~CMT_Descriptor();
@@ -92,6 +129,13 @@ public:
 	       LADSPA_PortRangeHintDescriptor iHintDescriptor = 0,
 	       LADSPA_Data                    fLowerBound = 0,
 	       LADSPA_Data                    fUpperBound = 0);
+
+  /** Supply a function to run many instances at once, for hosts
+      using cmt_run_batch(). This is optional: without one the
+      instances are run one by one. */
+  void setRunBatch(CMT_Run_Batch_Implementation fRunBatch) {
+    m_fRunBatch = fRunBatch;
+  }
   
 };
 
@@ -111,6 +155,48 @@ void registerNewPluginDescriptor(CMT_Descriptor * psDescriptor);
 
 /*****************************************************************************/
 
+/** Lookup tables shared between plugins (wavetables, filter kernels
+    and so on) derive from this class and are held in a registry in
+    cmt.cpp. A table is built by its factory function when first
+    acquired and deleted when its last user releases it, so tables
+    cost nothing until a plugin needing them is instantiated. */
+class CMT_SharedTable {
+public:
+  virtual ~CMT_SharedTable() {
+  }
+};
+
+typedef CMT_SharedTable * (*CMT_SharedTableFactory)(int iParameter);
+
+/** Obtain the table registered under pcKey and iParameter, calling
+    fFactory(iParameter) to build it if no plugin holds it. pcKey
+    should be a string constant naming the kind of table, and
+    iParameter tells apart tables of that kind (a waveform number, for
+    instance). Each call must be matched by a call to
+    releaseSharedTable() with the same key and parameter. These are
+    thread-safe but may allocate and block, so should be called from
+    instantiate() and cleanup() (or constructors and destructors)
+    rather than run(). */
+const CMT_SharedTable * acquireSharedTable(const char *           pcKey,
+					   int                    iParameter,
+					   CMT_SharedTableFactory fFactory);
+void releaseSharedTable(const char * pcKey, int iParameter);
+
+/** Table data should be allocated with the following, which align it
+    to CMT_TABLE_ALIGNMENT bytes. This is a cache line, which is also
+    more than any of the SIMD code needs. */
+#define CMT_TABLE_ALIGNMENT 64
+LADSPA_Data * allocateTableData(unsigned long lSampleCount);
+void freeTableData(LADSPA_Data * pfData);
+
+/*****************************************************************************/
+
+/** Timing counters kept for each instance in builds with
+    CMT_INSTRUMENT defined, in cmt.cpp. */
+class CMT_InstanceCounters;
+
+/*****************************************************************************/
+
 /** This class is the baseclass of all CMT plugins. It provides
     functionality to handle LADSPA connect_port() and cleanup()
     requirements (as long as plugins have correctly written
@@ -135,7 +221,11 @@ protected:
   LADSPA_Data ** m_ppfPorts;
 
   CMT_PluginInstance(const unsigned long lPortCount)
-    : m_ppfPorts(new LADSPA_Data_ptr[lPortCount]) {
+    : m_ppfPorts(new LADSPA_Data_ptr[lPortCount]),
+      m_psDescriptor(nullptr) {
+#ifdef CMT_INSTRUMENT
+    m_poCounters = nullptr;
+#endif
   }
   virtual ~CMT_PluginInstance() {
     if (m_ppfPorts != nullptr){
@@ -144,10 +234,37 @@ protected:
     }
   }
 
+private:
+
+  /** Set on instantiation, used to find the plugin's run functions. */
+  const CMT_Descriptor * m_psDescriptor;
+
+#ifdef CMT_INSTRUMENT
+  /** Allocated on instantiation and freed on cleanup. */
+  CMT_InstanceCounters * m_poCounters;
+#endif
+
   friend void CMT_ConnectPort(LADSPA_Handle Instance,
 			      unsigned long Port,
 			      LADSPA_Data * DataLocation);
   friend void CMT_Cleanup(LADSPA_Handle Instance);
+  friend LADSPA_Handle CMT_InstantiateInstance(const LADSPA_Descriptor * Descriptor,
+					       unsigned long             SampleRate);
+  friend void CMT_Run(LADSPA_Handle Instance,
+		      unsigned long SampleCount);
+  friend void CMT_RunAdding(LADSPA_Handle Instance,
+			    unsigned long SampleCount);
+  friend int cmt_run_batch(const LADSPA_Descriptor * Descriptor,
+			   const LADSPA_Handle *     Instances,
+			   unsigned long             InstanceCount,
+			   unsigned long             SampleCount);
+  friend int cmt_get_instance_statistics(const LADSPA_Handle       Instance,
+					 CMT_Instance_Statistics * Statistics);
+  friend int cmt_run_chain(const LADSPA_Handle * Instances,
+			   unsigned long         InstanceCount,
+			   const LADSPA_Data *   Input,
+			   LADSPA_Data *         Output,
+			   unsigned long         SampleCount);
 
 };
 
@@ -0,0 +1,183 @@
+/* cmt_host.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_HOST_INCLUDED
+#define CMT_HOST_INCLUDED
+
+/*****************************************************************************/
+
+/* Optional extensions to the LADSPA interface. The CMT library
+   exports the functions below alongside ladspa_descriptor(), and this
+   header may be included by hosts (from C or C++) that want to use
+   them. A host should look each one up with dlsym() or similar and
+   carry on with plain LADSPA calls if it is missing, as it will be
+   from other libraries and older versions of CMT. Nothing here
+   changes the behaviour of the standard LADSPA entry points. */
+
+/*****************************************************************************/
+
+#include <ladspa.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+
+/* Batched Processing:
+   ------------------- */
+
+/** Run InstanceCount instances of the plugin Descriptor for
+    SampleCount samples, with the same result as calling run() on each
+    instance in turn. Each instance must have been instantiated from
+    Descriptor by this library, activated and had its ports connected
+    as usual. No instance may read a buffer that another instance in
+    the same call writes, so instances chained through their buffers
+    must go in separate calls.
+
+    Plugins with many small instances (oscillator banks, filter banks,
+    envelope followers) spend much of their time on the call and on
+    fetching scattered state. Where a plugin supports it, this runs
+    the instances side by side in vector lanes, so a bank of them
+    costs not much more than a few. Returns 1 if the plugin has a
+    batched implementation, or 0 if the instances were run one by
+    one; either way they have all been run. */
+int cmt_run_batch(const LADSPA_Descriptor * Descriptor,
+		  const LADSPA_Handle *     Instances,
+		  unsigned long             InstanceCount,
+		  unsigned long             SampleCount);
+
+typedef int (*CMT_Run_Batch_Function)(const LADSPA_Descriptor * Descriptor,
+				      const LADSPA_Handle *     Instances,
+				      unsigned long             InstanceCount,
+				      unsigned long             SampleCount);
+
+/*****************************************************************************/
+
+/* Instrumentation:
+   ---------------- */
+
+/** Block sizes are counted in bins by powers of two: bin n counts
+    blocks of 2^n to 2^(n + 1) - 1 samples (bin 0 also counts empty
+    blocks) and the last bin counts everything larger. */
+#define CMT_BLOCK_SIZE_BINS 16
+
+/** Counters for one plugin instance, gathered from its instantiation
+    onwards. Calls are those to run() and run_adding(); an instance
+    run through cmt_run_batch() counts one call for the batch and an
+    equal share of the batch's time. */
+typedef struct _CMT_Instance_Statistics {
+
+  unsigned long long CallCount;
+  unsigned long long SampleCount;
+
+  /** Time spent in the plugin, from a monotonic clock. */
+  unsigned long long Nanoseconds;
+  unsigned long long MaximumCallNanoseconds;
+
+  /** Calls that took longer than the audio they produced lasts at
+      the instance's sample rate. An instance doing this cannot run in
+      real time however lightly the host is loaded. */
+  unsigned long long OverrunCount;
+
+  unsigned long long BlockSizeCounts[CMT_BLOCK_SIZE_BINS];
+
+} CMT_Instance_Statistics;
+
+/** Copy the counters of Instance, which must be an instance from
+    this library, to *Statistics. This does not block and may be
+    called from any thread while the instance runs; the copy is a
+    consistent snapshot between two calls. Counters are only kept
+    when the library is built with instrumentation (make
+    INSTRUMENT=1). Otherwise *Statistics is cleared and this returns
+    0; it returns 1 when the counters are real. */
+int cmt_get_instance_statistics(const LADSPA_Handle       Instance,
+				CMT_Instance_Statistics * Statistics);
+
+typedef int (*CMT_Get_Instance_Statistics_Function)
+  (const LADSPA_Handle       Instance,
+   CMT_Instance_Statistics * Statistics);
+
+/*****************************************************************************/
+
+/* Kernel Dispatch:
+   ---------------- */
+
+/** The name of the set of block kernels the library chose when it
+    started, to suit the processor: "avx512", "avx2", "sse", "neon" or
+    "generic". If the environment variable CMT_KERNELS names another
+    set the processor supports, that set is used instead. The choice
+    is made on the first call to ladspa_descriptor() and applies to
+    every plugin in the library. */
+const char * cmt_get_kernel_set(void);
+
+typedef const char * (*CMT_Get_Kernel_Set_Function)(void);
+
+/*****************************************************************************/
+
+/* Plugin Chains:
+   -------------- */
+
+/** The longest piece of a block cmt_run_chain() runs at once. The
+    two pieces of signal in flight then fit in 2KB, well within the
+    first level cache. */
+#define CMT_CHAIN_BLOCK_SIZE 256
+
+/** Run a linear chain of InstanceCount instances from this library
+    for SampleCount samples, the first audio output of each feeding
+    the first audio input of the next. Input feeds the first instance
+    and the last writes Output, which may be the same buffer as Input
+    but must not otherwise overlap it. An instance with no audio input
+    ignores the signal reaching it. Each instance must have been
+    activated and had its other ports connected as usual, audio ports
+    to buffers of SampleCount samples. The chained ports need not be
+    connected, and their connections are left as they were.
+
+    Rather than each instance running over the whole block in turn,
+    the chain is run over pieces of up to CMT_CHAIN_BLOCK_SIZE samples
+    handed between two scratch buffers on the stack, so the signal
+    stays in cache however long the chain is and the host needs no
+    buffer between instances. Each instance writes its output over its
+    input unless its plugin has LADSPA_PROPERTY_INPLACE_BROKEN. The
+    result is that of running the instances one after another on the
+    whole block, for plugins whose output does not depend on block
+    size. Returns 0, having run nothing, if an instance has no audio
+    output, or 1 otherwise. */
+int cmt_run_chain(const LADSPA_Handle * Instances,
+		  unsigned long         InstanceCount,
+		  const LADSPA_Data *   Input,
+		  LADSPA_Data *         Output,
+		  unsigned long         SampleCount);
+
+typedef int (*CMT_Run_Chain_Function)(const LADSPA_Handle * Instances,
+				      unsigned long         InstanceCount,
+				      const LADSPA_Data *   Input,
+				      LADSPA_Data *         Output,
+				      unsigned long         SampleCount);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* EOF */
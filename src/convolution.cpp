@@ -0,0 +1,453 @@
+/* convolution.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+/* Convolution reverbs. LADSPA has no way to pass a recorded impulse
+   response to a plugin, so these synthesise a room response from the
+   control ports: noise decaying by 60dB over the decay time, low-pass
+   filtered more heavily as it decays so that high frequencies die
+   away first, after an optional pre-delay. Each channel has its own
+   noise so the stereo variant is decorrelated. Responses are built on
+   one of the library's worker threads (see worker.h) when the
+   controls change, and convolved by Convolver (see convolver.h) with
+   no added latency. */
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+/*****************************************************************************/
+
+#include "cmt.h"
+#include "convolver.h"
+#include "prng.h"
+#include "run_adding.h"
+#include "silence.h"
+#include "utils.h"
+#include "worker.h"
+
+/*****************************************************************************/
+
+#define CR_PORT_INPUT(c)  (c)
+#define CR_PORT_OUTPUT(c) (iChannels + (c))
+#define CR_PORT_DECAY     (2 * iChannels)
+#define CR_PORT_DAMPING   (2 * iChannels + 1)
+#define CR_PORT_PREDELAY  (2 * iChannels + 2)
+#define CR_PORT_DRY       (2 * iChannels + 3)
+#define CR_PORT_WET       (2 * iChannels + 4)
+#define CR_PORT_IDLE      (2 * iChannels + 5)
+#define CR_PORT_COUNT(c)  (2 * (c) + 6)
+
+#define CR_MIN_DECAY      0.1f
+#define CR_MAX_DECAY      8
+#define CR_DEFAULT_DECAY  1
+#define CR_MAX_PREDELAY   0.1f
+
+/** Damping lowers the cutoff of the response from CR_DAMPING_START Hz
+    at its start to as little as CR_DAMPING_END Hz at the end of the
+    decay. */
+#define CR_DAMPING_START  16000.0
+#define CR_DAMPING_END    250.0
+
+/*****************************************************************************/
+
+/** Room parameters as the worker builds from them. */
+struct RoomSettings {
+  LADSPA_Data m_fDecay;
+  LADSPA_Data m_fDamping;
+  LADSPA_Data m_fPreDelay;
+};
+
+/** Write the response for channel lChannel of a room to pfResponse,
+    returning its length (at most lMaximumLength). The response has
+    unit energy, so the wet level of a steady noise matches its dry
+    level. */
+static unsigned long
+synthesiseRoom(LADSPA_Data *        pfResponse,
+	       const unsigned long  lMaximumLength,
+	       const double         dSampleRate,
+	       const RoomSettings & rsSettings,
+	       const unsigned long  lChannel) {
+
+  unsigned long lPreDelay = (unsigned long)(rsSettings.m_fPreDelay
+					    * dSampleRate);
+  unsigned long lDecay = (unsigned long)(rsSettings.m_fDecay * dSampleRate);
+  if (lPreDelay > lMaximumLength)
+    lPreDelay = lMaximumLength;
+  if (lDecay > lMaximumLength - lPreDelay)
+    lDecay = lMaximumLength - lPreDelay;
+
+  memset(pfResponse, 0, sizeof(LADSPA_Data) * lPreDelay);
+
+  PRNG oRandom(lChannel + 1);
+  const double dEnvelopeStep = exp(-3 * log(10.0) / (lDecay + 1));
+  const double dCutoffFall
+    = rsSettings.m_fDamping * log(CR_DAMPING_START / CR_DAMPING_END);
+  const double dMaximumCutoff = 0.45 * dSampleRate;
+  double dEnvelope = 1;
+  double dFiltered = 0;
+  double dEnergy = 0;
+  LADSPA_Data * pfDecay = pfResponse + lPreDelay;
+  for (unsigned long lIndex = 0; lIndex < lDecay; lIndex++) {
+    double dCutoff
+      = CR_DAMPING_START * exp(-dCutoffFall * lIndex / lDecay);
+    if (dCutoff > dMaximumCutoff)
+      dCutoff = dMaximumCutoff;
+    const double dPole = exp(-2 * M_PI * dCutoff / dSampleRate);
+    dFiltered = (1 - dPole) * oRandom.nextBipolar() + dPole * dFiltered;
+    const double dValue = dFiltered * dEnvelope;
+    pfDecay[lIndex] = LADSPA_Data(dValue);
+    dEnergy += dValue * dValue;
+    dEnvelope *= dEnvelopeStep;
+  }
+
+  if (dEnergy > 0) {
+    const LADSPA_Data fScale = LADSPA_Data(1 / sqrt(dEnergy));
+    for (unsigned long lIndex = 0; lIndex < lDecay; lIndex++)
+      pfDecay[lIndex] *= fScale;
+  }
+
+  return lPreDelay + lDecay;
+}
+
+/*****************************************************************************/
+
+template <int iChannels>
+class ConvolutionReverb : public CMT_PluginInstance {
+private:
+
+  double m_dSampleRate;
+  Convolver * m_apoConvolver[iChannels];
+
+  LADSPA_Data m_fRunAddingGain;
+  SilenceTracker m_oSilence;
+  ParameterSmoother<> m_oDrySmoother;
+  ParameterSmoother<> m_oWetSmoother;
+
+  /** The settings last passed to the worker, and whether it is still
+      building them. Only one build is asked for at a time, so a sweep
+      of the controls rebuilds as often as the worker keeps up rather
+      than queueing a build for every block. */
+  RoomSettings m_sRequested;
+  bool m_bBuilding;
+
+  CMT_WorkerClient * m_poWorker;
+  LADSPA_Data * m_pfResponse;
+
+  LADSPA_Data m_aafInput[iChannels][CONVOLVER_BLOCK];
+  LADSPA_Data m_afWet[CONVOLVER_BLOCK];
+
+  /** Build and load a response for every channel. Runs on the worker
+      thread, apart from the first call from the constructor. */
+  void buildRoom(const RoomSettings & rsSettings) {
+    for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+      const unsigned long lLength
+	= synthesiseRoom(m_pfResponse,
+			 m_apoConvolver[iChannel]->getMaximumLength(),
+			 m_dSampleRate,
+			 rsSettings,
+			 iChannel);
+      m_apoConvolver[iChannel]->loadResponse(m_pfResponse, lLength);
+    }
+  }
+
+  /** Work function for the worker, with the settings in the job's
+      values. The job is posted back to say the room is built. */
+  static void
+  buildRoomJob(void *               pvReverb,
+	       const CMT_WorkItem & rsJob,
+	       CMT_WorkerClient &   roClient) {
+    RoomSettings sSettings;
+    sSettings.m_fDecay = rsJob.m_afValue[0];
+    sSettings.m_fDamping = rsJob.m_afValue[1];
+    sSettings.m_fPreDelay = rsJob.m_afValue[2];
+    ((ConvolutionReverb *)pvReverb)->buildRoom(sSettings);
+    roClient.postResult(rsJob);
+  }
+
+  /** Pass any change of the room controls to the worker once it has
+      finished the last build. */
+  void requestRoom() {
+    CMT_WorkItem sJob;
+    while (m_poWorker->takeResult(sJob))
+      m_bBuilding = false;
+    if (m_bBuilding)
+      return;
+
+    RoomSettings sSettings;
+    sSettings.m_fDecay = BOUNDED(*m_ppfPorts[CR_PORT_DECAY],
+				 CR_MIN_DECAY,
+				 CR_MAX_DECAY);
+    sSettings.m_fDamping = BOUNDED(*m_ppfPorts[CR_PORT_DAMPING], 0, 1);
+    sSettings.m_fPreDelay = BOUNDED(*m_ppfPorts[CR_PORT_PREDELAY],
+				    0,
+				    CR_MAX_PREDELAY);
+    if (sSettings.m_fDecay == m_sRequested.m_fDecay
+	&& sSettings.m_fDamping == m_sRequested.m_fDamping
+	&& sSettings.m_fPreDelay == m_sRequested.m_fPreDelay)
+      return;
+
+    sJob.m_lType = 0;
+    sJob.m_pvData = NULL;
+    sJob.m_afValue[0] = sSettings.m_fDecay;
+    sJob.m_afValue[1] = sSettings.m_fDamping;
+    sJob.m_afValue[2] = sSettings.m_fPreDelay;
+    sJob.m_afValue[3] = 0;
+    if (m_poWorker->postJob(sJob)) {
+      m_sRequested = sSettings;
+      m_bBuilding = true;
+    }
+  }
+
+public:
+
+  ConvolutionReverb(const LADSPA_Descriptor *,
+		    unsigned long lSampleRate)
+    : CMT_PluginInstance(CR_PORT_COUNT(iChannels)),
+      m_dSampleRate(lSampleRate),
+      m_fRunAddingGain(1),
+      m_oDrySmoother(lSampleRate),
+      m_oWetSmoother(lSampleRate),
+      m_bBuilding(false) {
+
+    const unsigned long lMaximumLength
+      = (unsigned long)((CR_MAX_DECAY + CR_MAX_PREDELAY) * lSampleRate) + 1;
+    for (int iChannel = 0; iChannel < iChannels; iChannel++)
+      m_apoConvolver[iChannel] = new Convolver(lMaximumLength);
+    m_pfResponse = new LADSPA_Data[lMaximumLength];
+
+    /* Start with the room for the default control values, so there is
+       reverb from the first block. */
+    m_sRequested.m_fDecay = CR_DEFAULT_DECAY;
+    m_sRequested.m_fDamping = 0.5f;
+    m_sRequested.m_fPreDelay = 0;
+    buildRoom(m_sRequested);
+
+    m_poWorker = new CMT_WorkerClient(buildRoomJob, this);
+  }
+
+  ~ConvolutionReverb() {
+    delete m_poWorker;
+    for (int iChannel = 0; iChannel < iChannels; iChannel++)
+      delete m_apoConvolver[iChannel];
+    delete [] m_pfResponse;
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    ConvolutionReverb * poReverb = (ConvolutionReverb *)Instance;
+    for (int iChannel = 0; iChannel < iChannels; iChannel++)
+      poReverb->m_apoConvolver[iChannel]->reset();
+    poReverb->m_oSilence.reset();
+    poReverb->m_oDrySmoother.reset();
+    poReverb->m_oWetSmoother.reset();
+  }
+
+  static void
+  setRunAddingGain(LADSPA_Handle Instance,
+		   LADSPA_Data   Gain) {
+    ((ConvolutionReverb *)Instance)->m_fRunAddingGain = Gain;
+  }
+
+  template <OutputFunction write_output>
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+
+    ConvolutionReverb * poReverb = (ConvolutionReverb *)Instance;
+    LADSPA_Data ** ppfPorts = poReverb->m_ppfPorts;
+
+    poReverb->requestRoom();
+    poReverb->m_oDrySmoother.setTarget(*ppfPorts[CR_PORT_DRY]);
+    poReverb->m_oWetSmoother.setTarget(*ppfPorts[CR_PORT_WET]);
+
+    /* Nothing from before the history length can reach the output,
+       so once the input has been silent that long the convolution can
+       stop. */
+    SilenceTracker & roSilence = poReverb->m_oSilence;
+    const unsigned long lTailLength
+      = poReverb->m_apoConvolver[0]->getHistoryLength();
+    bool bSilent = true;
+    for (int iChannel = 0; iChannel < iChannels && bSilent; iChannel++)
+      bSilent = isSilent(ppfPorts[CR_PORT_INPUT(iChannel)], SampleCount);
+    if (bSilent && roSilence.isIdle(lTailLength)) {
+      if (!is_adding<write_output>())
+	for (int iChannel = 0; iChannel < iChannels; iChannel++)
+	  memset(ppfPorts[CR_PORT_OUTPUT(iChannel)],
+		 0,
+		 sizeof(LADSPA_Data) * SampleCount);
+      poReverb->m_oDrySmoother.skip(SampleCount);
+      poReverb->m_oWetSmoother.skip(SampleCount);
+      roSilence.update(true, SampleCount);
+      *ppfPorts[CR_PORT_IDLE] = 1;
+      return;
+    }
+
+    /* Inputs are copied a chunk at a time before any output is
+       written, so outputs may share any input buffer. */
+    LADSPA_Data afDry[CONVOLVER_BLOCK];
+    LADSPA_Data afWetGain[CONVOLVER_BLOCK];
+    for (unsigned long lStart = 0; lStart < SampleCount; ) {
+
+      unsigned long lCount = SampleCount - lStart;
+      if (lCount > CONVOLVER_BLOCK)
+	lCount = CONVOLVER_BLOCK;
+
+      for (int iChannel = 0; iChannel < iChannels; iChannel++)
+	memcpy(poReverb->m_aafInput[iChannel],
+	       ppfPorts[CR_PORT_INPUT(iChannel)] + lStart,
+	       sizeof(LADSPA_Data) * lCount);
+      for (unsigned long lIndex = 0; lIndex < lCount; lIndex++) {
+	afDry[lIndex] = poReverb->m_oDrySmoother.next();
+	afWetGain[lIndex] = poReverb->m_oWetSmoother.next();
+      }
+
+      for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+	const LADSPA_Data * pfInput = poReverb->m_aafInput[iChannel];
+	LADSPA_Data * pfOutput = ppfPorts[CR_PORT_OUTPUT(iChannel)] + lStart;
+	poReverb->m_apoConvolver[iChannel]->process(pfInput,
+						    poReverb->m_afWet,
+						    lCount);
+	for (unsigned long lIndex = 0; lIndex < lCount; lIndex++)
+	  write_output(pfOutput,
+		       (afDry[lIndex] * pfInput[lIndex]
+			+ afWetGain[lIndex] * poReverb->m_afWet[lIndex]),
+		       poReverb->m_fRunAddingGain);
+      }
+
+      lStart += lCount;
+    }
+
+    roSilence.update(bSilent, SampleCount);
+    if (roSilence.isQuietFor(lTailLength))
+      roSilence.enterIdle();
+    *ppfPorts[CR_PORT_IDLE] = 0;
+  }
+
+};
+
+/*****************************************************************************/
+
+template <int iChannels>
+static void
+registerConvolutionReverb(const unsigned long lUniqueID,
+			  const char *        pcLabel,
+			  const char *        pcName) {
+
+  CMT_Descriptor * psDescriptor = new CMT_Descriptor
+    (lUniqueID,
+     pcLabel,
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+     pcName,
+     CMT_MAKER("Richard W.E. Furse"),
+     CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+     NULL,
+     CMT_Instantiate<ConvolutionReverb<iChannels> >,
+     ConvolutionReverb<iChannels>::activate,
+     ConvolutionReverb<iChannels>::template run<write_output_normal>,
+     ConvolutionReverb<iChannels>::template run<write_output_adding>,
+     ConvolutionReverb<iChannels>::setRunAddingGain,
+     NULL);
+
+  static const char * apcChannel[] = { "Left", "Right" };
+  char acPortName[100];
+  for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+    if (iChannels == 1)
+      strcpy(acPortName, "Input");
+    else
+      sprintf(acPortName, "Input (%s)", apcChannel[iChannel]);
+    psDescriptor->addPort(LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+			  acPortName);
+  }
+  for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+    if (iChannels == 1)
+      strcpy(acPortName, "Output");
+    else
+      sprintf(acPortName, "Output (%s)", apcChannel[iChannel]);
+    psDescriptor->addPort(LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+			  acPortName);
+  }
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Decay Time (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_1),
+     CR_MIN_DECAY,
+     CR_MAX_DECAY);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "High Frequency Damping",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_MIDDLE),
+     0,
+     1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Pre-Delay (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_MINIMUM),
+     0,
+     CR_MAX_PREDELAY);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Dry Level",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_MAXIMUM),
+     0,
+     1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Wet Level",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_LOW),
+     0,
+     1);
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+     SILENCE_IDLE_PORT_NAME,
+     SILENCE_IDLE_PORT_HINTS);
+
+  registerNewPluginDescriptor(psDescriptor);
+}
+
+/*****************************************************************************/
+
+void
+initialise_convolution() {
+  registerConvolutionReverb<1>(2022,
+			       "convolution_reverb",
+			       "Convolution Reverb (Mono)");
+  registerConvolutionReverb<2>(2023,
+			       "convolution_reverb_stereo",
+			       "Convolution Reverb (Stereo)");
+}
+
+/*****************************************************************************/
+
+/* EOF */
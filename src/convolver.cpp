@@ -0,0 +1,455 @@
+/* convolver.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+#include <cstring>
+
+/*****************************************************************************/
+
+#include "convolver.h"
+#include "dispatch.h"
+
+/*****************************************************************************/
+
+/** Body partitions, covering taps from CONVOLVER_BLOCK up to the start
+    of the tail. */
+#define CONVOLVER_BODY_PARTITIONS					\
+  ((2 * CONVOLVER_TAIL_BLOCK - CONVOLVER_BLOCK) / CONVOLVER_BLOCK)
+
+/** Body blocks in each tail block. The first of these in each period
+    transforms the tail input, the last but one transforms the result
+    back and the rest share the multiplication. */
+#define CONVOLVER_TAIL_STEPS (CONVOLVER_TAIL_BLOCK / CONVOLVER_BLOCK)
+#define CONVOLVER_MULTIPLY_STEPS (CONVOLVER_TAIL_STEPS - 2)
+
+/*****************************************************************************/
+
+/** A response cut up and transformed for Convolver. Spectra are
+    scaled by the inverse of their transform size so that the inverse
+    transforms need no scaling. */
+class ConvolverResponse {
+public:
+
+  /** The head taps in reverse order, for dotProduct(). */
+  LADSPA_Data m_afHead[CONVOLVER_BLOCK];
+
+  LADSPA_Data * m_pfBodyReal;
+  LADSPA_Data * m_pfBodyImaginary;
+
+  unsigned long m_lTailPartitions;
+  LADSPA_Data * m_pfTailReal;
+  LADSPA_Data * m_pfTailImaginary;
+
+  ConvolverResponse(const unsigned long lMaximumTailPartitions)
+    : m_pfBodyReal(new LADSPA_Data[CONVOLVER_BODY_PARTITIONS
+				   * CONVOLVER_BLOCK]),
+      m_pfBodyImaginary(new LADSPA_Data[CONVOLVER_BODY_PARTITIONS
+					* CONVOLVER_BLOCK]),
+      m_lTailPartitions(0),
+      m_pfTailReal(new LADSPA_Data[lMaximumTailPartitions
+				   * CONVOLVER_TAIL_BLOCK]),
+      m_pfTailImaginary(new LADSPA_Data[lMaximumTailPartitions
+					* CONVOLVER_TAIL_BLOCK]) {
+  }
+
+  ~ConvolverResponse() {
+    delete [] m_pfBodyReal;
+    delete [] m_pfBodyImaginary;
+    delete [] m_pfTailReal;
+    delete [] m_pfTailImaginary;
+  }
+
+};
+
+/*****************************************************************************/
+
+Convolver::Convolver(const unsigned long lMaximumLength)
+  : m_oBodyFFT(2 * CONVOLVER_BLOCK),
+    m_oTailFFT(2 * CONVOLVER_TAIL_BLOCK),
+    m_lMaximumLength(lMaximumLength),
+    m_iFreeCount(0) {
+
+  m_lMaximumTailPartitions = 0;
+  if (lMaximumLength > 2 * CONVOLVER_TAIL_BLOCK)
+    m_lMaximumTailPartitions
+      = ((lMaximumLength - 2 * CONVOLVER_TAIL_BLOCK + CONVOLVER_TAIL_BLOCK - 1)
+	 / CONVOLVER_TAIL_BLOCK);
+
+  m_pfLoadBuffer = new LADSPA_Data[2 * CONVOLVER_TAIL_BLOCK];
+
+  m_pfBodyHistoryReal
+    = new LADSPA_Data[CONVOLVER_BODY_PARTITIONS * CONVOLVER_BLOCK];
+  m_pfBodyHistoryImaginary
+    = new LADSPA_Data[CONVOLVER_BODY_PARTITIONS * CONVOLVER_BLOCK];
+
+  m_pfTailInput = new LADSPA_Data[2 * CONVOLVER_TAIL_BLOCK];
+  m_pfTailOutput = new LADSPA_Data[CONVOLVER_TAIL_BLOCK];
+  m_pfTailNextOutput = new LADSPA_Data[CONVOLVER_TAIL_BLOCK];
+  m_pfTailHistoryReal
+    = new LADSPA_Data[m_lMaximumTailPartitions * CONVOLVER_TAIL_BLOCK];
+  m_pfTailHistoryImaginary
+    = new LADSPA_Data[m_lMaximumTailPartitions * CONVOLVER_TAIL_BLOCK];
+  m_pfTailAccumulatorReal = new LADSPA_Data[CONVOLVER_TAIL_BLOCK];
+  m_pfTailAccumulatorImaginary = new LADSPA_Data[CONVOLVER_TAIL_BLOCK];
+  m_pfTailTransform = new LADSPA_Data[2 * CONVOLVER_TAIL_BLOCK];
+
+  for (int iResponse = 0; iResponse < 3; iResponse++)
+    m_apoResponses[iResponse]
+      = new ConvolverResponse(m_lMaximumTailPartitions);
+
+  /* Start silent. */
+  m_poCurrent = m_apoResponses[0];
+  prepare(m_poCurrent, NULL, 0);
+  m_psNext.store(NULL);
+  m_psRetired.store(NULL);
+  m_apoFree[m_iFreeCount++] = m_apoResponses[1];
+  m_apoFree[m_iFreeCount++] = m_apoResponses[2];
+
+  reset();
+}
+
+/*****************************************************************************/
+
+Convolver::~Convolver() {
+  for (int iResponse = 0; iResponse < 3; iResponse++)
+    delete m_apoResponses[iResponse];
+  delete [] m_pfLoadBuffer;
+  delete [] m_pfBodyHistoryReal;
+  delete [] m_pfBodyHistoryImaginary;
+  delete [] m_pfTailInput;
+  delete [] m_pfTailOutput;
+  delete [] m_pfTailNextOutput;
+  delete [] m_pfTailHistoryReal;
+  delete [] m_pfTailHistoryImaginary;
+  delete [] m_pfTailAccumulatorReal;
+  delete [] m_pfTailAccumulatorImaginary;
+  delete [] m_pfTailTransform;
+}
+
+/*****************************************************************************/
+
+void
+Convolver::reset() {
+
+  memset(m_afBodyInput, 0, sizeof(m_afBodyInput));
+  memset(m_afBodyOutput, 0, sizeof(m_afBodyOutput));
+  memset(m_pfBodyHistoryReal,
+	 0,
+	 sizeof(LADSPA_Data) * CONVOLVER_BODY_PARTITIONS * CONVOLVER_BLOCK);
+  memset(m_pfBodyHistoryImaginary,
+	 0,
+	 sizeof(LADSPA_Data) * CONVOLVER_BODY_PARTITIONS * CONVOLVER_BLOCK);
+  m_lPosition = 0;
+  m_lBodyNewest = 0;
+
+  const unsigned long lTailHistorySize
+    = m_lMaximumTailPartitions * CONVOLVER_TAIL_BLOCK;
+  memset(m_pfTailInput, 0, sizeof(LADSPA_Data) * 2 * CONVOLVER_TAIL_BLOCK);
+  memset(m_pfTailOutput, 0, sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  memset(m_pfTailNextOutput, 0, sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  memset(m_pfTailHistoryReal, 0, sizeof(LADSPA_Data) * lTailHistorySize);
+  memset(m_pfTailHistoryImaginary, 0, sizeof(LADSPA_Data) * lTailHistorySize);
+  memset(m_pfTailAccumulatorReal,
+	 0,
+	 sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  memset(m_pfTailAccumulatorImaginary,
+	 0,
+	 sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  m_lTailPosition = 0;
+  m_lTailNewest = 0;
+}
+
+/*****************************************************************************/
+
+void
+Convolver::prepare(ConvolverResponse * poResponse,
+		   const LADSPA_Data * pfResponse,
+		   const unsigned long lLength) {
+
+  for (unsigned long lTap = 0; lTap < CONVOLVER_BLOCK; lTap++)
+    poResponse->m_afHead[CONVOLVER_BLOCK - 1 - lTap]
+      = (lTap < lLength ? pfResponse[lTap] : 0);
+
+  /* Each partition is transformed with as many zeros after it, so the
+     second half of each circular convolution is clean. */
+  LADSPA_Data * pfBuffer = m_pfLoadBuffer;
+  const LADSPA_Data fBodyScale = LADSPA_Data(1.0 / (2 * CONVOLVER_BLOCK));
+  for (unsigned long lPartition = 0;
+       lPartition < CONVOLVER_BODY_PARTITIONS;
+       lPartition++) {
+    const unsigned long lStart = (lPartition + 1) * CONVOLVER_BLOCK;
+    for (unsigned long lTap = 0; lTap < CONVOLVER_BLOCK; lTap++)
+      pfBuffer[lTap]
+	= (lStart + lTap < lLength
+	   ? pfResponse[lStart + lTap] * fBodyScale
+	   : 0);
+    memset(pfBuffer + CONVOLVER_BLOCK,
+	   0,
+	   sizeof(LADSPA_Data) * CONVOLVER_BLOCK);
+    m_oBodyFFT.forward(pfBuffer,
+		       poResponse->m_pfBodyReal + lPartition * CONVOLVER_BLOCK,
+		       (poResponse->m_pfBodyImaginary
+			+ lPartition * CONVOLVER_BLOCK));
+  }
+
+  unsigned long lTailPartitions = 0;
+  if (lLength > 2 * CONVOLVER_TAIL_BLOCK)
+    lTailPartitions
+      = ((lLength - 2 * CONVOLVER_TAIL_BLOCK + CONVOLVER_TAIL_BLOCK - 1)
+	 / CONVOLVER_TAIL_BLOCK);
+  if (lTailPartitions > m_lMaximumTailPartitions)
+    lTailPartitions = m_lMaximumTailPartitions;
+
+  const LADSPA_Data fTailScale
+    = LADSPA_Data(1.0 / (2 * CONVOLVER_TAIL_BLOCK));
+  for (unsigned long lPartition = 0;
+       lPartition < lTailPartitions;
+       lPartition++) {
+    const unsigned long lStart
+      = (lPartition + 2) * CONVOLVER_TAIL_BLOCK;
+    for (unsigned long lTap = 0; lTap < CONVOLVER_TAIL_BLOCK; lTap++)
+      pfBuffer[lTap]
+	= (lStart + lTap < lLength
+	   ? pfResponse[lStart + lTap] * fTailScale
+	   : 0);
+    memset(pfBuffer + CONVOLVER_TAIL_BLOCK,
+	   0,
+	   sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+    m_oTailFFT.forward(pfBuffer,
+		       (poResponse->m_pfTailReal
+			+ lPartition * CONVOLVER_TAIL_BLOCK),
+		       (poResponse->m_pfTailImaginary
+			+ lPartition * CONVOLVER_TAIL_BLOCK));
+  }
+  poResponse->m_lTailPartitions = lTailPartitions;
+}
+
+/*****************************************************************************/
+
+void
+Convolver::loadResponse(const LADSPA_Data * pfResponse,
+			const unsigned long lLength) {
+
+  /* Collecting the retired response first also clears the way for
+     process() to take up the one published below. */
+  ConvolverResponse * poResponse
+    = m_psRetired.exchange(NULL, std::memory_order_acquire);
+  if (poResponse)
+    m_apoFree[m_iFreeCount++] = poResponse;
+  if (m_iFreeCount == 0)
+    poResponse = m_psNext.exchange(NULL, std::memory_order_acquire);
+  else
+    poResponse = m_apoFree[--m_iFreeCount];
+
+  prepare(poResponse,
+	  pfResponse,
+	  lLength < m_lMaximumLength ? lLength : m_lMaximumLength);
+
+  ConvolverResponse * poReplaced
+    = m_psNext.exchange(poResponse, std::memory_order_acq_rel);
+  if (poReplaced)
+    m_apoFree[m_iFreeCount++] = poReplaced;
+}
+
+/*****************************************************************************/
+
+/* Called at the start of each tail block, so both stages switch
+   together. A response is only taken up once the loader has collected
+   the last one retired. */
+void
+Convolver::adoptNextResponse() {
+  if (m_psRetired.load(std::memory_order_relaxed) != NULL)
+    return;
+  ConvolverResponse * poNext
+    = m_psNext.exchange(NULL, std::memory_order_acquire);
+  if (poNext) {
+    m_psRetired.store(m_poCurrent, std::memory_order_release);
+    m_poCurrent = poNext;
+  }
+}
+
+/*****************************************************************************/
+
+/* Once a body block is complete, the body's contribution to the next
+   block depends only on this and earlier blocks of input: partition p
+   (applying taps (p + 1) * CONVOLVER_BLOCK onwards) meets the input
+   spectrum from p blocks back. */
+void
+Convolver::endBodyBlock() {
+
+  m_lBodyNewest++;
+  if (m_lBodyNewest == CONVOLVER_BODY_PARTITIONS)
+    m_lBodyNewest = 0;
+  m_oBodyFFT.forward(m_afBodyInput,
+		     m_pfBodyHistoryReal + m_lBodyNewest * CONVOLVER_BLOCK,
+		     (m_pfBodyHistoryImaginary
+		      + m_lBodyNewest * CONVOLVER_BLOCK));
+
+  memset(m_afBodyAccumulatorReal, 0, sizeof(m_afBodyAccumulatorReal));
+  memset(m_afBodyAccumulatorImaginary,
+	 0,
+	 sizeof(m_afBodyAccumulatorImaginary));
+  unsigned long lHistory = m_lBodyNewest;
+  for (unsigned long lPartition = 0;
+       lPartition < CONVOLVER_BODY_PARTITIONS;
+       lPartition++) {
+    dispatchMultiplyAccumulateSpectrum
+      (m_afBodyAccumulatorReal,
+       m_afBodyAccumulatorImaginary,
+       m_pfBodyHistoryReal + lHistory * CONVOLVER_BLOCK,
+       m_pfBodyHistoryImaginary + lHistory * CONVOLVER_BLOCK,
+       m_poCurrent->m_pfBodyReal + lPartition * CONVOLVER_BLOCK,
+       m_poCurrent->m_pfBodyImaginary + lPartition * CONVOLVER_BLOCK,
+       CONVOLVER_BLOCK);
+    lHistory = (lHistory ? lHistory : CONVOLVER_BODY_PARTITIONS) - 1;
+  }
+  m_oBodyFFT.inverse(m_afBodyAccumulatorReal,
+		     m_afBodyAccumulatorImaginary,
+		     m_afBodyTransform);
+  memcpy(m_afBodyOutput,
+	 m_afBodyTransform + CONVOLVER_BLOCK,
+	 sizeof(m_afBodyOutput));
+
+  memcpy(m_afBodyInput,
+	 m_afBodyInput + CONVOLVER_BLOCK,
+	 sizeof(LADSPA_Data) * CONVOLVER_BLOCK);
+}
+
+/*****************************************************************************/
+
+/* The tail's work for each period, done a body block at a time. The
+   result for a tail block applies the tail partitions to input up to
+   the end of the block before, which is complete by the start of the
+   period the result is worked out in. */
+void
+Convolver::stepTail() {
+
+  const unsigned long lStep = m_lTailPosition / CONVOLVER_BLOCK;
+  const unsigned long lPartitions = m_poCurrent->m_lTailPartitions;
+
+  if (lStep <= CONVOLVER_MULTIPLY_STEPS) {
+    const unsigned long lFirst
+      = (lStep - 1) * lPartitions / CONVOLVER_MULTIPLY_STEPS;
+    const unsigned long lLast
+      = lStep * lPartitions / CONVOLVER_MULTIPLY_STEPS;
+    for (unsigned long lPartition = lFirst;
+	 lPartition < lLast;
+	 lPartition++) {
+      const unsigned long lHistory
+	= ((m_lTailNewest + m_lMaximumTailPartitions - lPartition)
+	   % m_lMaximumTailPartitions);
+      dispatchMultiplyAccumulateSpectrum
+	(m_pfTailAccumulatorReal,
+	 m_pfTailAccumulatorImaginary,
+	 m_pfTailHistoryReal + lHistory * CONVOLVER_TAIL_BLOCK,
+	 m_pfTailHistoryImaginary + lHistory * CONVOLVER_TAIL_BLOCK,
+	 m_poCurrent->m_pfTailReal + lPartition * CONVOLVER_TAIL_BLOCK,
+	 m_poCurrent->m_pfTailImaginary + lPartition * CONVOLVER_TAIL_BLOCK,
+	 CONVOLVER_TAIL_BLOCK);
+    }
+  }
+  else if (lStep == CONVOLVER_TAIL_STEPS - 1) {
+    m_oTailFFT.inverse(m_pfTailAccumulatorReal,
+		       m_pfTailAccumulatorImaginary,
+		       m_pfTailTransform);
+    memcpy(m_pfTailNextOutput,
+	   m_pfTailTransform + CONVOLVER_TAIL_BLOCK,
+	   sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  }
+  else {
+    /* End of the period. */
+    LADSPA_Data * pfSwap = m_pfTailOutput;
+    m_pfTailOutput = m_pfTailNextOutput;
+    m_pfTailNextOutput = pfSwap;
+    m_lTailPosition = 0;
+
+    if (m_lMaximumTailPartitions > 0) {
+      m_lTailNewest++;
+      if (m_lTailNewest == m_lMaximumTailPartitions)
+	m_lTailNewest = 0;
+      m_oTailFFT.forward(m_pfTailInput,
+			 m_pfTailHistoryReal
+			 + m_lTailNewest * CONVOLVER_TAIL_BLOCK,
+			 m_pfTailHistoryImaginary
+			 + m_lTailNewest * CONVOLVER_TAIL_BLOCK);
+    }
+    memcpy(m_pfTailInput,
+	   m_pfTailInput + CONVOLVER_TAIL_BLOCK,
+	   sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+    memset(m_pfTailAccumulatorReal,
+	   0,
+	   sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+    memset(m_pfTailAccumulatorImaginary,
+	   0,
+	   sizeof(LADSPA_Data) * CONVOLVER_TAIL_BLOCK);
+  }
+}
+
+/*****************************************************************************/
+
+void
+Convolver::process(const LADSPA_Data * pfInput,
+		   LADSPA_Data *       pfOutput,
+		   unsigned long       lSampleCount) {
+
+  while (lSampleCount > 0) {
+
+    if (m_lTailPosition == 0)
+      adoptNextResponse();
+
+    unsigned long lCount = CONVOLVER_BLOCK - m_lPosition;
+    if (lCount > lSampleCount)
+      lCount = lSampleCount;
+
+    LADSPA_Data * pfBlock = m_afBodyInput + CONVOLVER_BLOCK + m_lPosition;
+    memcpy(pfBlock, pfInput, sizeof(LADSPA_Data) * lCount);
+    memcpy(m_pfTailInput + CONVOLVER_TAIL_BLOCK + m_lTailPosition,
+	   pfInput,
+	   sizeof(LADSPA_Data) * lCount);
+
+    const LADSPA_Data * pfHead = m_poCurrent->m_afHead;
+    const LADSPA_Data * pfBodyOutput = m_afBodyOutput + m_lPosition;
+    const LADSPA_Data * pfTailOutput = m_pfTailOutput + m_lTailPosition;
+    for (unsigned long lIndex = 0; lIndex < lCount; lIndex++)
+      pfOutput[lIndex]
+	= (dispatchDotProduct(pfBlock + lIndex + 1 - CONVOLVER_BLOCK,
+			      pfHead,
+			      CONVOLVER_BLOCK)
+	   + pfBodyOutput[lIndex]
+	   + pfTailOutput[lIndex]);
+
+    pfInput += lCount;
+    pfOutput += lCount;
+    lSampleCount -= lCount;
+    m_lPosition += lCount;
+    m_lTailPosition += lCount;
+
+    if (m_lPosition == CONVOLVER_BLOCK) {
+      m_lPosition = 0;
+      endBodyBlock();
+      stepTail();
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,179 @@
+/* convolver.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_CONVOLVER_INCLUDED
+#define CMT_CONVOLVER_INCLUDED
+
+/*****************************************************************************/
+
+/* Zero latency convolution with long impulse responses. The response
+   is split into three parts, each convolved in the cheapest way that
+   meets its deadline:
+
+     The head, the first CONVOLVER_BLOCK taps, is applied directly to
+     each sample as it arrives, so the output has no latency.
+
+     The body, up to 2 * CONVOLVER_TAIL_BLOCK taps, is split into
+     partitions of CONVOLVER_BLOCK taps convolved by FFT once every
+     CONVOLVER_BLOCK samples (uniformly partitioned overlap-save).
+
+     The tail, the rest, is split into partitions of
+     CONVOLVER_TAIL_BLOCK taps. As it starts two tail blocks in, the
+     result for each tail block is not needed until a whole block
+     after its input is complete, so its work is spread evenly over
+     the body blocks of that period rather than landing on one call.
+
+   Input spectra are kept in preallocated frequency domain delay lines
+   long enough for the longest response, so process() allocates
+   nothing and takes bounded time. Responses are prepared (cut up and
+   transformed) by loadResponse() on another thread and taken up by
+   process() at the start of a tail block. */
+
+/*****************************************************************************/
+
+#include <atomic>
+
+/*****************************************************************************/
+
+#include "cmt.h"
+#include "fft.h"
+
+/*****************************************************************************/
+
+#define CONVOLVER_BLOCK      64
+#define CONVOLVER_TAIL_BLOCK 1024
+
+/*****************************************************************************/
+
+class ConvolverResponse;
+
+/** Convolution of one channel with a response of up to a fixed
+    length. */
+class Convolver {
+private:
+
+  Convolver(const Convolver &);
+  Convolver & operator=(const Convolver &);
+
+  RealFFT m_oBodyFFT;
+  RealFFT m_oTailFFT;
+
+  unsigned long m_lMaximumLength;
+  unsigned long m_lMaximumTailPartitions;
+
+  /** Three responses circulate: the one process() uses, one
+      published by the loader (m_psNext) and one process() has
+      finished with (m_psRetired) or held by the loader. As process()
+      only takes up a response once the loader has collected the last
+      one retired, the loader always has one to work on. */
+  ConvolverResponse * m_apoResponses[3];
+  ConvolverResponse * m_poCurrent;
+  std::atomic<ConvolverResponse *> m_psNext;
+  std::atomic<ConvolverResponse *> m_psRetired;
+
+  /** Responses the loader holds, and its transform buffer. */
+  ConvolverResponse * m_apoFree[3];
+  int m_iFreeCount;
+  LADSPA_Data * m_pfLoadBuffer;
+
+  /** The previous and current body blocks of input, which the head
+      also reads, and the position in the current block. */
+  LADSPA_Data m_afBodyInput[2 * CONVOLVER_BLOCK];
+  unsigned long m_lPosition;
+
+  /** The body's contribution to the current block. */
+  LADSPA_Data m_afBodyOutput[CONVOLVER_BLOCK];
+
+  /** Spectra of recent input for the body, newest at
+      m_lBodyNewest. */
+  LADSPA_Data * m_pfBodyHistoryReal;
+  LADSPA_Data * m_pfBodyHistoryImaginary;
+  unsigned long m_lBodyNewest;
+
+  LADSPA_Data m_afBodyAccumulatorReal[CONVOLVER_BLOCK];
+  LADSPA_Data m_afBodyAccumulatorImaginary[CONVOLVER_BLOCK];
+  LADSPA_Data m_afBodyTransform[2 * CONVOLVER_BLOCK];
+
+  /** As above for the tail, the position running over a whole tail
+      block. m_pfTailOutput is played while m_pfTailNextOutput is
+      worked out. */
+  LADSPA_Data * m_pfTailInput;
+  unsigned long m_lTailPosition;
+  LADSPA_Data * m_pfTailOutput;
+  LADSPA_Data * m_pfTailNextOutput;
+  LADSPA_Data * m_pfTailHistoryReal;
+  LADSPA_Data * m_pfTailHistoryImaginary;
+  unsigned long m_lTailNewest;
+  LADSPA_Data * m_pfTailAccumulatorReal;
+  LADSPA_Data * m_pfTailAccumulatorImaginary;
+  LADSPA_Data * m_pfTailTransform;
+
+  void prepare(ConvolverResponse *  poResponse,
+	       const LADSPA_Data *  pfResponse,
+	       const unsigned long  lLength);
+
+  void adoptNextResponse();
+  void endBodyBlock();
+  void stepTail();
+
+public:
+
+  /** lMaximumLength is the longest response that will be loaded, in
+      samples. Memory use is around 24 bytes for each sample of it. */
+  Convolver(const unsigned long lMaximumLength);
+  ~Convolver();
+
+  unsigned long getMaximumLength() const {
+    return m_lMaximumLength;
+  }
+
+  /** Input older than this many samples cannot reach the output,
+      whatever response is loaded. Plugins can use it to decide when
+      their tail is over (see silence.h). */
+  unsigned long getHistoryLength() const {
+    return ((m_lMaximumTailPartitions + 3) * CONVOLVER_TAIL_BLOCK);
+  }
+
+  /** Clear the signal history. Call from activate(). */
+  void reset();
+
+  /** Prepare a response of lLength samples (no more than
+      getMaximumLength()) and pass it to process(), which takes it up
+      within CONVOLVER_TAIL_BLOCK samples. This allocates nothing but
+      takes time in proportion to the length, so it should be called
+      from a thread other than the one running process(), and from only
+      one thread at a time. A response loaded before process() has
+      taken up the last replaces it. */
+  void loadResponse(const LADSPA_Data * pfResponse,
+		    const unsigned long lLength);
+
+  /** Write the convolution of lSampleCount samples of pfInput to
+      pfOutput, which may be the same buffer. */
+  void process(const LADSPA_Data * pfInput,
+	       LADSPA_Data *       pfOutput,
+	       unsigned long       lSampleCount);
+
+};
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -22,17 +22,33 @@
 
 /* This module provides delays and delays with feedback. A variety of
    maximum delay times are available. (The plugins reserve different
-   amounts of memory space on this basis.) */
+   amounts of memory space on this basis.)
+
+   Long delay lines are lazy: their buffers are reserved with mmap()
+   so the system commits pages only as they are first touched, and
+   only as much of the buffer as the longest delay used since
+   instantiation is cycled through and cleared on activation. Memory
+   use and startup time then follow the delays actually used. When the
+   delay grows beyond what has been used, the buffer grows the next
+   time the write pointer wraps, so no history has to be moved in
+   run(), and until then the delay is held to what fits. History older
+   than the earlier delays reads as silence rather than as input from
+   that long ago. Shorter delay lines always use their whole buffer. */
 
 /*****************************************************************************/
 
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <sys/mman.h>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "dispatch.h"
+#include "run_adding.h"
+#include "silence.h"
 
 /*****************************************************************************/
 
@@ -53,12 +69,38 @@
 #define DL_OUTPUT	3
 /* Present only on feedback delays: */
 #define DL_FEEDBACK	4
+/* Present only on fractional delays, following the ports above: */
+#define DL_INTERPOLATION(bFeedback) ((bFeedback) ? 5 : 4)
+/* Always last: */
+#define DL_IDLE(bFeedback, bFractional) \
+  (4 + ((bFeedback) ? 1 : 0) + ((bFractional) ? 1 : 0))
+
+/** Delay lines with buffers of at least this many samples (4MiB) are
+    lazy. */
+#define DL_LAZY_MINIMUM_BUFFER_SIZE (1UL << 20)
+
+/** Smallest region of a lazy buffer that is used. */
+#define DL_LAZY_INITIAL_SIZE (1UL << 14)
+
+/** The interpolators need this many samples beyond the delay. */
+#define DL_DELAY_MARGIN 4
+
+#define DL_INTERPOLATION_LINEAR  0
+#define DL_INTERPOLATION_ALLPASS 1
+#define DL_INTERPOLATION_CUBIC   2
 
 static void activateDelayLine(LADSPA_Handle Instance);
+static void setDelayLineRunAddingGain(LADSPA_Handle Instance,
+				      LADSPA_Data Gain);
+template <OutputFunction write_output>
 static void runSimpleDelayLine(LADSPA_Handle Instance,
 			       unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runFeedbackDelayLine(LADSPA_Handle Instance,
 				 unsigned long SampleCount);
+template <bool bFeedback, OutputFunction write_output>
+static void runFractionalDelayLine(LADSPA_Handle Instance,
+				   unsigned long SampleCount);
 
 /** This class is used to implement delay line plugins. Different
     maximum delay times are supported as are both echo and feedback
@@ -72,36 +114,182 @@ private:
 
   LADSPA_Data * m_pfBuffer;
 
-  /** Buffer size, a power of two. */
+  /** Size of the part of the buffer in use, a power of two. Delay
+      positions wrap within this. */
   unsigned long m_lBufferSize;
 
+  /** Size of the whole buffer, a power of two. */
+  unsigned long m_lCapacity;
+
+  /** True if m_lBufferSize grows with the delay, see above. */
+  bool m_bLazy;
+
+  /** True if m_pfBuffer is from mmap() rather than new. */
+  bool m_bMapped;
+
+  /** Grow a lazy buffer so delays of fDelay samples fit. The buffer
+      only grows when the write pointer wraps to zero, as the history
+      is then already where a larger buffer needs it if the pointer
+      carries on from the old size. The rest of the larger buffer has
+      never been touched since instantiation so is already zero.
+      Nothing is moved or cleared, so run() stays in fixed time. A
+      block in which the pointer wraps is run by fRun in two parts,
+      split at the wrap, and true is returned. Until the buffer has
+      grown the delay is held to what fits. */
+  bool growAtWrap(const LADSPA_Data  fDelay,
+		  const unsigned long SampleCount,
+		  void (*fRun)(LADSPA_Handle, unsigned long)) {
+    if (!m_bLazy
+	|| m_lBufferSize == m_lCapacity
+	|| fDelay + DL_DELAY_MARGIN <= LADSPA_Data(m_lBufferSize))
+      return false;
+    if (m_lWritePointer == 0) {
+      unsigned long lSize = m_lBufferSize;
+      while (lSize < m_lCapacity
+	     && LADSPA_Data(lSize) < fDelay + DL_DELAY_MARGIN)
+	lSize <<= 1;
+      m_lWritePointer = m_lBufferSize;
+      m_lBufferSize = lSize;
+      return false;
+    }
+    const unsigned long lToWrap = m_lBufferSize - m_lWritePointer;
+    if (lToWrap >= SampleCount)
+      return false;
+    LADSPA_Data * pfInput = m_ppfPorts[DL_INPUT];
+    LADSPA_Data * pfOutput = m_ppfPorts[DL_OUTPUT];
+    fRun(this, lToWrap);
+    m_ppfPorts[DL_INPUT] = pfInput + lToWrap;
+    m_ppfPorts[DL_OUTPUT] = pfOutput + lToWrap;
+    fRun(this, SampleCount - lToWrap);
+    m_ppfPorts[DL_INPUT] = pfInput;
+    m_ppfPorts[DL_OUTPUT] = pfOutput;
+    return true;
+  }
+
   /** Write pointer in buffer. */
   unsigned long m_lWritePointer;
 
+  /** Delay (in samples) reached at the end of the last block by the
+      fractional delays, or negative if no block has been run since
+      activation. */
+  LADSPA_Data m_fCurrentDelay;
+
+  /** Previous output of the allpass interpolator. */
+  LADSPA_Data m_fAllpassState;
+
+  SilenceTracker m_oSilence;
+
+  LADSPA_Data m_fRunAddingGain;
+
+  /** If the delay line is idle, write silence to the output (unless
+      bAdding, when there is nothing to add), move the buffer along
+      with zeros and return true. lTailLength is the longest delay (in
+      samples) the block may read. */
+  bool runIdle(const bool          bSilent,
+	       const bool          bAdding,
+	       const unsigned long lTailLength,
+	       const unsigned long SampleCount,
+	       LADSPA_Data *       pfIdle) {
+    if (!(bSilent && m_oSilence.isIdle(lTailLength)))
+      return false;
+    unsigned long lClear = SampleCount;
+    if (lClear > m_lBufferSize)
+      lClear = m_lBufferSize;
+    unsigned long lFirst = m_lBufferSize - m_lWritePointer;
+    if (lFirst > lClear)
+      lFirst = lClear;
+    memset(m_pfBuffer + m_lWritePointer, 0, sizeof(LADSPA_Data) * lFirst);
+    memset(m_pfBuffer, 0, sizeof(LADSPA_Data) * (lClear - lFirst));
+    m_lWritePointer = (m_lWritePointer + SampleCount) & (m_lBufferSize - 1);
+    m_fAllpassState = 0;
+    if (!bAdding)
+      memset(m_ppfPorts[DL_OUTPUT], 0, sizeof(LADSPA_Data) * SampleCount);
+    m_oSilence.update(true, SampleCount);
+    *pfIdle = 1;
+    return true;
+  }
+
+  /** Call after processing a block that was not idle. If the input
+      was silent, what the block wrote to the buffer (SampleCount
+      samples ending at the write pointer) is checked too. */
+  void trackSilence(const bool          bSilent,
+		    const bool          bCheckBuffer,
+		    const unsigned long lTailLength,
+		    const unsigned long SampleCount,
+		    LADSPA_Data *       pfIdle) {
+    bool bQuiet = bSilent;
+    if (bQuiet && bCheckBuffer) {
+      unsigned long lWritten = SampleCount;
+      if (lWritten > m_lBufferSize)
+	lWritten = m_lBufferSize;
+      unsigned long lStart 
+	= (m_lWritePointer - lWritten) & (m_lBufferSize - 1);
+      if (lStart + lWritten > m_lBufferSize)
+	bQuiet = (isSilent(m_pfBuffer + lStart, m_lBufferSize - lStart)
+		  && isSilent(m_pfBuffer, lStart + lWritten - m_lBufferSize));
+      else
+	bQuiet = isSilent(m_pfBuffer + lStart, lWritten);
+    }
+    m_oSilence.update(bQuiet, SampleCount);
+    if (m_oSilence.isQuietFor(lTailLength))
+      m_oSilence.enterIdle();
+    *pfIdle = 0;
+  }
+
   friend void activateDelayLine(LADSPA_Handle Instance);
+  friend void setDelayLineRunAddingGain(LADSPA_Handle Instance,
+					LADSPA_Data Gain);
+  template <OutputFunction write_output>
   friend void runSimpleDelayLine(LADSPA_Handle Instance,
 				 unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runFeedbackDelayLine(LADSPA_Handle Instance,
 				   unsigned long SampleCount);
+  template <bool bFeedback, OutputFunction write_output>
+  friend void runFractionalDelayLine(LADSPA_Handle Instance,
+				     unsigned long SampleCount);
 
 public:
 
   DelayLine(const unsigned long lSampleRate,
 	    const LADSPA_Data fMaximumDelay) 
-    : CMT_PluginInstance(4),
+    : CMT_PluginInstance(7), /* Enough for any of the variants. */
       m_fSampleRate(LADSPA_Data(lSampleRate)),
-      m_fMaximumDelay(fMaximumDelay) {
+      m_fMaximumDelay(fMaximumDelay),
+      m_fRunAddingGain(1) {
     /* Buffer size is a power of two bigger than max delay time. */
     unsigned long lMinimumBufferSize 
       = (unsigned long)((LADSPA_Data)lSampleRate * m_fMaximumDelay) + 1;
-    m_lBufferSize = 1;
-    while (m_lBufferSize < lMinimumBufferSize)
-      m_lBufferSize <<= 1;
-    m_pfBuffer = new LADSPA_Data[m_lBufferSize];
+    m_lCapacity = 1;
+    while (m_lCapacity < lMinimumBufferSize)
+      m_lCapacity <<= 1;
+
+    m_bLazy = false;
+    m_bMapped = false;
+    if (m_lCapacity >= DL_LAZY_MINIMUM_BUFFER_SIZE) {
+      void * pvBuffer = mmap(NULL, 
+			     sizeof(LADSPA_Data) * m_lCapacity,
+			     PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			     -1,
+			     0);
+      if (pvBuffer != MAP_FAILED) {
+	m_pfBuffer = (LADSPA_Data *)pvBuffer;
+	m_bLazy = true;
+	m_bMapped = true;
+      }
+    }
+    if (!m_bMapped)
+      m_pfBuffer = new LADSPA_Data[m_lCapacity];
+    m_lBufferSize = m_bLazy ? DL_LAZY_INITIAL_SIZE : m_lCapacity;
+    m_lWritePointer = 0;
   }
   
   ~DelayLine() {
-    delete [] m_pfBuffer;
+    if (m_bMapped)
+      munmap(m_pfBuffer, sizeof(LADSPA_Data) * m_lCapacity);
+    else
+      delete [] m_pfBuffer;
   }
 };
 
@@ -115,29 +303,51 @@ activateDelayLine(LADSPA_Handle Instance) {
 
   /* Need to reset the delay history in this function rather than
      instantiate() in case deactivate() followed by activate() have
-     been called to reinitialise a delay line. */
+     been called to reinitialise a delay line. Only the part of the
+     buffer in use can hold anything. */
   memset(poDelayLine->m_pfBuffer, 
 	 0, 
 	 sizeof(LADSPA_Data) * poDelayLine->m_lBufferSize);
 
   poDelayLine->m_lWritePointer = 0;
+  poDelayLine->m_fCurrentDelay = -1;
+  poDelayLine->m_fAllpassState = 0;
+  poDelayLine->m_oSilence.reset();
+}
+
+/*****************************************************************************/
+
+static void
+setDelayLineRunAddingGain(LADSPA_Handle Instance,
+			  LADSPA_Data Gain) {
+  ((DelayLine *)Instance)->m_fRunAddingGain = Gain;
 }
 
 /*****************************************************************************/
 
 /* Run a delay line instance for a block of SampleCount samples. */
+template <OutputFunction write_output>
 static void 
 runSimpleDelayLine(LADSPA_Handle Instance,
 		   unsigned long SampleCount) {
   
   DelayLine * poDelayLine = (DelayLine *)Instance;
 
-  unsigned long lBufferSizeMinusOne = poDelayLine->m_lBufferSize - 1;
-  unsigned long lDelay = (unsigned long)
-    (LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DELAY_LENGTH]),
-		   0,
-		   poDelayLine->m_fMaximumDelay)
-     * poDelayLine->m_fSampleRate);
+  LADSPA_Data fDelay 
+    = (LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DELAY_LENGTH]),
+		     0,
+		     poDelayLine->m_fMaximumDelay)
+       * poDelayLine->m_fSampleRate);
+  if (poDelayLine->growAtWrap(fDelay,
+			      SampleCount,
+			      runSimpleDelayLine<write_output>))
+    return;
+
+  unsigned long lBufferSize = poDelayLine->m_lBufferSize;
+  unsigned long lBufferSizeMinusOne = lBufferSize - 1;
+  unsigned long lDelay = (unsigned long)fDelay;
+  if (lDelay > lBufferSizeMinusOne)
+    lDelay = lBufferSizeMinusOne;
 
   LADSPA_Data * pfInput
     = poDelayLine->m_ppfPorts[DL_INPUT];
@@ -145,55 +355,110 @@ runSimpleDelayLine(LADSPA_Handle Instance,
     = poDelayLine->m_ppfPorts[DL_OUTPUT];
   LADSPA_Data * pfBuffer
     = poDelayLine->m_pfBuffer;
+  LADSPA_Data * pfIdle
+    = poDelayLine->m_ppfPorts[DL_IDLE(false, false)];
+
+  /* The buffer only ever holds input, so silent input is all that
+     needs checking. */
+  bool bSilent = isSilent(pfInput, SampleCount);
+  if (poDelayLine->runIdle(bSilent, 
+			   is_adding<write_output>(), 
+			   lDelay, 
+			   SampleCount, 
+			   pfIdle))
+    return;
+  unsigned long lTotalSampleCount = SampleCount;
 
   unsigned long lBufferWriteOffset
     = poDelayLine->m_lWritePointer;
   unsigned long lBufferReadOffset
-    = lBufferWriteOffset + poDelayLine->m_lBufferSize - lDelay;
+    = (lBufferWriteOffset + lBufferSize - lDelay) & lBufferSizeMinusOne;
   LADSPA_Data fWet 
     = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DRY_WET]),
 		    0,
 		    1);
   LADSPA_Data fDry
     = 1 - fWet;
-
-  for (unsigned long lSampleIndex = 0;
-       lSampleIndex < SampleCount;
-       lSampleIndex++) {
-    LADSPA_Data fInputSample = *(pfInput++);
-    pfBuffer[((lSampleIndex + lBufferWriteOffset)
-	      & lBufferSizeMinusOne)] = fInputSample;
-    *(pfOutput++) = (fDry * fInputSample
-		     + fWet * pfBuffer[((lSampleIndex + lBufferReadOffset)
-					& lBufferSizeMinusOne)]);
+  LADSPA_Data fOutputGain 
+    = get_gain<write_output>(poDelayLine->m_fRunAddingGain);
+  fWet *= fOutputGain;
+  fDry *= fOutputGain;
+
+  /* The delay is constant across the block, so rather than masking
+     every index we work through contiguous segments that wrap
+     neither the read nor the write pointer. Each segment is copied
+     into the buffer before being read back, so a segment must also
+     be short enough not to overwrite history it has still to read
+     (this can only matter for blocks longer than the buffer). */
+  unsigned long lSegmentLimit = lBufferSize - lDelay;
+  while (SampleCount > 0) {
+
+    unsigned long lSegment = SampleCount;
+    if (lSegment > lSegmentLimit)
+      lSegment = lSegmentLimit;
+    if (lSegment > lBufferSize - lBufferWriteOffset)
+      lSegment = lBufferSize - lBufferWriteOffset;
+    if (lSegment > lBufferSize - lBufferReadOffset)
+      lSegment = lBufferSize - lBufferReadOffset;
+
+    memcpy(pfBuffer + lBufferWriteOffset,
+	   pfInput,
+	   sizeof(LADSPA_Data) * lSegment);
+    dispatchMixBuffers<is_adding<write_output>()>
+      (pfOutput,
+       pfInput,
+       fDry,
+       pfBuffer + lBufferReadOffset,
+       fWet,
+       lSegment);
+
+    pfInput += lSegment;
+    pfOutput += lSegment;
+    SampleCount -= lSegment;
+    lBufferWriteOffset = (lBufferWriteOffset + lSegment) & lBufferSizeMinusOne;
+    lBufferReadOffset = (lBufferReadOffset + lSegment) & lBufferSizeMinusOne;
   }
 
-  poDelayLine->m_lWritePointer
-    = ((poDelayLine->m_lWritePointer + SampleCount)
-       & lBufferSizeMinusOne);
+  poDelayLine->m_lWritePointer = lBufferWriteOffset;
+  poDelayLine->trackSilence(bSilent, false, lDelay, lTotalSampleCount, pfIdle);
 }
 
 /*****************************************************************************/
 
+/** Delays shorter than this (in samples) are processed by the
+    per-sample feedback loop as segments would be too short to be
+    worth vectorising. */
+#define DL_MINIMUM_SEGMENTED_FEEDBACK_DELAY 16
+
 /** Run a feedback delay line instance for a block of SampleCount samples. */
+template <OutputFunction write_output>
 static void 
 runFeedbackDelayLine(LADSPA_Handle Instance,
 		     unsigned long SampleCount) {
   
   DelayLine * poDelayLine = (DelayLine *)Instance;
 
-  unsigned long lBufferSizeMinusOne = poDelayLine->m_lBufferSize - 1;
-  unsigned long lDelay = (unsigned long)
-    (LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DELAY_LENGTH]),
-		   0,
-		   poDelayLine->m_fMaximumDelay)
-     * poDelayLine->m_fSampleRate);
+  LADSPA_Data fDelay 
+    = (LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DELAY_LENGTH]),
+		     0,
+		     poDelayLine->m_fMaximumDelay)
+       * poDelayLine->m_fSampleRate);
+  if (poDelayLine->growAtWrap(fDelay,
+			      SampleCount,
+			      runFeedbackDelayLine<write_output>))
+    return;
+
+  unsigned long lBufferSize = poDelayLine->m_lBufferSize;
+  unsigned long lBufferSizeMinusOne = lBufferSize - 1;
+  unsigned long lDelay = (unsigned long)fDelay;
   if (lDelay == 0) {
     /* The logic below uses read-then-write, to handle
        feedback. Because of this, a value of zero won't do what the
        user expects. */
     lDelay = 1;
   }
+  if (lDelay > lBufferSizeMinusOne)
+    lDelay = lBufferSizeMinusOne;
 
   LADSPA_Data * pfInput
     = poDelayLine->m_ppfPorts[DL_INPUT];
@@ -205,7 +470,7 @@ runFeedbackDelayLine(LADSPA_Handle Instance,
   unsigned long lBufferWriteOffset
     = poDelayLine->m_lWritePointer;
   unsigned long lBufferReadOffset
-    = lBufferWriteOffset + poDelayLine->m_lBufferSize - lDelay;
+    = lBufferWriteOffset + lBufferSize - lDelay;
   LADSPA_Data fWet 
     = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DRY_WET]),
 		    0,
@@ -216,25 +481,325 @@ runFeedbackDelayLine(LADSPA_Handle Instance,
     = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_FEEDBACK]),
 		    -1,
 		    1);
+  LADSPA_Data * pfIdle
+    = poDelayLine->m_ppfPorts[DL_IDLE(true, false)];
+  LADSPA_Data fOutputGain 
+    = get_gain<write_output>(poDelayLine->m_fRunAddingGain);
+  fWet *= fOutputGain;
+  fDry *= fOutputGain;
+
+  bool bSilent = isSilent(pfInput, SampleCount);
+  if (poDelayLine->runIdle(bSilent, 
+			   is_adding<write_output>(), 
+			   lDelay, 
+			   SampleCount, 
+			   pfIdle))
+    return;
+
+  if (lDelay < DL_MINIMUM_SEGMENTED_FEEDBACK_DELAY) {
+
+    for (unsigned long lSampleIndex = 0;
+	 lSampleIndex < SampleCount;
+	 lSampleIndex++) {
+
+      LADSPA_Data fInputSample = *(pfInput++);
+      LADSPA_Data &fDelayedSample 
+	= pfBuffer[((lSampleIndex + lBufferReadOffset)
+		    & lBufferSizeMinusOne)];
+    
+      write_output(pfOutput, 
+		   fDry * fInputSample + fWet * fDelayedSample, 
+		   1.0f);
+
+      pfBuffer[((lSampleIndex + lBufferWriteOffset)
+		& lBufferSizeMinusOne)]
+	= fInputSample + fDelayedSample * fFeedback;
+    }
+
+    poDelayLine->m_lWritePointer
+      = ((poDelayLine->m_lWritePointer + SampleCount)
+	 & lBufferSizeMinusOne);
+    poDelayLine->trackSilence(bSilent, true, lDelay, SampleCount, pfIdle);
+    return;
+  }
+
+  /* Segmented path. A segment no longer than the delay only reads
+     samples written before it started, and one no longer than the
+     rest of the buffer never writes over samples it is still to
+     read, so within such a segment (that also wraps neither pointer)
+     all reads and writes are independent. */
+  lBufferReadOffset &= lBufferSizeMinusOne;
+  unsigned long lTotalSampleCount = SampleCount;
+  unsigned long lSegmentLimit = lDelay;
+  if (lSegmentLimit > lBufferSize - lDelay)
+    lSegmentLimit = lBufferSize - lDelay;
+  while (SampleCount > 0) {
+
+    unsigned long lSegment = SampleCount;
+    if (lSegment > lSegmentLimit)
+      lSegment = lSegmentLimit;
+    if (lSegment > lBufferSize - lBufferWriteOffset)
+      lSegment = lBufferSize - lBufferWriteOffset;
+    if (lSegment > lBufferSize - lBufferReadOffset)
+      lSegment = lBufferSize - lBufferReadOffset;
+
+    dispatchMixWithFeedback<is_adding<write_output>()>
+      (pfOutput,
+       pfBuffer + lBufferWriteOffset,
+       pfInput,
+       pfBuffer + lBufferReadOffset,
+       fDry,
+       fWet,
+       fFeedback,
+       lSegment);
+
+    pfInput += lSegment;
+    pfOutput += lSegment;
+    SampleCount -= lSegment;
+    lBufferWriteOffset = (lBufferWriteOffset + lSegment) & lBufferSizeMinusOne;
+    lBufferReadOffset = (lBufferReadOffset + lSegment) & lBufferSizeMinusOne;
+  }
+
+  poDelayLine->m_lWritePointer = lBufferWriteOffset;
+  poDelayLine->trackSilence(bSilent, true, lDelay, lTotalSampleCount, pfIdle);
+}
+
+/*****************************************************************************/
+
+/** Read from a delay buffer between pfBuffer[lPosition] (fFraction =
+    0) and the older sample pfBuffer[lPosition - 1] (fFraction = 1).
+    Cubic interpolation also uses the samples either side of these
+    (lPosition + 1 and lPosition - 2). Allpass interpolation expects
+    fFraction in [0.5, 1.5) to keep its pole well inside the unit
+    circle, and keeps its previous output in fAllpassState. */
+template <int iInterpolation>
+static inline LADSPA_Data
+readFractional(const LADSPA_Data * pfBuffer,
+	       const unsigned long lBufferSizeMinusOne,
+	       const unsigned long lPosition,
+	       const LADSPA_Data   fFraction,
+	       LADSPA_Data &       fAllpassState) {
+
+  LADSPA_Data fX0 = pfBuffer[lPosition & lBufferSizeMinusOne];
+  LADSPA_Data fX1 = pfBuffer[(lPosition - 1) & lBufferSizeMinusOne];
+
+  switch (iInterpolation) {
+
+  case DL_INTERPOLATION_ALLPASS: {
+    LADSPA_Data fCoefficient = (1 - fFraction) / (1 + fFraction);
+    fAllpassState = fCoefficient * (fX0 - fAllpassState) + fX1;
+    return fAllpassState;
+  }
+
+  case DL_INTERPOLATION_CUBIC: {
+    /* Four-point, third-order Hermite. */
+    LADSPA_Data fXM1 = pfBuffer[(lPosition + 1) & lBufferSizeMinusOne];
+    LADSPA_Data fX2 = pfBuffer[(lPosition - 2) & lBufferSizeMinusOne];
+    LADSPA_Data fC1 = 0.5f * (fX1 - fXM1);
+    LADSPA_Data fC2 = fXM1 - 2.5f * fX0 + 2 * fX1 - 0.5f * fX2;
+    LADSPA_Data fC3 = 0.5f * (fX2 - fXM1) + 1.5f * (fX0 - fX1);
+    return ((fC3 * fFraction + fC2) * fFraction + fC1) * fFraction + fX0;
+  }
+
+  default:
+    return fX0 + fFraction * (fX1 - fX0);
+  }
+}
+
+/*****************************************************************************/
+
+/** Shortest delay (in samples) each interpolator can provide. Reads
+    must not reach samples not yet written, and feedback delays read
+    before they write. */
+static inline LADSPA_Data
+minimumFractionalDelay(const bool bFeedback,
+		       const int  iInterpolation) {
+  LADSPA_Data fMinimum = bFeedback ? 1 : 0;
+  if (iInterpolation == DL_INTERPOLATION_ALLPASS)
+    fMinimum += 0.5f;
+  else if (iInterpolation == DL_INTERPOLATION_CUBIC)
+    fMinimum += 1;
+  return fMinimum;
+}
+
+/*****************************************************************************/
+
+/** Run a fractional delay line for a block, moving the delay linearly
+    from fStartDelay to fEndDelay (both in samples) over the block. Any
+    run_adding gain should already be applied to fDry and fWet. */
+template <bool bFeedback, int iInterpolation, OutputFunction write_output>
+static inline void
+processFractionalDelayLine(LADSPA_Data *       pfBuffer,
+			   const unsigned long lBufferSizeMinusOne,
+			   unsigned long &     lWritePointer,
+			   LADSPA_Data &       fAllpassState,
+			   const LADSPA_Data * pfInput,
+			   LADSPA_Data *       pfOutput,
+			   const LADSPA_Data   fStartDelay,
+			   const LADSPA_Data   fEndDelay,
+			   const LADSPA_Data   fDry,
+			   const LADSPA_Data   fWet,
+			   const LADSPA_Data   fFeedback,
+			   const unsigned long SampleCount) {
+
+  /* The allpass works with fractions in [0.5, 1.5). */
+  const LADSPA_Data fOffset
+    = (iInterpolation == DL_INTERPOLATION_ALLPASS) ? 0.5f : 0;
+
+  LADSPA_Data fDelay = fStartDelay;
+  LADSPA_Data fDelayStep = (fEndDelay - fStartDelay) / SampleCount;
 
   for (unsigned long lSampleIndex = 0;
        lSampleIndex < SampleCount;
        lSampleIndex++) {
 
+    fDelay += fDelayStep;
+    long lWholeDelay = long(fDelay - fOffset);
+    LADSPA_Data fFraction = fDelay - lWholeDelay;
+
     LADSPA_Data fInputSample = *(pfInput++);
-    LADSPA_Data &fDelayedSample = pfBuffer[((lSampleIndex + lBufferReadOffset)
-					    & lBufferSizeMinusOne)];
-    
-    *(pfOutput++) = (fDry * fInputSample + fWet * fDelayedSample);
+    if (!bFeedback)
+      pfBuffer[lWritePointer] = fInputSample;
+
+    LADSPA_Data fDelayedSample
+      = readFractional<iInterpolation>(pfBuffer,
+				       lBufferSizeMinusOne,
+				       lWritePointer - lWholeDelay,
+				       fFraction,
+				       fAllpassState);
 
-    pfBuffer[((lSampleIndex + lBufferWriteOffset)
-	      & lBufferSizeMinusOne)]
-      = fInputSample + fDelayedSample * fFeedback;
+    write_output(pfOutput, fDry * fInputSample + fWet * fDelayedSample, 1.0f);
+    if (bFeedback)
+      pfBuffer[lWritePointer] = fInputSample + fDelayedSample * fFeedback;
+
+    lWritePointer = (lWritePointer + 1) & lBufferSizeMinusOne;
   }
-  
-  poDelayLine->m_lWritePointer
-    = ((poDelayLine->m_lWritePointer + SampleCount)
-       & lBufferSizeMinusOne);
+}
+
+/*****************************************************************************/
+
+/** Run a fractional delay line instance for a block of SampleCount
+    samples. The delay time is glided across the block rather than
+    jumping at block boundaries, so it can be automated without
+    zipper noise. */
+template <bool bFeedback, OutputFunction write_output>
+static void 
+runFractionalDelayLine(LADSPA_Handle Instance,
+		       unsigned long SampleCount) {
+
+  DelayLine * poDelayLine = (DelayLine *)Instance;
+
+  if (SampleCount == 0)
+    return;
+
+  LADSPA_Data fInterpolation 
+    = *(poDelayLine->m_ppfPorts[DL_INTERPOLATION(bFeedback)]);
+  int iInterpolation = DL_INTERPOLATION_LINEAR;
+  if (fInterpolation >= 1.5f)
+    iInterpolation = DL_INTERPOLATION_CUBIC;
+  else if (fInterpolation >= 0.5f)
+    iInterpolation = DL_INTERPOLATION_ALLPASS;
+
+  /* Keep clear of the oldest samples in the buffer as the
+     interpolators read a little beyond the nominal delay. */
+  LADSPA_Data fMinimumDelay 
+    = minimumFractionalDelay(bFeedback, iInterpolation);
+  LADSPA_Data fMaximumDelay
+    = LADSPA_Data(poDelayLine->m_lBufferSize - 3);
+  LADSPA_Data fTargetDelay
+    = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DELAY_LENGTH]),
+		    0,
+		    poDelayLine->m_fMaximumDelay)
+    * poDelayLine->m_fSampleRate;
+  if (poDelayLine->growAtWrap(fTargetDelay,
+			      SampleCount,
+			      runFractionalDelayLine<bFeedback, write_output>))
+    return;
+  fMaximumDelay = LADSPA_Data(poDelayLine->m_lBufferSize - 3);
+  fTargetDelay = LIMIT_BETWEEN(fTargetDelay, fMinimumDelay, fMaximumDelay);
+
+  LADSPA_Data fStartDelay = poDelayLine->m_fCurrentDelay;
+  if (fStartDelay < 0)
+    fStartDelay = fTargetDelay;
+  fStartDelay = LIMIT_BETWEEN(fStartDelay, fMinimumDelay, fMaximumDelay);
+  poDelayLine->m_fCurrentDelay = fTargetDelay;
+
+  /* The interpolators read up to two samples beyond the delay. */
+  LADSPA_Data * pfIdle
+    = poDelayLine->m_ppfPorts[DL_IDLE(bFeedback, true)];
+  unsigned long lTailLength = 3 + (unsigned long)
+    (fStartDelay > fTargetDelay ? fStartDelay : fTargetDelay);
+  bool bSilent = isSilent(poDelayLine->m_ppfPorts[DL_INPUT], SampleCount);
+  if (poDelayLine->runIdle(bSilent, 
+			   is_adding<write_output>(), 
+			   lTailLength, 
+			   SampleCount, 
+			   pfIdle))
+    return;
+
+  LADSPA_Data fWet 
+    = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_DRY_WET]),
+		    0,
+		    1);
+  LADSPA_Data fDry
+    = 1 - fWet;
+  LADSPA_Data fFeedback = 0;
+  if (bFeedback)
+    fFeedback = LIMIT_BETWEEN(*(poDelayLine->m_ppfPorts[DL_FEEDBACK]),
+			      -1,
+			      1);
+  LADSPA_Data fOutputGain 
+    = get_gain<write_output>(poDelayLine->m_fRunAddingGain);
+  fWet *= fOutputGain;
+  fDry *= fOutputGain;
+
+  /* Select the interpolator once for the block. */
+  void (*fProcess)(LADSPA_Data *,
+		   const unsigned long,
+		   unsigned long &,
+		   LADSPA_Data &,
+		   const LADSPA_Data *,
+		   LADSPA_Data *,
+		   const LADSPA_Data,
+		   const LADSPA_Data,
+		   const LADSPA_Data,
+		   const LADSPA_Data,
+		   const LADSPA_Data,
+		   const unsigned long);
+  switch (iInterpolation) {
+  case DL_INTERPOLATION_ALLPASS:
+    fProcess = processFractionalDelayLine<bFeedback, 
+					  DL_INTERPOLATION_ALLPASS, 
+					  write_output>;
+    break;
+  case DL_INTERPOLATION_CUBIC:
+    fProcess = processFractionalDelayLine<bFeedback, 
+					  DL_INTERPOLATION_CUBIC, 
+					  write_output>;
+    break;
+  default:
+    fProcess = processFractionalDelayLine<bFeedback, 
+					  DL_INTERPOLATION_LINEAR, 
+					  write_output>;
+    break;
+  }
+  fProcess(poDelayLine->m_pfBuffer,
+	   poDelayLine->m_lBufferSize - 1,
+	   poDelayLine->m_lWritePointer,
+	   poDelayLine->m_fAllpassState,
+	   poDelayLine->m_ppfPorts[DL_INPUT],
+	   poDelayLine->m_ppfPorts[DL_OUTPUT],
+	   fStartDelay,
+	   fTargetDelay,
+	   fDry,
+	   fWet,
+	   fFeedback,
+	   SampleCount);
+  poDelayLine->trackSilence(bSilent, 
+			    bFeedback, 
+			    lTailLength, 
+			    SampleCount, 
+			    pfIdle);
 }
 
 /*****************************************************************************/
@@ -264,8 +829,25 @@ initialise_delay() {
     "fbdelay"
   };
   LADSPA_Run_Function afRunFunctions[DELAY_TYPE_COUNT] = {
-    runSimpleDelayLine,
-    runFeedbackDelayLine
+    runSimpleDelayLine<write_output_normal>,
+    runFeedbackDelayLine<write_output_normal>
+  };
+  LADSPA_Run_Adding_Function afRunAddingFunctions[DELAY_TYPE_COUNT] = {
+    runSimpleDelayLine<write_output_adding>,
+    runFeedbackDelayLine<write_output_adding>
+  };
+  const char * apcFractionalDelayTypeLabels[DELAY_TYPE_COUNT] = {
+    "fracdelay",
+    "fracfbdelay"
+  };
+  LADSPA_Run_Function afFractionalRunFunctions[DELAY_TYPE_COUNT] = {
+    runFractionalDelayLine<false, write_output_normal>,
+    runFractionalDelayLine<true, write_output_normal>
+  };
+  LADSPA_Run_Adding_Function 
+    afFractionalRunAddingFunctions[DELAY_TYPE_COUNT] = {
+    runFractionalDelayLine<false, write_output_adding>,
+    runFractionalDelayLine<true, write_output_adding>
   };
 
   LADSPA_Data afMaximumDelays[DELAY_LENGTH_COUNT] = {
@@ -292,77 +874,103 @@ initialise_delay() {
     CMT_Delay_Instantiate<60000>
   };
   
-  for (long lDelayTypeIndex = 0;
-       lDelayTypeIndex < DELAY_TYPE_COUNT; 
-       lDelayTypeIndex++) {
-
-    for (long lDelayLengthIndex = 0; 
-	 lDelayLengthIndex < DELAY_LENGTH_COUNT;
-	 lDelayLengthIndex++) {
+  /* The second pass registers the fractional variants. */
+  for (long lFractional = 0; lFractional < 2; lFractional++) {
+    for (long lDelayTypeIndex = 0;
+	 lDelayTypeIndex < DELAY_TYPE_COUNT; 
+	 lDelayTypeIndex++) {
+
+      for (long lDelayLengthIndex = 0; 
+	   lDelayLengthIndex < DELAY_LENGTH_COUNT;
+	   lDelayLengthIndex++) {
       
-      long lPluginIndex 
-	= lDelayTypeIndex * DELAY_LENGTH_COUNT + lDelayLengthIndex;
+	long lPluginIndex 
+	  = lDelayTypeIndex * DELAY_LENGTH_COUNT + lDelayLengthIndex;
       
-      char acLabel[100];
-      sprintf(acLabel,
-	      "%s_%ss",
-	      apcDelayTypeLabels[lDelayTypeIndex],
-	      afMaximumDelayStrs[lDelayLengthIndex]);
-      char acName[100];
-      sprintf(acName, 
-	      "%s Delay Line (Maximum Delay %ss)",
-	      apcDelayTypeNames[lDelayTypeIndex],
-	      afMaximumDelayStrs[lDelayLengthIndex]);
+	char acLabel[100];
+	sprintf(acLabel,
+		"%s_%ss",
+		(lFractional 
+		 ? apcFractionalDelayTypeLabels[lDelayTypeIndex]
+		 : apcDelayTypeLabels[lDelayTypeIndex]),
+		afMaximumDelayStrs[lDelayLengthIndex]);
+	char acName[100];
+	sprintf(acName, 
+		"%s Delay Line (%sMaximum Delay %ss)",
+		apcDelayTypeNames[lDelayTypeIndex],
+		lFractional ? "Fractional, " : "",
+		afMaximumDelayStrs[lDelayLengthIndex]);
       
-      psDescriptor = new CMT_Descriptor
-	(1053 + lPluginIndex,
-	 acLabel,
-	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
-	 acName,
-	 CMT_MAKER("Richard W.E. Furse"),
-	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
-	 NULL,
-	 afInstantiateFunctions[lDelayLengthIndex],
-	 activateDelayLine,
-	 afRunFunctions[lDelayTypeIndex],
-	 NULL,
-	 NULL,
-	 NULL);
+	psDescriptor = new CMT_Descriptor
+	  ((lFractional ? 1901 : 1053) + lPluginIndex,
+	   acLabel,
+	   LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	   acName,
+	   CMT_MAKER("Richard W.E. Furse"),
+	   CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	   NULL,
+	   afInstantiateFunctions[lDelayLengthIndex],
+	   activateDelayLine,
+	   (lFractional 
+	    ? afFractionalRunFunctions[lDelayTypeIndex]
+	    : afRunFunctions[lDelayTypeIndex]),
+	   (lFractional 
+	    ? afFractionalRunAddingFunctions[lDelayTypeIndex]
+	    : afRunAddingFunctions[lDelayTypeIndex]),
+	   setDelayLineRunAddingGain,
+	   NULL);
       
-      psDescriptor->addPort
-	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
-	 "Delay (Seconds)",
-	 (LADSPA_HINT_BOUNDED_BELOW 
-	  | LADSPA_HINT_BOUNDED_ABOVE
-	  | LADSPA_HINT_DEFAULT_1),
-	 0,
-	 afMaximumDelays[lDelayLengthIndex]);
-      psDescriptor->addPort
-	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
-	 "Dry/Wet Balance",
-	 (LADSPA_HINT_BOUNDED_BELOW 
-	  | LADSPA_HINT_BOUNDED_ABOVE
-	  | LADSPA_HINT_DEFAULT_MIDDLE),
-	 0,
-	 1);
-      psDescriptor->addPort
-	(LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
-	 "Input");
-      psDescriptor->addPort
-	(LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
-	 "Output");
-      
-      if (lDelayTypeIndex == 1)
 	psDescriptor->addPort
 	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
-	   "Feedback",
+	   "Delay (Seconds)",
+	   (LADSPA_HINT_BOUNDED_BELOW 
+	    | LADSPA_HINT_BOUNDED_ABOVE
+	    | LADSPA_HINT_DEFAULT_1),
+	   0,
+	   afMaximumDelays[lDelayLengthIndex]);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	   "Dry/Wet Balance",
 	   (LADSPA_HINT_BOUNDED_BELOW 
 	    | LADSPA_HINT_BOUNDED_ABOVE
-	    | LADSPA_HINT_DEFAULT_HIGH),
-	   -1,
+	    | LADSPA_HINT_DEFAULT_MIDDLE),
+	   0,
 	   1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   "Input");
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   "Output");
+      
+	if (lDelayTypeIndex == 1)
+	  psDescriptor->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     "Feedback",
+	     (LADSPA_HINT_BOUNDED_BELOW 
+	      | LADSPA_HINT_BOUNDED_ABOVE
+	      | LADSPA_HINT_DEFAULT_HIGH),
+	     -1,
+	     1);
+
+	if (lFractional)
+	  psDescriptor->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     "Interpolation (0 = Linear, 1 = Allpass, 2 = Cubic)",
+	     (LADSPA_HINT_BOUNDED_BELOW 
+	      | LADSPA_HINT_BOUNDED_ABOVE
+	      | LADSPA_HINT_INTEGER
+	      | LADSPA_HINT_DEFAULT_0),
+	     0,
+	     2);
+
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+	   SILENCE_IDLE_PORT_NAME,
+	   SILENCE_IDLE_PORT_HINTS);
 
-      registerNewPluginDescriptor(psDescriptor);
+	registerNewPluginDescriptor(psDescriptor);
+      }
     }
   }
 }
@@ -0,0 +1,127 @@
+/* denormal.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_DENORMAL_INCLUDED
+#define CMT_DENORMAL_INCLUDED
+
+/*****************************************************************************/
+
+/* Where the target allows it, CMT_DENORMALS_FLUSHED is defined and
+   DenormalGuard switches the floating point unit to flush denormal
+   results (and, where supported, denormal inputs) to zero. Recursive
+   filters decaying towards silence otherwise spend most of their time
+   in very slow denormal arithmetic on many processors. */
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CMT_DENORMALS_FLUSHED
+#define CMT_DENORMAL_FTZ 0x8000
+#if defined(__SSE2__) || defined(_M_X64)
+/* Denormals-are-zero is not available on the earliest SSE
+   processors, where setting it would fault. */
+#define CMT_DENORMAL_DAZ 0x0040
+#else
+#define CMT_DENORMAL_DAZ 0
+#endif
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define CMT_DENORMALS_FLUSHED
+/* FZ bit of FPCR (AArch64) or FPSCR (AArch32). */
+#define CMT_DENORMAL_FZ (1UL << 24)
+#endif
+
+/*****************************************************************************/
+
+/** Flushes denormals to zero for the lifetime of the object and then
+    restores the previous floating point mode, so it is safe to nest
+    and leaves the host's own settings alone. The descriptor code in
+    cmt.cpp holds one of these around every run() and run_adding()
+    call, so plugins do not need their own per-sample denormal
+    checks. Where CMT_DENORMALS_FLUSHED is not defined this does
+    nothing. */
+class DenormalGuard {
+private:
+
+  unsigned long m_lSavedMode;
+
+  DenormalGuard(const DenormalGuard &);
+  DenormalGuard &operator=(const DenormalGuard &);
+
+  static inline unsigned long getMode() {
+#if defined(CMT_DENORMAL_FTZ)
+    return _mm_getcsr();
+#elif defined(__aarch64__) && defined(CMT_DENORMALS_FLUSHED)
+    unsigned long lMode;
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (lMode));
+    return lMode;
+#elif defined(CMT_DENORMALS_FLUSHED)
+    unsigned int iMode;
+    __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (iMode));
+    return iMode;
+#else
+    return 0;
+#endif
+  }
+
+  static inline void setMode(const unsigned long lMode) {
+#if defined(CMT_DENORMAL_FTZ)
+    _mm_setcsr((unsigned int)lMode);
+#elif defined(__aarch64__) && defined(CMT_DENORMALS_FLUSHED)
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (lMode));
+#elif defined(CMT_DENORMALS_FLUSHED)
+    unsigned int iMode = (unsigned int)lMode;
+    __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (iMode));
+#else
+    (void)lMode;
+#endif
+  }
+
+  static inline unsigned long flushMode(const unsigned long lMode) {
+#if defined(CMT_DENORMAL_FTZ)
+    return lMode | CMT_DENORMAL_FTZ | CMT_DENORMAL_DAZ;
+#elif defined(CMT_DENORMALS_FLUSHED)
+    return lMode | CMT_DENORMAL_FZ;
+#else
+    return lMode;
+#endif
+  }
+
+public:
+
+  inline DenormalGuard()
+    : m_lSavedMode(getMode()) {
+    /* Writing the control register is comparatively slow, so avoid
+       it when the mode is already set (for instance when nested). */
+    const unsigned long lMode = flushMode(m_lSavedMode);
+    if (lMode != m_lSavedMode)
+      setMode(lMode);
+  }
+
+  inline ~DenormalGuard() {
+    if (flushMode(m_lSavedMode) != m_lSavedMode)
+      setMode(m_lSavedMode);
+  }
+
+};
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
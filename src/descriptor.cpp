@@ -35,6 +35,7 @@ void initialise_ambisonic();
 void initialise_amp();
 void initialise_analogue();
 void initialise_canyondelay();
+void initialise_convolution();
 void initialise_delay();
 void initialise_dynamic();
 void initialise_filter();
@@ -71,6 +72,7 @@ initialise_modules() {
   initialise_amp();
   initialise_analogue();
   initialise_canyondelay();
+  initialise_convolution();
   initialise_delay();
   initialise_dynamic();
   initialise_filter();
@@ -101,13 +103,13 @@ initialise_modules() {
 /* Module Finalisation:
    -------------------- */
 
-void finalise_sine();
+void finaliseSharedTables();
 
 /** Finalise any structures allocated by the modules. This does not
     include descriptors passed to registerNewPluginDescriptor(). */
 void
 finalise_modules() {
-  finalise_sine();
+  finaliseSharedTables();
 }
 
 /*****************************************************************************/
@@ -27,6 +27,9 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "lanes.h"
+#include "oversample.h"
+#include "prng.h"
 #include "run_adding.h"
 
 /*****************************************************************************/
@@ -38,14 +41,74 @@ namespace disintegrator {
 	port_multiplier  = 1,
 	port_input       = 2,
 	port_output      = 3,
-	n_ports          = 4
+	port_seed        = 4,
+	n_ports          = 5,
+
+	// The oversampled version adds:
+	port_oversampling   = 5,
+	n_oversampled_ports = 6
     };
 
+    static void activate(LADSPA_Handle instance);
+
     template<OutputFunction write_output>
     static void run(LADSPA_Handle instance,
 	            unsigned long sample_count);
     static void set_run_adding_gain(LADSPA_Handle instance,
                                     LADSPA_Data new_gain);
+    static void activate_oversampled(LADSPA_Handle instance);
+    template<OutputFunction write_output>
+    static void run_oversampled(LADSPA_Handle instance,
+				unsigned long sample_count);
+    static void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						LADSPA_Data new_gain);
+
+/** Multiply the half-waveforms of in by mult, each with probability
+    prob, and write the result to out (which may be in). The gain can
+    only change at a zero crossing, so four samples at a time are
+    checked for one with masks and, if there is none, given the same
+    gain together. Only groups holding a crossing are done one sample
+    at a time. */
+    template<OutputFunction write_output>
+    static inline void disintegrate(bool & active,
+				    LADSPA_Data & last_input,
+				    PRNG & random,
+				    LADSPA_Data prob,
+				    LADSPA_Data mult,
+				    const LADSPA_Data * in,
+				    LADSPA_Data * out,
+				    unsigned long count,
+				    LADSPA_Data run_adding_gain) {
+	const Lanes zero = lanesSplat(0);
+	unsigned long i = 0;
+	for ( ; i + LANE_COUNT <= count ; i += LANE_COUNT ) {
+	    const Lanes insig = lanesLoad(in + i);
+	    const Lanes previous = lanesShiftIn(last_input, insig);
+	    const LaneMask crossing = (((previous > zero) & (insig < zero))
+				       | ((previous < zero) & (insig > zero)));
+	    if (!lanesAny(crossing)) {
+		last_input = in[i + LANE_COUNT - 1];
+		lanesWriteOutput<write_output>(out,
+					       insig * (active ? mult : 1.0f),
+					       run_adding_gain);
+		continue;
+	    }
+	    for ( unsigned long j = i; j < i + LANE_COUNT ; ++j ) {
+		LADSPA_Data sample = in[j];
+		if ( ( last_input>0 && sample<0 ) || ( last_input<0 && sample>0 ) )
+		    active = random.nextUnipolar() < prob;
+		last_input = sample;
+		write_output(out, active ? sample*mult : sample, run_adding_gain);
+	    }
+	}
+	for ( ; i < count ; ++i ) {
+	    LADSPA_Data sample = in[i];
+	    if ( ( last_input>0 && sample<0 ) || ( last_input<0 && sample>0 ) )
+		active = random.nextUnipolar() < prob;
+	    last_input = sample;
+	    write_output(out, active ? sample*mult : sample, run_adding_gain);
+	}
+    }
 
 /** This plugin multiplies random half-waveforms by port_multiplier,
     with probability port_probability */
@@ -53,6 +116,7 @@ namespace disintegrator {
 	LADSPA_Data run_adding_gain;
 	bool active;
 	LADSPA_Data last_input;
+	PRNG random;
     public:
 	Plugin(const LADSPA_Descriptor *,
 	       unsigned long)
@@ -60,6 +124,8 @@ namespace disintegrator {
 	    active = false; last_input = 0.0f;
 	}
 
+	friend void activate(LADSPA_Handle instance);
+
 	template<OutputFunction write_output>
 	friend void run(LADSPA_Handle instance,
 			unsigned long sample_count);
@@ -68,6 +134,10 @@ namespace disintegrator {
 					LADSPA_Data new_gain);
     };
 
+    static void activate(LADSPA_Handle instance) {
+	((Plugin *) instance)->random.resetSeedPort();
+    }
+
     template<OutputFunction write_output>
     void run(LADSPA_Handle instance,
 	            unsigned long sample_count) {
@@ -75,23 +145,15 @@ namespace disintegrator {
 	Plugin *pp = (Plugin *) instance;
 	Plugin &p  = *pp;
 
+	p.random.followSeedPort(*pp->m_ppfPorts[port_seed]);
+
 	LADSPA_Data   prob      = *pp->m_ppfPorts[port_probability];
 	LADSPA_Data   mult      = *pp->m_ppfPorts[port_multiplier];
 	LADSPA_Data * in        =  pp->m_ppfPorts[port_input];
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
     
-	mult *= get_gain<write_output>(p.run_adding_gain);
-
-	for ( unsigned long i = 0; i < sample_count ; ++i ) {
-	    LADSPA_Data insig = *(in++);
-	    if ( ( p.last_input>0 && insig<0 ) || ( p.last_input<0 && insig>0 ) )
-		p.active = rand() < prob*RAND_MAX;
-	    p.last_input = insig;
-	    if (p.active) 
-		write_output(out, insig*mult, 1.0f);
-	    else
-		write_output(out, insig, p.run_adding_gain);
-	}
+	disintegrate<write_output>(p.active, p.last_input, p.random, prob, mult,
+				   in, out, sample_count, p.run_adding_gain);
     }
     
     static void set_run_adding_gain(LADSPA_Handle instance,
@@ -99,23 +161,82 @@ namespace disintegrator {
 	((Plugin *) instance)->run_adding_gain = new_gain;
     }
 
-    void
-    initialise() {
-  
-	CMT_Descriptor * d = new CMT_Descriptor
-	    (1846,
-	     "disintegrator",
-	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
-	     "Disintegrator",
-	     CMT_MAKER("Nathaniel Virgo"),
-	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
-	     NULL,
-	     CMT_Instantiate<Plugin>,
-	     NULL,
-	     run<write_output_normal>,
-	     run<write_output_adding>,
-	     set_run_adding_gain,
-	     NULL);
+/** As Plugin, but the signal may be oversampled to reduce the
+    aliasing caused by the jumps in gain. */
+    class OversampledPlugin : public CMT_PluginInstance {
+	LADSPA_Data run_adding_gain;
+	bool active;
+	LADSPA_Data last_input;
+	PRNG random;
+	Oversampler oversampler;
+	LADSPA_Data buffer[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+    public:
+	OversampledPlugin(const LADSPA_Descriptor *,
+			  unsigned long)
+	    : CMT_PluginInstance(n_oversampled_ports) {
+	    active = false; last_input = 0.0f;
+	}
+
+	friend void activate_oversampled(LADSPA_Handle instance);
+
+	template<OutputFunction write_output>
+	friend void run_oversampled(LADSPA_Handle instance,
+				    unsigned long sample_count);
+
+	friend void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						    LADSPA_Data new_gain);
+    };
+
+    static void activate_oversampled(LADSPA_Handle instance) {
+	OversampledPlugin *pp = (OversampledPlugin *) instance;
+	pp->random.resetSeedPort();
+	pp->oversampler.reset();
+    }
+
+    template<OutputFunction write_output>
+    void run_oversampled(LADSPA_Handle instance,
+			 unsigned long sample_count) {
+
+	OversampledPlugin *pp = (OversampledPlugin *) instance;
+	OversampledPlugin &p  = *pp;
+
+	p.random.followSeedPort(*pp->m_ppfPorts[port_seed]);
+	p.oversampler.setFactor(*pp->m_ppfPorts[port_oversampling]);
+	const int factor = p.oversampler.getFactor();
+
+	LADSPA_Data   prob      = *pp->m_ppfPorts[port_probability];
+	LADSPA_Data   mult      = *pp->m_ppfPorts[port_multiplier];
+	LADSPA_Data * in        =  pp->m_ppfPorts[port_input];
+	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
+
+	while (sample_count > 0) {
+	    unsigned long count = sample_count;
+	    if (count > OVERSAMPLE_CHUNK)
+		count = OVERSAMPLE_CHUNK;
+
+	    p.oversampler.upsample(in, p.buffer, count);
+
+	    disintegrate<write_output_normal>(p.active, p.last_input, p.random,
+					      prob, mult, p.buffer, p.buffer,
+					      count * factor, 1.0f);
+
+	    p.oversampler.downsample(p.buffer, p.buffer, count);
+
+	    for ( unsigned long i = 0; i < count ; ++i )
+		write_output(out, p.buffer[i], p.run_adding_gain);
+
+	    in += count;
+	    sample_count -= count;
+	}
+    }
+
+    static void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						LADSPA_Data new_gain) {
+	((OversampledPlugin *) instance)->run_adding_gain = new_gain;
+    }
+
+    static void
+    add_ports(CMT_Descriptor * d) {
 
 	d->addPort
 	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -139,6 +260,58 @@ namespace disintegrator {
 	d->addPort
 	    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
 	     "Output");
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     PRNG_SEED_PORT_NAME,
+	     PRNG_SEED_PORT_HINTS,
+	     0,
+	     0);
+    }
+
+    void
+    initialise() {
+  
+	CMT_Descriptor * d = new CMT_Descriptor
+	    (1846,
+	     "disintegrator",
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	     "Disintegrator",
+	     CMT_MAKER("Nathaniel Virgo"),
+	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
+	     NULL,
+	     CMT_Instantiate<Plugin>,
+	     activate,
+	     run<write_output_normal>,
+	     run<write_output_adding>,
+	     set_run_adding_gain,
+	     NULL);
+
+	add_ports(d);
+
+	registerNewPluginDescriptor(d);
+
+	d = new CMT_Descriptor
+	    (2001,
+	     "disintegrator_os",
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	     "Disintegrator (Oversampled)",
+	     CMT_MAKER("Nathaniel Virgo"),
+	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
+	     NULL,
+	     CMT_Instantiate<OversampledPlugin>,
+	     activate_oversampled,
+	     run_oversampled<write_output_normal>,
+	     run_oversampled<write_output_adding>,
+	     set_run_adding_gain_oversampled,
+	     NULL);
+
+	add_ports(d);
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     OVERSAMPLE_PORT_NAME,
+	     OVERSAMPLE_PORT_HINTS,
+	     1,
+	     OVERSAMPLE_MAX_FACTOR);
 
 	registerNewPluginDescriptor(d);
 
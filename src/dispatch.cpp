@@ -0,0 +1,85 @@
+/* dispatch.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+
+/*****************************************************************************/
+
+#include "cmt.h"
+#include "dispatch.h"
+#include "kernels.h"
+
+/*****************************************************************************/
+
+#if defined(CMT_KERNELS_SSE)
+#define CMT_BASELINE_KERNELS "sse"
+#elif defined(CMT_KERNELS_NEON)
+#define CMT_BASELINE_KERNELS "neon"
+#else
+#define CMT_BASELINE_KERNELS "generic"
+#endif
+
+static const CMT_KernelSet g_sBaselineKernels
+  = CMT_KERNEL_SET(CMT_BASELINE_KERNELS);
+
+const CMT_KernelSet * g_psKernels = &g_sBaselineKernels;
+
+/*****************************************************************************/
+
+void
+selectKernels() {
+
+  /* Supported sets, narrowest first. */
+  const CMT_KernelSet * apsSupported[3];
+  int iSupportedCount = 0;
+  apsSupported[iSupportedCount++] = &g_sBaselineKernels;
+
+#ifdef CMT_DISPATCH_X86
+  /* These check that the operating system saves the wider registers
+     as well as that the processor has them. */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    apsSupported[iSupportedCount++] = &g_sAVX2Kernels;
+  if (__builtin_cpu_supports("avx512f"))
+    apsSupported[iSupportedCount++] = &g_sAVX512Kernels;
+#endif
+
+  g_psKernels = apsSupported[iSupportedCount - 1];
+
+  const char * pcRequest = getenv("CMT_KERNELS");
+  if (pcRequest != NULL)
+    for (int iSet = 0; iSet < iSupportedCount; iSet++)
+      if (strcmp(pcRequest, apsSupported[iSet]->m_pcName) == 0)
+	g_psKernels = apsSupported[iSet];
+}
+
+/*****************************************************************************/
+
+const char *
+cmt_get_kernel_set() {
+  return g_psKernels->m_pcName;
+}
+
+/*****************************************************************************/
+
+/* EOF */
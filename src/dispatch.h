@@ -0,0 +1,204 @@
+/* dispatch.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_DISPATCH_INCLUDED
+#define CMT_DISPATCH_INCLUDED
+
+/*****************************************************************************/
+
+/* Block kernels chosen when the library starts. The kernels in
+   kernels.h are built for the processor the library is compiled for,
+   usually SSE2 on x86-64 and NEON on ARM. On x86 the busiest are
+   built again for AVX2 and AVX-512 (see kernels_wide.h), and
+   selectKernels() picks the widest set the processor supports, so
+   one build runs well everywhere without risking illegal
+   instructions. Plugins reach these kernels through the dispatch
+   wrappers below, costing an indirect call per block.
+
+   Setting the environment variable CMT_KERNELS to the name of a set
+   ("sse", "neon", "generic", "avx2" or "avx512") forces that set if
+   the processor supports it, so the paths can be compared (see
+   cmt_get_kernel_set() in cmt_host.h). */
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+
+/*****************************************************************************/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CMT_DISPATCH_X86
+#endif
+
+/*****************************************************************************/
+
+/** One build of the dispatched kernels. See kernels.h for what each
+    does; the arrays are indexed by bAdding. */
+struct CMT_KernelSet {
+
+  const char * m_pcName;
+
+  void (*m_afMixBuffers[2])(LADSPA_Data *       pfOutput,
+			    const LADSPA_Data * pfInputA,
+			    const LADSPA_Data   fGainA,
+			    const LADSPA_Data * pfInputB,
+			    const LADSPA_Data   fGainB,
+			    const unsigned long lSampleCount);
+
+  void (*m_afMixWithFeedback[2])(LADSPA_Data *       pfOutput,
+				 LADSPA_Data *       pfFeedback,
+				 const LADSPA_Data * pfInput,
+				 const LADSPA_Data * pfDelayed,
+				 const LADSPA_Data   fDry,
+				 const LADSPA_Data   fWet,
+				 const LADSPA_Data   fFeedback,
+				 const unsigned long lSampleCount);
+
+  void (*m_afWriteGainRamp[2])(LADSPA_Data *       pfOutput,
+			       const LADSPA_Data * pfInput,
+			       const LADSPA_Data   fGain,
+			       const LADSPA_Data   fGainStep,
+			       const unsigned long lSampleCount);
+
+  void (*m_afMixGainRamps[2])(LADSPA_Data *               pfOutput,
+			      const LADSPA_Data * const * ppfInputs,
+			      const LADSPA_Data *         pfGain,
+			      const LADSPA_Data *         pfGainStep,
+			      const unsigned long         lInputCount,
+			      const unsigned long         lSampleCount);
+
+  LADSPA_Data (*m_fDotProduct)(const LADSPA_Data * pfA,
+			       const LADSPA_Data * pfB,
+			       const unsigned long lCount);
+
+  void (*m_fMultiplyAccumulateSpectrum)
+    (LADSPA_Data *       pfAccumulatorReal,
+     LADSPA_Data *       pfAccumulatorImaginary,
+     const LADSPA_Data * pfAReal,
+     const LADSPA_Data * pfAImaginary,
+     const LADSPA_Data * pfBReal,
+     const LADSPA_Data * pfBImaginary,
+     const unsigned long lBinCount);
+
+};
+
+/** Build a CMT_KernelSet from the kernels in scope, which are those of
+    kernels.h or kernels_wide.h. */
+#define CMT_KERNEL_SET(NAME)						\
+  {									\
+    NAME,								\
+    { mixBuffers<false>, mixBuffers<true> },				\
+    { mixWithFeedback<false>, mixWithFeedback<true> },			\
+    { applyGainRamp, addGainRamp },					\
+    { mixGainRamps<false>, mixGainRamps<true> },			\
+    dotProduct,								\
+    multiplyAccumulateSpectrum						\
+  }
+
+#ifdef CMT_DISPATCH_X86
+extern const CMT_KernelSet g_sAVX2Kernels;
+extern const CMT_KernelSet g_sAVX512Kernels;
+#endif
+
+/** The kernels in use. This starts as the baseline set so is always
+    valid, and is changed only by selectKernels(). */
+extern const CMT_KernelSet * g_psKernels;
+
+/** Choose the kernels. Called once before any plugin is registered. */
+void selectKernels();
+
+/*****************************************************************************/
+
+template <bool bAdding = false>
+inline void
+dispatchMixBuffers(LADSPA_Data *       pfOutput,
+		   const LADSPA_Data * pfInputA,
+		   const LADSPA_Data   fGainA,
+		   const LADSPA_Data * pfInputB,
+		   const LADSPA_Data   fGainB,
+		   const unsigned long lSampleCount) {
+  g_psKernels->m_afMixBuffers[bAdding]
+    (pfOutput, pfInputA, fGainA, pfInputB, fGainB, lSampleCount);
+}
+
+template <bool bAdding = false>
+inline void
+dispatchMixWithFeedback(LADSPA_Data *       pfOutput,
+			LADSPA_Data *       pfFeedback,
+			const LADSPA_Data * pfInput,
+			const LADSPA_Data * pfDelayed,
+			const LADSPA_Data   fDry,
+			const LADSPA_Data   fWet,
+			const LADSPA_Data   fFeedback,
+			const unsigned long lSampleCount) {
+  g_psKernels->m_afMixWithFeedback[bAdding]
+    (pfOutput, pfFeedback, pfInput, pfDelayed, fDry, fWet, fFeedback,
+     lSampleCount);
+}
+
+/** applyGainRamp() or, with bAdding set, addGainRamp(). */
+template <bool bAdding = false>
+inline void
+dispatchWriteGainRamp(LADSPA_Data *       pfOutput,
+		      const LADSPA_Data * pfInput,
+		      const LADSPA_Data   fGain,
+		      const LADSPA_Data   fGainStep,
+		      const unsigned long lSampleCount) {
+  g_psKernels->m_afWriteGainRamp[bAdding]
+    (pfOutput, pfInput, fGain, fGainStep, lSampleCount);
+}
+
+template <bool bAdding = false>
+inline void
+dispatchMixGainRamps(LADSPA_Data *               pfOutput,
+		     const LADSPA_Data * const * ppfInputs,
+		     const LADSPA_Data *         pfGain,
+		     const LADSPA_Data *         pfGainStep,
+		     const unsigned long         lInputCount,
+		     const unsigned long         lSampleCount) {
+  g_psKernels->m_afMixGainRamps[bAdding]
+    (pfOutput, ppfInputs, pfGain, pfGainStep, lInputCount, lSampleCount);
+}
+
+inline LADSPA_Data
+dispatchDotProduct(const LADSPA_Data * pfA,
+		   const LADSPA_Data * pfB,
+		   const unsigned long lCount) {
+  return g_psKernels->m_fDotProduct(pfA, pfB, lCount);
+}
+
+inline void
+dispatchMultiplyAccumulateSpectrum(LADSPA_Data *       pfAccumulatorReal,
+				   LADSPA_Data *       pfAccumulatorImaginary,
+				   const LADSPA_Data * pfAReal,
+				   const LADSPA_Data * pfAImaginary,
+				   const LADSPA_Data * pfBReal,
+				   const LADSPA_Data * pfBImaginary,
+				   const unsigned long lBinCount) {
+  g_psKernels->m_fMultiplyAccumulateSpectrum
+    (pfAccumulatorReal, pfAccumulatorImaginary,
+     pfAReal, pfAImaginary, pfBReal, pfBImaginary, lBinCount);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -34,16 +34,23 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "dispatch.h"
+#include "run_adding.h"
 #include "utils.h"
 
 /*****************************************************************************/
 
+template <class T>
+static void setDynamicProcessorRunAddingGain(LADSPA_Handle Instance,
+					     LADSPA_Data Gain);
+
 class DynamicProcessor {
 protected:
 
@@ -55,10 +62,17 @@ protected:
   /** The sample rate in the world this instance exists in. */
   LADSPA_Data m_fSampleRate;
 
+  LADSPA_Data m_fRunAddingGain;
+
   DynamicProcessor(const LADSPA_Data fSampleRate)
-    : m_fSampleRate(fSampleRate) {
+    : m_fSampleRate(fSampleRate),
+      m_fRunAddingGain(1) {
   }
 
+  template <class T>
+  friend void setDynamicProcessorRunAddingGain(LADSPA_Handle Instance,
+					       LADSPA_Data Gain);
+
 };
 
 /*****************************************************************************/
@@ -71,12 +85,16 @@ protected:
 #define CE_OUTPUT     5
 
 static void activateCompressorExpander(void * pvHandle);
+template <OutputFunction write_output>
 static void runCompressor_Peak(LADSPA_Handle Instance,
                                unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runCompressor_RMS(LADSPA_Handle Instance,
                               unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runExpander_Peak(LADSPA_Handle Instance,
                              unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runExpander_RMS(LADSPA_Handle Instance,
                             unsigned long SampleCount);
   
@@ -95,12 +113,16 @@ public:
   }
   
   friend void activateCompressorExpander(void * pvHandle);
+  template <OutputFunction write_output>
   friend void runCompressor_Peak(LADSPA_Handle Instance,
 				 unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runCompressor_RMS(LADSPA_Handle Instance,
 				unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runExpander_Peak(LADSPA_Handle Instance,
 			       unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runExpander_RMS(LADSPA_Handle Instance,
 			      unsigned long SampleCount);
   
@@ -115,8 +137,10 @@ public:
 #define LN_OUTPUT     4
 
 static void activateLimiter(void * pvHandle);
+template <OutputFunction write_output>
 static void runLimiter_Peak(LADSPA_Handle Instance,
                             unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runLimiter_RMS(LADSPA_Handle Instance,
                            unsigned long SampleCount);
   
@@ -135,8 +159,10 @@ public:
   }
   
   friend void activateLimiter(void * pvHandle);
+  template <OutputFunction write_output>
   friend void runLimiter_Peak(LADSPA_Handle Instance,
 			      unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runLimiter_RMS(LADSPA_Handle Instance,
 			     unsigned long SampleCount);
   
@@ -144,6 +170,182 @@ public:
 
 /*****************************************************************************/
 
+/** Modes for the fast processors. */
+#define DP_COMPRESSOR 0
+#define DP_EXPANDER   1
+#define DP_LIMITER    2
+
+/* The fast processors have the compressor/expander or limiter control
+   ports above followed by the audio inputs, the audio outputs and a
+   gain update interval port. With one channel this is the layout of
+   the plugins above with the interval port added at the end. The
+   multichannel versions share one detector between all channels. */
+#define DP_CONTROL_COUNT(iMode)      ((iMode) == DP_LIMITER ? 3 : 4)
+#define DP_INPUT(iMode, lChannel)    (DP_CONTROL_COUNT(iMode) + (lChannel))
+#define DP_OUTPUT(iMode, lChannelCount, lChannel)	\
+  (DP_CONTROL_COUNT(iMode) + (lChannelCount) + (lChannel))
+#define DP_INTERVAL(iMode, lChannelCount)		\
+  (DP_CONTROL_COUNT(iMode) + 2 * (lChannelCount))
+
+/** Most channels handled by a fast processor. */
+#define DP_MAXIMUM_CHANNELS 8
+
+/** Longest gain update interval (in samples) for the fast
+    processors. */
+#define DP_MAXIMUM_INTERVAL 256
+
+static void activateFastDynamicProcessor(void * pvHandle);
+template <int iMode, bool bRMS, long lChannelCount, 
+	  OutputFunction write_output>
+static void runFastDynamicProcessor(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+
+/** This class is used to implement the fast compressor, expander and
+    limiter plugins. These track the envelope in the same way as the
+    plugins above but use an approximate gain computer and can
+    optionally update the envelope and gain at control rate. */
+class FastDynamicProcessor
+  : public CMT_PluginInstance, public DynamicProcessor {
+public:
+
+  /** Gain applied at the end of the last block. */
+  LADSPA_Data m_fGain;
+
+  FastDynamicProcessor(const LADSPA_Descriptor *,
+		       unsigned long lSampleRate)
+    : CMT_PluginInstance(DP_INTERVAL(DP_COMPRESSOR, 
+				      DP_MAXIMUM_CHANNELS) + 1),
+    DynamicProcessor(lSampleRate) {
+  }
+  
+  friend void activateFastDynamicProcessor(void * pvHandle);
+  template <int iMode, bool bRMS, long lChannelCount, 
+	    OutputFunction write_output>
+  friend void runFastDynamicProcessor(LADSPA_Handle Instance,
+				      unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+#define LL_THRESHOLD  0
+#define LL_LOOKAHEAD  1
+#define LL_RELEASE    2
+#define LL_TRUE_PEAK  3
+#define LL_INPUT      4
+#define LL_OUTPUT     5
+#define LL_LATENCY    6
+
+/** Longest look-ahead time (in seconds). */
+#define LL_MAXIMUM_LOOKAHEAD 0.02f
+
+/** The true peak detector interpolates LL_TRUE_PEAK_PHASES - 1 points
+    between each pair of samples (i.e. it oversamples by
+    LL_TRUE_PEAK_PHASES) using windowed sinc filters of
+    LL_TRUE_PEAK_TAPS taps. The detector runs LL_TRUE_PEAK_DELAY
+    samples behind the input so the filter has the samples it needs;
+    this delay is applied whether or not true peak detection is on so
+    the latency does not change with it. */
+#define LL_TRUE_PEAK_PHASES 4
+#define LL_TRUE_PEAK_TAPS   12
+#define LL_TRUE_PEAK_DELAY  (LL_TRUE_PEAK_TAPS / 2)
+
+static void activateLookAheadLimiter(LADSPA_Handle Instance);
+template <OutputFunction write_output>
+static void runLookAheadLimiter(LADSPA_Handle Instance,
+				unsigned long SampleCount);
+
+/** This class is used to implement a look-ahead limiter. The input is
+    delayed while the gain needed to keep each sample under the
+    threshold is found. The gain applied is the minimum of the
+    required gain over a window of look-ahead samples (tracked with a
+    monotonic deque so this costs O(1) per sample), smoothed by a
+    moving average over the same window so it ramps down over the
+    look-ahead time and reaches the required gain by the time the
+    peak leaves the delay. Release is smoothed separately. All buffers
+    are allocated when the plugin is instantiated. */
+class LookAheadLimiter : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_fSampleRate;
+
+  /** Longest look-ahead window (in samples). */
+  unsigned long m_lMaximumWindow;
+
+  /** Look-ahead window currently in use (in samples) or zero if none
+      has been set up since activation. */
+  unsigned long m_lWindow;
+
+  /** Input delay line, a power of two in size. */
+  LADSPA_Data * m_pfBuffer;
+  unsigned long m_lBufferSize;
+  unsigned long m_lWritePointer;
+
+  /** Monotonic deque of (sample index, required gain) pairs used to
+      track the minimum required gain over the window. This is a ring
+      buffer with a power of two size. */
+  unsigned long * m_plDequeIndices;
+  LADSPA_Data * m_pfDequeGains;
+  unsigned long m_lDequeSize;
+  unsigned long m_lDequeHead;
+  unsigned long m_lDequeCount;
+
+  /** Detector sample counter used to expire deque entries. */
+  unsigned long m_lSampleIndex;
+
+  /** Ring buffer of windowed minima for the moving average. */
+  LADSPA_Data * m_pfAverageBuffer;
+  unsigned long m_lAveragePointer;
+  double m_dAverageSum;
+
+  /** Gain applied to the last output sample. */
+  LADSPA_Data m_fGain;
+
+  /** Largest interpolated value between the last pair of samples
+      seen by the true peak detector. */
+  LADSPA_Data m_fLastInterSamplePeak;
+
+  /** The last LL_TRUE_PEAK_TAPS input samples, stored twice over so
+      the true peak filters can always read them contiguously from
+      m_afHistory + m_lHistoryPointer + 1. */
+  LADSPA_Data m_afHistory[2 * LL_TRUE_PEAK_TAPS];
+  unsigned long m_lHistoryPointer;
+
+  /** Interpolation filters for the true peak detector, one for each
+      point between samples. */
+  LADSPA_Data m_aafTruePeakFilters[LL_TRUE_PEAK_PHASES - 1][LL_TRUE_PEAK_TAPS];
+
+  LADSPA_Data m_fRunAddingGain;
+
+  void resetDetector(const unsigned long lWindow);
+
+  friend void activateLookAheadLimiter(LADSPA_Handle Instance);
+  template <class T>
+  friend void setDynamicProcessorRunAddingGain(LADSPA_Handle Instance,
+					       LADSPA_Data Gain);
+  template <OutputFunction write_output>
+  friend void runLookAheadLimiter(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+
+public:
+
+  LookAheadLimiter(const LADSPA_Descriptor *,
+		   unsigned long lSampleRate);
+  ~LookAheadLimiter();
+
+};
+
+/*****************************************************************************/
+
+template <class T>
+static void
+setDynamicProcessorRunAddingGain(LADSPA_Handle Instance,
+				 LADSPA_Data Gain) {
+  ((T *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
 static void 
 activateCompressorExpander(void * pvHandle) {
   CompressorExpander * poProcessor = (CompressorExpander *)pvHandle;
@@ -160,6 +362,16 @@ activateLimiter(void * pvHandle) {
 
 /*****************************************************************************/
 
+static void 
+activateFastDynamicProcessor(void * pvHandle) {
+  FastDynamicProcessor * poProcessor = (FastDynamicProcessor *)pvHandle;
+  poProcessor->m_fEnvelopeState = 0;
+  poProcessor->m_fGain = 1;
+}
+
+/*****************************************************************************/
+
+template <OutputFunction write_output>
 static void 
 runCompressor_Peak(LADSPA_Handle Instance,
 		   unsigned long SampleCount) {
@@ -213,12 +425,13 @@ runCompressor_Peak(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
   }
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void 
 runCompressor_RMS(LADSPA_Handle Instance,
 		  unsigned long SampleCount) {
@@ -274,12 +487,13 @@ runCompressor_RMS(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
   }
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void 
 runExpander_Peak(LADSPA_Handle Instance,
 		 unsigned long SampleCount) {
@@ -333,12 +547,13 @@ runExpander_Peak(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
   }
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void 
 runExpander_RMS(LADSPA_Handle Instance,
 		  unsigned long SampleCount) {
@@ -394,12 +609,481 @@ runExpander_RMS(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
+  }
+}
+
+/*****************************************************************************/
+
+/** Gain computer for the fast processors. The gain map is evaluated
+    in the log domain with fastLog2() and fastExp2() rather than
+    pow():
+
+      gain = 2 ^ (exponent * (log2(envelope) - log2(threshold)))
+
+    outside the threshold and 1 inside it. For RMS tracking log2 of the
+    amplitude is taken as half log2 of the mean square, so no square
+    root is needed either. The limiter is the compressor with an
+    exponent of -1. The relative gain error against the pow() version
+    is below 2e-5 * |exponent| + 5e-6 (under 2.5e-5, around -90dB, for
+    ratios in [0, 1]). As output is not bit-identical the fast
+    processors have their own IDs. */
+template <int iMode, bool bRMS>
+class FastGainComputer {
+private:
+
+  LADSPA_Data m_fEnvelopeThreshold;
+  LADSPA_Data m_fLog2Threshold;
+  LADSPA_Data m_fExponent;
+
+public:
+
+  FastGainComputer(LADSPA_Data fThreshold, 
+		   const LADSPA_Data fRatio) {
+    /* A zero threshold is treated as a very small one. The envelope
+       is compared against the threshold in its own units (squared
+       for RMS). */
+    fThreshold = BOUNDED_BELOW(fThreshold, 1e-15f);
+    m_fEnvelopeThreshold = bRMS ? fThreshold * fThreshold : fThreshold;
+    m_fLog2Threshold = log2(fThreshold);
+    switch (iMode) {
+    case DP_EXPANDER:
+      m_fExponent = 1 - fRatio;
+      break;
+    case DP_LIMITER:
+      m_fExponent = -1;
+      break;
+    default:
+      m_fExponent = fRatio - 1;
+      break;
+    }
+  }
+
+  inline LADSPA_Data gain(const LADSPA_Data fEnvelopeState) const {
+    if (iMode == DP_EXPANDER
+	? fEnvelopeState >= m_fEnvelopeThreshold
+	: fEnvelopeState <= m_fEnvelopeThreshold)
+      return 1;
+    LADSPA_Data fLevel = fastLog2(fEnvelopeState);
+    if (bRMS)
+      fLevel *= 0.5f;
+    return fastExp2(m_fExponent * (fLevel - m_fLog2Threshold));
   }
+
+};
+
+/*****************************************************************************/
+
+/** Envelope follower step shared by the fast processors. */
+inline LADSPA_Data
+trackEnvelope(const LADSPA_Data fEnvelopeState,
+	      const LADSPA_Data fEnvelopeTarget,
+	      const LADSPA_Data fEnvelopeDrag_Attack,
+	      const LADSPA_Data fEnvelopeDrag_Decay) {
+  if (fEnvelopeTarget > fEnvelopeState)
+    return (fEnvelopeState * fEnvelopeDrag_Attack
+	    + fEnvelopeTarget * (1 - fEnvelopeDrag_Attack));
+  else
+    return (fEnvelopeState * fEnvelopeDrag_Decay
+	    + fEnvelopeTarget * (1 - fEnvelopeDrag_Decay));
+}
+
+/*****************************************************************************/
+
+/** Run a fast compressor, expander or limiter.
+
+    With a gain update interval of one the gain is computed every
+    sample. With an interval of N each block is split into segments of
+    N samples (the last may be shorter). The envelope is still tracked
+    every sample, as this is cheap, but the gain is only computed at
+    the end of each segment and is ramped linearly across it from the
+    previous value, so the per-sample gain work becomes a vectorised
+    multiply. The error is bounded: the envelope, and so the gain at
+    the end of each segment, is exactly that of per-sample processing,
+    and within a segment both the interpolated and the exact gain lie
+    between the lowest and highest exact gain over the segment. The
+    gain error at any sample is therefore no larger than the change in
+    gain across one segment, which is only significant during fast
+    attacks (N = 16 at 48kHz is 0.33ms). */
+template <int iMode, bool bRMS, long lChannelCount, 
+	  OutputFunction write_output>
+static void 
+runFastDynamicProcessor(LADSPA_Handle Instance,
+			unsigned long SampleCount) {
+
+  FastDynamicProcessor * poProcessor = (FastDynamicProcessor *)Instance;
+
+  const bool bLimiter = (iMode == DP_LIMITER);
+  LADSPA_Data ** ppfPorts = poProcessor->m_ppfPorts;
+
+  FastGainComputer<iMode, bRMS> oGainComputer
+    (*(ppfPorts[bLimiter ? LN_THRESHOLD : CE_THRESHOLD]),
+     bLimiter ? 0 : *(ppfPorts[CE_RATIO]));
+  LADSPA_Data fAttack
+    = *(ppfPorts[bLimiter ? LN_ATTACK : CE_ATTACK]);
+  LADSPA_Data fDecay
+    = *(ppfPorts[bLimiter ? LN_DECAY : CE_DECAY]);
+  LADSPA_Data * apfInputs[lChannelCount];
+  LADSPA_Data * apfOutputs[lChannelCount];
+  for (long lChannel = 0; lChannel < lChannelCount; lChannel++) {
+    apfInputs[lChannel] 
+      = ppfPorts[DP_INPUT(iMode, lChannel)];
+    apfOutputs[lChannel]
+      = ppfPorts[DP_OUTPUT(iMode, lChannelCount, lChannel)];
+  }
+  unsigned long lInterval
+    = (unsigned long)BOUNDED(*(ppfPorts[DP_INTERVAL(iMode, lChannelCount)]),
+			     1,
+			     DP_MAXIMUM_INTERVAL);
+
+  LADSPA_Data fEnvelopeDrag_Attack 
+    = calculate60dBDrag(fAttack, poProcessor->m_fSampleRate);
+  LADSPA_Data fEnvelopeDrag_Decay   
+    = calculate60dBDrag(fDecay, poProcessor->m_fSampleRate);
+ 
+  LADSPA_Data fEnvelopeState
+    = poProcessor->m_fEnvelopeState;
+  LADSPA_Data fGain
+    = poProcessor->m_fGain;
+  LADSPA_Data fRunAddingGain
+    = poProcessor->m_fRunAddingGain;
+
+  /* The channels share one detector, which sees the largest
+     magnitude or the mean square across them. All inputs for a
+     sample are read before any output is written so in-place
+     processing is safe. */
+  LADSPA_Data afInputs[lChannelCount];
+
+  for (unsigned long lSampleIndex = 0; 
+       lSampleIndex < SampleCount; 
+       lSampleIndex += lInterval) {
+
+    unsigned long lSegmentLength = SampleCount - lSampleIndex;
+    if (lSegmentLength > lInterval)
+      lSegmentLength = lInterval;
+
+    if (lInterval == 1) {
+      
+      LADSPA_Data fEnvelopeTarget = 0;
+      for (long lChannel = 0; lChannel < lChannelCount; lChannel++) {
+	LADSPA_Data fInput = apfInputs[lChannel][lSampleIndex];
+	afInputs[lChannel] = fInput;
+	if (bRMS)
+	  fEnvelopeTarget += fInput * fInput;
+	else if (fabs(fInput) > fEnvelopeTarget)
+	  fEnvelopeTarget = fabs(fInput);
+      }
+      if (bRMS && lChannelCount > 1)
+	fEnvelopeTarget *= LADSPA_Data(1.0 / lChannelCount);
+      fEnvelopeState = trackEnvelope(fEnvelopeState,
+				     fEnvelopeTarget,
+				     fEnvelopeDrag_Attack,
+				     fEnvelopeDrag_Decay);
+
+      fGain = oGainComputer.gain(fEnvelopeState);
+      for (long lChannel = 0; lChannel < lChannelCount; lChannel++)
+	write_control<write_output>(apfOutputs[lChannel] + lSampleIndex,
+				    afInputs[lChannel] * fGain,
+				    fRunAddingGain);
+
+    }
+    else {
+
+      /* Run the envelope across the segment... */
+      for (unsigned long lIndex = lSampleIndex; 
+	   lIndex < lSampleIndex + lSegmentLength; 
+	   lIndex++) {
+	LADSPA_Data fEnvelopeTarget = 0;
+	for (long lChannel = 0; lChannel < lChannelCount; lChannel++) {
+	  LADSPA_Data fInput = apfInputs[lChannel][lIndex];
+	  if (bRMS)
+	    fEnvelopeTarget += fInput * fInput;
+	  else if (fabs(fInput) > fEnvelopeTarget)
+	    fEnvelopeTarget = fabs(fInput);
+	}
+	if (bRMS && lChannelCount > 1)
+	  fEnvelopeTarget *= LADSPA_Data(1.0 / lChannelCount);
+	fEnvelopeState = trackEnvelope(fEnvelopeState,
+				       fEnvelopeTarget,
+				       fEnvelopeDrag_Attack,
+				       fEnvelopeDrag_Decay);
+      }
+
+      /* ...then ramp to the gain for its end. A mono buffer can be
+	 ramped in one pass; otherwise work across the channels. */
+      LADSPA_Data fSegmentGain = oGainComputer.gain(fEnvelopeState);
+      LADSPA_Data fGainStep = (fSegmentGain - fGain) / lSegmentLength;
+      if (lChannelCount == 1)
+	dispatchWriteGainRamp<is_adding<write_output>()>
+	  (apfOutputs[0] + lSampleIndex,
+	   apfInputs[0] + lSampleIndex,
+	   fGain * get_gain<write_output>(fRunAddingGain),
+	   fGainStep * get_gain<write_output>(fRunAddingGain),
+	   lSegmentLength);
+      else
+	for (unsigned long lIndex = 0; lIndex < lSegmentLength; lIndex++) {
+	  LADSPA_Data fRampGain = fGain + LADSPA_Data(lIndex + 1) * fGainStep;
+	  for (long lChannel = 0; lChannel < lChannelCount; lChannel++)
+	    afInputs[lChannel] = apfInputs[lChannel][lSampleIndex + lIndex];
+	  for (long lChannel = 0; lChannel < lChannelCount; lChannel++)
+	    write_control<write_output>
+	      (apfOutputs[lChannel] + lSampleIndex + lIndex,
+	       afInputs[lChannel] * fRampGain,
+	       fRunAddingGain);
+	}
+      fGain = fSegmentGain;
+
+    }
+  }
+
+  poProcessor->m_fEnvelopeState = fEnvelopeState;
+  poProcessor->m_fGain = fGain;
+}
+
+/*****************************************************************************/
+
+LookAheadLimiter::LookAheadLimiter(const LADSPA_Descriptor *,
+				   unsigned long lSampleRate)
+  : CMT_PluginInstance(7),
+    m_fSampleRate(LADSPA_Data(lSampleRate)),
+    m_lWindow(0),
+    m_fRunAddingGain(1) {
+
+  m_lMaximumWindow 
+    = (unsigned long)(LL_MAXIMUM_LOOKAHEAD * m_fSampleRate) + 1;
+
+  /* The delay line holds the detector delay and the window. */
+  m_lBufferSize = 1;
+  while (m_lBufferSize < m_lMaximumWindow + LL_TRUE_PEAK_DELAY + 1)
+    m_lBufferSize <<= 1;
+  m_pfBuffer = new LADSPA_Data[m_lBufferSize];
+
+  m_lDequeSize = 1;
+  while (m_lDequeSize < m_lMaximumWindow)
+    m_lDequeSize <<= 1;
+  m_plDequeIndices = new unsigned long[m_lDequeSize];
+  m_pfDequeGains = new LADSPA_Data[m_lDequeSize];
+
+  m_pfAverageBuffer = new LADSPA_Data[m_lMaximumWindow];
+
+  /* Hann windowed sinc interpolators. Filter iPhase estimates the
+     signal (iPhase + 1) / LL_TRUE_PEAK_PHASES of the way from sample
+     LL_TRUE_PEAK_TAPS / 2 - 1 to the next in the taps it is applied
+     to. Each is normalised for unity gain at DC. */
+  for (int iPhase = 0; iPhase < LL_TRUE_PEAK_PHASES - 1; iPhase++) {
+    double dSum = 0;
+    for (int iTap = 0; iTap < LL_TRUE_PEAK_TAPS; iTap++) {
+      double dOffset 
+	= (LL_TRUE_PEAK_TAPS / 2 - 1 - iTap
+	   + double(iPhase + 1) / LL_TRUE_PEAK_PHASES);
+      double dX = M_PI * dOffset;
+      double dSinc = (dX == 0 ? 1 : sin(dX) / dX);
+      double dWindow 
+	= 0.5 + 0.5 * cos(M_PI * dOffset / (LL_TRUE_PEAK_TAPS / 2));
+      m_aafTruePeakFilters[iPhase][iTap] = LADSPA_Data(dSinc * dWindow);
+      dSum += dSinc * dWindow;
+    }
+    for (int iTap = 0; iTap < LL_TRUE_PEAK_TAPS; iTap++)
+      m_aafTruePeakFilters[iPhase][iTap] /= dSum;
+  }
+}
+
+LookAheadLimiter::~LookAheadLimiter() {
+  delete [] m_pfBuffer;
+  delete [] m_plDequeIndices;
+  delete [] m_pfDequeGains;
+  delete [] m_pfAverageBuffer;
+}
+
+/*****************************************************************************/
+
+/** Restart gain detection with a new window length. The windowed
+    minimum and its average start from the current gain. */
+void
+LookAheadLimiter::resetDetector(const unsigned long lWindow) {
+  m_lWindow = lWindow;
+  m_lDequeHead = 0;
+  m_lDequeCount = 0;
+  for (unsigned long lIndex = 0; lIndex < lWindow; lIndex++)
+    m_pfAverageBuffer[lIndex] = m_fGain;
+  m_lAveragePointer = 0;
+  m_dAverageSum = double(m_fGain) * lWindow;
+}
+
+/*****************************************************************************/
+
+static void
+activateLookAheadLimiter(LADSPA_Handle Instance) {
+
+  LookAheadLimiter * poLimiter = (LookAheadLimiter *)Instance;
+
+  memset(poLimiter->m_pfBuffer,
+	 0,
+	 sizeof(LADSPA_Data) * poLimiter->m_lBufferSize);
+  poLimiter->m_lWritePointer = 0;
+  poLimiter->m_lSampleIndex = 0;
+  poLimiter->m_fGain = 1;
+  poLimiter->m_fLastInterSamplePeak = 0;
+  memset(poLimiter->m_afHistory, 0, sizeof(poLimiter->m_afHistory));
+  poLimiter->m_lHistoryPointer = 0;
+  poLimiter->m_lWindow = 0;
 }
 
 /*****************************************************************************/
 
+/** Run the look-ahead limiter. With a window of W samples the
+    detector looks at sample k = n - LL_TRUE_PEAK_DELAY at time n and
+    finds the gain r[k] needed to bring it (and, for true peak
+    detection, the interpolated points either side of it) to the
+    threshold. The windowed minimum m[k] = min(r[k - W + 1..k]) is
+    averaged over W values to give a[k] <= r[k - W + 1], so a[k] is
+    applied to sample k - W + 1 and the total latency is
+    LL_TRUE_PEAK_DELAY + W - 1 samples. Release smoothing can only
+    lower the gain further, so the (sample or estimated true) peak
+    never exceeds the threshold. */
+template <OutputFunction write_output>
+static void 
+runLookAheadLimiter(LADSPA_Handle Instance,
+		    unsigned long SampleCount) {
+
+  LookAheadLimiter * poLimiter = (LookAheadLimiter *)Instance;
+
+  LADSPA_Data ** ppfPorts = poLimiter->m_ppfPorts;
+
+  LADSPA_Data fThreshold
+    = BOUNDED_BELOW(*(ppfPorts[LL_THRESHOLD]), 0);
+  LADSPA_Data fLookAhead
+    = BOUNDED(*(ppfPorts[LL_LOOKAHEAD]), 0, LL_MAXIMUM_LOOKAHEAD);
+  LADSPA_Data fReleaseDrag
+    = calculate60dBDrag(*(ppfPorts[LL_RELEASE]), poLimiter->m_fSampleRate);
+  bool bTruePeak
+    = *(ppfPorts[LL_TRUE_PEAK]) > 0;
+  LADSPA_Data * pfInput
+    = ppfPorts[LL_INPUT];
+  LADSPA_Data * pfOutput
+    = ppfPorts[LL_OUTPUT];
+
+  unsigned long lWindow 
+    = (unsigned long)(fLookAhead * poLimiter->m_fSampleRate) + 1;
+  if (lWindow > poLimiter->m_lMaximumWindow)
+    lWindow = poLimiter->m_lMaximumWindow;
+  /* A change of window length shifts the output in time, so there
+     will be a discontinuity. */
+  if (lWindow != poLimiter->m_lWindow)
+    poLimiter->resetDetector(lWindow);
+
+  *(ppfPorts[LL_LATENCY]) = LADSPA_Data(LL_TRUE_PEAK_DELAY + lWindow - 1);
+
+  LADSPA_Data * pfBuffer = poLimiter->m_pfBuffer;
+  unsigned long lBufferMask = poLimiter->m_lBufferSize - 1;
+  unsigned long lWritePointer = poLimiter->m_lWritePointer;
+  unsigned long * plDequeIndices = poLimiter->m_plDequeIndices;
+  LADSPA_Data * pfDequeGains = poLimiter->m_pfDequeGains;
+  unsigned long lDequeMask = poLimiter->m_lDequeSize - 1;
+  unsigned long lDequeHead = poLimiter->m_lDequeHead;
+  unsigned long lDequeCount = poLimiter->m_lDequeCount;
+  unsigned long lSampleIndex = poLimiter->m_lSampleIndex;
+  LADSPA_Data * pfAverageBuffer = poLimiter->m_pfAverageBuffer;
+  unsigned long lAveragePointer = poLimiter->m_lAveragePointer;
+  double dAverageSum = poLimiter->m_dAverageSum;
+  double dOneOverWindow = 1.0 / lWindow;
+  LADSPA_Data fGain = poLimiter->m_fGain;
+  LADSPA_Data fRunAddingGain = poLimiter->m_fRunAddingGain;
+  LADSPA_Data fLastInterSamplePeak = poLimiter->m_fLastInterSamplePeak;
+  LADSPA_Data * pfHistory = poLimiter->m_afHistory;
+  unsigned long lHistoryPointer = poLimiter->m_lHistoryPointer;
+
+  for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
+
+    LADSPA_Data fInput = pfInput[lIndex];
+    pfBuffer[lWritePointer] = fInput;
+    pfHistory[lHistoryPointer] 
+      = pfHistory[lHistoryPointer + LL_TRUE_PEAK_TAPS]
+      = fInput;
+    const LADSPA_Data * pfTaps = pfHistory + lHistoryPointer + 1;
+    if (++lHistoryPointer == LL_TRUE_PEAK_TAPS)
+      lHistoryPointer = 0;
+
+    /* Level of the sample being detected. */
+    LADSPA_Data fLevel
+      = fabs(pfBuffer[(lWritePointer - LL_TRUE_PEAK_DELAY) & lBufferMask]);
+    if (bTruePeak) {
+      /* Interpolate between the detected sample and the next. */
+      LADSPA_Data fInterSamplePeak = 0;
+      for (int iPhase = 0; iPhase < LL_TRUE_PEAK_PHASES - 1; iPhase++) {
+	const LADSPA_Data * pfFilter 
+	  = poLimiter->m_aafTruePeakFilters[iPhase];
+	LADSPA_Data fValue = 0;
+	for (int iTap = 0; iTap < LL_TRUE_PEAK_TAPS; iTap++)
+	  fValue += pfFilter[iTap] * pfTaps[iTap];
+	fValue = fabs(fValue);
+	if (fValue > fInterSamplePeak)
+	  fInterSamplePeak = fValue;
+      }
+      if (fLastInterSamplePeak > fLevel)
+	fLevel = fLastInterSamplePeak;
+      if (fInterSamplePeak > fLevel)
+	fLevel = fInterSamplePeak;
+      fLastInterSamplePeak = fInterSamplePeak;
+    }
+    LADSPA_Data fRequiredGain = 1;
+    if (fLevel > fThreshold)
+      fRequiredGain = fThreshold / fLevel;
+
+    /* Windowed minimum. Expire the oldest entry, then drop entries
+       that can no longer be the minimum before adding this one. */
+    if (lDequeCount > 0
+	&& lSampleIndex - plDequeIndices[lDequeHead] >= lWindow) {
+      lDequeHead = (lDequeHead + 1) & lDequeMask;
+      lDequeCount--;
+    }
+    while (lDequeCount > 0
+	   && (pfDequeGains[(lDequeHead + lDequeCount - 1) & lDequeMask]
+	       >= fRequiredGain))
+      lDequeCount--;
+    unsigned long lDequeTail = (lDequeHead + lDequeCount) & lDequeMask;
+    plDequeIndices[lDequeTail] = lSampleIndex;
+    pfDequeGains[lDequeTail] = fRequiredGain;
+    lDequeCount++;
+    lSampleIndex++;
+    LADSPA_Data fMinimumGain = pfDequeGains[lDequeHead];
+
+    /* Moving average of the minimum. */
+    dAverageSum += fMinimumGain - pfAverageBuffer[lAveragePointer];
+    pfAverageBuffer[lAveragePointer] = fMinimumGain;
+    if (++lAveragePointer == lWindow)
+      lAveragePointer = 0;
+    LADSPA_Data fAverageGain = LADSPA_Data(dAverageSum * dOneOverWindow);
+
+    /* Release. */
+    if (fAverageGain < fGain)
+      fGain = fAverageGain;
+    else
+      fGain = fAverageGain - (fAverageGain - fGain) * fReleaseDrag;
+
+    write_control<write_output>
+      (pfOutput + lIndex,
+       (fGain
+	* pfBuffer[(lWritePointer - (LL_TRUE_PEAK_DELAY + lWindow - 1))
+		   & lBufferMask]),
+       fRunAddingGain);
+
+    lWritePointer = (lWritePointer + 1) & lBufferMask;
+  }
+
+  poLimiter->m_lWritePointer = lWritePointer;
+  poLimiter->m_lDequeHead = lDequeHead;
+  poLimiter->m_lDequeCount = lDequeCount;
+  poLimiter->m_lSampleIndex = lSampleIndex;
+  poLimiter->m_lAveragePointer = lAveragePointer;
+  poLimiter->m_dAverageSum = dAverageSum;
+  poLimiter->m_fGain = fGain;
+  poLimiter->m_fLastInterSamplePeak = fLastInterSamplePeak;
+  poLimiter->m_lHistoryPointer = lHistoryPointer;
+}
+/*****************************************************************************/
+
+template <OutputFunction write_output>
 static void 
 runLimiter_Peak(LADSPA_Handle Instance,
 		unsigned long SampleCount) {
@@ -449,12 +1133,13 @@ runLimiter_Peak(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
   }
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 static void 
 runLimiter_RMS(LADSPA_Handle Instance,
 		unsigned long SampleCount) {
@@ -506,12 +1191,96 @@ runLimiter_RMS(LADSPA_Handle Instance,
     }
 
     /* Perform output. */
-    *(pfOutput++) = fInput * fGain;
+    write_output(pfOutput, fInput * fGain, poProcessor->m_fRunAddingGain);
   }
 }
 
 /*****************************************************************************/
 
+/** Register one of the fast processors, see runFastDynamicProcessor()
+    for the port layout. */
+static void
+registerFastDynamicProcessor(const unsigned long lUniqueID,
+			     const char * pcLabel,
+			     const char * pcName,
+			     const int iMode,
+			     const long lChannelCount,
+			     LADSPA_Run_Function fRun,
+			     LADSPA_Run_Adding_Function fRunAdding) {
+
+  CMT_Descriptor * psDescriptor = new CMT_Descriptor
+    (lUniqueID,
+     pcLabel,
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+     pcName,
+     CMT_MAKER("Richard W.E. Furse"),
+     CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+     NULL,
+     CMT_Instantiate<FastDynamicProcessor>,
+     activateFastDynamicProcessor,
+     fRun,
+     fRunAdding,
+     setDynamicProcessorRunAddingGain<FastDynamicProcessor>,
+     NULL);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Threshold",
+     (LADSPA_HINT_BOUNDED_BELOW 
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_1),
+     0,
+     0);
+  if (iMode != DP_LIMITER)
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       iMode == DP_COMPRESSOR ? "Compression Ratio" : "Expansion Ratio",
+       (LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_DEFAULT_MIDDLE),
+       0,
+       1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Output Envelope Attack (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_DEFAULT_MAXIMUM),
+     0,
+     0.1f);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Output Envelope Decay (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_DEFAULT_MAXIMUM),
+     0,
+     0.1f);
+  for (int iOutput = 0; iOutput < 2; iOutput++)
+    for (long lChannel = 0; lChannel < lChannelCount; lChannel++) {
+      char acPortName[40];
+      if (lChannelCount == 1)
+	strcpy(acPortName, iOutput ? "Output" : "Input");
+      else
+	sprintf(acPortName, 
+		"%s %ld", 
+		iOutput ? "Output" : "Input",
+		lChannel + 1);
+      psDescriptor->addPort
+	((iOutput ? LADSPA_PORT_OUTPUT : LADSPA_PORT_INPUT)
+	 | LADSPA_PORT_AUDIO,
+	 acPortName);
+    }
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Gain Update Interval (Samples)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_INTEGER
+      | LADSPA_HINT_DEFAULT_1),
+     1,
+     DP_MAXIMUM_INTERVAL);
+  registerNewPluginDescriptor(psDescriptor);
+}
+
+/*****************************************************************************/
+
 void 
 initialise_dynamic() {
   
@@ -527,9 +1296,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<CompressorExpander>,
      activateCompressorExpander,
-     runCompressor_Peak,
-     NULL,
-     NULL,
+     runCompressor_Peak<write_output_normal>,
+     runCompressor_Peak<write_output_adding>,
+     setDynamicProcessorRunAddingGain<CompressorExpander>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -578,9 +1347,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<CompressorExpander>,
      activateCompressorExpander,
-     runCompressor_RMS,
-     NULL,
-     NULL,
+     runCompressor_RMS<write_output_normal>,
+     runCompressor_RMS<write_output_adding>,
+     setDynamicProcessorRunAddingGain<CompressorExpander>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -629,9 +1398,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<CompressorExpander>,
      activateCompressorExpander,
-     runExpander_Peak,
-     NULL,
-     NULL,
+     runExpander_Peak<write_output_normal>,
+     runExpander_Peak<write_output_adding>,
+     setDynamicProcessorRunAddingGain<CompressorExpander>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -680,9 +1449,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<CompressorExpander>,
      activateCompressorExpander,
-     runExpander_RMS,
-     NULL,
-     NULL,
+     runExpander_RMS<write_output_normal>,
+     runExpander_RMS<write_output_adding>,
+     setDynamicProcessorRunAddingGain<CompressorExpander>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -731,9 +1500,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<Limiter>,
      activateLimiter,
-     runLimiter_Peak,
-     NULL,
-     NULL,
+     runLimiter_Peak<write_output_normal>,
+     runLimiter_Peak<write_output_adding>,
+     setDynamicProcessorRunAddingGain<Limiter>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -775,9 +1544,9 @@ initialise_dynamic() {
      NULL,
      CMT_Instantiate<Limiter>,
      activateLimiter,
-     runLimiter_RMS,
-     NULL,
-     NULL,
+     runLimiter_RMS<write_output_normal>,
+     runLimiter_RMS<write_output_adding>,
+     setDynamicProcessorRunAddingGain<Limiter>,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -808,6 +1577,197 @@ initialise_dynamic() {
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");
   registerNewPluginDescriptor(psDescriptor);
+
+  /* Fast versions of the compressors, expanders and limiters. */
+  const char * apcFastLabels[6] = {
+    "compress_peak_fast",
+    "compress_rms_fast",
+    "expand_peak_fast",
+    "expand_rms_fast",
+    "limit_peak_fast",
+    "limit_rms_fast"
+  };
+  const char * apcFastNames[6] = {
+    "Simple Compressor (Peak Envelope Tracking, Fast Gain Computer)",
+    "Simple Compressor (RMS Envelope Tracking, Fast Gain Computer)",
+    "Simple Expander (Peak Envelope Tracking, Fast Gain Computer)",
+    "Simple Expander (RMS Envelope Tracking, Fast Gain Computer)",
+    "Simple Limiter (Peak Envelope Tracking, Fast Gain Computer)",
+    "Simple Limiter (RMS Envelope Tracking, Fast Gain Computer)"
+  };
+  const int aiFastModes[6] = {
+    DP_COMPRESSOR,
+    DP_COMPRESSOR,
+    DP_EXPANDER,
+    DP_EXPANDER,
+    DP_LIMITER,
+    DP_LIMITER
+  };
+  LADSPA_Run_Function afFastRunFunctions[6] = {
+    runFastDynamicProcessor<DP_COMPRESSOR, false, 1, write_output_normal>,
+    runFastDynamicProcessor<DP_COMPRESSOR, true,  1, write_output_normal>,
+    runFastDynamicProcessor<DP_EXPANDER, false, 1, write_output_normal>,
+    runFastDynamicProcessor<DP_EXPANDER, true,  1, write_output_normal>,
+    runFastDynamicProcessor<DP_LIMITER, false, 1, write_output_normal>,
+    runFastDynamicProcessor<DP_LIMITER, true,  1, write_output_normal>
+  };
+  LADSPA_Run_Adding_Function afFastRunAddingFunctions[6] = {
+    runFastDynamicProcessor<DP_COMPRESSOR, false, 1, write_output_adding>,
+    runFastDynamicProcessor<DP_COMPRESSOR, true, 1, write_output_adding>,
+    runFastDynamicProcessor<DP_EXPANDER, false, 1, write_output_adding>,
+    runFastDynamicProcessor<DP_EXPANDER, true, 1, write_output_adding>,
+    runFastDynamicProcessor<DP_LIMITER, false, 1, write_output_adding>,
+    runFastDynamicProcessor<DP_LIMITER, true, 1, write_output_adding>
+  };
+
+  for (long lFastIndex = 0; lFastIndex < 6; lFastIndex++)
+    registerFastDynamicProcessor(1912 + lFastIndex,
+				 apcFastLabels[lFastIndex],
+				 apcFastNames[lFastIndex],
+				 aiFastModes[lFastIndex],
+				 1,
+				 afFastRunFunctions[lFastIndex],
+				 afFastRunAddingFunctions[lFastIndex]);
+
+  psDescriptor = new CMT_Descriptor
+    (1918,
+     "limit_lookahead",
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+     "Look-Ahead Limiter (Optional True Peak Detection)",
+     CMT_MAKER("Richard W.E. Furse"),
+     CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+     NULL,
+     CMT_Instantiate<LookAheadLimiter>,
+     activateLookAheadLimiter,
+     runLookAheadLimiter<write_output_normal>,
+     runLookAheadLimiter<write_output_adding>,
+     setDynamicProcessorRunAddingGain<LookAheadLimiter>,
+     NULL);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Threshold",
+     (LADSPA_HINT_BOUNDED_BELOW 
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_1),
+     0,
+     0);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Look-Ahead (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_LOW),
+     0,
+     LL_MAXIMUM_LOOKAHEAD);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Release (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_LOW),
+     0,
+     1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "True Peak Detection",
+     (LADSPA_HINT_TOGGLED
+      | LADSPA_HINT_DEFAULT_0),
+     0,
+     0);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+     "Input");
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+     "Output");
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+     "latency");
+  registerNewPluginDescriptor(psDescriptor);
+
+  /* Linked multichannel compressors and limiters, each driven by a
+     single detector. */
+  const char * apcLinkedLabels[4] = {
+    "compress_peak",
+    "compress_rms",
+    "limit_peak",
+    "limit_rms"
+  };
+  const char * apcLinkedNames[4] = {
+    "Linked Compressor (Peak Envelope Tracking",
+    "Linked Compressor (RMS Envelope Tracking",
+    "Linked Limiter (Peak Envelope Tracking",
+    "Linked Limiter (RMS Envelope Tracking"
+  };
+  const long alLinkedChannelCounts[4] = {
+    2,
+    4,
+    6,
+    8
+  };
+  const char * apcLinkedLayoutNames[4] = {
+    "Stereo",
+    "Quad",
+    "5.1",
+    "8 Channel"
+  };
+  LADSPA_Run_Function aafLinkedRunFunctions[4][4] = {
+    { runFastDynamicProcessor<DP_COMPRESSOR, false, 2, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 4, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 6, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 8, write_output_normal> },
+    { runFastDynamicProcessor<DP_COMPRESSOR, true, 2, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 4, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 6, write_output_normal>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 8, write_output_normal> },
+    { runFastDynamicProcessor<DP_LIMITER, false, 2, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, false, 4, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, false, 6, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, false, 8, write_output_normal> },
+    { runFastDynamicProcessor<DP_LIMITER, true, 2, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, true, 4, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, true, 6, write_output_normal>,
+      runFastDynamicProcessor<DP_LIMITER, true, 8, write_output_normal> }
+  };
+  LADSPA_Run_Adding_Function aafLinkedRunAddingFunctions[4][4] = {
+    { runFastDynamicProcessor<DP_COMPRESSOR, false, 2, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 4, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 6, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, false, 8, write_output_adding> },
+    { runFastDynamicProcessor<DP_COMPRESSOR, true, 2, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 4, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 6, write_output_adding>,
+      runFastDynamicProcessor<DP_COMPRESSOR, true, 8, write_output_adding> },
+    { runFastDynamicProcessor<DP_LIMITER, false, 2, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, false, 4, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, false, 6, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, false, 8, write_output_adding> },
+    { runFastDynamicProcessor<DP_LIMITER, true, 2, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, true, 4, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, true, 6, write_output_adding>,
+      runFastDynamicProcessor<DP_LIMITER, true, 8, write_output_adding> }
+  };
+
+  for (long lTypeIndex = 0; lTypeIndex < 4; lTypeIndex++) 
+    for (long lCountIndex = 0; lCountIndex < 4; lCountIndex++) {
+      char acLabel[40];
+      char acName[100];
+      sprintf(acLabel,
+	      "%s_%ldch",
+	      apcLinkedLabels[lTypeIndex],
+	      alLinkedChannelCounts[lCountIndex]);
+      sprintf(acName,
+	      "%s, %s)",
+	      apcLinkedNames[lTypeIndex],
+	      apcLinkedLayoutNames[lCountIndex]);
+      registerFastDynamicProcessor(1919 + lTypeIndex * 4 + lCountIndex,
+				   acLabel,
+				   acName,
+				   lTypeIndex < 2 ? DP_COMPRESSOR : DP_LIMITER,
+				   alLinkedChannelCounts[lCountIndex],
+				   aafLinkedRunFunctions[lTypeIndex][lCountIndex],
+				   aafLinkedRunAddingFunctions[lTypeIndex][lCountIndex]);
+    }
 }
 
 /*****************************************************************************/
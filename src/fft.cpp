@@ -0,0 +1,352 @@
+/* fft.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+/* A real transform of N samples is done as a complex transform of M =
+   N/2 points, taking even samples as real parts and odd samples as
+   imaginary parts, followed by a pass that separates the two halves
+   again (and the reverse for the inverse). The complex transform is
+   an in-place radix 2 decimation in time. The first two stages need
+   no multiplications and are done together. Each later stage has its
+   own run of twiddle factors so that its butterflies can be done four
+   at a time with SSE or NEON. */
+
+/*****************************************************************************/
+
+#include <cmath>
+
+/*****************************************************************************/
+
+#include "fft.h"
+#include "kernels.h"
+
+/*****************************************************************************/
+
+class FFTTables : public CMT_SharedTable {
+public:
+
+  /** cos(2 pi k / N) and sin(2 pi k / N) for k < M, used to separate
+      the halves. */
+  LADSPA_Data * m_pfCos;
+  LADSPA_Data * m_pfSin;
+
+  /** Twiddle factors for the complex stage with butterflies h apart
+      start at index h - 1, running over the angles 2 pi j / 2h for j
+      < h. */
+  LADSPA_Data * m_pfStageCos;
+  LADSPA_Data * m_pfStageSin;
+
+  /** Bit reversal of each index below M. */
+  unsigned long * m_plReverse;
+
+  FFTTables(const unsigned long lSize) {
+
+    const unsigned long lPoints = lSize / 2;
+
+    m_pfCos = allocateTableData(lPoints);
+    m_pfSin = allocateTableData(lPoints);
+    for (unsigned long lIndex = 0; lIndex < lPoints; lIndex++) {
+      const double dAngle = 2 * M_PI * lIndex / lSize;
+      m_pfCos[lIndex] = LADSPA_Data(cos(dAngle));
+      m_pfSin[lIndex] = LADSPA_Data(sin(dAngle));
+    }
+
+    m_pfStageCos = allocateTableData(lPoints);
+    m_pfStageSin = allocateTableData(lPoints);
+    for (unsigned long lHalf = 1; lHalf < lPoints; lHalf <<= 1)
+      for (unsigned long lIndex = 0; lIndex < lHalf; lIndex++) {
+	const double dAngle = M_PI * lIndex / lHalf;
+	m_pfStageCos[lHalf - 1 + lIndex] = LADSPA_Data(cos(dAngle));
+	m_pfStageSin[lHalf - 1 + lIndex] = LADSPA_Data(sin(dAngle));
+      }
+
+    m_plReverse = new unsigned long[lPoints];
+    for (unsigned long lIndex = 0; lIndex < lPoints; lIndex++) {
+      unsigned long lReverse = 0;
+      for (unsigned long lBit = 1; lBit < lPoints; lBit <<= 1) {
+	lReverse <<= 1;
+	if (lIndex & lBit)
+	  lReverse |= 1;
+      }
+      m_plReverse[lIndex] = lReverse;
+    }
+  }
+
+  ~FFTTables() {
+    freeTableData(m_pfCos);
+    freeTableData(m_pfSin);
+    freeTableData(m_pfStageCos);
+    freeTableData(m_pfStageSin);
+    delete [] m_plReverse;
+  }
+
+};
+
+#define FFT_KEY "fft"
+
+static CMT_SharedTable *
+createFFTTables(const int iSize) {
+  return new FFTTables(iSize);
+}
+
+/*****************************************************************************/
+
+/** lCount butterflies between the points at pfA and those at pfB,
+    with the twiddle factors for the stage. lCount is a multiple of
+    four. */
+template <bool bInverse>
+static inline void
+butterflies(LADSPA_Data *       pfAReal,
+	    LADSPA_Data *       pfAImaginary,
+	    LADSPA_Data *       pfBReal,
+	    LADSPA_Data *       pfBImaginary,
+	    const LADSPA_Data * pfCos,
+	    const LADSPA_Data * pfSin,
+	    const unsigned long lCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  for (; lIndex < lCount; lIndex += 4) {
+    const __m128 vCos = _mm_loadu_ps(pfCos + lIndex);
+    __m128 vSin = _mm_loadu_ps(pfSin + lIndex);
+    if (bInverse)
+      vSin = _mm_sub_ps(_mm_setzero_ps(), vSin);
+    const __m128 vBReal = _mm_loadu_ps(pfBReal + lIndex);
+    const __m128 vBImaginary = _mm_loadu_ps(pfBImaginary + lIndex);
+    const __m128 vAReal = _mm_loadu_ps(pfAReal + lIndex);
+    const __m128 vAImaginary = _mm_loadu_ps(pfAImaginary + lIndex);
+    const __m128 vTReal = _mm_add_ps(_mm_mul_ps(vBReal, vCos),
+				     _mm_mul_ps(vBImaginary, vSin));
+    const __m128 vTImaginary = _mm_sub_ps(_mm_mul_ps(vBImaginary, vCos),
+					  _mm_mul_ps(vBReal, vSin));
+    _mm_storeu_ps(pfBReal + lIndex, _mm_sub_ps(vAReal, vTReal));
+    _mm_storeu_ps(pfBImaginary + lIndex, _mm_sub_ps(vAImaginary, vTImaginary));
+    _mm_storeu_ps(pfAReal + lIndex, _mm_add_ps(vAReal, vTReal));
+    _mm_storeu_ps(pfAImaginary + lIndex, _mm_add_ps(vAImaginary, vTImaginary));
+  }
+#elif defined(CMT_KERNELS_NEON)
+  for (; lIndex < lCount; lIndex += 4) {
+    const float32x4_t vCos = vld1q_f32(pfCos + lIndex);
+    float32x4_t vSin = vld1q_f32(pfSin + lIndex);
+    if (bInverse)
+      vSin = vnegq_f32(vSin);
+    const float32x4_t vBReal = vld1q_f32(pfBReal + lIndex);
+    const float32x4_t vBImaginary = vld1q_f32(pfBImaginary + lIndex);
+    const float32x4_t vAReal = vld1q_f32(pfAReal + lIndex);
+    const float32x4_t vAImaginary = vld1q_f32(pfAImaginary + lIndex);
+    const float32x4_t vTReal
+      = vmlaq_f32(vmulq_f32(vBReal, vCos), vBImaginary, vSin);
+    const float32x4_t vTImaginary
+      = vmlsq_f32(vmulq_f32(vBImaginary, vCos), vBReal, vSin);
+    vst1q_f32(pfBReal + lIndex, vsubq_f32(vAReal, vTReal));
+    vst1q_f32(pfBImaginary + lIndex, vsubq_f32(vAImaginary, vTImaginary));
+    vst1q_f32(pfAReal + lIndex, vaddq_f32(vAReal, vTReal));
+    vst1q_f32(pfAImaginary + lIndex, vaddq_f32(vAImaginary, vTImaginary));
+  }
+#endif
+
+  for (; lIndex < lCount; lIndex++) {
+    const LADSPA_Data fCos = pfCos[lIndex];
+    const LADSPA_Data fSin = bInverse ? -pfSin[lIndex] : pfSin[lIndex];
+    const LADSPA_Data fTReal
+      = pfBReal[lIndex] * fCos + pfBImaginary[lIndex] * fSin;
+    const LADSPA_Data fTImaginary
+      = pfBImaginary[lIndex] * fCos - pfBReal[lIndex] * fSin;
+    pfBReal[lIndex] = pfAReal[lIndex] - fTReal;
+    pfBImaginary[lIndex] = pfAImaginary[lIndex] - fTImaginary;
+    pfAReal[lIndex] += fTReal;
+    pfAImaginary[lIndex] += fTImaginary;
+  }
+}
+
+/** Complex transform of lPoints points held in bit reversed order,
+    with the sign of the exponent negative (forward) or positive
+    (bInverse). */
+template <bool bInverse>
+static void
+transform(LADSPA_Data *       pfReal,
+	  LADSPA_Data *       pfImaginary,
+	  const unsigned long lPoints,
+	  const FFTTables *   poTables) {
+
+  /* Stages with butterflies one and two apart, whose twiddle factors
+     are 1 and -i (or i for the inverse). */
+  for (unsigned long lStart = 0; lStart < lPoints; lStart += 4) {
+    LADSPA_Data * pfR = pfReal + lStart;
+    LADSPA_Data * pfI = pfImaginary + lStart;
+    const LADSPA_Data fR0 = pfR[0] + pfR[1];
+    const LADSPA_Data fI0 = pfI[0] + pfI[1];
+    const LADSPA_Data fR1 = pfR[0] - pfR[1];
+    const LADSPA_Data fI1 = pfI[0] - pfI[1];
+    const LADSPA_Data fR2 = pfR[2] + pfR[3];
+    const LADSPA_Data fI2 = pfI[2] + pfI[3];
+    const LADSPA_Data fR3 = pfR[2] - pfR[3];
+    const LADSPA_Data fI3 = pfI[2] - pfI[3];
+    const LADSPA_Data fTReal = bInverse ? -fI3 : fI3;
+    const LADSPA_Data fTImaginary = bInverse ? fR3 : -fR3;
+    pfR[0] = fR0 + fR2;
+    pfI[0] = fI0 + fI2;
+    pfR[2] = fR0 - fR2;
+    pfI[2] = fI0 - fI2;
+    pfR[1] = fR1 + fTReal;
+    pfI[1] = fI1 + fTImaginary;
+    pfR[3] = fR1 - fTReal;
+    pfI[3] = fI1 - fTImaginary;
+  }
+
+  for (unsigned long lHalf = 4; lHalf < lPoints; lHalf <<= 1) {
+    const LADSPA_Data * pfCos = poTables->m_pfStageCos + lHalf - 1;
+    const LADSPA_Data * pfSin = poTables->m_pfStageSin + lHalf - 1;
+    for (unsigned long lStart = 0; lStart < lPoints; lStart += 2 * lHalf)
+      butterflies<bInverse>(pfReal + lStart,
+			    pfImaginary + lStart,
+			    pfReal + lStart + lHalf,
+			    pfImaginary + lStart + lHalf,
+			    pfCos,
+			    pfSin,
+			    lHalf);
+  }
+}
+
+/*****************************************************************************/
+
+RealFFT::RealFFT(const unsigned long lSize)
+  : m_lSize(lSize) {
+  m_poTables = (const FFTTables *)acquireSharedTable(FFT_KEY,
+						     int(lSize),
+						     createFFTTables);
+}
+
+/*****************************************************************************/
+
+RealFFT::~RealFFT() {
+  releaseSharedTable(FFT_KEY, int(m_lSize));
+}
+
+/*****************************************************************************/
+
+void
+RealFFT::forward(const LADSPA_Data * pfInput,
+		 LADSPA_Data *       pfReal,
+		 LADSPA_Data *       pfImaginary) const {
+
+  const unsigned long lPoints = m_lSize / 2;
+  const unsigned long * plReverse = m_poTables->m_plReverse;
+
+  for (unsigned long lIndex = 0; lIndex < lPoints; lIndex++) {
+    pfReal[plReverse[lIndex]] = pfInput[2 * lIndex];
+    pfImaginary[plReverse[lIndex]] = pfInput[2 * lIndex + 1];
+  }
+
+  transform<false>(pfReal, pfImaginary, lPoints, m_poTables);
+
+  /* Bin 0 of the complex transform holds the sums of the even and odd
+     samples, giving the DC and Nyquist bins. Each other pair of bins
+     k and M - k gives the even part E and odd part O of bin k, which
+     combine as E + W^k O for bin k and conj(E - W^k O) for bin M -
+     k. */
+  const LADSPA_Data fZReal = pfReal[0];
+  const LADSPA_Data fZImaginary = pfImaginary[0];
+  pfReal[0] = fZReal + fZImaginary;
+  pfImaginary[0] = fZReal - fZImaginary;
+
+  for (unsigned long lIndex = 1; lIndex <= lPoints / 2; lIndex++) {
+    const unsigned long lMirror = lPoints - lIndex;
+    const LADSPA_Data fAReal = pfReal[lIndex];
+    const LADSPA_Data fAImaginary = pfImaginary[lIndex];
+    const LADSPA_Data fBReal = pfReal[lMirror];
+    const LADSPA_Data fBImaginary = pfImaginary[lMirror];
+    const LADSPA_Data fEReal = 0.5f * (fAReal + fBReal);
+    const LADSPA_Data fEImaginary = 0.5f * (fAImaginary - fBImaginary);
+    const LADSPA_Data fOReal = 0.5f * (fAImaginary + fBImaginary);
+    const LADSPA_Data fOImaginary = 0.5f * (fBReal - fAReal);
+    const LADSPA_Data fCos = m_poTables->m_pfCos[lIndex];
+    const LADSPA_Data fSin = m_poTables->m_pfSin[lIndex];
+    const LADSPA_Data fWOReal = fCos * fOReal + fSin * fOImaginary;
+    const LADSPA_Data fWOImaginary = fCos * fOImaginary - fSin * fOReal;
+    pfReal[lIndex] = fEReal + fWOReal;
+    pfImaginary[lIndex] = fEImaginary + fWOImaginary;
+    pfReal[lMirror] = fEReal - fWOReal;
+    pfImaginary[lMirror] = fWOImaginary - fEImaginary;
+  }
+}
+
+/*****************************************************************************/
+
+void
+RealFFT::inverse(LADSPA_Data * pfReal,
+		 LADSPA_Data * pfImaginary,
+		 LADSPA_Data * pfOutput) const {
+
+  const unsigned long lPoints = m_lSize / 2;
+  const unsigned long * plReverse = m_poTables->m_plReverse;
+
+  /* The reverse of the separation in forward(), leaving the complex
+     spectrum doubled. */
+  const LADSPA_Data fDC = pfReal[0];
+  const LADSPA_Data fNyquist = pfImaginary[0];
+  pfReal[0] = fDC + fNyquist;
+  pfImaginary[0] = fDC - fNyquist;
+
+  for (unsigned long lIndex = 1; lIndex <= lPoints / 2; lIndex++) {
+    const unsigned long lMirror = lPoints - lIndex;
+    const LADSPA_Data fAReal = pfReal[lIndex];
+    const LADSPA_Data fAImaginary = pfImaginary[lIndex];
+    const LADSPA_Data fBReal = pfReal[lMirror];
+    const LADSPA_Data fBImaginary = pfImaginary[lMirror];
+    const LADSPA_Data fEReal = fAReal + fBReal;
+    const LADSPA_Data fEImaginary = fAImaginary - fBImaginary;
+    const LADSPA_Data fDReal = fAReal - fBReal;
+    const LADSPA_Data fDImaginary = fAImaginary + fBImaginary;
+    const LADSPA_Data fCos = m_poTables->m_pfCos[lIndex];
+    const LADSPA_Data fSin = m_poTables->m_pfSin[lIndex];
+    const LADSPA_Data fOReal = fCos * fDReal - fSin * fDImaginary;
+    const LADSPA_Data fOImaginary = fCos * fDImaginary + fSin * fDReal;
+    pfReal[lIndex] = fEReal - fOImaginary;
+    pfImaginary[lIndex] = fEImaginary + fOReal;
+    pfReal[lMirror] = fEReal + fOImaginary;
+    pfImaginary[lMirror] = fOReal - fEImaginary;
+  }
+
+  for (unsigned long lIndex = 0; lIndex < lPoints; lIndex++) {
+    const unsigned long lReverse = plReverse[lIndex];
+    if (lReverse > lIndex) {
+      LADSPA_Data fSwap = pfReal[lIndex];
+      pfReal[lIndex] = pfReal[lReverse];
+      pfReal[lReverse] = fSwap;
+      fSwap = pfImaginary[lIndex];
+      pfImaginary[lIndex] = pfImaginary[lReverse];
+      pfImaginary[lReverse] = fSwap;
+    }
+  }
+
+  transform<true>(pfReal, pfImaginary, lPoints, m_poTables);
+
+  for (unsigned long lIndex = 0; lIndex < lPoints; lIndex++) {
+    pfOutput[2 * lIndex] = pfReal[lIndex];
+    pfOutput[2 * lIndex + 1] = pfImaginary[lIndex];
+  }
+}
+
+/*****************************************************************************/
+
+/* EOF */
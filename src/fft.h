@@ -0,0 +1,86 @@
+/* fft.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_FFT_INCLUDED
+#define CMT_FFT_INCLUDED
+
+/*****************************************************************************/
+
+/* Fast Fourier transform of real signals, for plugins working on
+   spectra (see convolver.h). A transform of N real samples has N/2 + 1
+   complex bins, the first and last of which are real. These are held
+   in "packed" form as N/2 real parts and N/2 imaginary parts in
+   separate arrays, with the real value of the last bin (the Nyquist
+   frequency) in place of the zero imaginary part of the first (DC)
+   bin. Keeping the parts apart lets spectra be multiplied four bins at
+   a time (see multiplyAccumulateSpectrum() in kernels.h), and packing
+   keeps the bin count a power of two. */
+
+/*****************************************************************************/
+
+#include "cmt.h"
+
+/*****************************************************************************/
+
+class FFTTables;
+
+/** A real FFT of one size, which must be a power of two from 8 to
+    65536. The twiddle factors and bit reversal table are shared by all
+    transforms of the same size through the shared table registry, so
+    construct these in instantiate() rather than run(). The transforms
+    themselves allocate nothing. */
+class RealFFT {
+private:
+
+  RealFFT(const RealFFT &);
+  RealFFT & operator=(const RealFFT &);
+
+  unsigned long m_lSize;
+  const FFTTables * m_poTables;
+
+public:
+
+  RealFFT(const unsigned long lSize);
+  ~RealFFT();
+
+  unsigned long getSize() const {
+    return m_lSize;
+  }
+
+  /** Transform getSize() samples of pfInput to getSize() / 2 packed
+      bins in pfReal and pfImaginary. */
+  void forward(const LADSPA_Data * pfInput,
+	       LADSPA_Data *       pfReal,
+	       LADSPA_Data *       pfImaginary) const;
+
+  /** Transform packed bins back to getSize() samples in pfOutput. The
+      result is scaled up by getSize(), which callers normally fold into
+      one of the spectra they multiply. The bins are overwritten. */
+  void inverse(LADSPA_Data * pfReal,
+	       LADSPA_Data * pfImaginary,
+	       LADSPA_Data * pfOutput) const;
+
+};
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -21,11 +21,17 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 
 /*****************************************************************************/
 
+#include "biquad.h"
 #include "cmt.h"
+#include "kernels.h"
+#include "lanes.h"
+#include "run_adding.h"
+#include "utils.h"
 
 /*****************************************************************************/
 
@@ -33,44 +39,76 @@
 #define SF_INPUT   1
 #define SF_OUTPUT  2
 
+/** Multichannel versions take all their inputs, then all their
+    outputs. */
+#define SF_MAX_CHANNELS 8
+
 static void activateOnePollFilter(LADSPA_Handle Instance);
+static void setOnePollFilterRunAddingGain(LADSPA_Handle Instance,
+					  LADSPA_Data Gain);
+template <OutputFunction write_output>
 static void runOnePollLowPassFilter(LADSPA_Handle Instance,
                                     unsigned long SampleCount);
+template <OutputFunction write_output>
 static void runOnePollHighPassFilter(LADSPA_Handle Instance,
                                      unsigned long SampleCount);
+template <bool bHighPass, int iChannels>
+static void runMultiOnePollFilter(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+template <bool bHighPass>
+static void runOnePollFilterBatch(const LADSPA_Handle * Instances,
+				  unsigned long InstanceCount,
+				  unsigned long SampleCount);
 
 /** Instance data for the OnePoll filter (one-poll, low or high
     pass). We can get away with using this structure for both low- and
     high-pass filters because the data stored is the same. Note that
-    the actual run() calls differ however. */
+    the actual run() calls differ however. The multichannel versions
+    share one set of coefficients between all their channels. */
 class OnePollFilter : public CMT_PluginInstance {
 private:
 
   LADSPA_Data m_fSampleRate;
   LADSPA_Data m_fTwoPiOverSampleRate;
 
-  LADSPA_Data m_fLastOutput;
+  LADSPA_Data m_afLastOutput[SF_MAX_CHANNELS];
   LADSPA_Data m_fLastCutoff;
   LADSPA_Data m_fAmountOfCurrent;
   LADSPA_Data m_fAmountOfLast;
 
+  LADSPA_Data m_fRunAddingGain;
+
+  void calculateCoefficients(const bool bHighPass);
+
 public:
 
-  OnePollFilter(const LADSPA_Descriptor *,
+  OnePollFilter(const LADSPA_Descriptor * psDescriptor,
 	       unsigned long lSampleRate) 
-    : CMT_PluginInstance(3),
+    : CMT_PluginInstance(psDescriptor->PortCount),
       m_fSampleRate(LADSPA_Data(lSampleRate)),
       m_fTwoPiOverSampleRate(LADSPA_Data((2 * M_PI) / lSampleRate)),
       m_fLastCutoff(0),
       m_fAmountOfCurrent(0),
-      m_fAmountOfLast(0) {
+      m_fAmountOfLast(0),
+      m_fRunAddingGain(1) {
   }
 
   friend void activateOnePollFilter(LADSPA_Handle Instance);
+  friend void setOnePollFilterRunAddingGain(LADSPA_Handle Instance,
+					    LADSPA_Data Gain);
+  template <OutputFunction write_output>
   friend void runOnePollLowPassFilter(LADSPA_Handle Instance,
 				     unsigned long SampleCount);
+  template <OutputFunction write_output>
   friend void runOnePollHighPassFilter(LADSPA_Handle Instance,
 				      unsigned long SampleCount);
+  template <bool bHighPass, int iChannels>
+  friend void runMultiOnePollFilter(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+  template <bool bHighPass>
+  friend void runOnePollFilterBatch(const LADSPA_Handle * Instances,
+				    unsigned long InstanceCount,
+				    unsigned long SampleCount);
 
 };
 
@@ -78,12 +116,60 @@ public:
 
 static void 
 activateOnePollFilter(LADSPA_Handle Instance) {
-  ((OnePollFilter *)Instance)->m_fLastOutput = 0;
+  OnePollFilter * poFilter = (OnePollFilter *)Instance;
+  for (int iChannel = 0; iChannel < SF_MAX_CHANNELS; iChannel++)
+    poFilter->m_afLastOutput[iChannel] = 0;
+}
+
+/*****************************************************************************/
+
+static void
+setOnePollFilterRunAddingGain(LADSPA_Handle Instance,
+			      LADSPA_Data Gain) {
+  ((OnePollFilter *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/** Recalculate the coefficients if the cutoff has changed. */
+void
+OnePollFilter::calculateCoefficients(const bool bHighPass) {
+  if (m_fLastCutoff != *(m_ppfPorts[SF_CUTOFF])) {
+    m_fLastCutoff = *(m_ppfPorts[SF_CUTOFF]);
+    if (m_fLastCutoff <= 0) {
+      if (bHighPass) {
+	/* Let everything through. */
+	m_fAmountOfCurrent = 1;
+	m_fAmountOfLast = 0;
+      }
+      else {
+	/* Reject everything. */
+	m_fAmountOfCurrent = m_fAmountOfLast = 0;
+      }
+    }
+    else if (m_fLastCutoff > m_fSampleRate * 0.5) {
+      if (bHighPass) {
+	/* Above Nyquist frequency. Reject everything. */
+	m_fAmountOfCurrent = m_fAmountOfLast = 0;
+      }
+      else {
+	/* Above Nyquist frequency. Let everything through. */
+	m_fAmountOfCurrent = 1;
+	m_fAmountOfLast = 0;
+      }
+    }
+    else {
+      LADSPA_Data fComp = 2 - cos(m_fTwoPiOverSampleRate * m_fLastCutoff);
+      m_fAmountOfLast = fComp - (LADSPA_Data)sqrt(fComp * fComp - 1);
+      m_fAmountOfCurrent = 1 - m_fAmountOfLast;
+    }
+  }
 }
 
 /*****************************************************************************/
 
 /** Run the LPF algorithm for a block of SampleCount samples. */
+template <OutputFunction write_output>
 static void 
 runOnePollLowPassFilter(LADSPA_Handle Instance,
 			unsigned long SampleCount) {
@@ -93,45 +179,29 @@ runOnePollLowPassFilter(LADSPA_Handle Instance,
   LADSPA_Data * pfInput = poFilter->m_ppfPorts[SF_INPUT];
   LADSPA_Data * pfOutput = poFilter->m_ppfPorts[SF_OUTPUT];
 
-  if (poFilter->m_fLastCutoff != *(poFilter->m_ppfPorts[SF_CUTOFF])) {
-    poFilter->m_fLastCutoff = *(poFilter->m_ppfPorts[SF_CUTOFF]);
-    if (poFilter->m_fLastCutoff <= 0) {
-      /* Reject everything. */
-      poFilter->m_fAmountOfCurrent = poFilter->m_fAmountOfLast = 0;
-    }
-    else if (poFilter->m_fLastCutoff > poFilter->m_fSampleRate * 0.5) {
-      /* Above Nyquist frequency. Let everything through. */
-      poFilter->m_fAmountOfCurrent = 1;
-      poFilter->m_fAmountOfLast = 0;
-    }
-    else {
-      poFilter->m_fAmountOfLast = 0;
-      LADSPA_Data fComp = 2 - cos(poFilter->m_fTwoPiOverSampleRate
-				  * poFilter->m_fLastCutoff);
-      poFilter->m_fAmountOfLast	= fComp - (LADSPA_Data)sqrt(fComp * fComp - 1);
-      poFilter->m_fAmountOfCurrent = 1 - poFilter->m_fAmountOfLast;
-    }
-  }
+  poFilter->calculateCoefficients(false);
 
   LADSPA_Data fAmountOfCurrent = poFilter->m_fAmountOfCurrent;
   LADSPA_Data fAmountOfLast = poFilter->m_fAmountOfLast;
-  LADSPA_Data fLastOutput = poFilter->m_fLastOutput;
+  LADSPA_Data fLastOutput = poFilter->m_afLastOutput[0];
+  LADSPA_Data fRunAddingGain = poFilter->m_fRunAddingGain;
 
   for (unsigned long lSampleIndex = 0;
        lSampleIndex < SampleCount;
        lSampleIndex++) {
-    *(pfOutput++)
-      = fLastOutput
+    fLastOutput
       = (fAmountOfCurrent * *(pfInput++)
 	 + fAmountOfLast * fLastOutput);
+    write_output(pfOutput, fLastOutput, fRunAddingGain);
   }
   
-  poFilter->m_fLastOutput = fLastOutput;
+  poFilter->m_afLastOutput[0] = fLastOutput;
 }
 
 /*****************************************************************************/
 
 /** Run the HPF algorithm for a block of SampleCount samples. */
+template <OutputFunction write_output>
 static void 
 runOnePollHighPassFilter(LADSPA_Handle Instance,
 		       unsigned long SampleCount) {
@@ -141,30 +211,12 @@ runOnePollHighPassFilter(LADSPA_Handle Instance,
   LADSPA_Data * pfInput = poFilter->m_ppfPorts[SF_INPUT];
   LADSPA_Data * pfOutput = poFilter->m_ppfPorts[SF_OUTPUT];
 
-  if (poFilter->m_fLastCutoff != *(poFilter->m_ppfPorts[SF_CUTOFF])) {
-    poFilter->m_fLastCutoff = *(poFilter->m_ppfPorts[SF_CUTOFF]);
-    if (poFilter->m_fLastCutoff <= 0) {
-      /* Let everything through. */
-      poFilter->m_fAmountOfCurrent = 1;
-      poFilter->m_fAmountOfLast = 0;
-    }
-    else if (poFilter->m_fLastCutoff > poFilter->m_fSampleRate * 0.5) {
-      /* Above Nyquist frequency. Reject everything. */
-      poFilter->m_fAmountOfCurrent = poFilter->m_fAmountOfLast = 0;
-    }
-    else {
-      poFilter->m_fAmountOfLast = 0;
-      LADSPA_Data fComp = 2 - cos(poFilter->m_fTwoPiOverSampleRate
-				  * poFilter->m_fLastCutoff);
-      poFilter->m_fAmountOfLast	= fComp - (LADSPA_Data)sqrt(fComp * fComp - 1);
-      poFilter->m_fAmountOfCurrent = 1 - poFilter->m_fAmountOfLast;
-    }
-
-  }
+  poFilter->calculateCoefficients(true);
 
   LADSPA_Data fAmountOfCurrent = poFilter->m_fAmountOfCurrent;
   LADSPA_Data fAmountOfLast = poFilter->m_fAmountOfLast;
-  LADSPA_Data fLastOutput = poFilter->m_fLastOutput;
+  LADSPA_Data fLastOutput = poFilter->m_afLastOutput[0];
+  LADSPA_Data fRunAddingGain = poFilter->m_fRunAddingGain;
 
   for (unsigned long lSampleIndex = 0;
        lSampleIndex < SampleCount;
@@ -172,10 +224,643 @@ runOnePollHighPassFilter(LADSPA_Handle Instance,
     fLastOutput
       = (fAmountOfCurrent * *pfInput
 	 + fAmountOfLast * fLastOutput);
-    *(pfOutput++) = *(pfInput++) - fLastOutput;
+    write_output(pfOutput, *(pfInput++) - fLastOutput, fRunAddingGain);
   }
   
-  poFilter->m_fLastOutput = fLastOutput;
+  poFilter->m_afLastOutput[0] = fLastOutput;
+}
+
+/*****************************************************************************/
+
+/** Run a batch of mono OnePoll filters (see cmt_run_batch()) in
+    groups of LANE_COUNT, one filter to each lane. Every filter keeps
+    its own cutoff and state. Any filters left over are run
+    separately. */
+template <bool bHighPass>
+static void
+runOnePollFilterBatch(const LADSPA_Handle * Instances,
+		      unsigned long InstanceCount,
+		      unsigned long SampleCount) {
+
+  unsigned long lInstance = 0;
+  for (; lInstance + LANE_COUNT <= InstanceCount; lInstance += LANE_COUNT) {
+
+    OnePollFilter * apoFilters[LANE_COUNT];
+    const LADSPA_Data * apfInputs[LANE_COUNT];
+    LADSPA_Data * apfOutputs[LANE_COUNT];
+    LADSPA_Data afAmountOfCurrent[LANE_COUNT];
+    LADSPA_Data afAmountOfLast[LANE_COUNT];
+    LADSPA_Data afLastOutput[LANE_COUNT];
+    int iLane;
+    for (iLane = 0; iLane < LANE_COUNT; iLane++) {
+      OnePollFilter * poFilter
+	= apoFilters[iLane]
+	= (OnePollFilter *)Instances[lInstance + iLane];
+      poFilter->calculateCoefficients(bHighPass);
+      apfInputs[iLane] = poFilter->m_ppfPorts[SF_INPUT];
+      apfOutputs[iLane] = poFilter->m_ppfPorts[SF_OUTPUT];
+      afAmountOfCurrent[iLane] = poFilter->m_fAmountOfCurrent;
+      afAmountOfLast[iLane] = poFilter->m_fAmountOfLast;
+      afLastOutput[iLane] = poFilter->m_afLastOutput[0];
+    }
+
+    const Lanes vAmountOfCurrent = lanesLoad(afAmountOfCurrent);
+    const Lanes vAmountOfLast = lanesLoad(afAmountOfLast);
+    Lanes vLastOutput = lanesLoad(afLastOutput);
+
+    for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
+      const Lanes vInput = lanesGather(apfInputs, lIndex);
+      vLastOutput = vAmountOfCurrent * vInput + vAmountOfLast * vLastOutput;
+      lanesScatter(apfOutputs,
+		   lIndex,
+		   bHighPass ? vInput - vLastOutput : vLastOutput);
+    }
+
+    lanesStore(afLastOutput, vLastOutput);
+    for (iLane = 0; iLane < LANE_COUNT; iLane++)
+      apoFilters[iLane]->m_afLastOutput[0] = afLastOutput[iLane];
+  }
+
+  for (; lInstance < InstanceCount; lInstance++)
+    if (bHighPass)
+      runOnePollHighPassFilter<write_output_normal>(Instances[lInstance],
+						    SampleCount);
+    else
+      runOnePollLowPassFilter<write_output_normal>(Instances[lInstance],
+						   SampleCount);
+}
+
+/*****************************************************************************/
+
+/* Cascaded filters. Each plugin runs a chain of one to four second
+   order sections (so a filter of order 2 to 8) over one to four
+   channels in a single pass through the audio. Coefficients are only
+   redesigned when a control changes. All channels share the same
+   coefficients, so with SSE or NEON the channels are run side by side
+   in the lanes of a vector, which costs no more than running a single
+   channel. */
+
+#define CF_LOWPASS  BIQUAD_LOWPASS
+#define CF_HIGHPASS BIQUAD_HIGHPASS
+#define CF_BANDPASS BIQUAD_BANDPASS
+#define CF_NOTCH    BIQUAD_NOTCH
+#define CF_LOWSHELF BIQUAD_LOWSHELF
+#define CF_HIGHSHELF BIQUAD_HIGHSHELF
+#define CF_SVF      6
+
+#define CF_KIND_COUNT 7
+
+#define CF_MAX_CHANNELS 4
+#define CF_MAX_SECTIONS 4
+
+#define CF_FREQUENCY 0
+/* Q or gain, depending on the filter type. */
+#define CF_PARAMETER 1
+#define CF_ORDER     2
+/* State variable filters only. */
+#define CF_MODE      3
+
+/** The first audio port. Inputs come first, then outputs. */
+#define CF_AUDIO(iKind) ((iKind) == CF_SVF ? 4 : 3)
+
+/** Design frequencies are kept clear of DC and the Nyquist
+    frequency, where the designs degenerate. */
+#define CF_MIN_FREQUENCY 1e-5
+#define CF_MAX_FREQUENCY 0.49
+
+#if defined(CMT_KERNELS_SSE) || defined(CMT_KERNELS_NEON)
+#define CF_VECTOR
+#endif
+
+static void activateCascadeFilter(LADSPA_Handle Instance);
+template <int iKind, int iChannels>
+static void runCascadeFilter(LADSPA_Handle Instance,
+			     unsigned long SampleCount);
+
+/** Instance data for the cascaded biquad and state variable
+    filters. State is held per section as one lane per channel so that
+    it may be loaded straight into a vector. */
+class CascadeFilter : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_fSampleRate;
+
+  bool m_bDesigned;
+  LADSPA_Data m_fLastFrequency;
+  LADSPA_Data m_fLastParameter;
+  LADSPA_Data m_fLastOrder;
+  LADSPA_Data m_fLastMode;
+
+  int m_iSectionCount;
+  BiquadCoefficients m_asBiquad[CF_MAX_SECTIONS];
+  SVFCoefficients m_asSVF[CF_MAX_SECTIONS];
+
+  /** z1 and z2 for biquads or ic1 and ic2 for state variable
+      sections. */
+  LADSPA_Data m_afState1[CF_MAX_SECTIONS][CF_MAX_CHANNELS];
+  LADSPA_Data m_afState2[CF_MAX_SECTIONS][CF_MAX_CHANNELS];
+
+  void design(const int iKind);
+
+public:
+
+  CascadeFilter(const LADSPA_Descriptor *,
+		unsigned long lSampleRate) 
+    : CMT_PluginInstance(4 + 2 * CF_MAX_CHANNELS),
+      m_fSampleRate(LADSPA_Data(lSampleRate)),
+      m_bDesigned(false),
+      m_iSectionCount(1) {
+  }
+
+  friend void activateCascadeFilter(LADSPA_Handle Instance);
+  template <int iKind, int iChannels>
+  friend void runCascadeFilter(LADSPA_Handle Instance,
+			       unsigned long SampleCount);
+  template <bool bSVF, int iChannels, int iSections>
+  friend void processCascadeFilter(CascadeFilter * poFilter,
+				   unsigned long lSampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void 
+activateCascadeFilter(LADSPA_Handle Instance) {
+  CascadeFilter * poFilter = (CascadeFilter *)Instance;
+  for (int iSection = 0; iSection < CF_MAX_SECTIONS; iSection++)
+    for (int iChannel = 0; iChannel < CF_MAX_CHANNELS; iChannel++)
+      poFilter->m_afState1[iSection][iChannel]
+	= poFilter->m_afState2[iSection][iChannel]
+	= 0;
+}
+
+/*****************************************************************************/
+
+/** Redesign the sections if any control has changed since the last
+    block. */
+void
+CascadeFilter::design(const int iKind) {
+
+  const LADSPA_Data fFrequency = *(m_ppfPorts[CF_FREQUENCY]);
+  const LADSPA_Data fParameter = *(m_ppfPorts[CF_PARAMETER]);
+  const LADSPA_Data fOrder = *(m_ppfPorts[CF_ORDER]);
+  const LADSPA_Data fMode = (iKind == CF_SVF ? *(m_ppfPorts[CF_MODE]) : 0);
+
+  if (m_bDesigned
+      && fFrequency == m_fLastFrequency
+      && fParameter == m_fLastParameter
+      && fOrder == m_fLastOrder
+      && fMode == m_fLastMode)
+    return;
+
+  m_bDesigned = true;
+  m_fLastFrequency = fFrequency;
+  m_fLastParameter = fParameter;
+  m_fLastOrder = fOrder;
+  m_fLastMode = fMode;
+
+  m_iSectionCount 
+    = int(BOUNDED(fOrder * 0.5f, 1, CF_MAX_SECTIONS) + 0.5f);
+  const double dFrequency 
+    = BOUNDED(fFrequency / m_fSampleRate, 
+	      CF_MIN_FREQUENCY,
+	      CF_MAX_FREQUENCY);
+
+  for (int iSection = 0; iSection < m_iSectionCount; iSection++) {
+    switch (iKind) {
+    case CF_LOWPASS:
+    case CF_HIGHPASS:
+      /* The Q control scales a Butterworth design, so the default of
+	 one gives a maximally flat response at any order. */
+      designBiquad(m_asBiquad[iSection],
+		   iKind,
+		   dFrequency,
+		   butterworthQ(iSection, m_iSectionCount) 
+		   * BOUNDED_BELOW(fParameter, 0.01f));
+      break;
+    case CF_BANDPASS:
+    case CF_NOTCH:
+      designBiquad(m_asBiquad[iSection],
+		   iKind,
+		   dFrequency,
+		   BOUNDED_BELOW(fParameter, 0.01f));
+      break;
+    case CF_LOWSHELF:
+    case CF_HIGHSHELF:
+      /* The gain is shared between the sections. */
+      designBiquad(m_asBiquad[iSection],
+		   iKind,
+		   dFrequency,
+		   M_SQRT1_2,
+		   fParameter / m_iSectionCount);
+      break;
+    case CF_SVF:
+      designSVF(m_asSVF[iSection],
+		int(BOUNDED(fMode, SVF_LOWPASS, SVF_NOTCH) + 0.5f),
+		dFrequency,
+		butterworthQ(iSection, m_iSectionCount)
+		* BOUNDED_BELOW(fParameter, 0.01f));
+      break;
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* Arithmetic used by the section code below, for single samples and
+   for vectors holding one sample from each channel. */
+
+inline void cfSplat(LADSPA_Data & rfResult, const LADSPA_Data fValue) {
+  rfResult = fValue;
+}
+inline LADSPA_Data cfAdd(const LADSPA_Data fA, const LADSPA_Data fB) {
+  return fA + fB;
+}
+inline LADSPA_Data cfSub(const LADSPA_Data fA, const LADSPA_Data fB) {
+  return fA - fB;
+}
+inline LADSPA_Data cfMul(const LADSPA_Data fA, const LADSPA_Data fB) {
+  return fA * fB;
+}
+
+/* Vectors are wrapped in a structure so that they may be used as
+   template arguments without losing their alignment attributes. */
+#if defined(CMT_KERNELS_SSE)
+struct CF_Vector {
+  __m128 m_v;
+};
+inline CF_Vector cfVector(const __m128 v) {
+  CF_Vector vResult = { v };
+  return vResult;
+}
+inline void cfSplat(CF_Vector & rvResult, const LADSPA_Data fValue) {
+  rvResult.m_v = _mm_set1_ps(fValue);
+}
+inline CF_Vector cfLoad(const LADSPA_Data * pfData) {
+  return cfVector(_mm_loadu_ps(pfData));
+}
+inline void cfStore(LADSPA_Data * pfData, const CF_Vector vValue) {
+  _mm_storeu_ps(pfData, vValue.m_v);
+}
+inline CF_Vector cfAdd(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(_mm_add_ps(vA.m_v, vB.m_v));
+}
+inline CF_Vector cfSub(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(_mm_sub_ps(vA.m_v, vB.m_v));
+}
+inline CF_Vector cfMul(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(_mm_mul_ps(vA.m_v, vB.m_v));
+}
+/** Gather sample lIndex of iChannels buffers into a vector, with
+    unused lanes set to zero. */
+template <int iChannels>
+inline CF_Vector cfGather(const LADSPA_Data * const * ppfBuffers,
+			  const unsigned long lIndex) {
+  return cfVector(_mm_setr_ps(ppfBuffers[0][lIndex],
+			      iChannels > 1 ? ppfBuffers[1][lIndex] : 0,
+			      iChannels > 2 ? ppfBuffers[2][lIndex] : 0,
+			      iChannels > 3 ? ppfBuffers[3][lIndex] : 0));
+}
+template <int iChannels>
+inline void cfScatter(LADSPA_Data * const * ppfBuffers,
+		      const unsigned long lIndex,
+		      const CF_Vector vValue) {
+  _mm_store_ss(ppfBuffers[0] + lIndex, vValue.m_v);
+  if (iChannels > 1)
+    _mm_store_ss(ppfBuffers[1] + lIndex, 
+		 _mm_shuffle_ps(vValue.m_v, vValue.m_v, 1));
+  if (iChannels > 2)
+    _mm_store_ss(ppfBuffers[2] + lIndex, 
+		 _mm_shuffle_ps(vValue.m_v, vValue.m_v, 2));
+  if (iChannels > 3)
+    _mm_store_ss(ppfBuffers[3] + lIndex, 
+		 _mm_shuffle_ps(vValue.m_v, vValue.m_v, 3));
+}
+#elif defined(CMT_KERNELS_NEON)
+struct CF_Vector {
+  float32x4_t m_v;
+};
+inline CF_Vector cfVector(const float32x4_t v) {
+  CF_Vector vResult = { v };
+  return vResult;
+}
+inline void cfSplat(CF_Vector & rvResult, const LADSPA_Data fValue) {
+  rvResult.m_v = vdupq_n_f32(fValue);
+}
+inline CF_Vector cfLoad(const LADSPA_Data * pfData) {
+  return cfVector(vld1q_f32(pfData));
+}
+inline void cfStore(LADSPA_Data * pfData, const CF_Vector vValue) {
+  vst1q_f32(pfData, vValue.m_v);
+}
+inline CF_Vector cfAdd(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(vaddq_f32(vA.m_v, vB.m_v));
+}
+inline CF_Vector cfSub(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(vsubq_f32(vA.m_v, vB.m_v));
+}
+inline CF_Vector cfMul(const CF_Vector vA, const CF_Vector vB) {
+  return cfVector(vmulq_f32(vA.m_v, vB.m_v));
+}
+template <int iChannels>
+inline CF_Vector cfGather(const LADSPA_Data * const * ppfBuffers,
+			  const unsigned long lIndex) {
+  float32x4_t v = vdupq_n_f32(0);
+  v = vsetq_lane_f32(ppfBuffers[0][lIndex], v, 0);
+  if (iChannels > 1)
+    v = vsetq_lane_f32(ppfBuffers[1][lIndex], v, 1);
+  if (iChannels > 2)
+    v = vsetq_lane_f32(ppfBuffers[2][lIndex], v, 2);
+  if (iChannels > 3)
+    v = vsetq_lane_f32(ppfBuffers[3][lIndex], v, 3);
+  return cfVector(v);
+}
+template <int iChannels>
+inline void cfScatter(LADSPA_Data * const * ppfBuffers,
+		      const unsigned long lIndex,
+		      const CF_Vector vValue) {
+  vst1q_lane_f32(ppfBuffers[0] + lIndex, vValue.m_v, 0);
+  if (iChannels > 1)
+    vst1q_lane_f32(ppfBuffers[1] + lIndex, vValue.m_v, 1);
+  if (iChannels > 2)
+    vst1q_lane_f32(ppfBuffers[2] + lIndex, vValue.m_v, 2);
+  if (iChannels > 3)
+    vst1q_lane_f32(ppfBuffers[3] + lIndex, vValue.m_v, 3);
+}
+#endif
+
+/*****************************************************************************/
+
+/** Coefficients of iSections sections in a form ready for the
+    section code, with T either LADSPA_Data or CF_Vector. */
+template <class T, bool bSVF, int iSections>
+struct CascadeCoefficients {
+
+  T m_tC[iSections][6];
+
+  CascadeCoefficients(const BiquadCoefficients * psBiquad,
+		      const SVFCoefficients * psSVF) {
+    for (int iSection = 0; iSection < iSections; iSection++) {
+      if (bSVF) {
+	cfSplat(m_tC[iSection][0], psSVF[iSection].m_fA1);
+	cfSplat(m_tC[iSection][1], psSVF[iSection].m_fA2);
+	cfSplat(m_tC[iSection][2], psSVF[iSection].m_fA3);
+	cfSplat(m_tC[iSection][3], psSVF[iSection].m_fM0);
+	cfSplat(m_tC[iSection][4], psSVF[iSection].m_fM1);
+	cfSplat(m_tC[iSection][5], psSVF[iSection].m_fM2);
+      }
+      else {
+	cfSplat(m_tC[iSection][0], psBiquad[iSection].m_fB0);
+	cfSplat(m_tC[iSection][1], psBiquad[iSection].m_fB1);
+	cfSplat(m_tC[iSection][2], psBiquad[iSection].m_fB2);
+	cfSplat(m_tC[iSection][3], psBiquad[iSection].m_fA1);
+	cfSplat(m_tC[iSection][4], psBiquad[iSection].m_fA2);
+      }
+    }
+  }
+
+  /** Run one sample (or one vector of samples) through the sections,
+      updating the state in ptState1 and ptState2. */
+  inline T process(const T tX, T * ptState1, T * ptState2) const {
+    return processSection(tX, ptState1, ptState2, CF_Section<0>());
+  }
+
+private:
+
+  /* The sections are unrolled at compile time by overloading on the
+     section index, which lets the compiler keep the state in
+     registers. */
+  template <int iSection> struct CF_Section {};
+
+  inline T processSection(const T tX, 
+			  T *, 
+			  T *, 
+			  CF_Section<iSections>) const {
+    return tX;
+  }
+
+  template <int iSection>
+  inline T processSection(const T tX, 
+			  T * ptState1, 
+			  T * ptState2, 
+			  CF_Section<iSection>) const {
+    const T * ptC = m_tC[iSection];
+    T & rtS1 = ptState1[iSection];
+    T & rtS2 = ptState2[iSection];
+    T tY;
+    if (bSVF) {
+      const T tV3 = cfSub(tX, rtS2);
+      const T tV1 = cfAdd(cfMul(ptC[0], rtS1), cfMul(ptC[1], tV3));
+      const T tV2 = cfAdd(rtS2, 
+			  cfAdd(cfMul(ptC[1], rtS1), cfMul(ptC[2], tV3)));
+      rtS1 = cfSub(cfAdd(tV1, tV1), rtS1);
+      rtS2 = cfSub(cfAdd(tV2, tV2), rtS2);
+      tY = cfAdd(cfMul(ptC[3], tX), 
+		 cfAdd(cfMul(ptC[4], tV1), cfMul(ptC[5], tV2)));
+    }
+    else {
+      tY = cfAdd(cfMul(ptC[0], tX), rtS1);
+      rtS1 = cfAdd(cfSub(cfMul(ptC[1], tX), cfMul(ptC[3], tY)), rtS2);
+      rtS2 = cfSub(cfMul(ptC[2], tX), cfMul(ptC[4], tY));
+    }
+    return processSection(tY, ptState1, ptState2, CF_Section<iSection + 1>());
+  }
+
+};
+
+/*****************************************************************************/
+
+/** Run the filter over a block. Each input sample is read before the
+    output for that sample is written, so outputs may share buffers
+    with their corresponding inputs. */
+template <bool bSVF, int iChannels, int iSections>
+void
+processCascadeFilter(CascadeFilter * poFilter,
+		     unsigned long lSampleCount) {
+
+  LADSPA_Data ** ppfInputs = poFilter->m_ppfPorts + CF_AUDIO(bSVF ? CF_SVF : CF_LOWPASS);
+  LADSPA_Data ** ppfOutputs = ppfInputs + iChannels;
+  unsigned long lIndex;
+
+#if defined(CF_VECTOR)
+  if (iChannels > 1) {
+
+    const CascadeCoefficients<CF_Vector, bSVF, iSections> 
+      oCoefficients(poFilter->m_asBiquad, poFilter->m_asSVF);
+    CF_Vector avState1[iSections];
+    CF_Vector avState2[iSections];
+    int iSection;
+    for (iSection = 0; iSection < iSections; iSection++) {
+      avState1[iSection] = cfLoad(poFilter->m_afState1[iSection]);
+      avState2[iSection] = cfLoad(poFilter->m_afState2[iSection]);
+    }
+
+    const LADSPA_Data * apfInputs[iChannels];
+    LADSPA_Data * apfOutputs[iChannels];
+    for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+      apfInputs[iChannel] = ppfInputs[iChannel];
+      apfOutputs[iChannel] = ppfOutputs[iChannel];
+    }
+
+    /* Unused lanes run on silence. */
+    for (lIndex = 0; lIndex < lSampleCount; lIndex++)
+      cfScatter<iChannels>(apfOutputs,
+			   lIndex,
+			   oCoefficients.process
+			   (cfGather<iChannels>(apfInputs, lIndex), 
+			    avState1, 
+			    avState2));
+
+    for (iSection = 0; iSection < iSections; iSection++) {
+      cfStore(poFilter->m_afState1[iSection], avState1[iSection]);
+      cfStore(poFilter->m_afState2[iSection], avState2[iSection]);
+    }
+    return;
+  }
+#endif
+
+  const CascadeCoefficients<LADSPA_Data, bSVF, iSections> 
+    oCoefficients(poFilter->m_asBiquad, poFilter->m_asSVF);
+
+  for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+
+    LADSPA_Data afState1[iSections];
+    LADSPA_Data afState2[iSections];
+    int iSection;
+    for (iSection = 0; iSection < iSections; iSection++) {
+      afState1[iSection] = poFilter->m_afState1[iSection][iChannel];
+      afState2[iSection] = poFilter->m_afState2[iSection][iChannel];
+    }
+
+    const LADSPA_Data * pfInput = ppfInputs[iChannel];
+    LADSPA_Data * pfOutput = ppfOutputs[iChannel];
+    for (lIndex = 0; lIndex < lSampleCount; lIndex++)
+      pfOutput[lIndex] 
+	= oCoefficients.process(pfInput[lIndex], afState1, afState2);
+
+    for (iSection = 0; iSection < iSections; iSection++) {
+      poFilter->m_afState1[iSection][iChannel] = afState1[iSection];
+      poFilter->m_afState2[iSection][iChannel] = afState2[iSection];
+    }
+  }
+}
+
+/*****************************************************************************/
+
+template <int iKind, int iChannels>
+static void 
+runCascadeFilter(LADSPA_Handle Instance,
+		 unsigned long SampleCount) {
+
+  CascadeFilter * poFilter = (CascadeFilter *)Instance;
+  const bool bSVF = (iKind == CF_SVF);
+
+  poFilter->design(iKind);
+
+  switch (poFilter->m_iSectionCount) {
+  case 1:
+    processCascadeFilter<bSVF, iChannels, 1>(poFilter, SampleCount);
+    break;
+  case 2:
+    processCascadeFilter<bSVF, iChannels, 2>(poFilter, SampleCount);
+    break;
+  case 3:
+    processCascadeFilter<bSVF, iChannels, 3>(poFilter, SampleCount);
+    break;
+  default:
+    processCascadeFilter<bSVF, iChannels, 4>(poFilter, SampleCount);
+    break;
+  }
+}
+
+/*****************************************************************************/
+
+/** Run a multichannel OnePoll filter. The recurrence is serial within
+    each channel, so the channels are run side by side in vector lanes
+    (two vectors for eight channels) where SSE or NEON is
+    available. */
+template <bool bHighPass, int iChannels>
+static void 
+runMultiOnePollFilter(LADSPA_Handle Instance,
+		      unsigned long SampleCount) {
+
+  OnePollFilter * poFilter = (OnePollFilter *)Instance;
+
+  LADSPA_Data ** ppfInputs = poFilter->m_ppfPorts + SF_INPUT;
+  LADSPA_Data ** ppfOutputs = ppfInputs + iChannels;
+
+  poFilter->calculateCoefficients(bHighPass);
+
+  unsigned long lSampleIndex;
+
+#if defined(CF_VECTOR)
+  /* Channels per vector. */
+  const int iLanes = (iChannels > 4 ? 4 : iChannels);
+  const int iVectors = iChannels / iLanes;
+
+  CF_Vector vAmountOfCurrent, vAmountOfLast;
+  cfSplat(vAmountOfCurrent, poFilter->m_fAmountOfCurrent);
+  cfSplat(vAmountOfLast, poFilter->m_fAmountOfLast);
+
+  const LADSPA_Data * apfInputs[iChannels];
+  LADSPA_Data * apfOutputs[iChannels];
+  CF_Vector avLastOutput[iVectors];
+  int iChannel, iVector;
+  for (iChannel = 0; iChannel < iChannels; iChannel++) {
+    apfInputs[iChannel] = ppfInputs[iChannel];
+    apfOutputs[iChannel] = ppfOutputs[iChannel];
+  }
+  for (iVector = 0; iVector < iVectors; iVector++)
+    avLastOutput[iVector] 
+      = cfLoad(poFilter->m_afLastOutput + iVector * iLanes);
+
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    /* All inputs for this sample are read before any output is
+       written. */
+    CF_Vector avInput[iVectors];
+    for (iVector = 0; iVector < iVectors; iVector++)
+      avInput[iVector] 
+	= cfGather<iLanes>(apfInputs + iVector * iLanes, lSampleIndex);
+    for (iVector = 0; iVector < iVectors; iVector++) {
+      avLastOutput[iVector] 
+	= cfAdd(cfMul(vAmountOfCurrent, avInput[iVector]),
+		cfMul(vAmountOfLast, avLastOutput[iVector]));
+      cfScatter<iLanes>(apfOutputs + iVector * iLanes,
+			lSampleIndex,
+			(bHighPass
+			 ? cfSub(avInput[iVector], avLastOutput[iVector])
+			 : avLastOutput[iVector]));
+    }
+  }
+
+  /* cfStore() writes whole vectors, so go through a buffer when a
+     vector is only partly used. */
+  LADSPA_Data afLastOutput[4 * iVectors];
+  for (iVector = 0; iVector < iVectors; iVector++)
+    cfStore(afLastOutput + 4 * iVector, avLastOutput[iVector]);
+  for (iVector = 0; iVector < iVectors; iVector++)
+    for (iChannel = 0; iChannel < iLanes; iChannel++)
+      poFilter->m_afLastOutput[iVector * iLanes + iChannel]
+	= afLastOutput[4 * iVector + iChannel];
+#else
+  const LADSPA_Data fAmountOfCurrent = poFilter->m_fAmountOfCurrent;
+  const LADSPA_Data fAmountOfLast = poFilter->m_fAmountOfLast;
+
+  for (int iChannel = 0; iChannel < iChannels; iChannel++) {
+
+    const LADSPA_Data * pfInput = ppfInputs[iChannel];
+    LADSPA_Data * pfOutput = ppfOutputs[iChannel];
+    LADSPA_Data fLastOutput = poFilter->m_afLastOutput[iChannel];
+
+    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+      const LADSPA_Data fInput = pfInput[lSampleIndex];
+      fLastOutput = fAmountOfCurrent * fInput + fAmountOfLast * fLastOutput;
+      pfOutput[lSampleIndex] = bHighPass ? fInput - fLastOutput : fLastOutput;
+    }
+
+    poFilter->m_afLastOutput[iChannel] = fLastOutput;
+  }
+#endif
 }
 
 /*****************************************************************************/
@@ -195,9 +880,9 @@ initialise_filter() {
      NULL,
      CMT_Instantiate<OnePollFilter>,
      activateOnePollFilter,
-     runOnePollLowPassFilter,
-     NULL,
-     NULL,
+     runOnePollLowPassFilter<write_output_normal>,
+     runOnePollLowPassFilter<write_output_adding>,
+     setOnePollFilterRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -215,6 +900,7 @@ initialise_filter() {
   psDescriptor->addPort
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");
+  psDescriptor->setRunBatch(runOnePollFilterBatch<false>);
   registerNewPluginDescriptor(psDescriptor);
 
   psDescriptor = new CMT_Descriptor
@@ -227,9 +913,9 @@ initialise_filter() {
      NULL,
      CMT_Instantiate<OnePollFilter>,
      activateOnePollFilter,
-     runOnePollHighPassFilter,
-     NULL,
-     NULL,
+     runOnePollHighPassFilter<write_output_normal>,
+     runOnePollHighPassFilter<write_output_adding>,
+     setOnePollFilterRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -247,7 +933,242 @@ initialise_filter() {
   psDescriptor->addPort
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");    
+  psDescriptor->setRunBatch(runOnePollFilterBatch<true>);
   registerNewPluginDescriptor(psDescriptor);
+
+  const int piOnePollChannels[] = { 2, 4, 8 };
+  LADSPA_Run_Function aafOnePollRunFunction[2][3] = {
+    { runMultiOnePollFilter<false, 2>,
+      runMultiOnePollFilter<false, 4>,
+      runMultiOnePollFilter<false, 8> },
+    { runMultiOnePollFilter<true, 2>,
+      runMultiOnePollFilter<true, 4>,
+      runMultiOnePollFilter<true, 8> }
+  };
+
+  for (int iHighPass = 0; iHighPass < 2; iHighPass++) {
+    for (int iVariant = 0; iVariant < 3; iVariant++) {
+
+      const int iChannels = piOnePollChannels[iVariant];
+      char acLabel[64];
+      char acName[128];
+      sprintf(acLabel, "%s_x%d", iHighPass ? "hpf" : "lpf", iChannels);
+      sprintf(acName, 
+	      "%s Pass Filter (One Pole, %d Channel)", 
+	      iHighPass ? "High" : "Low",
+	      iChannels);
+
+      psDescriptor = new CMT_Descriptor
+	(1963 + iHighPass * 3 + iVariant,
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<OnePollFilter>,
+	 activateOnePollFilter,
+	 aafOnePollRunFunction[iHighPass][iVariant],
+	 NULL,
+	 NULL,
+	 NULL);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Cutoff Frequency (Hz)",
+	 (LADSPA_HINT_BOUNDED_BELOW 
+	  | LADSPA_HINT_BOUNDED_ABOVE
+	  | LADSPA_HINT_SAMPLE_RATE
+	  | LADSPA_HINT_LOGARITHMIC
+	  | LADSPA_HINT_DEFAULT_440),
+	 0, 
+	 0.5f); /* Nyquist frequency (half the sample rate) */
+      int iChannel;
+      for (iChannel = 0; iChannel < iChannels; iChannel++) {
+	char acPortName[32];
+	sprintf(acPortName, "Input %d", iChannel + 1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (iChannel = 0; iChannel < iChannels; iChannel++) {
+	char acPortName[32];
+	sprintf(acPortName, "Output %d", iChannel + 1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      registerNewPluginDescriptor(psDescriptor);
+    }
+  }
+
+  const char * apcKindLabels[CF_KIND_COUNT] = {
+    "lpf_cascade",
+    "hpf_cascade",
+    "bpf_cascade",
+    "notch_cascade",
+    "lowshelf_cascade",
+    "highshelf_cascade",
+    "svf_cascade"
+  };
+  const char * apcKindNames[CF_KIND_COUNT] = {
+    "Low Pass Filter (Cascaded Biquad",
+    "High Pass Filter (Cascaded Biquad",
+    "Band Pass Filter (Cascaded Biquad",
+    "Notch Filter (Cascaded Biquad",
+    "Low Shelf Filter (Cascaded Biquad",
+    "High Shelf Filter (Cascaded Biquad",
+    "State Variable Filter (Cascaded"
+  };
+  const char * apcChannelSuffixes[] = { "", "_x2", "_x4" };
+  const char * apcChannelNames[] = { "", ", Stereo", ", 4 Channel" };
+  const int piChannels[] = { 1, 2, 4 };
+  LADSPA_Run_Function aafRunFunction[CF_KIND_COUNT][3] = {
+    { runCascadeFilter<CF_LOWPASS, 1>,
+      runCascadeFilter<CF_LOWPASS, 2>, 
+      runCascadeFilter<CF_LOWPASS, 4> },
+    { runCascadeFilter<CF_HIGHPASS, 1>,
+      runCascadeFilter<CF_HIGHPASS, 2>, 
+      runCascadeFilter<CF_HIGHPASS, 4> },
+    { runCascadeFilter<CF_BANDPASS, 1>,
+      runCascadeFilter<CF_BANDPASS, 2>, 
+      runCascadeFilter<CF_BANDPASS, 4> },
+    { runCascadeFilter<CF_NOTCH, 1>,
+      runCascadeFilter<CF_NOTCH, 2>, 
+      runCascadeFilter<CF_NOTCH, 4> },
+    { runCascadeFilter<CF_LOWSHELF, 1>,
+      runCascadeFilter<CF_LOWSHELF, 2>, 
+      runCascadeFilter<CF_LOWSHELF, 4> },
+    { runCascadeFilter<CF_HIGHSHELF, 1>,
+      runCascadeFilter<CF_HIGHSHELF, 2>, 
+      runCascadeFilter<CF_HIGHSHELF, 4> },
+    { runCascadeFilter<CF_SVF, 1>,
+      runCascadeFilter<CF_SVF, 2>, 
+      runCascadeFilter<CF_SVF, 4> }
+  };
+
+  for (int iKind = 0; iKind < CF_KIND_COUNT; iKind++) {
+    for (int iVariant = 0; iVariant < 3; iVariant++) {
+
+      char acLabel[64];
+      char acName[128];
+      sprintf(acLabel, 
+	      "%s%s", 
+	      apcKindLabels[iKind],
+	      apcChannelSuffixes[iVariant]);
+      sprintf(acName,
+	      "%s%s)",
+	      apcKindNames[iKind],
+	      apcChannelNames[iVariant]);
+
+      psDescriptor = new CMT_Descriptor
+	(1942 + iKind * 3 + iVariant,
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<CascadeFilter>,
+	 activateCascadeFilter,
+	 aafRunFunction[iKind][iVariant],
+	 NULL,
+	 NULL,
+	 NULL);
+
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 (iKind == CF_BANDPASS || iKind == CF_NOTCH
+	  ? "Centre Frequency (Hz)"
+	  : "Cutoff Frequency (Hz)"),
+	 (LADSPA_HINT_BOUNDED_BELOW 
+	  | LADSPA_HINT_BOUNDED_ABOVE
+	  | LADSPA_HINT_SAMPLE_RATE
+	  | LADSPA_HINT_LOGARITHMIC
+	  | LADSPA_HINT_DEFAULT_440),
+	 0, 
+	 0.5f); /* Nyquist frequency (half the sample rate) */
+      switch (iKind) {
+      case CF_BANDPASS:
+      case CF_NOTCH:
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	   "Q",
+	   (LADSPA_HINT_BOUNDED_BELOW 
+	    | LADSPA_HINT_BOUNDED_ABOVE
+	    | LADSPA_HINT_LOGARITHMIC
+	    | LADSPA_HINT_DEFAULT_1),
+	   0.1f, 
+	   100);
+	break;
+      case CF_LOWSHELF:
+      case CF_HIGHSHELF:
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	   "Gain (dB)",
+	   (LADSPA_HINT_BOUNDED_BELOW 
+	    | LADSPA_HINT_BOUNDED_ABOVE
+	    | LADSPA_HINT_DEFAULT_0),
+	   -24, 
+	   24);
+	break;
+      default:
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	   "Q (Relative to Butterworth)",
+	   (LADSPA_HINT_BOUNDED_BELOW 
+	    | LADSPA_HINT_BOUNDED_ABOVE
+	    | LADSPA_HINT_LOGARITHMIC
+	    | LADSPA_HINT_DEFAULT_1),
+	   0.25f, 
+	   32);
+	break;
+      }
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 "Order", 
+	 (LADSPA_HINT_BOUNDED_BELOW 
+	  | LADSPA_HINT_BOUNDED_ABOVE
+	  | LADSPA_HINT_INTEGER
+	  | LADSPA_HINT_DEFAULT_MINIMUM),
+	 2, 
+	 2 * CF_MAX_SECTIONS);
+      if (iKind == CF_SVF)
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	   "Mode (0=LP, 1=BP, 2=HP, 3=Notch)", 
+	   (LADSPA_HINT_BOUNDED_BELOW 
+	    | LADSPA_HINT_BOUNDED_ABOVE
+	    | LADSPA_HINT_INTEGER
+	    | LADSPA_HINT_DEFAULT_MINIMUM),
+	   SVF_LOWPASS, 
+	   SVF_NOTCH);
+
+      const int iChannels = piChannels[iVariant];
+      int iChannel;
+      for (iChannel = 0; iChannel < iChannels; iChannel++) {
+	char acPortName[32];
+	if (iChannels == 1)
+	  sprintf(acPortName, "Input");
+	else
+	  sprintf(acPortName, "Input %d", iChannel + 1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (iChannel = 0; iChannel < iChannels; iChannel++) {
+	char acPortName[32];
+	if (iChannels == 1)
+	  sprintf(acPortName, "Output");
+	else
+	  sprintf(acPortName, "Output %d", iChannel + 1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+
+      registerNewPluginDescriptor(psDescriptor);
+    }
+  }
 }
 
 /*****************************************************************************/
@@ -0,0 +1,182 @@
+// Comb filter bank implementation
+//
+// Added for CMT, based on the comb filter written by Jezar at
+// Dreampoint, June 2000
+// http://www.dreampoint.co.uk
+// This code is public domain
+
+#include "../../kernels.h"
+#include "combbank.h"
+#include "denormals.h"
+
+combbank::combbank()
+{
+	for (int i=0; i<numcombs; i++)
+	{
+		filterstore[i] = 0;
+		buffer[i] = 0;
+		bufsize[i] = 0;
+		bufidx[i] = 0;
+	}
+}
+
+void combbank::setbuffer(int index, float *buf, int size) 
+{
+	buffer[index] = buf; 
+	bufsize[index] = size;
+}
+
+void combbank::mute()
+{
+	for (int i=0; i<numcombs; i++)
+		for (int j=0; j<bufsize[i]; j++)
+			buffer[i][j]=0;
+}
+
+void combbank::setdamp(float val) 
+{
+	damp1 = val; 
+	damp2 = 1-val;
+}
+
+float combbank::getdamp() 
+{
+	return damp1;
+}
+
+void combbank::setfeedback(float val) 
+{
+	feedback = val;
+}
+
+float combbank::getfeedback() 
+{
+	return feedback;
+}
+
+// Run combs first to first+combbanklanes-1 over numsamples (at most
+// combbankblock) samples, writing their outputs interleaved, so the
+// output of comb first+j for sample i is outputs[i*combbanklanes+j].
+// The work is split into runs in which no comb's buffer index wraps.
+void combbank::processlanes(int first, const float *input, float *outputs, long numsamples)
+{
+	float *bufferat[combbanklanes];
+	int j;
+
+#if defined(CMT_KERNELS_SSE)
+	__m128 vfilterstore = _mm_loadu_ps(filterstore + first);
+	const __m128 vdamp1 = _mm_set1_ps(damp1);
+	const __m128 vdamp2 = _mm_set1_ps(damp2);
+	const __m128 vfeedback = _mm_set1_ps(feedback);
+#elif defined(CMT_KERNELS_NEON)
+	float32x4_t vfilterstore = vld1q_f32(filterstore + first);
+#else
+	float lanefilterstore[combbanklanes];
+	for (j=0; j<combbanklanes; j++)
+		lanefilterstore[j] = filterstore[first+j];
+#endif
+
+	long done = 0;
+	while (done < numsamples)
+	{
+		long run = numsamples - done;
+		for (j=0; j<combbanklanes; j++)
+		{
+			long left = bufsize[first+j] - bufidx[first+j];
+			if (left < run)
+				run = left;
+			bufferat[j] = buffer[first+j] + bufidx[first+j];
+		}
+
+		for (long i=0; i<run; i++)
+		{
+			const float inp = input[done+i];
+			float *outputat = outputs + (done+i)*combbanklanes;
+#if defined(CMT_KERNELS_SSE)
+			__m128 voutput = _mm_setr_ps(bufferat[0][i], bufferat[1][i],
+						     bufferat[2][i], bufferat[3][i]);
+			vfilterstore = _mm_add_ps(_mm_mul_ps(voutput, vdamp2),
+						  _mm_mul_ps(vfilterstore, vdamp1));
+			float write[combbanklanes];
+			_mm_storeu_ps(write, _mm_add_ps(_mm_set1_ps(inp),
+							_mm_mul_ps(vfilterstore, vfeedback)));
+			_mm_storeu_ps(outputat, voutput);
+#elif defined(CMT_KERNELS_NEON)
+			float read[combbanklanes];
+			for (j=0; j<combbanklanes; j++)
+				read[j] = bufferat[j][i];
+			float32x4_t voutput = vld1q_f32(read);
+			vfilterstore = vaddq_f32(vmulq_n_f32(voutput, damp2),
+						 vmulq_n_f32(vfilterstore, damp1));
+			float write[combbanklanes];
+			vst1q_f32(write, vaddq_f32(vdupq_n_f32(inp),
+						   vmulq_n_f32(vfilterstore, feedback)));
+			vst1q_f32(outputat, voutput);
+#else
+			float write[combbanklanes];
+			for (j=0; j<combbanklanes; j++)
+			{
+				float output = bufferat[j][i];
+				undenormalise(output);
+				float store = (output*damp2) + (lanefilterstore[j]*damp1);
+				undenormalise(store);
+				lanefilterstore[j] = store;
+				write[j] = inp + (store*feedback);
+				outputat[j] = output;
+			}
+#endif
+			for (j=0; j<combbanklanes; j++)
+				bufferat[j][i] = write[j];
+		}
+
+		for (j=0; j<combbanklanes; j++)
+		{
+			bufidx[first+j] += run;
+			if (bufidx[first+j] >= bufsize[first+j])
+				bufidx[first+j] = 0;
+		}
+		done += run;
+	}
+
+#if defined(CMT_KERNELS_SSE)
+	_mm_storeu_ps(filterstore + first, vfilterstore);
+#elif defined(CMT_KERNELS_NEON)
+	vst1q_f32(filterstore + first, vfilterstore);
+#else
+	for (j=0; j<combbanklanes; j++)
+		filterstore[first+j] = lanefilterstore[j];
+#endif
+}
+
+// Write the sum of the comb outputs for each input sample to output.
+// The outputs are added in comb order so the result matches the comb
+// class exactly.
+void combbank::process(const float *input, float *output, long numsamples)
+{
+	float laneoutputs[numcombs/combbanklanes][combbankblock*combbanklanes];
+
+	while (numsamples > 0)
+	{
+		long block = numsamples;
+		if (block > combbankblock)
+			block = combbankblock;
+
+		for (int k=0; k<numcombs/combbanklanes; k++)
+			processlanes(k*combbanklanes, input, laneoutputs[k], block);
+
+		for (long i=0; i<block; i++)
+		{
+			float sum = 0;
+			for (int k=0; k<numcombs/combbanklanes; k++)
+				for (int j=0; j<combbanklanes; j++)
+					sum += laneoutputs[k][i*combbanklanes+j];
+			output[i] = sum;
+		}
+
+		input += block;
+		output += block;
+		numsamples -= block;
+	}
+}
+
+//ends
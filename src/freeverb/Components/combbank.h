@@ -0,0 +1,50 @@
+// Comb filter bank declaration
+//
+// Added for CMT, based on the comb filter written by Jezar at
+// Dreampoint, June 2000
+// http://www.dreampoint.co.uk
+// This code is public domain
+
+#ifndef _combbank_
+#define _combbank_
+
+#include "tuning.h"
+
+// Number of combs run side by side (in SIMD lanes where the
+// compiler targets SSE or NEON). numcombs must be a multiple of this.
+const int combbanklanes = 4;
+
+// Longest run of samples processed in one pass.
+const int combbankblock = 64;
+
+// A bank of numcombs comb filters sharing their feedback and damping
+// settings, as all of revmodel's combs do. The filters' state is kept
+// in arrays rather than separate objects and a block of samples is
+// processed at a time. The output is identical to summing the
+// outputs of numcombs comb objects sample by sample.
+class combbank
+{
+public:
+					combbank();
+			void	setbuffer(int index, float *buf, int size);
+			void	process(const float *input, float *output, long numsamples);
+			void	mute();
+			void	setdamp(float val);
+			float	getdamp();
+			void	setfeedback(float val);
+			float	getfeedback();
+private:
+			void	processlanes(int first, const float *input, float *outputs, long numsamples);
+private:
+	float	feedback;
+	float	damp1;
+	float	damp2;
+	float	filterstore[numcombs];
+	float	*buffer[numcombs];
+	int		bufsize[numcombs];
+	int		bufidx[numcombs];
+};
+
+#endif//_combbank_
+
+//ends
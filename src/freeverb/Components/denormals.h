@@ -10,8 +10,18 @@
 
 //#define undenormalise(sample) if(((*(unsigned int*)&sample)&0x7f800000)==0) sample=0.0f
 
+// CMT runs every plugin with denormals flushed to zero by the hardware
+// where it can (see ../../denormal.h), so the per-sample check is only
+// needed on other targets.
+
+#include "../../denormal.h"
+
+#ifdef CMT_DENORMALS_FLUSHED
+#define undenormalise(sample)
+#else
 #include <cmath>
 #define undenormalise(sample) if(!std::isnormal(sample)) sample=0.0f
+#endif
 
 #endif//_denormals_
 
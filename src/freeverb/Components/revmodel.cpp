@@ -5,6 +5,7 @@
 // This code is public domain
 
 #include <stdio.h>
+#include "../../kernels.h"
 #include "revmodel.h"
 
 int revmodel::calcbufferlength(int tuning, float ratio)
@@ -63,51 +64,56 @@ revmodel::revmodel(float samplerate)
 	int allpasslengthL4 = calcbufferlength(allpasstuningL4,ratio);
 	int allpasslengthR4 = calcbufferlength(allpasstuningR4,ratio);
 	// Create buffer space
-	buffers = new float[comblengthL1+comblengthR1
-			    +comblengthL2+comblengthR2
-			    +comblengthL3+comblengthR3
-			    +comblengthL4+comblengthR4
-			    +comblengthL5+comblengthR5
-			    +comblengthL6+comblengthR6
-			    +comblengthL7+comblengthR7
-			    +comblengthL8+comblengthR8
-			    +allpasslengthL1+allpasslengthR1
-			    +allpasslengthL2+allpasslengthR2
-			    +allpasslengthL3+allpasslengthR3
-			    +allpasslengthL4+allpasslengthR4];
+	bufferlength = comblengthL1+comblengthR1
+		+comblengthL2+comblengthR2
+		+comblengthL3+comblengthR3
+		+comblengthL4+comblengthR4
+		+comblengthL5+comblengthR5
+		+comblengthL6+comblengthR6
+		+comblengthL7+comblengthR7
+		+comblengthL8+comblengthR8
+		+allpasslengthL1+allpasslengthR1
+		+allpasslengthL2+allpasslengthR2
+		+allpasslengthL3+allpasslengthR3
+		+allpasslengthL4+allpasslengthR4;
+	buffers = new float[bufferlength];
+	// The right channel's filters are the longer ones
+	taillength = comblengthR8
+		+allpasslengthR1+allpasslengthR2
+		+allpasslengthR3+allpasslengthR4;
 	// Tie the components to their buffers
 	float * bufferat = buffers;
-	combL[0].setbuffer(bufferat,comblengthL1);
+	combL.setbuffer(0,bufferat,comblengthL1);
 	bufferat += comblengthL1;
-	combR[0].setbuffer(bufferat,comblengthR1);
+	combR.setbuffer(0,bufferat,comblengthR1);
 	bufferat += comblengthR1;
-	combL[1].setbuffer(bufferat,comblengthL2);
+	combL.setbuffer(1,bufferat,comblengthL2);
 	bufferat += comblengthL2;
-	combR[1].setbuffer(bufferat,comblengthR2);
+	combR.setbuffer(1,bufferat,comblengthR2);
 	bufferat += comblengthR2;
-	combL[2].setbuffer(bufferat,comblengthL3);
+	combL.setbuffer(2,bufferat,comblengthL3);
 	bufferat += comblengthL3;
-	combR[2].setbuffer(bufferat,comblengthR3);
+	combR.setbuffer(2,bufferat,comblengthR3);
 	bufferat += comblengthR3;
-	combL[3].setbuffer(bufferat,comblengthL4);
+	combL.setbuffer(3,bufferat,comblengthL4);
 	bufferat += comblengthL4;
-	combR[3].setbuffer(bufferat,comblengthR4);
+	combR.setbuffer(3,bufferat,comblengthR4);
 	bufferat += comblengthR4;
-	combL[4].setbuffer(bufferat,comblengthL5);
+	combL.setbuffer(4,bufferat,comblengthL5);
 	bufferat += comblengthL5;
-	combR[4].setbuffer(bufferat,comblengthR5);
+	combR.setbuffer(4,bufferat,comblengthR5);
 	bufferat += comblengthR5;
-	combL[5].setbuffer(bufferat,comblengthL6);
+	combL.setbuffer(5,bufferat,comblengthL6);
 	bufferat += comblengthL6;
-	combR[5].setbuffer(bufferat,comblengthR6);
+	combR.setbuffer(5,bufferat,comblengthR6);
 	bufferat += comblengthR6;
-	combL[6].setbuffer(bufferat,comblengthL7);
+	combL.setbuffer(6,bufferat,comblengthL7);
 	bufferat += comblengthL7;
-	combR[6].setbuffer(bufferat,comblengthR7);
+	combR.setbuffer(6,bufferat,comblengthR7);
 	bufferat += comblengthR7;
-	combL[7].setbuffer(bufferat,comblengthL8);
+	combL.setbuffer(7,bufferat,comblengthL8);
 	bufferat += comblengthL8;
-	combR[7].setbuffer(bufferat,comblengthR8);
+	combR.setbuffer(7,bufferat,comblengthR8);
 	bufferat += comblengthR8;
 	allpassL[0].setbuffer(bufferat,allpasslengthL1);
 	bufferat += allpasslengthL1;
@@ -157,11 +163,8 @@ void revmodel::mute()
 	if (getmode() >= freezemode)
 		return;
 
-	for (i=0;i<numcombs;i++)
-	{
-		combL[i].mute();
-		combR[i].mute();
-	}
+	combL.mute();
+	combR.mute();
 	for (i=0;i<numallpasses;i++)
 	{
 		allpassL[i].mute();
@@ -169,84 +172,84 @@ void revmodel::mute()
 	}
 }
 
-void revmodel::processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
+// Process a block, one filter at a time over up to combbankblock
+// samples. As each filter is causal this gives the same output as
+// stepping all of them sample by sample. When mixing, the output is
+// scaled by mixgain before it is added.
+void revmodel::processblock(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, bool mix, float mixgain)
 {
-	float outL,outR,input;
-	int i;
+	float input[combbankblock];
+	float outL[combbankblock];
+	float outR[combbankblock];
+	long i;
+	int j;
 
-	while(numsamples-- > 0)
+	while(numsamples > 0)
 	{
-		outL = outR = 0;
-		input = (*inputL + *inputR) * gain;
+		long block = numsamples;
+		if (block > combbankblock)
+			block = combbankblock;
+
+		for(i=0; i<block; i++)
+			input[i] = (inputL[i*skip] + inputR[i*skip]) * gain;
 
 		// Accumulate comb filters in parallel
-		for(i=0; i<numcombs; i++)
-		{
-			outL += combL[i].process(input);
-			outR += combR[i].process(input);
-		}
+		combL.process(input,outL,block);
+		combR.process(input,outR,block);
 
 		// Feed through allpasses in series
-		for(i=0; i<numallpasses; i++)
+		for(j=0; j<numallpasses; j++)
 		{
-			outL = allpassL[i].process(outL);
-			outR = allpassR[i].process(outR);
+			for(i=0; i<block; i++)
+			{
+				outL[i] = allpassL[j].process(outL[i]);
+				outR[i] = allpassR[j].process(outR[i]);
+			}
 		}
 
-		// Calculate output REPLACING anything already there
-		*outputL = outL*wet1 + outR*wet2 + *inputL*dry;
-		*outputR = outR*wet1 + outL*wet2 + *inputR*dry;
+		// Calculate output REPLACING or MIXING with anything already
+		// there. Inputs are read first in case the buffers are shared.
+		for(i=0; i<block; i++)
+		{
+			float inL = inputL[i*skip];
+			float inR = inputR[i*skip];
+			float wetL = outL[i]*wet1 + outR[i]*wet2 + inL*dry;
+			float wetR = outR[i]*wet1 + outL[i]*wet2 + inR*dry;
+			if (mix)
+			{
+				outputL[i*skip] += wetL*mixgain;
+				outputR[i*skip] += wetR*mixgain;
+			}
+			else
+			{
+				outputL[i*skip] = wetL;
+				outputR[i*skip] = wetR;
+			}
+		}
 
 		// Increment sample pointers, allowing for interleave (if any)
-		inputL += skip;
-		inputR += skip;
-		outputL += skip;
-		outputR += skip;
+		inputL += block*skip;
+		inputR += block*skip;
+		outputL += block*skip;
+		outputR += block*skip;
+		numsamples -= block;
 	}
 }
 
-void revmodel::processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
+void revmodel::processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip)
 {
-	float outL,outR,input;
-	int i;
-
-	while(numsamples-- > 0)
-	{
-		outL = outR = 0;
-		input = (*inputL + *inputR) * gain;
-
-		// Accumulate comb filters in parallel
-		for(i=0; i<numcombs; i++)
-		{
-			outL += combL[i].process(input);
-			outR += combR[i].process(input);
-		}
-
-		// Feed through allpasses in series
-		for(i=0; i<numallpasses; i++)
-		{
-			outL = allpassL[i].process(outL);
-			outR = allpassR[i].process(outR);
-		}
-
-		// Calculate output MIXING with anything already there
-		*outputL += outL*wet1 + outR*wet2 + *inputL*dry;
-		*outputR += outR*wet1 + outL*wet2 + *inputR*dry;
+	processblock(inputL,inputR,outputL,outputR,numsamples,skip,false,1);
+}
 
-		// Increment sample pointers, allowing for interleave (if any)
-		inputL += skip;
-		inputR += skip;
-		outputL += skip;
-		outputR += skip;
-	}
+void revmodel::processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, float mixgain)
+{
+	processblock(inputL,inputR,outputL,outputR,numsamples,skip,true,mixgain);
 }
 
 void revmodel::update()
 {
 // Recalculate internal values after parameter change
 
-	int i;
-
 	wet1 = wet*(width/2 + 0.5f);
 	wet2 = wet*((1-width)/2);
 
@@ -263,17 +266,11 @@ void revmodel::update()
 		gain = fixedgain;
 	}
 
-	for(i=0; i<numcombs; i++)
-	{
-		combL[i].setfeedback(roomsize1);
-		combR[i].setfeedback(roomsize1);
-	}
+	combL.setfeedback(roomsize1);
+	combR.setfeedback(roomsize1);
 
-	for(i=0; i<numcombs; i++)
-	{
-		combL[i].setdamp(damp1);
-		combR[i].setdamp(damp1);
-	}
+	combL.setdamp(damp1);
+	combR.setdamp(damp1);
 }
 
 // The following get/set functions are not inlined, because
@@ -349,4 +346,43 @@ float revmodel::getmode()
 		return 0;
 }
 
+// Set all the parameters at once, as the set functions above would,
+// but only recalculating the internal values if something affecting
+// them has actually changed. This is cheap enough to call for every
+// block.
+void revmodel::setparameters(float newmode, float newroomsize, float newdamp, float newwet, float newdry, float newwidth)
+{
+	newroomsize = (newroomsize*scaleroom) + offsetroom;
+	newdamp = newdamp*scaledamp;
+	newwet = newwet*scalewet;
+	dry = newdry*scaledry;
+
+	if (newmode != mode
+	    || newroomsize != roomsize
+	    || newdamp != damp
+	    || newwet != wet
+	    || newwidth != width)
+	{
+		mode = newmode;
+		roomsize = newroomsize;
+		damp = newdamp;
+		wet = newwet;
+		width = newwidth;
+		update();
+	}
+}
+
+// Samples of silent input after which anything still in the
+// filters has passed through them at least once
+int revmodel::gettaillength()
+{
+	return taillength;
+}
+
+// True if everything held in the filters is no louder than threshold
+bool revmodel::isquiet(float threshold)
+{
+	return isBelowThreshold(buffers,threshold,bufferlength);
+}
+
 //ends
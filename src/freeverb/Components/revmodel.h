@@ -7,7 +7,7 @@
 #ifndef _revmodel_
 #define _revmodel_
 
-#include "comb.h"
+#include "combbank.h"
 #include "allpass.h"
 #include "tuning.h"
 
@@ -20,7 +20,7 @@ public:
 					revmodel(float samplerate);
 					~revmodel();
 			void	mute();
-			void	processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip);
+			void	processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, float mixgain = 1);
 			void	processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip);
 			void	setroomsize(float value);
 			float	getroomsize();
@@ -34,9 +34,13 @@ public:
 			float	getwidth();
 			void	setmode(float value);
 			float	getmode();
+			void	setparameters(float newmode, float newroomsize, float newdamp, float newwet, float newdry, float newwidth);
+			int	gettaillength();
+			bool	isquiet(float threshold);
 private:
 			int	calcbufferlength(int tuning, float ratio);
 			void	update();
+			void	processblock(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip, bool mix, float mixgain);
 private:
 	float	gain;
 	float	roomsize,roomsize1;
@@ -47,8 +51,8 @@ private:
 	float	mode;
 
 	// Comb filters
-	comb	combL[numcombs];
-	comb	combR[numcombs];
+	combbank	combL;
+	combbank	combR;
 
 	// Allpass filters
 	allpass	allpassL[numallpasses];
@@ -56,6 +60,10 @@ private:
 
 	// Buffers for the combs and allpasses
 	float	*buffers;
+	int	bufferlength;
+
+	// Longest path through the combs and allpasses, in samples
+	int	taillength;
 
 };
 
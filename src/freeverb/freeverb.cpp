@@ -23,10 +23,13 @@
 /*****************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 
 /*****************************************************************************/
 
 #include "../cmt.h"
+#include "../run_adding.h"
+#include "../silence.h"
 #include "Components/revmodel.h"
 
 /*****************************************************************************/
@@ -43,6 +46,7 @@ enum {
   FV_Wet,
   FV_Dry,
   FV_Width,
+  FV_Idle,
 
   FV_NumPorts
 
@@ -53,13 +57,23 @@ enum {
 /** This plugin wraps Jezar's Freeverb free reverberation module
     (version 3). */
 class Freeverb3 : public CMT_PluginInstance, public revmodel {
+private:
+
+  SilenceTracker m_oSilence;
+
+  LADSPA_Data m_fRunAddingGain;
+
 public:
 
   Freeverb3(const LADSPA_Descriptor *, unsigned long lSampleRate)
     : CMT_PluginInstance(FV_NumPorts),
-      revmodel((float)lSampleRate) {
+      revmodel((float)lSampleRate),
+      m_fRunAddingGain(1) {
   }
   friend void activateFreeverb3(LADSPA_Handle Instance);
+  friend void setFreeverb3RunAddingGain(LADSPA_Handle Instance,
+					LADSPA_Data Gain);
+  template <OutputFunction write_output>
   friend void runFreeverb3(LADSPA_Handle Instance, 
 			   unsigned long SampleCount);
 
@@ -71,39 +85,91 @@ void
 activateFreeverb3(LADSPA_Handle Instance) {
   Freeverb3 * poFreeverb = (Freeverb3 *)Instance;
   poFreeverb->mute();
+  poFreeverb->m_oSilence.reset();
+}
+
+/*****************************************************************************/
+
+void
+setFreeverb3RunAddingGain(LADSPA_Handle Instance,
+			  LADSPA_Data Gain) {
+  ((Freeverb3 *)Instance)->m_fRunAddingGain = Gain;
 }
 
 /*****************************************************************************/
 
+template <OutputFunction write_output>
 void
 runFreeverb3(LADSPA_Handle Instance,
 	     const unsigned long SampleCount) {
 
   Freeverb3 * poFreeverb = ((Freeverb3 *)Instance);
 
-  /* Handle control ports. Note that this isn't especially efficient
-     because of the way the update() code works in revmodel.cpp, but
-     at least this approach allows Freeverb to work with almost no
-     code changes. */
-
-  if (*(poFreeverb->m_ppfPorts[FV_Mode]) > 0)
-    poFreeverb->setmode(1);
-  else
-    poFreeverb->setmode(0);
-  poFreeverb->setdamp(*(poFreeverb->m_ppfPorts[FV_Damping]));
-  poFreeverb->setwet(*(poFreeverb->m_ppfPorts[FV_Wet]));
-  poFreeverb->setdry(*(poFreeverb->m_ppfPorts[FV_Dry]));
-  poFreeverb->setroomsize(*(poFreeverb->m_ppfPorts[FV_RoomSize]));
-  poFreeverb->setwidth(*(poFreeverb->m_ppfPorts[FV_Width]));
+  /* Handle control ports. The internal values are only recalculated
+     when a port value changes. */
+
+  poFreeverb->setparameters
+    (*(poFreeverb->m_ppfPorts[FV_Mode]) > 0 ? 1 : 0,
+     *(poFreeverb->m_ppfPorts[FV_RoomSize]),
+     *(poFreeverb->m_ppfPorts[FV_Damping]),
+     *(poFreeverb->m_ppfPorts[FV_Wet]),
+     *(poFreeverb->m_ppfPorts[FV_Dry]),
+     *(poFreeverb->m_ppfPorts[FV_Width]));
+
+  /* Once the input is silent and the tail has died away there is
+     nothing to compute. Frozen reverbs sustain indefinitely. */
+
+  SilenceTracker & roSilence = poFreeverb->m_oSilence;
+  unsigned long lTailLength = poFreeverb->gettaillength();
+  bool bSilent 
+    = (poFreeverb->getmode() == 0
+       && isSilent(poFreeverb->m_ppfPorts[FV_Input1], SampleCount)
+       && isSilent(poFreeverb->m_ppfPorts[FV_Input2], SampleCount));
+  if (bSilent && roSilence.isIdle(lTailLength)) {
+    if (!is_adding<write_output>()) {
+      memset(poFreeverb->m_ppfPorts[FV_Output1], 
+	     0, 
+	     sizeof(LADSPA_Data) * SampleCount);
+      memset(poFreeverb->m_ppfPorts[FV_Output2], 
+	     0, 
+	     sizeof(LADSPA_Data) * SampleCount);
+    }
+    roSilence.update(true, SampleCount);
+    *(poFreeverb->m_ppfPorts[FV_Idle]) = 1;
+    return;
+  }
 
   /* Connect to audio ports and run. */
 
-  poFreeverb->processreplace(poFreeverb->m_ppfPorts[FV_Input1],
-			     poFreeverb->m_ppfPorts[FV_Input2],
-			     poFreeverb->m_ppfPorts[FV_Output1],
-			     poFreeverb->m_ppfPorts[FV_Output2],
-			     SampleCount,
-			     1);
+  if (is_adding<write_output>())
+    poFreeverb->processmix(poFreeverb->m_ppfPorts[FV_Input1],
+			   poFreeverb->m_ppfPorts[FV_Input2],
+			   poFreeverb->m_ppfPorts[FV_Output1],
+			   poFreeverb->m_ppfPorts[FV_Output2],
+			   SampleCount,
+			   1,
+			   poFreeverb->m_fRunAddingGain);
+  else
+    poFreeverb->processreplace(poFreeverb->m_ppfPorts[FV_Input1],
+			       poFreeverb->m_ppfPorts[FV_Input2],
+			       poFreeverb->m_ppfPorts[FV_Output1],
+			       poFreeverb->m_ppfPorts[FV_Output2],
+			       SampleCount,
+			       1);
+
+  /* After a silent stretch as long as the tail, check the filters
+     directly and clear them if they have decayed. If not, try again
+     after another such stretch. */
+  roSilence.update(bSilent, SampleCount);
+  if (roSilence.isQuietFor(lTailLength)) {
+    if (poFreeverb->isquiet(SILENCE_THRESHOLD)) {
+      poFreeverb->mute();
+      roSilence.enterIdle();
+    }
+    else
+      roSilence.reset();
+  }
+  *(poFreeverb->m_ppfPorts[FV_Idle]) = 0;
 }
 
 /*****************************************************************************/
@@ -123,9 +189,9 @@ initialise_freeverb3() {
      NULL,
      CMT_Instantiate<Freeverb3>,
      activateFreeverb3, 
-     runFreeverb3,
-     NULL,
-     NULL,
+     runFreeverb3<write_output_normal>,
+     runFreeverb3<write_output_adding>,
+     setFreeverb3RunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO, 
@@ -189,6 +255,10 @@ initialise_freeverb3() {
       | LADSPA_HINT_DEFAULT_MIDDLE), 
      0,
      1);
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+     SILENCE_IDLE_PORT_NAME,
+     SILENCE_IDLE_PORT_HINTS);
 
   registerNewPluginDescriptor(psDescriptor);
 }
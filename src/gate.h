@@ -0,0 +1,107 @@
+/* gate.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_GATE_INCLUDED
+#define CMT_GATE_INCLUDED
+
+/*****************************************************************************/
+
+/* Audio rate gates for the mono synth voices. These read their gate
+   or trigger control once per block, so envelopes start and stop on
+   block boundaries. Their audio gate variants take the gate as an
+   audio port instead, split each block where it changes and run the
+   ordinary block code on each piece with the gate port pointed at a
+   constant. Envelopes then follow the gate to the sample whatever the
+   block size, at the cost of a block's setup for each change. */
+
+/*****************************************************************************/
+
+#include "lanes.h"
+
+/*****************************************************************************/
+
+/** Index of the first of the lCount samples of pfGate on the other
+    side of zero from bGate, above zero being on, or lCount if there is
+    none. Gates rarely change, so LANE_COUNT samples are checked at a
+    time. */
+inline unsigned long
+findGateChange(const LADSPA_Data * pfGate,
+	       const unsigned long lCount,
+	       const bool          bGate) {
+
+  const Lanes vZero = lanesSplat(0.0F);
+  unsigned long lIndex = 0;
+
+  for (; lIndex + LANE_COUNT <= lCount; lIndex += LANE_COUNT) {
+    const Lanes vGate = lanesLoad(pfGate + lIndex);
+    if (lanesAny(bGate ? vZero >= vGate : vGate > vZero))
+      break;
+  }
+  for (; lIndex < lCount; lIndex++)
+    if ((pfGate[lIndex] > 0) != bGate)
+      break;
+  return lIndex;
+}
+
+/** Run lSampleCount samples of a mono voice with the run function
+    fRun, taking port lGatePort of ppfPorts as an audio gate. fRun is
+    called once for each piece of the block over which the gate does
+    not change, with the gate port pointing at 1 or 0 and the audio
+    ports, given as a bit mask in lAudioPorts, moved on to the piece.
+    The ports are put back afterwards. As each piece is scanned before
+    it is run, the output may share the gate's buffer. */
+inline void
+runWithAudioGate(LADSPA_Handle       Instance,
+		 LADSPA_Data **      ppfPorts,
+		 const unsigned long lSampleCount,
+		 const unsigned long lGatePort,
+		 const unsigned long lAudioPorts,
+		 void (*fRun)(LADSPA_Handle, unsigned long)) {
+
+  const LADSPA_Data * pfGate = ppfPorts[lGatePort];
+  LADSPA_Data fGate;
+  ppfPorts[lGatePort] = &fGate;
+
+  unsigned long lStart = 0;
+  while (lStart < lSampleCount) {
+    const bool bGate = pfGate[lStart] > 0;
+    const unsigned long lCount
+      = 1 + findGateChange(pfGate + lStart + 1,
+			   lSampleCount - lStart - 1,
+			   bGate);
+    fGate = bGate ? 1 : 0;
+    fRun(Instance, lCount);
+    for (unsigned long lPort = 0; lAudioPorts >> lPort; lPort++)
+      if ((lAudioPorts >> lPort) & 1)
+	ppfPorts[lPort] += lCount;
+    lStart += lCount;
+  }
+
+  for (unsigned long lPort = 0; lAudioPorts >> lPort; lPort++)
+    if ((lAudioPorts >> lPort) & 1)
+      ppfPorts[lPort] -= lSampleCount;
+  ppfPorts[lGatePort] = (LADSPA_Data *)pfGate;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -20,12 +20,15 @@
 
 /*****************************************************************************/
 
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "lanes.h"
+#include "silence.h"
 #include "utils.h"
 
 /*****************************************************************************/
@@ -41,9 +44,15 @@
     distribution to generate grain counts? */
 #define GRAIN_NORMAL_RV_QUALITY 16
 
+/** Maximum number of grains that may sound at once. Storage for these
+    is allocated at instantiation so that run() never needs to call
+    new or delete. If the pool is full, new grains are discarded. */
+#define GRAIN_MAXIMUM_GRAINS 512
+
 /*****************************************************************************/
 
-/** Pointers to this can be used as linked list of grains. */
+/** A single grain. These are held contiguously in a fixed pool owned
+    by the GrainScatter instance. */
 class Grain {
 private:
 
@@ -60,6 +69,10 @@ private:
 
 public:
 
+  Grain()
+    : m_bFinished(true) {
+  }
+
   Grain(const long        lReadPointer,
 	const long        lGrainLength,
 	const long        lAttackTime)
@@ -85,9 +98,6 @@ public:
     return m_bFinished;
   }
 
-  /** NULL if end of grain list. */
-  Grain * m_poNextGrain;
-
   void run(const unsigned long lSampleCount,
 	   float * pfOutput,
 	   const float * pfHistoryBuffer,
@@ -130,6 +140,8 @@ public:
 #define GRN_SCATTER      3
 #define GRN_GRAIN_LENGTH 4
 #define GRN_GRAIN_ATTACK 5
+#define GRN_SEED         6
+#define GRN_IDLE         7
 
 static void activateGrainScatter(LADSPA_Handle Instance);
 static void runGrainScatter(LADSPA_Handle Instance,
@@ -140,7 +152,9 @@ static void runGrainScatter(LADSPA_Handle Instance,
 class GrainScatter : public CMT_PluginInstance {
 private:
 
-  Grain * m_poCurrentGrains;
+  /** Grain pool. The first m_lGrainCount entries are active. */
+  Grain * m_poGrains;
+  unsigned long m_lGrainCount;
 
   long m_lSampleRate;
 
@@ -151,13 +165,18 @@ private:
 
   /** Write pointer in buffer. */
   unsigned long m_lWritePointer;
+
+  PRNG m_oRandom;
+
+  SilenceTracker m_oSilence;
   
 public:
 
   GrainScatter(const LADSPA_Descriptor *,
 	       unsigned long lSampleRate)
-    : CMT_PluginInstance(6),
-      m_poCurrentGrains(NULL),
+    : CMT_PluginInstance(8),
+      m_poGrains(new Grain[GRAIN_MAXIMUM_GRAINS]),
+      m_lGrainCount(0),
       m_lSampleRate(lSampleRate) {
     /* Buffer size is a power of two bigger than max delay time. */
     unsigned long lMinimumBufferSize 
@@ -170,6 +189,7 @@ public:
 
   ~GrainScatter() {
     delete [] m_pfBuffer;
+    delete [] m_poGrains;
   }
 
   friend void activateGrainScatter(LADSPA_Handle Instance);
@@ -194,6 +214,9 @@ activateGrainScatter(LADSPA_Handle Instance) {
 	 sizeof(LADSPA_Data) * poGrainScatter->m_lBufferSize);
 
   poGrainScatter->m_lWritePointer = 0;
+  poGrainScatter->m_lGrainCount = 0;
+  poGrainScatter->m_oRandom.resetSeedPort();
+  poGrainScatter->m_oSilence.reset();
 }
 
 /*****************************************************************************/
@@ -226,6 +249,20 @@ runGrainScatter(LADSPA_Handle Instance,
 
   }
   else {
+
+    poGrainScatter->m_oRandom.followSeedPort
+      (*(poGrainScatter->m_ppfPorts[GRN_SEED]));
+
+    /* Grains only ever read the history buffer, so once the input has
+       been silent for the length of the buffer every grain is
+       silent. In that case the grains are dropped and the buffer is
+       just moved along. */
+    bool bSilent = isSilent(pfInput, SampleCount);
+    bool bIdle = bSilent && poGrainScatter->m_oSilence.isIdle(0);
+    poGrainScatter->m_oSilence.update(bSilent, SampleCount);
+    if (poGrainScatter->m_oSilence.isQuietFor(poGrainScatter->m_lBufferSize))
+      poGrainScatter->m_oSilence.enterIdle();
+    *(poGrainScatter->m_ppfPorts[GRN_IDLE]) = bIdle ? 1 : 0;
     
     /* Move the delay line along. */
     if (poGrainScatter->m_lWritePointer 
@@ -253,22 +290,26 @@ runGrainScatter(LADSPA_Handle Instance,
 
     /* Empty the output buffer. */
     memset(pfOutput, 0, SampleCount * sizeof(LADSPA_Data));
+
+    if (bIdle) {
+      poGrainScatter->m_lGrainCount = 0;
+      return;
+    }
     
-    /* Process current grains. */
-    Grain ** ppoGrainReference = &(poGrainScatter->m_poCurrentGrains);
-    while (*ppoGrainReference != NULL) {
-      (*ppoGrainReference)->run(SampleCount,
+    /* Process current grains. Finished grains are replaced by the
+       last active grain in the pool so the active set stays
+       contiguous. */
+    Grain * poGrains = poGrainScatter->m_poGrains;
+    unsigned long lGrainIndex = 0;
+    while (lGrainIndex < poGrainScatter->m_lGrainCount) {
+      poGrains[lGrainIndex].run(SampleCount,
 				pfOutput,
 				poGrainScatter->m_pfBuffer,
 				poGrainScatter->m_lBufferSize);
-      if ((*ppoGrainReference)->isFinished()) {
-	Grain *poNextGrain = (*ppoGrainReference)->m_poNextGrain;
-	delete *ppoGrainReference;
-	*ppoGrainReference = poNextGrain;
-      }
-      else {
-	ppoGrainReference = &((*ppoGrainReference)->m_poNextGrain);
-      }
+      if (poGrains[lGrainIndex].isFinished())
+	poGrains[lGrainIndex] = poGrains[--poGrainScatter->m_lGrainCount];
+      else
+	lGrainIndex++;
     }
 
     LADSPA_Data fSampleRate = LADSPA_Data(poGrainScatter->m_lSampleRate);
@@ -286,12 +327,16 @@ runGrainScatter(LADSPA_Handle Instance,
        discard negative samples from the RV. */
     double dGrainCountRV_Mean = fDensity * SampleCount / fSampleRate;
     double dGrainCountRV_SD   = dGrainCountRV_Mean;
-    double dGrainCountRV = sampleNormalDistribution(dGrainCountRV_Mean,
+    double dGrainCountRV = sampleNormalDistribution(poGrainScatter->m_oRandom,
+						    dGrainCountRV_Mean,
 						    dGrainCountRV_SD,
 						    GRAIN_NORMAL_RV_QUALITY);
     unsigned long lNewGrainCount = 0;
     if (dGrainCountRV > 0)
       lNewGrainCount = (unsigned long)(0.5 + dGrainCountRV);
+    if (lNewGrainCount 
+	> GRAIN_MAXIMUM_GRAINS - poGrainScatter->m_lGrainCount)
+      lNewGrainCount = GRAIN_MAXIMUM_GRAINS - poGrainScatter->m_lGrainCount;
     if (lNewGrainCount > 0) {
 
       LADSPA_Data fScatter 
@@ -314,23 +359,21 @@ runGrainScatter(LADSPA_Handle Instance,
 
       for (unsigned long lIndex = 0; lIndex < lNewGrainCount; lIndex++) {
 
-	long lOffset = rand() % SampleCount;
+	long lOffset = poGrainScatter->m_oRandom.nextBelow(SampleCount);
 
 	long lGrainReadPointer 
 	  = (poGrainScatter->m_lWritePointer 
 	     - SampleCount 
 	     + lOffset
-	     - (rand() % lScatterSampleWidth));
+	     - poGrainScatter->m_oRandom.nextBelow(lScatterSampleWidth));
 	while (lGrainReadPointer < 0)
 	  lGrainReadPointer += poGrainScatter->m_lBufferSize;
 	lGrainReadPointer &= (poGrainScatter->m_lBufferSize - 1);
 
-	Grain * poNewGrain = new Grain(lGrainReadPointer,
-				       lGrainLength,
-				       lAttackTime);
-
-	poNewGrain->m_poNextGrain = poGrainScatter->m_poCurrentGrains;
-	poGrainScatter->m_poCurrentGrains = poNewGrain;
+	Grain * poNewGrain = poGrains + poGrainScatter->m_lGrainCount++;
+	*poNewGrain = Grain(lGrainReadPointer,
+			    lGrainLength,
+			    lAttackTime);
 
 	poNewGrain->run(SampleCount - lOffset,
 			pfOutput + lOffset,
@@ -343,13 +386,380 @@ runGrainScatter(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+/* A second granular engine, for dense clouds. Grains start at random
+   intervals averaging the density, so how many start does not depend
+   on the host's block size, and each plays the input from a random
+   time ago through a window read from a table.
+
+   The block is worked through in chunks of GRAIN_CLOUD_CHUNK samples.
+   Each chunk of input is written to the history buffer before any
+   grain reads it, so the output may share the input's buffer and the
+   history need only hold the longest scatter and one chunk, whatever
+   the block size. Grains are kept as arrays and each adds its part of
+   a chunk as contiguous runs of history, LANE_COUNT samples at a
+   time. */
+
+#define GRAIN_CLOUD_CHUNK 256
+
+/** Points in each window table. The tables have two further points so
+    that interpolation at the end stays in bounds. */
+#define GRAIN_WINDOW_SIZE 1024
+
+#define GRAIN_WINDOW_HANN     0
+#define GRAIN_WINDOW_TUKEY    1
+#define GRAIN_WINDOW_GAUSSIAN 2
+#define GRAIN_WINDOW_COUNT    3
+
+/** The window tables, shared between instances. The Tukey window is
+    flat over its middle half and the Gaussian has a standard
+    deviation of a sixth of its length, lowered and rescaled to start
+    and end at zero. */
+class GrainWindows : public CMT_SharedTable {
+private:
+
+  LADSPA_Data * m_pfData;
+
+public:
+
+  GrainWindows() {
+
+    m_pfData = allocateTableData(GRAIN_WINDOW_COUNT
+				 * (GRAIN_WINDOW_SIZE + 2));
+    const double dGaussianEdge = exp(-4.5);
+
+    for (long lIndex = 0; lIndex <= GRAIN_WINDOW_SIZE + 1; lIndex++) {
+
+      double dX = double(lIndex) / GRAIN_WINDOW_SIZE;
+      if (dX > 1)
+	dX = 1;
+      double dEdge = dX < 0.5 ? dX : 1 - dX;
+
+      window(GRAIN_WINDOW_HANN)[lIndex]
+	= LADSPA_Data(0.5 - 0.5 * cos(2 * M_PI * dX));
+      window(GRAIN_WINDOW_TUKEY)[lIndex]
+	= LADSPA_Data(dEdge < 0.25 ? 0.5 - 0.5 * cos(4 * M_PI * dEdge) : 1);
+      window(GRAIN_WINDOW_GAUSSIAN)[lIndex]
+	= LADSPA_Data((exp(-18 * (dX - 0.5) * (dX - 0.5)) - dGaussianEdge)
+		      / (1 - dGaussianEdge));
+    }
+  }
+
+  ~GrainWindows() {
+    freeTableData(m_pfData);
+  }
+
+  LADSPA_Data * window(const int iWindow) const {
+    return m_pfData + iWindow * (GRAIN_WINDOW_SIZE + 2);
+  }
+
+};
+
+#define GRAIN_WINDOWS_KEY "grain_windows"
+
+static CMT_SharedTable *
+createGrainWindows(const int) {
+  return new GrainWindows;
+}
+
+/** Add lCount samples of pfSource to pfOutput through the window
+    pfWindow. The window is read lPosition samples into a grain taking
+    fStep window points per sample. */
+static inline void
+accumulateGrain(LADSPA_Data * pfOutput,
+		const LADSPA_Data * pfSource,
+		const unsigned long lCount,
+		const LADSPA_Data * pfWindow,
+		const long lPosition,
+		const LADSPA_Data fStep) {
+
+  const LADSPA_Data * apfWindows[LANE_COUNT]
+    = { pfWindow, pfWindow, pfWindow, pfWindow };
+  const Lanes vOffsets = lanesSet(0, 1, 2, 3);
+  const Lanes vStep = lanesSplat(fStep);
+
+  unsigned long lIndex = 0;
+  for (; lIndex + LANE_COUNT <= lCount; lIndex += LANE_COUNT) {
+    const Lanes vPhase
+      = (lanesSplat(LADSPA_Data(lPosition + lIndex)) + vOffsets) * vStep;
+    lanesStore(pfOutput + lIndex,
+	       lanesLoad(pfOutput + lIndex)
+	       + lanesInterpolate(apfWindows, vPhase)
+	       * lanesLoad(pfSource + lIndex));
+  }
+  for (; lIndex < lCount; lIndex++) {
+    const LADSPA_Data fPhase = LADSPA_Data(lPosition + lIndex) * fStep;
+    const long lPoint = long(fPhase);
+    const LADSPA_Data fFraction = fPhase - lPoint;
+    pfOutput[lIndex]
+      += (pfWindow[lPoint]
+	  + fFraction * (pfWindow[lPoint + 1] - pfWindow[lPoint]))
+      * pfSource[lIndex];
+  }
+}
+
+/*****************************************************************************/
+
+#define GCL_INPUT        0
+#define GCL_OUTPUT       1
+#define GCL_DENSITY      2
+#define GCL_SCATTER      3
+#define GCL_GRAIN_LENGTH 4
+#define GCL_WINDOW       5
+#define GCL_SEED         6
+#define GCL_IDLE         7
+
+static void activateGrainCloud(LADSPA_Handle Instance);
+static void runGrainCloud(LADSPA_Handle Instance,
+			  unsigned long SampleCount);
+
+/** This plugin scatters many short windowed grains of an audio stream
+    to make a granular cloud. */
+class GrainCloud : public CMT_PluginInstance {
+private:
+
+  /** Active grains, the first m_lGrainCount entries of each array. A
+      grain's position counts the samples it has played, and is
+      negative before it starts. It plays the input from its delay
+      ago through its window. */
+  long m_alPosition[GRAIN_MAXIMUM_GRAINS];
+  long m_alLength[GRAIN_MAXIMUM_GRAINS];
+  unsigned long m_alDelay[GRAIN_MAXIMUM_GRAINS];
+  LADSPA_Data m_afWindowStep[GRAIN_MAXIMUM_GRAINS];
+  const LADSPA_Data * m_apfWindow[GRAIN_MAXIMUM_GRAINS];
+  unsigned long m_lGrainCount;
+
+  /** Samples from the start of the next chunk to the next grain. */
+  double m_dNextGrain;
+
+  long m_lSampleRate;
+
+  LADSPA_Data * m_pfBuffer;
+
+  /** Buffer size, a power of two. */
+  unsigned long m_lBufferSize;
+
+  /** Write pointer in buffer. */
+  unsigned long m_lWritePointer;
+
+  PRNG m_oRandom;
+
+  SilenceTracker m_oSilence;
+
+  const GrainWindows * m_poWindows;
+
+  /** Start the grains falling in the next lCount samples. */
+  void startGrains(const unsigned long lCount) {
+
+    LADSPA_Data fSampleRate = LADSPA_Data(m_lSampleRate);
+    LADSPA_Data fDensity = BOUNDED(*(m_ppfPorts[GCL_DENSITY]), 1, 10000);
+    LADSPA_Data fScatter 
+      = BOUNDED(*(m_ppfPorts[GCL_SCATTER]), 0, GRAIN_MAXIMUM_SCATTER);
+    LADSPA_Data fGrainLength
+      = BOUNDED(*(m_ppfPorts[GCL_GRAIN_LENGTH]), 0.001, 1);
+    int iWindow
+      = int(BOUNDED(*(m_ppfPorts[GCL_WINDOW]), 0, GRAIN_WINDOW_COUNT - 1));
+
+    unsigned long lScatterSampleWidth
+      = (unsigned long)(fSampleRate * fScatter) + 1;
+    long lGrainLength = long(fSampleRate * fGrainLength);
+    if (lGrainLength < 1)
+      lGrainLength = 1;
+    double dMeanInterval = fSampleRate / fDensity;
+
+    /* Intervals are exponentially distributed, so grains start
+       independently of each other at the given average rate. Once the
+       pool is full the rest of the chunk's grains are discarded
+       without drawing their intervals. */
+    while (m_dNextGrain < lCount) {
+      if (m_lGrainCount == GRAIN_MAXIMUM_GRAINS) {
+	m_dNextGrain = lCount;
+	break;
+      }
+      m_alPosition[m_lGrainCount] = -long(m_dNextGrain);
+      m_alLength[m_lGrainCount] = lGrainLength;
+      m_alDelay[m_lGrainCount] = m_oRandom.nextBelow(lScatterSampleWidth);
+      m_afWindowStep[m_lGrainCount]
+	= LADSPA_Data(GRAIN_WINDOW_SIZE) / lGrainLength;
+      m_apfWindow[m_lGrainCount] = m_poWindows->window(iWindow);
+      m_lGrainCount++;
+      m_dNextGrain -= log(1 - m_oRandom.nextUnipolar()) * dMeanInterval;
+    }
+    m_dNextGrain -= lCount;
+  }
+
+  /** Add the grains for lCount samples to pfOutput, the input for
+      which starts at the write pointer. Finished grains are replaced
+      by the last active grain so the active set stays contiguous. */
+  void runGrains(LADSPA_Data * pfOutput, const unsigned long lCount) {
+
+    const unsigned long lMask = m_lBufferSize - 1;
+
+    unsigned long lGrain = 0;
+    while (lGrain < m_lGrainCount) {
+
+      long lPosition = m_alPosition[lGrain];
+      unsigned long lStart = lPosition < 0 ? -lPosition : 0;
+      lPosition += lStart;
+      unsigned long lEnd = lStart + (m_alLength[lGrain] - lPosition);
+      if (lEnd > lCount)
+	lEnd = lCount;
+      unsigned long lRead
+	= (m_lWritePointer + lStart - m_alDelay[lGrain]) & lMask;
+
+      while (lStart < lEnd) {
+	unsigned long lRun = lEnd - lStart;
+	if (lRun > m_lBufferSize - lRead)
+	  lRun = m_lBufferSize - lRead;
+	accumulateGrain(pfOutput + lStart,
+			m_pfBuffer + lRead,
+			lRun,
+			m_apfWindow[lGrain],
+			lPosition,
+			m_afWindowStep[lGrain]);
+	lStart += lRun;
+	lPosition += lRun;
+	lRead = (lRead + lRun) & lMask;
+      }
+
+      if (lPosition >= m_alLength[lGrain]) {
+	m_lGrainCount--;
+	m_alPosition[lGrain] = m_alPosition[m_lGrainCount];
+	m_alLength[lGrain] = m_alLength[m_lGrainCount];
+	m_alDelay[lGrain] = m_alDelay[m_lGrainCount];
+	m_afWindowStep[lGrain] = m_afWindowStep[m_lGrainCount];
+	m_apfWindow[lGrain] = m_apfWindow[m_lGrainCount];
+      }
+      else {
+	m_alPosition[lGrain] = lPosition;
+	lGrain++;
+      }
+    }
+  }
+
+public:
+
+  GrainCloud(const LADSPA_Descriptor *,
+	     unsigned long lSampleRate)
+    : CMT_PluginInstance(8),
+      m_lGrainCount(0),
+      m_lSampleRate(lSampleRate) {
+    /* Buffer size is a power of two holding the longest scatter and a
+       chunk. */
+    unsigned long lMinimumBufferSize 
+      = ((unsigned long)((LADSPA_Data)lSampleRate * GRAIN_MAXIMUM_SCATTER)
+	 + 1 + GRAIN_CLOUD_CHUNK);
+    m_lBufferSize = 1;
+    while (m_lBufferSize < lMinimumBufferSize)
+      m_lBufferSize <<= 1;
+    m_pfBuffer = new LADSPA_Data[m_lBufferSize];
+    m_poWindows
+      = (const GrainWindows *)acquireSharedTable(GRAIN_WINDOWS_KEY,
+						 0,
+						 createGrainWindows);
+  }
+
+  ~GrainCloud() {
+    releaseSharedTable(GRAIN_WINDOWS_KEY, 0);
+    delete [] m_pfBuffer;
+  }
+
+  friend void activateGrainCloud(LADSPA_Handle Instance);
+  friend void runGrainCloud(LADSPA_Handle Instance,
+			    unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+/** Initialise and activate a plugin instance. */
+static void
+activateGrainCloud(LADSPA_Handle Instance) {
+
+  GrainCloud * poGrainCloud = (GrainCloud *)Instance;
+
+  memset(poGrainCloud->m_pfBuffer, 
+	 0, 
+	 sizeof(LADSPA_Data) * poGrainCloud->m_lBufferSize);
+
+  poGrainCloud->m_lWritePointer = 0;
+  poGrainCloud->m_lGrainCount = 0;
+  poGrainCloud->m_dNextGrain = 0;
+  poGrainCloud->m_oRandom.resetSeedPort();
+  poGrainCloud->m_oSilence.reset();
+}
+
+/*****************************************************************************/
+
+static void 
+runGrainCloud(LADSPA_Handle Instance,
+	      unsigned long SampleCount) {
+
+  GrainCloud * poGrainCloud = (GrainCloud *)Instance;
+
+  LADSPA_Data * pfInput  = poGrainCloud->m_ppfPorts[GCL_INPUT];
+  LADSPA_Data * pfOutput = poGrainCloud->m_ppfPorts[GCL_OUTPUT];
+
+  poGrainCloud->m_oRandom.followSeedPort
+    (*(poGrainCloud->m_ppfPorts[GCL_SEED]));
+
+  /* As for the scatter processor, once the input has been silent for
+     the length of the buffer every grain is silent. */
+  bool bSilent = isSilent(pfInput, SampleCount);
+  bool bIdle = bSilent && poGrainCloud->m_oSilence.isIdle(0);
+  poGrainCloud->m_oSilence.update(bSilent, SampleCount);
+  if (poGrainCloud->m_oSilence.isQuietFor(poGrainCloud->m_lBufferSize))
+    poGrainCloud->m_oSilence.enterIdle();
+  *(poGrainCloud->m_ppfPorts[GCL_IDLE]) = bIdle ? 1 : 0;
+
+  if (bIdle)
+    poGrainCloud->m_lGrainCount = 0;
+
+  unsigned long lCount;
+  for (unsigned long lStart = 0; lStart < SampleCount; lStart += lCount) {
+
+    lCount = SampleCount - lStart;
+    if (lCount > GRAIN_CLOUD_CHUNK)
+      lCount = GRAIN_CLOUD_CHUNK;
+
+    /* Move the delay line along. The write pointer is moved on after
+       the grains have run, so they find this chunk's input there. */
+    unsigned long lSpace
+      = poGrainCloud->m_lBufferSize - poGrainCloud->m_lWritePointer;
+    if (lCount > lSpace) {
+      memcpy(poGrainCloud->m_pfBuffer + poGrainCloud->m_lWritePointer, 
+	     pfInput + lStart,
+	     sizeof(LADSPA_Data) * lSpace);
+      memcpy(poGrainCloud->m_pfBuffer,
+	     pfInput + lStart + lSpace,
+	     sizeof(LADSPA_Data) * (lCount - lSpace));
+    }
+    else {
+      memcpy(poGrainCloud->m_pfBuffer + poGrainCloud->m_lWritePointer, 
+	     pfInput + lStart,
+	     sizeof(LADSPA_Data) * lCount);
+    }
+
+    memset(pfOutput + lStart, 0, lCount * sizeof(LADSPA_Data));
+    if (!bIdle) {
+      poGrainCloud->startGrains(lCount);
+      poGrainCloud->runGrains(pfOutput + lStart, lCount);
+    }
+
+    poGrainCloud->m_lWritePointer 
+      = ((poGrainCloud->m_lWritePointer + lCount)
+	 & (poGrainCloud->m_lBufferSize - 1));
+  }
+}
+
+/*****************************************************************************/
+
 void
 initialise_grain() {
   
   CMT_Descriptor * psDescriptor = new CMT_Descriptor
     (1096,
      "grain_scatter",
-     0,
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
      "Granular Scatter Processor",
      CMT_MAKER("Richard W.E. Furse"),
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
@@ -395,6 +805,85 @@ initialise_grain() {
       | LADSPA_HINT_DEFAULT_MAXIMUM),
      0,
      0.05);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     PRNG_SEED_PORT_NAME,
+     PRNG_SEED_PORT_HINTS,
+     0,
+     0);
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+     SILENCE_IDLE_PORT_NAME,
+     SILENCE_IDLE_PORT_HINTS);
+
+  registerNewPluginDescriptor(psDescriptor);
+
+
+  psDescriptor = new CMT_Descriptor
+    (2029,
+     "grain_cloud",
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+     "Granular Cloud",
+     CMT_MAKER("Richard W.E. Furse"),
+     CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+     NULL,
+     CMT_Instantiate<GrainCloud>,
+     activateGrainCloud,
+     runGrainCloud,
+     NULL,
+     NULL,
+     NULL);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+     "Input");
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+     "Output");
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Density (Grains/s)",
+     (LADSPA_HINT_BOUNDED_BELOW 
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_MIDDLE),
+     1,
+     10000);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Scatter (s)",
+     (LADSPA_HINT_BOUNDED_BELOW 
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_DEFAULT_MIDDLE),
+     0,
+     GRAIN_MAXIMUM_SCATTER);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Grain Length (s)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_MIDDLE),
+     0.001,
+     1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Window (0=Hann, 1=Tukey, 2=Gaussian)",
+     (LADSPA_HINT_BOUNDED_BELOW
+      | LADSPA_HINT_BOUNDED_ABOVE
+      | LADSPA_HINT_INTEGER
+      | LADSPA_HINT_DEFAULT_0),
+     0,
+     GRAIN_WINDOW_COUNT - 1);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     PRNG_SEED_PORT_NAME,
+     PRNG_SEED_PORT_HINTS,
+     0,
+     0);
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+     SILENCE_IDLE_PORT_NAME,
+     SILENCE_IDLE_PORT_HINTS);
 
   registerNewPluginDescriptor(psDescriptor);
 }
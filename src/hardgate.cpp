@@ -22,11 +22,14 @@
 
 /*****************************************************************************/
 
+#include <cmath>
 #include <cstdlib>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "lanes.h"
+#include "run_adding.h"
 
 /*****************************************************************************/
 
@@ -39,23 +42,38 @@ namespace hardgate {
 	n_ports        = 3
     };
 
+    template<OutputFunction write_output>
     static void run(LADSPA_Handle instance,
                     unsigned long sample_count);
+
+    static void set_run_adding_gain(LADSPA_Handle instance,
+                                    LADSPA_Data new_gain);
   
 /** This plugin sets its input signal to 0 if it falls below a threshold. */
     class Plugin : public CMT_PluginInstance {
+	LADSPA_Data run_adding_gain;
     public:
 	
 	Plugin(const LADSPA_Descriptor *,
 	       unsigned long)
-	    : CMT_PluginInstance(n_ports) {
+	    : CMT_PluginInstance(n_ports),
+	      run_adding_gain(1.0f) {
 	}
 	
+	template<OutputFunction write_output>
 	friend void run(LADSPA_Handle instance,
 			unsigned long sample_count);
 	
+	friend void set_run_adding_gain(LADSPA_Handle instance,
+					LADSPA_Data new_gain);
+	
     };
     
+    // The gate is |insig| < threshold, which for any threshold
+    // (including negative ones, which never close it) is the same as
+    // insig < threshold && insig > -threshold. Four samples are gated
+    // at a time with a mask rather than a branch.
+    template<OutputFunction write_output>
     static void run(LADSPA_Handle instance,
                     unsigned long sample_count) {
 	
@@ -65,15 +83,28 @@ namespace hardgate {
 	LADSPA_Data * in        =  pp->m_ppfPorts[port_input];
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
     
-	for ( unsigned long i = 0; i < sample_count ; ++i ) 
-	{
-	    LADSPA_Data insig = *(in++);
-	    if ( insig < threshold && insig > -threshold )
-		*(out++) = 0.0f;
-	    else 
-		*(out++) = insig;
+	const Lanes threshold_lanes = lanesSplat(threshold);
+	const Lanes zero = lanesSplat(0);
+	unsigned long i = 0;
+	for ( ; i + LANE_COUNT <= sample_count ; i += LANE_COUNT ) {
+	    const Lanes insig = lanesLoad(in + i);
+	    lanesWriteOutput<write_output>
+		(out,
+		 lanesSelect(lanesAbs(insig) < threshold_lanes, zero, insig),
+		 pp->run_adding_gain);
+	}
+	for ( ; i < sample_count ; ++i ) {
+	    LADSPA_Data insig = in[i];
+	    write_output(out,
+			 std::fabs(insig) < threshold ? 0.0f : insig,
+			 pp->run_adding_gain);
 	}
     }
+
+    static void set_run_adding_gain(LADSPA_Handle instance,
+                                    LADSPA_Data new_gain) {
+	((Plugin *) instance)->run_adding_gain = new_gain;
+    }
     
     void
     initialise() {
@@ -88,9 +119,9 @@ namespace hardgate {
 	     NULL,
 	     CMT_Instantiate<Plugin>,
 	     NULL,
-	     run,
-	     NULL,
-	     NULL,
+	     run<write_output_normal>,
+	     run<write_output_adding>,
+	     set_run_adding_gain,
 	     NULL);
 
 	d->addPort
@@ -27,6 +27,8 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "dispatch.h"
+#include "worker.h"
 
 /*****************************************************************************/
 
@@ -60,37 +62,42 @@ static unsigned long g_lPluginCount = 0;
 
 /*****************************************************************************/
 
-#define CAPACITY_STEP 20
+/* Enough for all the plugins at present, so normally the registry is
+   allocated once. It doubles if more are registered. */
+#define INITIAL_CAPACITY 256
 
 void 
 registerNewPluginDescriptor(CMT_Descriptor * psDescriptor) {
   if (g_lPluginCapacity == g_lPluginCount) {
     /* Full. Enlarge capacity. */
+    unsigned long lNewCapacity 
+      = g_lPluginCapacity ? 2 * g_lPluginCapacity : INITIAL_CAPACITY;
     CMT_Descriptor ** ppsOldDescriptors
       = g_ppsRegisteredDescriptors;
     g_ppsRegisteredDescriptors
-      = new CMT_Descriptor_ptr[g_lPluginCapacity + CAPACITY_STEP];
+      = new CMT_Descriptor_ptr[lNewCapacity];
     if (g_lPluginCapacity > 0) {
       memcpy(g_ppsRegisteredDescriptors, 
 	     ppsOldDescriptors,
 	     g_lPluginCapacity * sizeof(CMT_Descriptor_ptr));
       delete [] ppsOldDescriptors;
     }
-    g_lPluginCapacity += CAPACITY_STEP;
+    g_lPluginCapacity = lNewCapacity;
   }
   g_ppsRegisteredDescriptors[g_lPluginCount++] = psDescriptor;
 }
 
 /*****************************************************************************/
 
-/** A global object of this class is used to perform initialisation
+/** A static object of this class is used to perform initialisation
     and shutdown services for the entire library. The constructor is
-    run when the library is loaded and the destructor when it is
-    unloaded. */
+    run when a descriptor is first requested (see ladspa_descriptor()
+    below) and the destructor when the library is unloaded. */
 class StartupShutdownHandler {
 public:
 
   StartupShutdownHandler() {
+    selectKernels();
     initialise_modules();
     qsort(g_ppsRegisteredDescriptors, 
 	  g_lPluginCount,
@@ -99,6 +106,7 @@ public:
   }
 
   ~StartupShutdownHandler() {
+    finalise_workers();
     if (g_ppsRegisteredDescriptors != NULL) {
       for (unsigned long lIndex = 0; lIndex < g_lPluginCount; lIndex++)
 	delete g_ppsRegisteredDescriptors[lIndex];
@@ -109,16 +117,20 @@ public:
 
 };
 
-static StartupShutdownHandler g_oStartupShutdownHandler;
-  
 /*****************************************************************************/
 
+/* The plugins are registered on the first call rather than when the
+   library is loaded, so loading the library does no work of its own
+   and a host that loads it without asking for descriptors pays
+   nothing. Initialisation of the local static is thread-safe. */
+
 #ifdef _MSC_VER
 // needed to get it to compile on msvc
 __declspec(dllexport)
 #endif
 const LADSPA_Descriptor * 
 ladspa_descriptor(unsigned long Index) {
+  static StartupShutdownHandler s_oStartupShutdownHandler;
   if (Index < g_lPluginCount)
     return g_ppsRegisteredDescriptors[Index];
   else
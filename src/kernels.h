@@ -0,0 +1,633 @@
+/* kernels.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_KERNELS_INCLUDED
+#define CMT_KERNELS_INCLUDED
+
+/*****************************************************************************/
+
+/* Simple block processing kernels shared between plugins. These work
+   on contiguous runs of samples and use SSE or NEON where the
+   compiler targets them, falling back to plain loops. Unless stated
+   otherwise, an output buffer may be the same as an input buffer
+   (elements are read before the corresponding output is written) but
+   must not partially overlap one. */
+
+/*****************************************************************************/
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CMT_KERNELS_SSE
+#if defined(__SSE2__) || defined(_M_X64)
+/* Integer vector operations. */
+#include <emmintrin.h>
+#define CMT_KERNELS_SSE2
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CMT_KERNELS_NEON
+#endif
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+#include "utils.h"
+
+/*****************************************************************************/
+
+/** pfOutput[i] = fGainA * pfInputA[i] + fGainB * pfInputB[i], or
+    with bAdding set, pfOutput[i] += the same. */
+template <bool bAdding = false>
+inline void
+mixBuffers(LADSPA_Data *       pfOutput,
+	   const LADSPA_Data * pfInputA,
+	   const LADSPA_Data   fGainA,
+	   const LADSPA_Data * pfInputB,
+	   const LADSPA_Data   fGainB,
+	   const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  __m128 vGainA = _mm_set1_ps(fGainA);
+  __m128 vGainB = _mm_set1_ps(fGainB);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    __m128 vMix
+      = _mm_add_ps(_mm_mul_ps(vGainA, _mm_loadu_ps(pfInputA + lIndex)),
+		   _mm_mul_ps(vGainB, _mm_loadu_ps(pfInputB + lIndex)));
+    if (bAdding)
+      vMix = _mm_add_ps(_mm_loadu_ps(pfOutput + lIndex), vMix);
+    _mm_storeu_ps(pfOutput + lIndex, vMix);
+  }
+#elif defined(CMT_KERNELS_NEON)
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    float32x4_t vMix
+      = vmlaq_n_f32(vmulq_n_f32(vld1q_f32(pfInputA + lIndex), fGainA),
+		    vld1q_f32(pfInputB + lIndex),
+		    fGainB);
+    if (bAdding)
+      vMix = vaddq_f32(vld1q_f32(pfOutput + lIndex), vMix);
+    vst1q_f32(pfOutput + lIndex, vMix);
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    const LADSPA_Data fMix 
+      = fGainA * pfInputA[lIndex] + fGainB * pfInputB[lIndex];
+    if (bAdding)
+      pfOutput[lIndex] += fMix;
+    else
+      pfOutput[lIndex] = fMix;
+  }
+}
+
+/*****************************************************************************/
+
+/** Feedback delay kernel. For each sample, reading pfDelayed[i]:
+
+      pfOutput[i]   = fDry * pfInput[i] + fWet * pfDelayed[i]
+      pfFeedback[i] = pfInput[i] + fFeedback * pfDelayed[i]
+
+    pfFeedback must not overlap pfDelayed; pfOutput may be pfInput.
+    With bAdding set the output is added to pfOutput. */
+template <bool bAdding = false>
+inline void
+mixWithFeedback(LADSPA_Data *       pfOutput,
+		LADSPA_Data *       pfFeedback,
+		const LADSPA_Data * pfInput,
+		const LADSPA_Data * pfDelayed,
+		const LADSPA_Data   fDry,
+		const LADSPA_Data   fWet,
+		const LADSPA_Data   fFeedback,
+		const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  __m128 vDry = _mm_set1_ps(fDry);
+  __m128 vWet = _mm_set1_ps(fWet);
+  __m128 vFeedback = _mm_set1_ps(fFeedback);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    __m128 vInput = _mm_loadu_ps(pfInput + lIndex);
+    __m128 vDelayed = _mm_loadu_ps(pfDelayed + lIndex);
+    __m128 vMix = _mm_add_ps(_mm_mul_ps(vDry, vInput),
+			     _mm_mul_ps(vWet, vDelayed));
+    if (bAdding)
+      vMix = _mm_add_ps(_mm_loadu_ps(pfOutput + lIndex), vMix);
+    _mm_storeu_ps(pfOutput + lIndex, vMix);
+    _mm_storeu_ps(pfFeedback + lIndex,
+		  _mm_add_ps(vInput, _mm_mul_ps(vFeedback, vDelayed)));
+  }
+#elif defined(CMT_KERNELS_NEON)
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    float32x4_t vInput = vld1q_f32(pfInput + lIndex);
+    float32x4_t vDelayed = vld1q_f32(pfDelayed + lIndex);
+    float32x4_t vMix = vmlaq_n_f32(vmulq_n_f32(vInput, fDry), vDelayed, fWet);
+    if (bAdding)
+      vMix = vaddq_f32(vld1q_f32(pfOutput + lIndex), vMix);
+    vst1q_f32(pfOutput + lIndex, vMix);
+    vst1q_f32(pfFeedback + lIndex,
+	      vmlaq_n_f32(vInput, vDelayed, fFeedback));
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    LADSPA_Data fInputSample = pfInput[lIndex];
+    LADSPA_Data fDelayedSample = pfDelayed[lIndex];
+    LADSPA_Data fMix = fDry * fInputSample + fWet * fDelayedSample;
+    if (bAdding)
+      pfOutput[lIndex] += fMix;
+    else
+      pfOutput[lIndex] = fMix;
+    pfFeedback[lIndex] = fInputSample + fFeedback * fDelayedSample;
+  }
+}
+
+/*****************************************************************************/
+
+/** Apply a linear gain ramp:
+
+      pfOutput[i] = pfInput[i] * (fGain + (i + 1) * fGainStep)
+
+    so the gain reaches fGain + lSampleCount * fGainStep on the last
+    sample. */
+inline void
+applyGainRamp(LADSPA_Data *       pfOutput,
+	      const LADSPA_Data * pfInput,
+	      const LADSPA_Data   fGain,
+	      const LADSPA_Data   fGainStep,
+	      const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  __m128 vGain = _mm_set1_ps(fGain);
+  __m128 vGainStep = _mm_set1_ps(fGainStep);
+  __m128 vStepCount = _mm_setr_ps(1, 2, 3, 4);
+  const __m128 vFour = _mm_set1_ps(4);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    _mm_storeu_ps(pfOutput + lIndex,
+		  _mm_mul_ps(_mm_loadu_ps(pfInput + lIndex),
+			     _mm_add_ps(vGain, 
+					_mm_mul_ps(vStepCount, vGainStep))));
+    vStepCount = _mm_add_ps(vStepCount, vFour);
+  }
+#elif defined(CMT_KERNELS_NEON)
+  const float afStepCount[4] = { 1, 2, 3, 4 };
+  float32x4_t vStepCount = vld1q_f32(afStepCount);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    vst1q_f32(pfOutput + lIndex,
+	      vmulq_f32(vld1q_f32(pfInput + lIndex),
+			vaddq_f32(vdupq_n_f32(fGain),
+				  vmulq_n_f32(vStepCount, fGainStep))));
+    vStepCount = vaddq_f32(vStepCount, vdupq_n_f32(4));
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++)
+    pfOutput[lIndex] 
+      = pfInput[lIndex] * (fGain + LADSPA_Data(lIndex + 1) * fGainStep);
+}
+
+/*****************************************************************************/
+
+/** As applyGainRamp() but adding to the output:
+
+      pfOutput[i] += pfInput[i] * (fGain + (i + 1) * fGainStep) */
+inline void
+addGainRamp(LADSPA_Data *       pfOutput,
+	    const LADSPA_Data * pfInput,
+	    const LADSPA_Data   fGain,
+	    const LADSPA_Data   fGainStep,
+	    const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  __m128 vGain = _mm_set1_ps(fGain);
+  __m128 vGainStep = _mm_set1_ps(fGainStep);
+  __m128 vStepCount = _mm_setr_ps(1, 2, 3, 4);
+  const __m128 vFour = _mm_set1_ps(4);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    _mm_storeu_ps(pfOutput + lIndex,
+		  _mm_add_ps(_mm_loadu_ps(pfOutput + lIndex),
+			     _mm_mul_ps(_mm_loadu_ps(pfInput + lIndex),
+					_mm_add_ps(vGain, 
+						   _mm_mul_ps(vStepCount, 
+							      vGainStep)))));
+    vStepCount = _mm_add_ps(vStepCount, vFour);
+  }
+#elif defined(CMT_KERNELS_NEON)
+  const float afStepCount[4] = { 1, 2, 3, 4 };
+  float32x4_t vStepCount = vld1q_f32(afStepCount);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    vst1q_f32(pfOutput + lIndex,
+	      vmlaq_f32(vld1q_f32(pfOutput + lIndex),
+			vld1q_f32(pfInput + lIndex),
+			vaddq_f32(vdupq_n_f32(fGain),
+				  vmulq_n_f32(vStepCount, fGainStep))));
+    vStepCount = vaddq_f32(vStepCount, vdupq_n_f32(4));
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++)
+    pfOutput[lIndex] 
+      += pfInput[lIndex] * (fGain + LADSPA_Data(lIndex + 1) * fGainStep);
+}
+
+/*****************************************************************************/
+
+/** applyGainRamp() or, with bAdding set, addGainRamp(). This suits
+    run functions templated on their output mode (see run_adding.h
+    and is_adding<>()). */
+template <bool bAdding>
+inline void
+writeGainRamp(LADSPA_Data *       pfOutput,
+	      const LADSPA_Data * pfInput,
+	      const LADSPA_Data   fGain,
+	      const LADSPA_Data   fGainStep,
+	      const unsigned long lSampleCount) {
+  if (bAdding)
+    addGainRamp(pfOutput, pfInput, fGain, fGainStep, lSampleCount);
+  else
+    applyGainRamp(pfOutput, pfInput, fGain, fGainStep, lSampleCount);
+}
+
+/*****************************************************************************/
+
+/** Mix lInputCount inputs, each with its own linear gain ramp:
+
+      pfOutput[i] = sum over k of
+		      ppfInputs[k][i] * (pfGain[k] + (i + 1) * pfGainStep[k])
+
+    or with bAdding set, pfOutput[i] += the same. Each group of
+    output samples is accumulated across all the inputs before it is
+    stored, so the output is written once whatever the number of
+    inputs. Keep lSampleCount small enough for all the inputs to stay
+    in cache if the same inputs are to be mixed again. pfOutput must
+    not overlap any of the inputs. */
+template <bool bAdding = false>
+inline void
+mixGainRamps(LADSPA_Data *               pfOutput,
+	     const LADSPA_Data * const * ppfInputs,
+	     const LADSPA_Data *         pfGain,
+	     const LADSPA_Data *         pfGainStep,
+	     const unsigned long         lInputCount,
+	     const unsigned long         lSampleCount) {
+
+  unsigned long lIndex = 0;
+  unsigned long lInput;
+
+#if defined(CMT_KERNELS_SSE)
+  const unsigned long lVectorCount = lSampleCount & ~3UL;
+  __m128 vStepCount = _mm_setr_ps(1, 2, 3, 4);
+  const __m128 vFour = _mm_set1_ps(4);
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    __m128 vSum = _mm_setzero_ps();
+    for (lInput = 0; lInput < lInputCount; lInput++) {
+      const __m128 vGain 
+	= _mm_add_ps(_mm_set1_ps(pfGain[lInput]),
+		     _mm_mul_ps(vStepCount, _mm_set1_ps(pfGainStep[lInput])));
+      vSum = _mm_add_ps(vSum, 
+			_mm_mul_ps(_mm_loadu_ps(ppfInputs[lInput] + lIndex),
+				   vGain));
+    }
+    if (bAdding)
+      vSum = _mm_add_ps(_mm_loadu_ps(pfOutput + lIndex), vSum);
+    _mm_storeu_ps(pfOutput + lIndex, vSum);
+    vStepCount = _mm_add_ps(vStepCount, vFour);
+  }
+#elif defined(CMT_KERNELS_NEON)
+  const unsigned long lVectorCount = lSampleCount & ~3UL;
+  const float afStepCount[4] = { 1, 2, 3, 4 };
+  float32x4_t vStepCount = vld1q_f32(afStepCount);
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    float32x4_t vSum = vdupq_n_f32(0);
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      vSum = vmlaq_f32(vSum,
+		       vld1q_f32(ppfInputs[lInput] + lIndex),
+		       vmlaq_n_f32(vdupq_n_f32(pfGain[lInput]),
+				   vStepCount,
+				   pfGainStep[lInput]));
+    if (bAdding)
+      vSum = vaddq_f32(vld1q_f32(pfOutput + lIndex), vSum);
+    vst1q_f32(pfOutput + lIndex, vSum);
+    vStepCount = vaddq_f32(vStepCount, vdupq_n_f32(4));
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    LADSPA_Data fSum = 0;
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      fSum += (ppfInputs[lInput][lIndex]
+	       * (pfGain[lInput] + LADSPA_Data(lIndex + 1) * pfGainStep[lInput]));
+    if (bAdding)
+      pfOutput[lIndex] += fSum;
+    else
+      pfOutput[lIndex] = fSum;
+  }
+}
+
+/*****************************************************************************/
+
+/** Returns true if every |pfInput[i]| is no greater than fThreshold.
+    This gives up at the first group of samples over the threshold,
+    so it is cheap on signals that are not quiet. */
+inline bool
+isBelowThreshold(const LADSPA_Data * pfInput,
+		 const LADSPA_Data   fThreshold,
+		 const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  const __m128 vSignBit = _mm_set1_ps(-0.0f);
+  const __m128 vThreshold = _mm_set1_ps(fThreshold);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4)
+    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_andnot_ps(vSignBit,
+						   _mm_loadu_ps(pfInput + lIndex)),
+				     vThreshold)))
+      return false;
+#elif defined(CMT_KERNELS_NEON)
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    uint32x4_t vOver = vcagtq_f32(vld1q_f32(pfInput + lIndex),
+				  vdupq_n_f32(fThreshold));
+    uint32x2_t vOver2 = vorr_u32(vget_low_u32(vOver), vget_high_u32(vOver));
+    if (vget_lane_u32(vOver2, 0) | vget_lane_u32(vOver2, 1))
+      return false;
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++)
+    if (pfInput[lIndex] > fThreshold || pfInput[lIndex] < -fThreshold)
+      return false;
+  return true;
+}
+
+/*****************************************************************************/
+
+/** Returns the largest |pfInput[i]| and sets rfSumOfSquares to the
+    sum of pfInput[i]^2, reading the input once for both. As with
+    dotProduct(), the SIMD paths keep four partial sums. */
+inline LADSPA_Data
+peakAndSumOfSquares(const LADSPA_Data * pfInput,
+		    const unsigned long lSampleCount,
+		    LADSPA_Data &       rfSumOfSquares) {
+
+  unsigned long lIndex = 0;
+  LADSPA_Data fPeak = 0;
+  LADSPA_Data fSum = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  const unsigned long lVectorCount = lSampleCount & ~3UL;
+  const __m128 vSignBit = _mm_set1_ps(-0.0f);
+  __m128 vPeak = _mm_setzero_ps();
+  __m128 vSum = _mm_setzero_ps();
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    const __m128 vInput = _mm_loadu_ps(pfInput + lIndex);
+    vPeak = _mm_max_ps(vPeak, _mm_andnot_ps(vSignBit, vInput));
+    vSum = _mm_add_ps(vSum, _mm_mul_ps(vInput, vInput));
+  }
+  vPeak = _mm_max_ps(vPeak, _mm_movehl_ps(vPeak, vPeak));
+  vPeak = _mm_max_ss(vPeak, _mm_shuffle_ps(vPeak, vPeak, 1));
+  fPeak = _mm_cvtss_f32(vPeak);
+  vSum = _mm_add_ps(vSum, _mm_movehl_ps(vSum, vSum));
+  vSum = _mm_add_ss(vSum, _mm_shuffle_ps(vSum, vSum, 1));
+  fSum = _mm_cvtss_f32(vSum);
+#elif defined(CMT_KERNELS_NEON)
+  const unsigned long lVectorCount = lSampleCount & ~3UL;
+  float32x4_t vPeak = vdupq_n_f32(0);
+  float32x4_t vSum = vdupq_n_f32(0);
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    const float32x4_t vInput = vld1q_f32(pfInput + lIndex);
+    vPeak = vmaxq_f32(vPeak, vabsq_f32(vInput));
+    vSum = vmlaq_f32(vSum, vInput, vInput);
+  }
+  float32x2_t vHalf = vmax_f32(vget_low_f32(vPeak), vget_high_f32(vPeak));
+  fPeak = vget_lane_f32(vpmax_f32(vHalf, vHalf), 0);
+  vHalf = vadd_f32(vget_low_f32(vSum), vget_high_f32(vSum));
+  fSum = vget_lane_f32(vpadd_f32(vHalf, vHalf), 0);
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    const LADSPA_Data fInput = pfInput[lIndex];
+    if (fInput > fPeak)
+      fPeak = fInput;
+    else if (-fInput > fPeak)
+      fPeak = -fInput;
+    fSum += fInput * fInput;
+  }
+
+  rfSumOfSquares = fSum;
+  return fPeak;
+}
+
+/*****************************************************************************/
+
+/** Inverse distance to each of a run of points:
+
+      pfOutput[i] = 1 / sqrt(pfX[i]^2 + pfY[i]^2 + pfZ[i]^2)
+
+    or zero for points closer to the origin than 1e-5. The relative
+    error is below 5e-6, as for fastInverseSqrt(). */
+inline void
+inverseDistance(LADSPA_Data *       pfOutput,
+		const LADSPA_Data * pfX,
+		const LADSPA_Data * pfY,
+		const LADSPA_Data * pfZ,
+		const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  const __m128 vMinimum = _mm_set1_ps(1e-10f);
+  const __m128 vHalf = _mm_set1_ps(0.5f);
+  const __m128 vThreeHalves = _mm_set1_ps(1.5f);
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    const __m128 vX = _mm_loadu_ps(pfX + lIndex);
+    const __m128 vY = _mm_loadu_ps(pfY + lIndex);
+    const __m128 vZ = _mm_loadu_ps(pfZ + lIndex);
+    const __m128 vDistanceSquared 
+      = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vX, vX), _mm_mul_ps(vY, vY)),
+		   _mm_mul_ps(vZ, vZ));
+    const __m128 vValid = _mm_cmpgt_ps(vDistanceSquared, vMinimum);
+    const __m128 vSafe = _mm_max_ps(vDistanceSquared, vMinimum);
+    /* One Newton-Raphson step on the 12 bit estimate. */
+    __m128 vResult = _mm_rsqrt_ps(vSafe);
+    vResult 
+      = _mm_mul_ps(vResult,
+		   _mm_sub_ps(vThreeHalves,
+			      _mm_mul_ps(_mm_mul_ps(vHalf, vSafe),
+					 _mm_mul_ps(vResult, vResult))));
+    _mm_storeu_ps(pfOutput + lIndex, _mm_and_ps(vResult, vValid));
+  }
+#elif defined(CMT_KERNELS_NEON)
+  for (; lIndex + 4 <= lSampleCount; lIndex += 4) {
+    const float32x4_t vX = vld1q_f32(pfX + lIndex);
+    const float32x4_t vY = vld1q_f32(pfY + lIndex);
+    const float32x4_t vZ = vld1q_f32(pfZ + lIndex);
+    const float32x4_t vDistanceSquared 
+      = vmlaq_f32(vmlaq_f32(vmulq_f32(vX, vX), vY, vY), vZ, vZ);
+    const uint32x4_t vValid 
+      = vcgtq_f32(vDistanceSquared, vdupq_n_f32(1e-10f));
+    const float32x4_t vSafe 
+      = vmaxq_f32(vDistanceSquared, vdupq_n_f32(1e-10f));
+    /* Two Newton-Raphson steps on the 8 bit estimate. */
+    float32x4_t vResult = vrsqrteq_f32(vSafe);
+    vResult = vmulq_f32(vResult,
+			vrsqrtsq_f32(vmulq_f32(vSafe, vResult), vResult));
+    vResult = vmulq_f32(vResult,
+			vrsqrtsq_f32(vmulq_f32(vSafe, vResult), vResult));
+    vst1q_f32(pfOutput + lIndex,
+	      vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vResult),
+					      vValid)));
+  }
+#endif
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    const LADSPA_Data fDistanceSquared 
+      = (pfX[lIndex] * pfX[lIndex] 
+	 + pfY[lIndex] * pfY[lIndex] 
+	 + pfZ[lIndex] * pfZ[lIndex]);
+    pfOutput[lIndex] 
+      = (fDistanceSquared > 1e-10f ? fastInverseSqrt(fDistanceSquared) : 0);
+  }
+}
+
+/*****************************************************************************/
+
+/** Returns the sum of pfA[i] * pfB[i]. The SIMD paths keep four
+    partial sums, so the result may differ slightly from the plain
+    loop. */
+inline LADSPA_Data
+dotProduct(const LADSPA_Data * pfA,
+	   const LADSPA_Data * pfB,
+	   const unsigned long lCount) {
+
+  unsigned long lIndex = 0;
+  LADSPA_Data fSum = 0;
+
+  /* Counting to a multiple of four (rather than testing lIndex + 4 <=
+     lCount) lets gcc see that the loop ends. */
+#if defined(CMT_KERNELS_SSE)
+  const unsigned long lVectorCount = lCount & ~3UL;
+  __m128 vSum = _mm_setzero_ps();
+  for (; lIndex < lVectorCount; lIndex += 4)
+    vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_loadu_ps(pfA + lIndex),
+				       _mm_loadu_ps(pfB + lIndex)));
+  vSum = _mm_add_ps(vSum, _mm_movehl_ps(vSum, vSum));
+  vSum = _mm_add_ss(vSum, _mm_shuffle_ps(vSum, vSum, 1));
+  fSum = _mm_cvtss_f32(vSum);
+#elif defined(CMT_KERNELS_NEON)
+  const unsigned long lVectorCount = lCount & ~3UL;
+  float32x4_t vSum = vdupq_n_f32(0);
+  for (; lIndex < lVectorCount; lIndex += 4)
+    vSum = vmlaq_f32(vSum, vld1q_f32(pfA + lIndex), vld1q_f32(pfB + lIndex));
+  float32x2_t vHalf = vadd_f32(vget_low_f32(vSum), vget_high_f32(vSum));
+  fSum = vget_lane_f32(vpadd_f32(vHalf, vHalf), 0);
+#endif
+
+  for (; lIndex < lCount; lIndex++)
+    fSum += pfA[lIndex] * pfB[lIndex];
+  return fSum;
+}
+
+/*****************************************************************************/
+
+/** Multiply spectra A and B bin by bin and add the products to the
+    accumulator, all held in the packed form of fft.h (real and
+    imaginary parts apart, with the real DC and Nyquist bins sharing
+    bin 0, which is multiplied part by part). This is the inner loop
+    of fast convolution. */
+inline void
+multiplyAccumulateSpectrum(LADSPA_Data *       pfAccumulatorReal,
+			   LADSPA_Data *       pfAccumulatorImaginary,
+			   const LADSPA_Data * pfAReal,
+			   const LADSPA_Data * pfAImaginary,
+			   const LADSPA_Data * pfBReal,
+			   const LADSPA_Data * pfBImaginary,
+			   const unsigned long lBinCount) {
+
+  if (lBinCount == 0)
+    return;
+
+  /* Bin 0 goes through the loop as a complex bin and is put right
+     afterwards. */
+  const LADSPA_Data fDC 
+    = pfAccumulatorReal[0] + pfAReal[0] * pfBReal[0];
+  const LADSPA_Data fNyquist
+    = pfAccumulatorImaginary[0] + pfAImaginary[0] * pfBImaginary[0];
+
+  unsigned long lIndex = 0;
+
+#if defined(CMT_KERNELS_SSE)
+  const unsigned long lVectorCount = lBinCount & ~3UL;
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    const __m128 vAReal = _mm_loadu_ps(pfAReal + lIndex);
+    const __m128 vAImaginary = _mm_loadu_ps(pfAImaginary + lIndex);
+    const __m128 vBReal = _mm_loadu_ps(pfBReal + lIndex);
+    const __m128 vBImaginary = _mm_loadu_ps(pfBImaginary + lIndex);
+    _mm_storeu_ps(pfAccumulatorReal + lIndex,
+		  _mm_add_ps(_mm_loadu_ps(pfAccumulatorReal + lIndex),
+			     _mm_sub_ps(_mm_mul_ps(vAReal, vBReal),
+					_mm_mul_ps(vAImaginary,
+						   vBImaginary))));
+    _mm_storeu_ps(pfAccumulatorImaginary + lIndex,
+		  _mm_add_ps(_mm_loadu_ps(pfAccumulatorImaginary + lIndex),
+			     _mm_add_ps(_mm_mul_ps(vAReal, vBImaginary),
+					_mm_mul_ps(vAImaginary, vBReal))));
+  }
+#elif defined(CMT_KERNELS_NEON)
+  const unsigned long lVectorCount = lBinCount & ~3UL;
+  for (; lIndex < lVectorCount; lIndex += 4) {
+    const float32x4_t vAReal = vld1q_f32(pfAReal + lIndex);
+    const float32x4_t vAImaginary = vld1q_f32(pfAImaginary + lIndex);
+    const float32x4_t vBReal = vld1q_f32(pfBReal + lIndex);
+    const float32x4_t vBImaginary = vld1q_f32(pfBImaginary + lIndex);
+    float32x4_t vReal = vld1q_f32(pfAccumulatorReal + lIndex);
+    float32x4_t vImaginary = vld1q_f32(pfAccumulatorImaginary + lIndex);
+    vReal = vmlsq_f32(vmlaq_f32(vReal, vAReal, vBReal),
+		      vAImaginary, vBImaginary);
+    vImaginary = vmlaq_f32(vmlaq_f32(vImaginary, vAReal, vBImaginary),
+			   vAImaginary, vBReal);
+    vst1q_f32(pfAccumulatorReal + lIndex, vReal);
+    vst1q_f32(pfAccumulatorImaginary + lIndex, vImaginary);
+  }
+#endif
+
+  for (; lIndex < lBinCount; lIndex++) {
+    const LADSPA_Data fAReal = pfAReal[lIndex];
+    const LADSPA_Data fAImaginary = pfAImaginary[lIndex];
+    const LADSPA_Data fBReal = pfBReal[lIndex];
+    const LADSPA_Data fBImaginary = pfBImaginary[lIndex];
+    pfAccumulatorReal[lIndex] += fAReal * fBReal - fAImaginary * fBImaginary;
+    pfAccumulatorImaginary[lIndex] 
+      += fAReal * fBImaginary + fAImaginary * fBReal;
+  }
+
+  pfAccumulatorReal[0] = fDC;
+  pfAccumulatorImaginary[0] = fNyquist;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
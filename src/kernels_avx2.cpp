@@ -0,0 +1,44 @@
+/* kernels_avx2.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+/* The dispatched kernels built for AVX2 (see dispatch.h). */
+
+/*****************************************************************************/
+
+#include "dispatch.h"
+
+/*****************************************************************************/
+
+#ifdef CMT_DISPATCH_X86
+
+#pragma GCC target("avx2,fma")
+
+#define CMT_WIDE_LANES 8
+#include "kernels_wide.h"
+
+const CMT_KernelSet g_sAVX2Kernels = CMT_KERNEL_SET("avx2");
+
+#endif
+
+/*****************************************************************************/
+
+/* EOF */
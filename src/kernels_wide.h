@@ -0,0 +1,307 @@
+/* kernels_wide.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_KERNELS_WIDE_INCLUDED
+#define CMT_KERNELS_WIDE_INCLUDED
+
+/*****************************************************************************/
+
+/* The dispatched kernels of dispatch.h written for vectors of
+   CMT_WIDE_LANES floats, using the compiler's generic vector types.
+   This is included by one file per instruction set, after that file
+   has set CMT_WIDE_LANES and the target (with #pragma GCC target), so
+   that the same source gives AVX2 and AVX-512 code. The kernels have
+   internal linkage, so they cannot be mistaken for the baseline
+   kernels of kernels.h at link time. Each follows the plain loop of
+   its kernels.h counterpart, which also handles the tail. */
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+
+/*****************************************************************************/
+
+namespace {
+
+typedef LADSPA_Data WideVector
+  __attribute__((vector_size(CMT_WIDE_LANES * sizeof(LADSPA_Data))));
+
+inline WideVector
+wideLoad(const LADSPA_Data * pfData) {
+  WideVector vResult;
+  __builtin_memcpy(&vResult, pfData, sizeof(vResult));
+  return vResult;
+}
+
+inline void
+wideStore(LADSPA_Data * pfData, const WideVector vValue) {
+  __builtin_memcpy(pfData, &vValue, sizeof(vValue));
+}
+
+inline WideVector
+wideSplat(const LADSPA_Data fValue) {
+  return WideVector{} + fValue;
+}
+
+/** The lane numbers plus fFirst. */
+inline WideVector
+wideCount(const LADSPA_Data fFirst) {
+  WideVector vResult;
+  for (int iLane = 0; iLane < CMT_WIDE_LANES; iLane++)
+    vResult[iLane] = fFirst + iLane;
+  return vResult;
+}
+
+inline LADSPA_Data
+wideSum(const WideVector vValue) {
+  LADSPA_Data fSum = 0;
+  for (int iLane = 0; iLane < CMT_WIDE_LANES; iLane++)
+    fSum += vValue[iLane];
+  return fSum;
+}
+
+/*****************************************************************************/
+
+template <bool bAdding>
+void
+mixBuffers(LADSPA_Data *       pfOutput,
+	   const LADSPA_Data * pfInputA,
+	   const LADSPA_Data   fGainA,
+	   const LADSPA_Data * pfInputB,
+	   const LADSPA_Data   fGainB,
+	   const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+  for (; lIndex + CMT_WIDE_LANES <= lSampleCount; lIndex += CMT_WIDE_LANES) {
+    WideVector vMix 
+      = fGainA * wideLoad(pfInputA + lIndex) 
+      + fGainB * wideLoad(pfInputB + lIndex);
+    if (bAdding)
+      vMix += wideLoad(pfOutput + lIndex);
+    wideStore(pfOutput + lIndex, vMix);
+  }
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    const LADSPA_Data fMix 
+      = fGainA * pfInputA[lIndex] + fGainB * pfInputB[lIndex];
+    if (bAdding)
+      pfOutput[lIndex] += fMix;
+    else
+      pfOutput[lIndex] = fMix;
+  }
+}
+
+template <bool bAdding>
+void
+mixWithFeedback(LADSPA_Data *       pfOutput,
+		LADSPA_Data *       pfFeedback,
+		const LADSPA_Data * pfInput,
+		const LADSPA_Data * pfDelayed,
+		const LADSPA_Data   fDry,
+		const LADSPA_Data   fWet,
+		const LADSPA_Data   fFeedback,
+		const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+  for (; lIndex + CMT_WIDE_LANES <= lSampleCount; lIndex += CMT_WIDE_LANES) {
+    const WideVector vInput = wideLoad(pfInput + lIndex);
+    const WideVector vDelayed = wideLoad(pfDelayed + lIndex);
+    WideVector vMix = fDry * vInput + fWet * vDelayed;
+    if (bAdding)
+      vMix += wideLoad(pfOutput + lIndex);
+    wideStore(pfOutput + lIndex, vMix);
+    wideStore(pfFeedback + lIndex, vInput + fFeedback * vDelayed);
+  }
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    LADSPA_Data fInputSample = pfInput[lIndex];
+    LADSPA_Data fDelayedSample = pfDelayed[lIndex];
+    LADSPA_Data fMix = fDry * fInputSample + fWet * fDelayedSample;
+    if (bAdding)
+      pfOutput[lIndex] += fMix;
+    else
+      pfOutput[lIndex] = fMix;
+    pfFeedback[lIndex] = fInputSample + fFeedback * fDelayedSample;
+  }
+}
+
+template <bool bAdding>
+void
+writeGainRamp(LADSPA_Data *       pfOutput,
+	      const LADSPA_Data * pfInput,
+	      const LADSPA_Data   fGain,
+	      const LADSPA_Data   fGainStep,
+	      const unsigned long lSampleCount) {
+
+  unsigned long lIndex = 0;
+  WideVector vStepCount = wideCount(1);
+  for (; lIndex + CMT_WIDE_LANES <= lSampleCount; lIndex += CMT_WIDE_LANES) {
+    WideVector vOutput 
+      = wideLoad(pfInput + lIndex) * (fGain + vStepCount * fGainStep);
+    if (bAdding)
+      vOutput += wideLoad(pfOutput + lIndex);
+    wideStore(pfOutput + lIndex, vOutput);
+    vStepCount += LADSPA_Data(CMT_WIDE_LANES);
+  }
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    const LADSPA_Data fOutput
+      = pfInput[lIndex] * (fGain + LADSPA_Data(lIndex + 1) * fGainStep);
+    if (bAdding)
+      pfOutput[lIndex] += fOutput;
+    else
+      pfOutput[lIndex] = fOutput;
+  }
+}
+
+void
+applyGainRamp(LADSPA_Data *       pfOutput,
+	      const LADSPA_Data * pfInput,
+	      const LADSPA_Data   fGain,
+	      const LADSPA_Data   fGainStep,
+	      const unsigned long lSampleCount) {
+  writeGainRamp<false>(pfOutput, pfInput, fGain, fGainStep, lSampleCount);
+}
+
+void
+addGainRamp(LADSPA_Data *       pfOutput,
+	    const LADSPA_Data * pfInput,
+	    const LADSPA_Data   fGain,
+	    const LADSPA_Data   fGainStep,
+	    const unsigned long lSampleCount) {
+  writeGainRamp<true>(pfOutput, pfInput, fGain, fGainStep, lSampleCount);
+}
+
+template <bool bAdding>
+void
+mixGainRamps(LADSPA_Data *               pfOutput,
+	     const LADSPA_Data * const * ppfInputs,
+	     const LADSPA_Data *         pfGain,
+	     const LADSPA_Data *         pfGainStep,
+	     const unsigned long         lInputCount,
+	     const unsigned long         lSampleCount) {
+
+  unsigned long lIndex = 0;
+  unsigned long lInput;
+
+  WideVector vStepCount = wideCount(1);
+  for (; lIndex + CMT_WIDE_LANES <= lSampleCount; lIndex += CMT_WIDE_LANES) {
+    WideVector vSum = WideVector{};
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      vSum += (wideLoad(ppfInputs[lInput] + lIndex)
+	       * (pfGain[lInput] + vStepCount * pfGainStep[lInput]));
+    if (bAdding)
+      vSum += wideLoad(pfOutput + lIndex);
+    wideStore(pfOutput + lIndex, vSum);
+    vStepCount += LADSPA_Data(CMT_WIDE_LANES);
+  }
+
+  for (; lIndex < lSampleCount; lIndex++) {
+    LADSPA_Data fSum = 0;
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      fSum += (ppfInputs[lInput][lIndex]
+	       * (pfGain[lInput] + LADSPA_Data(lIndex + 1) * pfGainStep[lInput]));
+    if (bAdding)
+      pfOutput[lIndex] += fSum;
+    else
+      pfOutput[lIndex] = fSum;
+  }
+}
+
+/** Two vectors of partial sums are kept to hide the latency of the
+    additions. */
+LADSPA_Data
+dotProduct(const LADSPA_Data * pfA,
+	   const LADSPA_Data * pfB,
+	   const unsigned long lCount) {
+
+  unsigned long lIndex = 0;
+  WideVector vSum0 = WideVector{};
+  WideVector vSum1 = WideVector{};
+  for (; lIndex + 2 * CMT_WIDE_LANES <= lCount; lIndex += 2 * CMT_WIDE_LANES) {
+    vSum0 += wideLoad(pfA + lIndex) * wideLoad(pfB + lIndex);
+    vSum1 += (wideLoad(pfA + lIndex + CMT_WIDE_LANES)
+	      * wideLoad(pfB + lIndex + CMT_WIDE_LANES));
+  }
+  if (lIndex + CMT_WIDE_LANES <= lCount) {
+    vSum0 += wideLoad(pfA + lIndex) * wideLoad(pfB + lIndex);
+    lIndex += CMT_WIDE_LANES;
+  }
+
+  LADSPA_Data fSum = wideSum(vSum0 + vSum1);
+  for (; lIndex < lCount; lIndex++)
+    fSum += pfA[lIndex] * pfB[lIndex];
+  return fSum;
+}
+
+void
+multiplyAccumulateSpectrum(LADSPA_Data *       pfAccumulatorReal,
+			   LADSPA_Data *       pfAccumulatorImaginary,
+			   const LADSPA_Data * pfAReal,
+			   const LADSPA_Data * pfAImaginary,
+			   const LADSPA_Data * pfBReal,
+			   const LADSPA_Data * pfBImaginary,
+			   const unsigned long lBinCount) {
+
+  if (lBinCount == 0)
+    return;
+
+  /* Bin 0 goes through the loop as a complex bin and is put right
+     afterwards. */
+  const LADSPA_Data fDC 
+    = pfAccumulatorReal[0] + pfAReal[0] * pfBReal[0];
+  const LADSPA_Data fNyquist
+    = pfAccumulatorImaginary[0] + pfAImaginary[0] * pfBImaginary[0];
+
+  unsigned long lIndex = 0;
+  for (; lIndex + CMT_WIDE_LANES <= lBinCount; lIndex += CMT_WIDE_LANES) {
+    const WideVector vAReal = wideLoad(pfAReal + lIndex);
+    const WideVector vAImaginary = wideLoad(pfAImaginary + lIndex);
+    const WideVector vBReal = wideLoad(pfBReal + lIndex);
+    const WideVector vBImaginary = wideLoad(pfBImaginary + lIndex);
+    wideStore(pfAccumulatorReal + lIndex,
+	      wideLoad(pfAccumulatorReal + lIndex)
+	      + (vAReal * vBReal - vAImaginary * vBImaginary));
+    wideStore(pfAccumulatorImaginary + lIndex,
+	      wideLoad(pfAccumulatorImaginary + lIndex)
+	      + (vAReal * vBImaginary + vAImaginary * vBReal));
+  }
+
+  for (; lIndex < lBinCount; lIndex++) {
+    const LADSPA_Data fAReal = pfAReal[lIndex];
+    const LADSPA_Data fAImaginary = pfAImaginary[lIndex];
+    const LADSPA_Data fBReal = pfBReal[lIndex];
+    const LADSPA_Data fBImaginary = pfBImaginary[lIndex];
+    pfAccumulatorReal[lIndex] += fAReal * fBReal - fAImaginary * fBImaginary;
+    pfAccumulatorImaginary[lIndex] 
+      += fAReal * fBImaginary + fAImaginary * fBReal;
+  }
+
+  pfAccumulatorReal[0] = fDC;
+  pfAccumulatorImaginary[0] = fNyquist;
+}
+
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
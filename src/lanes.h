@@ -0,0 +1,580 @@
+/* lanes.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_LANES_INCLUDED
+#define CMT_LANES_INCLUDED
+
+/*****************************************************************************/
+
+/* Small vectors of LANE_COUNT floats for plugins that run several
+   voices side by side, one voice per lane. Code written with these
+   compiles to SSE2 or NEON where the compiler targets them and to
+   plain loops otherwise, so a plugin's voice code is written once
+   rather than once per instruction set as in kernels.h.
+
+   Comparisons give a LaneMask, which is true in the lanes where the
+   comparison holds and is used with lanesSelect() in place of
+   branches. */
+
+/*****************************************************************************/
+
+#include <cmath>
+
+/*****************************************************************************/
+
+#include "kernels.h"
+#include "run_adding.h"
+
+/*****************************************************************************/
+
+#define LANE_COUNT 4
+
+/*****************************************************************************/
+
+#if defined(CMT_KERNELS_SSE2)
+
+struct Lanes {
+  __m128 m_v;
+};
+struct LaneMask {
+  __m128 m_v;
+};
+
+inline Lanes lanes(const __m128 v) {
+  Lanes vResult = { v };
+  return vResult;
+}
+inline LaneMask laneMask(const __m128 v) {
+  LaneMask vResult = { v };
+  return vResult;
+}
+
+inline Lanes lanesSplat(const LADSPA_Data fValue) {
+  return lanes(_mm_set1_ps(fValue));
+}
+inline Lanes lanesSet(const LADSPA_Data f0,
+		      const LADSPA_Data f1,
+		      const LADSPA_Data f2,
+		      const LADSPA_Data f3) {
+  return lanes(_mm_setr_ps(f0, f1, f2, f3));
+}
+inline Lanes lanesLoad(const LADSPA_Data * pfData) {
+  return lanes(_mm_loadu_ps(pfData));
+}
+inline void lanesStore(LADSPA_Data * pfData, const Lanes vValue) {
+  _mm_storeu_ps(pfData, vValue.m_v);
+}
+
+inline Lanes operator+(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_add_ps(vA.m_v, vB.m_v));
+}
+inline Lanes operator-(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_sub_ps(vA.m_v, vB.m_v));
+}
+inline Lanes operator*(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_mul_ps(vA.m_v, vB.m_v));
+}
+inline Lanes operator/(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_div_ps(vA.m_v, vB.m_v));
+}
+inline Lanes lanesMin(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_min_ps(vA.m_v, vB.m_v));
+}
+inline Lanes lanesMax(const Lanes vA, const Lanes vB) {
+  return lanes(_mm_max_ps(vA.m_v, vB.m_v));
+}
+inline Lanes lanesAbs(const Lanes vValue) {
+  return lanes(_mm_andnot_ps(_mm_set1_ps(-0.0f), vValue.m_v));
+}
+inline Lanes lanesSqrt(const Lanes vValue) {
+  return lanes(_mm_sqrt_ps(vValue.m_v));
+}
+
+/** fFirst followed by the first three lanes of vValue, for comparing
+    each sample of a block with the one before. */
+inline Lanes lanesShiftIn(const LADSPA_Data fFirst, const Lanes vValue) {
+  return lanes(_mm_move_ss(_mm_shuffle_ps(vValue.m_v,
+					  vValue.m_v,
+					  _MM_SHUFFLE(2, 1, 0, 3)),
+			   _mm_set_ss(fFirst)));
+}
+
+/** Largest integer not above each lane, for lanes within the range
+    of a 32 bit integer. */
+inline Lanes lanesFloor(const Lanes vValue) {
+  const __m128 vTruncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(vValue.m_v));
+  return lanes(_mm_sub_ps(vTruncated,
+			  _mm_and_ps(_mm_cmpgt_ps(vTruncated, vValue.m_v),
+				     _mm_set1_ps(1))));
+}
+
+inline LaneMask operator<(const Lanes vA, const Lanes vB) {
+  return laneMask(_mm_cmplt_ps(vA.m_v, vB.m_v));
+}
+inline LaneMask operator>(const Lanes vA, const Lanes vB) {
+  return laneMask(_mm_cmpgt_ps(vA.m_v, vB.m_v));
+}
+inline LaneMask operator>=(const Lanes vA, const Lanes vB) {
+  return laneMask(_mm_cmpge_ps(vA.m_v, vB.m_v));
+}
+inline LaneMask operator&(const LaneMask vA, const LaneMask vB) {
+  return laneMask(_mm_and_ps(vA.m_v, vB.m_v));
+}
+inline LaneMask operator|(const LaneMask vA, const LaneMask vB) {
+  return laneMask(_mm_or_ps(vA.m_v, vB.m_v));
+}
+
+/** True if vMask is true in any lane. */
+inline bool lanesAny(const LaneMask vMask) {
+  return _mm_movemask_ps(vMask.m_v) != 0;
+}
+
+/** vA in the lanes where vMask is true and vB elsewhere. */
+inline Lanes lanesSelect(const LaneMask vMask,
+			 const Lanes vA,
+			 const Lanes vB) {
+  return lanes(_mm_or_ps(_mm_and_ps(vMask.m_v, vA.m_v),
+			 _mm_andnot_ps(vMask.m_v, vB.m_v)));
+}
+
+/** Sum of the lanes, added as (0 + 1) + (2 + 3). */
+inline LADSPA_Data lanesSum(const Lanes vValue) {
+  const __m128 vPairs
+    = _mm_add_ps(vValue.m_v, _mm_movehl_ps(vValue.m_v, vValue.m_v));
+  return _mm_cvtss_f32(_mm_add_ss(vPairs,
+				  _mm_shuffle_ps(vPairs, vPairs, 1)));
+}
+
+/** Sample lIndex of a different buffer for each lane, and the
+    reverse. These let plugins run several instances or channels side
+    by side, one to a lane. */
+inline Lanes lanesGather(const LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex) {
+  return lanes(_mm_setr_ps(ppfBuffers[0][lIndex],
+			   ppfBuffers[1][lIndex],
+			   ppfBuffers[2][lIndex],
+			   ppfBuffers[3][lIndex]));
+}
+inline void lanesScatter(LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex,
+			 const Lanes vValue) {
+  _mm_store_ss(ppfBuffers[0] + lIndex, vValue.m_v);
+  _mm_store_ss(ppfBuffers[1] + lIndex, 
+	       _mm_shuffle_ps(vValue.m_v, vValue.m_v, 1));
+  _mm_store_ss(ppfBuffers[2] + lIndex, 
+	       _mm_shuffle_ps(vValue.m_v, vValue.m_v, 2));
+  _mm_store_ss(ppfBuffers[3] + lIndex, 
+	       _mm_shuffle_ps(vValue.m_v, vValue.m_v, 3));
+}
+
+/** Linear interpolation in a different table for each lane, at a
+    non-negative position measured in table points. Each table must
+    be readable one point beyond the position. The points are
+    gathered through registers as storing them and reloading them as
+    a vector would stall. */
+inline Lanes lanesInterpolate(const LADSPA_Data * const * ppfTables,
+			      const Lanes vPosition) {
+  const __m128i viIndex = _mm_cvttps_epi32(vPosition.m_v);
+  int aiIndex[LANE_COUNT];
+  _mm_storeu_si128((__m128i *)aiIndex, viIndex);
+  const __m128 vX0 = _mm_setr_ps(ppfTables[0][aiIndex[0]],
+				 ppfTables[1][aiIndex[1]],
+				 ppfTables[2][aiIndex[2]],
+				 ppfTables[3][aiIndex[3]]);
+  const __m128 vX1 = _mm_setr_ps(ppfTables[0][aiIndex[0] + 1],
+				 ppfTables[1][aiIndex[1] + 1],
+				 ppfTables[2][aiIndex[2] + 1],
+				 ppfTables[3][aiIndex[3] + 1]);
+  const __m128 vFraction = _mm_sub_ps(vPosition.m_v, _mm_cvtepi32_ps(viIndex));
+  return lanes(_mm_add_ps(vX0, _mm_mul_ps(vFraction, _mm_sub_ps(vX1, vX0))));
+}
+
+/*****************************************************************************/
+
+#elif defined(CMT_KERNELS_NEON)
+
+struct Lanes {
+  float32x4_t m_v;
+};
+struct LaneMask {
+  uint32x4_t m_v;
+};
+
+inline Lanes lanes(const float32x4_t v) {
+  Lanes vResult = { v };
+  return vResult;
+}
+inline LaneMask laneMask(const uint32x4_t v) {
+  LaneMask vResult = { v };
+  return vResult;
+}
+
+inline Lanes lanesSplat(const LADSPA_Data fValue) {
+  return lanes(vdupq_n_f32(fValue));
+}
+inline Lanes lanesSet(const LADSPA_Data f0,
+		      const LADSPA_Data f1,
+		      const LADSPA_Data f2,
+		      const LADSPA_Data f3) {
+  float32x4_t v = vdupq_n_f32(f0);
+  v = vsetq_lane_f32(f1, v, 1);
+  v = vsetq_lane_f32(f2, v, 2);
+  v = vsetq_lane_f32(f3, v, 3);
+  return lanes(v);
+}
+inline Lanes lanesLoad(const LADSPA_Data * pfData) {
+  return lanes(vld1q_f32(pfData));
+}
+inline void lanesStore(LADSPA_Data * pfData, const Lanes vValue) {
+  vst1q_f32(pfData, vValue.m_v);
+}
+
+inline Lanes operator+(const Lanes vA, const Lanes vB) {
+  return lanes(vaddq_f32(vA.m_v, vB.m_v));
+}
+inline Lanes operator-(const Lanes vA, const Lanes vB) {
+  return lanes(vsubq_f32(vA.m_v, vB.m_v));
+}
+inline Lanes operator*(const Lanes vA, const Lanes vB) {
+  return lanes(vmulq_f32(vA.m_v, vB.m_v));
+}
+inline Lanes operator/(const Lanes vA, const Lanes vB) {
+#if defined(__aarch64__)
+  return lanes(vdivq_f32(vA.m_v, vB.m_v));
+#else
+  /* ARMv7 has no vector divide. Two Newton-Raphson steps on the
+     reciprocal estimate give close to full precision. */
+  float32x4_t vReciprocal = vrecpeq_f32(vB.m_v);
+  vReciprocal = vmulq_f32(vrecpsq_f32(vB.m_v, vReciprocal), vReciprocal);
+  vReciprocal = vmulq_f32(vrecpsq_f32(vB.m_v, vReciprocal), vReciprocal);
+  return lanes(vmulq_f32(vA.m_v, vReciprocal));
+#endif
+}
+inline Lanes lanesMin(const Lanes vA, const Lanes vB) {
+  return lanes(vminq_f32(vA.m_v, vB.m_v));
+}
+inline Lanes lanesMax(const Lanes vA, const Lanes vB) {
+  return lanes(vmaxq_f32(vA.m_v, vB.m_v));
+}
+inline Lanes lanesAbs(const Lanes vValue) {
+  return lanes(vabsq_f32(vValue.m_v));
+}
+inline Lanes lanesSqrt(const Lanes vValue) {
+#if defined(__aarch64__)
+  return lanes(vsqrtq_f32(vValue.m_v));
+#else
+  /* As for division, refine the reciprocal square root estimate. The
+     square root of zero would come out as zero times infinity, so is
+     selected separately. */
+  float32x4_t vReciprocal = vrsqrteq_f32(vValue.m_v);
+  vReciprocal
+    = vmulq_f32(vrsqrtsq_f32(vmulq_f32(vValue.m_v, vReciprocal), vReciprocal),
+		vReciprocal);
+  vReciprocal
+    = vmulq_f32(vrsqrtsq_f32(vmulq_f32(vValue.m_v, vReciprocal), vReciprocal),
+		vReciprocal);
+  return lanes(vbslq_f32(vcgtq_f32(vValue.m_v, vdupq_n_f32(0)),
+			 vmulq_f32(vValue.m_v, vReciprocal),
+			 vdupq_n_f32(0)));
+#endif
+}
+
+inline Lanes lanesShiftIn(const LADSPA_Data fFirst, const Lanes vValue) {
+  return lanes(vextq_f32(vdupq_n_f32(fFirst), vValue.m_v, 3));
+}
+
+inline Lanes lanesFloor(const Lanes vValue) {
+  const float32x4_t vTruncated = vcvtq_f32_s32(vcvtq_s32_f32(vValue.m_v));
+  return lanes(vsubq_f32(vTruncated,
+			 vbslq_f32(vcgtq_f32(vTruncated, vValue.m_v),
+				   vdupq_n_f32(1),
+				   vdupq_n_f32(0))));
+}
+
+inline LaneMask operator<(const Lanes vA, const Lanes vB) {
+  return laneMask(vcltq_f32(vA.m_v, vB.m_v));
+}
+inline LaneMask operator>(const Lanes vA, const Lanes vB) {
+  return laneMask(vcgtq_f32(vA.m_v, vB.m_v));
+}
+inline LaneMask operator>=(const Lanes vA, const Lanes vB) {
+  return laneMask(vcgeq_f32(vA.m_v, vB.m_v));
+}
+inline LaneMask operator&(const LaneMask vA, const LaneMask vB) {
+  return laneMask(vandq_u32(vA.m_v, vB.m_v));
+}
+inline LaneMask operator|(const LaneMask vA, const LaneMask vB) {
+  return laneMask(vorrq_u32(vA.m_v, vB.m_v));
+}
+
+inline bool lanesAny(const LaneMask vMask) {
+#if defined(__aarch64__)
+  return vmaxvq_u32(vMask.m_v) != 0;
+#else
+  const uint32x2_t vHalves = vorr_u32(vget_low_u32(vMask.m_v),
+				      vget_high_u32(vMask.m_v));
+  return vget_lane_u32(vpmax_u32(vHalves, vHalves), 0) != 0;
+#endif
+}
+
+inline Lanes lanesSelect(const LaneMask vMask,
+			 const Lanes vA,
+			 const Lanes vB) {
+  return lanes(vbslq_f32(vMask.m_v, vA.m_v, vB.m_v));
+}
+
+inline LADSPA_Data lanesSum(const Lanes vValue) {
+  return ((vgetq_lane_f32(vValue.m_v, 0) + vgetq_lane_f32(vValue.m_v, 2))
+	  + (vgetq_lane_f32(vValue.m_v, 1) + vgetq_lane_f32(vValue.m_v, 3)));
+}
+
+inline Lanes lanesGather(const LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex) {
+  float32x4_t v = vdupq_n_f32(ppfBuffers[0][lIndex]);
+  v = vsetq_lane_f32(ppfBuffers[1][lIndex], v, 1);
+  v = vsetq_lane_f32(ppfBuffers[2][lIndex], v, 2);
+  v = vsetq_lane_f32(ppfBuffers[3][lIndex], v, 3);
+  return lanes(v);
+}
+inline void lanesScatter(LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex,
+			 const Lanes vValue) {
+  vst1q_lane_f32(ppfBuffers[0] + lIndex, vValue.m_v, 0);
+  vst1q_lane_f32(ppfBuffers[1] + lIndex, vValue.m_v, 1);
+  vst1q_lane_f32(ppfBuffers[2] + lIndex, vValue.m_v, 2);
+  vst1q_lane_f32(ppfBuffers[3] + lIndex, vValue.m_v, 3);
+}
+
+inline Lanes lanesInterpolate(const LADSPA_Data * const * ppfTables,
+			      const Lanes vPosition) {
+  const int32x4_t viIndex = vcvtq_s32_f32(vPosition.m_v);
+  int aiIndex[LANE_COUNT];
+  vst1q_s32(aiIndex, viIndex);
+  float32x4_t vX0 = vdupq_n_f32(ppfTables[0][aiIndex[0]]);
+  float32x4_t vX1 = vdupq_n_f32(ppfTables[0][aiIndex[0] + 1]);
+  vX0 = vsetq_lane_f32(ppfTables[1][aiIndex[1]], vX0, 1);
+  vX1 = vsetq_lane_f32(ppfTables[1][aiIndex[1] + 1], vX1, 1);
+  vX0 = vsetq_lane_f32(ppfTables[2][aiIndex[2]], vX0, 2);
+  vX1 = vsetq_lane_f32(ppfTables[2][aiIndex[2] + 1], vX1, 2);
+  vX0 = vsetq_lane_f32(ppfTables[3][aiIndex[3]], vX0, 3);
+  vX1 = vsetq_lane_f32(ppfTables[3][aiIndex[3] + 1], vX1, 3);
+  const float32x4_t vFraction
+    = vsubq_f32(vPosition.m_v, vcvtq_f32_s32(viIndex));
+  return lanes(vmlaq_f32(vX0, vFraction, vsubq_f32(vX1, vX0)));
+}
+
+/*****************************************************************************/
+
+#else
+
+struct Lanes {
+  LADSPA_Data m_af[LANE_COUNT];
+};
+struct LaneMask {
+  bool m_ab[LANE_COUNT];
+};
+
+/* The lanes are written out one by one rather than looped over, so
+   that the compiler keeps them in registers. */
+#define CMT_LANES_EACH(STATEMENT)		\
+  { const int iLane = 0; STATEMENT; }		\
+  { const int iLane = 1; STATEMENT; }		\
+  { const int iLane = 2; STATEMENT; }		\
+  { const int iLane = 3; STATEMENT; }
+
+inline Lanes lanesSplat(const LADSPA_Data fValue) {
+  Lanes vResult = { { fValue, fValue, fValue, fValue } };
+  return vResult;
+}
+inline Lanes lanesSet(const LADSPA_Data f0,
+		      const LADSPA_Data f1,
+		      const LADSPA_Data f2,
+		      const LADSPA_Data f3) {
+  Lanes vResult = { { f0, f1, f2, f3 } };
+  return vResult;
+}
+inline Lanes lanesLoad(const LADSPA_Data * pfData) {
+  Lanes vResult = { { pfData[0], pfData[1], pfData[2], pfData[3] } };
+  return vResult;
+}
+inline void lanesStore(LADSPA_Data * pfData, const Lanes vValue) {
+  CMT_LANES_EACH(pfData[iLane] = vValue.m_af[iLane]);
+}
+
+#define CMT_LANES_OPERATION(RESULT, NAME, TYPE, EXPRESSION)	\
+inline RESULT NAME(const TYPE vA, const TYPE vB) {		\
+  RESULT vResult;						\
+  CMT_LANES_EACH(EXPRESSION);					\
+  return vResult;						\
+}
+
+CMT_LANES_OPERATION(Lanes, operator+, Lanes,
+		    vResult.m_af[iLane] = vA.m_af[iLane] + vB.m_af[iLane])
+CMT_LANES_OPERATION(Lanes, operator-, Lanes,
+		    vResult.m_af[iLane] = vA.m_af[iLane] - vB.m_af[iLane])
+CMT_LANES_OPERATION(Lanes, operator*, Lanes,
+		    vResult.m_af[iLane] = vA.m_af[iLane] * vB.m_af[iLane])
+CMT_LANES_OPERATION(Lanes, operator/, Lanes,
+		    vResult.m_af[iLane] = vA.m_af[iLane] / vB.m_af[iLane])
+CMT_LANES_OPERATION(Lanes, lanesMin, Lanes,
+		    vResult.m_af[iLane] = (vA.m_af[iLane] < vB.m_af[iLane]
+					   ? vA.m_af[iLane] : vB.m_af[iLane]))
+CMT_LANES_OPERATION(Lanes, lanesMax, Lanes,
+		    vResult.m_af[iLane] = (vA.m_af[iLane] > vB.m_af[iLane]
+					   ? vA.m_af[iLane] : vB.m_af[iLane]))
+CMT_LANES_OPERATION(LaneMask, operator<, Lanes,
+		    vResult.m_ab[iLane] = vA.m_af[iLane] < vB.m_af[iLane])
+CMT_LANES_OPERATION(LaneMask, operator>, Lanes,
+		    vResult.m_ab[iLane] = vA.m_af[iLane] > vB.m_af[iLane])
+CMT_LANES_OPERATION(LaneMask, operator>=, Lanes,
+		    vResult.m_ab[iLane] = vA.m_af[iLane] >= vB.m_af[iLane])
+CMT_LANES_OPERATION(LaneMask, operator&, LaneMask,
+		    vResult.m_ab[iLane] = vA.m_ab[iLane] && vB.m_ab[iLane])
+CMT_LANES_OPERATION(LaneMask, operator|, LaneMask,
+		    vResult.m_ab[iLane] = vA.m_ab[iLane] || vB.m_ab[iLane])
+
+#undef CMT_LANES_OPERATION
+
+inline Lanes lanesFloor(const Lanes vValue) {
+  Lanes vResult;
+  CMT_LANES_EACH(const LADSPA_Data fTruncated
+		 = LADSPA_Data(int32_t(vValue.m_af[iLane]));
+		 vResult.m_af[iLane] = (fTruncated > vValue.m_af[iLane]
+					? fTruncated - 1 : fTruncated));
+  return vResult;
+}
+
+inline Lanes lanesAbs(const Lanes vValue) {
+  Lanes vResult;
+  CMT_LANES_EACH(vResult.m_af[iLane] = std::fabs(vValue.m_af[iLane]));
+  return vResult;
+}
+inline Lanes lanesSqrt(const Lanes vValue) {
+  Lanes vResult;
+  CMT_LANES_EACH(vResult.m_af[iLane] = std::sqrt(vValue.m_af[iLane]));
+  return vResult;
+}
+
+inline Lanes lanesShiftIn(const LADSPA_Data fFirst, const Lanes vValue) {
+  Lanes vResult
+    = { { fFirst, vValue.m_af[0], vValue.m_af[1], vValue.m_af[2] } };
+  return vResult;
+}
+
+inline bool lanesAny(const LaneMask vMask) {
+  return (vMask.m_ab[0] || vMask.m_ab[1]) || (vMask.m_ab[2] || vMask.m_ab[3]);
+}
+
+inline Lanes lanesGather(const LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex) {
+  Lanes vResult;
+  CMT_LANES_EACH(vResult.m_af[iLane] = ppfBuffers[iLane][lIndex]);
+  return vResult;
+}
+inline void lanesScatter(LADSPA_Data * const * ppfBuffers,
+			 const unsigned long lIndex,
+			 const Lanes vValue) {
+  CMT_LANES_EACH(ppfBuffers[iLane][lIndex] = vValue.m_af[iLane]);
+}
+
+inline Lanes lanesSelect(const LaneMask vMask,
+			 const Lanes vA,
+			 const Lanes vB) {
+  Lanes vResult;
+  CMT_LANES_EACH(vResult.m_af[iLane]
+		 = vMask.m_ab[iLane] ? vA.m_af[iLane] : vB.m_af[iLane]);
+  return vResult;
+}
+
+inline LADSPA_Data lanesSum(const Lanes vValue) {
+  return ((vValue.m_af[0] + vValue.m_af[1])
+	  + (vValue.m_af[2] + vValue.m_af[3]));
+}
+
+inline Lanes lanesInterpolate(const LADSPA_Data * const * ppfTables,
+			      const Lanes vPosition) {
+  Lanes vResult;
+  CMT_LANES_EACH(const int iIndex = int(vPosition.m_af[iLane]);
+		 const LADSPA_Data * pfPoint = ppfTables[iLane] + iIndex;
+		 vResult.m_af[iLane]
+		 = pfPoint[0] + ((vPosition.m_af[iLane] - iIndex)
+				 * (pfPoint[1] - pfPoint[0])));
+  return vResult;
+}
+
+#undef CMT_LANES_EACH
+
+#endif
+
+/*****************************************************************************/
+
+/* Operations built from the ones above. */
+
+inline Lanes operator+(const Lanes vA, const LADSPA_Data fB) {
+  return vA + lanesSplat(fB);
+}
+inline Lanes operator-(const Lanes vA, const LADSPA_Data fB) {
+  return vA - lanesSplat(fB);
+}
+inline Lanes operator*(const Lanes vA, const LADSPA_Data fB) {
+  return vA * lanesSplat(fB);
+}
+
+/** Write the lanes as four consecutive output samples in the manner
+    of write_output() (see run_adding.h), moving pfOutput on. */
+template <OutputFunction write_output>
+inline void lanesWriteOutput(LADSPA_Data *&    pfOutput,
+			     const Lanes       vValue,
+			     const LADSPA_Data fRunAddingGain) {
+  if (is_adding<write_output>())
+    lanesStore(pfOutput, lanesLoad(pfOutput) + vValue * fRunAddingGain);
+  else
+    lanesStore(pfOutput, vValue);
+  pfOutput += LANE_COUNT;
+}
+
+/** Fractional part of each lane, in [0, 1). */
+inline Lanes lanesWrap(const Lanes vValue) {
+  return vValue - lanesFloor(vValue);
+}
+
+/** sin(2 * pi * vCycles) for any phase within the range of a 32 bit
+    integer. The phase is wrapped to [-1/2, 1/2), folded into [-1/4,
+    1/4] and a ninth-order polynomial used from there, as the
+    polyphonic sine oscillator in sine.cpp does. The error is a few
+    parts in a million. */
+inline Lanes lanesSine(const Lanes vCycles) {
+  Lanes vX = lanesWrap(vCycles + 0.5f) - 0.5f;
+  vX = lanesMin(vX, lanesSplat(0.5f) - vX);
+  vX = lanesMax(vX, lanesSplat(-0.5f) - vX);
+  const Lanes vX2 = vX * vX;
+  Lanes vY = lanesSplat(LADSPA_Data(42.0586939449));
+  vY = vY * vX2 + LADSPA_Data(-76.7058597531);
+  vY = vY * vX2 + LADSPA_Data(81.6052492761);
+  vY = vY * vX2 + LADSPA_Data(-41.3417022404);
+  vY = vY * vX2 + LADSPA_Data(6.28318530718);
+  return vY * vX;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
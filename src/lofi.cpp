@@ -26,6 +26,8 @@
 #include <cmath>
 #include <cstdlib>
 #include "cmt.h"
+#include "oversample.h"
+#include "prng.h"
 
 #define PORT_IN_LEFT     0
 #define PORT_IN_RIGHT    1
@@ -34,8 +36,14 @@
 #define PORT_CRACKLING   4
 #define PORT_OVERLOADING 5
 #define PORT_BANDWIDTH   6
+#define PORT_SEED        7
 
-#define NUM_PORTS        7
+#define NUM_PORTS        8
+
+/* The oversampled version adds: */
+#define PORT_OVERSAMPLING 8
+
+#define NUM_OVERSAMPLED_PORTS 9
 
 #ifndef PI
 #define PI 3.14159265358979
@@ -49,114 +57,115 @@
 #define MAX(x,y) ((x)>(y)?(x):(y))
 #endif
 
-class Pop
-{
-public:
-  float  x;
-  float  dx;
-  float  amp;
-  float  pwr;
-  Pop   *next;
-
-  Pop (float dx, float amp, float pwr, Pop *next);
-  ~Pop ();
-};
-
-Pop::Pop (float  _dx,
-          float  _amp,
-          float  _pwr,
-          Pop   *_next)
-  : x (0.0), dx (_dx), amp (_amp), pwr (_pwr), next (_next)
-{
-}
-
-Pop::~Pop ()
-{
-  delete next;
-}
-
+/* Maximum number of pops (crackles) that may sound at once. This is
+   far above what the 100% crackling setting produces on average; new
+   pops are discarded once it is reached. */
+#define MAX_POPS         64
 
 class Record
 {
 public:
   int  rate;
   int  amount; /* 0 -> 100% */
-  Pop *pops;
+  PRNG random;
+
+  /* Active pops, stored as parallel arrays so run() can walk them
+     without chasing pointers. Entries 0 .. num_pops - 1 are live. */
+  int   num_pops;
+  float pop_x[MAX_POPS];
+  float pop_dx[MAX_POPS];
+  float pop_amp[MAX_POPS];
+  float pop_pwr[MAX_POPS];
 
   LADSPA_Data process (LADSPA_Data sample);
   void        setAmount (int _amount);
+  void        reset ();
 
   Record (int sample_rate);
-  ~Record ();
 };
 
 Record::Record (int sample_rate)
   : rate (sample_rate),
     amount (0),
-    pops (NULL)
+    num_pops (0)
 {
 }
 
-Record::~Record ()
+static void
+record_pop_add (Record *record,
+                float   dx,
+                float   amp,
+                float   pwr)
 {
-  delete pops;
+  int i;
+
+  if (record->num_pops >= MAX_POPS)
+    return;
+
+  i = record->num_pops++;
+  record->pop_x[i] = 0.0;
+  record->pop_dx[i] = dx;
+  record->pop_amp[i] = amp;
+  record->pop_pwr[i] = pwr;
 }
 
-static Pop *
-record_pop_new (Record *record,
-                Pop    *next)
+static void
+record_pop_new (Record *record)
 {
-  return new Pop ((rand () % 1500 + 500.0) / record->rate,
-                  (rand () % 50) / 10000.0,
-                  1.0,
-                  next);
+  record_pop_add (record,
+                  (record->random.nextBelow (1500) + 500.0) / record->rate,
+                  record->random.nextBelow (50) / 10000.0,
+                  1.0);
 }
 
-static Pop *
-record_pop_loud_new (Record *record,
-                     Pop    *next)
+static void
+record_pop_loud_new (Record *record)
 {
-  return new Pop ((rand () % 500 + 2500.0) / record->rate,
-                  (rand () % 100) / 400.0 + 0.5,
-                  (rand () % 50) / 20.0,
-                  next);
+  record_pop_add (record,
+                  (record->random.nextBelow (500) + 2500.0) / record->rate,
+                  record->random.nextBelow (100) / 400.0 + 0.5,
+                  record->random.nextBelow (50) / 20.0);
 }
 
 LADSPA_Data
 Record::process (LADSPA_Data sample)
 {
-  Pop *pop;
-  Pop **pop_prev;
+  int i;
 
   /* Add some crackle */
-  if (rand () % rate < rate * amount / 4000)
-    pops = record_pop_new (this, pops);
+  if ((int) random.nextBelow (rate) < rate * amount / 4000)
+    record_pop_new (this);
 
   /* Add some loud pops */
-  if (rand () % (rate * 10) < rate * amount / 400000)
-    pops = record_pop_loud_new (this, pops);
+  if ((int) random.nextBelow (rate * 10) < rate * amount / 400000)
+    record_pop_loud_new (this);
 
-  /* Compute pops */
-  pop_prev = &pops;
-  pop = *pop_prev;
-  while (pop != NULL)
+  /* Compute pops. A finished pop is replaced by the last live one. */
+  i = 0;
+  while (i < num_pops)
     {
-      if (pop->x >= 0.5)
-        sample += (pow ((1.0 - pop->x) * 2.0, pop->pwr) - 0.5) * pop->amp;
-      else
-        sample += (pow (pop->x * 2.0, pop->pwr) - 0.5) * pop->amp;
+      float x = pop_x[i];
+      float y = (x >= 0.5) ? (1.0 - x) * 2.0 : x * 2.0;
+
+      /* Ordinary crackles have unit power, so avoid pow () for them. */
+      if (pop_pwr[i] != 1.0)
+        y = pow (y, pop_pwr[i]);
+      sample += (y - 0.5) * pop_amp[i];
 
-      pop->x += pop->dx;
-      if (pop->x > 1.0)
+      x += pop_dx[i];
+      if (x > 1.0)
         {
-          *pop_prev = pop->next;
-          pop->next = NULL;
-          delete pop;
+          num_pops--;
+          pop_x[i] = pop_x[num_pops];
+          pop_dx[i] = pop_dx[num_pops];
+          pop_amp[i] = pop_amp[num_pops];
+          pop_pwr[i] = pop_pwr[num_pops];
         }
       else
-        pop_prev = &pop->next;
-
-      pop = *pop_prev;
+        {
+          pop_x[i] = x;
+          i++;
+        }
     }
 
   return sample;
@@ -168,6 +177,12 @@ Record::setAmount (int _amount)
   amount = _amount;
 }
 
+void
+Record::reset ()
+{
+  num_pops = 0;
+}
+
 
 class Compressor
 {
@@ -270,23 +285,40 @@ BandwidthLimit::setFreq (float freq)
 }
 
 
+/* Buffers for the oversampled version, which runs only the distortion
+   at the higher rate. */
+class LoFiOversampling
+{
+public:
+  Oversampler oversampler_l;
+  Oversampler oversampler_r;
+  LADSPA_Data in_l[OVERSAMPLE_CHUNK];
+  LADSPA_Data in_r[OVERSAMPLE_CHUNK];
+  LADSPA_Data buffer_l[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+  LADSPA_Data buffer_r[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+};
+
+
 class LoFi : public CMT_PluginInstance {
-  Record         *record;
-  Compressor     *compressor;
-  BandwidthLimit *bandwidth_l;
-  BandwidthLimit *bandwidth_r;
+  Record           *record;
+  Compressor       *compressor;
+  BandwidthLimit   *bandwidth_l;
+  BandwidthLimit   *bandwidth_r;
+  LoFiOversampling *oversampling;
 
 public:
-  LoFi(const LADSPA_Descriptor *,
+  LoFi(const LADSPA_Descriptor * Descriptor,
        unsigned long s_rate)
-    : CMT_PluginInstance (NUM_PORTS),
+    : CMT_PluginInstance (Descriptor->PortCount),
       record (new Record (s_rate * 2)),
       compressor (new Compressor (s_rate * 2, 1.6)),
       bandwidth_l (new BandwidthLimit (s_rate, 8000.0)),
-      bandwidth_r (new BandwidthLimit (s_rate, 8000.0)) {
+      bandwidth_r (new BandwidthLimit (s_rate, 8000.0)),
+      oversampling (Descriptor->PortCount > NUM_PORTS ? new LoFiOversampling : NULL) {
   }
 
   ~LoFi() {
+    delete oversampling;
     delete bandwidth_l;
     delete bandwidth_r;
     delete compressor;
@@ -301,13 +333,18 @@ public:
     lofi->bandwidth_r->setFreq (8000);
     lofi->compressor->setClamp (1.6);
     lofi->record->setAmount (0);
+    lofi->record->reset ();
+    lofi->record->random.resetSeedPort ();
+
+    if (lofi->oversampling)
+      {
+        lofi->oversampling->oversampler_l.reset ();
+        lofi->oversampling->oversampler_r.reset ();
+      }
   }
 
   static void
-  run(LADSPA_Handle Instance,
-      unsigned long SampleCount) {
-    LoFi *lofi = (LoFi*) Instance;
-    unsigned long   i;
+  follow_ports(LoFi *lofi) {
     LADSPA_Data   **ports = lofi->m_ppfPorts;
     LADSPA_Data     clamp;
 
@@ -322,6 +359,17 @@ public:
     lofi->compressor->setClamp (clamp);
 
     lofi->record->setAmount ((int) ports[PORT_CRACKLING][0]);
+    lofi->record->random.followSeedPort (ports[PORT_SEED][0]);
+  }
+
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+    LoFi *lofi = (LoFi*) Instance;
+    unsigned long   i;
+    LADSPA_Data   **ports = lofi->m_ppfPorts;
+
+    follow_ports (lofi);
 
     for (i = 0; i < SampleCount; i++)
       {
@@ -343,6 +391,59 @@ public:
         ports[PORT_OUT_RIGHT][i] = sample_r;
       }
   }
+
+  /* As run (), but with the distortion oversampled. The stages before
+     and after it run over each chunk in turn rather than sample by
+     sample, which gives the same result as they do not depend on each
+     other. */
+  static void
+  run_oversampled(LADSPA_Handle Instance,
+                  unsigned long SampleCount) {
+    LoFi *lofi = (LoFi*) Instance;
+    LoFiOversampling *os = lofi->oversampling;
+    unsigned long   i, start, count, os_count;
+    LADSPA_Data   **ports = lofi->m_ppfPorts;
+
+    follow_ports (lofi);
+
+    os->oversampler_l.setFactor (ports[PORT_OVERSAMPLING][0]);
+    os->oversampler_r.setFactor (ports[PORT_OVERSAMPLING][0]);
+
+    for (start = 0; start < SampleCount; start += count)
+      {
+        count = MIN (SampleCount - start, OVERSAMPLE_CHUNK);
+        os_count = count * os->oversampler_l.getFactor ();
+
+        for (i = 0; i < count; i++)
+          {
+            LADSPA_Data sample_l, sample_r;
+
+            sample_l = ports[PORT_IN_LEFT][start + i];
+            sample_r = ports[PORT_IN_RIGHT][start + i];
+
+            sample_l = lofi->compressor->process (sample_l);
+            sample_r = lofi->compressor->process (sample_r);
+            os->in_l[i] = lofi->bandwidth_l->process (sample_l);
+            os->in_r[i] = lofi->bandwidth_r->process (sample_r);
+          }
+
+        os->oversampler_l.upsample (os->in_l, os->buffer_l, count);
+        os->oversampler_r.upsample (os->in_r, os->buffer_r, count);
+        for (i = 0; i < os_count; i++)
+          {
+            os->buffer_l[i] = distort (os->buffer_l[i]);
+            os->buffer_r[i] = distort (os->buffer_r[i]);
+          }
+        os->oversampler_l.downsample (os->buffer_l, os->in_l, count);
+        os->oversampler_r.downsample (os->buffer_r, os->in_r, count);
+
+        for (i = 0; i < count; i++)
+          {
+            ports[PORT_OUT_LEFT][start + i] = lofi->record->process (os->in_l[i]);
+            ports[PORT_OUT_RIGHT][start + i] = lofi->record->process (os->in_r[i]);
+          }
+      }
+  }
 };
 
 
@@ -354,6 +455,8 @@ static LADSPA_PortDescriptor g_psPortDescriptors[] =
   LADSPA_PORT_AUDIO | LADSPA_PORT_OUTPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT
 };
 
@@ -367,7 +470,9 @@ static const char * const g_psPortNames[] =
 
   "Crackling (%)",
   "Powersupply Overloading (%)",
-  "Opamp Bandwidth Limiting (Hz)"
+  "Opamp Bandwidth Limiting (Hz)",
+  PRNG_SEED_PORT_NAME,
+  OVERSAMPLE_PORT_NAME
 };
 
 static LADSPA_PortRangeHint g_psPortRangeHints[] =
@@ -380,7 +485,9 @@ static LADSPA_PortRangeHint g_psPortRangeHints[] =
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW |
     LADSPA_HINT_INTEGER, -0.1, 100.1 },
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 100.0 },
-  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 1.0, 10000.0 }
+  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 1.0, 10000.0 },
+  { PRNG_SEED_PORT_HINTS, 0.0, 0.0 },
+  { OVERSAMPLE_PORT_HINTS, 1.0, OVERSAMPLE_MAX_FACTOR }
 };
 
 void
@@ -390,7 +497,7 @@ initialise_lofi() {
   psDescriptor = new CMT_Descriptor
       (1227,
        "lofi",
-       0 /* Sorry, this module is not RT capable, run() calls malloc() */,
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
        "Lo Fi",
        CMT_MAKER("David A. Bartold"),
        CMT_COPYRIGHT("2001", "David A. Bartold"),
@@ -411,4 +518,29 @@ initialise_lofi() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2002,
+       "lofi_os",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Lo Fi (Oversampled)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("2001", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<LoFi>,
+       LoFi::activate,
+       LoFi::run_oversampled,
+       NULL,
+       NULL,
+       NULL);
+
+  for (int i = 0; i < NUM_OVERSAMPLED_PORTS; i++)
+    psDescriptor->addPort(
+      g_psPortDescriptors[i],
+      g_psPortNames[i],
+      g_psPortRangeHints[i].HintDescriptor,
+      g_psPortRangeHints[i].LowerBound,
+      g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
 }
@@ -20,12 +20,15 @@
 
 /*****************************************************************************/
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "dispatch.h"
+#include "run_adding.h"
 
 /*****************************************************************************/
 
@@ -35,18 +38,29 @@
 #define MIXER_INPUT2 1
 #define MIXER_OUTPUT 2
 
+static void setSimpleMixerRunAddingGain(LADSPA_Handle Instance,
+					LADSPA_Data Gain);
+template <OutputFunction write_output>
 static void runSimpleMixer(LADSPA_Handle Instance,
                            unsigned long SampleCount);
 
 /** This plugin adds two signals together to produce a third. */
 class SimpleMixer : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_fRunAddingGain;
+
 public:
 
   SimpleMixer(const LADSPA_Descriptor *,
 	      unsigned long)
-    : CMT_PluginInstance(3) {
+    : CMT_PluginInstance(3),
+      m_fRunAddingGain(1) {
   }
 
+  friend void setSimpleMixerRunAddingGain(LADSPA_Handle Instance,
+					  LADSPA_Data Gain);
+  template <OutputFunction write_output>
   friend void runSimpleMixer(LADSPA_Handle Instance,
 			     unsigned long SampleCount);
 
@@ -54,6 +68,15 @@ public:
 
 /*****************************************************************************/
 
+static void
+setSimpleMixerRunAddingGain(LADSPA_Handle Instance,
+			    LADSPA_Data Gain) {
+  ((SimpleMixer *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+template <OutputFunction write_output>
 static void 
 runSimpleMixer(LADSPA_Handle Instance,
 	       unsigned long SampleCount) {
@@ -67,7 +90,181 @@ runSimpleMixer(LADSPA_Handle Instance,
   for (unsigned long lSampleIndex = 0; 
        lSampleIndex < SampleCount; 
        lSampleIndex++) 
-    *(pfOutput++) = *(pfInput1++) + *(pfInput2++);
+    write_output(pfOutput, 
+		 *(pfInput1++) + *(pfInput2++), 
+		 poMixer->m_fRunAddingGain);
+}
+
+/*****************************************************************************/
+
+/* Matrix mixers. These mix a number of inputs into one or more
+   outputs in one pass, with a gain for each input on each output. The
+   ports are the audio inputs, then the audio outputs, then the gains
+   for each input in turn (one for each output). Gain changes are
+   ramped linearly across each block. */
+
+#define MM_MAX_INPUTS  32
+#define MM_MAX_OUTPUTS 8
+
+#define MM_INPUT(lInput)                         (lInput)
+#define MM_OUTPUT(lInputCount, lOutput)          ((lInputCount) + (lOutput))
+#define MM_GAIN(lInputCount, lOutputCount, lInput, lOutput)	\
+  ((lInputCount) + (lOutputCount)				\
+   + (lInput) * (lOutputCount) + (lOutput))
+
+/** Samples mixed at once. The inputs for a tile are mixed into every
+    output before moving on, so with the largest mixer they are read
+    from the L1 cache after the first output. */
+#define MM_TILE 64
+
+static void activateMatrixMixer(LADSPA_Handle Instance);
+static void setMatrixMixerRunAddingGain(LADSPA_Handle Instance,
+					LADSPA_Data Gain);
+template <long lInputCount, long lOutputCount, OutputFunction write_output>
+static void runMatrixMixer(LADSPA_Handle Instance,
+			   unsigned long SampleCount);
+
+/** This plugin mixes up to MM_MAX_INPUTS signals into up to
+    MM_MAX_OUTPUTS. */
+class MatrixMixer : public CMT_PluginInstance {
+private:
+
+  /** Gain reached at the end of the last block for each input on
+      each output, ordered as the gain ports. */
+  LADSPA_Data m_afGain[MM_MAX_INPUTS * MM_MAX_OUTPUTS];
+  bool m_bGainsSet;
+
+  LADSPA_Data m_fRunAddingGain;
+
+  /** Used in place of the outputs when an output shares its buffer
+      with an input. */
+  LADSPA_Data m_aafMix[MM_MAX_OUTPUTS][MM_TILE];
+
+public:
+
+  MatrixMixer(const LADSPA_Descriptor * psDescriptor,
+	      unsigned long)
+    : CMT_PluginInstance(psDescriptor->PortCount),
+      m_bGainsSet(false),
+      m_fRunAddingGain(1) {
+  }
+
+  friend void activateMatrixMixer(LADSPA_Handle Instance);
+  friend void setMatrixMixerRunAddingGain(LADSPA_Handle Instance,
+					  LADSPA_Data Gain);
+  template <long lInputCount, long lOutputCount, OutputFunction write_output>
+  friend void runMatrixMixer(LADSPA_Handle Instance,
+			     unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void
+activateMatrixMixer(LADSPA_Handle Instance) {
+  ((MatrixMixer *)Instance)->m_bGainsSet = false;
+}
+
+/*****************************************************************************/
+
+static void
+setMatrixMixerRunAddingGain(LADSPA_Handle Instance,
+			    LADSPA_Data Gain) {
+  ((MatrixMixer *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/** Run a matrix mixer. The mixGainRamps() kernel accumulates all the
+    inputs for each output, working through the block in tiles of
+    MM_TILE samples. The first block after activation starts at its
+    gains rather than ramping to them. */
+template <long lInputCount, long lOutputCount, OutputFunction write_output>
+static void 
+runMatrixMixer(LADSPA_Handle Instance,
+	       unsigned long SampleCount) {
+
+  MatrixMixer * poMixer = (MatrixMixer *)Instance;
+  LADSPA_Data ** ppfPorts = poMixer->m_ppfPorts;
+
+  long lInput, lOutput;
+
+  /* Gains and steps are gathered by output so the kernel can read
+     them contiguously. The run_adding gain is folded in. */
+  const LADSPA_Data fOutputGain 
+    = get_gain<write_output>(poMixer->m_fRunAddingGain);
+  const LADSPA_Data fRampScalar = SampleCount > 0 ? 1.0f / SampleCount : 0;
+  LADSPA_Data aafGain[lOutputCount][lInputCount];
+  LADSPA_Data aafGainStep[lOutputCount][lInputCount];
+  for (lInput = 0; lInput < lInputCount; lInput++)
+    for (lOutput = 0; lOutput < lOutputCount; lOutput++) {
+      const long lGain = lInput * lOutputCount + lOutput;
+      const LADSPA_Data fTarget 
+	= *(ppfPorts[MM_GAIN(lInputCount, lOutputCount, lInput, lOutput)]);
+      if (!poMixer->m_bGainsSet)
+	poMixer->m_afGain[lGain] = fTarget;
+      aafGain[lOutput][lInput] = poMixer->m_afGain[lGain] * fOutputGain;
+      aafGainStep[lOutput][lInput] 
+	= (fTarget - poMixer->m_afGain[lGain]) * fRampScalar * fOutputGain;
+      poMixer->m_afGain[lGain] = fTarget;
+    }
+  poMixer->m_bGainsSet = true;
+
+  const LADSPA_Data * apfInputs[lInputCount];
+  for (lInput = 0; lInput < lInputCount; lInput++)
+    apfInputs[lInput] = ppfPorts[MM_INPUT(lInput)];
+
+  /* The kernel writes each output directly unless the host has
+     placed it over an input, in which case the tile is mixed aside
+     and copied once all the outputs have read their inputs. */
+  LADSPA_Data * apfOutputs[lOutputCount];
+  bool bInPlace = false;
+  for (lOutput = 0; lOutput < lOutputCount; lOutput++) {
+    apfOutputs[lOutput] = ppfPorts[MM_OUTPUT(lInputCount, lOutput)];
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      if (apfOutputs[lOutput] == apfInputs[lInput])
+	bInPlace = true;
+  }
+
+  for (unsigned long lTileStart = 0;
+       lTileStart < SampleCount;
+       lTileStart += MM_TILE) {
+
+    const unsigned long lTileSize 
+      = (SampleCount - lTileStart < MM_TILE 
+	 ? SampleCount - lTileStart 
+	 : MM_TILE);
+
+    for (lOutput = 0; lOutput < lOutputCount; lOutput++)
+      if (bInPlace)
+	dispatchMixGainRamps(poMixer->m_aafMix[lOutput],
+			     apfInputs,
+			     aafGain[lOutput],
+			     aafGainStep[lOutput],
+			     lInputCount,
+			     lTileSize);
+      else
+	dispatchMixGainRamps<is_adding<write_output>()>
+	  (apfOutputs[lOutput] + lTileStart,
+	   apfInputs,
+	   aafGain[lOutput],
+	   aafGainStep[lOutput],
+	   lInputCount,
+	   lTileSize);
+
+    if (bInPlace)
+      for (lOutput = 0; lOutput < lOutputCount; lOutput++) {
+	LADSPA_Data * pfOutput = apfOutputs[lOutput] + lTileStart;
+	for (unsigned long lIndex = 0; lIndex < lTileSize; lIndex++)
+	  write_output(pfOutput, poMixer->m_aafMix[lOutput][lIndex], 1.0f);
+      }
+
+    for (lInput = 0; lInput < lInputCount; lInput++)
+      apfInputs[lInput] += lTileSize;
+    for (lOutput = 0; lOutput < lOutputCount; lOutput++)
+      for (lInput = 0; lInput < lInputCount; lInput++)
+	aafGain[lOutput][lInput] += lTileSize * aafGainStep[lOutput][lInput];
+  }
 }
 
 /*****************************************************************************/
@@ -87,9 +284,9 @@ initialise_mixer() {
      NULL,
      CMT_Instantiate<SimpleMixer>,
      NULL,
-     runSimpleMixer,
-     NULL,
-     NULL,
+     runSimpleMixer<write_output_normal>,
+     runSimpleMixer<write_output_adding>,
+     setSimpleMixerRunAddingGain,
      NULL);
   psDescriptor->addPort
     (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
@@ -101,6 +298,106 @@ initialise_mixer() {
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");
   registerNewPluginDescriptor(psDescriptor);
+
+  const long alInputCounts[4] = { 4, 8, 16, 32 };
+  const long alOutputCounts[3] = { 1, 2, 8 };
+  LADSPA_Run_Function aafMatrixRunFunctions[4][3] = {
+    { runMatrixMixer<4, 1, write_output_normal>,
+      runMatrixMixer<4, 2, write_output_normal>,
+      runMatrixMixer<4, 8, write_output_normal> },
+    { runMatrixMixer<8, 1, write_output_normal>,
+      runMatrixMixer<8, 2, write_output_normal>,
+      runMatrixMixer<8, 8, write_output_normal> },
+    { runMatrixMixer<16, 1, write_output_normal>,
+      runMatrixMixer<16, 2, write_output_normal>,
+      runMatrixMixer<16, 8, write_output_normal> },
+    { runMatrixMixer<32, 1, write_output_normal>,
+      runMatrixMixer<32, 2, write_output_normal>,
+      runMatrixMixer<32, 8, write_output_normal> }
+  };
+  LADSPA_Run_Adding_Function aafMatrixRunAddingFunctions[4][3] = {
+    { runMatrixMixer<4, 1, write_output_adding>,
+      runMatrixMixer<4, 2, write_output_adding>,
+      runMatrixMixer<4, 8, write_output_adding> },
+    { runMatrixMixer<8, 1, write_output_adding>,
+      runMatrixMixer<8, 2, write_output_adding>,
+      runMatrixMixer<8, 8, write_output_adding> },
+    { runMatrixMixer<16, 1, write_output_adding>,
+      runMatrixMixer<16, 2, write_output_adding>,
+      runMatrixMixer<16, 8, write_output_adding> },
+    { runMatrixMixer<32, 1, write_output_adding>,
+      runMatrixMixer<32, 2, write_output_adding>,
+      runMatrixMixer<32, 8, write_output_adding> }
+  };
+
+  for (long lInputIndex = 0; lInputIndex < 4; lInputIndex++)
+    for (long lOutputIndex = 0; lOutputIndex < 3; lOutputIndex++) {
+
+      const long lInputCount = alInputCounts[lInputIndex];
+      const long lOutputCount = alOutputCounts[lOutputIndex];
+
+      char acLabel[40];
+      char acName[100];
+      sprintf(acLabel, "mixer_%ldx%ld", lInputCount, lOutputCount);
+      sprintf(acName,
+	      "Matrix Mixer (%ld Inputs to %ld Output%s)",
+	      lInputCount,
+	      lOutputCount,
+	      lOutputCount > 1 ? "s" : "");
+
+      psDescriptor = new CMT_Descriptor
+	(2005 + lInputIndex * 3 + lOutputIndex,
+	 acLabel,
+	 LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	 acName,
+	 CMT_MAKER("Richard W.E. Furse"),
+	 CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+	 NULL,
+	 CMT_Instantiate<MatrixMixer>,
+	 activateMatrixMixer,
+	 aafMatrixRunFunctions[lInputIndex][lOutputIndex],
+	 aafMatrixRunAddingFunctions[lInputIndex][lOutputIndex],
+	 setMatrixMixerRunAddingGain,
+	 NULL);
+
+      char acPortName[100];
+      long lInput, lOutput;
+      for (lInput = 0; lInput < lInputCount; lInput++) {
+	sprintf(acPortName, "Input %ld", lInput + 1);
+	psDescriptor->addPort
+	  (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (lOutput = 0; lOutput < lOutputCount; lOutput++) {
+	if (lOutputCount > 1)
+	  sprintf(acPortName, "Output %ld", lOutput + 1);
+	else
+	  sprintf(acPortName, "Output");
+	psDescriptor->addPort
+	  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+	   acPortName);
+      }
+      for (lInput = 0; lInput < lInputCount; lInput++)
+	for (lOutput = 0; lOutput < lOutputCount; lOutput++) {
+	  if (lOutputCount > 1)
+	    sprintf(acPortName, 
+		    "Gain (Input %ld to Output %ld)", 
+		    lInput + 1, 
+		    lOutput + 1);
+	  else
+	    sprintf(acPortName, "Gain (Input %ld)", lInput + 1);
+	  psDescriptor->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     acPortName,
+	     (LADSPA_HINT_BOUNDED_BELOW 
+	      | LADSPA_HINT_LOGARITHMIC
+	      | LADSPA_HINT_DEFAULT_1),
+	     0,
+	     0);
+	}
+
+      registerNewPluginDescriptor(psDescriptor);
+    }
 }
 
 /*****************************************************************************/
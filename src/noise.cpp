@@ -25,6 +25,7 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "prng.h"
 
 /*****************************************************************************/
 
@@ -32,7 +33,9 @@
 
 #define NOISE_AMPLITUDE 0
 #define NOISE_OUTPUT    1
+#define NOISE_SEED      2
 
+static void activateWhiteNoise(LADSPA_Handle Instance);
 static void runWhiteNoise(LADSPA_Handle Instance,
                           unsigned long SampleCount);
 static void runWhiteNoiseAdding(LADSPA_Handle Instance,
@@ -40,20 +43,24 @@ static void runWhiteNoiseAdding(LADSPA_Handle Instance,
 static void setWhiteNoiseRunAddingGain(LADSPA_Handle Instance,
                                        LADSPA_Data   Gain);
 
-/** Plugin that provides white noise output. This is provided by
-    calling rand() repeatedly. */
+/** Plugin that provides white noise output. This is provided by a
+    per-instance pseudo-random number generator. */
 class WhiteNoise : public CMT_PluginInstance {
 private:
 
   LADSPA_Data m_fRunAddingGain;
 
+  PRNG m_oRandom;
+
 public:
 
   WhiteNoise(const LADSPA_Descriptor *,
 	      unsigned long)
-    : CMT_PluginInstance(2) {
+    : CMT_PluginInstance(3),
+      m_fRunAddingGain(1) {
   }
 
+  friend void activateWhiteNoise(LADSPA_Handle Instance);
   friend void runWhiteNoise(LADSPA_Handle Instance,
 			    unsigned long SampleCount);
   friend void runWhiteNoiseAdding(LADSPA_Handle Instance,
@@ -65,6 +72,13 @@ public:
 
 /*****************************************************************************/
 
+static void
+activateWhiteNoise(LADSPA_Handle Instance) {
+  ((WhiteNoise *)Instance)->m_oRandom.resetSeedPort();
+}
+
+/*****************************************************************************/
+
 static void 
 runWhiteNoise(LADSPA_Handle Instance,
 	      unsigned long SampleCount) {
@@ -72,14 +86,11 @@ runWhiteNoise(LADSPA_Handle Instance,
   WhiteNoise * poNoise = (WhiteNoise *)Instance;
 
   LADSPA_Data fAmplitude = *(poNoise->m_ppfPorts[NOISE_AMPLITUDE]);
-  LADSPA_Data fScalar = fAmplitude * LADSPA_Data(2.0 / RAND_MAX);
 
   LADSPA_Data * pfOutput = poNoise->m_ppfPorts[NOISE_OUTPUT];
 
-  for (unsigned long lSampleIndex = 0; 
-       lSampleIndex < SampleCount; 
-       lSampleIndex++) 
-    *(pfOutput++) = rand() * fScalar - fAmplitude;
+  poNoise->m_oRandom.followSeedPort(*(poNoise->m_ppfPorts[NOISE_SEED]));
+  poNoise->m_oRandom.fillBipolar(pfOutput, SampleCount, fAmplitude);
 }
 
 static void 
@@ -90,21 +101,19 @@ runWhiteNoiseAdding(LADSPA_Handle Instance,
 
   LADSPA_Data fAmplitude
     = *(poNoise->m_ppfPorts[NOISE_AMPLITUDE]);
-  LADSPA_Data fScalar
-    = poNoise->m_fRunAddingGain * fAmplitude * LADSPA_Data(2.0 / RAND_MAX);
 
   LADSPA_Data * pfOutput = poNoise->m_ppfPorts[NOISE_OUTPUT];
 
-  for (unsigned long lSampleIndex = 0; 
-       lSampleIndex < SampleCount; 
-       lSampleIndex++) 
-    *(pfOutput++) += rand() * fScalar - fAmplitude;
-
+  poNoise->m_oRandom.followSeedPort(*(poNoise->m_ppfPorts[NOISE_SEED]));
+  poNoise->m_oRandom.addBipolar(pfOutput, 
+				SampleCount, 
+				poNoise->m_fRunAddingGain * fAmplitude);
 }
 
 static void 
 setWhiteNoiseRunAddingGain(LADSPA_Handle Instance,
 			   LADSPA_Data   Gain) {
+  ((WhiteNoise *)Instance)->m_fRunAddingGain = Gain;
 }
 
 /*****************************************************************************/
@@ -123,7 +132,7 @@ initialise_noise() {
      CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
      NULL,
      CMT_Instantiate<WhiteNoise>,
-     NULL,
+     activateWhiteNoise,
      runWhiteNoise,
      runWhiteNoiseAdding,
      setWhiteNoiseRunAddingGain,
@@ -139,6 +148,12 @@ initialise_noise() {
   psDescriptor->addPort
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     PRNG_SEED_PORT_NAME,
+     PRNG_SEED_PORT_HINTS,
+     0,
+     0);
   registerNewPluginDescriptor(psDescriptor);
 }
 
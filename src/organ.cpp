@@ -24,8 +24,12 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include "cmt.h"
+#include "gate.h"
+#include "voices.h"
+#include "wavetable.h"
 
 #define PORT_OUT         0
 #define PORT_GATE        1
@@ -51,11 +55,7 @@
 
 #define NUM_PORTS       21
 
-#define RESOLUTION   16384
-
-#ifndef PI
-#define PI 3.14159265358979
-#endif
+#define NUM_HARMONICS    6
 
 typedef struct Envelope
 {
@@ -65,10 +65,22 @@ typedef struct Envelope
   Envelope () : envelope_decay (0), envelope (0.0) {}
 } Envelope;
 
-static LADSPA_Data *g_sine_table;
-static LADSPA_Data *g_triangle_table;
-static LADSPA_Data *g_pulse_table;
-static int          ref_count;
+/* Pitch of each harmonic relative to the fundamental, with and
+   without the brass switch. */
+static const LADSPA_Data g_brass_ratios[NUM_HARMONICS] =
+  { 0.5F, 1.0F, 2.0F, 4.0F, 8.0F, 16.0F };
+static const LADSPA_Data g_normal_ratios[NUM_HARMONICS] =
+  { 0.5F, 1.0F, 1.5F, 2.0F, 3.0F, 4.0F };
+
+/* Which harmonics use the reed and flute waveforms. */
+#define TONE_SINE        0
+#define TONE_REED        1
+#define TONE_FLUTE       2
+
+static const int g_brass_tones[NUM_HARMONICS] =
+  { TONE_SINE, TONE_SINE, TONE_REED, TONE_SINE, TONE_FLUTE, TONE_FLUTE };
+static const int g_normal_tones[NUM_HARMONICS] =
+  { TONE_SINE, TONE_SINE, TONE_SINE, TONE_REED, TONE_SINE, TONE_FLUTE };
 
 class Organ : CMT_PluginInstance
 {
@@ -77,74 +89,40 @@ class Organ : CMT_PluginInstance
   Envelope env0;
   Envelope env1;
 
-  unsigned long harm0_accum;
-  unsigned long harm1_accum;
-  unsigned long harm2_accum;
-  unsigned long harm3_accum;
-  unsigned long harm4_accum;
-  unsigned long harm5_accum;
+  /* Phase accumulators, in the form used by wavetable.h. */
+  unsigned long harm_accum[NUM_HARMONICS];
+
+  /* The shared band-limited tables. The reed is a square wave and the
+     flute a triangle wave. */
+  const Wavetable *sine_table;
+  const Wavetable *reed_table;
+  const Wavetable *flute_table;
 
   public:
 
   Organ(const LADSPA_Descriptor * Descriptor,
         unsigned long             SampleRate)
     : CMT_PluginInstance(NUM_PORTS),
-      sample_rate(SampleRate),
-      harm0_accum(0), harm1_accum(0),
-      harm2_accum(0), harm3_accum(0),
-      harm4_accum(0), harm5_accum(0) {
-    if (ref_count++ == 0)
-      {
-        int size = RESOLUTION;
-        int half = size / 2;
-        int slope = size / 10;
-        int i;
-
-        /* Initialize sine table. */
-        g_sine_table = new LADSPA_Data[size];
-        for (i = 0; i < size; i++)
-          g_sine_table[i] = sin ((i * 2.0 * PI) / size) / 6.0;
-  
-        /* Initialize triangle table. */
-        g_triangle_table = new LADSPA_Data[size];
-        for (i = 0; i < half; i++)
-          g_triangle_table[i] = (4.0 / size * i - 1.0) / 6.0;
-        for (; i < size; i++)
-          g_triangle_table[i] = (4.0 / size * (size - i) - 1.0) / 6.0;
-  
-        /* Initialize pulse table. */
-        g_pulse_table = new LADSPA_Data[size];
-        for (i = 0; i < slope; i++)
-          g_pulse_table[i] = ((double) -i) / slope / 6.0;
-        for (; i < half - slope; i++)
-          g_pulse_table[i] = -1.0 / 6.0;
-        for (; i < half + slope; i++)
-          g_pulse_table[i] = ((double) i - half) / slope / 6.0;
-        for (; i < size - slope; i++)
-          g_pulse_table[i] = 1.0 / 6.0;
-        for (; i < size; i++)
-          g_pulse_table[i] = ((double) size - i) / slope / 6.0;
-      }
+      sample_rate(SampleRate) {
+    for (int h = 0; h < NUM_HARMONICS; h++)
+      harm_accum[h] = 0;
+    sine_table = acquireWavetable (WAVEFORM_SINE);
+    reed_table = acquireWavetable (WAVEFORM_SQUARE);
+    flute_table = acquireWavetable (WAVEFORM_TRIANGLE);
   }
 
   ~Organ () {
-    if (--ref_count == 0)
-      {
-        delete[] g_pulse_table;
-        delete[] g_triangle_table;
-        delete[] g_sine_table;
-      }
+    releaseWavetable (WAVEFORM_TRIANGLE);
+    releaseWavetable (WAVEFORM_SQUARE);
+    releaseWavetable (WAVEFORM_SINE);
   }
 
   static inline LADSPA_Data
-  table_pos (LADSPA_Data   *table,
-             unsigned long  freq_256,
-             unsigned long *accum) {
-    *accum += freq_256;
-    while (*accum >= RESOLUTION * 256)
-      *accum -= RESOLUTION * 256;
-  
-    return table[*accum >> 8];
+  table_pos (const LADSPA_Data *table,
+             unsigned long      step,
+             unsigned long     *accum) {
+    *accum += step;
+    return readWavetable (table, *accum);
   }
 
   static inline LADSPA_Data
@@ -184,12 +162,8 @@ class Organ : CMT_PluginInstance
     organ->env0.envelope = 0.0;
     organ->env1.envelope_decay = 0;
     organ->env1.envelope = 0.0;
-    organ->harm0_accum = 0;
-    organ->harm1_accum = 0;
-    organ->harm2_accum = 0;
-    organ->harm3_accum = 0;
-    organ->harm4_accum = 0;
-    organ->harm5_accum = 0;
+    for (int h = 0; h < NUM_HARMONICS; h++)
+      organ->harm_accum[h] = 0;
   }
 
   static void
@@ -197,19 +171,20 @@ class Organ : CMT_PluginInstance
       unsigned long SampleCount) {
   Organ *organ = (Organ*) Instance;
   unsigned long i;
+  int h;
   LADSPA_Data **ports;
-  LADSPA_Data *sine_table;
-  LADSPA_Data *reed_table;
-  LADSPA_Data *flute_table;
-  unsigned long freq_256;
-  unsigned long freq_256_harm0, freq_256_harm1;
-  unsigned long freq_256_harm2, freq_256_harm3;
-  unsigned long freq_256_harm4, freq_256_harm5;
+  const LADSPA_Data *ratios;
+  const int *tones;
+  const LADSPA_Data *table[NUM_HARMONICS];
+  unsigned long step[NUM_HARMONICS];
+  LADSPA_Data level[NUM_HARMONICS];
+  unsigned long *accum;
   double attack0, decay0, release0;
   double attack1, decay1, release1;
   int gate;
 
   ports = organ->m_ppfPorts;
+  accum = organ->harm_accum;
 
   gate = (*ports[PORT_GATE] > 0.0);
   if (gate == 0)
@@ -218,15 +193,43 @@ class Organ : CMT_PluginInstance
       organ->env1.envelope_decay = 0;
     }
 
-  sine_table = g_sine_table;
-  reed_table = (*ports[PORT_REED] > 0.0) ? g_pulse_table : sine_table;
-  flute_table = (*ports[PORT_FLUTE] > 0.0) ? g_triangle_table : sine_table;
-  freq_256 = (int) (*ports[PORT_FREQ] *
-                    ((double) RESOLUTION) /
-                    organ->sample_rate * 256.0);
+  if (*ports[PORT_BRASS] > 0.0)
+    {
+      ratios = g_brass_ratios;
+      tones = g_brass_tones;
+    }
+  else
+    {
+      ratios = g_normal_ratios;
+      tones = g_normal_tones;
+    }
 
-  freq_256_harm0 = freq_256 / 2;
-  freq_256_harm1 = freq_256;
+  /* Pick the table level for each harmonic from its pitch. Harmonics
+     at or above the Nyquist frequency are silenced rather than
+     allowed to alias. The 1/6 keeps the sum of the six harmonics
+     within range. */
+  for (h = 0; h < NUM_HARMONICS; h++)
+    {
+      LADSPA_Data cycles = *ports[PORT_FREQ] * ratios[h] / organ->sample_rate;
+      const Wavetable *wavetable = organ->sine_table;
+
+      if (tones[h] == TONE_REED && *ports[PORT_REED] > 0.0)
+        wavetable = organ->reed_table;
+      else if (tones[h] == TONE_FLUTE && *ports[PORT_FLUTE] > 0.0)
+        wavetable = organ->flute_table;
+
+      if (cycles > 0.0F && cycles < 0.5F)
+        {
+          step[h] = wavetablePhase (cycles);
+          level[h] = *ports[PORT_HARM0 + h] / 6.0F;
+        }
+      else
+        {
+          step[h] = 0;
+          level[h] = 0.0F;
+        }
+      table[h] = wavetable->getLevel (wavetableLevel (step[h]));
+    }
 
   attack0 = multiplier (organ, *ports[PORT_ATTACK_LO]);
   decay0 = multiplier (organ, *ports[PORT_DECAY_LO]);
@@ -236,45 +239,510 @@ class Organ : CMT_PluginInstance
   decay1 = multiplier (organ, *ports[PORT_DECAY_HI]);
   release1 = multiplier (organ, *ports[PORT_RELEASE_HI]);
 
-  if (*ports[PORT_BRASS] > 0.0)
+  for (i = 0; i < SampleCount; i++)
+    ports[PORT_OUT][i] =
+      ((table_pos (table[0], step[0], &accum[0]) * level[0]
+      + table_pos (table[1], step[1], &accum[1]) * level[1]
+      + table_pos (table[2], step[2], &accum[2]) * level[2])
+      * envelope (&organ->env0, gate, attack0, decay0, *ports[PORT_SUSTAIN_LO], release0)
+
+      + (table_pos (table[3], step[3], &accum[3]) * level[3]
+      + table_pos (table[4], step[4], &accum[4]) * level[4]
+      + table_pos (table[5], step[5], &accum[5]) * level[5])
+      * envelope (&organ->env1, gate, attack1, decay1, *ports[PORT_SUSTAIN_HI], release1)) * *ports[PORT_VELOCITY];
+}
+
+  /* As run(), taking the gate as an audio signal (see gate.h). */
+  static void
+  run_audio_gate(LADSPA_Handle Instance,
+                unsigned long SampleCount) {
+    runWithAudioGate (Instance, ((Organ*) Instance)->m_ppfPorts, SampleCount,
+                      PORT_GATE, 1 << PORT_OUT, run);
+  }
+};
+
+/*****************************************************************************/
+
+/* Polyphonic organ. Rather than one Organ per note, this holds a
+   fixed pool of voices sharing one set of drawbar, tone and envelope
+   controls. Each key has its own gate, velocity and frequency ports.
+   A rising gate takes a voice from the pool and a falling one
+   releases it, so a key may start a new note while its last one is
+   still dying away. When the pool is exhausted the quietest released
+   voice is stolen, or failing that the oldest held one (see
+   voices.h). Nothing is allocated after instantiation.
+
+   Voice state is held as arrays so that four voices are rendered at
+   once with SIMD instructions where available. Phases are 32 bit
+   here, so the table index is the top WAVETABLE_BITS bits and the
+   rest give the interpolation fraction. */
+
+#define POLY_PORT_OUT         0
+
+/* The shared controls are those of Organ from PORT_BRASS on, in the
+   same order. */
+#define POLY_PORT_SHARED(p)   ((p) - PORT_BRASS + 1)
+#define POLY_NUM_SHARED       POLY_PORT_SHARED (NUM_PORTS)
+
+#define POLY_PORT_GATE(k)     (POLY_NUM_SHARED + 3 * (k))
+#define POLY_PORT_VELOCITY(k) (POLY_PORT_GATE (k) + 1)
+#define POLY_PORT_FREQ(k)     (POLY_PORT_GATE (k) + 2)
+
+#define POLY_VOICES_PER_KEY   2
+#define POLY_LANES            LANE_COUNT
+#define POLY_CHUNK            64
+
+#define POLY_PHASE_BITS       32
+#define POLY_PHASE_SHIFT      (POLY_PHASE_BITS - WAVETABLE_BITS)
+#define POLY_FRACTION_MASK    ((1U << POLY_PHASE_SHIFT) - 1)
+#define POLY_FRACTION_SCALAR  (1.0F / (1U << POLY_PHASE_SHIFT))
+
+/* Per-block values for one group of POLY_LANES voices. */
+typedef struct PolyLanes
+{
+  const LADSPA_Data *table[NUM_HARMONICS][POLY_LANES];
+  unsigned int       step[NUM_HARMONICS][POLY_LANES];
+  LADSPA_Data        level[NUM_HARMONICS][POLY_LANES];
+  LADSPA_Data        gate[POLY_LANES];
+} PolyLanes;
+
+/* Envelope settings shared by all voices: index 0 is the low group
+   of harmonics and 1 the high. */
+typedef struct PolyEnvelopes
+{
+  LADSPA_Data attack[2];
+  LADSPA_Data decay[2];
+  LADSPA_Data sustain[2];
+  LADSPA_Data release[2];
+} PolyEnvelopes;
+
+class PolyOrgan : CMT_PluginInstance
+{
+  LADSPA_Data sample_rate;
+  VoiceAllocator voices;
+
+  /* Voice state. env_decay is 1 once the envelope has passed its
+     attack, as Envelope::envelope_decay. */
+  unsigned int phase[NUM_HARMONICS][VOICE_MAX_VOICES];
+  LADSPA_Data  env[2][VOICE_MAX_VOICES];
+  LADSPA_Data  env_decay[2][VOICE_MAX_VOICES];
+  LADSPA_Data  freq[VOICE_MAX_VOICES];
+  LADSPA_Data  velocity[VOICE_MAX_VOICES];
+
+  const Wavetable *sine_table;
+  const Wavetable *reed_table;
+  const Wavetable *flute_table;
+
+  public:
+
+  PolyOrgan(const LADSPA_Descriptor * Descriptor,
+            unsigned long             SampleRate)
+    : CMT_PluginInstance(Descriptor->PortCount),
+      sample_rate(SampleRate),
+      voices((Descriptor->PortCount - POLY_NUM_SHARED) / 3,
+             (Descriptor->PortCount - POLY_NUM_SHARED) / 3 * POLY_VOICES_PER_KEY) {
+    sine_table = acquireWavetable (WAVEFORM_SINE);
+    reed_table = acquireWavetable (WAVEFORM_SQUARE);
+    flute_table = acquireWavetable (WAVEFORM_TRIANGLE);
+    activate (this);
+  }
+
+  ~PolyOrgan () {
+    releaseWavetable (WAVEFORM_TRIANGLE);
+    releaseWavetable (WAVEFORM_SQUARE);
+    releaseWavetable (WAVEFORM_SINE);
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    PolyOrgan *organ = (PolyOrgan*) Instance;
+
+    for (int v = 0; v < VOICE_MAX_VOICES; v++)
+      {
+        for (int h = 0; h < NUM_HARMONICS; h++)
+          organ->phase[h][v] = 0;
+        organ->env[0][v] = organ->env[1][v] = 0.0F;
+        organ->env_decay[0][v] = organ->env_decay[1][v] = 0.0F;
+        organ->freq[v] = 0.0F;
+        organ->velocity[v] = 0.0F;
+      }
+    organ->voices.reset ();
+  }
+
+  /* Start, update and release voices from the key ports. A voice
+     started from the pool begins from silence at phase zero, as an
+     activated Organ does. A stolen voice keeps its phases and
+     envelope levels so that the new note takes over without a
+     click. */
+  static void
+  update_keys(PolyOrgan *organ) {
+    LADSPA_Data **ports = organ->m_ppfPorts;
+    LADSPA_Data level[VOICE_MAX_VOICES];
+
+    for (int v = 0; v < organ->voices.getVoiceCount (); v++)
+      level[v] = organ->env[0][v] + organ->env[1][v];
+
+    for (int k = 0; k < organ->voices.getKeyCount (); k++)
+      {
+        int event;
+        int v = organ->voices.followKey (k, *ports[POLY_PORT_GATE (k)] > 0.0,
+                                         level, event);
+
+        if (event == VOICE_STARTED)
+          {
+            for (int h = 0; h < NUM_HARMONICS; h++)
+              organ->phase[h][v] = 0;
+            organ->env[0][v] = organ->env[1][v] = 0.0F;
+          }
+        if (event != VOICE_UNCHANGED)
+          organ->env_decay[0][v] = organ->env_decay[1][v] = 0.0F;
+
+        if (v >= 0 && organ->voices.isHeld (v))
+          {
+            organ->freq[v] = *ports[POLY_PORT_FREQ (k)];
+            organ->velocity[v] = *ports[POLY_PORT_VELOCITY (k)];
+          }
+      }
+  }
+
+  /* Render one group of voices, adding to out if add is set. The
+     state arrays are those of the group's first voice. */
+  static void
+  render_lanes(LADSPA_Data         *out,
+               const PolyLanes     *lanes,
+               const PolyEnvelopes *envelopes,
+               unsigned int        *phase,
+               LADSPA_Data         *env0,
+               LADSPA_Data         *env1,
+               LADSPA_Data         *decay0,
+               LADSPA_Data         *decay1,
+               bool                 add,
+               unsigned long        SampleCount) {
+    int h;
+    unsigned long i;
+
+#if defined(CMT_KERNELS_SSE2)
+
+    /* Each harmonic is run over a chunk at a time, summing into
+       per-sample vectors, so that its state stays in registers. The
+       envelopes are then applied to the sums. */
+    __m128 sum_v[2][POLY_CHUNK];
+    unsigned int index[POLY_LANES];
+    const __m128 one = _mm_set1_ps (1.0F);
+    const __m128 threshold = _mm_set1_ps (0.95F);
+    const __m128 gate = _mm_cmpgt_ps (_mm_loadu_ps (lanes->gate), _mm_setzero_ps ());
+    const __m128i fraction_mask = _mm_set1_epi32 (POLY_FRACTION_MASK);
+    const __m128 fraction_scalar = _mm_set1_ps (POLY_FRACTION_SCALAR);
+    __m128 env_v[2] = { _mm_loadu_ps (env0), _mm_loadu_ps (env1) };
+    __m128 decay_v[2] = { _mm_cmpgt_ps (_mm_loadu_ps (decay0), _mm_setzero_ps ()),
+                          _mm_cmpgt_ps (_mm_loadu_ps (decay1), _mm_setzero_ps ()) };
+
+    for (unsigned long start = 0; start < SampleCount; start += POLY_CHUNK)
+      {
+        const unsigned long count
+          = SampleCount - start < POLY_CHUNK ? SampleCount - start : POLY_CHUNK;
+
+        for (i = 0; i < count; i++)
+          sum_v[0][i] = sum_v[1][i] = _mm_setzero_ps ();
+
+        for (h = 0; h < NUM_HARMONICS; h++)
+          {
+            __m128i phase_v = _mm_loadu_si128 ((const __m128i *) (phase + h * VOICE_MAX_VOICES));
+            const __m128i step_v = _mm_loadu_si128 ((const __m128i *) lanes->step[h]);
+            const __m128 level_v = _mm_loadu_ps (lanes->level[h]);
+            const LADSPA_Data *table0 = lanes->table[h][0];
+            const LADSPA_Data *table1 = lanes->table[h][1];
+            const LADSPA_Data *table2 = lanes->table[h][2];
+            const LADSPA_Data *table3 = lanes->table[h][3];
+            __m128 *sum = sum_v[h / 3];
+
+            for (i = 0; i < count; i++)
+              {
+                /* As table_pos(), the phase is advanced before
+                   reading. The points are gathered through registers
+                   as storing them and reloading them as a vector
+                   would stall. */
+                phase_v = _mm_add_epi32 (phase_v, step_v);
+                _mm_storeu_si128 ((__m128i *) index,
+                                  _mm_srli_epi32 (phase_v, POLY_PHASE_SHIFT));
+                const __m128 x0_v = _mm_setr_ps (table0[index[0]], table1[index[1]],
+                                                 table2[index[2]], table3[index[3]]);
+                const __m128 x1_v = _mm_setr_ps (table0[index[0] + 1], table1[index[1] + 1],
+                                                 table2[index[2] + 1], table3[index[3] + 1]);
+                const __m128 fraction
+                  = _mm_mul_ps (_mm_cvtepi32_ps (_mm_and_si128 (phase_v, fraction_mask)),
+                                fraction_scalar);
+                const __m128 x_v
+                  = _mm_add_ps (x0_v, _mm_mul_ps (fraction, _mm_sub_ps (x1_v, x0_v)));
+                sum[i] = _mm_add_ps (sum[i], _mm_mul_ps (x_v, level_v));
+              }
+
+            _mm_storeu_si128 ((__m128i *) (phase + h * VOICE_MAX_VOICES), phase_v);
+          }
+
+        for (i = 0; i < count; i++)
+          {
+            /* Held voices rise to 1 then decay to the sustain level;
+               released ones fall to zero, as Organ::envelope(). */
+            for (int e = 0; e < 2; e++)
+              {
+                const __m128 target
+                  = _mm_and_ps (gate,
+                                _mm_or_ps (_mm_and_ps (decay_v[e], _mm_set1_ps (envelopes->sustain[e])),
+                                           _mm_andnot_ps (decay_v[e], one)));
+                const __m128 rate
+                  = _mm_or_ps (_mm_and_ps (gate,
+                                           _mm_or_ps (_mm_and_ps (decay_v[e], _mm_set1_ps (envelopes->decay[e])),
+                                                      _mm_andnot_ps (decay_v[e], _mm_set1_ps (envelopes->attack[e])))),
+                               _mm_andnot_ps (gate, _mm_set1_ps (envelopes->release[e])));
+                env_v[e] = _mm_add_ps (env_v[e], _mm_mul_ps (_mm_sub_ps (target, env_v[e]), rate));
+                decay_v[e] = _mm_or_ps (decay_v[e],
+                                        _mm_and_ps (gate, _mm_cmpge_ps (env_v[e], threshold)));
+              }
+
+            LADSPA_Data y[POLY_LANES];
+            _mm_storeu_ps (y, _mm_add_ps (_mm_mul_ps (sum_v[0][i], env_v[0]),
+                                          _mm_mul_ps (sum_v[1][i], env_v[1])));
+            const LADSPA_Data total = (y[0] + y[1]) + (y[2] + y[3]);
+            out[start + i] = add ? out[start + i] + total : total;
+          }
+      }
+
+    _mm_storeu_ps (env0, env_v[0]);
+    _mm_storeu_ps (env1, env_v[1]);
+    _mm_storeu_ps (decay0, _mm_and_ps (decay_v[0], one));
+    _mm_storeu_ps (decay1, _mm_and_ps (decay_v[1], one));
+
+#elif defined(CMT_KERNELS_NEON)
+
+    float32x4_t sum_v[2][POLY_CHUNK];
+    unsigned int index[POLY_LANES];
+    const float32x4_t one = vdupq_n_f32 (1.0F);
+    const uint32x4_t gate = vcgtq_f32 (vld1q_f32 (lanes->gate), vdupq_n_f32 (0.0F));
+    float32x4_t env_v[2] = { vld1q_f32 (env0), vld1q_f32 (env1) };
+    uint32x4_t decay_v[2] = { vcgtq_f32 (vld1q_f32 (decay0), vdupq_n_f32 (0.0F)),
+                              vcgtq_f32 (vld1q_f32 (decay1), vdupq_n_f32 (0.0F)) };
+
+    for (unsigned long start = 0; start < SampleCount; start += POLY_CHUNK)
+      {
+        const unsigned long count
+          = SampleCount - start < POLY_CHUNK ? SampleCount - start : POLY_CHUNK;
+
+        for (i = 0; i < count; i++)
+          sum_v[0][i] = sum_v[1][i] = vdupq_n_f32 (0.0F);
+
+        for (h = 0; h < NUM_HARMONICS; h++)
+          {
+            uint32x4_t phase_v = vld1q_u32 (phase + h * VOICE_MAX_VOICES);
+            const uint32x4_t step_v = vld1q_u32 (lanes->step[h]);
+            const float32x4_t level_v = vld1q_f32 (lanes->level[h]);
+            const LADSPA_Data *table0 = lanes->table[h][0];
+            const LADSPA_Data *table1 = lanes->table[h][1];
+            const LADSPA_Data *table2 = lanes->table[h][2];
+            const LADSPA_Data *table3 = lanes->table[h][3];
+            float32x4_t *sum = sum_v[h / 3];
+
+            for (i = 0; i < count; i++)
+              {
+                phase_v = vaddq_u32 (phase_v, step_v);
+                vst1q_u32 (index, vshrq_n_u32 (phase_v, POLY_PHASE_SHIFT));
+                float32x4_t x0_v = vdupq_n_f32 (table0[index[0]]);
+                float32x4_t x1_v = vdupq_n_f32 (table0[index[0] + 1]);
+                x0_v = vsetq_lane_f32 (table1[index[1]], x0_v, 1);
+                x1_v = vsetq_lane_f32 (table1[index[1] + 1], x1_v, 1);
+                x0_v = vsetq_lane_f32 (table2[index[2]], x0_v, 2);
+                x1_v = vsetq_lane_f32 (table2[index[2] + 1], x1_v, 2);
+                x0_v = vsetq_lane_f32 (table3[index[3]], x0_v, 3);
+                x1_v = vsetq_lane_f32 (table3[index[3] + 1], x1_v, 3);
+                const float32x4_t fraction
+                  = vmulq_n_f32 (vcvtq_f32_u32 (vandq_u32 (phase_v, vdupq_n_u32 (POLY_FRACTION_MASK))),
+                                 POLY_FRACTION_SCALAR);
+                const float32x4_t x_v = vmlaq_f32 (x0_v, fraction, vsubq_f32 (x1_v, x0_v));
+                sum[i] = vmlaq_f32 (sum[i], x_v, level_v);
+              }
+
+            vst1q_u32 (phase + h * VOICE_MAX_VOICES, phase_v);
+          }
+
+        for (i = 0; i < count; i++)
+          {
+            for (int e = 0; e < 2; e++)
+              {
+                const float32x4_t held_target
+                  = vbslq_f32 (decay_v[e], vdupq_n_f32 (envelopes->sustain[e]), one);
+                const float32x4_t held_rate
+                  = vbslq_f32 (decay_v[e], vdupq_n_f32 (envelopes->decay[e]), vdupq_n_f32 (envelopes->attack[e]));
+                const float32x4_t target = vbslq_f32 (gate, held_target, vdupq_n_f32 (0.0F));
+                const float32x4_t rate = vbslq_f32 (gate, held_rate, vdupq_n_f32 (envelopes->release[e]));
+                env_v[e] = vmlaq_f32 (env_v[e], vsubq_f32 (target, env_v[e]), rate);
+                decay_v[e] = vorrq_u32 (decay_v[e],
+                                        vandq_u32 (gate, vcgeq_f32 (env_v[e], vdupq_n_f32 (0.95F))));
+              }
+
+            LADSPA_Data y[POLY_LANES];
+            vst1q_f32 (y, vmlaq_f32 (vmulq_f32 (sum_v[0][i], env_v[0]), sum_v[1][i], env_v[1]));
+            const LADSPA_Data total = (y[0] + y[1]) + (y[2] + y[3]);
+            out[start + i] = add ? out[start + i] + total : total;
+          }
+      }
+
+    vst1q_f32 (env0, env_v[0]);
+    vst1q_f32 (env1, env_v[1]);
+    vst1q_f32 (decay0, vbslq_f32 (decay_v[0], one, vdupq_n_f32 (0.0F)));
+    vst1q_f32 (decay1, vbslq_f32 (decay_v[1], one, vdupq_n_f32 (0.0F)));
+
+#else
+
+    int l;
+    LADSPA_Data *env[2] = { env0, env1 };
+    LADSPA_Data *decay[2] = { decay0, decay1 };
+
+    for (i = 0; i < SampleCount; i++)
+      {
+        LADSPA_Data y[POLY_LANES];
+        for (l = 0; l < POLY_LANES; l++)
+          {
+            LADSPA_Data sum[2] = { 0.0F, 0.0F };
+            for (h = 0; h < NUM_HARMONICS; h++)
+              {
+                unsigned int *p = phase + h * VOICE_MAX_VOICES + l;
+                *p += lanes->step[h][l];
+                const LADSPA_Data *x = lanes->table[h][l] + (*p >> POLY_PHASE_SHIFT);
+                const LADSPA_Data fraction
+                  = LADSPA_Data (*p & POLY_FRACTION_MASK) * POLY_FRACTION_SCALAR;
+                sum[h / 3] += (x[0] + fraction * (x[1] - x[0])) * lanes->level[h][l];
+              }
+            for (int e = 0; e < 2; e++)
+              {
+                LADSPA_Data target, rate;
+                if (lanes->gate[l] > 0.0F)
+                  {
+                    target = decay[e][l] > 0.0F ? envelopes->sustain[e] : 1.0F;
+                    rate = decay[e][l] > 0.0F ? envelopes->decay[e] : envelopes->attack[e];
+                  }
+                else
+                  {
+                    target = 0.0F;
+                    rate = envelopes->release[e];
+                  }
+                env[e][l] += (target - env[e][l]) * rate;
+                if (lanes->gate[l] > 0.0F && env[e][l] >= 0.95F)
+                  decay[e][l] = 1.0F;
+              }
+            y[l] = sum[0] * env[0][l] + sum[1] * env[1][l];
+          }
+        const LADSPA_Data sum = (y[0] + y[1]) + (y[2] + y[3]);
+        out[i] = add ? out[i] + sum : sum;
+      }
+
+#endif
+  }
+
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+  PolyOrgan *organ = (PolyOrgan*) Instance;
+  LADSPA_Data **ports = organ->m_ppfPorts;
+  const LADSPA_Data *ratios;
+  const int *tones;
+  const Wavetable *wavetable[NUM_HARMONICS];
+  LADSPA_Data drawbar[NUM_HARMONICS];
+  PolyEnvelopes envelopes;
+  PolyLanes lanes;
+  int h, v;
+  bool add = false;
+
+  update_keys (organ);
+
+  /* Everything that does not depend on the voice is worked out once
+     per block. */
+  if (*ports[POLY_PORT_SHARED (PORT_BRASS)] > 0.0)
     {
-      freq_256_harm2 = freq_256 * 2;
-      freq_256_harm3 = freq_256_harm2 * 2;
-      freq_256_harm4 = freq_256_harm3 * 2;
-      freq_256_harm5 = freq_256_harm4 * 2;
-
-      for (i = 0; i < SampleCount; i++)
-        ports[PORT_OUT][i] =
-	  ((table_pos (sine_table, freq_256_harm0, &organ->harm0_accum) * *ports[PORT_HARM0]
-	  + table_pos (sine_table, freq_256_harm1, &organ->harm1_accum) * *ports[PORT_HARM1]
-	  + table_pos (reed_table, freq_256_harm2, &organ->harm2_accum) * *ports[PORT_HARM2])
-          * envelope (&organ->env0, gate, attack0, decay0, *ports[PORT_SUSTAIN_LO], release0)
-	  + (table_pos (sine_table, freq_256_harm3, &organ->harm3_accum) * *ports[PORT_HARM3]
-	  + table_pos (flute_table, freq_256_harm4, &organ->harm4_accum) * *ports[PORT_HARM4]
-	  + table_pos (flute_table, freq_256_harm5, &organ->harm5_accum) * *ports[PORT_HARM5])
-          * envelope (&organ->env1, gate, attack1, decay1, *ports[PORT_SUSTAIN_HI], release1)) * *ports[PORT_VELOCITY];
+      ratios = g_brass_ratios;
+      tones = g_brass_tones;
     }
   else
     {
-      freq_256_harm2 = freq_256 * 3 / 2;
-      freq_256_harm3 = freq_256 * 2;
-      freq_256_harm4 = freq_256 * 3;
-      freq_256_harm5 = freq_256_harm3 * 2;
-
-      for (i = 0; i < SampleCount; i++)
-        ports[PORT_OUT][i] =
-          ((table_pos (sine_table, freq_256_harm0, &organ->harm0_accum) * *ports[PORT_HARM0]
-          + table_pos (sine_table, freq_256_harm1, &organ->harm1_accum) * *ports[PORT_HARM1]
-          + table_pos (sine_table, freq_256_harm2, &organ->harm2_accum) * *ports[PORT_HARM2])
-          * envelope (&organ->env0, gate, attack0, decay0, *ports[PORT_SUSTAIN_LO], release0)
-
-          + (table_pos (reed_table, freq_256_harm3, &organ->harm3_accum) * *ports[PORT_HARM3]
-          + table_pos (sine_table, freq_256_harm4, &organ->harm4_accum) * *ports[PORT_HARM4]
-          + table_pos (flute_table, freq_256_harm5, &organ->harm5_accum) * *ports[PORT_HARM5])
-          * envelope (&organ->env1, gate, attack1, decay1, *ports[PORT_SUSTAIN_HI], release1)) * *ports[PORT_VELOCITY];
+      ratios = g_normal_ratios;
+      tones = g_normal_tones;
+    }
+  for (h = 0; h < NUM_HARMONICS; h++)
+    {
+      wavetable[h] = organ->sine_table;
+      if (tones[h] == TONE_REED && *ports[POLY_PORT_SHARED (PORT_REED)] > 0.0)
+        wavetable[h] = organ->reed_table;
+      else if (tones[h] == TONE_FLUTE && *ports[POLY_PORT_SHARED (PORT_FLUTE)] > 0.0)
+        wavetable[h] = organ->flute_table;
+      drawbar[h] = *ports[POLY_PORT_SHARED (PORT_HARM0 + h)] / 6.0F;
+    }
+  for (int e = 0; e < 2; e++)
+    {
+      const int base = (e == 0 ? PORT_ATTACK_LO : PORT_ATTACK_HI);
+      envelopes.attack[e] = multiplier (organ, *ports[POLY_PORT_SHARED (base)]);
+      envelopes.decay[e] = multiplier (organ, *ports[POLY_PORT_SHARED (base + 1)]);
+      envelopes.sustain[e] = *ports[POLY_PORT_SHARED (base + 2)];
+      envelopes.release[e] = multiplier (organ, *ports[POLY_PORT_SHARED (base + 3)]);
+    }
+
+  for (int group = 0; group < organ->voices.getVoiceCount (); group += POLY_LANES)
+    {
+      if (!organ->voices.isGroupActive (group))
+        continue;
+
+      for (int l = 0; l < POLY_LANES; l++)
+        {
+          v = group + l;
+          lanes.gate[l] = organ->voices.isHeld (v) ? 1.0F : 0.0F;
+          for (h = 0; h < NUM_HARMONICS; h++)
+            {
+              LADSPA_Data cycles = organ->freq[v] * ratios[h] / organ->sample_rate;
+
+              if (organ->voices.isActive (v) && cycles > 0.0F && cycles < 0.5F)
+                {
+                  /* Tuned exactly as Organ, whose phase step has
+                     fewer fraction bits. */
+                  lanes.step[h][l] = (unsigned int)
+                    (wavetablePhase (cycles) >> (8 * sizeof (unsigned long) - POLY_PHASE_BITS));
+                  lanes.level[h][l] = drawbar[h] * organ->velocity[v];
+                }
+              else
+                {
+                  lanes.step[h][l] = 0;
+                  lanes.level[h][l] = 0.0F;
+                }
+              lanes.table[h][l] = wavetable[h]->getLevel
+                (wavetableLevel ((unsigned long) lanes.step[h][l]
+                                 << (8 * sizeof (unsigned long) - POLY_PHASE_BITS)));
+            }
+        }
+
+      render_lanes (ports[POLY_PORT_OUT], &lanes, &envelopes,
+                    &organ->phase[0][group],
+                    &organ->env[0][group], &organ->env[1][group],
+                    &organ->env_decay[0][group], &organ->env_decay[1][group],
+                    add, SampleCount);
+      add = true;
     }
+
+  if (!add)
+    for (unsigned long i = 0; i < SampleCount; i++)
+      ports[POLY_PORT_OUT][i] = 0.0F;
+
+  /* Return voices that have died away to the pool. */
+  for (v = 0; v < organ->voices.getVoiceCount (); v++)
+    if (organ->voices.isActive (v) && !organ->voices.isHeld (v)
+        && organ->env[0][v] < VOICE_SILENCE && organ->env[1][v] < VOICE_SILENCE)
+      {
+        organ->voices.retireVoice (v);
+        organ->env[0][v] = organ->env[1][v] = 0.0F;
+      }
 }
 
+  static inline LADSPA_Data
+  multiplier(PolyOrgan   *organ,
+             LADSPA_Data  value) {
+    return 1.0 - pow (0.05, 1.0 / (organ->sample_rate * value));
+  }
 
 };
 
@@ -371,4 +839,84 @@ initialise_organ() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2026,
+       "organ_audio_gate",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Organ (Audio Gate)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("1999, 2000", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<Organ>,
+       Organ::activate,
+       Organ::run_audio_gate,
+       NULL,
+       NULL,
+       NULL);
+
+  for (int i = 0; i < NUM_PORTS; i++)
+    if (i == PORT_GATE)
+      psDescriptor->addPort(
+        LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+        g_psPortNames[i]);
+    else
+      psDescriptor->addPort(
+        g_psPortDescriptors[i],
+        g_psPortNames[i],
+        g_psPortRangeHints[i].HintDescriptor,
+        g_psPortRangeHints[i].LowerBound,
+        g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
+
+  const char * poly_labels[] = { "organ_poly8", "organ_poly16" };
+  const char * poly_names[] = {
+    "Polyphonic Organ (8 Keys)",
+    "Polyphonic Organ (16 Keys)"
+  };
+  const int poly_keys[] = { 8, 16 };
+
+  for (int p = 0; p < 2; p++)
+    {
+      psDescriptor = new CMT_Descriptor
+          (1993 + p,
+           poly_labels[p],
+           LADSPA_PROPERTY_HARD_RT_CAPABLE,
+           poly_names[p],
+           CMT_MAKER("David A. Bartold"),
+           CMT_COPYRIGHT("1999, 2000", "David A. Bartold"),
+           NULL,
+           CMT_Instantiate<PolyOrgan>,
+           PolyOrgan::activate,
+           PolyOrgan::run,
+           NULL,
+           NULL,
+           NULL);
+
+      psDescriptor->addPort(
+        g_psPortDescriptors[PORT_OUT],
+        g_psPortNames[PORT_OUT]);
+      for (int i = PORT_BRASS; i < NUM_PORTS; i++)
+        psDescriptor->addPort(
+          g_psPortDescriptors[i],
+          g_psPortNames[i],
+          g_psPortRangeHints[i].HintDescriptor,
+          g_psPortRangeHints[i].LowerBound,
+          g_psPortRangeHints[i].UpperBound);
+      for (int k = 0; k < poly_keys[p]; k++)
+        for (int i = PORT_GATE; i <= PORT_FREQ; i++)
+          {
+            char name[64];
+            sprintf (name, "%s %d", g_psPortNames[i], k + 1);
+            psDescriptor->addPort(
+              g_psPortDescriptors[i],
+              name,
+              g_psPortRangeHints[i].HintDescriptor,
+              g_psPortRangeHints[i].LowerBound,
+              g_psPortRangeHints[i].UpperBound);
+          }
+
+      registerNewPluginDescriptor(psDescriptor);
+    }
 }
@@ -0,0 +1,267 @@
+/* oversample.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <cstring>
+
+/*****************************************************************************/
+
+#include "kernels.h"
+#include "oversample.h"
+
+/*****************************************************************************/
+
+/** Kaiser window parameter, giving around 70dB of stopband
+    attenuation. */
+#define OVERSAMPLE_KAISER_BETA 7.0
+
+/** Zeroth order modified Bessel function of the first kind, from its
+    power series. */
+static double
+besselI0(const double dX) {
+  double dSum = 1;
+  double dTerm = 1;
+  for (int iK = 1; iK < 32; iK++) {
+    const double dHalf = dX / (2 * iK);
+    dTerm *= dHalf * dHalf;
+    dSum += dTerm;
+  }
+  return dSum;
+}
+
+/** Fill pfFilter with a lowpass for iFactor times oversampling, cut
+    off at the base rate Nyquist frequency and normalised to unity
+    gain at DC. */
+static void
+designFilter(LADSPA_Data * pfFilter, const int iFactor) {
+
+  const int iLength = iFactor * OVERSAMPLE_TAPS;
+  const double dCentre = (iLength - 1) * 0.5;
+  const double dCutoff = 0.5 / iFactor;
+
+  double * pdFilter = new double[iLength];
+  double dSum = 0;
+  for (int iTap = 0; iTap < iLength; iTap++) {
+    const double dT = iTap - dCentre;
+    const double dRatio = dT / dCentre;
+    const double dSinc = sin(2 * M_PI * dCutoff * dT) / (M_PI * dT);
+    pdFilter[iTap]
+      = (dSinc
+	 * besselI0(OVERSAMPLE_KAISER_BETA * sqrt(1 - dRatio * dRatio))
+	 / besselI0(OVERSAMPLE_KAISER_BETA));
+    dSum += pdFilter[iTap];
+  }
+  for (int iTap = 0; iTap < iLength; iTap++)
+    pfFilter[iTap] = LADSPA_Data(pdFilter[iTap] / dSum);
+
+  delete [] pdFilter;
+}
+
+/*****************************************************************************/
+
+/** The filters and upsampling phases for factors 2, 4 and 8. Factor
+    2^n is at index n - 1. */
+class OversampleKernels : public CMT_SharedTable {
+private:
+
+  LADSPA_Data * m_apfFilter[3];
+  LADSPA_Data * m_apfPhases[3];
+
+public:
+
+  OversampleKernels() {
+    for (int iLevel = 0; iLevel < 3; iLevel++) {
+      const int iFactor = 2 << iLevel;
+      m_apfFilter[iLevel] = allocateTableData(iFactor * OVERSAMPLE_TAPS);
+      m_apfPhases[iLevel] = allocateTableData(iFactor * OVERSAMPLE_TAPS);
+      designFilter(m_apfFilter[iLevel], iFactor);
+      /* Phase p of the interpolator produces output sample p of each
+	 group of iFactor from taps p, p + iFactor, p + 2 *
+	 iFactor... */
+      for (int iPhase = 0; iPhase < iFactor; iPhase++)
+	for (int iTap = 0; iTap < OVERSAMPLE_TAPS; iTap++)
+	  m_apfPhases[iLevel][iPhase * OVERSAMPLE_TAPS + iTap]
+	    = (iFactor
+	       * m_apfFilter[iLevel][(OVERSAMPLE_TAPS - 1 - iTap) * iFactor
+				     + iPhase]);
+    }
+  }
+
+  ~OversampleKernels() {
+    for (int iLevel = 0; iLevel < 3; iLevel++) {
+      freeTableData(m_apfFilter[iLevel]);
+      freeTableData(m_apfPhases[iLevel]);
+    }
+  }
+
+  const LADSPA_Data * getFilter(const int iLevel) const {
+    return m_apfFilter[iLevel];
+  }
+  const LADSPA_Data * getPhases(const int iLevel) const {
+    return m_apfPhases[iLevel];
+  }
+
+};
+
+#define OVERSAMPLE_KEY "oversample"
+
+static CMT_SharedTable *
+createOversampleKernels(const int) {
+  return new OversampleKernels;
+}
+
+/*****************************************************************************/
+
+Oversampler::Oversampler()
+  : m_iFactor(1),
+    m_pfFilter(NULL),
+    m_pfPhases(NULL) {
+  m_poKernels 
+    = (const OversampleKernels *)acquireSharedTable(OVERSAMPLE_KEY,
+						    0,
+						    createOversampleKernels);
+  reset();
+}
+
+/*****************************************************************************/
+
+Oversampler::~Oversampler() {
+  releaseSharedTable(OVERSAMPLE_KEY, 0);
+}
+
+/*****************************************************************************/
+
+void
+Oversampler::reset() {
+  memset(m_afUpHistory, 0, sizeof(m_afUpHistory));
+  memset(m_afDownHistory, 0, sizeof(m_afDownHistory));
+}
+
+/*****************************************************************************/
+
+void
+Oversampler::setFactor(const LADSPA_Data fFactor) {
+
+  int iFactor;
+  if (fFactor < 1.5f)
+    iFactor = 1;
+  else if (fFactor < 3)
+    iFactor = 2;
+  else if (fFactor < 6)
+    iFactor = 4;
+  else
+    iFactor = 8;
+
+  if (iFactor == m_iFactor)
+    return;
+  m_iFactor = iFactor;
+
+  int iLevel = -1;
+  switch (iFactor) {
+  case 2:
+    iLevel = 0;
+    break;
+  case 4:
+    iLevel = 1;
+    break;
+  case 8:
+    iLevel = 2;
+    break;
+  }
+  if (iLevel >= 0) {
+    m_pfFilter = m_poKernels->getFilter(iLevel);
+    m_pfPhases = m_poKernels->getPhases(iLevel);
+  }
+  else {
+    m_pfFilter = NULL;
+    m_pfPhases = NULL;
+  }
+
+  reset();
+}
+
+/*****************************************************************************/
+
+void
+Oversampler::upsample(const LADSPA_Data * pfInput,
+		      LADSPA_Data *       pfOutput,
+		      const unsigned long lSampleCount) {
+
+  if (m_iFactor == 1) {
+    if (pfOutput != pfInput)
+      memmove(pfOutput, pfInput, lSampleCount * sizeof(LADSPA_Data));
+    return;
+  }
+
+  LADSPA_Data * pfHistory = m_afUpHistory;
+  memcpy(pfHistory + OVERSAMPLE_TAPS - 1,
+	 pfInput,
+	 lSampleCount * sizeof(LADSPA_Data));
+
+  for (unsigned long lIndex = 0; lIndex < lSampleCount; lIndex++)
+    for (int iPhase = 0; iPhase < m_iFactor; iPhase++)
+      *(pfOutput++) = dotProduct(pfHistory + lIndex,
+				 m_pfPhases + iPhase * OVERSAMPLE_TAPS,
+				 OVERSAMPLE_TAPS);
+
+  memmove(pfHistory,
+	  pfHistory + lSampleCount,
+	  (OVERSAMPLE_TAPS - 1) * sizeof(LADSPA_Data));
+}
+
+/*****************************************************************************/
+
+void
+Oversampler::downsample(const LADSPA_Data * pfInput,
+			LADSPA_Data *       pfOutput,
+			const unsigned long lSampleCount) {
+
+  if (m_iFactor == 1) {
+    if (pfOutput != pfInput)
+      memmove(pfOutput, pfInput, lSampleCount * sizeof(LADSPA_Data));
+    return;
+  }
+
+  const unsigned long lLength = m_iFactor * OVERSAMPLE_TAPS;
+  const unsigned long lInputCount = lSampleCount * m_iFactor;
+
+  LADSPA_Data * pfHistory = m_afDownHistory;
+  memcpy(pfHistory + lLength - 1,
+	 pfInput,
+	 lInputCount * sizeof(LADSPA_Data));
+
+  /* Each output is the filter applied to the input up to the last
+     sample of its group. The filter is symmetric so needs no
+     reversing. */
+  for (unsigned long lIndex = 0; lIndex < lSampleCount; lIndex++)
+    pfOutput[lIndex] = dotProduct(pfHistory + (lIndex + 1) * m_iFactor - 1,
+				  m_pfFilter,
+				  lLength);
+
+  memmove(pfHistory,
+	  pfHistory + lInputCount,
+	  (lLength - 1) * sizeof(LADSPA_Data));
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,138 @@
+/* oversample.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_OVERSAMPLE_INCLUDED
+#define CMT_OVERSAMPLE_INCLUDED
+
+/*****************************************************************************/
+
+/* Polyphase up and down-sampling for nonlinear plugins. A plugin
+   wraps its nonlinear stage as follows, for one Oversampler per
+   channel:
+
+     for each chunk of up to OVERSAMPLE_CHUNK samples:
+       oOversampler.upsample(pfInput, pfBuffer, lCount);
+       Process lCount * oOversampler.getFactor() samples of pfBuffer.
+       oOversampler.downsample(pfBuffer, pfOutput, lCount);
+
+   so only that stage runs at the higher rate. Both filters are the
+   same Kaiser windowed sinc with OVERSAMPLE_TAPS taps per phase,
+   which is flat to about 0.4 of the base sample rate and gives over
+   70dB of rejection. Together they delay the signal by just under
+   OVERSAMPLE_TAPS samples at the base rate. */
+
+/*****************************************************************************/
+
+#include "cmt.h"
+
+/*****************************************************************************/
+
+#define OVERSAMPLE_MAX_FACTOR 8
+
+/** Taps in each phase of the filters. This is a multiple of four to
+    suit the dotProduct() kernel. */
+#define OVERSAMPLE_TAPS 24
+
+/** Largest number of base rate samples upsample() and downsample()
+    accept at once. */
+#define OVERSAMPLE_CHUNK 64
+
+/** Standard port hints for an oversampling factor port, running from
+    1 to OVERSAMPLE_MAX_FACTOR with a default of 1 (no
+    oversampling). */
+#define OVERSAMPLE_PORT_NAME "Oversampling Factor"
+#define OVERSAMPLE_PORT_HINTS			\
+  (LADSPA_HINT_BOUNDED_BELOW			\
+   | LADSPA_HINT_BOUNDED_ABOVE			\
+   | LADSPA_HINT_INTEGER			\
+   | LADSPA_HINT_DEFAULT_1)
+
+/*****************************************************************************/
+
+class OversampleKernels;
+
+/** Up and down-sampling state for one channel. All storage is
+    allocated with the object, so upsample() and downsample() are safe
+    to call from run(). The filters are shared by all Oversamplers
+    through the shared table registry. */
+class Oversampler {
+private:
+
+  Oversampler(const Oversampler &);
+  Oversampler & operator=(const Oversampler &);
+
+  int m_iFactor;
+
+  const OversampleKernels * m_poKernels;
+
+  /** The filter for the current factor, OVERSAMPLE_TAPS * factor taps
+      long. This is symmetric so is used as it is by downsample(). */
+  const LADSPA_Data * m_pfFilter;
+
+  /** The same filter split into its phases of OVERSAMPLE_TAPS taps,
+      each reversed and scaled by the factor for upsample(). */
+  const LADSPA_Data * m_pfPhases;
+
+  /** The last OVERSAMPLE_TAPS - 1 input samples from the previous
+      call to upsample() followed by the current input. */
+  LADSPA_Data m_afUpHistory[OVERSAMPLE_TAPS - 1 + OVERSAMPLE_CHUNK];
+
+  /** As above but for downsample(), at the higher rate. */
+  LADSPA_Data m_afDownHistory[OVERSAMPLE_MAX_FACTOR
+			      * (OVERSAMPLE_TAPS + OVERSAMPLE_CHUNK)];
+
+public:
+
+  Oversampler();
+  ~Oversampler();
+
+  /** Clear the filter state. Call from activate(). */
+  void reset();
+
+  /** Select the factor, normally from the port value at the start of
+      each block. fFactor is rounded to 1, 2, 4 or 8. Changing the
+      factor clears the filter state. */
+  void setFactor(const LADSPA_Data fFactor);
+
+  int getFactor() const {
+    return m_iFactor;
+  }
+
+  /** Write lSampleCount * getFactor() samples to pfOutput for the
+      lSampleCount samples of pfInput. lSampleCount must be no more
+      than OVERSAMPLE_CHUNK. */
+  void upsample(const LADSPA_Data * pfInput,
+		LADSPA_Data *       pfOutput,
+		const unsigned long lSampleCount);
+
+  /** Write lSampleCount samples to pfOutput for the lSampleCount *
+      getFactor() samples of pfInput. lSampleCount must be no more
+      than OVERSAMPLE_CHUNK. pfOutput may be the same as pfInput. */
+  void downsample(const LADSPA_Data * pfInput,
+		  LADSPA_Data *       pfOutput,
+		  const unsigned long lSampleCount);
+
+};
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
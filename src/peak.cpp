@@ -21,12 +21,16 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 /*****************************************************************************/
 
+#include "biquad.h"
 #include "cmt.h"
+#include "kernels.h"
+#include "lanes.h"
 #include "utils.h"
 
 /*****************************************************************************/
@@ -45,6 +49,10 @@ static void runEnvelopeTracker_MaxPeak(LADSPA_Handle Instance,
                                        unsigned long SampleCount);
 static void runEnvelopeTracker_MaxRMS(LADSPA_Handle Instance,
                                       unsigned long SampleCount);
+template <bool bRMS, bool bMaximum>
+static void runEnvelopeTrackerBatch(const LADSPA_Handle * Instances,
+				    unsigned long InstanceCount,
+				    unsigned long SampleCount);
   
 /** This class is used to provide plugins that perform envelope
     tracking. Peak and RMS are supported and smoothed or smoothed
@@ -72,6 +80,10 @@ public:
 					 unsigned long SampleCount);
   friend void runEnvelopeTracker_MaxRMS(LADSPA_Handle Instance,
 					unsigned long SampleCount);
+  template <bool bRMS, bool bMaximum>
+  friend void runEnvelopeTrackerBatch(const LADSPA_Handle * Instances,
+				      unsigned long InstanceCount,
+				      unsigned long SampleCount);
   
 };
 
@@ -208,6 +220,73 @@ runEnvelopeTracker_MaxRMS(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+/** Run a batch of envelope trackers of one kind (see
+    cmt_run_batch()) in groups of LANE_COUNT, one tracker to each
+    lane. The maximum trackers take the larger of the input and the
+    decayed envelope, which is what the branches in the single
+    versions come to. Any trackers left over are run separately. */
+template <bool bRMS, bool bMaximum>
+static void
+runEnvelopeTrackerBatch(const LADSPA_Handle * Instances,
+			unsigned long InstanceCount,
+			unsigned long SampleCount) {
+
+  unsigned long lInstance = 0;
+  for (; lInstance + LANE_COUNT <= InstanceCount; lInstance += LANE_COUNT) {
+
+    Tracker * apoTrackers[LANE_COUNT];
+    const LADSPA_Data * apfInputs[LANE_COUNT];
+    LADSPA_Data afDrag[LANE_COUNT];
+    LADSPA_Data afState[LANE_COUNT];
+    int iLane;
+    for (iLane = 0; iLane < LANE_COUNT; iLane++) {
+      Tracker * poTracker
+	= apoTrackers[iLane]
+	= (Tracker *)Instances[lInstance + iLane];
+      apfInputs[iLane] = poTracker->m_ppfPorts[ET_INPUT];
+      afDrag[iLane] 
+	= (bMaximum
+	   ? calculate60dBDrag(*(poTracker->m_ppfPorts[ET_FILTER]),
+			       poTracker->m_fSampleRate)
+	   : *(poTracker->m_ppfPorts[ET_FILTER]));
+      afState[iLane] = poTracker->m_fState;
+    }
+
+    const Lanes vDrag = lanesLoad(afDrag);
+    const Lanes vOneMinusDrag = lanesSplat(1) - vDrag;
+    Lanes vState = lanesLoad(afState);
+
+    for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
+      const Lanes vInput = lanesGather(apfInputs, lIndex);
+      const Lanes vEnvelopeTarget = bRMS ? vInput * vInput : lanesAbs(vInput);
+      if (bMaximum)
+	vState = lanesMax(vEnvelopeTarget, vState * vDrag);
+      else
+	vState = vState * vDrag + vEnvelopeTarget * vOneMinusDrag;
+    }
+
+    lanesStore(afState, vState);
+    for (iLane = 0; iLane < LANE_COUNT; iLane++) {
+      apoTrackers[iLane]->m_fState = afState[iLane];
+      *(apoTrackers[iLane]->m_ppfPorts[ET_OUTPUT])
+	= bRMS ? sqrt(afState[iLane]) : afState[iLane];
+    }
+  }
+
+  for (; lInstance < InstanceCount; lInstance++) {
+    if (bMaximum && bRMS)
+      runEnvelopeTracker_MaxRMS(Instances[lInstance], SampleCount);
+    else if (bMaximum)
+      runEnvelopeTracker_MaxPeak(Instances[lInstance], SampleCount);
+    else if (bRMS)
+      runEnvelopeTracker_RMS(Instances[lInstance], SampleCount);
+    else
+      runEnvelopeTracker_Peak(Instances[lInstance], SampleCount);
+  }
+}
+
+/*****************************************************************************/
+
 static void 
 runPeakMonitor(LADSPA_Handle Instance,
 	       unsigned long SampleCount) {
@@ -227,6 +306,354 @@ runPeakMonitor(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+/* Multichannel meters. Each gives the peak and RMS level of every
+   channel and the momentary (400ms) and short-term (3s) loudness of
+   EBU R128 over all the channels together, weighting each channel
+   equally. Peaks and sums of squares are found a block at a time
+   with peakAndSumOfSquares() from kernels.h, and the K-weighting
+   filters run LANE_COUNT channels side by side.
+
+   Energies are gathered in segments of 10ms, kept in a ring covering
+   the longest window, so each sliding window is a running sum to
+   which a segment is added and from which one is taken as each
+   segment ends. The RMS and loudness outputs therefore change every
+   10ms, while the peaks follow each block. */
+
+#define MT_MAX_CHANNELS 16
+
+#define MT_SEGMENTS_PER_SECOND 100
+#define MT_MAX_SEGMENTS        300
+#define MT_MOMENTARY_SEGMENTS  40
+#define MT_SHORT_TERM_SEGMENTS 300
+
+/** Loudness is reported down to the absolute gate of EBU R128. */
+#define MT_MIN_LOUDNESS -70
+
+/** Ports for lChannels channels. The inputs come first, then the
+    controls, then a peak and an RMS output for each channel and
+    finally the loudness outputs. */
+#define MT_INPUT(iChannel)           (iChannel)
+#define MT_RMS_WINDOW(lChannels)     (lChannels)
+#define MT_PEAK_DECAY(lChannels)     ((lChannels) + 1)
+#define MT_PEAK(lChannels, iChannel) ((lChannels) + 2 + 2 * (iChannel))
+#define MT_RMS(lChannels, iChannel)  ((lChannels) + 3 + 2 * (iChannel))
+#define MT_MOMENTARY(lChannels)      (3 * (lChannels) + 2)
+#define MT_SHORT_TERM(lChannels)     (3 * (lChannels) + 3)
+#define MT_PORT_COUNT(lChannels)     (3 * (lChannels) + 4)
+
+static void activateMeter(LADSPA_Handle Instance);
+template <long lChannels>
+static void runMeter(LADSPA_Handle Instance,
+		     unsigned long SampleCount);
+
+/** Instance data for the multichannel meters. The K-weighting state
+    is held one lane per channel so that it may be loaded straight
+    into a vector. Energies are kept in double precision so that the
+    running sums do not wander. */
+class Meter : public CMT_PluginInstance {
+private:
+
+  LADSPA_Data m_fSampleRate;
+  unsigned long m_lSegmentLength;
+
+  BiquadCoefficients m_sShelf;
+  BiquadCoefficients m_sHighPass;
+  LADSPA_Data m_afShelfZ1[MT_MAX_CHANNELS];
+  LADSPA_Data m_afShelfZ2[MT_MAX_CHANNELS];
+  LADSPA_Data m_afHighPassZ1[MT_MAX_CHANNELS];
+  LADSPA_Data m_afHighPassZ2[MT_MAX_CHANNELS];
+
+  LADSPA_Data m_afPeak[MT_MAX_CHANNELS];
+
+  /** The segment being gathered. */
+  unsigned long m_lSegmentFill;
+  double m_adSegmentEnergy[MT_MAX_CHANNELS];
+  double m_dSegmentLoudness;
+
+  /** Completed segments, with m_iSegment the next to be written (and
+      so the oldest). */
+  int m_iSegment;
+  double m_aadEnergy[MT_MAX_SEGMENTS][MT_MAX_CHANNELS];
+  double m_adLoudness[MT_MAX_SEGMENTS];
+
+  /** The running sums, over the last m_iRMSSegments segments for the
+      RMS levels. */
+  int m_iRMSSegments;
+  double m_adRMSSum[MT_MAX_CHANNELS];
+  double m_dMomentarySum;
+  double m_dShortTermSum;
+
+  double sumLoudness(const int iSegmentCount) const;
+  void sumWindows(const long lChannels);
+  void endSegment(const long lChannels);
+  template <long lChannels>
+  double weighLoudness(const unsigned long lOffset,
+		       const unsigned long lSampleCount);
+
+public:
+
+  Meter(const LADSPA_Descriptor *,
+	unsigned long lSampleRate)
+    : CMT_PluginInstance(MT_PORT_COUNT(MT_MAX_CHANNELS)),
+      m_fSampleRate(LADSPA_Data(lSampleRate)),
+      m_lSegmentLength((lSampleRate + MT_SEGMENTS_PER_SECOND / 2)
+		       / MT_SEGMENTS_PER_SECOND) {
+    if (m_lSegmentLength == 0)
+      m_lSegmentLength = 1;
+    designKWeighting(m_sShelf, m_sHighPass, lSampleRate);
+  }
+
+  friend void activateMeter(LADSPA_Handle Instance);
+  template <long lChannels>
+  friend void runMeter(LADSPA_Handle Instance,
+		       unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void
+activateMeter(LADSPA_Handle Instance) {
+  Meter * poMeter = (Meter *)Instance;
+  for (int iChannel = 0; iChannel < MT_MAX_CHANNELS; iChannel++) {
+    poMeter->m_afShelfZ1[iChannel] = poMeter->m_afShelfZ2[iChannel] = 0;
+    poMeter->m_afHighPassZ1[iChannel] = poMeter->m_afHighPassZ2[iChannel] = 0;
+    poMeter->m_afPeak[iChannel] = 0;
+    poMeter->m_adSegmentEnergy[iChannel] = 0;
+    poMeter->m_adRMSSum[iChannel] = 0;
+  }
+  poMeter->m_lSegmentFill = 0;
+  poMeter->m_dSegmentLoudness = 0;
+  poMeter->m_iSegment = 0;
+  memset(poMeter->m_aadEnergy, 0, sizeof(poMeter->m_aadEnergy));
+  memset(poMeter->m_adLoudness, 0, sizeof(poMeter->m_adLoudness));
+  poMeter->m_iRMSSegments = 1;
+  poMeter->m_dMomentarySum = poMeter->m_dShortTermSum = 0;
+}
+
+/*****************************************************************************/
+
+/** Sum the loudness energy of the last iSegmentCount segments. */
+double
+Meter::sumLoudness(const int iSegmentCount) const {
+  double dSum = 0;
+  for (int iBack = 1; iBack <= iSegmentCount; iBack++)
+    dSum += m_adLoudness[(m_iSegment - iBack + MT_MAX_SEGMENTS)
+			 % MT_MAX_SEGMENTS];
+  return dSum;
+}
+
+/*****************************************************************************/
+
+/** Recalculate the running sums from the ring. This is done when the
+    RMS window changes and once each time round the ring, which stops
+    rounding errors building up in the sums. */
+void
+Meter::sumWindows(const long lChannels) {
+  for (long lChannel = 0; lChannel < lChannels; lChannel++) {
+    double dSum = 0;
+    for (int iBack = 1; iBack <= m_iRMSSegments; iBack++)
+      dSum += m_aadEnergy[(m_iSegment - iBack + MT_MAX_SEGMENTS)
+			  % MT_MAX_SEGMENTS][lChannel];
+    m_adRMSSum[lChannel] = dSum;
+  }
+  m_dMomentarySum = sumLoudness(MT_MOMENTARY_SEGMENTS);
+  m_dShortTermSum = sumLoudness(MT_SHORT_TERM_SEGMENTS);
+}
+
+/*****************************************************************************/
+
+/** Move the completed segment into the ring and the running sums. The
+    segment leaving a window of n segments is the one n back from the
+    new one, which for the longest window is the one overwritten. */
+void
+Meter::endSegment(const long lChannels) {
+
+  const int iRMSLeaving 
+    = (m_iSegment - m_iRMSSegments + MT_MAX_SEGMENTS) % MT_MAX_SEGMENTS;
+  const int iMomentaryLeaving
+    = (m_iSegment - MT_MOMENTARY_SEGMENTS + MT_MAX_SEGMENTS) % MT_MAX_SEGMENTS;
+  const int iShortTermLeaving
+    = (m_iSegment - MT_SHORT_TERM_SEGMENTS + MT_MAX_SEGMENTS) % MT_MAX_SEGMENTS;
+
+  for (long lChannel = 0; lChannel < lChannels; lChannel++) {
+    m_adRMSSum[lChannel] 
+      += (m_adSegmentEnergy[lChannel] - m_aadEnergy[iRMSLeaving][lChannel]);
+    m_aadEnergy[m_iSegment][lChannel] = m_adSegmentEnergy[lChannel];
+    m_adSegmentEnergy[lChannel] = 0;
+  }
+  m_dMomentarySum 
+    += m_dSegmentLoudness - m_adLoudness[iMomentaryLeaving];
+  m_dShortTermSum 
+    += m_dSegmentLoudness - m_adLoudness[iShortTermLeaving];
+  m_adLoudness[m_iSegment] = m_dSegmentLoudness;
+  m_dSegmentLoudness = 0;
+  m_lSegmentFill = 0;
+
+  m_iSegment = (m_iSegment + 1) % MT_MAX_SEGMENTS;
+  if (m_iSegment == 0)
+    sumWindows(lChannels);
+}
+
+/*****************************************************************************/
+
+/** Run lSampleCount samples from lOffset through the K-weighting
+    filters and return the energy of the result, summed over the
+    channels. Each group of LANE_COUNT channels is filtered together;
+    lanes past the last channel repeat the first channel of their
+    group and are left out of the sum. */
+template <long lChannels>
+double
+Meter::weighLoudness(const unsigned long lOffset,
+		     const unsigned long lSampleCount) {
+
+  const Lanes vB0 = lanesSplat(m_sShelf.m_fB0);
+  const Lanes vB1 = lanesSplat(m_sShelf.m_fB1);
+  const Lanes vB2 = lanesSplat(m_sShelf.m_fB2);
+  const Lanes vA1 = lanesSplat(m_sShelf.m_fA1);
+  const Lanes vA2 = lanesSplat(m_sShelf.m_fA2);
+  const Lanes vHighPassA1 = lanesSplat(m_sHighPass.m_fA1);
+  const Lanes vHighPassA2 = lanesSplat(m_sHighPass.m_fA2);
+  const Lanes vTwo = lanesSplat(2);
+
+  double dEnergy = 0;
+  for (long lFirst = 0; lFirst < lChannels; lFirst += LANE_COUNT) {
+
+    const LADSPA_Data * apfInputs[LANE_COUNT];
+    int iLane;
+    for (iLane = 0; iLane < LANE_COUNT; iLane++)
+      apfInputs[iLane] 
+	= (m_ppfPorts[MT_INPUT(lFirst + iLane < lChannels
+			       ? lFirst + iLane 
+			       : lFirst)]
+	   + lOffset);
+
+    Lanes vShelfZ1 = lanesLoad(m_afShelfZ1 + lFirst);
+    Lanes vShelfZ2 = lanesLoad(m_afShelfZ2 + lFirst);
+    Lanes vHighPassZ1 = lanesLoad(m_afHighPassZ1 + lFirst);
+    Lanes vHighPassZ2 = lanesLoad(m_afHighPassZ2 + lFirst);
+    Lanes vSum = lanesSplat(0);
+
+    for (unsigned long lIndex = 0; lIndex < lSampleCount; lIndex++) {
+      const Lanes vInput = lanesGather(apfInputs, lIndex);
+      const Lanes vShelf = vB0 * vInput + vShelfZ1;
+      vShelfZ1 = vB1 * vInput - vA1 * vShelf + vShelfZ2;
+      vShelfZ2 = vB2 * vInput - vA2 * vShelf;
+      /* The highpass numerator is 1, -2, 1. */
+      const Lanes vOutput = vShelf + vHighPassZ1;
+      vHighPassZ1 = vHighPassZ2 - vTwo * vShelf - vHighPassA1 * vOutput;
+      vHighPassZ2 = vShelf - vHighPassA2 * vOutput;
+      vSum = vSum + vOutput * vOutput;
+    }
+
+    lanesStore(m_afShelfZ1 + lFirst, vShelfZ1);
+    lanesStore(m_afShelfZ2 + lFirst, vShelfZ2);
+    lanesStore(m_afHighPassZ1 + lFirst, vHighPassZ1);
+    lanesStore(m_afHighPassZ2 + lFirst, vHighPassZ2);
+
+    LADSPA_Data afSum[LANE_COUNT];
+    lanesStore(afSum, vSum);
+    for (iLane = 0; iLane < LANE_COUNT && lFirst + iLane < lChannels; iLane++)
+      dEnergy += afSum[iLane];
+  }
+
+  return dEnergy;
+}
+
+/*****************************************************************************/
+
+/** Loudness in LUFS of a mean square level over all channels. */
+static inline LADSPA_Data
+meterLoudness(const double dMeanSquare) {
+  /* Below the gate, avoiding the logarithm of zero. */
+  if (dMeanSquare < 1.17e-7)
+    return MT_MIN_LOUDNESS;
+  return LADSPA_Data(-0.691 + 10 * log10(dMeanSquare));
+}
+
+template <long lChannels>
+static void
+runMeter(LADSPA_Handle Instance,
+	 unsigned long SampleCount) {
+
+  Meter * poMeter = (Meter *)Instance;
+  LADSPA_Data ** ppfPorts = poMeter->m_ppfPorts;
+  long lChannel;
+
+  int iRMSSegments 
+    = int(*(ppfPorts[MT_RMS_WINDOW(lChannels)]) * MT_SEGMENTS_PER_SECOND
+	  + 0.5f);
+  if (iRMSSegments < 1)
+    iRMSSegments = 1;
+  else if (iRMSSegments > MT_MAX_SEGMENTS)
+    iRMSSegments = MT_MAX_SEGMENTS;
+  if (iRMSSegments != poMeter->m_iRMSSegments) {
+    poMeter->m_iRMSSegments = iRMSSegments;
+    poMeter->sumWindows(lChannels);
+  }
+
+  LADSPA_Data afBlockPeak[lChannels];
+  for (lChannel = 0; lChannel < lChannels; lChannel++)
+    afBlockPeak[lChannel] = 0;
+
+  unsigned long lDone = 0;
+  while (lDone < SampleCount) {
+
+    unsigned long lCount = poMeter->m_lSegmentLength - poMeter->m_lSegmentFill;
+    if (lCount > SampleCount - lDone)
+      lCount = SampleCount - lDone;
+
+    for (lChannel = 0; lChannel < lChannels; lChannel++) {
+      LADSPA_Data fSumOfSquares;
+      const LADSPA_Data fPeak 
+	= peakAndSumOfSquares(ppfPorts[MT_INPUT(lChannel)] + lDone,
+			      lCount,
+			      fSumOfSquares);
+      if (fPeak > afBlockPeak[lChannel])
+	afBlockPeak[lChannel] = fPeak;
+      poMeter->m_adSegmentEnergy[lChannel] += fSumOfSquares;
+    }
+    poMeter->m_dSegmentLoudness 
+      += poMeter->weighLoudness<lChannels>(lDone, lCount);
+
+    lDone += lCount;
+    poMeter->m_lSegmentFill += lCount;
+    if (poMeter->m_lSegmentFill == poMeter->m_lSegmentLength)
+      poMeter->endSegment(lChannels);
+  }
+
+  /* The held peaks decay once a block, by the amount they would have
+     fallen over it. */
+  const LADSPA_Data fDecay
+    = (SampleCount
+       ? calculate60dBDrag(*(ppfPorts[MT_PEAK_DECAY(lChannels)]),
+			   poMeter->m_fSampleRate / SampleCount)
+       : 1);
+  const double dRMSLength 
+    = double(poMeter->m_iRMSSegments) * poMeter->m_lSegmentLength;
+  for (lChannel = 0; lChannel < lChannels; lChannel++) {
+    LADSPA_Data & rfPeak = poMeter->m_afPeak[lChannel];
+    rfPeak *= fDecay;
+    if (afBlockPeak[lChannel] > rfPeak)
+      rfPeak = afBlockPeak[lChannel];
+    *(ppfPorts[MT_PEAK(lChannels, lChannel)]) = rfPeak;
+    const double dSum = poMeter->m_adRMSSum[lChannel];
+    *(ppfPorts[MT_RMS(lChannels, lChannel)]) 
+      = LADSPA_Data(dSum > 0 ? sqrt(dSum / dRMSLength) : 0);
+  }
+
+  *(ppfPorts[MT_MOMENTARY(lChannels)])
+    = meterLoudness(poMeter->m_dMomentarySum 
+		    / (double(MT_MOMENTARY_SEGMENTS) 
+		       * poMeter->m_lSegmentLength));
+  *(ppfPorts[MT_SHORT_TERM(lChannels)])
+    = meterLoudness(poMeter->m_dShortTermSum 
+		    / (double(MT_SHORT_TERM_SEGMENTS)
+		       * poMeter->m_lSegmentLength));
+}
+
+/*****************************************************************************/
+
 void
 initialise_peak() {
   
@@ -260,6 +687,7 @@ initialise_peak() {
      LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE,
      0,
      1);
+  psDescriptor->setRunBatch(runEnvelopeTrackerBatch<false, false>);
   registerNewPluginDescriptor(psDescriptor);
   
   psDescriptor = new CMT_Descriptor
@@ -290,6 +718,7 @@ initialise_peak() {
      LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE,
      0,
      1);
+  psDescriptor->setRunBatch(runEnvelopeTrackerBatch<true, false>);
   registerNewPluginDescriptor(psDescriptor);
   
   psDescriptor = new CMT_Descriptor
@@ -321,6 +750,7 @@ initialise_peak() {
       | LADSPA_HINT_DEFAULT_MAXIMUM),
      0,
      10);
+  psDescriptor->setRunBatch(runEnvelopeTrackerBatch<false, true>);
   registerNewPluginDescriptor(psDescriptor);
   
   psDescriptor = new CMT_Descriptor
@@ -352,6 +782,7 @@ initialise_peak() {
       | LADSPA_HINT_DEFAULT_MAXIMUM),
      0,
      10);
+  psDescriptor->setRunBatch(runEnvelopeTrackerBatch<true, true>);
   registerNewPluginDescriptor(psDescriptor);
   
   psDescriptor = new CMT_Descriptor
@@ -377,6 +808,91 @@ initialise_peak() {
      LADSPA_HINT_BOUNDED_BELOW,
      0);
   registerNewPluginDescriptor(psDescriptor);
+
+  const long plMeterChannels[] = { 2, 4, 6, 8, 16 };
+  LADSPA_Run_Function afMeterRunFunction[] = {
+    runMeter<2>,
+    runMeter<4>,
+    runMeter<6>,
+    runMeter<8>,
+    runMeter<16>
+  };
+
+  for (long lIndex = 0; lIndex < 5; lIndex++) {
+
+    const long lChannels = plMeterChannels[lIndex];
+    char acLabel[40];
+    char acName[100];
+    char acPortName[100];
+    sprintf(acLabel, "meter_%ld", lChannels);
+    sprintf(acName, "Level and Loudness Meter (%ld Channels)", lChannels);
+
+    psDescriptor = new CMT_Descriptor
+      (2017 + lIndex,
+       acLabel,
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       acName,
+       CMT_MAKER("Richard W.E. Furse"),
+       CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+       NULL,
+       CMT_Instantiate<Meter>,
+       activateMeter,
+       afMeterRunFunction[lIndex],
+       NULL,
+       NULL,
+       NULL);
+
+    long lChannel;
+    for (lChannel = 0; lChannel < lChannels; lChannel++) {
+      sprintf(acPortName, "Input %ld", lChannel + 1);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+	 acPortName);
+    }
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "RMS Window (s)",
+       (LADSPA_HINT_BOUNDED_BELOW
+	| LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_LOGARITHMIC
+	| LADSPA_HINT_DEFAULT_MIDDLE),
+       0.05f,
+       3);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Peak Decay (s/60dB)",
+       (LADSPA_HINT_BOUNDED_BELOW
+	| LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_DEFAULT_MIDDLE),
+       0,
+       10);
+    for (lChannel = 0; lChannel < lChannels; lChannel++) {
+      sprintf(acPortName, "Peak (Input %ld)", lChannel + 1);
+      psDescriptor->addPort
+	(LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+	 acPortName,
+	 LADSPA_HINT_BOUNDED_BELOW,
+	 0);
+      sprintf(acPortName, "RMS (Input %ld)", lChannel + 1);
+      psDescriptor->addPort
+	(LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+	 acPortName,
+	 LADSPA_HINT_BOUNDED_BELOW,
+	 0);
+    }
+    psDescriptor->addPort
+      (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+       "Momentary Loudness (LUFS)",
+       LADSPA_HINT_BOUNDED_BELOW,
+       MT_MIN_LOUDNESS);
+    psDescriptor->addPort
+      (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL,
+       "Short-Term Loudness (LUFS)",
+       LADSPA_HINT_BOUNDED_BELOW,
+       MT_MIN_LOUDNESS);
+
+    registerNewPluginDescriptor(psDescriptor);
+  }
 }
 
 /*****************************************************************************/
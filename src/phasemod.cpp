@@ -24,8 +24,12 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include "cmt.h"
+#include "gate.h"
+#include "run_adding.h"
+#include "voices.h"
 
 #define PORT_OUT            0
 #define PORT_GATE           1
@@ -43,6 +47,9 @@
 
 #define NUM_PORTS           46
 
+/* PhaseMod runs each DCO over this many samples at a time. */
+#define PHASEMOD_CHUNK      64
+
 #ifndef PI
 #define PI 3.14159265358979F
 #endif
@@ -55,6 +62,19 @@ typedef struct Envelope
   Envelope () : envelope_decay (0), envelope (0.0) {}
 } Envelope;
 
+/* Per-block values for one DCO. */
+typedef struct DCOBlock
+{
+  int          gate;
+  LADSPA_Data  inc;
+  LADSPA_Data  modulation;
+  LADSPA_Data  attack;
+  LADSPA_Data  decay;
+  LADSPA_Data  sustain;
+  LADSPA_Data  release;
+  LADSPA_Data  velocity;
+} DCOBlock;
+
 class PhaseMod : public CMT_PluginInstance
 {
   LADSPA_Data sample_rate;
@@ -64,16 +84,29 @@ class PhaseMod : public CMT_PluginInstance
   Envelope    dco_env[6];
   LADSPA_Data dco_accum[6];
 
+  /* The last octave setting of each DCO and 2 to its power. */
+  LADSPA_Data dco_octave[6];
+  double      dco_octave_scale[6];
+
+  LADSPA_Data run_adding_gain;
+
+  PRNG        random;
+
 public:
   PhaseMod(const LADSPA_Descriptor * Descriptor,
            unsigned long             SampleRate)
     : CMT_PluginInstance(NUM_PORTS),
       sample_rate (SampleRate),
-      trigger (0) {
+      trigger (0),
+      run_adding_gain (1.0) {
     int i;
 
     for (i = 0; i < 6; i++)
-      dco_accum[i] = 0.0;
+      {
+        dco_accum[i] = 0.0;
+        dco_octave[i] = 0.0;
+        dco_octave_scale[i] = 1.0;
+      }
   }
 
   ~PhaseMod () {
@@ -127,11 +160,16 @@ public:
       }
   }
 
+  /* Advance the phase by inc and return the waveform at that phase
+     offset by phasemod. The waveform is a template parameter so that
+     run_dco() is compiled once for each waveform and has no branches
+     on it. */
+  template <int waveform>
   static inline LADSPA_Data
-  osc(int          waveform,
-      LADSPA_Data  inc,
+  osc(LADSPA_Data  inc,
       LADSPA_Data  phasemod,
-      LADSPA_Data *accum) {
+      LADSPA_Data *accum,
+      PRNG        &random) {
     LADSPA_Data pos;
 
     *accum += inc;
@@ -142,36 +180,47 @@ public:
     while (pos < 0.0F) pos += 1.0F;
     while (pos > 1.0F) pos -= 1.0F;
 
-    /* 0 = Sine wave */
-    if (waveform == 0)
-      return sin (pos * 2.0 * PI);
+    switch (waveform)
+      {
+      /* 0 = Sine wave */
+      case 0:
+        return sin (pos * 2.0 * PI);
 
-    /* 1 = Triangle wave */
-    else if (waveform == 1)
-      return tri (pos);
+      /* 1 = Triangle wave */
+      case 1:
+        return tri (pos);
 
-    /* 2 = Square wave */
-    else if (waveform == 2)
-      return (pos > 0.5) ? 1.0F : -1.0F;
+      /* 2 = Square wave */
+      case 2:
+        return (pos > 0.5) ? 1.0F : -1.0F;
 
-    /* 3 = Sawtooth wave */
-    else if (waveform == 3)
-      return pos * 2.0F - 1.0F;
+      /* 3 = Sawtooth wave */
+      case 3:
+        return pos * 2.0F - 1.0F;
 
-    /* 4 = Fullwave Rectified Sine wave */
-    else if (waveform == 4)
-      return fabs (pos * PI);
+      /* 4 = Fullwave Rectified Sine wave */
+      case 4:
+        return fabs (pos * PI);
 
-    /* 5 = Static */
-    else
-      return (rand () & 1) ? -1.0F : 1.0F;
+      /* 5 = Static */
+      default:
+        return (random.nextInteger () & 1) ? -1.0F : 1.0F;
+      }
   }
 
+  /* Phase increment per sample of DCO i. 2^octave is only
+     recalculated when the octave port changes. */
   static LADSPA_Data
-  calc_inc(LADSPA_Data oct,
-           LADSPA_Data freq,
-           LADSPA_Data sample_rate) {
-    return pow (2.0, oct) * freq / sample_rate;
+  calc_inc(PhaseMod    *phasemod,
+           int          i,
+           LADSPA_Data  oct,
+           LADSPA_Data  freq) {
+    if (oct != phasemod->dco_octave[i])
+      {
+        phasemod->dco_octave[i] = oct;
+        phasemod->dco_octave_scale[i] = pow (2.0, oct);
+      }
+    return phasemod->dco_octave_scale[i] * freq / phasemod->sample_rate;
   }
 
   static inline LADSPA_Data
@@ -180,6 +229,72 @@ public:
     return 1.0 - pow (0.05, 1.0 / (phasemod->sample_rate * value));
   }
 
+  /* Run DCO j over a chunk of samples. prev holds the output of the
+     DCO before, which phase modulates this one, and is replaced by
+     this DCO's output. A carrier is a DCO whose output is heard and
+     is added to sum. */
+  template <int waveform, bool carrier>
+  static void
+  run_dco(PhaseMod       *phasemod,
+          int             j,
+          const DCOBlock *block,
+          LADSPA_Data    *prev,
+          LADSPA_Data    *sum,
+          unsigned long   count) {
+    Envelope env = phasemod->dco_env[j];
+    LADSPA_Data accum = phasemod->dco_accum[j];
+
+    for (unsigned long i = 0; i < count; i++)
+      {
+        prev[i] =
+          envelope (&env,
+                    block->gate, block->attack, block->decay,
+                    block->sustain, block->release) *
+          osc<waveform> (block->inc, prev[i] * block->modulation,
+                         &accum, phasemod->random) *
+          block->velocity;
+
+        if (carrier)
+          sum[i] += prev[i];
+      }
+
+    phasemod->dco_env[j] = env;
+    phasemod->dco_accum[j] = accum;
+  }
+
+  typedef void DCOFunction(PhaseMod *, int, const DCOBlock *,
+                           LADSPA_Data *, LADSPA_Data *, unsigned long);
+
+  /* The specialisation of run_dco() for a waveform and routing. */
+  static DCOFunction *
+  dco_function(int  waveform,
+               bool carrier) {
+    static DCOFunction * const functions[6][2] =
+      {
+        { run_dco<0, false>, run_dco<0, true> },
+        { run_dco<1, false>, run_dco<1, true> },
+        { run_dco<2, false>, run_dco<2, true> },
+        { run_dco<3, false>, run_dco<3, true> },
+        { run_dco<4, false>, run_dco<4, true> },
+        { run_dco<5, false>, run_dco<5, true> }
+      };
+
+    if (waveform < 0 || waveform > 5)
+      waveform = 5;
+    return functions[waveform][carrier ? 1 : 0];
+  }
+
+  static void
+  set_run_adding_gain(LADSPA_Handle Instance,
+                      LADSPA_Data   gain) {
+    ((PhaseMod*) Instance)->run_adding_gain = gain;
+  }
+
+  /* The routing and waveforms are looked at once per block to choose
+     a run_dco() for each DCO. The DCOs are then run in turn over
+     chunks of the block, which is possible as each only depends on
+     the output of the one before it at the same sample. */
+  template <OutputFunction write_output>
   static void
   run(LADSPA_Handle Instance,
       unsigned long SampleCount) {
@@ -187,13 +302,14 @@ public:
 
     unsigned long   i, j;
     int             gate;
-    int             waveform[6];
-    int             store[6];
-    LADSPA_Data     inc[6];
-    LADSPA_Data     attack[6];
-    LADSPA_Data     decay[6];
-    LADSPA_Data     release[6];
+    int             carriers;
+    bool            carrier[6];
+    DCOFunction    *function[6];
+    DCOBlock        block[6];
+    LADSPA_Data     prev[PHASEMOD_CHUNK];
+    LADSPA_Data     sum[PHASEMOD_CHUNK];
     LADSPA_Data   **ports;
+    LADSPA_Data    *out;
     LADSPA_Data     vol;
 
     ports = phasemod->m_ppfPorts;
@@ -205,54 +321,396 @@ public:
 
     phasemod->trigger = gate;
 
+    carriers = 1;
+    for (i = 0; i < 5; i++)
+      {
+        carrier[i] = (*ports[PORT_DCO_MODULATION + (i + 1) * DCO_MULTIPLIER] < 0.0001);
+        if (carrier[i])
+          carriers++;
+      }
+    carrier[5] = true;
+    vol = 1.0 / carriers;
+    vol *= get_gain<write_output> (phasemod->run_adding_gain);
+
     for (i = 0; i < 6; i++)
       {
         int offset = DCO_MULTIPLIER * i;
 
-        waveform[i] = (int) *ports[PORT_DCO_WAVEFORM + offset];
-        inc[i] = calc_inc (*ports[PORT_DCO_OCTAVE + offset],
-                           *ports[PORT_FREQ],
-                           phasemod->sample_rate);
-        attack[i] = multiplier (phasemod, *ports[PORT_DCO_ATTACK + offset]);
-        decay[i] = multiplier (phasemod, *ports[PORT_DCO_DECAY + offset]);
-        release[i] = multiplier (phasemod, *ports[PORT_DCO_RELEASE + offset]);
+        function[i] = dco_function ((int) *ports[PORT_DCO_WAVEFORM + offset], carrier[i]);
+        block[i].gate = gate;
+        block[i].inc = calc_inc (phasemod, i, *ports[PORT_DCO_OCTAVE + offset],
+                                 *ports[PORT_FREQ]);
+        block[i].modulation = *ports[PORT_DCO_MODULATION + offset];
+        block[i].attack = multiplier (phasemod, *ports[PORT_DCO_ATTACK + offset]);
+        block[i].decay = multiplier (phasemod, *ports[PORT_DCO_DECAY + offset]);
+        block[i].sustain = *ports[PORT_DCO_SUSTAIN + offset];
+        block[i].release = multiplier (phasemod, *ports[PORT_DCO_RELEASE + offset]);
+        block[i].velocity = *ports[PORT_VELOCITY];
       }
 
-    j = 1;
-    for (i = 0; i < 5; i++)
-      if (*ports[PORT_DCO_MODULATION + (i + 1) * DCO_MULTIPLIER] < 0.0001)
-        store[i] = 1, j++;
-      else
-        store[i] = 0;
-    store[5] = 1;
-    vol = 1.0 / j;
-
-    for (i = 0; i < SampleCount; i++)
+    out = ports[PORT_OUT];
+    for (unsigned long start = 0; start < SampleCount; start += PHASEMOD_CHUNK)
       {
-        LADSPA_Data sample;
-        LADSPA_Data prev;
+        const unsigned long count
+          = SampleCount - start < PHASEMOD_CHUNK ? SampleCount - start : PHASEMOD_CHUNK;
 
-        sample = 0.0;
-        prev = 1.0;
+        for (i = 0; i < count; i++)
+          {
+            prev[i] = 1.0;
+            sum[i] = 0.0;
+          }
         for (j = 0; j < 6; j++)
+          function[j] (phasemod, j, &block[j], prev, sum, count);
+        for (i = 0; i < count; i++)
+          write_output (out, sum[i] * vol, 1.0F);
+      }
+  }
+
+  /* As run(), taking the gate as an audio signal (see gate.h). */
+  template <OutputFunction write_output>
+  static void
+  run_audio_gate(LADSPA_Handle Instance,
+                unsigned long SampleCount) {
+    runWithAudioGate (Instance, ((PhaseMod*) Instance)->m_ppfPorts, SampleCount,
+                      PORT_GATE, 1 << PORT_OUT, run<write_output>);
+  }
+};
+
+/*****************************************************************************/
+
+/* Polyphonic phase modulated voice. As the polyphonic organ, one
+   instance holds a pool of voices sharing the DCO controls, and each
+   key has its own gate, velocity and frequency ports (see
+   voices.h). A rising gate restarts the envelopes of a voice as it
+   does for PhaseMod.
+
+   Four voices are run at a time in SIMD lanes. Each block is worked
+   through a chunk at a time, running each of the six DCOs over the
+   chunk in turn: a DCO only depends on the output of the one before
+   it at the same sample, which is kept for the chunk. Each DCO runs
+   in a loop specialised for its waveform and for whether it is heard,
+   so nothing is decided per sample. Sines come from a polynomial,
+   which differs from PhaseMod by a few parts in a million. */
+
+#define POLY_PORT_OUT         0
+
+/* The shared controls are those of PhaseMod from PORT_DCO_MODULATION
+   on, in the same order. */
+#define POLY_PORT_SHARED(p)   ((p) - PORT_DCO_MODULATION + 1)
+#define POLY_NUM_SHARED       POLY_PORT_SHARED (NUM_PORTS)
+
+#define POLY_PORT_GATE(k)     (POLY_NUM_SHARED + 3 * (k))
+#define POLY_PORT_VELOCITY(k) (POLY_PORT_GATE (k) + 1)
+#define POLY_PORT_FREQ(k)     (POLY_PORT_GATE (k) + 2)
+
+#define POLY_VOICES_PER_KEY   2
+#define POLY_CHUNK            64
+
+/* Per-block values for the DCOs, shared by all voices. */
+typedef struct PolyDCOs
+{
+  int           waveform[6];
+  bool          carrier[6];
+  double        octave[6];
+  Lanes         modulation[6];
+  VoiceEnvelope envelope[6];
+  Lanes         vol;
+} PolyDCOs;
+
+/* Per-block values for a group of voices. */
+typedef struct PolyLanes
+{
+  Lanes    inc[6];
+  Lanes    velocity;
+  LaneMask gate;
+} PolyLanes;
+
+class PolyPhaseMod : public CMT_PluginInstance
+{
+  LADSPA_Data    sample_rate;
+  VoiceAllocator voices;
+  PRNG           random;
+
+  /* Voice state, as the members of PhaseMod. env_decay is 1 once an
+     envelope has passed its attack. */
+  LADSPA_Data env[6][VOICE_MAX_VOICES];
+  LADSPA_Data env_decay[6][VOICE_MAX_VOICES];
+  LADSPA_Data dco_accum[6][VOICE_MAX_VOICES];
+  LADSPA_Data freq[VOICE_MAX_VOICES];
+  LADSPA_Data velocity[VOICE_MAX_VOICES];
+
+public:
+  PolyPhaseMod(const LADSPA_Descriptor * Descriptor,
+               unsigned long             SampleRate)
+    : CMT_PluginInstance(Descriptor->PortCount),
+      sample_rate (SampleRate),
+      voices ((Descriptor->PortCount - POLY_NUM_SHARED) / 3,
+              (Descriptor->PortCount - POLY_NUM_SHARED) / 3 * POLY_VOICES_PER_KEY) {
+    activate (this);
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    PolyPhaseMod *phasemod = (PolyPhaseMod*) Instance;
+
+    for (int v = 0; v < VOICE_MAX_VOICES; v++)
+      start_voice (phasemod, v);
+    phasemod->voices.reset ();
+  }
+
+  /* Clear the state of a voice, as activating PhaseMod does. */
+  static void
+  start_voice(PolyPhaseMod *phasemod,
+              int           v) {
+    for (int j = 0; j < 6; j++)
+      phasemod->env[j][v] = phasemod->env_decay[j][v] = phasemod->dco_accum[j][v] = 0.0F;
+    phasemod->freq[v] = phasemod->velocity[v] = 0.0F;
+  }
+
+  /* Start, update and release voices from the key ports. A stolen
+     voice carries on from its current envelope levels, as a
+     retriggered PhaseMod does. */
+  static void
+  update_keys(PolyPhaseMod *phasemod) {
+    LADSPA_Data **ports = phasemod->m_ppfPorts;
+    LADSPA_Data level[VOICE_MAX_VOICES];
+
+    for (int v = 0; v < phasemod->voices.getVoiceCount (); v++)
+      {
+        level[v] = 0.0F;
+        for (int j = 0; j < 6; j++)
+          level[v] += phasemod->env[j][v];
+      }
+
+    for (int k = 0; k < phasemod->voices.getKeyCount (); k++)
+      {
+        int event;
+        int v = phasemod->voices.followKey (k, *ports[POLY_PORT_GATE (k)] > 0.0,
+                                            level, event);
+
+        if (event == VOICE_STARTED)
+          start_voice (phasemod, v);
+        else if (event == VOICE_STOLEN)
+          for (int j = 0; j < 6; j++)
+            phasemod->env_decay[j][v] = 0.0F;
+
+        if (v >= 0 && phasemod->voices.isHeld (v))
           {
-            int offset = DCO_MULTIPLIER * j;
-
-            prev =
-              envelope (&phasemod->dco_env[j],
-                        gate, attack[j], decay[j],
-                        *ports[PORT_DCO_SUSTAIN + offset], release[j]) *
-              osc (waveform[j], inc[j],
-                   prev * *ports[PORT_DCO_MODULATION + offset],
-                   &phasemod->dco_accum[j]) *
-              *ports[PORT_VELOCITY];
-
-            if (store[j])
-              sample += prev;
+            phasemod->freq[v] = *ports[POLY_PORT_FREQ (k)];
+            phasemod->velocity[v] = *ports[POLY_PORT_VELOCITY (k)];
           }
-        ports[PORT_OUT][i] = sample * vol;
       }
   }
+
+  static inline Lanes
+  tri(Lanes x) {
+    x = lanesSelect (x > lanesSplat (0.75F), x - 1.0F,
+                     lanesSelect (x > lanesSplat (0.25F), lanesSplat (0.5F) - x, x));
+    return x * 4.0F;
+  }
+
+  /* One sample of waveform for four voices at phase pos, as
+     PhaseMod::osc(). noise holds a random value for each lane for
+     the static waveform. */
+  template <int waveform>
+  static inline Lanes
+  osc(const Lanes        pos,
+      const LADSPA_Data *noise) {
+    const Lanes one = lanesSplat (1.0F);
+
+    switch (waveform)
+      {
+      case 0:
+        return lanesSine (pos);
+      case 1:
+        return tri (pos);
+      case 2:
+        return lanesSelect (pos > lanesSplat (0.5F), one, lanesSplat (-1.0F));
+      case 3:
+        return pos * 2.0F - one;
+      case 4:
+        /* As PhaseMod, where the phase is never negative. */
+        return pos * PI;
+      default:
+        return lanesSelect (lanesLoad (noise) < lanesSplat (0.0F), lanesSplat (-1.0F), one);
+      }
+  }
+
+  /* Run DCO j and its envelope for a group of voices over a chunk.
+     prev holds the output of the DCO before, which phase modulates
+     this one, and is replaced with this DCO's output. A carrier is
+     one whose output is heard, and is added to sum. */
+  template <int waveform, bool carrier>
+  static void
+  run_dco(PolyPhaseMod    *phasemod,
+          int              group,
+          int              j,
+          const PolyDCOs  *dcos,
+          const PolyLanes *lanes,
+          Lanes           *prev,
+          Lanes           *sum,
+          unsigned long    count) {
+    Lanes accum = lanesLoad (phasemod->dco_accum[j] + group);
+    Lanes env = lanesLoad (phasemod->env[j] + group);
+    LaneMask decay = lanesLoad (phasemod->env_decay[j] + group) > lanesSplat (0.0F);
+    const Lanes inc = lanes->inc[j];
+    const Lanes modulation = dcos->modulation[j];
+    LADSPA_Data noise[waveform == 5 ? POLY_CHUNK * LANE_COUNT : 1];
+
+    if (waveform == 5)
+      phasemod->random.fillBipolar (noise, count * LANE_COUNT);
+
+    for (unsigned long i = 0; i < count; i++)
+      {
+        accum = lanesWrap (accum + inc);
+        const Lanes pos = lanesWrap (accum + prev[i] * modulation);
+        prev[i] = runVoiceEnvelope (env, decay, lanes->gate, dcos->envelope[j])
+          * osc<waveform> (pos, noise + (waveform == 5 ? i * LANE_COUNT : 0))
+          * lanes->velocity;
+        if (carrier)
+          sum[i] = sum[i] + prev[i];
+      }
+
+    lanesStore (phasemod->dco_accum[j] + group, accum);
+    lanesStore (phasemod->env[j] + group, env);
+    lanesStore (phasemod->env_decay[j] + group,
+                lanesSelect (decay, lanesSplat (1.0F), lanesSplat (0.0F)));
+  }
+
+  template <bool carrier>
+  static void
+  run_dco(PolyPhaseMod    *phasemod,
+          int              group,
+          int              j,
+          const PolyDCOs  *dcos,
+          const PolyLanes *lanes,
+          Lanes           *prev,
+          Lanes           *sum,
+          unsigned long    count) {
+    switch (dcos->waveform[j])
+      {
+      case 0:
+        run_dco<0, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      case 1:
+        run_dco<1, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      case 2:
+        run_dco<2, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      case 3:
+        run_dco<3, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      case 4:
+        run_dco<4, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      default:
+        run_dco<5, carrier> (phasemod, group, j, dcos, lanes, prev, sum, count);
+        break;
+      }
+  }
+
+  static inline LADSPA_Data
+  multiplier(PolyPhaseMod *phasemod,
+             LADSPA_Data   value) {
+    return 1.0 - pow (0.05, 1.0 / (phasemod->sample_rate * value));
+  }
+
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+  PolyPhaseMod *phasemod = (PolyPhaseMod*) Instance;
+  LADSPA_Data **ports = phasemod->m_ppfPorts;
+  PolyDCOs dcos;
+  PolyLanes lanes;
+  Lanes prev[POLY_CHUNK];
+  Lanes sum[POLY_CHUNK];
+  int carriers = 1;
+  int j, v;
+  bool add = false;
+
+  update_keys (phasemod);
+
+  /* Everything that does not depend on the voice is worked out once
+     per block. As in PhaseMod, DCO6 is always heard and the others
+     are heard when the next DCO is not modulated by them. */
+  for (j = 0; j < 6; j++)
+    {
+      const int offset = DCO_MULTIPLIER * j;
+
+      dcos.waveform[j] = (int) *ports[POLY_PORT_SHARED (PORT_DCO_WAVEFORM + offset)];
+      dcos.octave[j] = pow (2.0, *ports[POLY_PORT_SHARED (PORT_DCO_OCTAVE + offset)]);
+      dcos.modulation[j] = lanesSplat (*ports[POLY_PORT_SHARED (PORT_DCO_MODULATION + offset)]);
+      setVoiceEnvelope (dcos.envelope[j],
+                        multiplier (phasemod, *ports[POLY_PORT_SHARED (PORT_DCO_ATTACK + offset)]),
+                        multiplier (phasemod, *ports[POLY_PORT_SHARED (PORT_DCO_DECAY + offset)]),
+                        *ports[POLY_PORT_SHARED (PORT_DCO_SUSTAIN + offset)],
+                        multiplier (phasemod, *ports[POLY_PORT_SHARED (PORT_DCO_RELEASE + offset)]));
+      dcos.carrier[j] = (j == 5
+                         || *ports[POLY_PORT_SHARED (PORT_DCO_MODULATION + offset + DCO_MULTIPLIER)]
+                            < 0.0001);
+      if (j < 5 && dcos.carrier[j])
+        carriers++;
+    }
+  dcos.vol = lanesSplat (1.0 / carriers);
+
+  for (int group = 0; group < phasemod->voices.getVoiceCount (); group += LANE_COUNT)
+    {
+      if (!phasemod->voices.isGroupActive (group))
+        continue;
+
+      for (j = 0; j < 6; j++)
+        {
+          LADSPA_Data inc[LANE_COUNT];
+
+          for (int l = 0; l < LANE_COUNT; l++)
+            inc[l] = dcos.octave[j] * phasemod->freq[group + l] / phasemod->sample_rate;
+          lanes.inc[j] = lanesLoad (inc);
+        }
+      lanes.velocity = lanesLoad (phasemod->velocity + group);
+      lanes.gate = lanesSet (phasemod->voices.isHeld (group) ? 1.0F : 0.0F,
+                             phasemod->voices.isHeld (group + 1) ? 1.0F : 0.0F,
+                             phasemod->voices.isHeld (group + 2) ? 1.0F : 0.0F,
+                             phasemod->voices.isHeld (group + 3) ? 1.0F : 0.0F)
+        > lanesSplat (0.0F);
+
+      for (unsigned long start = 0; start < SampleCount; start += POLY_CHUNK)
+        {
+          const unsigned long count
+            = SampleCount - start < POLY_CHUNK ? SampleCount - start : POLY_CHUNK;
+          LADSPA_Data *out = ports[POLY_PORT_OUT] + start;
+
+          for (unsigned long i = 0; i < count; i++)
+            {
+              prev[i] = lanesSplat (1.0F);
+              sum[i] = lanesSplat (0.0F);
+            }
+          for (j = 0; j < 6; j++)
+            if (dcos.carrier[j])
+              run_dco<true> (phasemod, group, j, &dcos, &lanes, prev, sum, count);
+            else
+              run_dco<false> (phasemod, group, j, &dcos, &lanes, prev, sum, count);
+          for (unsigned long i = 0; i < count; i++)
+            out[i] = (add ? out[i] : 0.0F) + lanesSum (sum[i] * dcos.vol);
+        }
+      add = true;
+    }
+
+  if (!add)
+    for (unsigned long i = 0; i < SampleCount; i++)
+      ports[POLY_PORT_OUT][i] = 0.0F;
+
+  /* Return voices that have died away to the pool. */
+  for (v = 0; v < phasemod->voices.getVoiceCount (); v++)
+    if (phasemod->voices.isActive (v) && !phasemod->voices.isHeld (v))
+      {
+        bool silent = true;
+        for (j = 0; j < 6; j++)
+          silent = silent && phasemod->env[j][v] < VOICE_SILENCE;
+        if (silent)
+          phasemod->voices.retireVoice (v);
+      }
+}
 };
 
 static LADSPA_PortDescriptor g_psPortDescriptors[] =
@@ -447,9 +905,9 @@ initialise_phasemod() {
        NULL,
        CMT_Instantiate<PhaseMod>,
        PhaseMod::activate,
-       PhaseMod::run,
-       NULL,
-       NULL,
+       PhaseMod::run<write_output_normal>,
+       PhaseMod::run<write_output_adding>,
+       PhaseMod::set_run_adding_gain,
        NULL);
 
   for (int i = 0; i < NUM_PORTS; i++)
@@ -461,4 +919,84 @@ initialise_phasemod() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2028,
+       "phasemod_audio_gate",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Phase Modulated Voice (Audio Gate)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("2001", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<PhaseMod>,
+       PhaseMod::activate,
+       PhaseMod::run_audio_gate<write_output_normal>,
+       PhaseMod::run_audio_gate<write_output_adding>,
+       PhaseMod::set_run_adding_gain,
+       NULL);
+
+  for (int i = 0; i < NUM_PORTS; i++)
+    if (i == PORT_GATE)
+      psDescriptor->addPort(
+        LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+        g_psPortNames[i]);
+    else
+      psDescriptor->addPort(
+        g_psPortDescriptors[i],
+        g_psPortNames[i],
+        g_psPortRangeHints[i].HintDescriptor,
+        g_psPortRangeHints[i].LowerBound,
+        g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
+
+  const char * poly_labels[] = { "phasemod_poly8", "phasemod_poly16" };
+  const char * poly_names[] = {
+    "Polyphonic Phase Modulated Voice (8 Keys)",
+    "Polyphonic Phase Modulated Voice (16 Keys)"
+  };
+  const int poly_keys[] = { 8, 16 };
+
+  for (int p = 0; p < 2; p++)
+    {
+      psDescriptor = new CMT_Descriptor
+          (1997 + p,
+           poly_labels[p],
+           LADSPA_PROPERTY_HARD_RT_CAPABLE,
+           poly_names[p],
+           CMT_MAKER("David A. Bartold"),
+           CMT_COPYRIGHT("2001", "David A. Bartold"),
+           NULL,
+           CMT_Instantiate<PolyPhaseMod>,
+           PolyPhaseMod::activate,
+           PolyPhaseMod::run,
+           NULL,
+           NULL,
+           NULL);
+
+      psDescriptor->addPort(
+        g_psPortDescriptors[PORT_OUT],
+        g_psPortNames[PORT_OUT]);
+      for (int i = PORT_DCO_MODULATION; i < NUM_PORTS; i++)
+        psDescriptor->addPort(
+          g_psPortDescriptors[i],
+          g_psPortNames[i],
+          g_psPortRangeHints[i].HintDescriptor,
+          g_psPortRangeHints[i].LowerBound,
+          g_psPortRangeHints[i].UpperBound);
+      for (int k = 0; k < poly_keys[p]; k++)
+        for (int i = PORT_GATE; i <= PORT_FREQ; i++)
+          {
+            char name[64];
+            sprintf (name, "%s %d", g_psPortNames[i], k + 1);
+            psDescriptor->addPort(
+              g_psPortDescriptors[i],
+              name,
+              g_psPortRangeHints[i].HintDescriptor,
+              g_psPortRangeHints[i].LowerBound,
+              g_psPortRangeHints[i].UpperBound);
+          }
+
+      registerNewPluginDescriptor(psDescriptor);
+    }
 }
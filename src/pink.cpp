@@ -40,9 +40,13 @@ namespace pink {
     enum {
 	port_frequency   = 0,
 	port_output      = 1,
-	n_ports          = 2
+	port_seed        = 2,
+	n_ports          = 3
     };
     
+    class Plugin;
+
+    static void restart(Plugin &p);
     static void activate(LADSPA_Handle instance);
     static void run_interpolated_audio(LADSPA_Handle instance,
                                        unsigned long sample_count);
@@ -75,6 +79,7 @@ namespace pink {
 	    delete [] data_points;
 	}
 	
+	friend void restart(Plugin &p);
 	friend void activate(LADSPA_Handle instance);
 	
 	friend void run_interpolated_audio(LADSPA_Handle instance,
@@ -85,10 +90,7 @@ namespace pink {
 	
     };
     
-    static void activate(LADSPA_Handle instance) {
-	Plugin *pp = (Plugin *) instance;
-	Plugin &p  = *pp;
-	
+    static void restart(Plugin &p) {
 	p.noise_source.reset();
 	for (int i=0; i<4; ++i)
 	    p.data_points[i] = p.noise_source.getValue();
@@ -97,6 +99,14 @@ namespace pink {
 	p.multiplier = 1;
     }
 
+    static void activate(LADSPA_Handle instance) {
+	Plugin *pp = (Plugin *) instance;
+	Plugin &p  = *pp;
+	
+	p.noise_source.getRandom().resetSeedPort();
+	restart(p);
+    }
+
     static inline float thirdInterp(const float &x,
                                     const float &L1,const float &L0,
                                     const float &H0,const float &H1) {
@@ -119,6 +129,9 @@ namespace pink {
 	LADSPA_Data   frequency = *pp->m_ppfPorts[port_frequency];
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
 
+	if (p.noise_source.getRandom().followSeedPort(*pp->m_ppfPorts[port_seed]))
+	    restart(p);
+
 	if (frequency<=0) {
 	    LADSPA_Data value = thirdInterp( 1 - p.counter*p.multiplier,
 					     p.data_points[  p.first_point        ],
@@ -184,7 +197,7 @@ namespace pink {
 	CMT_Descriptor * d = new CMT_Descriptor
 	    (1841,
 	     "pink_interpolated_audio",
-	     0,
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
 	     "Pink Noise (Interpolated)",
 	     CMT_MAKER("Nathaniel Virgo"),
 	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
@@ -207,6 +220,12 @@ namespace pink {
 	d->addPort
 	    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
 	     "Output");
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     PRNG_SEED_PORT_NAME,
+	     PRNG_SEED_PORT_HINTS,
+	     0,
+	     0);
 	registerNewPluginDescriptor(d);
 
 	// the following has been commented out because I'm pretty sure that
@@ -40,8 +40,9 @@ namespace pink_full {
 
     enum {
 	port_output      = 0,
+	port_seed        = 1,
 
-	n_ports          = 1
+	n_ports          = 2
     };
     
     static void activate(LADSPA_Handle instance);
@@ -73,6 +74,7 @@ namespace pink_full {
 	Plugin *pp = (Plugin *) instance;
 	Plugin &p  = *pp;
 	
+	p.noise_source.getRandom().resetSeedPort();
 	p.noise_source.reset();
     }
 
@@ -84,15 +86,17 @@ namespace pink_full {
 
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
 
-	for (unsigned long i=0; i<sample_count; ++i)
-	    *(out++) = p.noise_source.getValue2();
+	if (p.noise_source.getRandom().followSeedPort(*pp->m_ppfPorts[port_seed]))
+	    p.noise_source.reset();
+
+	p.noise_source.getValues2(out, sample_count);
     }
 
     void initialise() {
 	CMT_Descriptor * d = new CMT_Descriptor
 	    (1844,
 	     "pink_full_frequency",
-	     0,
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
 	     "Pink Noise (full frequency range)",
 	     CMT_MAKER("Nathaniel Virgo"),
 	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
@@ -106,6 +110,12 @@ namespace pink_full {
 	d->addPort
 	    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
 	     "Output");
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     PRNG_SEED_PORT_NAME,
+	     PRNG_SEED_PORT_HINTS,
+	     0,
+	     0);
 	registerNewPluginDescriptor(d);
     }
 
@@ -41,7 +41,8 @@ namespace pink_sh {
     enum {
 	port_frequency   = 0,
 	port_output      = 1,
-	n_ports          = 2
+	port_seed        = 2,
+	n_ports          = 3
     };
     
     static void activate(LADSPA_Handle instance);
@@ -77,6 +78,7 @@ namespace pink_sh {
 	Plugin *pp = (Plugin *) instance;
 	Plugin &p  = *pp;
 	
+	p.noise_source.getRandom().resetSeedPort();
 	p.noise_source.reset();
 	p.counter = 0;
     }
@@ -90,6 +92,11 @@ namespace pink_sh {
 	LADSPA_Data   frequency = *pp->m_ppfPorts[port_frequency];
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
 
+	if (p.noise_source.getRandom().followSeedPort(*pp->m_ppfPorts[port_seed])) {
+	    p.noise_source.reset();
+	    p.counter = 0;
+	}
+
 	frequency = BOUNDED_ABOVE(frequency,p.sample_rate);
 	unsigned remain = sample_count;
 
@@ -118,7 +125,7 @@ namespace pink_sh {
 	CMT_Descriptor * d = new CMT_Descriptor
 	    (1843,
 	     "pink_sh",
-	     0,
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
 	     "Pink Noise (sample and hold)",
 	     CMT_MAKER("Nathaniel Virgo"),
 	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
@@ -140,6 +147,12 @@ namespace pink_sh {
 	d->addPort
 	    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
 	     "Output");
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     PRNG_SEED_PORT_NAME,
+	     PRNG_SEED_PORT_HINTS,
+	     0,
+	     0);
 	registerNewPluginDescriptor(d);
     }
 
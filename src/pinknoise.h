@@ -26,59 +26,101 @@
 #ifndef _PINKNOISE_H
 #define _PINKNOISE_H
 
-#include <cstdlib>
+#include <stdint.h>
 
-typedef unsigned int CounterType;
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "prng.h"
+
+typedef uint32_t CounterType;
 typedef float DataValue;
 
 const int n_generators = 8*sizeof(CounterType);
 
+// values are made this many at a time by getValues() and getValues2(),
+// which draws the new generator values for a chunk in one go.
+const unsigned long pink_chunk = 64;
+
+// number of trailing zeros in n, which must not be zero. this takes
+// constant time: a single instruction where the compiler provides one,
+// and a de Bruijn sequence lookup otherwise.
+static inline int countTrailingZeros(CounterType n) {
+#if defined(__GNUC__)
+    return __builtin_ctz(n);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, n);
+    return int(index);
+#else
+    static const int debruijn_index[32] = {
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return debruijn_index[((n & (0 - n)) * 0x077CB531U) >> 27];
+#endif
+}
+
 class PinkNoise {
  private:
     
     CounterType counter;
-    DataValue * generators;
+    DataValue generators[n_generators];
     DataValue last_value;
+    PRNG random;
+
+    // generator to update at the current count. setting the top bit
+    // means a count of zero updates the last generator rather than
+    // needing a test, so the cost per value is fixed.
+    inline int nextIndex() {
+	return countTrailingZeros(counter++
+				  | (CounterType(1) << (n_generators - 1)));
+    }
+
+    // the running sum picks up rounding error with every update, so
+    // it is worked out afresh at the end of each chunk.
+    inline void resum() {
+	DataValue sum = 0;
+	for (int i=0; i<n_generators; ++i)
+	    sum += generators[i];
+	last_value = sum;
+    }
+
+    // unscaled values for a chunk of at most pink_chunk samples.
+    inline void getUnscaledChunk(DataValue * out, unsigned long count) {
+	DataValue updates[pink_chunk];
+	random.fillBipolar(updates, count);
+	DataValue value = last_value;
+	for (unsigned long i=0; i<count; ++i) {
+	    const int index = nextIndex();
+	    value += updates[i] - generators[index];
+	    generators[index] = updates[i];
+	    out[i] = value;
+	}
+	resum();
+    }
 
  public:
     
     PinkNoise() {
-	generators = new DataValue[n_generators];
 	reset();
     }
 
-    ~PinkNoise() {delete [] generators;};
-
     void reset() {
 	counter = 0;
-	last_value = 0;
-	for (int i=0; i<n_generators; ++i) {
-	    generators[i] = 2*(rand()/DataValue(RAND_MAX))-1;
-	    last_value += generators[i];
-	}
+	for (int i=0; i<n_generators; ++i)
+	    generators[i] = random.nextBipolar();
+	resum();
     }
 
     inline DataValue getUnscaledValue() {
-	if (counter != 0) {
-	    // set index to number of trailing zeros in counter.
-	    // hangs if counter==0, hence the slightly inefficient
-	    // test above.
-	    CounterType n = counter;
-	    int index = 0;
-	    while ( (n & 1) == 0 ) {
-		n >>= 1;
-		index++;
-		// this loop means that the plugins cannot be labelled as
-		// capable of hard real-time performance.
-	    }
-
-	    last_value -= generators[index];
-	    generators[index] = 2*(rand()/DataValue(RAND_MAX))-1;
-	    last_value += generators[index];
-	}
-
-	counter++;
-	
+	const int index = nextIndex();
+	last_value -= generators[index];
+	generators[index] = random.nextBipolar();
+	last_value += generators[index];
+	if ((counter & 0xFFFF) == 0)
+	    resum();
 	return last_value;
     }
 
@@ -93,18 +135,42 @@ class PinkNoise {
     inline DataValue getValue2() {
 	// adding some white noise gets rid of some nulls in the frequency spectrum
 	// but makes the signal spikier, so possibly not so good for control signals.
-	return (getUnscaledValue() + rand()/DataValue(RAND_MAX*0.5)-1)/(n_generators+1);
+	return (getUnscaledValue() + random.nextBipolar())/(n_generators+1);
     }
 
-};
-
-#endif
-
-
-
-
-
+    // count values as from getValue().
+    void getValues(DataValue * out, unsigned long count) {
+	const DataValue scale = DataValue(1)/n_generators;
+	while (count) {
+	    const unsigned long n = count < pink_chunk ? count : pink_chunk;
+	    getUnscaledChunk(out, n);
+	    for (unsigned long i=0; i<n; ++i)
+		out[i] *= scale;
+	    out += n;
+	    count -= n;
+	}
+    }
 
+    // count values as from getValue2(), with the white noise for the
+    // whole chunk added in one batch.
+    void getValues2(DataValue * out, unsigned long count) {
+	const DataValue scale = DataValue(1)/(n_generators+1);
+	while (count) {
+	    const unsigned long n = count < pink_chunk ? count : pink_chunk;
+	    getUnscaledChunk(out, n);
+	    for (unsigned long i=0; i<n; ++i)
+		out[i] *= scale;
+	    random.addBipolar(out, n, scale);
+	    out += n;
+	    count -= n;
+	}
+    }
 
+    // the generator is exposed so that plugins can follow a seed port.
+    inline PRNG & getRandom() {
+	return random;
+    }
 
+};
 
+#endif
@@ -0,0 +1,203 @@
+/* prng.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_PRNG_INCLUDED
+#define CMT_PRNG_INCLUDED
+
+/*****************************************************************************/
+
+#include <atomic>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+
+/*****************************************************************************/
+
+/** Number of independent generators run side by side when filling
+    blocks. Interleaving removes the serial dependency between
+    successive values so the block loops can be vectorised. */
+#define PRNG_LANES 4
+
+/*****************************************************************************/
+
+/** Small, fast pseudo-random number generator (Marsaglia's xorshift32,
+    run as PRNG_LANES interleaved lanes). Plugins should own one of
+    these per instance rather than calling rand(), which is slow,
+    shares global state between instances (and threads) and cannot be
+    reproduced per instance. */
+class PRNG {
+private:
+
+  uint32_t m_aiState[PRNG_LANES];
+
+  /** Last value seen on a seed port, see followSeedPort(). */
+  LADSPA_Data m_fSeedPortValue;
+
+  static inline uint32_t step(uint32_t & iState) {
+    iState ^= iState << 13;
+    iState ^= iState >> 17;
+    iState ^= iState << 5;
+    return iState;
+  }
+
+  /** Each new generator gets a different default seed so that two
+      instances of the same plugin do not produce identical output.
+      Hosts may instantiate from several threads at once, so the count
+      is atomic. */
+  static uint32_t nextDefaultSeed() {
+    static std::atomic<uint32_t> s_iInstanceCount(0);
+    return s_iInstanceCount.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  template <bool bAdding>
+  void fillBuffer(LADSPA_Data * pfBuffer,
+		  unsigned long lSampleCount,
+		  const LADSPA_Data fScale) {
+    const LADSPA_Data fScalar = fScale * LADSPA_Data(1.0 / 2147483648.0);
+    uint32_t aiState[PRNG_LANES];
+    for (int iLane = 0; iLane < PRNG_LANES; iLane++)
+      aiState[iLane] = m_aiState[iLane];
+    while (lSampleCount >= PRNG_LANES) {
+      for (int iLane = 0; iLane < PRNG_LANES; iLane++) {
+	LADSPA_Data fValue = int32_t(step(aiState[iLane])) * fScalar;
+	if (bAdding)
+	  pfBuffer[iLane] += fValue;
+	else
+	  pfBuffer[iLane] = fValue;
+      }
+      pfBuffer += PRNG_LANES;
+      lSampleCount -= PRNG_LANES;
+    }
+    for (unsigned long lIndex = 0; lIndex < lSampleCount; lIndex++) {
+      LADSPA_Data fValue = int32_t(step(aiState[lIndex])) * fScalar;
+      if (bAdding)
+	pfBuffer[lIndex] += fValue;
+      else
+	pfBuffer[lIndex] = fValue;
+    }
+    for (int iLane = 0; iLane < PRNG_LANES; iLane++)
+      m_aiState[iLane] = aiState[iLane];
+  }
+
+public:
+
+  PRNG()
+    : m_fSeedPortValue(0) {
+    seed(nextDefaultSeed());
+  }
+
+  /** A generator started from lSeed, as seed() would. This leaves the
+      default seeds alone, so suits generators made off the audio
+      thread that must be reproducible. */
+  explicit PRNG(const unsigned long lSeed)
+    : m_fSeedPortValue(0) {
+    seed(lSeed);
+  }
+
+  /** Restart the sequence. Equal seeds give equal sequences. */
+  void seed(const unsigned long lSeed) {
+    /* Spread the seed over the lanes with splitmix32 so that nearby
+       seeds give unrelated sequences. Xorshift state must never be
+       zero. */
+    uint32_t iMix = uint32_t(lSeed);
+    for (int iLane = 0; iLane < PRNG_LANES; iLane++) {
+      iMix += 0x9E3779B9U;
+      uint32_t iValue = iMix;
+      iValue = (iValue ^ (iValue >> 16)) * 0x85EBCA6BU;
+      iValue = (iValue ^ (iValue >> 13)) * 0xC2B2AE35U;
+      iValue ^= iValue >> 16;
+      m_aiState[iLane] = iValue ? iValue : 0x6D2B79F5U;
+    }
+  }
+
+  /** Uniformly distributed over all 32 bit values. */
+  inline uint32_t nextInteger() {
+    return step(m_aiState[0]);
+  }
+
+  /** Uniformly distributed integer in [0, lLimit). */
+  inline unsigned long nextBelow(const unsigned long lLimit) {
+    return (unsigned long)((uint64_t(nextInteger()) * uint32_t(lLimit)) >> 32);
+  }
+
+  /** Uniformly distributed in [0, 1). */
+  inline LADSPA_Data nextUnipolar() {
+    return (nextInteger() >> 8) * LADSPA_Data(1.0 / 16777216.0);
+  }
+
+  /** Uniformly distributed in [-1, 1). */
+  inline LADSPA_Data nextBipolar() {
+    return int32_t(nextInteger()) * LADSPA_Data(1.0 / 2147483648.0);
+  }
+
+  /** Write lSampleCount values uniformly distributed in [-fScale,
+      fScale) to pfBuffer. */
+  void fillBipolar(LADSPA_Data * pfBuffer,
+		   const unsigned long lSampleCount,
+		   const LADSPA_Data fScale = 1) {
+    fillBuffer<false>(pfBuffer, lSampleCount, fScale);
+  }
+
+  /** As fillBipolar() but adds to the existing buffer contents. */
+  void addBipolar(LADSPA_Data * pfBuffer,
+		  const unsigned long lSampleCount,
+		  const LADSPA_Data fScale = 1) {
+    fillBuffer<true>(pfBuffer, lSampleCount, fScale);
+  }
+
+  /** Support for optional seed ports. Call resetSeedPort() from
+      activate() and followSeedPort() at the start of each run(). A
+      positive seed port value reseeds the generator on the first run
+      after activation and whenever the value changes; zero leaves the
+      generator running freely. followSeedPort() returns true if the
+      generator was reseeded, so plugins holding state drawn from it
+      can regenerate that state. */
+  void resetSeedPort() {
+    m_fSeedPortValue = 0;
+  }
+
+  bool followSeedPort(const LADSPA_Data fSeed) {
+    if (fSeed == m_fSeedPortValue)
+      return false;
+    m_fSeedPortValue = fSeed;
+    if (fSeed <= 0)
+      return false;
+    seed((unsigned long)fSeed);
+    return true;
+  }
+
+};
+
+/*****************************************************************************/
+
+/** Port hints for an optional seed port, used with
+    PRNG::followSeedPort(). */
+#define PRNG_SEED_PORT_NAME  "Random Seed (0 = Free Running)"
+#define PRNG_SEED_PORT_HINTS (LADSPA_HINT_BOUNDED_BELOW	\
+			      | LADSPA_HINT_INTEGER		\
+			      | LADSPA_HINT_DEFAULT_0)
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
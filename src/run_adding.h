@@ -23,6 +23,9 @@
    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
    02111-1307, USA. */
 
+#ifndef CMT_RUN_ADDING_INCLUDED
+#define CMT_RUN_ADDING_INCLUDED
+
 /*****************************************************************************/
 
 /*
@@ -156,3 +159,34 @@ inline float get_gain<write_output_adding>(const LADSPA_Data &run_adding_gain)
 {
     return run_adding_gain;
 }
+
+/*****************************************************************************/
+
+/*
+  Block kernels such as mixBuffers() in kernels.h do their own writes, and
+  take a bool template parameter to choose between storing and adding.
+  is_adding<write_output>() gives that parameter, e.g.
+
+    mixBuffers<is_adding<write_output>()>(pfOutput, ...);
+*/
+
+template <OutputFunction output_mode>
+constexpr bool is_adding();
+
+template <>
+constexpr bool is_adding<write_output_normal>()
+{
+    return false;
+}
+
+template <>
+constexpr bool is_adding<write_output_adding>()
+{
+    return true;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
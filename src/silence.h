@@ -0,0 +1,121 @@
+/* silence.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_SILENCE_INCLUDED
+#define CMT_SILENCE_INCLUDED
+
+/*****************************************************************************/
+
+#include "ladspa_types.h"
+#include "kernels.h"
+
+/*****************************************************************************/
+
+/** Signals no louder than this (about -120dB) are treated as
+    silence. */
+#define SILENCE_THRESHOLD LADSPA_Data(1e-6)
+
+/** Port hints for the optional idle output port, which reads 1 while
+    the plugin is bypassing its processing and 0 otherwise. Plugins
+    add this after all their other ports. */
+#define SILENCE_IDLE_PORT_NAME  "Idle"
+#define SILENCE_IDLE_PORT_HINTS LADSPA_HINT_TOGGLED
+
+/*****************************************************************************/
+
+/** Returns true if a block of audio is silent. */
+inline bool
+isSilent(const LADSPA_Data * pfBuffer, const unsigned long lSampleCount) {
+  return isBelowThreshold(pfBuffer, SILENCE_THRESHOLD, lSampleCount);
+}
+
+/*****************************************************************************/
+
+/** Tracks how long a plugin's input and internal state have been
+    silent so that plugins with a tail (reverbs, delays and so on) can
+    stop processing once it has died away. A typical run() is:
+
+      bSilent = isSilent(input) (and not in some sustaining mode)
+      if (bSilent && tracker.isIdle(lTailLength)) {
+        Clear the outputs, advance any delay buffers with zeros,
+        tracker.update(true, SampleCount), set the idle port and
+        return.
+      }
+      Process as normal.
+      tracker.update(bSilent && state written this block was silent,
+                     SampleCount);
+      if (tracker.isQuietFor(lTailLength)) tracker.enterIdle();
+
+    where lTailLength is the number of samples over which state can
+    still reach the output. A plugin that cannot cheaply check the
+    state it writes may instead confirm that its state has decayed
+    before calling enterIdle(). Call reset() from activate(). */
+class SilenceTracker {
+private:
+
+  /** Samples for which the input and state have been quiet. */
+  unsigned long m_lQuietCount;
+
+  bool m_bIdle;
+
+public:
+
+  SilenceTracker()
+    : m_lQuietCount(0),
+      m_bIdle(false) {
+  }
+
+  void reset() {
+    m_lQuietCount = 0;
+    m_bIdle = false;
+  }
+
+  /** Record whether the last block was quiet. A loud block ends any
+      idle period. */
+  void update(const bool bQuiet, const unsigned long lSampleCount) {
+    if (!bQuiet)
+      reset();
+    else if (m_lQuietCount < (1UL << 30))
+      m_lQuietCount += lSampleCount;
+  }
+
+  bool isQuietFor(const unsigned long lTailLength) const {
+    return m_lQuietCount >= lTailLength;
+  }
+
+  void enterIdle() {
+    m_bIdle = true;
+  }
+
+  /** True if processing may be bypassed. lTailLength is checked
+      again so that a plugin whose tail grows (for instance when a
+      delay time is increased) resumes processing until the longer
+      tail has been covered. */
+  bool isIdle(const unsigned long lTailLength) const {
+    return m_bIdle && m_lQuietCount >= lTailLength;
+  }
+
+};
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
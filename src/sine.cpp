@@ -21,35 +21,24 @@
 /*****************************************************************************/
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "kernels.h"
+#include "lanes.h"
+#include "wavetable.h"
 
 /*****************************************************************************/
 
-/* Sine table size is given by (1 << SINE_TABLE_BITS). */
-#define SINE_TABLE_BITS 14
-#define SINE_TABLE_SHIFT (8 * sizeof(unsigned long) - SINE_TABLE_BITS)
-
-/*****************************************************************************/
-
-static LADSPA_Data * g_pfSineTable = NULL;
 static LADSPA_Data g_fPhaseStepBase = 0;
 
 /*****************************************************************************/
 
 static void
-initialise_sine_wavetable() {
-  if (g_pfSineTable == NULL) {
-    long lTableSize = (1 << SINE_TABLE_BITS);
-    double dShift = (double(M_PI) * 2) / lTableSize;
-    g_pfSineTable = new float[lTableSize];
-    if (g_pfSineTable != NULL)
-      for (long lIndex = 0; lIndex < lTableSize; lIndex++)
-	g_pfSineTable[lIndex] = LADSPA_Data(sin(dShift * lIndex));
-  }
+initialise_phase_step_base() {
   if (g_fPhaseStepBase == 0) {
     g_fPhaseStepBase = (LADSPA_Data)pow(2, sizeof(unsigned long) * 8);
   }
@@ -70,13 +59,18 @@ static void runSineOscillator_FreqCtrl_AmpAudio(LADSPA_Handle Instance,
                                                 unsigned long SampleCount);
 static void runSineOscillator_FreqCtrl_AmpCtrl(LADSPA_Handle Instance,
                                                unsigned long SampleCount);
+template <bool bAmplitudeAudio>
+static void runSineOscillatorBatch(const LADSPA_Handle * Instances,
+				   unsigned long InstanceCount,
+				   unsigned long SampleCount);
 
 /* This class provides sine wavetable oscillator
    plugins. Band-limiting to avoid aliasing is trivial because of the
    waveform in use. Four versions of the oscillator are provided,
    allowing the amplitude and frequency inputs of the oscillator to be
    audio signals rather than controls (for use in AM and FM
-   synthesis). */
+   synthesis). The shared sine table (see wavetable.h) is read with
+   linear interpolation. */
 class SineOscillator : public CMT_PluginInstance{
 private:
 
@@ -87,6 +81,7 @@ private:
   LADSPA_Data       m_fCachedFrequency;
   const LADSPA_Data m_fLimitFrequency;
   const LADSPA_Data m_fPhaseStepScalar;
+  const LADSPA_Data * m_pfTable;
 
   void setPhaseStepFromFrequency(const LADSPA_Data fFrequency) {
     if (fFrequency != m_fCachedFrequency) {
@@ -106,7 +101,12 @@ public:
       m_lPhaseStep(0), 
       m_fCachedFrequency(0),
       m_fLimitFrequency(LADSPA_Data(lSampleRate * 0.5)),
-      m_fPhaseStepScalar(LADSPA_Data(g_fPhaseStepBase / lSampleRate)) {
+      m_fPhaseStepScalar(LADSPA_Data(g_fPhaseStepBase / lSampleRate)),
+      m_pfTable(acquireWavetable(WAVEFORM_SINE)->getLevel(0)) {
+  }
+
+  ~SineOscillator() {
+    releaseWavetable(WAVEFORM_SINE);
   }
 
   friend void activateSineOscillator(void * pvHandle);
@@ -118,6 +118,10 @@ public:
 						  unsigned long SampleCount);
   friend void runSineOscillator_FreqCtrl_AmpCtrl(LADSPA_Handle Instance,
 						 unsigned long SampleCount);
+  template <bool bAmplitudeAudio>
+  friend void runSineOscillatorBatch(const LADSPA_Handle * Instances,
+				     unsigned long InstanceCount,
+				     unsigned long SampleCount);
 
 };
 
@@ -142,7 +146,7 @@ runSineOscillator_FreqAudio_AmpAudio(LADSPA_Handle Instance,
        support. */
     LADSPA_Data fFrequency = *(pfFrequency++);
     *(pfOutput++)
-      = (g_pfSineTable[poSineOscillator->m_lPhase >> SINE_TABLE_SHIFT]
+      = (readWavetable(poSineOscillator->m_pfTable, poSineOscillator->m_lPhase)
 	 * *(pfAmplitude++));
     poSineOscillator->setPhaseStepFromFrequency(fFrequency);
     poSineOscillator->m_lPhase 
@@ -164,7 +168,7 @@ runSineOscillator_FreqAudio_AmpCtrl(LADSPA_Handle Instance,
        support. */
     LADSPA_Data fFrequency = *(pfFrequency++);
     *(pfOutput++)
-      = (g_pfSineTable[poSineOscillator->m_lPhase >> SINE_TABLE_SHIFT]
+      = (readWavetable(poSineOscillator->m_pfTable, poSineOscillator->m_lPhase)
 	 * fAmplitude);
     poSineOscillator->setPhaseStepFromFrequency(fFrequency);
     poSineOscillator->m_lPhase 
@@ -184,7 +188,7 @@ runSineOscillator_FreqCtrl_AmpAudio(LADSPA_Handle Instance,
   LADSPA_Data * pfOutput = poSineOscillator->m_ppfPorts[OSC_OUTPUT];
   for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
     *(pfOutput++)
-      = (g_pfSineTable[poSineOscillator->m_lPhase >> SINE_TABLE_SHIFT]
+      = (readWavetable(poSineOscillator->m_pfTable, poSineOscillator->m_lPhase)
 	 * *(pfAmplitude++));
     poSineOscillator->m_lPhase 
       += poSineOscillator->m_lPhaseStep;
@@ -203,7 +207,7 @@ runSineOscillator_FreqCtrl_AmpCtrl(LADSPA_Handle Instance,
   LADSPA_Data * pfOutput = poSineOscillator->m_ppfPorts[OSC_OUTPUT];
   for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
     *(pfOutput++)
-      = (g_pfSineTable[poSineOscillator->m_lPhase >> SINE_TABLE_SHIFT]
+      = (readWavetable(poSineOscillator->m_pfTable, poSineOscillator->m_lPhase)
 	 * fAmplitude);
     poSineOscillator->m_lPhase 
       += poSineOscillator->m_lPhaseStep;
@@ -212,10 +216,476 @@ runSineOscillator_FreqCtrl_AmpCtrl(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+#if defined(CMT_KERNELS_SSE2) && defined(__LP64__)
+/* Phases are 64 bit unsigned longs, so may be stepped two to a
+   vector. */
+#define SINE_BATCH_SSE2
+#endif
+
+/** Run a batch of control frequency sine oscillators (see
+    cmt_run_batch()) in groups of LANE_COUNT. The phases of a group
+    are held side by side and advanced together, so the table reads
+    of the oscillators overlap rather than each oscillator waiting on
+    its own. All oscillators share the one sine table. Any oscillators
+    left over are run separately. */
+template <bool bAmplitudeAudio>
+static void
+runSineOscillatorBatch(const LADSPA_Handle * Instances,
+		       unsigned long InstanceCount,
+		       unsigned long SampleCount) {
+
+  unsigned long lInstance = 0;
+  for (; lInstance + LANE_COUNT <= InstanceCount; lInstance += LANE_COUNT) {
+
+    SineOscillator * apoOscillators[LANE_COUNT];
+    const LADSPA_Data * apfAmplitude[LANE_COUNT];
+    LADSPA_Data * apfOutput[LANE_COUNT];
+    LADSPA_Data afAmplitude[LANE_COUNT];
+    unsigned long alPhase[LANE_COUNT];
+    unsigned long alPhaseStep[LANE_COUNT];
+    int iLane;
+    for (iLane = 0; iLane < LANE_COUNT; iLane++) {
+      SineOscillator * poOscillator
+	= apoOscillators[iLane]
+	= (SineOscillator *)Instances[lInstance + iLane];
+      poOscillator->setPhaseStepFromFrequency
+	(*(poOscillator->m_ppfPorts[OSC_FREQUENCY]));
+      apfAmplitude[iLane] = poOscillator->m_ppfPorts[OSC_AMPLITUDE];
+      apfOutput[iLane] = poOscillator->m_ppfPorts[OSC_OUTPUT];
+      afAmplitude[iLane] = *(apfAmplitude[iLane]);
+      alPhase[iLane] = poOscillator->m_lPhase;
+      alPhaseStep[iLane] = poOscillator->m_lPhaseStep;
+    }
+    const LADSPA_Data * pfTable = apoOscillators[0]->m_pfTable;
+
+#if defined(SINE_BATCH_SSE2)
+    /* Phases for lanes 0 and 1, then 2 and 3. */
+    __m128i avPhase[2], avStep[2];
+    avPhase[0] = _mm_loadu_si128((const __m128i *)alPhase);
+    avPhase[1] = _mm_loadu_si128((const __m128i *)(alPhase + 2));
+    avStep[0] = _mm_loadu_si128((const __m128i *)alPhaseStep);
+    avStep[1] = _mm_loadu_si128((const __m128i *)(alPhaseStep + 2));
+    const Lanes vAmplitude = lanesLoad(afAmplitude);
+    const __m128i viFractionMask 
+      = _mm_set1_epi32((1 << WAVETABLE_FRACTION_BITS) - 1);
+    const __m128 vFractionScale 
+      = _mm_set1_ps(LADSPA_Data(1.0 / (1UL << WAVETABLE_FRACTION_BITS)));
+    for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
+      /* The index and fraction bits of the four phases, packed into
+	 32 bit lanes. */
+      const __m128i viBits = _mm_castps_si128
+	(_mm_shuffle_ps
+	 (_mm_castsi128_ps(_mm_srli_epi64(avPhase[0], WAVETABLE_FRACTION_SHIFT)),
+	  _mm_castsi128_ps(_mm_srli_epi64(avPhase[1], WAVETABLE_FRACTION_SHIFT)),
+	  _MM_SHUFFLE(2, 0, 2, 0)));
+      int aiIndex[LANE_COUNT];
+      _mm_storeu_si128((__m128i *)aiIndex, 
+		       _mm_srli_epi32(viBits, WAVETABLE_FRACTION_BITS));
+      const Lanes vX0 = lanesSet(pfTable[aiIndex[0]],
+				 pfTable[aiIndex[1]],
+				 pfTable[aiIndex[2]],
+				 pfTable[aiIndex[3]]);
+      const Lanes vX1 = lanesSet(pfTable[aiIndex[0] + 1],
+				 pfTable[aiIndex[1] + 1],
+				 pfTable[aiIndex[2] + 1],
+				 pfTable[aiIndex[3] + 1]);
+      const Lanes vFraction 
+	= lanes(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(viBits, 
+							 viFractionMask)),
+			   vFractionScale));
+      const Lanes vSine = vX0 + vFraction * (vX1 - vX0);
+      lanesScatter(apfOutput,
+		   lIndex,
+		   vSine * (bAmplitudeAudio 
+			    ? lanesGather(apfAmplitude, lIndex)
+			    : vAmplitude));
+      avPhase[0] = _mm_add_epi64(avPhase[0], avStep[0]);
+      avPhase[1] = _mm_add_epi64(avPhase[1], avStep[1]);
+    }
+    _mm_storeu_si128((__m128i *)alPhase, avPhase[0]);
+    _mm_storeu_si128((__m128i *)(alPhase + 2), avPhase[1]);
+#else
+    for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++)
+      for (iLane = 0; iLane < LANE_COUNT; iLane++) {
+	apfOutput[iLane][lIndex]
+	  = (readWavetable(pfTable, alPhase[iLane])
+	     * (bAmplitudeAudio
+		? apfAmplitude[iLane][lIndex]
+		: afAmplitude[iLane]));
+	alPhase[iLane] += alPhaseStep[iLane];
+      }
+#endif
+
+    for (iLane = 0; iLane < LANE_COUNT; iLane++)
+      apoOscillators[iLane]->m_lPhase = alPhase[iLane];
+  }
+
+  for (; lInstance < InstanceCount; lInstance++)
+    if (bAmplitudeAudio)
+      runSineOscillator_FreqCtrl_AmpAudio(Instances[lInstance], SampleCount);
+    else
+      runSineOscillator_FreqCtrl_AmpCtrl(Instances[lInstance], SampleCount);
+}
+
+/*****************************************************************************/
+
+#define BLO_FREQUENCY     0
+#define BLO_AMPLITUDE     1
+#define BLO_OUTPUT        2
+#define BLO_WAVEFORM      3
+#define BLO_INTERPOLATION 4
+
+class BandLimitedOscillator;
+
+static void activateBandLimitedOscillator(void * pvHandle);
+template <bool bFrequencyAudio, bool bAmplitudeAudio>
+static void runBandLimitedOscillator(LADSPA_Handle Instance,
+				     unsigned long SampleCount);
+template <bool bFrequencyAudio, bool bAmplitudeAudio, bool bCubic>
+static void processBandLimitedOscillator(BandLimitedOscillator * poOscillator,
+					 const Wavetable * poTable,
+					 unsigned long SampleCount);
+
+/* This class provides band-limited wavetable oscillators (sine,
+   triangle, square and sawtooth) using the shared mipmapped tables in
+   wavetable.h. The table level is chosen from the frequency so that
+   no harmonics above the Nyquist frequency are produced. As with the
+   sine oscillators, four versions are provided with audio or control
+   frequency and amplitude inputs. */
+class BandLimitedOscillator : public CMT_PluginInstance {
+private:
+
+  unsigned long     m_lPhase;
+  unsigned long     m_lPhaseStep;
+  int               m_iLevel;
+  LADSPA_Data       m_fCachedFrequency;
+  const LADSPA_Data m_fLimitFrequency;
+  const LADSPA_Data m_fPhaseStepScalar;
+  const Wavetable * m_apoTables[WAVEFORM_COUNT];
+
+  void setPhaseStepFromFrequency(const LADSPA_Data fFrequency) {
+    if (fFrequency != m_fCachedFrequency) {
+      if (fFrequency >= 0 && fFrequency < m_fLimitFrequency) 
+	m_lPhaseStep = (unsigned long)(m_fPhaseStepScalar * fFrequency);
+      else 
+	m_lPhaseStep = 0;
+      m_iLevel = wavetableLevel(m_lPhaseStep);
+      m_fCachedFrequency = fFrequency;
+    }
+  }
+
+public:
+
+  BandLimitedOscillator(const LADSPA_Descriptor *,
+			unsigned long lSampleRate) 
+    : CMT_PluginInstance(5),
+      m_lPhaseStep(0), 
+      m_iLevel(WAVETABLE_LEVELS - 1),
+      m_fCachedFrequency(0),
+      m_fLimitFrequency(LADSPA_Data(lSampleRate * 0.5)),
+      m_fPhaseStepScalar(LADSPA_Data(g_fPhaseStepBase / lSampleRate)) {
+    for (int iWaveform = 0; iWaveform < WAVEFORM_COUNT; iWaveform++)
+      m_apoTables[iWaveform] = acquireWavetable(iWaveform);
+  }
+
+  ~BandLimitedOscillator() {
+    for (int iWaveform = 0; iWaveform < WAVEFORM_COUNT; iWaveform++)
+      releaseWavetable(iWaveform);
+  }
+
+  friend void activateBandLimitedOscillator(void * pvHandle);
+  template <bool bFrequencyAudio, bool bAmplitudeAudio>
+  friend void runBandLimitedOscillator(LADSPA_Handle Instance,
+				       unsigned long SampleCount);
+  template <bool bFrequencyAudio, bool bAmplitudeAudio, bool bCubic>
+  friend void processBandLimitedOscillator(BandLimitedOscillator * poOscillator,
+					   const Wavetable * poTable,
+					   unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void 
+activateBandLimitedOscillator(void * pvHandle) {
+  ((BandLimitedOscillator *)pvHandle)->m_lPhase = 0;
+}
+
+/*****************************************************************************/
+
+template <bool bFrequencyAudio, bool bAmplitudeAudio, bool bCubic>
+static void
+processBandLimitedOscillator(BandLimitedOscillator * poOscillator,
+			     const Wavetable * poTable,
+			     unsigned long SampleCount) {
+  LADSPA_Data * pfFrequency = poOscillator->m_ppfPorts[BLO_FREQUENCY];
+  LADSPA_Data * pfAmplitude = poOscillator->m_ppfPorts[BLO_AMPLITUDE];
+  LADSPA_Data * pfOutput = poOscillator->m_ppfPorts[BLO_OUTPUT];
+  LADSPA_Data fAmplitude = *pfAmplitude;
+  unsigned long lPhase = poOscillator->m_lPhase;
+  if (!bFrequencyAudio)
+    poOscillator->setPhaseStepFromFrequency(*pfFrequency);
+  const LADSPA_Data * pfTable = poTable->getLevel(poOscillator->m_iLevel);
+  for (unsigned long lIndex = 0; lIndex < SampleCount; lIndex++) {
+    /* Extract inputs at this point to guarantee inplace support. */
+    LADSPA_Data fFrequency = bFrequencyAudio ? pfFrequency[lIndex] : 0;
+    if (bAmplitudeAudio)
+      fAmplitude = pfAmplitude[lIndex];
+    pfOutput[lIndex] 
+      = fAmplitude * (bCubic 
+		      ? readWavetableCubic(pfTable, lPhase)
+		      : readWavetable(pfTable, lPhase));
+    if (bFrequencyAudio) {
+      poOscillator->setPhaseStepFromFrequency(fFrequency);
+      pfTable = poTable->getLevel(poOscillator->m_iLevel);
+    }
+    lPhase += poOscillator->m_lPhaseStep;
+  }
+  poOscillator->m_lPhase = lPhase;
+}
+
+/*****************************************************************************/
+
+template <bool bFrequencyAudio, bool bAmplitudeAudio>
+static void
+runBandLimitedOscillator(LADSPA_Handle Instance,
+			 unsigned long SampleCount) {
+  BandLimitedOscillator * poOscillator = (BandLimitedOscillator *)Instance;
+  LADSPA_Data fWaveform = *(poOscillator->m_ppfPorts[BLO_WAVEFORM]);
+  int iWaveform = WAVEFORM_SINE;
+  if (fWaveform >= WAVEFORM_COUNT - 1)
+    iWaveform = WAVEFORM_COUNT - 1;
+  else if (fWaveform > 0)
+    iWaveform = int(fWaveform + 0.5f);
+  const Wavetable * poTable = poOscillator->m_apoTables[iWaveform];
+  if (*(poOscillator->m_ppfPorts[BLO_INTERPOLATION]) >= 0.5f)
+    processBandLimitedOscillator<bFrequencyAudio, bAmplitudeAudio, true>
+      (poOscillator, poTable, SampleCount);
+  else
+    processBandLimitedOscillator<bFrequencyAudio, bAmplitudeAudio, false>
+      (poOscillator, poTable, SampleCount);
+}
+
+/*****************************************************************************/
+
+#define PSO_OUTPUT     0
+#define PSO_FREQUENCY0 1
+#define PSO_AMPLITUDE0 2
+
+/** Port numbers for the frequency and amplitude of voice iVoice. */
+#define PSO_FREQUENCY(iVoice) (PSO_FREQUENCY0 + 2 * (iVoice))
+#define PSO_AMPLITUDE(iVoice) (PSO_AMPLITUDE0 + 2 * (iVoice))
+
+#define PSO_MAX_VOICES 16
+#define PSO_LANES      4
+
+/* Voices keep their phase in 32 bit accumulators, which wrap once
+   per cycle. Read as a signed value scaled by 2^-32 the phase runs
+   from -1/2 to 1/2; this is folded into [-1/4, 1/4] and a
+   ninth-order polynomial used from there, which is accurate to a few
+   parts in a million. The SIMD versions below compute exactly the
+   same thing four lanes at a time. */
+#define PSO_PHASE_SCALAR LADSPA_Data(1.0 / 4294967296.0)
+#define PSO_C1 LADSPA_Data(6.28318530718)
+#define PSO_C3 LADSPA_Data(-41.3417022404)
+#define PSO_C5 LADSPA_Data(81.6052492761)
+#define PSO_C7 LADSPA_Data(-76.7058597531)
+#define PSO_C9 LADSPA_Data(42.0586939449)
+
+static inline LADSPA_Data
+polySine(const unsigned int iPhase) {
+  LADSPA_Data fX = LADSPA_Data(int(iPhase)) * PSO_PHASE_SCALAR;
+  fX = fX < 0.5f - fX ? fX : 0.5f - fX;
+  fX = fX > -0.5f - fX ? fX : -0.5f - fX;
+  const LADSPA_Data fX2 = fX * fX;
+  return fX * (PSO_C1 + fX2 * (PSO_C3 + fX2 * (PSO_C5 + fX2 
+					       * (PSO_C7 + fX2 * PSO_C9))));
+}
+
+static void activatePolySineOscillator(void * pvHandle);
+template <int iVoices>
+static void runPolySineOscillator(LADSPA_Handle Instance,
+				  unsigned long SampleCount);
+
+/* This class provides a bank of sine oscillators with control-rate
+   frequencies and amplitudes, mixed to a single output. This is much
+   cheaper than one sine oscillator plugin per partial for additive
+   synthesis: the per-voice state is held as arrays so that four
+   voices are computed at once with SIMD instructions where
+   available. Amplitude changes are ramped over each block. */
+class PolySineOscillator : public CMT_PluginInstance {
+private:
+
+  unsigned int m_aiPhase[PSO_MAX_VOICES];
+  LADSPA_Data m_afAmplitude[PSO_MAX_VOICES];
+  const LADSPA_Data m_fSampleRate;
+
+public:
+
+  PolySineOscillator(const LADSPA_Descriptor *,
+		     unsigned long lSampleRate) 
+    : CMT_PluginInstance(1 + 2 * PSO_MAX_VOICES),
+      m_fSampleRate(LADSPA_Data(lSampleRate)) {
+  }
+
+  friend void activatePolySineOscillator(void * pvHandle);
+  template <int iVoices>
+  friend void runPolySineOscillator(LADSPA_Handle Instance,
+				    unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void 
+activatePolySineOscillator(void * pvHandle) {
+  PolySineOscillator * poOscillator = (PolySineOscillator *)pvHandle;
+  for (int iVoice = 0; iVoice < PSO_MAX_VOICES; iVoice++) {
+    poOscillator->m_aiPhase[iVoice] = 0;
+    poOscillator->m_afAmplitude[iVoice] = 0;
+  }
+}
+
+/*****************************************************************************/
+
+/** Render PSO_LANES voices over lSampleCount samples, adding to
+    pfOutput if bAdd is set and overwriting it otherwise. piPhase and
+    pfAmplitude are updated. */
+static void
+renderPolySineLanes(LADSPA_Data * pfOutput,
+		    unsigned int * piPhase,
+		    const unsigned int * piPhaseStep,
+		    LADSPA_Data * pfAmplitude,
+		    const LADSPA_Data * pfAmplitudeStep,
+		    const bool bAdd,
+		    const unsigned long lSampleCount) {
+
+  unsigned long lIndex;
+
+#if defined(CMT_KERNELS_SSE2)
+
+  __m128i vPhase = _mm_loadu_si128((const __m128i *)piPhase);
+  const __m128i vPhaseStep = _mm_loadu_si128((const __m128i *)piPhaseStep);
+  __m128 vAmplitude = _mm_loadu_ps(pfAmplitude);
+  const __m128 vAmplitudeStep = _mm_loadu_ps(pfAmplitudeStep);
+  const __m128 vHalf = _mm_set1_ps(0.5f);
+  const __m128 vMinusHalf = _mm_set1_ps(-0.5f);
+  const __m128 vScalar = _mm_set1_ps(PSO_PHASE_SCALAR);
+  for (lIndex = 0; lIndex < lSampleCount; lIndex++) {
+    __m128 vX = _mm_mul_ps(_mm_cvtepi32_ps(vPhase), vScalar);
+    vX = _mm_min_ps(vX, _mm_sub_ps(vHalf, vX));
+    vX = _mm_max_ps(vX, _mm_sub_ps(vMinusHalf, vX));
+    const __m128 vX2 = _mm_mul_ps(vX, vX);
+    __m128 vY = _mm_set1_ps(PSO_C9);
+    vY = _mm_add_ps(_mm_set1_ps(PSO_C7), _mm_mul_ps(vX2, vY));
+    vY = _mm_add_ps(_mm_set1_ps(PSO_C5), _mm_mul_ps(vX2, vY));
+    vY = _mm_add_ps(_mm_set1_ps(PSO_C3), _mm_mul_ps(vX2, vY));
+    vY = _mm_add_ps(_mm_set1_ps(PSO_C1), _mm_mul_ps(vX2, vY));
+    vY = _mm_mul_ps(_mm_mul_ps(vX, vY), vAmplitude);
+    /* Horizontal sum, in the same order as the scalar version. */
+    float afY[PSO_LANES];
+    _mm_storeu_ps(afY, vY);
+    const LADSPA_Data fSum = (afY[0] + afY[1]) + (afY[2] + afY[3]);
+    pfOutput[lIndex] = bAdd ? pfOutput[lIndex] + fSum : fSum;
+    vPhase = _mm_add_epi32(vPhase, vPhaseStep);
+    vAmplitude = _mm_add_ps(vAmplitude, vAmplitudeStep);
+  }
+  _mm_storeu_si128((__m128i *)piPhase, vPhase);
+  _mm_storeu_ps(pfAmplitude, vAmplitude);
+
+#elif defined(CMT_KERNELS_NEON)
+
+  uint32x4_t vPhase = vld1q_u32(piPhase);
+  const uint32x4_t vPhaseStep = vld1q_u32(piPhaseStep);
+  float32x4_t vAmplitude = vld1q_f32(pfAmplitude);
+  const float32x4_t vAmplitudeStep = vld1q_f32(pfAmplitudeStep);
+  const float32x4_t vHalf = vdupq_n_f32(0.5f);
+  const float32x4_t vMinusHalf = vdupq_n_f32(-0.5f);
+  for (lIndex = 0; lIndex < lSampleCount; lIndex++) {
+    float32x4_t vX = vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(vPhase)),
+				 PSO_PHASE_SCALAR);
+    vX = vminq_f32(vX, vsubq_f32(vHalf, vX));
+    vX = vmaxq_f32(vX, vsubq_f32(vMinusHalf, vX));
+    const float32x4_t vX2 = vmulq_f32(vX, vX);
+    float32x4_t vY = vdupq_n_f32(PSO_C9);
+    vY = vaddq_f32(vdupq_n_f32(PSO_C7), vmulq_f32(vX2, vY));
+    vY = vaddq_f32(vdupq_n_f32(PSO_C5), vmulq_f32(vX2, vY));
+    vY = vaddq_f32(vdupq_n_f32(PSO_C3), vmulq_f32(vX2, vY));
+    vY = vaddq_f32(vdupq_n_f32(PSO_C1), vmulq_f32(vX2, vY));
+    vY = vmulq_f32(vmulq_f32(vX, vY), vAmplitude);
+    float afY[PSO_LANES];
+    vst1q_f32(afY, vY);
+    const LADSPA_Data fSum = (afY[0] + afY[1]) + (afY[2] + afY[3]);
+    pfOutput[lIndex] = bAdd ? pfOutput[lIndex] + fSum : fSum;
+    vPhase = vaddq_u32(vPhase, vPhaseStep);
+    vAmplitude = vaddq_f32(vAmplitude, vAmplitudeStep);
+  }
+  vst1q_u32(piPhase, vPhase);
+  vst1q_f32(pfAmplitude, vAmplitude);
+
+#else
+
+  for (lIndex = 0; lIndex < lSampleCount; lIndex++) {
+    LADSPA_Data afY[PSO_LANES];
+    for (int iLane = 0; iLane < PSO_LANES; iLane++) {
+      afY[iLane] = polySine(piPhase[iLane]) * pfAmplitude[iLane];
+      piPhase[iLane] += piPhaseStep[iLane];
+      pfAmplitude[iLane] += pfAmplitudeStep[iLane];
+    }
+    const LADSPA_Data fSum = (afY[0] + afY[1]) + (afY[2] + afY[3]);
+    pfOutput[lIndex] = bAdd ? pfOutput[lIndex] + fSum : fSum;
+  }
+
+#endif
+}
+
+/*****************************************************************************/
+
+template <int iVoices>
+static void
+runPolySineOscillator(LADSPA_Handle Instance,
+		      unsigned long SampleCount) {
+
+  PolySineOscillator * poOscillator = (PolySineOscillator *)Instance;
+  LADSPA_Data ** ppfPorts = poOscillator->m_ppfPorts;
+
+  unsigned int aiPhaseStep[iVoices];
+  LADSPA_Data afAmplitudeStep[iVoices];
+  const LADSPA_Data fRampScalar = SampleCount > 0 ? 1.0f / SampleCount : 0;
+
+  for (int iVoice = 0; iVoice < iVoices; iVoice++) {
+    const LADSPA_Data fCycles
+      = *(ppfPorts[PSO_FREQUENCY(iVoice)]) / poOscillator->m_fSampleRate;
+    aiPhaseStep[iVoice] 
+      = ((fCycles >= 0 && fCycles < 0.5f) 
+	 ? (unsigned int)(fCycles * 4294967296.0) 
+	 : 0);
+    afAmplitudeStep[iVoice] 
+      = ((*(ppfPorts[PSO_AMPLITUDE(iVoice)]) 
+	  - poOscillator->m_afAmplitude[iVoice])
+	 * fRampScalar);
+  }
+
+  for (int iVoice = 0; iVoice < iVoices; iVoice += PSO_LANES)
+    renderPolySineLanes(ppfPorts[PSO_OUTPUT],
+			poOscillator->m_aiPhase + iVoice,
+			aiPhaseStep + iVoice,
+			poOscillator->m_afAmplitude + iVoice,
+			afAmplitudeStep + iVoice,
+			iVoice > 0,
+			SampleCount);
+
+  /* Land exactly on the target amplitudes. */
+  for (int iVoice = 0; iVoice < iVoices; iVoice++)
+    poOscillator->m_afAmplitude[iVoice] = *(ppfPorts[PSO_AMPLITUDE(iVoice)]);
+}
+
+/*****************************************************************************/
+
 void
 initialise_sine() {
 
-  initialise_sine_wavetable();
+  initialise_phase_step_base();
 
   const char * apcLabels[] = {
     "sine_faaa",
@@ -235,6 +705,12 @@ initialise_sine() {
     runSineOscillator_FreqCtrl_AmpAudio,
     runSineOscillator_FreqCtrl_AmpCtrl 
   };
+  CMT_Run_Batch_Implementation afRunBatchFunction[] = {
+    NULL,
+    NULL,
+    runSineOscillatorBatch<true>,
+    runSineOscillatorBatch<false>
+  };
   LADSPA_PortDescriptor piFrequencyPortProperties[] = {
     LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,	
     LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,	
@@ -288,16 +764,155 @@ initialise_sine() {
     psDescriptor->addPort
       (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
        "Output");
+    psDescriptor->setRunBatch(afRunBatchFunction[lPluginIndex]);
 
     registerNewPluginDescriptor(psDescriptor);
   }
-}
 
-/*****************************************************************************/
+  const char * apcBandLimitedLabels[] = {
+    "wavetable_faaa",
+    "wavetable_faac",
+    "wavetable_fcaa",
+    "wavetable_fcac" 
+  };
+  const char * apcBandLimitedNames[] = { 
+    "Band-Limited Wavetable Oscillator (Freq:audio, Amp:audio)",
+    "Band-Limited Wavetable Oscillator (Freq:audio, Amp:control)",
+    "Band-Limited Wavetable Oscillator (Freq:control, Amp:audio)",
+    "Band-Limited Wavetable Oscillator (Freq:control, Amp:control)" 
+  };
+  LADSPA_Run_Function afBandLimitedRunFunction[] = {
+    runBandLimitedOscillator<true, true>,
+    runBandLimitedOscillator<true, false>,
+    runBandLimitedOscillator<false, true>,
+    runBandLimitedOscillator<false, false>
+  };
+
+  for (long lPluginIndex = 0; lPluginIndex < 4; lPluginIndex++) {
+    
+    CMT_Descriptor * psDescriptor;
+    
+    psDescriptor = new CMT_Descriptor
+      (1935 + lPluginIndex,
+       apcBandLimitedLabels[lPluginIndex],
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       apcBandLimitedNames[lPluginIndex],
+       CMT_MAKER("Richard W.E. Furse"),
+       CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+       NULL,
+       CMT_Instantiate<BandLimitedOscillator>,
+       activateBandLimitedOscillator,
+       afBandLimitedRunFunction[lPluginIndex],
+       NULL,
+       NULL,
+       NULL);
+    
+    psDescriptor->addPort
+      (piFrequencyPortProperties[lPluginIndex],
+       "Frequency",
+       (LADSPA_HINT_BOUNDED_BELOW
+	| LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_SAMPLE_RATE 
+	| LADSPA_HINT_LOGARITHMIC
+	| LADSPA_HINT_DEFAULT_440),
+       0, 
+       0.5);
+    psDescriptor->addPort
+      (piAmplitudePortProperties[lPluginIndex],
+       "Amplitude",
+       (LADSPA_HINT_BOUNDED_BELOW 
+	| LADSPA_HINT_LOGARITHMIC
+	| LADSPA_HINT_DEFAULT_1),
+       0,
+       0);
+    psDescriptor->addPort
+      (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+       "Output");
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Waveform (0 = Sine, 1 = Triangle, 2 = Square, 3 = Sawtooth)",
+       (LADSPA_HINT_BOUNDED_BELOW
+	| LADSPA_HINT_BOUNDED_ABOVE
+	| LADSPA_HINT_INTEGER
+	| LADSPA_HINT_DEFAULT_0),
+       0,
+       WAVEFORM_COUNT - 1);
+    psDescriptor->addPort
+      (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+       "Cubic Interpolation",
+       (LADSPA_HINT_TOGGLED
+	| LADSPA_HINT_DEFAULT_0),
+       0,
+       0);
 
-void 
-finalise_sine() {
-  delete [] g_pfSineTable;
+    registerNewPluginDescriptor(psDescriptor);
+  }
+
+  const char * apcPolyLabels[] = {
+    "sine_poly4",
+    "sine_poly8",
+    "sine_poly16"
+  };
+  const char * apcPolyNames[] = { 
+    "Polyphonic Sine Oscillator Bank (4 Voices)",
+    "Polyphonic Sine Oscillator Bank (8 Voices)",
+    "Polyphonic Sine Oscillator Bank (16 Voices)"
+  };
+  const int piPolyVoices[] = { 4, 8, 16 };
+  LADSPA_Run_Function afPolyRunFunction[] = {
+    runPolySineOscillator<4>,
+    runPolySineOscillator<8>,
+    runPolySineOscillator<16>
+  };
+
+  for (long lPluginIndex = 0; lPluginIndex < 3; lPluginIndex++) {
+    
+    CMT_Descriptor * psDescriptor;
+    
+    psDescriptor = new CMT_Descriptor
+      (1939 + lPluginIndex,
+       apcPolyLabels[lPluginIndex],
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       apcPolyNames[lPluginIndex],
+       CMT_MAKER("Richard W.E. Furse"),
+       CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+       NULL,
+       CMT_Instantiate<PolySineOscillator>,
+       activatePolySineOscillator,
+       afPolyRunFunction[lPluginIndex],
+       NULL,
+       NULL,
+       NULL);
+    
+    psDescriptor->addPort
+      (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+       "Output");
+    for (int iVoice = 0; iVoice < piPolyVoices[lPluginIndex]; iVoice++) {
+      char acFrequencyName[32];
+      char acAmplitudeName[32];
+      sprintf(acFrequencyName, "Frequency %d", iVoice + 1);
+      sprintf(acAmplitudeName, "Amplitude %d", iVoice + 1);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 acFrequencyName,
+	 (LADSPA_HINT_BOUNDED_BELOW
+	  | LADSPA_HINT_BOUNDED_ABOVE
+	  | LADSPA_HINT_SAMPLE_RATE 
+	  | LADSPA_HINT_LOGARITHMIC
+	  | LADSPA_HINT_DEFAULT_440),
+	 0, 
+	 0.5);
+      psDescriptor->addPort
+	(LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	 acAmplitudeName,
+	 (LADSPA_HINT_BOUNDED_BELOW 
+	  | (iVoice == 0 ? LADSPA_HINT_DEFAULT_1 : LADSPA_HINT_DEFAULT_0)),
+	 0,
+	 0);
+    }
+
+    registerNewPluginDescriptor(psDescriptor);
+  }
 }
 
 /*****************************************************************************/
@@ -31,6 +31,8 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "lanes.h"
+#include "oversample.h"
 #include "run_adding.h"
 
 /*****************************************************************************/
@@ -44,7 +46,11 @@ namespace sledgehammer {
 	port_modulator = 3,
 	port_carrier   = 4,
 	port_output    = 5,
-	n_ports        = 6
+	n_ports        = 6,
+
+	// The oversampled version adds:
+	port_oversampling = 6,
+	n_oversampled_ports = 7
     };
     
     static void activate(LADSPA_Handle instance);
@@ -53,7 +59,84 @@ namespace sledgehammer {
 	            unsigned long sample_count);
     static void set_run_adding_gain(LADSPA_Handle instance,
                                     LADSPA_Data new_gain);
-  
+    static void activate_oversampled(LADSPA_Handle instance);
+    template<OutputFunction write_output>
+    static void run_oversampled(LADSPA_Handle instance,
+				unsigned long sample_count);
+    static void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						LADSPA_Data new_gain);
+
+    // samples processed per pass of process(), below.
+    const unsigned long process_chunk = 64;
+
+    // the gain for one sample, as process() works out four at a time.
+    static inline LADSPA_Data gain(LADSPA_Data ms_mod,
+				   LADSPA_Data ms_car,
+				   LADSPA_Data mod_infl,
+				   LADSPA_Data car_infl) {
+	LADSPA_Data rms_mod = sqrt(ms_mod);
+	LADSPA_Data rms_car = sqrt(ms_car);
+	LADSPA_Data g = (rms_mod-0.5f)*mod_infl+0.5f;
+	if (rms_car>0)
+	    g *= ((rms_car-0.5f)*car_infl+0.5f)/rms_car;
+	return g;
+    }
+
+/** Track the mean squares of the modulator and carrier and write the
+    carrier with its dynamics replaced to out, which may be car. The
+    averages depend on the sample before so are tracked one sample at
+    a time, but the square roots and gains, which are most of the
+    work, are then done four samples at a time with a mask in place
+    of the test for silence. */
+    template<OutputFunction write_output>
+    static void process(LADSPA_Data & running_ms_mod,
+			LADSPA_Data & running_ms_car,
+			const LADSPA_Data * mod,
+			const LADSPA_Data * car,
+			LADSPA_Data * out,
+			unsigned long count,
+			LADSPA_Data rate,
+			LADSPA_Data mod_infl,
+			LADSPA_Data car_infl,
+			LADSPA_Data run_adding_gain) {
+	LADSPA_Data ms_mod[process_chunk];
+	LADSPA_Data ms_car[process_chunk];
+	const Lanes mod_infl_lanes = lanesSplat(mod_infl);
+	const Lanes car_infl_lanes = lanesSplat(car_infl);
+	const Lanes half = lanesSplat(0.5f);
+	const Lanes one = lanesSplat(1);
+	const Lanes zero = lanesSplat(0);
+	while (count > 0) {
+	    const unsigned long n = count < process_chunk ? count : process_chunk;
+	    for ( unsigned long i = 0; i < n ; ++i ) {
+		running_ms_mod = running_ms_mod*(1-rate) + (mod[i]*mod[i])*rate;
+		running_ms_car = running_ms_car*(1-rate) + (car[i]*car[i])*rate;
+		ms_mod[i] = running_ms_mod;
+		ms_car[i] = running_ms_car;
+	    }
+	    unsigned long i = 0;
+	    for ( ; i + LANE_COUNT <= n ; i += LANE_COUNT ) {
+		const Lanes rms_mod = lanesSqrt(lanesLoad(ms_mod + i));
+		const Lanes rms_car = lanesSqrt(lanesLoad(ms_car + i));
+		const Lanes car_gain
+		    = lanesSelect(rms_car > zero,
+				  ((rms_car-half)*car_infl_lanes+half)/rms_car,
+				  one);
+		const Lanes mod_gain = (rms_mod-half)*mod_infl_lanes+half;
+		lanesWriteOutput<write_output>(out,
+					       lanesLoad(car + i)*car_gain*mod_gain,
+					       run_adding_gain);
+	    }
+	    for ( ; i < n ; ++i )
+		write_output(out,
+			     car[i]*gain(ms_mod[i], ms_car[i], mod_infl, car_infl),
+			     run_adding_gain);
+	    mod += n;
+	    car += n;
+	    count -= n;
+	}
+    }
+
 /** This plugin imposes the dynamics of one sound onto another.
     It can be seen as a brutal compressor with a sidechain, or
     as a kind of one-band vocoder. */
@@ -98,49 +181,101 @@ namespace sledgehammer {
 	LADSPA_Data * carptr    =  pp->m_ppfPorts[port_carrier];
 	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
 
-	for ( unsigned long i = 0; i < sample_count ; ++i ) {
-	    LADSPA_Data mod = *(modptr++);
-	    LADSPA_Data car = *(carptr++);
+	process<write_output>(p.running_ms_mod, p.running_ms_car,
+			      modptr, carptr, out, sample_count,
+			      rate, mod_infl, car_infl, p.run_adding_gain);
+    }
+    
+    static void set_run_adding_gain(LADSPA_Handle instance,
+                                    LADSPA_Data new_gain) {
+	((Plugin *) instance)->run_adding_gain = new_gain;
+    }
+
+/** As Plugin, but the signals may be oversampled to reduce the
+    aliasing caused by the gain changing every sample. */
+    class OversampledPlugin : public CMT_PluginInstance {
+	LADSPA_Data run_adding_gain;
+	LADSPA_Data running_ms_mod;
+	LADSPA_Data running_ms_car;
+	Oversampler mod_oversampler;
+	Oversampler car_oversampler; // also downsamples the output
+	LADSPA_Data mod_buffer[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+	LADSPA_Data car_buffer[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+    public:
+	OversampledPlugin(const LADSPA_Descriptor *,
+			  unsigned long)
+	    : CMT_PluginInstance(n_oversampled_ports) {}
 
-	    p.running_ms_mod = p.running_ms_mod*(1-rate) + (mod*mod)*rate;
-	    p.running_ms_car = p.running_ms_car*(1-rate) + (car*car)*rate;
-	    
-	    LADSPA_Data rms_mod = sqrt(p.running_ms_mod);
-	    LADSPA_Data rms_car = sqrt(p.running_ms_car);
+	friend void activate_oversampled(LADSPA_Handle instance);
 
-	    LADSPA_Data outsig = car;
+	template<OutputFunction write_output>
+	friend void run_oversampled(LADSPA_Handle instance,
+				    unsigned long sample_count);
 
-	    if (rms_car>0)
-		outsig *= ((rms_car-0.5)*car_infl+0.5)/rms_car;
+	friend void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						    LADSPA_Data new_gain);
+    };
 
-	    outsig *= ((rms_mod-0.5)*mod_infl+0.5);
+    static void activate_oversampled(LADSPA_Handle instance) {
+	OversampledPlugin *pp = (OversampledPlugin *) instance;
+	OversampledPlugin &p  = *pp;
 
-	    write_output(out, outsig ,p.run_adding_gain);
+	p.running_ms_mod = 0;
+	p.running_ms_car = 0;
+	p.mod_oversampler.reset();
+	p.car_oversampler.reset();
+    }
+
+    template<OutputFunction write_output>
+    static void run_oversampled(LADSPA_Handle instance,
+				unsigned long sample_count) {
+
+	OversampledPlugin *pp = (OversampledPlugin *) instance;
+	OversampledPlugin &p  = *pp;
+
+	p.mod_oversampler.setFactor(*pp->m_ppfPorts[port_oversampling]);
+	p.car_oversampler.setFactor(*pp->m_ppfPorts[port_oversampling]);
+	const int factor = p.car_oversampler.getFactor();
+
+	// The averaging rate is per sample, so is slowed to match.
+	LADSPA_Data   rate      = *pp->m_ppfPorts[port_rate] / factor;
+	LADSPA_Data   mod_infl  = *pp->m_ppfPorts[port_mod_infl];
+	LADSPA_Data   car_infl  = *pp->m_ppfPorts[port_car_infl];
+	LADSPA_Data * modptr    =  pp->m_ppfPorts[port_modulator];
+	LADSPA_Data * carptr    =  pp->m_ppfPorts[port_carrier];
+	LADSPA_Data * out       =  pp->m_ppfPorts[port_output];
+
+	while (sample_count > 0) {
+	    unsigned long count = sample_count;
+	    if (count > OVERSAMPLE_CHUNK)
+		count = OVERSAMPLE_CHUNK;
+
+	    p.mod_oversampler.upsample(modptr, p.mod_buffer, count);
+	    p.car_oversampler.upsample(carptr, p.car_buffer, count);
+
+	    process<write_output_normal>(p.running_ms_mod, p.running_ms_car,
+					 p.mod_buffer, p.car_buffer,
+					 p.car_buffer, count * factor,
+					 rate, mod_infl, car_infl, 1);
+
+	    p.car_oversampler.downsample(p.car_buffer, p.car_buffer, count);
+
+	    for ( unsigned long i = 0; i < count ; ++i )
+		write_output(out, p.car_buffer[i], p.run_adding_gain);
+
+	    modptr += count;
+	    carptr += count;
+	    sample_count -= count;
 	}
     }
-    
-    static void set_run_adding_gain(LADSPA_Handle instance,
-                                    LADSPA_Data new_gain) {
-	((Plugin *) instance)->run_adding_gain = new_gain;
+
+    static void set_run_adding_gain_oversampled(LADSPA_Handle instance,
+						LADSPA_Data new_gain) {
+	((OversampledPlugin *) instance)->run_adding_gain = new_gain;
     }
 
-    void
-    initialise() {
-  
-	CMT_Descriptor * d = new CMT_Descriptor
-	    (1848,
-	     "sledgehammer",
-	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
-	     "Dynamic Sledgehammer",
-	     CMT_MAKER("Nathaniel Virgo"),
-	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
-	     NULL,
-	     CMT_Instantiate<Plugin>,
-	     activate,
-	     run<write_output_normal>,
-	     run<write_output_adding>,
-	     set_run_adding_gain,
-	     NULL);
+    static void
+    add_ports(CMT_Descriptor * d) {
 
 	d->addPort
 	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
@@ -175,6 +310,52 @@ namespace sledgehammer {
 	d->addPort
 	    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
 	     "Output");
+    }
+
+    void
+    initialise() {
+  
+	CMT_Descriptor * d = new CMT_Descriptor
+	    (1848,
+	     "sledgehammer",
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	     "Dynamic Sledgehammer",
+	     CMT_MAKER("Nathaniel Virgo"),
+	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
+	     NULL,
+	     CMT_Instantiate<Plugin>,
+	     activate,
+	     run<write_output_normal>,
+	     run<write_output_adding>,
+	     set_run_adding_gain,
+	     NULL);
+
+	add_ports(d);
+
+	registerNewPluginDescriptor(d);
+
+	d = new CMT_Descriptor
+	    (1999,
+	     "sledgehammer_os",
+	     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+	     "Dynamic Sledgehammer (Oversampled)",
+	     CMT_MAKER("Nathaniel Virgo"),
+	     CMT_COPYRIGHT("2002", "Nathaniel Virgo"),
+	     NULL,
+	     CMT_Instantiate<OversampledPlugin>,
+	     activate_oversampled,
+	     run_oversampled<write_output_normal>,
+	     run_oversampled<write_output_adding>,
+	     set_run_adding_gain_oversampled,
+	     NULL);
+
+	add_ports(d);
+	d->addPort
+	    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+	     OVERSAMPLE_PORT_NAME,
+	     OVERSAMPLE_PORT_HINTS,
+	     1,
+	     OVERSAMPLE_MAX_FACTOR);
 
 	registerNewPluginDescriptor(d);
 
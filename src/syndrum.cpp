@@ -26,6 +26,8 @@
 #include <cmath>
 #include <cstdlib>
 #include "cmt.h"
+#include "run_adding.h"
+#include "voices.h"
 
 #define PORT_OUT       0
 #define PORT_TRIGGER   1
@@ -111,6 +113,213 @@ public:
   }
 };
 
+/*****************************************************************************/
+
+/* Drum bank. Rather than one SynDrum per hit, this plays overlapping
+   hits on a fixed pool of voices. The trigger is an audio input: a
+   hit starts on each sample where it rises above zero, with the
+   value of that sample as its velocity, so hits land on the right
+   sample whatever the block size. Each hit takes a free voice, or
+   failing that steals the quietest (see voices.h), and runs the
+   spring and envelope of SynDrum with the shared controls. A stolen
+   voice keeps its spring position so the new hit takes over without
+   a click. Nothing is allocated after instantiation.
+
+   Voice state is held as arrays so that all voices are run together,
+   LANE_COUNT at a time. */
+
+#define BANK_PORT_OUT       0
+#define BANK_PORT_TRIGGER   1
+#define BANK_PORT_FREQ      2
+#define BANK_PORT_RESONANCE 3
+#define BANK_PORT_RATIO     4
+
+#define BANK_NUM_PORTS      5
+
+#define BANK_VOICES         8
+#define BANK_CHUNK          64
+
+class SynDrumBank : public CMT_PluginInstance {
+  LADSPA_Data sample_rate;
+  LADSPA_Data run_adding_gain;
+  VoiceAllocator voices;
+
+  LADSPA_Data spring_vel[BANK_VOICES];
+  LADSPA_Data spring_pos[BANK_VOICES];
+  LADSPA_Data env[BANK_VOICES];
+
+  LADSPA_Data last_trigger;
+
+public:
+  SynDrumBank(const LADSPA_Descriptor *,
+              unsigned long s_rate)
+    : CMT_PluginInstance(BANK_NUM_PORTS),
+      sample_rate(s_rate),
+      run_adding_gain(1.0F),
+      voices(1, BANK_VOICES) {
+    activate(this);
+  }
+
+  static void
+  activate(LADSPA_Handle Instance) {
+    SynDrumBank *bank = (SynDrumBank*) Instance;
+    for (int v = 0; v < BANK_VOICES; v++)
+      {
+        bank->spring_vel[v] = 0.0F;
+        bank->spring_pos[v] = 0.0F;
+        bank->env[v] = 0.0F;
+      }
+    bank->voices.reset();
+    bank->last_trigger = 0.0F;
+  }
+
+  static void
+  set_run_adding_gain(LADSPA_Handle Instance,
+                      LADSPA_Data   Gain) {
+    ((SynDrumBank*) Instance)->run_adding_gain = Gain;
+  }
+
+  /* Positions in [0, count) where trigger rises above zero, returning
+     how many. prev is the sample before trigger[0]. Groups of
+     LANE_COUNT samples are checked together, as edges are rare. */
+  static unsigned long
+  find_edges(const LADSPA_Data *trigger,
+             unsigned long      count,
+             LADSPA_Data        prev,
+             unsigned long     *edges) {
+    const Lanes zero = lanesSplat(0.0F);
+    unsigned long found = 0;
+    unsigned long i = 0;
+
+    for (; i + LANE_COUNT <= count; i += LANE_COUNT)
+      {
+        const Lanes x = lanesLoad(trigger + i);
+        if (lanesAny((x > zero) & (zero >= lanesShiftIn(prev, x))))
+          for (unsigned long j = i; j < i + LANE_COUNT; j++)
+            {
+              if (trigger[j] > 0.0F && prev <= 0.0F)
+                edges[found++] = j;
+              prev = trigger[j];
+            }
+        else
+          prev = trigger[i + LANE_COUNT - 1];
+      }
+    for (; i < count; i++)
+      {
+        if (trigger[i] > 0.0F && prev <= 0.0F)
+          edges[found++] = i;
+        prev = trigger[i];
+      }
+    return found;
+  }
+
+  /* Start a hit. The allocator works in keys, so the hit is a key
+     that goes down and straight up again, leaving its voice released
+     and free to be stolen by quietness. */
+  void
+  hit(LADSPA_Data velocity) {
+    int event, released;
+    int v = voices.followKey(0, true, env, event);
+    voices.followKey(0, false, env, released);
+    if (event == VOICE_STARTED)
+      spring_pos[v] = 0.0F;
+    spring_vel[v] = velocity;
+    env[v] = velocity;
+  }
+
+  /* Run the active voices from sample start to end of mix, adding
+     their sum. */
+  void
+  render(LADSPA_Data   *mix,
+         unsigned long  start,
+         unsigned long  end,
+         const Lanes    freq,
+         const Lanes    freq_shift,
+         const Lanes    res) {
+    for (int group = 0; group < BANK_VOICES; group += LANE_COUNT)
+      {
+        if (!voices.isGroupActive(group))
+          continue;
+
+        Lanes vel = lanesLoad(spring_vel + group);
+        Lanes pos = lanesLoad(spring_pos + group);
+        Lanes e = lanesLoad(env + group);
+        for (unsigned long i = start; i < end; i++)
+          {
+            const Lanes cur_freq = freq + e * freq_shift;
+            vel = vel - pos * cur_freq;
+            pos = pos + vel * cur_freq;
+            vel = vel * res;
+            e = e * res;
+            mix[i] += lanesSum(pos);
+          }
+        lanesStore(spring_vel + group, vel);
+        lanesStore(spring_pos + group, pos);
+        lanesStore(env + group, e);
+      }
+  }
+
+  template <OutputFunction write_output>
+  static void
+  run(LADSPA_Handle Instance,
+      unsigned long SampleCount) {
+    SynDrumBank *bank = (SynDrumBank*) Instance;
+    LADSPA_Data **ports = bank->m_ppfPorts;
+    const LADSPA_Data *trigger = ports[BANK_PORT_TRIGGER];
+    LADSPA_Data *out = ports[BANK_PORT_OUT];
+
+    const LADSPA_Data factor = 2.0 * PI / bank->sample_rate;
+    const Lanes freq = lanesSplat(*ports[BANK_PORT_FREQ] * factor);
+    const Lanes freq_shift = lanesSplat(*ports[BANK_PORT_FREQ] *
+                                        *ports[BANK_PORT_RATIO] * factor);
+    const Lanes res = lanesSplat(pow (0.05, 1.0 / (bank->sample_rate *
+                                                   *ports[BANK_PORT_RESONANCE])));
+
+    for (unsigned long start = 0; start < SampleCount; start += BANK_CHUNK)
+      {
+        unsigned long count = SampleCount - start;
+        if (count > BANK_CHUNK)
+          count = BANK_CHUNK;
+
+        /* The trigger is read in full before any output is written,
+           so the output may share its buffer. */
+        unsigned long edges[BANK_CHUNK];
+        LADSPA_Data velocities[BANK_CHUNK];
+        const unsigned long edge_count
+          = find_edges(trigger + start, count, bank->last_trigger, edges);
+        for (unsigned long e = 0; e < edge_count; e++)
+          velocities[e] = trigger[start + edges[e]];
+        bank->last_trigger = trigger[start + count - 1];
+
+        LADSPA_Data mix[BANK_CHUNK];
+        for (unsigned long i = 0; i < count; i++)
+          mix[i] = 0.0F;
+
+        unsigned long position = 0;
+        for (unsigned long e = 0; e < edge_count; e++)
+          {
+            bank->render(mix, position, edges[e], freq, freq_shift, res);
+            bank->hit(velocities[e]);
+            position = edges[e];
+          }
+        bank->render(mix, position, count, freq, freq_shift, res);
+
+        for (unsigned long i = 0; i < count; i++)
+          write_output(out, mix[i], bank->run_adding_gain);
+
+        /* Return voices that have died away to the pool. */
+        for (int v = 0; v < BANK_VOICES; v++)
+          if (bank->voices.isActive(v) && bank->env[v] < VOICE_SILENCE)
+            {
+              bank->voices.retireVoice(v);
+              bank->spring_vel[v] = 0.0F;
+              bank->spring_pos[v] = 0.0F;
+              bank->env[v] = 0.0F;
+            }
+      }
+  }
+};
+
 
 static LADSPA_PortDescriptor g_psPortDescriptors[] =
 {
@@ -171,4 +380,35 @@ initialise_syndrum() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2024,
+       "syndrum_bank",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "Syn Drum Bank",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("1999, 2000", "David A. Bartold"),
+       NULL,
+       CMT_Instantiate<SynDrumBank>,
+       SynDrumBank::activate,
+       SynDrumBank::run<write_output_normal>,
+       SynDrumBank::run<write_output_adding>,
+       SynDrumBank::set_run_adding_gain,
+       NULL);
+
+  psDescriptor->addPort(
+    g_psPortDescriptors[PORT_OUT],
+    g_psPortNames[PORT_OUT]);
+  psDescriptor->addPort(
+    LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+    "Trigger (Velocity)");
+  for (int i = PORT_FREQ; i < NUM_PORTS; i++)
+    psDescriptor->addPort(
+      g_psPortDescriptors[i],
+      g_psPortNames[i],
+      g_psPortRangeHints[i].HintDescriptor,
+      g_psPortRangeHints[i].LowerBound,
+      g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
 }
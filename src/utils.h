@@ -25,10 +25,12 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <stdint.h>
 
 /*****************************************************************************/
 
 #include "ladspa_types.h"
+#include "prng.h"
 
 /*****************************************************************************/
 
@@ -78,19 +80,195 @@ BOUNDED(const LADSPA_Data fData,
 
 /*****************************************************************************/
 
+/** Fast approximation to log2(fValue) for positive finite fValue,
+    taking the exponent from the float representation and fitting a
+    fifth order polynomial to the mantissa. The absolute error is
+    below 3e-5. Zero and denormals return roughly -127. */
+inline float
+fastLog2(const float fValue) {
+  union { float f; int32_t i; } uValue;
+  uValue.f = fValue;
+  float fExponent = float(((uValue.i >> 23) & 0xFF) - 127);
+  uValue.i = (uValue.i & 0x007FFFFF) | 0x3F800000;
+  float fMantissa = uValue.f - 1;
+  return fExponent
+    + fMantissa * (1.44182550f
+		   + fMantissa * (-0.70867891f
+				  + fMantissa * (0.41541119f
+						 + fMantissa * (-0.19440832f
+								+ fMantissa
+								* 0.04587895f))));
+}
+
+/** Fast approximation to pow(2, fValue), building the integer part
+    of the result directly in the float exponent and using a fourth
+    order polynomial for the fractional part. The relative error is
+    below 5e-6. Arguments are clamped to [-126, 126] so the result is
+    always a normal float. */
+inline float
+fastExp2(float fValue) {
+  if (fValue < -126)
+    fValue = -126;
+  else if (fValue > 126)
+    fValue = 126;
+  int32_t iInteger = int32_t(fValue);
+  if (fValue < iInteger)
+    iInteger--;
+  float fFraction = fValue - iInteger;
+  union { float f; int32_t i; } uScale;
+  uScale.i = (iInteger + 127) << 23;
+  return uScale.f
+    * (1 + fFraction * (0.69301863f
+			+ fFraction * (0.24140477f
+				       + fFraction * (0.05207394f
+						      + fFraction
+						      * 0.01349348f))));
+}
+
+/** Fast approximation to 1 / sqrt(fValue) for positive normal
+    fValue, taking a first guess from the float representation and
+    refining it with two Newton-Raphson steps. The relative error is
+    below 5e-6. */
+inline float
+fastInverseSqrt(const float fValue) {
+  union { float f; int32_t i; } uValue;
+  uValue.f = fValue;
+  uValue.i = 0x5F375A86 - (uValue.i >> 1);
+  float fResult = uValue.f;
+  const float fHalfValue = 0.5f * fValue;
+  fResult *= 1.5f - fHalfValue * fResult * fResult;
+  fResult *= 1.5f - fHalfValue * fResult * fResult;
+  return fResult;
+}
+
+/*****************************************************************************/
+
+/** Time in seconds over which ParameterSmoother glides to a new
+    control value by default. This is short enough to track a control
+    closely but long enough to remove zipper noise. */
+#define PARAMETER_SMOOTHING_TIME 0.01
+
+/** Smooths a control port value, which plugins otherwise read once
+    per block. When the port changes the value ramps linearly to the
+    new one over a fixed number of samples, independent of the block
+    size, so hosts can use long blocks without zipper noise. A typical
+    run() is:
+
+      oSmoother.setTarget(*(m_ppfPorts[PORT]));
+      if (oSmoother.isConstant()) {
+        Process with oSmoother.getValue() throughout.
+      }
+      else {
+        Process with oSmoother.next() for each sample.
+      }
+
+    next() holds the target once the ramp is over, so a block in which
+    a ramp ends may keep calling it. The first value after
+    construction or reset() is taken immediately. T may be any
+    floating point type, as plugins keep some coefficients in double
+    precision. */
+template <class T = LADSPA_Data>
+class ParameterSmoother {
+private:
+
+  T m_tValue;
+  T m_tTarget;
+  T m_tStep;
+
+  unsigned long m_lRampLength;
+  unsigned long m_lRemaining;
+  bool m_bPrimed;
+
+public:
+
+  ParameterSmoother(const LADSPA_Data fSampleRate = 0,
+		    const LADSPA_Data fTime = PARAMETER_SMOOTHING_TIME)
+    : m_tValue(0),
+      m_tTarget(0),
+      m_tStep(0),
+      m_lRampLength((unsigned long)(fSampleRate * fTime)),
+      m_lRemaining(0),
+      m_bPrimed(false) {
+  }
+
+  /** Forget the current value so the next target is taken without a
+      ramp. Call from activate(). */
+  void reset() {
+    m_lRemaining = 0;
+    m_bPrimed = false;
+  }
+
+  /** Set the value to ramp to, normally the port value at the start
+      of each block. */
+  void setTarget(const T tTarget) {
+    if (!m_bPrimed || m_lRampLength == 0) {
+      m_tValue = m_tTarget = tTarget;
+      m_lRemaining = 0;
+      m_bPrimed = true;
+    }
+    else if (tTarget != m_tTarget) {
+      m_tTarget = tTarget;
+      m_tStep = (tTarget - m_tValue) / T(m_lRampLength);
+      m_lRemaining = m_lRampLength;
+    }
+  }
+
+  /** True if no ramp is in progress, so getValue() holds for the
+      whole block. */
+  bool isConstant() const {
+    return m_lRemaining == 0;
+  }
+
+  /** The current value. */
+  T getValue() const {
+    return m_tValue;
+  }
+
+  T getTarget() const {
+    return m_tTarget;
+  }
+
+  /** Advance one sample and return the value for it. */
+  T next() {
+    if (m_lRemaining > 0) {
+      if (--m_lRemaining == 0)
+	m_tValue = m_tTarget;
+      else
+	m_tValue += m_tStep;
+    }
+    return m_tValue;
+  }
+
+  /** Advance lSampleCount samples. */
+  void skip(const unsigned long lSampleCount) {
+    if (lSampleCount >= m_lRemaining) {
+      m_tValue = m_tTarget;
+      m_lRemaining = 0;
+    }
+    else {
+      m_tValue += m_tStep * T(lSampleCount);
+      m_lRemaining -= lSampleCount;
+    }
+  }
+
+};
+
+/*****************************************************************************/
+
 /* Take a reading from a normal RV. The algorithm works by repeated
-   sampling of the uniform distribution, the lQuality variable giving
-   the number of samples. */
+   sampling of the uniform distribution (from the caller's generator),
+   the lQuality variable giving the number of samples. */
 inline double 
-sampleNormalDistribution(const double dMean,
+sampleNormalDistribution(PRNG &       oRandom,
+			 const double dMean,
 			 const double dStandardDeviation,
 			 const long   lQuality = 12) {
 
   double dValue = 0;
   for (long lIter = 0; lIter < lQuality; lIter++)
-    dValue += rand();
+    dValue += oRandom.nextUnipolar();
 
-  double dSampleFromNormal01 = (dValue / RAND_MAX) - (lQuality * 0.5);
+  double dSampleFromNormal01 = dValue - (lQuality * 0.5);
 
   return dMean + dStandardDeviation * dSampleFromNormal01;
 }
@@ -27,6 +27,9 @@
 #include <cmath>
 #include <cstdlib>
 #include "cmt.h"
+#include "gate.h"
+#include "utils.h"
+#include "wavetable.h"
 
 #define PORT_IN        0
 #define PORT_OUT       1
@@ -35,13 +38,60 @@
 #define PORT_RESONANCE 4
 #define PORT_ENV_MOD   5
 #define PORT_DECAY     6
+#define PORT_INTERVAL  7
 
-#define NUM_PORTS      7
+#define NUM_PORTS      8
+
+/* While the controls are gliding the filter coefficients are
+   recalculated this often, in samples. */
+#define RAMP_INTERVAL  8
 
 #ifndef PI
 #define PI 3.14159265358979
 #endif
 
+/* The filter coefficients are generated from tables and fast
+   approximations, accurate to a few parts in a million. Define
+   VCF303_REFERENCE to use the exact formulae instead. */
+
+/* exp(-x) for x from 0 to EXP_TABLE_RANGE, read with linear
+   interpolation. Beyond the range the filter pole is so close to
+   zero that the last entry is used. */
+#define EXP_TABLE_SIZE  4096
+#define EXP_TABLE_RANGE 16
+
+static LADSPA_Data g_exp_table[EXP_TABLE_SIZE + 2];
+
+static void
+init_exp_table() {
+  for (int i = 0; i <= EXP_TABLE_SIZE + 1; i++)
+    g_exp_table[i] = exp (-i * (double) EXP_TABLE_RANGE / EXP_TABLE_SIZE);
+}
+
+static inline LADSPA_Data
+exp_neg(LADSPA_Data x) {
+#ifdef VCF303_REFERENCE
+  return exp (-x);
+#else
+  x *= (LADSPA_Data) EXP_TABLE_SIZE / EXP_TABLE_RANGE;
+  if (!(x < EXP_TABLE_SIZE))
+    return g_exp_table[EXP_TABLE_SIZE];
+  int i = (int) x;
+  LADSPA_Data frac = x - i;
+  return g_exp_table[i] + frac * (g_exp_table[i + 1] - g_exp_table[i]);
+#endif
+}
+
+/* exp(x) for the cutoff, resonance and decay calculations. */
+static inline LADSPA_Data
+exp_pos(LADSPA_Data x) {
+#ifdef VCF303_REFERENCE
+  return exp (x);
+#else
+  return fastExp2 (x * (LADSPA_Data) M_LOG2E);
+#endif
+}
+
 class Vcf303 : public CMT_PluginInstance {
   LADSPA_Data sample_rate;
 
@@ -49,6 +99,19 @@ class Vcf303 : public CMT_PluginInstance {
   int         last_trigger;
   int         envpos;
 
+  ParameterSmoother<> cutoff;
+  ParameterSmoother<> resonance;
+  ParameterSmoother<> env_mod;
+
+  /* Shared sine table, for cos(). */
+  const LADSPA_Data *sine_table;
+
+  /* Last update interval and decay setting, and the decay per update
+     they give. */
+  int         interval;
+  LADSPA_Data last_decay;
+  LADSPA_Data decay;
+
 public:
   Vcf303(const LADSPA_Descriptor *,
          unsigned long s_rate)
@@ -56,10 +119,18 @@ public:
       sample_rate(s_rate),
       d1(0.0), d2(0.0), c0(0.0),
       last_trigger(0),
-      envpos(0) {
+      envpos(0),
+      cutoff(s_rate),
+      resonance(s_rate),
+      env_mod(s_rate),
+      sine_table(acquireWavetable (WAVEFORM_SINE)->getLevel (0)),
+      interval(0),
+      last_decay(-1.0),
+      decay(0.0) {
   }
 
   ~Vcf303() {
+    releaseWavetable (WAVEFORM_SINE);
   }
 
   static void
@@ -71,6 +142,35 @@ public:
     vcf303->c0 = 0.0;
     vcf303->last_trigger = 0;
     vcf303->envpos = 0;
+    vcf303->cutoff.reset();
+    vcf303->resonance.reset();
+    vcf303->env_mod.reset();
+  }
+
+  /* Base cutoff given envmod, cutoff, and reso. */
+  static inline LADSPA_Data
+  calc_e0 (Vcf303      *filter,
+           LADSPA_Data  env_mod,
+           LADSPA_Data  cutoff,
+           LADSPA_Data  resonance) {
+    LADSPA_Data e0;
+
+    e0 = exp_pos (5.613 - 0.8 * env_mod + 2.1553 *
+                  cutoff - 0.7696 * (1.0 - resonance));
+    return e0 * (PI / filter->sample_rate);
+  }
+
+  /* cos(2 * x) for x >= 0. */
+  static inline LADSPA_Data
+  cos2 (Vcf303      *filter,
+        LADSPA_Data  x) {
+#ifdef VCF303_REFERENCE
+    return cos (2.0 * x);
+#else
+    LADSPA_Data cycles = x * (LADSPA_Data) (1.0 / PI) + 0.25F;
+    cycles -= (long) cycles;
+    return readWavetable (filter->sine_table, wavetablePhase (cycles));
+#endif
   }
 
   static inline void
@@ -84,9 +184,9 @@ public:
     LADSPA_Data whopping, k;
   
     whopping = e0 + c0;
-    k = exp (-whopping / resonance);
+    k = exp_neg (whopping / resonance);
   
-    *a = 2.0 * cos (2.0 * whopping) * k;
+    *a = 2.0 * cos2 (filter, whopping) * k;
     *b = -k * k;
     *c = (1.0 - *a - *b) * 0.2;
   }
@@ -98,35 +198,55 @@ public:
     unsigned long i;
     LADSPA_Data e0, d, a, b, c;
     LADSPA_Data decay, resonance;
+    int interval;
     LADSPA_Data **ports;
     int trigger;
+    bool gliding;
 
     /* Update vars given envmod, cutoff, and reso. */
     ports = vcf303->m_ppfPorts;
-    e0 = exp (5.613 - 0.8 * *ports[PORT_ENV_MOD] + 2.1553 *
-              *ports[PORT_CUTOFF] - 0.7696 * (1.0 - *ports[PORT_RESONANCE]));
-    e0 *= PI / vcf303->sample_rate;
+    vcf303->cutoff.setTarget (*ports[PORT_CUTOFF]);
+    vcf303->resonance.setTarget (*ports[PORT_RESONANCE]);
+    vcf303->env_mod.setTarget (*ports[PORT_ENV_MOD]);
+    gliding = !(vcf303->cutoff.isConstant ()
+                && vcf303->resonance.isConstant ()
+                && vcf303->env_mod.isConstant ());
+
+    e0 = calc_e0 (vcf303,
+                  vcf303->env_mod.getValue (),
+                  vcf303->cutoff.getValue (),
+                  vcf303->resonance.getValue ());
 
     trigger = (*ports[PORT_TRIGGER] > 0.0);
     if (trigger == 1 && vcf303->last_trigger == 0)
       {
         LADSPA_Data e1;
 
-        e1 = exp (6.109 + 1.5876 * *ports[PORT_ENV_MOD] + 2.1553 *
-                  *ports[PORT_CUTOFF] - 1.2 * (1.0 - *ports[PORT_RESONANCE]));
+        e1 = exp_pos (6.109 + 1.5876 * vcf303->env_mod.getValue () + 2.1553 *
+                  vcf303->cutoff.getValue () - 1.2 * (1.0 - vcf303->resonance.getValue ()));
         e1 *= PI / vcf303->sample_rate;
         vcf303->c0 = e1 - e0;
       }
     vcf303->last_trigger = trigger;
   
-    /* Update decay given envdecay. */
-    d = 0.2 + (2.3 * *ports[PORT_DECAY]);
-    d *= vcf303->sample_rate;
-    d = pow (0.1, 1.0 / d);
-    decay = pow (d, 64);
+    /* Update decay given envdecay and the update interval, only when
+       they change. */
+    interval = (int) *ports[PORT_INTERVAL];
+    if (interval < 1)
+      interval = 1;
+    if (interval != vcf303->interval || *ports[PORT_DECAY] != vcf303->last_decay)
+      {
+        d = 0.2 + (2.3 * *ports[PORT_DECAY]);
+        d *= vcf303->sample_rate;
+        d = pow (0.1, 1.0 / d);
+        vcf303->decay = pow (d, interval);
+        vcf303->interval = interval;
+        vcf303->last_decay = *ports[PORT_DECAY];
+      }
+    decay = vcf303->decay;
   
     /* Update resonance. */
-    resonance = exp (-1.20 + 3.455 * *ports[PORT_RESONANCE]);
+    resonance = exp_pos (-1.20 + 3.455 * vcf303->resonance.getValue ());
   
     recalc_a_b_c (vcf303, e0, vcf303->c0, resonance, &a, &b, &c);
 
@@ -134,6 +254,20 @@ public:
       {
         LADSPA_Data sample;
 
+        if (gliding)
+          {
+            LADSPA_Data fCutoff = vcf303->cutoff.next ();
+            LADSPA_Data fResonance = vcf303->resonance.next ();
+            LADSPA_Data fEnvMod = vcf303->env_mod.next ();
+
+            if ((i % RAMP_INTERVAL) == 0)
+              {
+                e0 = calc_e0 (vcf303, fEnvMod, fCutoff, fResonance);
+                resonance = exp_pos (-1.20 + 3.455 * fResonance);
+                recalc_a_b_c (vcf303, e0, vcf303->c0, resonance, &a, &b, &c);
+              }
+          }
+
         sample = a * vcf303->d1 + b * vcf303->d2 + c * ports[PORT_IN][i];
         ports[PORT_OUT][i] = sample;
 
@@ -141,7 +275,7 @@ public:
         vcf303->d1 = sample;
 
         vcf303->envpos++;
-        if (vcf303->envpos >= 64)
+        if (vcf303->envpos >= interval)
           {
             vcf303->envpos = 0;
             vcf303->c0 *= decay;
@@ -149,6 +283,14 @@ public:
           }
       }
   }
+
+  /* As run(), taking the trigger as an audio signal (see gate.h). */
+  static void
+  run_audio_trigger(LADSPA_Handle Instance,
+                   unsigned long SampleCount) {
+    runWithAudioGate (Instance, ((Vcf303*) Instance)->m_ppfPorts, SampleCount,
+                      PORT_TRIGGER, (1 << PORT_IN) | (1 << PORT_OUT), run);
+  }
 };
 
 
@@ -160,6 +302,7 @@ static LADSPA_PortDescriptor g_psPortDescriptors[] =
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
+  LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT,
   LADSPA_PORT_CONTROL | LADSPA_PORT_INPUT
 };
 
@@ -171,7 +314,8 @@ static const char * const g_psPortNames[] =
   "Cutoff",
   "Resonance",
   "Envelope Modulation",
-  "Decay"
+  "Decay",
+  "Envelope Update Interval (Samples)"
 };
 
 static LADSPA_PortRangeHint g_psPortRangeHints[] =
@@ -183,13 +327,18 @@ static LADSPA_PortRangeHint g_psPortRangeHints[] =
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 1.0 },
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 1.0 },
   { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 1.0 },
-  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 1.0 }
+  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW, 0.0, 1.0 },
+  { LADSPA_HINT_BOUNDED_ABOVE | LADSPA_HINT_BOUNDED_BELOW |
+    LADSPA_HINT_INTEGER | LADSPA_HINT_LOGARITHMIC |
+    LADSPA_HINT_DEFAULT_MIDDLE, 1.0, 4096.0 }
 };
 
 void
 initialise_vcf303() {
   CMT_Descriptor * psDescriptor;
 
+  init_exp_table ();
+
   psDescriptor = new CMT_Descriptor
       (1224,
        "vcf303",
@@ -214,4 +363,34 @@ initialise_vcf303() {
       g_psPortRangeHints[i].UpperBound);
 
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+      (2025,
+       "vcf303_audio_trigger",
+       LADSPA_PROPERTY_HARD_RT_CAPABLE,
+       "VCF 303 (Audio Trigger)",
+       CMT_MAKER("David A. Bartold"),
+       CMT_COPYRIGHT("1998-2000", "Andy Sloane, David A. Bartold"),
+       NULL,
+       CMT_Instantiate<Vcf303>,
+       Vcf303::activate,
+       Vcf303::run_audio_trigger,
+       NULL,
+       NULL,
+       NULL);
+
+  for (int i = 0; i < NUM_PORTS; i++)
+    if (i == PORT_TRIGGER)
+      psDescriptor->addPort(
+        LADSPA_PORT_AUDIO | LADSPA_PORT_INPUT,
+        g_psPortNames[i]);
+    else
+      psDescriptor->addPort(
+        g_psPortDescriptors[i],
+        g_psPortNames[i],
+        g_psPortRangeHints[i].HintDescriptor,
+        g_psPortRangeHints[i].LowerBound,
+        g_psPortRangeHints[i].UpperBound);
+
+  registerNewPluginDescriptor(psDescriptor);
 }
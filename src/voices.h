@@ -0,0 +1,238 @@
+/* voices.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_VOICES_INCLUDED
+#define CMT_VOICES_INCLUDED
+
+/*****************************************************************************/
+
+/* Support for polyphonic versions of the synth voices. These have a
+   set of shared controls followed by gate, velocity and frequency
+   ports for each key, and play the keys on a pool of voices. Voice
+   state is kept in arrays indexed by voice so that LANE_COUNT voices
+   can be run at once with the operations in lanes.h. */
+
+/*****************************************************************************/
+
+#include "lanes.h"
+
+/*****************************************************************************/
+
+#define VOICE_MAX_KEYS   16
+#define VOICE_MAX_VOICES 32
+
+/** Events returned by VoiceAllocator::followKey(). When a voice is
+    started from the free pool its state should be cleared, as an
+    activated mono voice would be. A stolen voice was still sounding,
+    so plugins may prefer to keep its oscillator state to avoid a
+    click. */
+#define VOICE_UNCHANGED 0
+#define VOICE_STARTED   1
+#define VOICE_STOLEN    2
+#define VOICE_RELEASED  3
+
+/** Released voices may be returned to the pool once their envelopes
+    fall below this (-100dB). */
+#define VOICE_SILENCE 1e-5F
+
+/*****************************************************************************/
+
+/** Assigns keys to voices. A key going down takes a free voice if
+    there is one, otherwise the quietest released voice, otherwise the
+    voice that has been held longest. Keys act on the rising edge of
+    their gates only, so a key held down keeps its voice until it is
+    released or stolen. */
+class VoiceAllocator {
+private:
+
+  int m_iKeyCount;
+  int m_iVoiceCount;
+
+  /** Voice playing each key, or -1 if the key is up or its voice was
+      stolen. */
+  int m_aiKeyVoice[VOICE_MAX_KEYS];
+  bool m_abKeyGate[VOICE_MAX_KEYS];
+
+  bool m_abHeld[VOICE_MAX_VOICES];
+  bool m_abActive[VOICE_MAX_VOICES];
+  unsigned long m_alStartTime[VOICE_MAX_VOICES];
+  unsigned long m_lNoteCount;
+
+  int findVoice(const LADSPA_Data * pfVoiceLevel, int & riEvent) {
+
+    int iVoice, iBest = -1;
+
+    for (iVoice = 0; iVoice < m_iVoiceCount; iVoice++)
+      if (!m_abActive[iVoice]) {
+	riEvent = VOICE_STARTED;
+	return iVoice;
+      }
+
+    riEvent = VOICE_STOLEN;
+    for (iVoice = 0; iVoice < m_iVoiceCount; iVoice++)
+      if (!m_abHeld[iVoice]
+	  && (iBest < 0 || pfVoiceLevel[iVoice] < pfVoiceLevel[iBest]))
+	iBest = iVoice;
+    if (iBest >= 0)
+      return iBest;
+
+    for (iVoice = 0; iVoice < m_iVoiceCount; iVoice++)
+      if (iBest < 0 || m_alStartTime[iVoice] < m_alStartTime[iBest])
+	iBest = iVoice;
+    for (int iKey = 0; iKey < m_iKeyCount; iKey++)
+      if (m_aiKeyVoice[iKey] == iBest)
+	m_aiKeyVoice[iKey] = -1;
+    return iBest;
+  }
+
+public:
+
+  VoiceAllocator(const int iKeyCount, const int iVoiceCount)
+    : m_iKeyCount(iKeyCount),
+      m_iVoiceCount(iVoiceCount) {
+    reset();
+  }
+
+  /** Release all keys and free all voices. Call from activate(). */
+  void reset() {
+    for (int iKey = 0; iKey < VOICE_MAX_KEYS; iKey++) {
+      m_aiKeyVoice[iKey] = -1;
+      m_abKeyGate[iKey] = false;
+    }
+    for (int iVoice = 0; iVoice < VOICE_MAX_VOICES; iVoice++) {
+      m_abHeld[iVoice] = false;
+      m_abActive[iVoice] = false;
+      m_alStartTime[iVoice] = 0;
+    }
+    m_lNoteCount = 0;
+  }
+
+  int getKeyCount() const {
+    return m_iKeyCount;
+  }
+  int getVoiceCount() const {
+    return m_iVoiceCount;
+  }
+
+  /** True while the key that started the voice is down. */
+  bool isHeld(const int iVoice) const {
+    return m_abHeld[iVoice];
+  }
+  /** True until a released voice is retired. */
+  bool isActive(const int iVoice) const {
+    return m_abActive[iVoice];
+  }
+
+  /** Follow the gate of key iKey at the start of a block. Returns the
+      voice playing the key, or -1 if there is none, and sets riEvent
+      to one of the VOICE_ events. pfVoiceLevel gives a loudness for
+      each voice and is used to pick a released voice to steal. A
+      VOICE_RELEASED event returns the voice that has just been
+      released. */
+  int followKey(const int iKey,
+		const bool bGate,
+		const LADSPA_Data * pfVoiceLevel,
+		int & riEvent) {
+    int iVoice = m_aiKeyVoice[iKey];
+    riEvent = VOICE_UNCHANGED;
+    if (bGate && !m_abKeyGate[iKey]) {
+      iVoice = findVoice(pfVoiceLevel, riEvent);
+      m_aiKeyVoice[iKey] = iVoice;
+      m_abHeld[iVoice] = true;
+      m_abActive[iVoice] = true;
+      m_alStartTime[iVoice] = ++m_lNoteCount;
+    }
+    else if (!bGate && iVoice >= 0) {
+      riEvent = VOICE_RELEASED;
+      m_abHeld[iVoice] = false;
+      m_aiKeyVoice[iKey] = -1;
+    }
+    m_abKeyGate[iKey] = bGate;
+    return iVoice;
+  }
+
+  /** Return a released voice that has died away to the pool. */
+  void retireVoice(const int iVoice) {
+    m_abActive[iVoice] = false;
+  }
+
+  /** True if any of the LANE_COUNT voices from iFirstVoice is
+      active. */
+  bool isGroupActive(const int iFirstVoice) const {
+    for (int iLane = 0; iLane < LANE_COUNT; iLane++)
+      if (m_abActive[iFirstVoice + iLane])
+	return true;
+    return false;
+  }
+
+};
+
+/*****************************************************************************/
+
+/** Settings for the envelope used by the synth voices, as returned by
+    the voices' multiplier() functions. */
+struct VoiceEnvelope {
+  Lanes m_vAttack;
+  Lanes m_vDecay;
+  Lanes m_vSustain;
+  Lanes m_vRelease;
+};
+
+inline void
+setVoiceEnvelope(VoiceEnvelope &   roEnvelope,
+		 const LADSPA_Data fAttack,
+		 const LADSPA_Data fDecay,
+		 const LADSPA_Data fSustain,
+		 const LADSPA_Data fRelease) {
+  roEnvelope.m_vAttack = lanesSplat(fAttack);
+  roEnvelope.m_vDecay = lanesSplat(fDecay);
+  roEnvelope.m_vSustain = lanesSplat(fSustain);
+  roEnvelope.m_vRelease = lanesSplat(fRelease);
+}
+
+/** Advance the envelopes of LANE_COUNT voices by one sample and
+    return them. While the gate is held the envelope rises towards 1
+    until it passes 0.95, after which (vDecaying) it falls to the
+    sustain level; once the gate is released it falls to zero. This is
+    the envelope() function of the mono voices. */
+inline Lanes
+runVoiceEnvelope(Lanes &               rvLevel,
+		 LaneMask &            rvDecaying,
+		 const LaneMask        vGate,
+		 const VoiceEnvelope & roEnvelope) {
+  const Lanes vZero = lanesSplat(0);
+  const Lanes vTarget
+    = lanesSelect(vGate,
+		  lanesSelect(rvDecaying, roEnvelope.m_vSustain, lanesSplat(1)),
+		  vZero);
+  const Lanes vRate
+    = lanesSelect(vGate,
+		  lanesSelect(rvDecaying, roEnvelope.m_vDecay, roEnvelope.m_vAttack),
+		  roEnvelope.m_vRelease);
+  rvLevel = rvLevel + (vTarget - rvLevel) * vRate;
+  rvDecaying = rvDecaying | (vGate & (rvLevel >= lanesSplat(0.95f)));
+  return rvLevel;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
@@ -0,0 +1,130 @@
+/* wavetable.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+
+/*****************************************************************************/
+
+#include "cmt.h"
+#include "wavetable.h"
+
+/*****************************************************************************/
+
+/** Amplitude of harmonic lHarmonic of a waveform, as a multiple of
+    sin(2 pi lHarmonic t). */
+static double
+harmonicAmplitude(const int iWaveform, const long lHarmonic) {
+  switch (iWaveform) {
+  case WAVEFORM_TRIANGLE:
+    if ((lHarmonic & 1) == 0)
+      return 0;
+    return ((lHarmonic & 2) ? -8 : 8) / (M_PI * M_PI * lHarmonic * lHarmonic);
+  case WAVEFORM_SQUARE:
+    if ((lHarmonic & 1) == 0)
+      return 0;
+    return 4 / (M_PI * lHarmonic);
+  case WAVEFORM_SAWTOOTH:
+    return -2 / (M_PI * lHarmonic);
+  default:
+    return lHarmonic == 1 ? 1 : 0;
+  }
+}
+
+/*****************************************************************************/
+
+Wavetable::Wavetable(const int iWaveform)
+  : m_iLevelCount(iWaveform == WAVEFORM_SINE ? 1 : WAVETABLE_LEVELS) {
+
+  m_pfData = allocateTableData(WAVETABLE_PADDING
+			       + m_iLevelCount * WAVETABLE_STRIDE);
+
+  /* Build the levels additively, each adding the harmonics the
+     previous one lacked. Harmonics are read from a sine table as
+     their phases are exact multiples of the table step. */
+  double * pdSine = new double[WAVETABLE_SIZE];
+  double * pdSum = new double[WAVETABLE_SIZE];
+  long lIndex;
+  for (lIndex = 0; lIndex < WAVETABLE_SIZE; lIndex++) {
+    pdSine[lIndex] = sin(lIndex * 2 * M_PI / WAVETABLE_SIZE);
+    pdSum[lIndex] = 0;
+  }
+
+  long lHarmonic = 1;
+  for (int iLevel = 0; iLevel < m_iLevelCount; iLevel++) {
+
+    for (; lHarmonic <= (1L << iLevel) && lHarmonic < WAVETABLE_SIZE / 2;
+	 lHarmonic++) {
+      const double dAmplitude = harmonicAmplitude(iWaveform, lHarmonic);
+      if (dAmplitude != 0)
+	for (lIndex = 0; lIndex < WAVETABLE_SIZE; lIndex++)
+	  pdSum[lIndex]
+	    += dAmplitude * pdSine[(lIndex * lHarmonic) & (WAVETABLE_SIZE - 1)];
+    }
+
+    LADSPA_Data * pfLevel
+      = m_pfData + WAVETABLE_PADDING + iLevel * WAVETABLE_STRIDE;
+    for (lIndex = 0; lIndex < WAVETABLE_SIZE; lIndex++)
+      pfLevel[lIndex] = LADSPA_Data(pdSum[lIndex]);
+    pfLevel[-1] = pfLevel[WAVETABLE_SIZE - 1];
+    pfLevel[WAVETABLE_SIZE] = pfLevel[0];
+    pfLevel[WAVETABLE_SIZE + 1] = pfLevel[1];
+  }
+
+  delete [] pdSum;
+  delete [] pdSine;
+}
+
+/*****************************************************************************/
+
+Wavetable::~Wavetable() {
+  freeTableData(m_pfData);
+}
+
+/*****************************************************************************/
+
+#define WAVETABLE_KEY "wavetable"
+
+static CMT_SharedTable *
+createWavetable(const int iWaveform) {
+  return new Wavetable(iWaveform);
+}
+
+/*****************************************************************************/
+
+const Wavetable *
+acquireWavetable(const int iWaveform) {
+  return (const Wavetable *)acquireSharedTable(WAVETABLE_KEY,
+					       iWaveform,
+					       createWavetable);
+}
+
+/*****************************************************************************/
+
+void
+releaseWavetable(const int iWaveform) {
+  releaseSharedTable(WAVETABLE_KEY, iWaveform);
+}
+
+/*****************************************************************************/
+
+/* EOF */
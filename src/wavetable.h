@@ -0,0 +1,164 @@
+/* wavetable.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_WAVETABLE_INCLUDED
+#define CMT_WAVETABLE_INCLUDED
+
+/*****************************************************************************/
+
+#include "cmt.h"
+
+/*****************************************************************************/
+
+/* Shared, band-limited wavetables for oscillators. Each waveform is
+   held as a set of octave-spaced tables ("levels"): level n holds
+   harmonics 1 to 2^n only, so an oscillator that picks its level from
+   its frequency with wavetableLevel() has no harmonics above the
+   Nyquist frequency. Tables are held in the shared table registry
+   (see cmt.h) so are built when first acquired and shared by all
+   plugins using them.
+
+   Oscillators keep their phase in an unsigned long accumulator that
+   wraps once per cycle (so a full cycle is 2^32 or 2^64 depending on
+   the platform). The top WAVETABLE_BITS bits select the table entry
+   and the following WAVETABLE_FRACTION_BITS bits are used for
+   interpolation. */
+
+/** Table size is given by (1 << WAVETABLE_BITS). */
+#define WAVETABLE_BITS 11
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS)
+#define WAVETABLE_SHIFT (8 * sizeof(unsigned long) - WAVETABLE_BITS)
+
+#define WAVETABLE_FRACTION_BITS 16
+#define WAVETABLE_FRACTION_SHIFT (WAVETABLE_SHIFT - WAVETABLE_FRACTION_BITS)
+
+/** Level n holds harmonics up to 2^n, so the top level holds all the
+    harmonics the table size allows. */
+#define WAVETABLE_LEVELS WAVETABLE_BITS
+
+/** Each level is stored with one guard point before the table and two
+    after so the interpolators never need to wrap. Levels are padded
+    so that each starts on a CMT_TABLE_ALIGNMENT boundary. */
+#define WAVETABLE_PADDING (CMT_TABLE_ALIGNMENT / sizeof(LADSPA_Data))
+#define WAVETABLE_STRIDE (WAVETABLE_SIZE + WAVETABLE_PADDING)
+
+#define WAVEFORM_SINE     0
+#define WAVEFORM_TRIANGLE 1
+#define WAVEFORM_SQUARE   2
+#define WAVEFORM_SAWTOOTH 3
+
+#define WAVEFORM_COUNT    4
+
+/*****************************************************************************/
+
+/** A band-limited waveform. All waveforms run from -1 to 1 (ignoring
+    the ripple of the band-limited square and sawtooth) and start at
+    phase zero on a rising zero crossing of their fundamental, except
+    the sawtooth which starts at -1. */
+class Wavetable : public CMT_SharedTable {
+private:
+
+  LADSPA_Data * m_pfData;
+
+  /** Sine waves need only one level, shared by all. */
+  int m_iLevelCount;
+
+public:
+
+  Wavetable(const int iWaveform);
+  ~Wavetable();
+
+  /** Returns table level iLevel, which may be indexed from -1 to
+      WAVETABLE_SIZE + 1. */
+  inline const LADSPA_Data * getLevel(const int iLevel) const {
+    const int iUsedLevel = iLevel < m_iLevelCount ? iLevel : m_iLevelCount - 1;
+    return m_pfData + WAVETABLE_PADDING + iUsedLevel * WAVETABLE_STRIDE;
+  }
+
+};
+
+/*****************************************************************************/
+
+/** Obtain the shared table for a waveform (WAVEFORM_SINE etc),
+    building it if no other plugin holds it. Each call must be matched
+    by a call to releaseWavetable(). These should be called from
+    instantiate() and cleanup() rather than run(). */
+const Wavetable * acquireWavetable(const int iWaveform);
+void releaseWavetable(const int iWaveform);
+
+/*****************************************************************************/
+
+/** Highest table level that is free of aliasing for an oscillator
+    advancing its phase by lPhaseStep per sample. */
+inline int
+wavetableLevel(const unsigned long lPhaseStep) {
+  /* Level n is safe while 2^n * lPhaseStep is no more than half a
+     cycle. */
+  const unsigned long lHalfCycle = 1UL << (8 * sizeof(unsigned long) - 1);
+  int iLevel = WAVETABLE_LEVELS - 1;
+  while (iLevel > 0 && (lPhaseStep > (lHalfCycle >> iLevel)))
+    iLevel--;
+  return iLevel;
+}
+
+/*****************************************************************************/
+
+/** Linearly interpolated table read. */
+inline LADSPA_Data
+readWavetable(const LADSPA_Data * pfTable, const unsigned long lPhase) {
+  const unsigned long lIndex = lPhase >> WAVETABLE_SHIFT;
+  const LADSPA_Data fFraction
+    = LADSPA_Data((lPhase >> WAVETABLE_FRACTION_SHIFT)
+		  & ((1UL << WAVETABLE_FRACTION_BITS) - 1))
+    * LADSPA_Data(1.0 / (1UL << WAVETABLE_FRACTION_BITS));
+  const LADSPA_Data fX0 = pfTable[lIndex];
+  return fX0 + fFraction * (pfTable[lIndex + 1] - fX0);
+}
+
+/** Four-point, third-order Hermite interpolated table read. */
+inline LADSPA_Data
+readWavetableCubic(const LADSPA_Data * pfTable, const unsigned long lPhase) {
+  const unsigned long lIndex = lPhase >> WAVETABLE_SHIFT;
+  const LADSPA_Data fFraction
+    = LADSPA_Data((lPhase >> WAVETABLE_FRACTION_SHIFT)
+		  & ((1UL << WAVETABLE_FRACTION_BITS) - 1))
+    * LADSPA_Data(1.0 / (1UL << WAVETABLE_FRACTION_BITS));
+  const LADSPA_Data * pfX = pfTable + lIndex;
+  const LADSPA_Data fC1 = 0.5f * (pfX[1] - pfX[-1]);
+  const LADSPA_Data fC2 = pfX[-1] - 2.5f * pfX[0] + 2 * pfX[1] - 0.5f * pfX[2];
+  const LADSPA_Data fC3 = 0.5f * (pfX[2] - pfX[-1]) + 1.5f * (pfX[0] - pfX[1]);
+  return ((fC3 * fFraction + fC2) * fFraction + fC1) * fFraction + pfX[0];
+}
+
+/** Convert a phase in cycles (from 0 up to but not including 1) to
+    the accumulator form used above. */
+inline unsigned long
+wavetablePhase(const LADSPA_Data fPhase) {
+  return (unsigned long)
+    (double(fPhase) 
+     * double(1UL << (WAVETABLE_BITS + WAVETABLE_FRACTION_BITS)))
+    << WAVETABLE_FRACTION_SHIFT;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
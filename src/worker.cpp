@@ -0,0 +1,203 @@
+/* worker.cpp
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+/*****************************************************************************/
+
+/* Each thread sleeps on a semaphore, which postJob() posts once per
+   job. Posting a semaphore never blocks and takes no lock, unlike
+   notifying a condition variable properly, so it is safe from run().
+   A thread holds its lock while it works through its clients' queues,
+   so a client being deleted waits for its job to finish. */
+
+/*****************************************************************************/
+
+#include <cerrno>
+#include <mutex>
+#include <semaphore.h>
+#include <thread>
+
+/*****************************************************************************/
+
+#include "worker.h"
+
+/*****************************************************************************/
+
+/** The most threads started, whatever the processor count. */
+#define CMT_MAX_WORKER_THREADS 8
+
+/*****************************************************************************/
+
+class CMT_WorkerThread {
+private:
+
+  std::thread m_oThread;
+  sem_t m_sWake;
+  std::atomic<bool> m_bStop;
+
+  /** Guards the client list and is held while jobs are done. */
+  std::mutex m_oMutex;
+  CMT_WorkerClient * m_poFirstClient;
+
+  void work() {
+    while (true) {
+      while (sem_wait(&m_sWake) != 0 && errno == EINTR)
+	;
+      if (m_bStop.load(std::memory_order_acquire))
+	return;
+      std::lock_guard<std::mutex> oLock(m_oMutex);
+      for (CMT_WorkerClient * poClient = m_poFirstClient;
+	   poClient != NULL;
+	   poClient = poClient->m_poNext) {
+	CMT_WorkItem sJob;
+	while (poClient->m_oJobs.pop(sJob))
+	  poClient->m_fWork(poClient->m_pvData, sJob, *poClient);
+      }
+    }
+  }
+
+public:
+
+  /** Clients attached, counted under the pool's lock. */
+  unsigned long m_lClientCount;
+
+  CMT_WorkerThread()
+    : m_bStop(false),
+      m_poFirstClient(NULL),
+      m_lClientCount(0) {
+    sem_init(&m_sWake, 0, 0);
+    m_oThread = std::thread(&CMT_WorkerThread::work, this);
+  }
+
+  ~CMT_WorkerThread() {
+    m_bStop.store(true, std::memory_order_release);
+    sem_post(&m_sWake);
+    m_oThread.join();
+    sem_destroy(&m_sWake);
+    /* Clients a host failed to clean up post nothing from now on. */
+    for (CMT_WorkerClient * poClient = m_poFirstClient;
+	 poClient != NULL;
+	 poClient = poClient->m_poNext)
+      poClient->m_poThread = NULL;
+  }
+
+  void wake() {
+    sem_post(&m_sWake);
+  }
+
+  void attach(CMT_WorkerClient * poClient) {
+    std::lock_guard<std::mutex> oLock(m_oMutex);
+    poClient->m_poNext = m_poFirstClient;
+    m_poFirstClient = poClient;
+  }
+
+  void detach(CMT_WorkerClient * poClient) {
+    std::lock_guard<std::mutex> oLock(m_oMutex);
+    CMT_WorkerClient ** ppoLink = &m_poFirstClient;
+    while (*ppoLink != poClient)
+      ppoLink = &(*ppoLink)->m_poNext;
+    *ppoLink = poClient->m_poNext;
+  }
+
+};
+
+/*****************************************************************************/
+
+/* The pool is plain static data, so needs no construction and may be
+   used from any instantiate() call. */
+
+static std::mutex g_oWorkerPoolMutex;
+static CMT_WorkerThread * g_apoWorkerThreads[CMT_MAX_WORKER_THREADS];
+static unsigned long g_lWorkerThreadCount = 0;
+static bool g_bWorkersFinalised = false;
+
+/** The thread a new client should use, starting one if all have
+    clients and more are allowed. NULL once the library is being
+    unloaded. Called under the pool's lock. */
+static CMT_WorkerThread *
+chooseWorkerThread() {
+
+  if (g_bWorkersFinalised)
+    return NULL;
+
+  CMT_WorkerThread * poBest = NULL;
+  for (unsigned long lIndex = 0; lIndex < g_lWorkerThreadCount; lIndex++)
+    if (poBest == NULL
+	|| (g_apoWorkerThreads[lIndex]->m_lClientCount
+	    < poBest->m_lClientCount))
+      poBest = g_apoWorkerThreads[lIndex];
+
+  unsigned long lLimit = std::thread::hardware_concurrency();
+  lLimit = lLimit > 1 ? lLimit - 1 : 1;
+  if (lLimit > CMT_MAX_WORKER_THREADS)
+    lLimit = CMT_MAX_WORKER_THREADS;
+
+  if ((poBest == NULL || poBest->m_lClientCount > 0)
+      && g_lWorkerThreadCount < lLimit) {
+    poBest = new CMT_WorkerThread;
+    g_apoWorkerThreads[g_lWorkerThreadCount++] = poBest;
+  }
+
+  return poBest;
+}
+
+/*****************************************************************************/
+
+CMT_WorkerClient::CMT_WorkerClient(CMT_WorkFunction fWork, void * pvData)
+  : m_fWork(fWork),
+    m_pvData(pvData),
+    m_poNext(NULL) {
+  std::lock_guard<std::mutex> oLock(g_oWorkerPoolMutex);
+  m_poThread = chooseWorkerThread();
+  if (m_poThread != NULL) {
+    m_poThread->m_lClientCount++;
+    m_poThread->attach(this);
+  }
+}
+
+CMT_WorkerClient::~CMT_WorkerClient() {
+  std::lock_guard<std::mutex> oLock(g_oWorkerPoolMutex);
+  if (m_poThread != NULL) {
+    m_poThread->detach(this);
+    m_poThread->m_lClientCount--;
+  }
+}
+
+bool
+CMT_WorkerClient::postJob(const CMT_WorkItem & rsJob) {
+  if (m_poThread == NULL || !m_oJobs.push(rsJob))
+    return false;
+  m_poThread->wake();
+  return true;
+}
+
+/*****************************************************************************/
+
+void
+finalise_workers() {
+  std::lock_guard<std::mutex> oLock(g_oWorkerPoolMutex);
+  for (unsigned long lIndex = 0; lIndex < g_lWorkerThreadCount; lIndex++)
+    delete g_apoWorkerThreads[lIndex];
+  g_lWorkerThreadCount = 0;
+  g_bWorkersFinalised = true;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,182 @@
+/* worker.h
+
+   Computer Music Toolkit - a library of LADSPA plugins. Copyright (C)
+   2000-2002 Richard W.E. Furse.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public Licence as
+   published by the Free Software Foundation; either version 2 of the
+   Licence, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA. */
+
+#ifndef CMT_WORKER_INCLUDED
+#define CMT_WORKER_INCLUDED
+
+/*****************************************************************************/
+
+/* Background work for plugins: building tables, preparing responses,
+   allocating buffers and anything else too slow or unsafe for run().
+   A plugin instance creates a CMT_WorkerClient in instantiate(),
+   posts jobs to it from run() and collects results there. Posting and
+   collecting are lock-free and never block, as each client has a
+   single-producer single-consumer queue in each direction with the
+   audio thread at one end and one worker thread at the other.
+
+   The worker threads belong to the library. They are started as
+   clients are created, up to one fewer than the processors available,
+   with each client given to the least busy, so the work of separate
+   instances spreads across cores. They are stopped when the library
+   is unloaded. */
+
+/*****************************************************************************/
+
+#include <atomic>
+
+/*****************************************************************************/
+
+#include "cmt.h"
+
+/*****************************************************************************/
+
+/** A single-producer single-consumer queue of lCapacity Ts, which must
+    be a power of two. One thread may push() and one other may pop()
+    without locking; neither blocks. */
+template <typename T, unsigned long lCapacity>
+class CMT_SPSCQueue {
+private:
+
+  CMT_SPSCQueue(const CMT_SPSCQueue &);
+  CMT_SPSCQueue & operator=(const CMT_SPSCQueue &);
+
+  /** Both run on without wrapping, so they differ by the number of
+      items queued. Each is written by one side only, and they are
+      kept on separate cache lines so the sides do not contend. */
+  alignas(64) std::atomic<unsigned long> m_lHead;
+  alignas(64) std::atomic<unsigned long> m_lTail;
+  T m_atItems[lCapacity];
+
+public:
+
+  CMT_SPSCQueue()
+    : m_lHead(0),
+      m_lTail(0) {
+    static_assert((lCapacity & (lCapacity - 1)) == 0,
+		  "Queue capacity must be a power of two.");
+  }
+
+  /** Add an item, returning false if the queue is full. Producer
+      only. */
+  bool push(const T & rtItem) {
+    const unsigned long lTail = m_lTail.load(std::memory_order_relaxed);
+    if (lTail - m_lHead.load(std::memory_order_acquire) == lCapacity)
+      return false;
+    m_atItems[lTail & (lCapacity - 1)] = rtItem;
+    m_lTail.store(lTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Remove the oldest item, returning false if the queue is
+      empty. Consumer only. */
+  bool pop(T & rtItem) {
+    const unsigned long lHead = m_lHead.load(std::memory_order_relaxed);
+    if (lHead == m_lTail.load(std::memory_order_acquire))
+      return false;
+    rtItem = m_atItems[lHead & (lCapacity - 1)];
+    m_lHead.store(lHead + 1, std::memory_order_release);
+    return true;
+  }
+
+};
+
+/*****************************************************************************/
+
+/** A job or result. What the fields mean is up to the plugin: usually
+    m_lType says what to do and the rest carry its parameters or a
+    pointer to memory that changes hands. */
+struct CMT_WorkItem {
+  long m_lType;
+  void * m_pvData;
+  LADSPA_Data m_afValue[4];
+};
+
+#define CMT_WORKER_QUEUE_SIZE 16
+
+class CMT_WorkerClient;
+class CMT_WorkerThread;
+
+/** Called on a worker thread for each job posted. pvData is as given
+    to the client's constructor. The function may post results back
+    through roClient. */
+typedef void (*CMT_WorkFunction)(void *               pvData,
+				 const CMT_WorkItem & rsJob,
+				 CMT_WorkerClient &   roClient);
+
+/** One plugin instance's connection to the worker threads. Its jobs
+    are done one at a time in the order posted, always on the same
+    thread. Create and delete it outside run(), as both may block and
+    the constructor may start a thread. */
+class CMT_WorkerClient {
+private:
+
+  CMT_WorkerClient(const CMT_WorkerClient &);
+  CMT_WorkerClient & operator=(const CMT_WorkerClient &);
+
+  CMT_WorkFunction m_fWork;
+  void * m_pvData;
+
+  CMT_SPSCQueue<CMT_WorkItem, CMT_WORKER_QUEUE_SIZE> m_oJobs;
+  CMT_SPSCQueue<CMT_WorkItem, CMT_WORKER_QUEUE_SIZE> m_oResults;
+
+  /** The thread doing our jobs and the next of its clients, both
+      guarded by that thread's lock. */
+  CMT_WorkerThread * m_poThread;
+  CMT_WorkerClient * m_poNext;
+
+  friend class CMT_WorkerThread;
+
+public:
+
+  CMT_WorkerClient(CMT_WorkFunction fWork, void * pvData);
+
+  /** Waits for any job in progress. Jobs and results still queued are
+      dropped, so delete the client before anything its work function
+      uses, and take care over memory passed through items. */
+  ~CMT_WorkerClient();
+
+  /** Queue a job, returning false if CMT_WORKER_QUEUE_SIZE are already
+      waiting. Safe to call from run(), but only from one thread at a
+      time. */
+  bool postJob(const CMT_WorkItem & rsJob);
+
+  /** Take the oldest result, returning false if there is none. Safe
+      to call from run(), but only from one thread at a time. */
+  bool takeResult(CMT_WorkItem & rsResult) {
+    return m_oResults.pop(rsResult);
+  }
+
+  /** Queue a result. Only for the work function. Returns false if
+      CMT_WORKER_QUEUE_SIZE results have not been taken. */
+  bool postResult(const CMT_WorkItem & rsResult) {
+    return m_oResults.push(rsResult);
+  }
+
+};
+
+/** Stop the worker threads, waiting for jobs in progress. Called when
+    the library is unloaded. */
+void finalise_workers();
+
+/*****************************************************************************/
+
+#endif
+
+/* EOF */
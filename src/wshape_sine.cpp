@@ -26,12 +26,14 @@
 /*****************************************************************************/
 
 #include "cmt.h"
+#include "oversample.h"
 
 /*****************************************************************************/
 
 #define WSS_CONTROL 0
 #define WSS_INPUT   1
 #define WSS_OUTPUT  2
+#define WSS_FACTOR  3
 
 static void runSineWaveshaper(LADSPA_Handle Instance,
                               unsigned long SampleCount);
@@ -71,6 +73,78 @@ runSineWaveshaper(LADSPA_Handle Instance,
 
 /*****************************************************************************/
 
+static void activateOversampledSineWaveshaper(LADSPA_Handle Instance);
+static void runOversampledSineWaveshaper(LADSPA_Handle Instance,
+					 unsigned long SampleCount);
+
+/** As SineWaveshaper but the signal may be oversampled while it is
+    shaped to reduce aliasing. */
+class OversampledSineWaveshaper : public CMT_PluginInstance {
+private:
+
+  Oversampler m_oOversampler;
+  LADSPA_Data m_afBuffer[OVERSAMPLE_CHUNK * OVERSAMPLE_MAX_FACTOR];
+
+public:
+
+  OversampledSineWaveshaper(const LADSPA_Descriptor *,
+			    unsigned long)
+    : CMT_PluginInstance(4) {
+  }
+
+  friend void activateOversampledSineWaveshaper(LADSPA_Handle Instance);
+  friend void runOversampledSineWaveshaper(LADSPA_Handle Instance,
+					   unsigned long SampleCount);
+
+};
+
+/*****************************************************************************/
+
+static void
+activateOversampledSineWaveshaper(LADSPA_Handle Instance) {
+  ((OversampledSineWaveshaper *)Instance)->m_oOversampler.reset();
+}
+
+/*****************************************************************************/
+
+static void 
+runOversampledSineWaveshaper(LADSPA_Handle Instance,
+			     unsigned long SampleCount) {
+  
+  OversampledSineWaveshaper * poProcessor
+    = (OversampledSineWaveshaper *)Instance;
+  Oversampler & roOversampler = poProcessor->m_oOversampler;
+
+  LADSPA_Data * pfInput  = poProcessor->m_ppfPorts[WSS_INPUT];
+  LADSPA_Data * pfOutput = poProcessor->m_ppfPorts[WSS_OUTPUT];
+  LADSPA_Data   fLimit   = *(poProcessor->m_ppfPorts[WSS_CONTROL]);
+  LADSPA_Data   fOneOverLimit = 1 / fLimit;
+  LADSPA_Data * pfBuffer = poProcessor->m_afBuffer;
+
+  roOversampler.setFactor(*(poProcessor->m_ppfPorts[WSS_FACTOR]));
+
+  while (SampleCount > 0) {
+    unsigned long lChunkSize = SampleCount;
+    if (lChunkSize > OVERSAMPLE_CHUNK)
+      lChunkSize = OVERSAMPLE_CHUNK;
+
+    roOversampler.upsample(pfInput, pfBuffer, lChunkSize);
+    const unsigned long lBufferSize = lChunkSize * roOversampler.getFactor();
+    for (unsigned long lSampleIndex = 0; 
+	 lSampleIndex < lBufferSize; 
+	 lSampleIndex++) 
+      pfBuffer[lSampleIndex] 
+	= fLimit * sin(pfBuffer[lSampleIndex] * fOneOverLimit);
+    roOversampler.downsample(pfBuffer, pfOutput, lChunkSize);
+
+    pfInput += lChunkSize;
+    pfOutput += lChunkSize;
+    SampleCount -= lChunkSize;
+  }
+}
+
+/*****************************************************************************/
+
 void
 initialise_wshape_sine() {
   
@@ -105,6 +179,42 @@ initialise_wshape_sine() {
     (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
      "Output");
   registerNewPluginDescriptor(psDescriptor);
+
+  psDescriptor = new CMT_Descriptor
+    (2000,
+     "wshape_sine_os",
+     LADSPA_PROPERTY_HARD_RT_CAPABLE,
+     "Wave Shaper (Sine-Based, Oversampled)",
+     CMT_MAKER("Richard W.E. Furse"),
+     CMT_COPYRIGHT("2000-2002", "Richard W.E. Furse"),
+     NULL,
+     CMT_Instantiate<OversampledSineWaveshaper>,
+     activateOversampledSineWaveshaper,
+     runOversampledSineWaveshaper,
+     NULL,
+     NULL,
+     NULL);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     "Limiting Amplitude",
+     (LADSPA_HINT_BOUNDED_BELOW 
+      | LADSPA_HINT_LOGARITHMIC
+      | LADSPA_HINT_DEFAULT_1),
+     0,
+     0);
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO,
+     "Input");
+  psDescriptor->addPort
+    (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO,
+     "Output");
+  psDescriptor->addPort
+    (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL,
+     OVERSAMPLE_PORT_NAME,
+     OVERSAMPLE_PORT_HINTS,
+     1,
+     OVERSAMPLE_MAX_FACTOR);
+  registerNewPluginDescriptor(psDescriptor);
 }
 
 /*****************************************************************************/